@@ -0,0 +1,388 @@
+﻿#include "fft_check.h"
+
+#include <sl12/fft.h>
+#include <sl12/random.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+
+namespace
+{
+	// 1次元の計測で1回に変換する要素数の合計
+	const sl12::u32 kBenchmarkElements = 1 << 20;
+	// 2次元の計測の画像サイズとチャンネル数
+	const sl12::u32 kBenchmarkImageSize = 256;
+	const sl12::u32 kBenchmarkChannels = 3;
+
+	/**************************************************//**
+	 * @brief 相対誤差を集計する
+	 *
+	 * NaN や無限大が含まれる場合は誤差も NaN か無限大になる.
+	******************************************************/
+	class ErrorAccumulator
+	{
+	public:
+		void Add(double refRe, double refIm, double re, double im)
+		{
+			double dr = re - refRe, di = im - refIm;
+			double diff = dr * dr + di * di;
+			double mag = refRe * refRe + refIm * refIm;
+			sumDiff_ += diff;
+			sumRef_ += mag;
+			if (!(diff <= maxDiff_) && !std::isnan(maxDiff_))
+			{
+				maxDiff_ = diff;
+			}
+			maxRef_ = std::max(maxRef_, mag);
+		}
+
+		FFTError GetError() const
+		{
+			FFTError ret;
+			ret.maxError = std::sqrt((maxRef_ > 0.0) ? maxDiff_ / maxRef_ : maxDiff_);
+			ret.rmsError = std::sqrt((sumRef_ > 0.0) ? sumDiff_ / sumRef_ : sumDiff_);
+			return ret;
+		}
+
+	private:
+		double	sumDiff_ = 0.0;
+		double	sumRef_ = 0.0;
+		double	maxDiff_ = 0.0;
+		double	maxRef_ = 0.0;
+	};	// class ErrorAccumulator
+
+	// 大きい方の誤差を返す. NaN は残す
+	FFTError MaxError(const FFTError& a, const FFTError& b)
+	{
+		FFTError ret;
+		ret.maxError = (b.maxError <= a.maxError) ? a.maxError : b.maxError;
+		ret.rmsError = (b.rmsError <= a.rmsError) ? a.rmsError : b.rmsError;
+		return ret;
+	}
+
+	void FillRandom(float* p, size_t count, sl12::u32 seed)
+	{
+		sl12::u32 state = sl12::PcgHash(seed);
+		for (size_t i = 0; i < count; ++i)
+		{
+			p[i] = sl12::NextRandom(state) * 2.0f - 1.0f;
+		}
+	}
+
+	//---------------------------------------
+	// 倍精度の2次元 DFT
+	// 行方向、列方向の順に ComputeReferenceDFT で計算する
+	//---------------------------------------
+	void ComputeReferenceDFT2D(const float* pRe, const float* pIm, sl12::u32 width, sl12::u32 height, std::vector<double>& outRe, std::vector<double>& outIm)
+	{
+		const size_t count = static_cast<size_t>(width) * height;
+		outRe.resize(count);
+		outIm.resize(count);
+
+		std::vector<double> srcRe(std::max(width, height)), srcIm(std::max(width, height));
+		std::vector<double> dstRe(std::max(width, height)), dstIm(std::max(width, height));
+		for (sl12::u32 y = 0; y < height; ++y)
+		{
+			for (sl12::u32 x = 0; x < width; ++x)
+			{
+				srcRe[x] = pRe[y * width + x];
+				srcIm[x] = pIm ? pIm[y * width + x] : 0.0;
+			}
+			sl12::ComputeReferenceDFT(srcRe.data(), srcIm.data(), &outRe[y * width], &outIm[y * width], width, false);
+		}
+		for (sl12::u32 x = 0; x < width; ++x)
+		{
+			for (sl12::u32 y = 0; y < height; ++y)
+			{
+				srcRe[y] = outRe[y * width + x];
+				srcIm[y] = outIm[y * width + x];
+			}
+			sl12::ComputeReferenceDFT(srcRe.data(), srcIm.data(), dstRe.data(), dstIm.data(), height, false);
+			for (sl12::u32 y = 0; y < height; ++y)
+			{
+				outRe[y * width + x] = dstRe[y];
+				outIm[y * width + x] = dstIm[y];
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 順変換と逆変換を繰り返して最速の時間を返す
+	//---------------------------------------
+	template <typename Func>
+	double MeasureBest(sl12::u32 runCount, Func func)
+	{
+		double best = 1e30;
+		for (sl12::u32 r = 0; r < runCount + 1; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			func();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			// 最初の1回はページフォルトなどを含むので除く
+			if (r > 0)
+			{
+				best = std::min(best, ms);
+			}
+		}
+		return best;
+	}
+
+	void SetResult(FFTBenchmark& out, const char* name, sl12::u32 length, sl12::u32 count, double ms, bool isReal)
+	{
+		out.name = name;
+		out.length = length;
+		out.count = count;
+		out.msPerRun = ms;
+		// 順変換と逆変換の2回分
+		double flops = sl12::GetFFTNominalFlops(length, isReal) * 2.0 * count;
+		out.gflops = (ms > 0.0) ? flops / (ms * 1e6) : 0.0;
+	}
+
+	//---------------------------------------
+	// 1次元の複素 FFT
+	//---------------------------------------
+	void BenchmarkComplex(const char* name, sl12::u32 length, sl12::u32 runCount, FFTBenchmark& out)
+	{
+		sl12::FFTPlan plan;
+		if (!plan.Initialize(length))
+		{
+			return;
+		}
+		const sl12::u32 count = std::max(kBenchmarkElements / length, 1u);
+		const size_t total = static_cast<size_t>(length) * count;
+		std::vector<float> re(total), im(total), work(plan.GetWorkSize());
+		FillRandom(re.data(), total, 1);
+		FillRandom(im.data(), total, 2);
+
+		// 誤差は先頭の1列で調べる
+		std::vector<float> srcRe(re.begin(), re.begin() + length), srcIm(im.begin(), im.begin() + length);
+		std::vector<double> dre(srcRe.begin(), srcRe.end()), dim(srcIm.begin(), srcIm.end());
+		std::vector<double> refRe(length), refIm(length);
+		sl12::ComputeReferenceDFT(dre.data(), dim.data(), refRe.data(), refIm.data(), length, false);
+		plan.Forward(re.data(), im.data(), work.data());
+		ErrorAccumulator forward, roundTrip;
+		for (sl12::u32 i = 0; i < length; ++i)
+		{
+			forward.Add(refRe[i], refIm[i], re[i], im[i]);
+		}
+		plan.Inverse(re.data(), im.data(), work.data());
+		for (sl12::u32 i = 0; i < length; ++i)
+		{
+			roundTrip.Add(srcRe[i], srcIm[i], re[i], im[i]);
+		}
+
+		double ms = MeasureBest(runCount, [&]()
+		{
+			for (sl12::u32 i = 0; i < count; ++i)
+			{
+				plan.Forward(&re[i * length], &im[i * length], work.data());
+				plan.Inverse(&re[i * length], &im[i * length], work.data());
+			}
+		});
+
+		SetResult(out, name, length, count, ms, false);
+		out.forwardError = forward.GetError().rmsError;
+		out.roundTripError = roundTrip.GetError().rmsError;
+	}
+
+	//---------------------------------------
+	// 1次元の実数 FFT
+	//---------------------------------------
+	void BenchmarkReal(const char* name, sl12::u32 length, sl12::u32 runCount, FFTBenchmark& out)
+	{
+		sl12::RealFFTPlan plan;
+		if (!plan.Initialize(length))
+		{
+			return;
+		}
+		const sl12::u32 count = std::max(kBenchmarkElements / length, 1u);
+		const sl12::u32 spectrumLength = plan.GetSpectrumLength();
+		const size_t total = static_cast<size_t>(length) * count;
+		std::vector<float> src(total), dst(total), work(plan.GetWorkSize());
+		std::vector<float> re(static_cast<size_t>(spectrumLength) * count), im(static_cast<size_t>(spectrumLength) * count);
+		FillRandom(src.data(), total, 3);
+
+		std::vector<double> dre(src.begin(), src.begin() + length), dim(length, 0.0);
+		std::vector<double> refRe(length), refIm(length);
+		sl12::ComputeReferenceDFT(dre.data(), dim.data(), refRe.data(), refIm.data(), length, false);
+
+		double ms = MeasureBest(runCount, [&]()
+		{
+			for (sl12::u32 i = 0; i < count; ++i)
+			{
+				plan.Forward(&src[i * length], &re[i * spectrumLength], &im[i * spectrumLength], work.data());
+				plan.Inverse(&re[i * spectrumLength], &im[i * spectrumLength], &dst[i * length], work.data());
+			}
+		});
+
+		ErrorAccumulator forward, roundTrip;
+		for (sl12::u32 i = 0; i < spectrumLength; ++i)
+		{
+			forward.Add(refRe[i], refIm[i], re[i], im[i]);
+		}
+		for (sl12::u32 i = 0; i < length; ++i)
+		{
+			roundTrip.Add(src[i], 0.0, dst[i], 0.0);
+		}
+
+		SetResult(out, name, length, count, ms, true);
+		out.forwardError = forward.GetError().rmsError;
+		out.roundTripError = roundTrip.GetError().rmsError;
+	}
+
+	//---------------------------------------
+	// 2次元の FFT
+	//---------------------------------------
+	void Benchmark2D(const char* name, bool isReal, sl12::u32 runCount, FFTBenchmark& out)
+	{
+		const sl12::u32 size = kBenchmarkImageSize;
+		sl12::FFT2D fft;
+		if (!fft.Initialize(size, size))
+		{
+			return;
+		}
+		const size_t pixelCount = static_cast<size_t>(size) * size;
+		const size_t spectrumCount = static_cast<size_t>(fft.GetSpectrumWidth()) * size;
+		std::vector<float> src(pixelCount * kBenchmarkChannels), dst(pixelCount * kBenchmarkChannels);
+		std::vector<float> re(pixelCount * kBenchmarkChannels), im(pixelCount * kBenchmarkChannels);
+		FillRandom(src.data(), src.size(), 4);
+
+		std::vector<double> refRe, refIm;
+		ComputeReferenceDFT2D(src.data(), nullptr, size, size, refRe, refIm);
+
+		ErrorAccumulator forward, roundTrip;
+		double ms = 0.0;
+		if (isReal)
+		{
+			fft.ForwardReal(src.data(), re.data(), im.data(), 0);
+			for (sl12::u32 y = 0; y < size; ++y)
+			{
+				for (sl12::u32 x = 0; x < fft.GetSpectrumWidth(); ++x)
+				{
+					size_t index = static_cast<size_t>(y) * fft.GetSpectrumWidth() + x;
+					forward.Add(refRe[y * size + x], refIm[y * size + x], re[index], im[index]);
+				}
+			}
+
+			ms = MeasureBest(runCount, [&]()
+			{
+				for (sl12::u32 c = 0; c < kBenchmarkChannels; ++c)
+				{
+					fft.ForwardReal(&src[pixelCount * c], &re[spectrumCount * c], &im[spectrumCount * c], 0);
+					fft.InverseReal(&re[spectrumCount * c], &im[spectrumCount * c], &dst[pixelCount * c], 0);
+				}
+			});
+		}
+		else
+		{
+			std::copy(src.begin(), src.end(), re.begin());
+			std::fill(im.begin(), im.end(), 0.0f);
+			fft.Forward(re.data(), im.data(), 0);
+			for (size_t i = 0; i < pixelCount; ++i)
+			{
+				forward.Add(refRe[i], refIm[i], re[i], im[i]);
+			}
+
+			ms = MeasureBest(runCount, [&]()
+			{
+				for (sl12::u32 c = 0; c < kBenchmarkChannels; ++c)
+				{
+					std::copy(src.begin() + pixelCount * c, src.begin() + pixelCount * (c + 1), re.begin() + pixelCount * c);
+					std::fill(im.begin() + pixelCount * c, im.begin() + pixelCount * (c + 1), 0.0f);
+					fft.Forward(&re[pixelCount * c], &im[pixelCount * c], 0);
+					fft.Inverse(&re[pixelCount * c], &im[pixelCount * c], 0);
+				}
+			});
+			std::copy(re.begin(), re.end(), dst.begin());
+		}
+
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			roundTrip.Add(src[i], 0.0, dst[i], 0.0);
+		}
+
+		SetResult(out, name, size * size, kBenchmarkChannels, ms, isReal);
+		out.forwardError = forward.GetError().rmsError;
+		out.roundTripError = roundTrip.GetError().rmsError;
+	}
+
+}	// namespace
+
+
+//---------------------------------------
+// GPU から読み戻した FFT の結果を CPU の FFT と比較する
+//---------------------------------------
+FFTValidation ValidateFFT(
+	const float* pSource, const float* pSpectrumRe, const float* pSpectrumIm, const float* pInverse,
+	sl12::u32 width, sl12::u32 height, double tolerance)
+{
+	FFTValidation result;
+	sl12::FFT2D fft;
+	if (!fft.Initialize(width, height))
+	{
+		return result;
+	}
+
+	const size_t pixelCount = static_cast<size_t>(width) * height;
+	const sl12::u32 spectrumWidth = fft.GetSpectrumWidth();
+	std::vector<float> src(pixelCount);
+	std::vector<float> re(static_cast<size_t>(spectrumWidth) * height), im(static_cast<size_t>(spectrumWidth) * height);
+	for (int c = 0; c < 3; ++c)
+	{
+		for (size_t i = 0; i < pixelCount; ++i)
+		{
+			src[i] = pSource[i * 4 + c];
+		}
+		fft.ForwardReal(src.data(), re.data(), im.data(), 0);
+
+		ErrorAccumulator spectrum, inverse;
+		for (sl12::u32 y = 0; y < height; ++y)
+		{
+			for (sl12::u32 x = 0; x < width; ++x)
+			{
+				// 右半分は X[y][x] = conj(X[(H-y)%H][W-x])
+				double refRe, refIm;
+				if (x < spectrumWidth)
+				{
+					size_t index = static_cast<size_t>(y) * spectrumWidth + x;
+					refRe = re[index];
+					refIm = im[index];
+				}
+				else
+				{
+					size_t index = static_cast<size_t>((height - y) % height) * spectrumWidth + (width - x);
+					refRe = re[index];
+					refIm = -im[index];
+				}
+
+				size_t pixel = static_cast<size_t>(y) * width + x;
+				spectrum.Add(refRe, refIm, pSpectrumRe[pixel * 4 + c], pSpectrumIm[pixel * 4 + c]);
+				inverse.Add(src[pixel], 0.0, pInverse[pixel * 4 + c], 0.0);
+			}
+		}
+		result.spectrum = MaxError(result.spectrum, spectrum.GetError());
+		result.inverse = MaxError(result.inverse, inverse.GetError());
+	}
+
+	result.isPassed = (result.spectrum.rmsError <= tolerance) && (result.inverse.rmsError <= tolerance);
+	return result;
+}
+
+//---------------------------------------
+// CPU の FFT を計測する
+//---------------------------------------
+void BenchmarkFFT(sl12::u32 runCount, FFTBenchmark* pResults)
+{
+	runCount = std::max(runCount, 1u);
+
+	BenchmarkComplex("C2C 256", 256, runCount, pResults[0]);
+	BenchmarkComplex("C2C 1000 (Bluestein)", 1000, runCount, pResults[1]);
+	BenchmarkReal("R2C 256", 256, runCount, pResults[2]);
+	Benchmark2D("2D C2C 256x256", false, runCount, pResults[3]);
+	Benchmark2D("2D R2C 256x256", true, runCount, pResults[4]);
+}
+
+
+//	EOF
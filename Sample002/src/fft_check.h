@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+
+
+/*************************************************//**
+ * @brief FFT の結果と正解の差
+ *
+ * どちらも正解の大きさで割った相対誤差.
+*****************************************************/
+struct FFTError
+{
+	double	maxError = 0.0;		//!< 差の絶対値の最大 / 正解の絶対値の最大
+	double	rmsError = 0.0;		//!< 差の二乗平均平方根 / 正解の二乗平均平方根
+};	// struct FFTError
+
+/*************************************************//**
+ * @brief GPU の FFT の検証結果
+*****************************************************/
+struct FFTValidation
+{
+	FFTError	spectrum;			//!< 順変換の結果と CPU の FFT の差. RGB で最大のもの
+	FFTError	inverse;			//!< 逆変換の結果と元画像の差. RGB で最大のもの
+	bool		isPassed = false;	//!< どちらの rmsError も許容誤差以下
+};	// struct FFTValidation
+
+/**
+ * @brief GPU から読み戻した FFT の結果を CPU の FFT (sl12::FFT2D) と比較する
+ *
+ * GPU は虚部を0として複素 FFT を行うので、CPU は実数の FFT を行い、エルミート対称性から残りの周波数を求める.\n
+ * 画像はすべて RGBA の float で、A は比較しない.
+ *
+ * @param[in]	pSource						元画像
+ * @param[in]	pSpectrumRe, pSpectrumIm	GPU の順変換の結果
+ * @param[in]	pInverse					GPU の逆変換の結果
+ * @param[in]	tolerance					rmsError の許容誤差
+*/
+FFTValidation ValidateFFT(
+	const float* pSource, const float* pSpectrumRe, const float* pSpectrumIm, const float* pInverse,
+	sl12::u32 width, sl12::u32 height, double tolerance);
+
+/*************************************************//**
+ * @brief CPU の FFT の計測結果
+*****************************************************/
+struct FFTBenchmark
+{
+	const char*	name = nullptr;
+	sl12::u32	length = 0;				//!< 1回の変換の要素数
+	sl12::u32	count = 0;				//!< 1回の計測で変換する数
+	double		msPerRun = 0.0;			//!< 順変換と逆変換を count 回行う最速の時間
+	double		gflops = 0.0;			//!< 名目上の演算数 (sl12::GetFFTNominalFlops) による GFLOP/s
+	double		forwardError = 0.0;		//!< 倍精度の DFT との相対誤差 (二乗平均平方根)
+	double		roundTripError = 0.0;	//!< 順変換して逆変換した結果と入力の相対誤差 (二乗平均平方根)
+};	// struct FFTBenchmark
+
+static const sl12::u32 kFFTBenchmarkCount = 5;
+
+/**
+ * @brief CPU の FFT を計測する
+ *
+ * 1次元の複素数 (2のべき乗と Bluestein 法)、1次元の実数、2次元の複素数と実数を計測する.\n
+ * 1次元はシングルスレッド、2次元はハードウェアのスレッド数で計算する.
+ *
+ * @param[out]	pResults	kFFTBenchmarkCount 要素
+*/
+void BenchmarkFFT(sl12::u32 runCount, FFTBenchmark* pResults);
+
+
+//	EOF
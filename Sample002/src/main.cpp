@@ -12,10 +12,13 @@
 #include <sl12/buffer_view.h>
 #include <sl12/shader.h>
 #include <sl12/gui.h>
+#include <sl12/float16.h>
 #include <DirectXTex.h>
 #include <windowsx.h>
+#include <vector>
 
 #include "file.h"
+#include "fft_check.h"
 
 
 namespace
@@ -42,6 +45,8 @@ namespace
 	static const DXGI_FORMAT	kDepthViewFormat = DXGI_FORMAT_D32_FLOAT;
 	static const int kMaxFrameCount = sl12::Swapchain::kMaxBuffer;
 	static const int kMaxComputeCmdList = 10;
+	static const double kValidateTolerance = 2e-3;		// GPU の FFT の許容誤差. 中間結果も half で保存される
+	static const sl12::u32 kBenchmarkRunCount = 5;
 
 	HWND	g_hWnd_;
 
@@ -117,6 +122,19 @@ namespace
 	int					g_SyncInterval = 1;
 	bool				g_useResourceBarrier_ = true;
 
+	// GPU の FFT の検証
+	std::vector<float>					g_sourcePixels_;			// 元画像. RGBA の float
+	ID3D12Resource*						g_pValidateReadback_ = nullptr;
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT	g_validateFootprints_[3];	// FFT の実部、虚部、IFFT の結果
+	bool								g_validateRequested = false;
+	sl12::u32							g_validateWaitFrames = 0;	// 読み戻しが完了するまでのフレーム数. 0 なら待機していない
+	bool								g_hasValidateResult = false;
+	FFTValidation						g_validateResult;
+
+	// CPU の FFT の計測
+	bool								g_hasBenchmarkResult = false;
+	FFTBenchmark						g_benchmarkResults[kFFTBenchmarkCount];
+
 }
 
 // Window Proc
@@ -190,6 +208,38 @@ void InitWindow(HINSTANCE hInstance, int nCmdShow)
 	ShowWindow(g_hWnd_, nCmdShow);
 }
 
+// 読み戻し用のバッファを作成する
+ID3D12Resource* CreateReadbackBuffer(ID3D12Device* pDev, UINT64 size)
+{
+	D3D12_HEAP_PROPERTIES prop{};
+	prop.Type = D3D12_HEAP_TYPE_READBACK;
+	prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	prop.CreationNodeMask = 1;
+	prop.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC rd{};
+	rd.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	rd.Alignment = 0;
+	rd.Width = size;
+	rd.Height = 1;
+	rd.DepthOrArraySize = 1;
+	rd.MipLevels = 1;
+	rd.Format = DXGI_FORMAT_UNKNOWN;
+	rd.SampleDesc.Count = 1;
+	rd.SampleDesc.Quality = 0;
+	rd.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	rd.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+
+	ID3D12Resource* pRes = nullptr;
+	auto hr = pDev->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &rd, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pRes));
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+	return pRes;
+}
+
 bool InitializeAssets()
 {
 	ID3D12Device* pDev = g_Device_.GetDeviceDep();
@@ -243,6 +293,24 @@ bool InitializeAssets()
 		return false;
 	}
 
+	// 検証用の読み戻しバッファを作成する
+	// FFT の実部、虚部、IFFT の結果のターゲットを並べて配置する
+	{
+		UINT64 offset = 0;
+		for (int i = 0; i < _countof(g_validateFootprints_); i++)
+		{
+			UINT64 size = 0;
+			pDev->GetCopyableFootprints(&g_FFTTargets_[i + 2].GetResourceDesc(), 0, 1, 0, &g_validateFootprints_[i], nullptr, nullptr, &size);
+			g_validateFootprints_[i].Offset = offset;
+			offset += (size + D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1) & ~(UINT64)(D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT - 1);
+		}
+		g_pValidateReadback_ = CreateReadbackBuffer(pDev, offset);
+		if (!g_pValidateReadback_)
+		{
+			return false;
+		}
+	}
+
 	// 定数バッファを作成
 	{
 		D3D12_HEAP_PROPERTIES prop{};
@@ -368,6 +436,23 @@ bool InitializeAssets()
 		{
 			return false;
 		}
+
+		// CPU の FFT で検証するため、RGBA の float でも保持しておく
+		DirectX::ScratchImage image, converted;
+		if (FAILED(DirectX::LoadFromTGAMemory(texFile.GetData(), texFile.GetSize(), nullptr, image)))
+		{
+			return false;
+		}
+		if (FAILED(DirectX::Convert(*image.GetImage(0, 0, 0), DXGI_FORMAT_R32G32B32A32_FLOAT, DirectX::TEX_FILTER_DEFAULT, DirectX::TEX_THRESHOLD_DEFAULT, converted)))
+		{
+			return false;
+		}
+		const DirectX::Image* pImage = converted.GetImage(0, 0, 0);
+		g_sourcePixels_.resize(pImage->width * pImage->height * 4);
+		for (size_t y = 0; y < pImage->height; y++)
+		{
+			memcpy(&g_sourcePixels_[y * pImage->width * 4], pImage->pixels + y * pImage->rowPitch, pImage->width * sizeof(float) * 4);
+		}
 	}
 	// サンプラ作成
 	{
@@ -659,6 +744,8 @@ void DestroyAssets()
 {
 	g_Gui_.Destroy();
 
+	sl12::SafeRelease(g_pValidateReadback_);
+
 	for (auto& v : g_pFFTPipelineStates_)
 	{
 		sl12::SafeRelease(v);
@@ -801,6 +888,44 @@ void LoadFFTCommand(sl12::CommandList& cmdList, int numLoop)
 	}
 }
 
+// 読み戻した GPU の FFT の結果を CPU の FFT と比較する
+void ValidateGpuFFT()
+{
+	const sl12::u32 width = g_FFTTargets_[2].GetTextureDesc().width;
+	const sl12::u32 height = g_FFTTargets_[2].GetTextureDesc().height;
+	if (g_sourcePixels_.size() != (size_t)width * height * 4)
+	{
+		// 元画像のサイズが FFT のサイズと異なる
+		return;
+	}
+
+	const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& last = g_validateFootprints_[_countof(g_validateFootprints_) - 1];
+	void* p = nullptr;
+	D3D12_RANGE range{ 0, (SIZE_T)(last.Offset + (UINT64)last.Footprint.RowPitch * height) };
+	if (FAILED(g_pValidateReadback_->Map(0, &range, &p)))
+	{
+		return;
+	}
+
+	// R16G16B16A16_FLOAT を RGBA の float に変換する
+	std::vector<float> images[_countof(g_validateFootprints_)];
+	for (int i = 0; i < _countof(g_validateFootprints_); i++)
+	{
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& fp = g_validateFootprints_[i];
+		images[i].resize((size_t)width * height * 4);
+		for (sl12::u32 y = 0; y < height; y++)
+		{
+			const sl12::u8* pRow = reinterpret_cast<const sl12::u8*>(p) + fp.Offset + (size_t)fp.Footprint.RowPitch * y;
+			sl12::HalfToFloatArray(reinterpret_cast<const sl12::u16*>(pRow), &images[i][(size_t)y * width * 4], (size_t)width * 4);
+		}
+	}
+	D3D12_RANGE writeRange{ 0, 0 };
+	g_pValidateReadback_->Unmap(0, &writeRange);
+
+	g_validateResult = ValidateFFT(g_sourcePixels_.data(), images[0].data(), images[1].data(), images[2].data(), width, height, kValidateTolerance);
+	g_hasValidateResult = true;
+}
+
 void RenderScene()
 {
 	static int sFFTCalcLoop = 1000;
@@ -810,6 +935,16 @@ void RenderScene()
 
 	sl12::CommandList& mainCmdList = g_mainCmdLists_[frameIndex];
 
+	// 検証用の読み戻しの完了を待つ
+	// 記録したフレームのコマンドリストは次のフレームで完了する
+	if (g_validateWaitFrames > 0)
+	{
+		if (--g_validateWaitFrames == 0)
+		{
+			ValidateGpuFFT();
+		}
+	}
+
 	g_Gui_.BeginNewFrame(&mainCmdList, kWindowWidth, kWindowHeight, g_InputData_);
 
 	bool runCalcFFT = false;
@@ -849,6 +984,37 @@ void RenderScene()
 		ImGui::Checkbox("Use Barrier", &g_useResourceBarrier_);
 
 		ImGui::Text("Frame Count To Calc : %d", g_FrameCountToCalced);
+
+		// GPU の結果の検証. FFT の計算後のみ
+		if (g_isFFTCalced && g_validateWaitFrames == 0 && ImGui::Button("Validate"))
+		{
+			g_validateRequested = true;
+		}
+		if (g_validateRequested || g_validateWaitFrames > 0)
+		{
+			ImGui::Text("Validating...");
+		}
+		else if (g_hasValidateResult)
+		{
+			const FFTValidation& v = g_validateResult;
+			ImGui::Text("%s (tolerance %.1e)", v.isPassed ? "Passed" : "Failed", kValidateTolerance);
+			ImGui::Text("  FFT  : max %.2e, rms %.2e", v.spectrum.maxError, v.spectrum.rmsError);
+			ImGui::Text("  IFFT : max %.2e, rms %.2e", v.inverse.maxError, v.inverse.rmsError);
+		}
+
+		// CPU 版の計測
+		if (ImGui::Button("CPU Benchmark"))
+		{
+			BenchmarkFFT(kBenchmarkRunCount, g_benchmarkResults);
+			g_hasBenchmarkResult = true;
+		}
+		if (g_hasBenchmarkResult)
+		{
+			for (auto&& r : g_benchmarkResults)
+			{
+				ImGui::Text("%-20s : %.3f ms, %.2f GFLOP/s, error %.1e, round trip %.1e", r.name, r.msPerRun, r.gflops, r.forwardError, r.roundTripError);
+			}
+		}
 	}
 	else
 	{
@@ -924,6 +1090,31 @@ void RenderScene()
 		g_isFFTCalced = true;
 	}
 
+	// 検証用に FFT の結果を読み戻す
+	if (g_validateRequested)
+	{
+		for (int i = 0; i < _countof(g_validateFootprints_); i++)
+		{
+			sl12::Texture* pTarget = &g_FFTTargets_[i + 2];
+			mainCmdList.TransitionBarrier(pTarget, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+			D3D12_TEXTURE_COPY_LOCATION dst{}, src{};
+			dst.pResource = g_pValidateReadback_;
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			dst.PlacedFootprint = g_validateFootprints_[i];
+			src.pResource = pTarget->GetResourceDep();
+			src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			src.SubresourceIndex = 0;
+			mainCmdList.GetCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+
+			// FFT のパスはバリアで状態を遷移しないので、作成時の状態に戻しておく
+			mainCmdList.TransitionBarrier(pTarget, D3D12_RESOURCE_STATE_COPY_DEST);
+		}
+
+		g_validateRequested = false;
+		g_validateWaitFrames = 2;
+	}
+
 	mainCmdList.TransitionBarrier(&g_texture_, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 	for (auto& v : g_vbuffers_)
 	{
@@ -11,6 +11,10 @@ RWTexture2D<float4>	outputImageI : register(u1);
 
 #define PI 3.14159265
 
+// Twiddle factors exp(-2*PI*i*k/LENGTH).
+// Each thread computes one entry per group instead of calling sin/cos in every butterfly pass.
+groupshared float2 twiddleTable[LENGTH];
+
 void GetButterflyValues(uint passIndex, uint x, out uint2 indices, out float2 weights)
 {
 	uint sectionWidth = 2 << passIndex;
@@ -20,10 +24,8 @@ void GetButterflyValues(uint passIndex, uint x, out uint2 indices, out float2 we
 	uint halfSectionOffset = x & (halfSectionWidth - 1);
 	uint sectionOffset = x & (sectionWidth - 1);
 
-	float a = 2.0 * PI * float(sectionOffset) / float(sectionWidth);
-	weights.y = sin(a);
-	weights.x = cos(a);
-	weights.y = -weights.y;
+	// exp(-2*PI*i*sectionOffset/sectionWidth)
+	weights = twiddleTable[sectionOffset * (LENGTH / sectionWidth)];
 
 	indices.x = sectionStartOffset + halfSectionOffset;
 	indices.y = sectionStartOffset + halfSectionOffset + halfSectionWidth;
@@ -92,6 +94,11 @@ void main(uint3 dispatchID : SV_DispatchThreadID)
 	pingPongArray[1][position.x].xyz = inputImageI.Load(int3(texturePos, 0)).xyz;
 #endif
 
+	// The first butterfly pass waits on the group barrier, so the table is complete by then
+	float2 twiddle;
+	sincos(2.0 * PI * float(position.x) / float(LENGTH), twiddle.y, twiddle.x);
+	twiddleTable[position.x] = float2(twiddle.x, -twiddle.y);
+
 	uint4 textureIndices = uint4(0, 1, 2, 3);
 
 	for (int i = 0; i < BUTTERFLY_COUNT - 1; i++)
@@ -15,6 +15,9 @@
 #include <sl12/pipeline_state.h>
 #include <sl12/shader.h>
 #include <sl12/gui.h>
+#include <sl12/gpu_profiler.h>
+#include <sl12/profiler.h>
+#include <sl12/geometry_generator.h>
 #include <DirectXTex.h>
 #include <windowsx.h>
 
@@ -29,6 +32,9 @@ namespace
 	//static const DXGI_FORMAT	kDepthFormat = DXGI_FORMAT_R32G8X24_TYPELESS;
 	static const DXGI_FORMAT	kDepthFormat = DXGI_FORMAT_D32_FLOAT;
 	static const uint32_t kMaxTriangle = 10000000;
+	static const uint32_t kProfileHistory = 60;			// 統計に含めるフレーム数
+	static const uint32_t kTraceFrameCount = 60;		// トレースに出力するフレーム数
+	static const uint32_t kGeometrySeed = 0;			// 三角形の生成に使う乱数のシード
 
 	struct CompressVertex
 	{
@@ -70,12 +76,17 @@ namespace
 	//ID3D12PipelineState*	g_pCompressPipeline_ = nullptr;
 	//ID3D12PipelineState*	g_pNoCompressPipeline_ = nullptr;
 
-	ID3D12QueryHeap*		g_pTimestampQuery_[sl12::Swapchain::kMaxBuffer] = { nullptr };
-	ID3D12Resource*			g_pTimestampBuffer_[sl12::Swapchain::kMaxBuffer] = { nullptr };
+	sl12::GpuProfiler		g_gpuProfiler_;
+	sl12::CpuProfiler		g_cpuProfiler_;
+	sl12::ProfileStats		g_gpuStats_;
+	sl12::ProfileStats		g_cpuStats_;
+	sl12::ChromeTraceWriter	g_traceWriter_;
+	uint32_t				g_traceFramesLeft = 0;
 
 	sl12::Gui		g_Gui_;
 	sl12::InputData	g_InputData_{};
 	bool			g_IsNoCompressVertex = false;
+	float			g_generateMs[2] = {};		// 頂点の生成とアップロードにかかった時間
 }
 
 // Window Proc
@@ -192,72 +203,54 @@ bool InitializeAssets()
 	}
 
 	// 頂点バッファを作成
+	// 頂点はアップロード用のメモリに直接生成する
 	{
-		auto frandom = [](float minv, float maxv) {
-			float t = (float)rand() / (float)(RAND_MAX - 1);
-			return minv * (1.0f - t) + maxv * t;
+		sl12::GeometryGenerator::Desc genDesc;
+		genDesc.triangleCount = kMaxTriangle;
+		genDesc.seed = kGeometrySeed;
+
+		const sl12::GeometryVertexElement compressElements[] = {
+			{ sl12::GeometryAttribute::Position, sl12::GeometryFormat::Float32x3, 0 },
+			{ sl12::GeometryAttribute::Color, sl12::GeometryFormat::Unorm8x4, sizeof(float) * 3 },
 		};
-		auto posRandom = [&](float* p) {
-			p[0] = frandom(-20.0f, 20.0f);
-			p[1] = frandom(-20.0f, 20.0f);
-			p[2] = frandom(-20.0f, 20.0f);
+		const sl12::GeometryVertexElement noCompressElements[] = {
+			{ sl12::GeometryAttribute::Position, sl12::GeometryFormat::Float32x3, 0 },
+			{ sl12::GeometryAttribute::Color, sl12::GeometryFormat::Float32x4, sizeof(float) * 3 },
 		};
-		auto colRandom = [&](float* c) {
-			c[0] = frandom(0.0f, 1.0f);
-			c[1] = frandom(0.0f, 1.0f);
-			c[2] = frandom(0.0f, 1.0f);
-			c[3] = 1.0f;
+		struct VertexSetup
+		{
+			const sl12::GeometryVertexElement*	pElements;
+			uint32_t							numElements;
+			uint32_t							stride;
 		};
-		auto toU32Col = [](float* c) {
-			return ((uint32_t)(c[3] * 255.0f) << 24) | ((uint32_t)(c[2] * 255.0f) << 16) | ((uint32_t)(c[1] * 255.0f) << 8) | ((uint32_t)(c[0] * 255.0f) << 0);
+		const VertexSetup setups[] = {
+			{ compressElements, _countof(compressElements), sizeof(CompressVertex) },
+			{ noCompressElements, _countof(noCompressElements), sizeof(NoCompressVertex) },
 		};
 
-		CompressVertex* pCV = new CompressVertex[kMaxTriangle * 3];
-		NoCompressVertex* pNV = new NoCompressVertex[kMaxTriangle * 3];
-		for (uint32_t i = 0; i < kMaxTriangle; ++i)
-		{
-			uint32_t index = i * 3;
-			// カラー
-			colRandom(pNV[index].color);
-			memcpy(pNV[index + 1].color, pNV[index].color, sizeof(pNV[index].color));
-			memcpy(pNV[index + 2].color, pNV[index].color, sizeof(pNV[index].color));
-			pCV[index].color = pCV[index + 1].color = pCV[index + 2].color = toU32Col(pNV[index].color);
-			// 座標
-			float p[3];
-			posRandom(p);
-			pNV[index].position[0] = pCV[index].position[0] = p[0];
-			pNV[index].position[1] = pCV[index].position[1] = p[1] + 0.2f;
-			pNV[index].position[2] = pCV[index].position[2] = p[2];
-			pNV[index + 1].position[0] = pCV[index + 1].position[0] = p[0] - 0.2f;
-			pNV[index + 1].position[1] = pCV[index + 1].position[1] = p[1] - 0.2f;
-			pNV[index + 1].position[2] = pCV[index + 1].position[2] = p[2];
-			pNV[index + 2].position[0] = pCV[index + 2].position[0] = p[0] + 0.2f;
-			pNV[index + 2].position[1] = pCV[index + 2].position[1] = p[1] - 0.2f;
-			pNV[index + 2].position[2] = pCV[index + 2].position[2] = p[2];
-		}
-
-		if (!g_vbuffers_[0].Initialize(&g_Device_, sizeof(CompressVertex) * kMaxTriangle * 3, sizeof(CompressVertex), sl12::BufferUsage::VertexBuffer, false, false))
+		for (uint32_t i = 0; i < _countof(setups); ++i)
 		{
-			return false;
-		}
-		if (!g_vbufferViews_[0].Initialize(&g_Device_, &g_vbuffers_[0]))
-		{
-			return false;
-		}
-		g_vbuffers_[0].UpdateBuffer(&g_Device_, &g_copyCmdList_, pCV, sizeof(CompressVertex) * kMaxTriangle * 3);
+			sl12::GeometryGenerator generator;
+			if (!generator.Initialize(genDesc, setups[i].pElements, setups[i].numElements, setups[i].stride))
+			{
+				return false;
+			}
+			if (!g_vbuffers_[i].Initialize(&g_Device_, generator.GetBufferSize(), setups[i].stride, sl12::BufferUsage::VertexBuffer, false, false))
+			{
+				return false;
+			}
+			if (!g_vbufferViews_[i].Initialize(&g_Device_, &g_vbuffers_[i]))
+			{
+				return false;
+			}
 
-		if (!g_vbuffers_[1].Initialize(&g_Device_, sizeof(NoCompressVertex) * kMaxTriangle * 3, sizeof(NoCompressVertex), sl12::BufferUsage::VertexBuffer, false, false))
-		{
-			return false;
-		}
-		if (!g_vbufferViews_[1].Initialize(&g_Device_, &g_vbuffers_[1]))
-		{
-			return false;
+			uint64_t startTicks = sl12::CpuProfiler::GetTicks();
+			g_vbuffers_[i].FillBuffer(&g_Device_, &g_copyCmdList_, generator.GetBufferSize(), 0, [&](void* pDst)
+			{
+				generator.Generate(pDst, 0);
+			});
+			g_generateMs[i] = (float)((double)(sl12::CpuProfiler::GetTicks() - startTicks) * 1000.0 / (double)sl12::CpuProfiler::GetTicksPerSecond());
 		}
-		g_vbuffers_[1].UpdateBuffer(&g_Device_, &g_copyCmdList_, pNV, sizeof(NoCompressVertex) * kMaxTriangle * 3);
-
-		delete[] pCV;
-		delete[] pNV;
 	}
 
 	// シェーダロード
@@ -426,46 +419,20 @@ bool InitializeAssets()
 	//	}
 	//}
 
-	// タイムスタンプクエリとバッファ
-	for (int i = 0; i < sl12::Swapchain::kMaxBuffer; ++i)
+	// プロファイラ
+	if (!g_gpuProfiler_.Initialize(&g_Device_, 16))
 	{
-		D3D12_QUERY_HEAP_DESC qd{};
-		qd.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
-		qd.Count = 2;
-		qd.NodeMask = 1;
-
-		auto hr = pDev->CreateQueryHeap(&qd, IID_PPV_ARGS(&g_pTimestampQuery_[i]));
-		if (FAILED(hr))
-		{
-			return false;
-		}
-
-		D3D12_HEAP_PROPERTIES prop{};
-		prop.Type = D3D12_HEAP_TYPE_READBACK;
-		prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		prop.CreationNodeMask = 1;
-		prop.VisibleNodeMask = 1;
-
-		D3D12_RESOURCE_DESC rd{};
-		rd.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		rd.Alignment = 0;
-		rd.Width = sizeof(uint64_t) * 2;
-		rd.Height = 1;
-		rd.DepthOrArraySize = 1;
-		rd.MipLevels = 1;
-		rd.Format = DXGI_FORMAT_UNKNOWN;
-		rd.SampleDesc.Count = 1;
-		rd.SampleDesc.Quality = 0;
-		rd.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		rd.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
-
-		hr = pDev->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &rd, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&g_pTimestampBuffer_[i]));
-		if (FAILED(hr))
-		{
-			return false;
-		}
+		return false;
 	}
+	if (!g_cpuProfiler_.Initialize(1, 64))
+	{
+		return false;
+	}
+	if (!g_gpuStats_.Initialize(kProfileHistory) || !g_cpuStats_.Initialize(kProfileHistory))
+	{
+		return false;
+	}
+	g_cpuProfiler_.SetThreadName("Main Thread");
 
 	// GUIの初期化
 	if (!g_Gui_.Initialize(&g_Device_, DXGI_FORMAT_R8G8B8A8_UNORM, g_DepthBuffer_.GetTextureDesc().format))
@@ -484,8 +451,8 @@ void DestroyAssets()
 {
 	g_Gui_.Destroy();
 
-	for (auto& v : g_pTimestampBuffer_) sl12::SafeRelease(v);
-	for (auto& v : g_pTimestampQuery_) sl12::SafeRelease(v);
+	g_gpuProfiler_.Destroy();
+	g_cpuProfiler_.Destroy();
 
 	//sl12::SafeRelease(g_pNoCompressPipeline_);
 	//sl12::SafeRelease(g_pCompressPipeline_);
@@ -521,6 +488,30 @@ void RenderScene()
 	int32_t frameIndex = (prevFrameIndex + 1) % sl12::Swapchain::kMaxBuffer;
 	g_pNextCmdList_ = &g_mainCmdLists_[frameIndex];
 
+	// 計測結果を集計する
+	// GPU は同じフレーム番号を前回使ったフレーム、CPU は直前のフレームの結果になる
+	{
+		g_gpuProfiler_.BeginFrame(frameIndex);
+		auto&& gpuEvents = g_gpuProfiler_.GetEvents();
+		g_gpuStats_.AddFrame(gpuEvents.data(), gpuEvents.size(), g_gpuProfiler_.GetTicksPerSecond());
+
+		std::vector<sl12::ProfileEvent> cpuEvents;
+		g_cpuProfiler_.CollectEvents(cpuEvents);
+		g_cpuStats_.AddFrame(cpuEvents.data(), cpuEvents.size(), sl12::CpuProfiler::GetTicksPerSecond());
+
+		if (g_traceFramesLeft > 0)
+		{
+			g_traceWriter_.AddEvents(0, cpuEvents.data(), cpuEvents.size(), sl12::CpuProfiler::GetTicksPerSecond());
+			g_traceWriter_.AddEvents(1, gpuEvents.data(), gpuEvents.size(), g_gpuProfiler_.GetTicksPerSecond());
+			if (--g_traceFramesLeft == 0)
+			{
+				g_traceWriter_.WriteFile("profile.json");
+			}
+		}
+	}
+
+	sl12::CpuProfileScope cpuFrameScope(g_cpuProfiler_, "RenderScene");
+
 	g_Gui_.BeginNewFrame(g_pNextCmdList_, kWindowWidth, kWindowHeight, g_InputData_);
 
 	// GUI
@@ -531,22 +522,43 @@ void RenderScene()
 		}
 
 		ImGui::Text(g_IsNoCompressVertex ? "Float32 Color" : "U32 Color");
+		ImGui::Text("Generate : %.1f ms (U32), %.1f ms (Float32)", g_generateMs[0], g_generateMs[1]);
 
-		auto buffer = g_pTimestampBuffer_[prevFrameIndex];
-		void* p = nullptr;
-		D3D12_RANGE range{0, sizeof(uint64_t) * 2};
-		buffer->Map(0, &range, &p);
-		uint64_t* t = (uint64_t*)p;
-		uint64_t time = t[1] - t[0];
-		buffer->Unmap(0, nullptr);
-		uint64_t freq = g_Device_.GetGraphicsQueue().GetTimestampFrequency();
-		float ms = (float)time / ((float)freq / 1000.0f);
-
-		ImGui::Text("Time : %f (ms)", ms);
+		// 直近のフレームの平均 (最小, 最大)
+		auto showStats = [](const char* title, const sl12::ProfileStats& stats)
+		{
+			ImGui::Text("%s", title);
+			for (auto&& e : stats.GetEntries())
+			{
+				ImGui::Text("%*s%s : %.3f (%.3f, %.3f) ms", (int)(e.depth + 1) * 2, "", e.name.c_str(), e.avgMs, e.minMs, e.maxMs);
+			}
+		};
+		showStats("GPU", g_gpuStats_);
+		showStats("CPU", g_cpuStats_);
+
+		if (g_traceFramesLeft == 0 && ImGui::Button("Export Trace"))
+		{
+			g_traceWriter_.Clear();
+			g_traceWriter_.SetProcessName(0, "CPU");
+			g_traceWriter_.SetProcessName(1, "GPU");
+			g_traceWriter_.SetTrackName(1, 0, "Graphics Queue");
+			for (uint32_t i = 0; i < g_cpuProfiler_.GetTrackCount(); ++i)
+			{
+				if (g_cpuProfiler_.GetTrackName(i))
+					g_traceWriter_.SetTrackName(0, i, g_cpuProfiler_.GetTrackName(i));
+			}
+			g_traceFramesLeft = kTraceFrameCount;
+		}
+		if (g_traceFramesLeft > 0)
+		{
+			ImGui::Text("Capturing Trace... (%u)", g_traceFramesLeft);
+		}
 	}
 
 	g_pNextCmdList_->Reset();
 
+	g_gpuProfiler_.BeginScope(g_pNextCmdList_, "Frame");
+
 	for (auto& v : g_vbuffers_)
 	{
 		g_pNextCmdList_->TransitionBarrier(&v, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
@@ -575,6 +587,8 @@ void RenderScene()
 	sl12::Descriptor& cbSceneDesc0 = *g_CBSceneViews_[frameIndex].GetDesc();
 	sl12::Descriptor& cbSceneDesc1 = *g_CBSceneViews_[frameIndex + sl12::Swapchain::kMaxBuffer].GetDesc();
 	{
+		sl12::CpuProfileScope cpuScope(g_cpuProfiler_, "Update Scene");
+
 		static float sAngle = 0.0f;
 		static const float kXZLength = 80.0f;
 		void* p0 = g_pCBSceneBuffers_[frameIndex];
@@ -590,8 +604,10 @@ void RenderScene()
 		sAngle += 1.0f;
 	}
 
-	pCmdList->EndQuery(g_pTimestampQuery_[frameIndex], D3D12_QUERY_TYPE_TIMESTAMP, 0);
 	{
+		sl12::CpuProfileScope cpuScope(g_cpuProfiler_, "Draw");
+		sl12::GpuProfileScope gpuScope(g_gpuProfiler_, g_pNextCmdList_, "Draw");
+
 		// レンダーターゲット設定
 		pCmdList->OMSetRenderTargets(1, &rtvHandle, false, &dsvHandle);
 
@@ -630,13 +646,18 @@ void RenderScene()
 		}
 		pCmdList->DrawInstanced(kMaxTriangle * 3, 1, 0, 0);
 	}
-	pCmdList->EndQuery(g_pTimestampQuery_[frameIndex], D3D12_QUERY_TYPE_TIMESTAMP, 1);
 
-	ImGui::Render();
+	{
+		sl12::CpuProfileScope cpuScope(g_cpuProfiler_, "GUI");
+		sl12::GpuProfileScope gpuScope(g_gpuProfiler_, g_pNextCmdList_, "GUI");
+
+		ImGui::Render();
+	}
 
 	g_pNextCmdList_->TransitionBarrier(scTex, D3D12_RESOURCE_STATE_PRESENT);
 
-	pCmdList->ResolveQueryData(g_pTimestampQuery_[frameIndex], D3D12_QUERY_TYPE_TIMESTAMP, 0, 2, g_pTimestampBuffer_[frameIndex], 0);
+	g_gpuProfiler_.EndScope(g_pNextCmdList_);
+	g_gpuProfiler_.EndFrame(g_pNextCmdList_);
 
 	g_pNextCmdList_->Close();
 }
@@ -15,11 +15,14 @@
 #include <sl12/pipeline_state.h>
 #include <sl12/shader.h>
 #include <sl12/gui.h>
+#include <sl12/profiler.h>
+#include <sl12/geometry_generator.h>
 #include <DirectXTex.h>
 #include <windowsx.h>
+#include <vector>
 
 #include "file.h"
-#include "float16.h"
+#include "world_transform.h"
 
 
 namespace
@@ -30,17 +33,27 @@ namespace
 	//static const DXGI_FORMAT	kDepthFormat = DXGI_FORMAT_R32G8X24_TYPELESS;
 	static const DXGI_FORMAT	kDepthFormat = DXGI_FORMAT_D32_FLOAT;
 	static const uint32_t kMaxTriangle = 10000000;
+	static const uint32_t kGeometrySeed = 0;			// 三角形の生成に使う乱数のシード
+	static const uint32_t kValidateVertexCount = 3 * 65536;		// GPU の結果を検証する頂点数 (先頭から)
+	static const uint32_t kBenchmarkVertexCount = 3 * 1000000;	// CPU 版の計測に使う頂点数
+	// GPU は積和の融合や計算順序が CPU 版と異なる場合があるので、ULP 単位で誤差を許容する
+	static const uint32_t kValidatePositionUlp = 16;
+	static const uint32_t kValidateNormalUlp = 16;
+	static const uint32_t kValidateHalfNormalUlp = 1;
+	static const float kValidateAbsTolerance = 1e-5f;
 
 	struct CompressVertex
 	{
 		float		position[3];
-		float16		normal[4];
+		sl12::u16	normal[4];
 	};
 	struct NoCompressVertex
 	{
 		float		position[3];
 		float		normal[3];
 	};
+	static_assert(sizeof(CompressVertex) == kWorldTransformFp16.vertexStride, "CompressVertex must match world_transform_fp16.hlsl");
+	static_assert(sizeof(NoCompressVertex) == kWorldTransformFp32.vertexStride, "NoCompressVertex must match world_transform_fp32.hlsl");
 	struct CbWorld
 	{
 		DirectX::XMFLOAT4X4		mtxWorld;
@@ -67,6 +80,7 @@ namespace
 	void*						g_pCBWorldBuffers_[kMaxCBs] = { nullptr };
 	sl12::ConstantBufferView	g_CBWorldViews_[kMaxCBs];
 
+	sl12::GeometryGenerator	g_generators_[2];
 	sl12::Buffer			g_src_vbuffers_[2];
 	sl12::Buffer			g_dst_vbuffers_[2];
 	sl12::VertexBufferView	g_vbufferViews_[2];
@@ -91,9 +105,56 @@ namespace
 	ID3D12QueryHeap*		g_pTimestampQuery_[sl12::Swapchain::kMaxBuffer] = { nullptr };
 	ID3D12Resource*			g_pTimestampBuffer_[sl12::Swapchain::kMaxBuffer] = { nullptr };
 
+	// GPU の結果の検証
+	ID3D12Resource*			g_pValidateReadback_ = nullptr;
+	DirectX::XMFLOAT4X4		g_mtxWorld;						// 最後に定数バッファに書き込んだワールド行列
+	bool					g_validateRequested = false;
+	uint32_t				g_validateWaitFrames = 0;		// 読み戻しが完了するまでのフレーム数. 0 なら待機していない
+	int						g_validateIndex = 0;
+	DirectX::XMFLOAT4X4		g_validateMtx;
+	bool					g_hasValidateResult = false;
+	WorldTransformValidation	g_validateResult;
+
+	// CPU 版の計測結果. [fp16, fp32][スカラー, AVX2, 並列]
+	bool					g_hasBenchmarkResult = false;
+	WorldTransformBenchmark	g_benchmarkResults[2][3];
+
 	sl12::Gui		g_Gui_;
 	sl12::InputData	g_InputData_{};
 	bool			g_IsNoCompressVertex = false;
+	float			g_generateMs[2] = {};		// 頂点の生成とアップロードにかかった時間
+}
+
+// 読み戻し用のバッファを作成する
+ID3D12Resource* CreateReadbackBuffer(ID3D12Device* pDev, UINT64 size)
+{
+	D3D12_HEAP_PROPERTIES prop{};
+	prop.Type = D3D12_HEAP_TYPE_READBACK;
+	prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	prop.CreationNodeMask = 1;
+	prop.VisibleNodeMask = 1;
+
+	D3D12_RESOURCE_DESC rd{};
+	rd.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	rd.Alignment = 0;
+	rd.Width = size;
+	rd.Height = 1;
+	rd.DepthOrArraySize = 1;
+	rd.MipLevels = 1;
+	rd.Format = DXGI_FORMAT_UNKNOWN;
+	rd.SampleDesc.Count = 1;
+	rd.SampleDesc.Quality = 0;
+	rd.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	rd.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+
+	ID3D12Resource* pRes = nullptr;
+	auto hr = pDev->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &rd, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&pRes));
+	if (FAILED(hr))
+	{
+		return nullptr;
+	}
+	return pRes;
 }
 
 // Window Proc
@@ -225,57 +286,38 @@ bool InitializeAssets()
 	}
 
 	// 頂点バッファを作成
+	// 頂点はアップロード用のメモリに直接生成する
 	{
-		auto frandom = [](float minv, float maxv) {
-			float t = (float)rand() / (float)(RAND_MAX - 1);
-			return minv * (1.0f - t) + maxv * t;
-		};
-		auto posRandom = [&](float* p) {
-			p[0] = frandom(-20.0f, 20.0f);
-			p[1] = frandom(-20.0f, 20.0f);
-			p[2] = frandom(-20.0f, 20.0f);
-		};
-		auto normRandom = [&](float* n) {
-			n[0] = frandom(-1.0f, 1.0f);
-			n[1] = frandom(-1.0f, 1.0f);
-			n[2] = frandom(-1.0f, 1.0f);
-			float div = 1.0f / sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
-			n[0] *= div;
-			n[1] *= div;
-			n[2] *= div;
+		sl12::GeometryGenerator::Desc genDesc;
+		genDesc.triangleCount = kMaxTriangle;
+		genDesc.seed = kGeometrySeed;
+
+		const sl12::GeometryVertexElement compressElements[] = {
+			{ sl12::GeometryAttribute::Position, sl12::GeometryFormat::Float32x3, 0 },
+			{ sl12::GeometryAttribute::Normal, sl12::GeometryFormat::Float16x4, sizeof(float) * 3 },
 		};
-		auto toNormal16 = [](float16* no, float* ni) {
-			no[0] = ToFloat16(ni[0]);
-			no[1] = ToFloat16(ni[1]);
-			no[2] = ToFloat16(ni[2]);
-			no[3] = 0x0;
+		const sl12::GeometryVertexElement noCompressElements[] = {
+			{ sl12::GeometryAttribute::Position, sl12::GeometryFormat::Float32x3, 0 },
+			{ sl12::GeometryAttribute::Normal, sl12::GeometryFormat::Float32x3, sizeof(float) * 3 },
 		};
-
-		CompressVertex* pCV = new CompressVertex[kMaxTriangle * 3];
-		NoCompressVertex* pNV = new NoCompressVertex[kMaxTriangle * 3];
-		for (uint32_t i = 0; i < kMaxTriangle; ++i)
-		{
-			uint32_t index = i * 3;
-			// カラー
-			normRandom(pNV[index].normal);
-			memcpy(pNV[index + 1].normal, pNV[index].normal, sizeof(pNV[index].normal));
-			memcpy(pNV[index + 2].normal, pNV[index].normal, sizeof(pNV[index].normal));
-			toNormal16(pCV[index + 0].normal, pNV[index + 0].normal);
-			toNormal16(pCV[index + 1].normal, pNV[index + 1].normal);
-			toNormal16(pCV[index + 2].normal, pNV[index + 2].normal);
-			// 座標
-			float p[3];
-			posRandom(p);
-			pNV[index].position[0] = pCV[index].position[0] = p[0];
-			pNV[index].position[1] = pCV[index].position[1] = p[1] + 0.2f;
-			pNV[index].position[2] = pCV[index].position[2] = p[2];
-			pNV[index + 1].position[0] = pCV[index + 1].position[0] = p[0] - 0.2f;
-			pNV[index + 1].position[1] = pCV[index + 1].position[1] = p[1] - 0.2f;
-			pNV[index + 1].position[2] = pCV[index + 1].position[2] = p[2];
-			pNV[index + 2].position[0] = pCV[index + 2].position[0] = p[0] + 0.2f;
-			pNV[index + 2].position[1] = pCV[index + 2].position[1] = p[1] - 0.2f;
-			pNV[index + 2].position[2] = pCV[index + 2].position[2] = p[2];
+		if (!g_generators_[0].Initialize(genDesc, compressElements, _countof(compressElements), sizeof(CompressVertex)))
+		{
+			return false;
+		}
+		if (!g_generators_[1].Initialize(genDesc, noCompressElements, _countof(noCompressElements), sizeof(NoCompressVertex)))
+		{
+			return false;
 		}
+		auto fillVertices = [&](int index)
+		{
+			auto&& generator = g_generators_[index];
+			uint64_t startTicks = sl12::CpuProfiler::GetTicks();
+			g_src_vbuffers_[index].FillBuffer(&g_Device_, &g_copyCmdList_, generator.GetBufferSize(), 0, [&](void* pDst)
+			{
+				generator.Generate(pDst, 0);
+			});
+			g_generateMs[index] = (float)((double)(sl12::CpuProfiler::GetTicks() - startTicks) * 1000.0 / (double)sl12::CpuProfiler::GetTicksPerSecond());
+		};
 
 		if (!g_src_vbuffers_[0].Initialize(&g_Device_, sizeof(CompressVertex) * kMaxTriangle * 3, sizeof(CompressVertex), sl12::BufferUsage::VertexBuffer, false, false))
 		{
@@ -297,7 +339,7 @@ bool InitializeAssets()
 		{
 			return false;
 		}
-		g_src_vbuffers_[0].UpdateBuffer(&g_Device_, &g_copyCmdList_, pCV, sizeof(CompressVertex) * kMaxTriangle * 3);
+		fillVertices(0);
 
 		if (!g_src_vbuffers_[1].Initialize(&g_Device_, sizeof(NoCompressVertex) * kMaxTriangle * 3, sizeof(NoCompressVertex), sl12::BufferUsage::VertexBuffer, false, false))
 		{
@@ -319,10 +361,7 @@ bool InitializeAssets()
 		{
 			return false;
 		}
-		g_src_vbuffers_[1].UpdateBuffer(&g_Device_, &g_copyCmdList_, pNV, sizeof(NoCompressVertex) * kMaxTriangle * 3);
-
-		delete[] pCV;
-		delete[] pNV;
+		fillVertices(1);
 	}
 
 	// シェーダロード
@@ -476,33 +515,20 @@ bool InitializeAssets()
 			return false;
 		}
 
-		D3D12_HEAP_PROPERTIES prop{};
-		prop.Type = D3D12_HEAP_TYPE_READBACK;
-		prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		prop.CreationNodeMask = 1;
-		prop.VisibleNodeMask = 1;
-
-		D3D12_RESOURCE_DESC rd{};
-		rd.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-		rd.Alignment = 0;
-		rd.Width = sizeof(uint64_t) * 4;
-		rd.Height = 1;
-		rd.DepthOrArraySize = 1;
-		rd.MipLevels = 1;
-		rd.Format = DXGI_FORMAT_UNKNOWN;
-		rd.SampleDesc.Count = 1;
-		rd.SampleDesc.Quality = 0;
-		rd.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-		rd.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
-
-		hr = pDev->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &rd, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&g_pTimestampBuffer_[i]));
-		if (FAILED(hr))
+		g_pTimestampBuffer_[i] = CreateReadbackBuffer(pDev, sizeof(uint64_t) * 4);
+		if (!g_pTimestampBuffer_[i])
 		{
 			return false;
 		}
 	}
 
+	// 検証用の読み戻しバッファ
+	g_pValidateReadback_ = CreateReadbackBuffer(pDev, (UINT64)kValidateVertexCount * sizeof(NoCompressVertex));
+	if (!g_pValidateReadback_)
+	{
+		return false;
+	}
+
 	// GUIの初期化
 	if (!g_Gui_.Initialize(&g_Device_, DXGI_FORMAT_R8G8B8A8_UNORM, g_DepthBuffer_.GetTextureDesc().format))
 	{
@@ -520,6 +546,7 @@ void DestroyAssets()
 {
 	g_Gui_.Destroy();
 
+	sl12::SafeRelease(g_pValidateReadback_);
 	for (auto& v : g_pTimestampBuffer_) sl12::SafeRelease(v);
 	for (auto& v : g_pTimestampQuery_) sl12::SafeRelease(v);
 
@@ -560,11 +587,45 @@ void DestroyAssets()
 	g_DepthBuffer_.Destroy();
 }
 
+// 読み戻した GPU の結果を CPU 版と比較する
+void ValidateWorldTransform()
+{
+	const WorldTransformLayout& layout = (g_validateIndex == 0) ? kWorldTransformFp16 : kWorldTransformFp32;
+	size_t size = (size_t)kValidateVertexCount * layout.vertexStride;
+
+	// 入力の頂点は生成し直す
+	std::vector<sl12::u8> src(size), expected(size);
+	g_generators_[g_validateIndex].GenerateRange(src.data(), 0, kValidateVertexCount / 3);
+	TransformVerticesParallel(layout, &g_validateMtx.m[0][0], src.data(), expected.data(), kValidateVertexCount, 0);
+
+	void* p = nullptr;
+	D3D12_RANGE range{ 0, size };
+	if (FAILED(g_pValidateReadback_->Map(0, &range, &p)))
+	{
+		return;
+	}
+	sl12::u32 normalUlp = layout.isHalfNormal ? kValidateHalfNormalUlp : kValidateNormalUlp;
+	g_validateResult = ValidateTransformedVertices(layout, expected.data(), p, kValidateVertexCount, kValidatePositionUlp, normalUlp, kValidateAbsTolerance);
+	D3D12_RANGE writeRange{ 0, 0 };
+	g_pValidateReadback_->Unmap(0, &writeRange);
+	g_hasValidateResult = true;
+}
+
 void RenderScene()
 {
 	if (g_pNextCmdList_)
 		g_pNextCmdList_->Execute();
 
+	// 検証用の読み戻しの完了を待つ
+	// 記録したフレームのコマンドリストは次のフレームで実行され、そのフレームの終わりに完了する
+	if (g_validateWaitFrames > 0)
+	{
+		if (--g_validateWaitFrames == 0)
+		{
+			ValidateWorldTransform();
+		}
+	}
+
 	int32_t prevFrameIndex = g_Device_.GetSwapchain().GetFrameIndex();
 	int32_t frameIndex = (prevFrameIndex + 1) % sl12::Swapchain::kMaxBuffer;
 	g_pNextCmdList_ = &g_mainCmdLists_[frameIndex];
@@ -579,6 +640,7 @@ void RenderScene()
 		}
 
 		ImGui::Text(g_IsNoCompressVertex ? "Float32 Normal" : "Float16 Normal");
+		ImGui::Text("Generate : %.1f ms (Float16), %.1f ms (Float32)", g_generateMs[0], g_generateMs[1]);
 
 		auto buffer = g_pTimestampBuffer_[prevFrameIndex];
 		void* p = nullptr;
@@ -594,6 +656,52 @@ void RenderScene()
 
 		ImGui::Text("Dispatch : %f (ms)", cs_ms);
 		ImGui::Text("Draw : %f (ms)", gr_ms);
+
+		// コンピュートシェーダの頂点スループット. バイト数は読み込み + 書き込み
+		const WorldTransformLayout& layout = !g_IsNoCompressVertex ? kWorldTransformFp16 : kWorldTransformFp32;
+		if (cs_ms > 0.0f)
+		{
+			ImGui::Text("GPU : %u B/vtx, %.1f Mvtx/s", layout.vertexStride * 2, (double)(kMaxTriangle * 3) / (double)cs_ms / 1000.0);
+		}
+
+		// GPU の結果の検証
+		if (ImGui::Button("Validate") && g_validateWaitFrames == 0)
+		{
+			g_validateRequested = true;
+		}
+		if (g_validateRequested || g_validateWaitFrames > 0)
+		{
+			ImGui::Text("Validating...");
+		}
+		else if (g_hasValidateResult)
+		{
+			const WorldTransformValidation& v = g_validateResult;
+			ImGui::Text("%s : %u / %u errors", (g_validateIndex == 0) ? "Float16" : "Float32", v.errorCount, v.checkedCount);
+			ImGui::Text("  max ulp : position %u, normal %u", v.maxPositionUlp, v.maxNormalUlp);
+			if (v.errorCount > 0)
+			{
+				ImGui::Text("  first error : vertex %u", v.firstErrorVertex);
+			}
+		}
+
+		// CPU 版の計測
+		if (ImGui::Button("CPU Benchmark"))
+		{
+			BenchmarkWorldTransform(kWorldTransformFp16, kBenchmarkVertexCount, 5, g_benchmarkResults[0]);
+			BenchmarkWorldTransform(kWorldTransformFp32, kBenchmarkVertexCount, 5, g_benchmarkResults[1]);
+			g_hasBenchmarkResult = true;
+		}
+		if (g_hasBenchmarkResult)
+		{
+			ImGui::Text("AVX2 : %s", IsWorldTransformAvx2Supported() ? "supported" : "not supported");
+			for (int i = 0; i < 2; ++i)
+			{
+				for (auto&& r : g_benchmarkResults[i])
+				{
+					ImGui::Text("%s %-8s : %u B/vtx, %.1f Mvtx/s, %.2f GB/s", (i == 0) ? "Float16" : "Float32", r.name, r.bytesPerVertex, r.verticesPerSecond / 1e6, r.bytesPerSecond / 1e9);
+				}
+			}
+		}
 	}
 
 	g_pNextCmdList_->Reset();
@@ -623,6 +731,7 @@ void RenderScene()
 		CbWorld* pWorld = reinterpret_cast<CbWorld*>(p0);
 		DirectX::XMMATRIX mtxW = DirectX::XMMatrixRotationY(sAngle * DirectX::XM_PI / 180.0f);
 		DirectX::XMStoreFloat4x4(&pWorld->mtxWorld, mtxW);
+		DirectX::XMStoreFloat4x4(&g_mtxWorld, mtxW);
 		pWorld->vertexCount = kMaxTriangle * 3;
 
 		//sAngle += 1.0f;
@@ -659,6 +768,20 @@ void RenderScene()
 	}
 	pCmdList->EndQuery(g_pTimestampQuery_[frameIndex], D3D12_QUERY_TYPE_TIMESTAMP, 1);
 
+	// 検証用に変換結果の先頭を読み戻す
+	if (g_validateRequested)
+	{
+		int index = !g_IsNoCompressVertex ? 0 : 1;
+		UINT64 size = (UINT64)kValidateVertexCount * ((index == 0) ? sizeof(CompressVertex) : sizeof(NoCompressVertex));
+		g_pNextCmdList_->TransitionBarrier(&g_dst_vbuffers_[index], D3D12_RESOURCE_STATE_COPY_SOURCE);
+		pCmdList->CopyBufferRegion(g_pValidateReadback_, 0, g_dst_vbuffers_[index].GetResourceDep(), 0, size);
+
+		g_validateIndex = index;
+		g_validateMtx = g_mtxWorld;
+		g_validateRequested = false;
+		g_validateWaitFrames = 2;
+	}
+
 	for (auto& v : g_dst_vbuffers_)
 	{
 		g_pNextCmdList_->TransitionBarrier(&v, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER);
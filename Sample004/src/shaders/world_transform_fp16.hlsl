@@ -1,3 +1,4 @@
+// CPU  (world_transform.h)  kWorldTransformFp16 ƈv邱
 #define VERTEX_STRIDE		(4 * 3 + 4 * 2)
 #define NORMAL_OFFSET		(4 * 3)
 
@@ -0,0 +1,436 @@
+﻿#include "world_transform.h"
+
+#include <sl12/float16.h>
+#include <sl12/geometry_generator.h>
+#include <sl12/parallel.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#	define WORLD_TRANSFORM_X86
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define WORLD_TRANSFORM_TARGET
+#	else
+#		include <cpuid.h>
+#		define WORLD_TRANSFORM_TARGET	__attribute__((target("avx2,f16c")))
+#	endif
+#endif
+
+
+namespace
+{
+	//---------------------------------------
+	// 行ベクトルに行列を掛ける
+	// AVX2 版と同じ順序で計算する
+	//---------------------------------------
+	inline void TransformPoint(const float* m, const float* v, float* out)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			out[c] = v[0] * m[0 * 4 + c] + v[1] * m[1 * 4 + c] + v[2] * m[2 * 4 + c] + m[3 * 4 + c];
+		}
+	}
+	inline void TransformDirection(const float* m, const float* v, float* out)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			out[c] = v[0] * m[0 * 4 + c] + v[1] * m[1 * 4 + c] + v[2] * m[2 * 4 + c];
+		}
+	}
+
+	//---------------------------------------
+	// 1頂点を変換する
+	//---------------------------------------
+	inline void TransformVertex(const WorldTransformLayout& layout, const float* m, const sl12::u8* pSrc, sl12::u8* pDst)
+	{
+		float v[3], o[3];
+		memcpy(v, pSrc, sizeof(v));
+		TransformPoint(m, v, o);
+		memcpy(pDst, o, sizeof(o));
+
+		if (layout.isHalfNormal)
+		{
+			sl12::u16 h[4];
+			memcpy(h, pSrc + layout.normalOffset, sizeof(h));
+			v[0] = sl12::HalfToFloat(h[0]);
+			v[1] = sl12::HalfToFloat(h[1]);
+			v[2] = sl12::HalfToFloat(h[2]);
+			TransformDirection(m, v, o);
+			h[0] = sl12::FloatToHalf(o[0]);
+			h[1] = sl12::FloatToHalf(o[1]);
+			h[2] = sl12::FloatToHalf(o[2]);
+			h[3] = 0;
+			memcpy(pDst + layout.normalOffset, h, sizeof(h));
+		}
+		else
+		{
+			memcpy(v, pSrc + layout.normalOffset, sizeof(v));
+			TransformDirection(m, v, o);
+			memcpy(pDst + layout.normalOffset, o, sizeof(o));
+		}
+	}
+
+#if defined(WORLD_TRANSFORM_X86)
+	//---------------------------------------
+	// AVX2 で8頂点ずつ変換する
+	// 読み込みは gather、書き込みはレイアウトが AoS なので1頂点ずつ行う
+	//---------------------------------------
+	WORLD_TRANSFORM_TARGET void TransformAvx2(const WorldTransformLayout& layout, const float* m, const sl12::u8* pSrc, sl12::u8* pDst, sl12::u32 vertexCount)
+	{
+		const sl12::u32 stride = layout.vertexStride;
+		const __m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32((int)stride));
+		const __m256i mask16 = _mm256_set1_epi32(0xffff);
+
+		__m256 mtx[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			mtx[i] = _mm256_set1_ps(m[i]);
+		}
+
+		alignas(32) float outX[8], outY[8], outZ[8];
+		alignas(32) sl12::u32 outN[3][8];
+
+		sl12::u32 i = 0;
+		for (; i + 8 <= vertexCount; i += 8)
+		{
+			const sl12::u8* s = pSrc + (size_t)i * stride;
+			sl12::u8* d = pDst + (size_t)i * stride;
+
+			// 座標
+			__m256 x = _mm256_i32gather_ps(reinterpret_cast<const float*>(s + 0), offsets, 1);
+			__m256 y = _mm256_i32gather_ps(reinterpret_cast<const float*>(s + 4), offsets, 1);
+			__m256 z = _mm256_i32gather_ps(reinterpret_cast<const float*>(s + 8), offsets, 1);
+			_mm256_store_ps(outX, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, mtx[0]), _mm256_mul_ps(y, mtx[4])), _mm256_mul_ps(z, mtx[8])), mtx[12]));
+			_mm256_store_ps(outY, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, mtx[1]), _mm256_mul_ps(y, mtx[5])), _mm256_mul_ps(z, mtx[9])), mtx[13]));
+			_mm256_store_ps(outZ, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, mtx[2]), _mm256_mul_ps(y, mtx[6])), _mm256_mul_ps(z, mtx[10])), mtx[14]));
+
+			// 法線
+			const sl12::u8* sn = s + layout.normalOffset;
+			__m256 nx, ny, nz;
+			if (layout.isHalfNormal)
+			{
+				__m256i xy = _mm256_i32gather_epi32(reinterpret_cast<const int*>(sn), offsets, 1);
+				__m256i zw = _mm256_i32gather_epi32(reinterpret_cast<const int*>(sn + 4), offsets, 1);
+				__m256i hx = _mm256_and_si256(xy, mask16);
+				__m256i hy = _mm256_srli_epi32(xy, 16);
+				__m256i hz = _mm256_and_si256(zw, mask16);
+				nx = _mm256_cvtph_ps(_mm_packus_epi32(_mm256_castsi256_si128(hx), _mm256_extracti128_si256(hx, 1)));
+				ny = _mm256_cvtph_ps(_mm_packus_epi32(_mm256_castsi256_si128(hy), _mm256_extracti128_si256(hy, 1)));
+				nz = _mm256_cvtph_ps(_mm_packus_epi32(_mm256_castsi256_si128(hz), _mm256_extracti128_si256(hz, 1)));
+			}
+			else
+			{
+				nx = _mm256_i32gather_ps(reinterpret_cast<const float*>(sn + 0), offsets, 1);
+				ny = _mm256_i32gather_ps(reinterpret_cast<const float*>(sn + 4), offsets, 1);
+				nz = _mm256_i32gather_ps(reinterpret_cast<const float*>(sn + 8), offsets, 1);
+			}
+			__m256 ox = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, mtx[0]), _mm256_mul_ps(ny, mtx[4])), _mm256_mul_ps(nz, mtx[8]));
+			__m256 oy = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, mtx[1]), _mm256_mul_ps(ny, mtx[5])), _mm256_mul_ps(nz, mtx[9]));
+			__m256 oz = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, mtx[2]), _mm256_mul_ps(ny, mtx[6])), _mm256_mul_ps(nz, mtx[10]));
+			if (layout.isHalfNormal)
+			{
+				__m256i hx = _mm256_cvtepu16_epi32(_mm256_cvtps_ph(ox, _MM_FROUND_TO_NEAREST_INT));
+				__m256i hy = _mm256_cvtepu16_epi32(_mm256_cvtps_ph(oy, _MM_FROUND_TO_NEAREST_INT));
+				__m256i hz = _mm256_cvtepu16_epi32(_mm256_cvtps_ph(oz, _MM_FROUND_TO_NEAREST_INT));
+				_mm256_store_si256(reinterpret_cast<__m256i*>(outN[0]), _mm256_or_si256(hx, _mm256_slli_epi32(hy, 16)));
+				_mm256_store_si256(reinterpret_cast<__m256i*>(outN[1]), hz);
+			}
+			else
+			{
+				_mm256_store_ps(reinterpret_cast<float*>(outN[0]), ox);
+				_mm256_store_ps(reinterpret_cast<float*>(outN[1]), oy);
+				_mm256_store_ps(reinterpret_cast<float*>(outN[2]), oz);
+			}
+
+			for (int k = 0; k < 8; ++k, d += stride)
+			{
+				float p[3] = { outX[k], outY[k], outZ[k] };
+				memcpy(d, p, sizeof(p));
+				if (layout.isHalfNormal)
+				{
+					sl12::u32 n[2] = { outN[0][k], outN[1][k] };
+					memcpy(d + layout.normalOffset, n, sizeof(n));
+				}
+				else
+				{
+					sl12::u32 n[3] = { outN[0][k], outN[1][k], outN[2][k] };
+					memcpy(d + layout.normalOffset, n, sizeof(n));
+				}
+			}
+		}
+		_mm256_zeroupper();
+
+		for (; i < vertexCount; ++i)
+		{
+			TransformVertex(layout, m, pSrc + (size_t)i * stride, pDst + (size_t)i * stride);
+		}
+	}
+
+	bool CheckAvx2()
+	{
+		// AVX, F16C と OS のサポートは half の変換命令と同じ条件
+		if (!sl12::IsHardwareHalfSupported())
+		{
+			return false;
+		}
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		unsigned int eax, ebx, ecx, edx;
+		if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		{
+			return false;
+		}
+		return (ebx & (1 << 5)) != 0;
+#endif
+	}
+#endif
+
+	//---------------------------------------
+	// ULP 単位の距離
+	//---------------------------------------
+	sl12::u32 UlpDistance(float a, float b)
+	{
+		if (std::isnan(a) || std::isnan(b))
+		{
+			return 0xffffffff;
+		}
+		sl12::s32 ia, ib;
+		memcpy(&ia, &a, sizeof(ia));
+		memcpy(&ib, &b, sizeof(ib));
+		// 符号と絶対値の表現を順序付きの整数にする
+		sl12::s64 oa = (ia < 0) ? (sl12::s64)(sl12::s32)0x80000000 - ia : ia;
+		sl12::s64 ob = (ib < 0) ? (sl12::s64)(sl12::s32)0x80000000 - ib : ib;
+		sl12::s64 d = (oa > ob) ? oa - ob : ob - oa;
+		return (sl12::u32)std::min<sl12::s64>(d, 0xffffffff);
+	}
+	sl12::u32 HalfUlpDistance(sl12::u16 a, sl12::u16 b)
+	{
+		float fa = sl12::HalfToFloat(a), fb = sl12::HalfToFloat(b);
+		if (std::isnan(fa) || std::isnan(fb))
+		{
+			return 0xffffffff;
+		}
+		sl12::s32 oa = (a & 0x8000) ? -(sl12::s32)(a & 0x7fff) : (sl12::s32)a;
+		sl12::s32 ob = (b & 0x8000) ? -(sl12::s32)(b & 0x7fff) : (sl12::s32)b;
+		return (sl12::u32)std::abs(oa - ob);
+	}
+
+	typedef void (*TransformFunc)(const WorldTransformLayout&, const float*, const void*, void*, sl12::u32);
+
+}	// namespace
+
+
+//---------------------------------------
+// 頂点をワールド変換する
+//---------------------------------------
+void TransformVerticesScalar(const WorldTransformLayout& layout, const float* pMatrix, const void* pSrc, void* pDst, sl12::u32 vertexCount)
+{
+	const sl12::u8* s = reinterpret_cast<const sl12::u8*>(pSrc);
+	sl12::u8* d = reinterpret_cast<sl12::u8*>(pDst);
+	for (sl12::u32 i = 0; i < vertexCount; ++i, s += layout.vertexStride, d += layout.vertexStride)
+	{
+		TransformVertex(layout, pMatrix, s, d);
+	}
+}
+
+//---------------------------------------
+// AVX2 で8頂点ずつ変換する
+//---------------------------------------
+void TransformVerticesAvx2(const WorldTransformLayout& layout, const float* pMatrix, const void* pSrc, void* pDst, sl12::u32 vertexCount)
+{
+#if defined(WORLD_TRANSFORM_X86)
+	if (IsWorldTransformAvx2Supported())
+	{
+		TransformAvx2(layout, pMatrix, reinterpret_cast<const sl12::u8*>(pSrc), reinterpret_cast<sl12::u8*>(pDst), vertexCount);
+		return;
+	}
+#endif
+	TransformVerticesScalar(layout, pMatrix, pSrc, pDst, vertexCount);
+}
+
+//---------------------------------------
+// 頂点を分割して並列に変換する
+//---------------------------------------
+void TransformVerticesParallel(const WorldTransformLayout& layout, const float* pMatrix, const void* pSrc, void* pDst, sl12::u32 vertexCount, sl12::u32 numThreads)
+{
+	static const sl12::u32 kMinVerticesPerThread = 64 * 1024;
+	if (numThreads == 0)
+	{
+		numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	numThreads = std::max(std::min(numThreads, vertexCount / kMinVerticesPerThread), 1u);
+
+	const sl12::u8* s = reinterpret_cast<const sl12::u8*>(pSrc);
+	sl12::u8* d = reinterpret_cast<sl12::u8*>(pDst);
+	auto work = [&](sl12::u32 t)
+	{
+		// 8頂点単位で分割する
+		sl12::u32 first = (sl12::u32)((sl12::u64)vertexCount * t / numThreads) & ~7u;
+		sl12::u32 end = (t + 1 == numThreads) ? vertexCount : ((sl12::u32)((sl12::u64)vertexCount * (t + 1) / numThreads) & ~7u);
+		size_t offset = (size_t)first * layout.vertexStride;
+		TransformVerticesAvx2(layout, pMatrix, s + offset, d + offset, end - first);
+	};
+
+	sl12::ParallelFor(numThreads, numThreads, work);
+}
+
+//---------------------------------------
+// AVX2 が使用できるか
+//---------------------------------------
+bool IsWorldTransformAvx2Supported()
+{
+#if defined(WORLD_TRANSFORM_X86)
+	static const bool kSupported = CheckAvx2();
+	return kSupported;
+#else
+	return false;
+#endif
+}
+
+//---------------------------------------
+// GPU から読み戻した頂点をリファレンスと比較する
+//---------------------------------------
+WorldTransformValidation ValidateTransformedVertices(
+	const WorldTransformLayout& layout, const void* pExpected, const void* pActual, sl12::u32 vertexCount,
+	sl12::u32 maxPositionUlp, sl12::u32 maxNormalUlp, float absTolerance)
+{
+	WorldTransformValidation ret;
+	ret.checkedCount = vertexCount;
+
+	const sl12::u8* e = reinterpret_cast<const sl12::u8*>(pExpected);
+	const sl12::u8* a = reinterpret_cast<const sl12::u8*>(pActual);
+	for (sl12::u32 i = 0; i < vertexCount; ++i, e += layout.vertexStride, a += layout.vertexStride)
+	{
+		sl12::u32 posUlp = 0, normUlp = 0;
+
+		float pe[3], pa[3];
+		memcpy(pe, e, sizeof(pe));
+		memcpy(pa, a, sizeof(pa));
+		for (int c = 0; c < 3; ++c)
+		{
+			if (std::fabs(pe[c] - pa[c]) > absTolerance)
+			{
+				posUlp = std::max(posUlp, UlpDistance(pe[c], pa[c]));
+			}
+		}
+
+		if (layout.isHalfNormal)
+		{
+			sl12::u16 ne[4], na[4];
+			memcpy(ne, e + layout.normalOffset, sizeof(ne));
+			memcpy(na, a + layout.normalOffset, sizeof(na));
+			for (int c = 0; c < 4; ++c)
+			{
+				if (std::fabs(sl12::HalfToFloat(ne[c]) - sl12::HalfToFloat(na[c])) > absTolerance)
+				{
+					normUlp = std::max(normUlp, HalfUlpDistance(ne[c], na[c]));
+				}
+			}
+		}
+		else
+		{
+			float ne[3], na[3];
+			memcpy(ne, e + layout.normalOffset, sizeof(ne));
+			memcpy(na, a + layout.normalOffset, sizeof(na));
+			for (int c = 0; c < 3; ++c)
+			{
+				if (std::fabs(ne[c] - na[c]) > absTolerance)
+				{
+					normUlp = std::max(normUlp, UlpDistance(ne[c], na[c]));
+				}
+			}
+		}
+
+		ret.maxPositionUlp = std::max(ret.maxPositionUlp, posUlp);
+		ret.maxNormalUlp = std::max(ret.maxNormalUlp, normUlp);
+		if (posUlp > maxPositionUlp || normUlp > maxNormalUlp)
+		{
+			if (ret.errorCount == 0)
+			{
+				ret.firstErrorVertex = i;
+			}
+			ret.errorCount++;
+		}
+	}
+
+	return ret;
+}
+
+//---------------------------------------
+// スカラー/AVX2/並列の各実装を計測する
+//---------------------------------------
+void BenchmarkWorldTransform(const WorldTransformLayout& layout, sl12::u32 vertexCount, sl12::u32 runCount, WorldTransformBenchmark* pResults)
+{
+	vertexCount = vertexCount / 3 * 3;
+	runCount = std::max(runCount, 1u);
+
+	sl12::GeometryGenerator::Desc genDesc;
+	genDesc.triangleCount = vertexCount / 3;
+	const sl12::GeometryVertexElement elements[] = {
+		{ sl12::GeometryAttribute::Position, sl12::GeometryFormat::Float32x3, 0 },
+		{ sl12::GeometryAttribute::Normal, layout.isHalfNormal ? sl12::GeometryFormat::Float16x4 : sl12::GeometryFormat::Float32x3, layout.normalOffset },
+	};
+	sl12::GeometryGenerator generator;
+	if (!generator.Initialize(genDesc, elements, 2, layout.vertexStride))
+	{
+		return;
+	}
+	std::vector<sl12::u8> src(generator.GetBufferSize()), dst(generator.GetBufferSize());
+	generator.Generate(src.data(), 0);
+
+	// Y軸回転 + 平行移動
+	const float kAngle = 0.5f;
+	const float c = cosf(kAngle), s = sinf(kAngle);
+	const float mtx[16] = {
+		c, 0.0f, -s, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		s, 0.0f, c, 0.0f,
+		1.0f, 2.0f, 3.0f, 1.0f,
+	};
+
+	struct Variant
+	{
+		const char*		name;
+		TransformFunc	func;
+	};
+	const Variant variants[] = {
+		{ "Scalar", &TransformVerticesScalar },
+		{ "AVX2", &TransformVerticesAvx2 },
+		{ "Parallel", [](const WorldTransformLayout& l, const float* m, const void* ps, void* pd, sl12::u32 n) { TransformVerticesParallel(l, m, ps, pd, n, 0); } },
+	};
+
+	for (int v = 0; v < 3; ++v)
+	{
+		double best = 1e30;
+		for (sl12::u32 r = 0; r < runCount + 1; ++r)
+		{
+			auto start = std::chrono::steady_clock::now();
+			variants[v].func(layout, mtx, src.data(), dst.data(), vertexCount);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			// 最初の1回はページフォルトなどを含むので除く
+			if (r > 0)
+			{
+				best = std::min(best, ms);
+			}
+		}
+
+		auto&& res = pResults[v];
+		res.name = variants[v].name;
+		res.bytesPerVertex = layout.vertexStride * 2;
+		res.msPerRun = best;
+		res.verticesPerSecond = (best > 0.0) ? (double)vertexCount * 1000.0 / best : 0.0;
+		res.bytesPerSecond = res.verticesPerSecond * res.bytesPerVertex;
+	}
+}
+
+
+//	EOF
@@ -0,0 +1,103 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+
+
+/*************************************************//**
+ * @brief world_transform コンピュートシェーダの頂点レイアウト
+ *
+ * VERTEX_STRIDE, NORMAL_OFFSET はシェーダ側の define と一致させること.
+*****************************************************/
+struct WorldTransformLayout
+{
+	sl12::u32	vertexStride;		//!< VERTEX_STRIDE
+	sl12::u32	normalOffset;		//!< NORMAL_OFFSET
+	bool		isHalfNormal;		//!< 法線が half x 4 (W は0)
+};	// struct WorldTransformLayout
+
+//! world_transform_fp16.hlsl
+constexpr WorldTransformLayout kWorldTransformFp16 = { 4 * 3 + 4 * 2, 4 * 3, true };
+//! world_transform_fp32.hlsl
+constexpr WorldTransformLayout kWorldTransformFp32 = { 4 * 3 + 4 * 3, 4 * 3, false };
+
+/**
+ * @brief 頂点をワールド変換する (CPU リファレンス)
+ *
+ * シェーダと同じく、座標は (x, y, z, 1)、法線は (x, y, z, 0) を行ベクトルとして行列を右から掛ける.\n
+ * 行列は定数バッファに書き込む XMFLOAT4X4 と同じ並びの16要素.\n
+ * 法線が half の場合は最近接偶数丸めで変換し、W は0にする.\n
+ * 各実装は同じ順序で乗算と加算を行うので、CPU の実装同士の結果はビット単位で一致する.
+ *
+ * @param[in]	pSrc	変換前の頂点. firstVertex 番目の頂点が先頭
+ * @param[out]	pDst	変換後の頂点. firstVertex 番目の頂点が先頭. 頂点間の隙間には書き込まない
+*/
+void TransformVerticesScalar(const WorldTransformLayout& layout, const float* pMatrix, const void* pSrc, void* pDst, sl12::u32 vertexCount);
+
+/**
+ * @brief AVX2 で8頂点ずつ変換する
+ *
+ * AVX2 が使用できない環境ではスカラー版を使用する.
+*/
+void TransformVerticesAvx2(const WorldTransformLayout& layout, const float* pMatrix, const void* pSrc, void* pDst, sl12::u32 vertexCount);
+
+/**
+ * @brief 頂点を分割して並列に変換する
+ *
+ * 各スレッドは AVX2 版 (使用できない場合はスカラー版) で変換する.
+ *
+ * @param[in]	numThreads	使用するスレッド数. 0 の場合はハードウェアのスレッド数
+*/
+void TransformVerticesParallel(const WorldTransformLayout& layout, const float* pMatrix, const void* pSrc, void* pDst, sl12::u32 vertexCount, sl12::u32 numThreads);
+
+/**
+ * @brief AVX2 が使用できるか
+*/
+bool IsWorldTransformAvx2Supported();
+
+/*************************************************//**
+ * @brief GPU の結果の検証結果
+ *
+ * 誤差は ULP (同じ符号の隣り合う値の数) で数える. half の法線は half の ULP.
+*****************************************************/
+struct WorldTransformValidation
+{
+	sl12::u32	checkedCount = 0;
+	sl12::u32	errorCount = 0;				//!< 許容誤差を超えた頂点数
+	sl12::u32	firstErrorVertex = 0;		//!< errorCount > 0 の場合のみ有効
+	sl12::u32	maxPositionUlp = 0;
+	sl12::u32	maxNormalUlp = 0;
+};	// struct WorldTransformValidation
+
+/**
+ * @brief GPU から読み戻した頂点をリファレンスと比較する
+ *
+ * GPU は積和の融合や計算順序が異なる場合があるので、ULP 単位の許容誤差を指定する.\n
+ * 0付近の値は相対誤差が大きくなるので、絶対誤差が absTolerance 以下の場合は一致とみなす.
+*/
+WorldTransformValidation ValidateTransformedVertices(
+	const WorldTransformLayout& layout, const void* pExpected, const void* pActual, sl12::u32 vertexCount,
+	sl12::u32 maxPositionUlp, sl12::u32 maxNormalUlp, float absTolerance);
+
+/*************************************************//**
+ * @brief CPU での計測結果
+*****************************************************/
+struct WorldTransformBenchmark
+{
+	const char*	name = nullptr;
+	sl12::u32	bytesPerVertex = 0;			//!< 1頂点の読み込み + 書き込みバイト数
+	double		msPerRun = 0.0;				//!< 最速の1回の時間
+	double		verticesPerSecond = 0.0;
+	double		bytesPerSecond = 0.0;
+};	// struct WorldTransformBenchmark
+
+/**
+ * @brief スカラー/AVX2/並列の各実装を計測する
+ *
+ * 頂点は内部で生成する. 各実装を runCount 回実行し、最速の時間を採用する.
+ *
+ * @param[out]	pResults	3要素. スカラー、AVX2、並列の順
+*/
+void BenchmarkWorldTransform(const WorldTransformLayout& layout, sl12::u32 vertexCount, sl12::u32 runCount, WorldTransformBenchmark* pResults);
+
+
+//	EOF
@@ -16,6 +16,7 @@
 #include <sl12/root_signature.h>
 #include <sl12/pipeline_state.h>
 #include <sl12/file.h>
+#include <sl12/upload_manager.h>
 #include <DirectXTex.h>
 #include <windowsx.h>
 
@@ -66,7 +67,8 @@ namespace
 	sl12::RootSignature			g_rootSigMesh_;
 	sl12::GraphicsPipelineState	g_psoMesh_;
 
-	sl12::File			g_meshFile_;
+	sl12::UploadManager	g_uploader_;
+	sl12::MappedFile	g_meshFile_;
 	sl12::MeshInstance	g_mesh_;
 
 	sl12::Gui	g_Gui_;
@@ -267,14 +269,19 @@ bool InitializeAssets()
 	}
 
 	// メッシュロード
-	if (!g_meshFile_.ReadFile("data/sponza.mesh"))
+	if (!g_meshFile_.Open("data/sponza.mesh"))
 	{
 		return false;
 	}
-	if (!g_mesh_.Initialize(&g_Device_, &g_copyCmdList_, g_meshFile_.GetData()))
+	if (!g_uploader_.Initialize(&g_Device_, g_copyCmdList_.GetParentQueue()))
 	{
 		return false;
 	}
+	if (!g_mesh_.Initialize(&g_Device_, &g_uploader_, g_meshFile_.GetData(), g_meshFile_.GetSize()))
+	{
+		return false;
+	}
+	g_uploader_.WaitIdle();
 
 	// GUIの初期化
 	if (!g_Gui_.Initialize(&g_Device_, DXGI_FORMAT_R8G8B8A8_UNORM, g_DepthBuffer_.GetTextureDesc().format))
@@ -295,6 +302,7 @@ void DestroyAssets()
 
 	g_mesh_.Destroy();
 	g_meshFile_.Destroy();
+	g_uploader_.Destroy();
 
 	g_psoMesh_.Destroy();
 	g_rootSigMesh_.Destroy();
@@ -350,6 +358,7 @@ void RenderScene()
 
 	// Scene定数バッファを更新
 	sl12::Descriptor& cbSceneDesc = *g_CBSceneViews_[frameIndex].GetDesc();
+	DirectX::XMFLOAT3 localEyePos;
 	{
 		static float sAngle = 90.0f;
 		void* p0 = g_pCBSceneBuffers_[frameIndex];
@@ -364,6 +373,9 @@ void RenderScene()
 		DirectX::XMStoreFloat4x4(pMtxs + 1, mtxV);
 		DirectX::XMStoreFloat4x4(pMtxs + 2, mtxP);
 
+		// LOD選択用にメッシュのローカル空間でのカメラ位置を求める
+		DirectX::XMStoreFloat3(&localEyePos, DirectX::XMVector3Transform(eye, DirectX::XMMatrixInverse(nullptr, mtxW)));
+
 		//sAngle += 1.0f;
 	}
 
@@ -384,10 +396,14 @@ void RenderScene()
 		pCmdList->SetGraphicsRootDescriptorTable(0, cbSceneDesc.GetGpuHandle());
 
 		// DrawCall
+		// 画面上の誤差が1pixel以下となるLODを選択する
+		const float kLodProjScale = (float)kWindowHeight / (2.0f * tanf(30.0f * DirectX::XM_PI / 180.0f));
+		const float kLodPixelError = 1.0f;
 		auto submeshCount = g_mesh_.GetSubmeshCount();
 		for (sl12::s32 i = 0; i < submeshCount; ++i)
 		{
-			sl12::DrawSubmeshInfo info = g_mesh_.GetDrawSubmeshInfo(i);
+			sl12::u32 lod = g_mesh_.SelectLod(i, localEyePos, kLodProjScale, kLodPixelError);
+			sl12::DrawSubmeshInfo info = g_mesh_.GetDrawSubmeshInfo(i, lod);
 
 			D3D12_VERTEX_BUFFER_VIEW views[] = {
 				info.pShape->GetPositionView()->GetView(),
@@ -396,7 +412,7 @@ void RenderScene()
 			};
 			pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 			pCmdList->IASetVertexBuffers(0, _countof(views), views);
-			pCmdList->IASetIndexBuffer(&info.pSubmesh->GetIndexBufferView()->GetView());
+			pCmdList->IASetIndexBuffer(&info.pSubmesh->GetIndexBufferView(info.lod)->GetView());
 			pCmdList->DrawIndexedInstanced(info.numIndices, 1, 0, 0, 0);
 		}
 		/*
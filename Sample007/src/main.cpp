@@ -16,6 +16,7 @@
 #include <sl12/root_signature.h>
 #include <sl12/pipeline_state.h>
 #include <sl12/file.h>
+#include <sl12/upload_manager.h>
 #include <sl12/root_signature_manager.h>
 #include <sl12/render_resource_manager.h>
 
@@ -107,6 +108,8 @@ namespace
 
 	sl12::RootSignatureManager	g_rootSigMan_;
 	sl12::RootSignatureHandle	g_basePassSig_;
+	sl12::BindingSlot			g_basePassCbSceneSlot_;
+	sl12::BindingSlot			g_basePassCbMeshSlot_;
 	sl12::RootSignatureHandle	g_linearDepthSig_;
 	sl12::RootSignatureHandle	g_lightingSig_;
 	sl12::RootSignatureHandle	g_blurXPassSig_;
@@ -121,7 +124,8 @@ namespace
 	sl12::RootSignature			g_rootSigMesh_;
 	sl12::GraphicsPipelineState	g_psoMesh_;
 
-	sl12::File			g_meshFile_;
+	sl12::UploadManager	g_uploader_;
+	sl12::MappedFile	g_meshFile_;
 	sl12::MeshInstance	g_mesh_;
 
 	struct RenderID
@@ -377,6 +381,8 @@ bool InitializeAssets()
 		desc.pVS = &g_Shaders_[ShaderKind::BasePassV];
 		desc.pPS = &g_Shaders_[ShaderKind::BasePassP];
 		g_basePassSig_ = g_rootSigMan_.CreateRootSignature(desc);
+		g_basePassCbSceneSlot_ = g_basePassSig_.FindSlot("CbScene");
+		g_basePassCbMeshSlot_ = g_basePassSig_.FindSlot("CbMesh");
 
 		desc.pVS = &g_Shaders_[ShaderKind::PostProcessV];
 		desc.pPS = &g_Shaders_[ShaderKind::LinearDepthP];
@@ -595,14 +601,19 @@ bool InitializeAssets()
 	}
 
 	// メッシュロード
-	if (!g_meshFile_.ReadFile("data/sponza.mesh"))
+	if (!g_meshFile_.Open("data/sponza.mesh"))
 	{
 		return false;
 	}
-	if (!g_mesh_.Initialize(&g_Device_, &g_copyCmdList_, g_meshFile_.GetData()))
+	if (!g_uploader_.Initialize(&g_Device_, g_copyCmdList_.GetParentQueue()))
 	{
 		return false;
 	}
+	if (!g_mesh_.Initialize(&g_Device_, &g_uploader_, g_meshFile_.GetData(), g_meshFile_.GetSize()))
+	{
+		return false;
+	}
+	g_uploader_.WaitIdle();
 
 	// GUIの初期化
 	if (!g_Gui_.Initialize(&g_Device_, DXGI_FORMAT_R8G8B8A8_UNORM, g_DepthBuffer_.GetTextureDesc().format))
@@ -623,6 +634,7 @@ void DestroyAssets()
 
 	g_mesh_.Destroy();
 	g_meshFile_.Destroy();
+	g_uploader_.Destroy();
 
 	g_psoMesh_.Destroy();
 	g_rootSigMesh_.Destroy();
@@ -730,7 +742,9 @@ void RenderScene()
 	mainCmdList.TransitionBarrier(scTex, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 	// 画面クリア
+	// NOTE: クリアはネイティブのコマンドリストに記録するので、積まれたバリアを先に発行する
 	const float kClearColor[] = { 0.0f, 0.0f, 0.6f, 1.0f };
+	mainCmdList.FlushBarriers();
 	pCmdList->ClearRenderTargetView(rtvHandle, kClearColor, 0, nullptr);
 	pCmdList->ClearDepthStencilView(dsvHandle, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, g_DepthBuffer_.GetTextureDesc().clearDepth, g_DepthBuffer_.GetTextureDesc().clearStencil, 0, nullptr);
 
@@ -799,6 +813,7 @@ void RenderScene()
 		}
 
 		// 画面クリア
+		mainCmdList.FlushBarriers();
 		pCmdList->ClearRenderTargetView(rtvs[0], pOutputs[0]->GetTexture()->GetTextureDesc().clearColor, 0, nullptr);
 		pCmdList->ClearRenderTargetView(rtvs[1], pOutputs[1]->GetTexture()->GetTextureDesc().clearColor, 0, nullptr);
 		pCmdList->ClearRenderTargetView(rtvs[2], pOutputs[2]->GetTexture()->GetTextureDesc().clearColor, 0, nullptr);
@@ -819,8 +834,8 @@ void RenderScene()
 		pCmdList->SetGraphicsRootSignature(g_basePassSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_basePassSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-		g_basePassSig_.SetDescriptor(mainCmdList, "CbMesh", g_MeshCB_.cbv_);
+		g_basePassSig_.SetDescriptor(mainCmdList, g_basePassCbSceneSlot_, curCB.cbv_);
+		g_basePassSig_.SetDescriptor(mainCmdList, g_basePassCbMeshSlot_, g_MeshCB_.cbv_);
 
 		// DrawCall
 		auto submeshCount = g_mesh_.GetSubmeshCount();
@@ -836,7 +851,7 @@ void RenderScene()
 			pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 			pCmdList->IASetVertexBuffers(0, _countof(views), views);
 			pCmdList->IASetIndexBuffer(&info.pSubmesh->GetIndexBufferView()->GetView());
-			pCmdList->DrawIndexedInstanced(info.numIndices, 1, 0, 0, 0);
+			mainCmdList.DrawIndexedInstanced(info.numIndices, 1, 0, 0, 0);
 		}
 	}
 
@@ -867,7 +882,7 @@ void RenderScene()
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		mainCmdList.DrawInstanced(3, 1, 0, 0);
 	}
 
 	// LightingPass
@@ -910,7 +925,7 @@ void RenderScene()
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		mainCmdList.DrawInstanced(3, 1, 0, 0);
 	}
 
 	// BlurPass
@@ -949,7 +964,7 @@ void RenderScene()
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		mainCmdList.DrawInstanced(3, 1, 0, 0);
 
 
 		//// Y軸方向
@@ -973,7 +988,7 @@ void RenderScene()
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		mainCmdList.DrawInstanced(3, 1, 0, 0);
 	}
 
 	ImGui::Render();
@@ -995,6 +1010,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 	{
 		ret = v.Initialize(&g_Device_, &g_Device_.GetGraphicsQueue());
 		assert(ret);
+
+		// バリアは次の描画の直前にまとめて発行する
+		v.SetDeferredBarriers(true);
 	}
 	for (auto& v : g_computeCmdLists_)
 	{
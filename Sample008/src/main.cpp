@@ -16,8 +16,12 @@
 #include <sl12/root_signature.h>
 #include <sl12/pipeline_state.h>
 #include <sl12/file.h>
+#include <sl12/upload_manager.h>
 #include <sl12/root_signature_manager.h>
 #include <sl12/render_resource_manager.h>
+#include <sl12/scheduled_command_lists.h>
+#include <sl12/point_light_set.h>
+#include <sl12/light_cluster_binner.h>
 
 #include "file.h"
 
@@ -57,6 +61,12 @@ namespace
 		float					gapBleed;
 	};	// struct WaterCB
 
+	struct ClusterCB
+	{
+		DirectX::XMUINT4		clusterGrid;		// (タイル数X, タイル数Y, スライス数, タイルのピクセル数)
+		DirectX::XMFLOAT4		clusterDepth;		// (最初のスライスの深度, スライス係数, -, -)
+	};	// struct ClusterCB
+
 	struct ConstantSet
 	{
 		sl12::Buffer				cb_;
@@ -94,6 +104,7 @@ namespace
 			BlurXP,
 			BlurYP,
 			TiledLightC,
+			ClusterLightC,
 			ClearHashC,
 			ProjectHashC,
 			ResolveHashP,
@@ -115,21 +126,34 @@ namespace
 	static const DXGI_FORMAT	kDepthViewFormat = DXGI_FORMAT_D32_FLOAT;
 	static const int kMaxFrameCount = sl12::Swapchain::kMaxBuffer;
 	static const int kTileWidth = 16;
-	static const int kLightMax = 128;
-
-	DirectX::XMFLOAT4	g_LightPos_[kLightMax];
+	static const int kLightMax = 65536;
+	static const int kClusterTileSize = 64;
+	static const int kClusterSliceCount = 32;
+	// ライトの割り当ては毎フレーム CPU で行うので、コストとアップロード量を上限で抑える
+	// 上限を超えるライト数や密度が必要な場合は GPU での割り当てが必要になる
+	static const int kClusterLightMax = 1024;			// クラスタライティングで使用するライトの最大数
+	static const int kClusterLightsPerCluster = 32;		// 1クラスタに割り当てるライトの最大数
+	// シーンのカメラ. フロクセルのグリッドも同じ値で作成する
+	static const float kNearZ = 1.0f;
+	static const float kFarZ = 10000.0f;
+	static const float kFovY = DirectX::XMConvertToRadians(60.0f);
+	static const int kViewStagingCount = 32;		// 1フレームでテーブルにまとめるデスクリプタ数
+
+	sl12::PointLightSet	g_lightSet_;
+	sl12::LightClusterBinner	g_clusterBinner_;
 
 	HWND	g_hWnd_;
 
 	sl12::Device		g_Device_;
-	sl12::CommandList	g_mainCmdLists_[kMaxFrameCount];
+	sl12::ScheduledCommandLists	g_mainCmdLists_;
 	sl12::CommandList	g_copyCmdList_;
 
 	ConstantSet				g_SceneCBs_[kMaxFrameCount];
 	ConstantSet				g_MeshCB_;
 	ConstantSet				g_BlurCB_;
-	ConstantSet				g_LightCB_;
+	ConstantSet				g_LightCBs_[kMaxFrameCount];
 	ConstantSet				g_WaterCBs_[kMaxFrameCount];
+	ConstantSet				g_ClusterCB_;
 	TextureSet				g_WaveNormalTex_;
 
 	sl12::Sampler			g_sampler_;
@@ -141,6 +165,10 @@ namespace
 	sl12::BufferView		g_LightPosBV_[kMaxFrameCount];
 	sl12::Buffer			g_LightColorB_;
 	sl12::BufferView		g_LightColorBV_;
+	sl12::Buffer			g_ClusterRangeB_[kMaxFrameCount];
+	sl12::BufferView		g_ClusterRangeBV_[kMaxFrameCount];
+	sl12::Buffer			g_ClusterIndexB_[kMaxFrameCount];
+	sl12::BufferView		g_ClusterIndexBV_[kMaxFrameCount];
 	sl12::Buffer			g_WaterVB_;
 	sl12::VertexBufferView	g_WaterVBV_;
 	sl12::Buffer			g_WaterIB_;
@@ -148,6 +176,8 @@ namespace
 
 	sl12::RootSignatureManager	g_rootSigMan_;
 	sl12::RootSignatureHandle	g_basePassSig_;
+	sl12::BindingSlot			g_basePassCbSceneSlot_;
+	sl12::BindingSlot			g_basePassCbMeshSlot_;
 	sl12::RootSignatureHandle	g_linearDepthSig_;
 	sl12::RootSignatureHandle	g_lightingSig_;
 	sl12::RootSignatureHandle	g_blurXPassSig_;
@@ -156,8 +186,12 @@ namespace
 	sl12::RootSignatureHandle	g_projectHashSig_;
 	sl12::RootSignatureHandle	g_resolveHashSig_;
 	sl12::RootSignatureHandle	g_tiledLightSig_;
+	sl12::DescriptorSet			g_tiledLightSet_;
+	sl12::RootSignatureHandle	g_clusterLightSig_;
+	sl12::DescriptorSet			g_clusterLightSet_;
 	sl12::RootSignatureHandle	g_waterSig_;
 	sl12::RootSignatureHandle	g_reprojectSig_;
+	sl12::DescriptorStaging		g_viewStaging_;
 
 	sl12::GraphicsPipelineState	g_basePassPso_;
 	sl12::GraphicsPipelineState	g_linearDepthPso_;
@@ -168,10 +202,12 @@ namespace
 	sl12::GraphicsPipelineState	g_waterPso_;
 	sl12::GraphicsPipelineState	g_reprojectPso_;
 	sl12::ComputePipelineState	g_tiledLightPso_;
+	sl12::ComputePipelineState	g_clusterLightPso_;
 	sl12::ComputePipelineState	g_clearHashPso_;
 	sl12::ComputePipelineState	g_projectHashPso_;
 
-	sl12::File			g_meshFile_;
+	sl12::UploadManager	g_uploader_;
+	sl12::MappedFile	g_meshFile_;
 	sl12::MeshInstance	g_mesh_;
 
 	struct RenderID
@@ -200,6 +236,10 @@ namespace
 	static bool		g_enableFresnel = true;
 	static bool		g_gapBleed = true;
 	static bool		g_scenePause = false;
+	static bool		g_asyncCompute = true;
+	static int		g_lightCount = 128;
+	static bool		g_clusteredLighting = false;
+	static sl12::u32	g_clusterIndexCount = 0;
 
 	int					g_SyncInterval = 1;
 }
@@ -309,7 +349,7 @@ bool InitializeAssets()
 			return false;
 		}
 
-		g_SceneCBs_[i].ptr_ = g_SceneCBs_[i].cb_.Map(&g_mainCmdLists_[i]);
+		g_SceneCBs_[i].ptr_ = g_SceneCBs_[i].cb_.Map(nullptr);
 	}
 	{
 		if (!g_MeshCB_.cb_.Initialize(&g_Device_, sizeof(MeshCB), 1, sl12::BufferUsage::ConstantBuffer, true, false))
@@ -359,7 +399,7 @@ bool InitializeAssets()
 		g_BlurCB_.cb_.Unmap();
 	}
 	{
-		for (int i = 0; i < 3; ++i)
+		for (int i = 0; i < kMaxFrameCount; ++i)
 		{
 			if (!g_LightPosB_[i].Initialize(&g_Device_, sizeof(DirectX::XMFLOAT4) * kLightMax, sizeof(DirectX::XMFLOAT4), sl12::BufferUsage::ShaderResource, true, false))
 			{
@@ -385,35 +425,98 @@ bool InitializeAssets()
 			return (maxV - minV) * r + minV;
 		};
 
-		auto color = reinterpret_cast<DirectX::XMFLOAT4*>(g_LightColorB_.Map(nullptr));
-		for (sl12::u32 i = 0; i < kLightMax; i++, color++)
+		if (!g_lightSet_.Initialize(kLightMax))
+		{
+			return false;
+		}
+		for (sl12::u32 i = 0; i < kLightMax; i++)
 		{
-			g_LightPos_[i].x = randFloat(-1000.0f, 1000.0f);
-			g_LightPos_[i].y = randFloat(100.0f, 400.0f);
-			g_LightPos_[i].z = randFloat(-500.0f, 500.0f);
-			g_LightPos_[i].w = randFloat(100.0f, 500.0f);
+			DirectX::XMFLOAT3 pos;
+			pos.x = randFloat(-1000.0f, 1000.0f);
+			pos.y = randFloat(100.0f, 400.0f);
+			pos.z = randFloat(-500.0f, 500.0f);
+			float radius = randFloat(100.0f, 500.0f);
 
 			float intensity = randFloat(3000.0f, 10000.0f);
-			color->x = randFloat(0.0f, 1.0f) * intensity;
-			color->y = randFloat(0.0f, 1.0f) * intensity;
-			color->z = randFloat(0.0f, 1.0f) * intensity;
-			color->w = 1.0f;
+			DirectX::XMFLOAT3 color;
+			color.x = randFloat(0.0f, 1.0f) * intensity;
+			color.y = randFloat(0.0f, 1.0f) * intensity;
+			color.z = randFloat(0.0f, 1.0f) * intensity;
+
+			g_lightSet_.SetLight(i, pos, radius, color);
 		}
+
+		auto color = reinterpret_cast<DirectX::XMFLOAT4*>(g_LightColorB_.Map(nullptr));
+		g_lightSet_.WriteColor(0, kLightMax, color);
 		g_LightColorB_.Unmap();
 
-		if (!g_LightCB_.cb_.Initialize(&g_Device_, sizeof(sl12::u32), 1, sl12::BufferUsage::ConstantBuffer, true, false))
+		// ライト数はGUIで変更するので、フレームごとに用意する
+		for (int i = 0; i < kMaxFrameCount; ++i)
+		{
+			if (!g_LightCBs_[i].cb_.Initialize(&g_Device_, sizeof(sl12::u32), 1, sl12::BufferUsage::ConstantBuffer, true, false))
+			{
+				return false;
+			}
+
+			if (!g_LightCBs_[i].cbv_.Initialize(&g_Device_, &g_LightCBs_[i].cb_))
+			{
+				return false;
+			}
+		}
+	}
+	{
+		// フロクセルのグリッドはシーンのカメラと合わせる
+		sl12::LightClusterBinner::GridDesc gridDesc;
+		gridDesc.screenWidth = kWindowWidth;
+		gridDesc.screenHeight = kWindowHeight;
+		gridDesc.tileSize = kClusterTileSize;
+		gridDesc.sliceCount = kClusterSliceCount;
+		gridDesc.nearZ = kNearZ;
+		gridDesc.farZ = kFarZ;
+		gridDesc.fovY = kFovY;
+		gridDesc.maxLightsPerCluster = kClusterLightsPerCluster;
+		if (!g_clusterBinner_.Initialize(gridDesc))
 		{
 			return false;
 		}
 
-		if (!g_LightCB_.cbv_.Initialize(&g_Device_, &g_LightCB_.cb_))
+		// ライトの割り当ては毎フレーム CPU で行うので、フレームごとに用意する
+		// インデックスリストはクラスタ数 x 1クラスタの上限で足りる
+		sl12::u32 clusterCount = g_clusterBinner_.GetClusterCount();
+		sl12::u32 indexCount = g_clusterBinner_.GetMaxIndexCount();
+		for (int i = 0; i < kMaxFrameCount; ++i)
+		{
+			if (!g_ClusterRangeB_[i].Initialize(&g_Device_, sizeof(sl12::u32) * 2 * clusterCount, sizeof(sl12::u32) * 2, sl12::BufferUsage::ShaderResource, true, false))
+			{
+				return false;
+			}
+			if (!g_ClusterRangeBV_[i].Initialize(&g_Device_, &g_ClusterRangeB_[i], 0, sizeof(sl12::u32) * 2))
+			{
+				return false;
+			}
+			if (!g_ClusterIndexB_[i].Initialize(&g_Device_, sizeof(sl12::u32) * indexCount, sizeof(sl12::u32), sl12::BufferUsage::ShaderResource, true, false))
+			{
+				return false;
+			}
+			if (!g_ClusterIndexBV_[i].Initialize(&g_Device_, &g_ClusterIndexB_[i], 0, sizeof(sl12::u32)))
+			{
+				return false;
+			}
+		}
+
+		if (!g_ClusterCB_.cb_.Initialize(&g_Device_, sizeof(ClusterCB), 1, sl12::BufferUsage::ConstantBuffer, true, false))
+		{
+			return false;
+		}
+		if (!g_ClusterCB_.cbv_.Initialize(&g_Device_, &g_ClusterCB_.cb_))
 		{
 			return false;
 		}
 
-		auto p = reinterpret_cast<sl12::u32*>(g_LightCB_.cb_.Map(nullptr));
-		*p = kLightMax;
-		g_LightCB_.cb_.Unmap();
+		auto p = reinterpret_cast<ClusterCB*>(g_ClusterCB_.cb_.Map(nullptr));
+		p->clusterGrid = DirectX::XMUINT4(g_clusterBinner_.GetTileCountX(), g_clusterBinner_.GetTileCountY(), gridDesc.sliceCount, gridDesc.tileSize);
+		p->clusterDepth = DirectX::XMFLOAT4(gridDesc.nearZ, g_clusterBinner_.GetSliceScale(), 0.0f, 0.0f);
+		g_ClusterCB_.cb_.Unmap();
 	}
 	{
 		if (!g_WaterVB_.Initialize(&g_Device_, sizeof(DirectX::XMFLOAT3) * 4, sizeof(DirectX::XMFLOAT3), sl12::BufferUsage::VertexBuffer, true, false))
@@ -519,6 +622,10 @@ bool InitializeAssets()
 	{
 		return false;
 	}
+	if (!g_Shaders_[ShaderKind::ClusterLightC].Initialize(&g_Device_, sl12::ShaderType::Compute, "data/cluster_lighting.c.cso"))
+	{
+		return false;
+	}
 	if (!g_Shaders_[ShaderKind::ClearHashC].Initialize(&g_Device_, sl12::ShaderType::Compute, "data/clear_hash.c.cso"))
 	{
 		return false;
@@ -554,6 +661,12 @@ bool InitializeAssets()
 		return false;
 	}
 
+	// 描画ごとのデスクリプタテーブル用のステージング領域
+	if (!g_viewStaging_.Initialize(&g_Device_, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, kViewStagingCount, kMaxFrameCount))
+	{
+		return false;
+	}
+
 	// ルートシグネチャを生成
 	{
 		sl12::RootSignatureCreateDesc desc;
@@ -561,6 +674,8 @@ bool InitializeAssets()
 		desc.pVS = &g_Shaders_[ShaderKind::BasePassV];
 		desc.pPS = &g_Shaders_[ShaderKind::BasePassP];
 		g_basePassSig_ = g_rootSigMan_.CreateRootSignature(desc);
+		g_basePassCbSceneSlot_ = g_basePassSig_.FindSlot("CbScene");
+		g_basePassCbMeshSlot_ = g_basePassSig_.FindSlot("CbMesh");
 
 		desc.pVS = &g_Shaders_[ShaderKind::PostProcessV];
 		desc.pPS = &g_Shaders_[ShaderKind::LinearDepthP];
@@ -589,8 +704,15 @@ bool InitializeAssets()
 	{
 		sl12::RootSignatureCreateDesc desc;
 
+		// タイルライティングはリソースが多いので、タイプごとに1つのテーブルにまとめる
 		desc.pCS = &g_Shaders_[ShaderKind::TiledLightC];
+		desc.packTables = true;
 		g_tiledLightSig_ = g_rootSigMan_.CreateRootSignature(desc);
+		g_tiledLightSet_.Initialize(g_tiledLightSig_);
+		desc.pCS = &g_Shaders_[ShaderKind::ClusterLightC];
+		g_clusterLightSig_ = g_rootSigMan_.CreateRootSignature(desc);
+		g_clusterLightSet_.Initialize(g_clusterLightSig_);
+		desc.packTables = false;
 
 		desc.pCS = &g_Shaders_[ShaderKind::ClearHashC];
 		g_clearHashSig_ = g_rootSigMan_.CreateRootSignature(desc);
@@ -869,6 +991,16 @@ bool InitializeAssets()
 			return false;
 		}
 	}
+	{
+		sl12::ComputePipelineStateDesc desc;
+		desc.pRootSignature = g_clusterLightSig_.GetRootSignature();
+		desc.pCS = &g_Shaders_[ShaderKind::ClusterLightC];
+
+		if (!g_clusterLightPso_.Initialize(&g_Device_, desc))
+		{
+			return false;
+		}
+	}
 	{
 		sl12::ComputePipelineStateDesc desc;
 		desc.pRootSignature = g_clearHashSig_.GetRootSignature();
@@ -891,14 +1023,19 @@ bool InitializeAssets()
 	}
 
 	// メッシュロード
-	if (!g_meshFile_.ReadFile("data/sponza.mesh"))
+	if (!g_meshFile_.Open("data/sponza.mesh"))
 	{
 		return false;
 	}
-	if (!g_mesh_.Initialize(&g_Device_, &g_copyCmdList_, g_meshFile_.GetData()))
+	if (!g_uploader_.Initialize(&g_Device_, g_copyCmdList_.GetParentQueue()))
 	{
 		return false;
 	}
+	if (!g_mesh_.Initialize(&g_Device_, &g_uploader_, g_meshFile_.GetData(), g_meshFile_.GetSize()))
+	{
+		return false;
+	}
+	g_uploader_.WaitIdle();
 
 	// GUIの初期化
 	if (!g_Gui_.Initialize(&g_Device_, DXGI_FORMAT_R8G8B8A8_UNORM))
@@ -919,6 +1056,7 @@ void DestroyAssets()
 
 	g_mesh_.Destroy();
 	g_meshFile_.Destroy();
+	g_uploader_.Destroy();
 
 	g_basePassPso_.Destroy();
 	g_linearDepthPso_.Destroy();
@@ -929,6 +1067,7 @@ void DestroyAssets()
 	g_projectHashPso_.Destroy();
 	g_resolveHashPso_.Destroy();
 	g_tiledLightPso_.Destroy();
+	g_clusterLightPso_.Destroy();
 	g_waterPso_.Destroy();
 	g_reprojectPso_.Destroy();
 
@@ -940,7 +1079,11 @@ void DestroyAssets()
 	g_clearHashSig_.Invalid();
 	g_projectHashSig_.Invalid();
 	g_resolveHashSig_.Invalid();
+	g_tiledLightSet_.Destroy();
+	g_clusterLightSet_.Destroy();
 	g_tiledLightSig_.Invalid();
+	g_clusterLightSig_.Invalid();
+	g_viewStaging_.Destroy();
 	g_waterSig_.Invalid();
 	g_reprojectSig_.Invalid();
 	g_rootSigMan_.Destroy();
@@ -949,6 +1092,10 @@ void DestroyAssets()
 	for (auto&& v : g_LightPosB_) v.Destroy();
 	g_LightColorBV_.Destroy();
 	g_LightColorB_.Destroy();
+	for (auto&& v : g_ClusterIndexBV_) v.Destroy();
+	for (auto&& v : g_ClusterIndexB_) v.Destroy();
+	for (auto&& v : g_ClusterRangeBV_) v.Destroy();
+	for (auto&& v : g_ClusterRangeB_) v.Destroy();
 
 	g_samLinearClamp_.Destroy();
 	g_sampler_.Destroy();
@@ -957,7 +1104,10 @@ void DestroyAssets()
 	g_WaveNormalTex_.Destroy();
 
 	for (auto&&v : g_WaterCBs_) v.Destroy();
-	g_LightCB_.Destroy();
+	for (auto&&v : g_LightCBs_) v.Destroy();
+	g_lightSet_.Destroy();
+	g_ClusterCB_.Destroy();
+	g_clusterBinner_.Destroy();
 	g_BlurCB_.Destroy();
 	g_MeshCB_.Destroy();
 	for (auto&&v : g_SceneCBs_) v.Destroy();
@@ -1004,6 +1154,7 @@ bool InitializeRenderResource()
 		pass++;
 
 		// Deferred Lighting Pass
+		g_rrProducers_[pass]->SetQueueType(sl12::QueueType::Compute);
 		g_rrProducers_[pass]->SetInputUnique(0, RenderID::GBuffer0);
 		g_rrProducers_[pass]->SetInputUnique(1, RenderID::GBuffer1);
 		g_rrProducers_[pass]->SetInputUnique(2, RenderID::GBuffer2);
@@ -1012,6 +1163,7 @@ bool InitializeRenderResource()
 		pass++;
 
 		// Projection Hash Pass
+		g_rrProducers_[pass]->SetQueueType(sl12::QueueType::Compute);
 		g_rrProducers_[pass]->SetInputUnique(0, RenderID::LinearDepth);
 		g_rrProducers_[pass]->SetOutputUnique(0, RenderID::HashBuffer, descHash);
 		pass++;
@@ -1047,6 +1199,8 @@ bool InitializeRenderResource()
 	{
 		return false;
 	}
+	// 使用区間の重ならない一時リソースはメモリを共有する
+	g_rrManager_.SetTransientAliasing(true);
 
 	return true;
 }
@@ -1062,9 +1216,20 @@ void RenderScene()
 	sl12::s32 frameIndex = g_Device_.GetSwapchain().GetFrameIndex();
 	sl12::s32 nextFrameIndex = (frameIndex + 1) % sl12::Swapchain::kMaxBuffer;
 
-	sl12::CommandList& mainCmdList = g_mainCmdLists_[frameIndex];
+	// リソース生成
+	// コンピュートのパスは後続のパスと並行できれば非同期コンピュートキューで実行する
+	g_rrManager_.SetAsyncCompute(g_asyncCompute);
+	g_rrManager_.MakeResources(g_rrProducers_);
+
+	// コマンドロードの開始
+	// パスのキューへの割り当てに従ってコマンドリストを用意する
+	g_mainCmdLists_.Begin(g_rrManager_.GetSchedule(), frameIndex);
+	g_viewStaging_.BeginFrame(frameIndex);
+
+	// GUIとPresentのバリアは最後のコマンドリストで行う
+	sl12::CommandList& lastCmdList = g_mainCmdLists_.GetLastCommandList();
 
-	g_Gui_.BeginNewFrame(&mainCmdList, kWindowWidth, kWindowHeight, g_InputData_);
+	g_Gui_.BeginNewFrame(&lastCmdList, kWindowWidth, kWindowHeight, g_InputData_);
 
 	// GUI
 	{
@@ -1074,30 +1239,66 @@ void RenderScene()
 		ImGui::Checkbox("Fresnel Enable", &g_enableFresnel);
 		ImGui::Checkbox("Gap Bleed", &g_gapBleed);
 		ImGui::Checkbox("Scene Pause", &g_scenePause);
-	}
+		ImGui::Checkbox("Async Compute", &g_asyncCompute);
+		ImGui::Checkbox("Clustered Lighting", &g_clusteredLighting);
+		if (g_clusteredLighting)
+		{
+			// NOTE: クラスタの上限を超えたライトはインデックスの大きいものから除かれる
+			if (g_lightCount > kClusterLightMax)
+				g_lightCount = kClusterLightMax;
+			ImGui::SliderInt("Light Count", &g_lightCount, 1, kClusterLightMax);
+			ImGui::Text("Cluster Light Indices : %u / %u (Max %d per Cluster)", g_clusterIndexCount, g_clusterBinner_.GetMaxIndexCount(), kClusterLightsPerCluster);
+		}
+		else
+		{
+			ImGui::SliderInt("Light Count", &g_lightCount, 1, kLightMax);
+		}
 
-	// グラフィクスコマンドロードの開始
-	mainCmdList.Reset();
+		auto&& transientStats = g_rrManager_.GetTransientMemoryStats();
+		ImGui::Text("Transient Heap : %.1f MB (Peak %.1f MB, Unaliased %.1f MB)",
+			(float)transientStats.heapSize / (1024.0f * 1024.0f),
+			(float)transientStats.peakLiveSize / (1024.0f * 1024.0f),
+			(float)transientStats.totalSize / (1024.0f * 1024.0f));
 
-	// リソース生成
-	g_rrManager_.MakeResources(g_rrProducers_);
+		auto&& schedule = g_rrManager_.GetSchedule();
+		sl12::u32 asyncPassCount = 0;
+		for (sl12::u32 i = 0; i < schedule.GetPassCount(); i++)
+		{
+			if (schedule.GetPassQueue(i) == sl12::QueueType::Compute)
+				asyncPassCount++;
+		}
+		ImGui::Text("Command Batches : %d (Async Passes %d)", schedule.GetBatchCount(), asyncPassCount);
+	}
 
 	auto scTex = g_Device_.GetSwapchain().GetCurrentTexture(1);
 	D3D12_CPU_DESCRIPTOR_HANDLE rtvHandle = g_Device_.GetSwapchain().GetDescHandle(nextFrameIndex);
-	ID3D12GraphicsCommandList* pCmdList = mainCmdList.GetCommandList();
 
-	// Viewport + Scissor設定
+	// DescriptorHeap, Viewport + Scissor設定
+	// NOTE: コマンドリストごとに設定が必要
 	D3D12_VIEWPORT viewport{ 0.0f, 0.0f, (float)kWindowWidth, (float)kWindowHeight, 0.0f, 1.0f };
 	D3D12_RECT scissor{ 0, 0, kWindowWidth, kWindowHeight };
-	pCmdList->RSSetViewports(1, &viewport);
-	pCmdList->RSSetScissorRects(1, &scissor);
+	ID3D12DescriptorHeap* pDescHeaps[] = {
+		g_Device_.GetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV).GetHeap(),
+		g_Device_.GetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER).GetHeap()
+	};
+	for (sl12::u32 i = 0; i < g_mainCmdLists_.GetBatchCount(); i++)
+	{
+		// バリアは次の描画、ディスパッチの直前にまとめて発行する
+		g_mainCmdLists_.GetBatchCommandList(i).SetDeferredBarriers(true);
+
+		ID3D12GraphicsCommandList* pCmdList = g_mainCmdLists_.GetBatchCommandList(i).GetCommandList();
+		pCmdList->SetDescriptorHeaps(_countof(pDescHeaps), pDescHeaps);
+		if (g_mainCmdLists_.GetBatchQueue(i) == sl12::QueueType::Graphics)
+		{
+			pCmdList->RSSetViewports(1, &viewport);
+			pCmdList->RSSetScissorRects(1, &scissor);
+		}
+	}
 
 	// Scene定数バッファを更新
 	auto&& curCB = g_SceneCBs_[frameIndex];
+	DirectX::XMMATRIX mtxSceneView;
 	{
-		static const float kNearZ = 1.0f;
-		static const float kFarZ = 10000.0f;
-		static const float kFovY = DirectX::XMConvertToRadians(60.0f);
 		static DirectX::XMFLOAT4X4 sPrevWorldToClip = DirectX::XMFLOAT4X4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
 		static float sCamAngle = 0.0f;
 		const float kAspect = (float)kWindowWidth / (float)kWindowHeight;
@@ -1110,6 +1311,7 @@ void RenderScene()
 		auto up = DirectX::XMLoadFloat3(&DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f));
 		auto mtxView = DirectX::XMMatrixLookAtRH(eye, focus, up);
 		auto mtxClip = DirectX::XMMatrixPerspectiveFovRH(kFovY, kAspect, kNearZ, kFarZ);
+		mtxSceneView = mtxView;
 		DirectX::XMStoreFloat4x4(&ptr->mtxWorldToView, mtxView);
 		DirectX::XMStoreFloat4x4(&ptr->mtxViewToWorld, DirectX::XMMatrixInverse(nullptr, mtxView));
 		DirectX::XMStoreFloat4x4(&ptr->mtxViewToClip, mtxClip);
@@ -1126,9 +1328,6 @@ void RenderScene()
 	}
 	auto&& curWaterCB = g_WaterCBs_[frameIndex];
 	{
-		static const float kNearZ = 1.0f;
-		static const float kFarZ = 10000.0f;
-		static const float kFovY = DirectX::XMConvertToRadians(60.0f);
 		static DirectX::XMFLOAT4X4 sPrevWorldToClip = DirectX::XMFLOAT4X4(1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1);
 		static float sCamAngle = 0.0f;
 		const float kAspect = (float)kWindowWidth / (float)kWindowHeight;
@@ -1145,29 +1344,48 @@ void RenderScene()
 	// ライト更新
 	auto&& curLightPosB = g_LightPosB_[frameIndex];
 	auto&& curLightPosBV = g_LightPosBV_[frameIndex];
+	auto&& curLightCB = g_LightCBs_[frameIndex];
 	{
-		auto mtxRot = DirectX::XMMatrixRotationY(DirectX::XMConvertToRadians(g_scenePause ? 0.0f : 1.0f));
-		for (int i = 0; i < kLightMax; i++)
-		{
-			DirectX::XMVECTOR p = DirectX::XMLoadFloat4(&DirectX::XMFLOAT4(g_LightPos_[i].x, g_LightPos_[i].y, g_LightPos_[i].z, 1.0f));
-			p = DirectX::XMVector3TransformCoord(p, mtxRot);
-			DirectX::XMFLOAT4 pp;
-			DirectX::XMStoreFloat4(&pp, p);
-			g_LightPos_[i].x = pp.x;
-			g_LightPos_[i].y = pp.y;
-			g_LightPos_[i].z = pp.z;
-		}
+		sl12::u32 lightCount = (sl12::u32)g_lightCount;
 
-		auto p = curLightPosB.Map(nullptr);
-		memcpy(p, g_LightPos_, sizeof(g_LightPos_));
+		// 有効なライトのみ変換し、マップしたバッファに直接書き込む
+		auto mtxRot = DirectX::XMMatrixRotationY(DirectX::XMConvertToRadians(g_scenePause ? 0.0f : 1.0f));
+		auto pos = reinterpret_cast<DirectX::XMFLOAT4*>(curLightPosB.Map(nullptr));
+		g_lightSet_.Transform(mtxRot, 0, lightCount, pos);
 		curLightPosB.Unmap();
+
+		auto p = reinterpret_cast<sl12::u32*>(curLightCB.cb_.Map(nullptr));
+		*p = lightCount;
+		curLightCB.cb_.Unmap();
+	}
+
+	// ライトのクラスタ割り当て
+	auto&& curClusterRangeB = g_ClusterRangeB_[frameIndex];
+	auto&& curClusterRangeBV = g_ClusterRangeBV_[frameIndex];
+	auto&& curClusterIndexB = g_ClusterIndexB_[frameIndex];
+	auto&& curClusterIndexBV = g_ClusterIndexBV_[frameIndex];
+	if (g_clusteredLighting)
+	{
+		// 変換後のライト座標で割り当て、結果をマップしたバッファに直接書き込む
+		g_clusterIndexCount = g_clusterBinner_.Bin(g_lightSet_, (sl12::u32)g_lightCount, mtxSceneView, 0);
+
+		auto ranges = reinterpret_cast<sl12::u32*>(curClusterRangeB.Map(nullptr));
+		g_clusterBinner_.WriteClusterRanges(ranges, g_clusterBinner_.GetMaxIndexCount());
+		curClusterRangeB.Unmap();
+
+		auto indices = reinterpret_cast<sl12::u32*>(curClusterIndexB.Map(nullptr));
+		g_clusterBinner_.WriteLightIndices(indices, g_clusterBinner_.GetMaxIndexCount());
+		curClusterIndexB.Unmap();
 	}
 
 	int passNo = 0;
+	bool isScheduled = true;
 
 	// BasePass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pOutputs[] = {
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetOutputIds()[0]),		// GBuffer0
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetOutputIds()[1]),		// GBuffer1
@@ -1184,9 +1402,10 @@ void RenderScene()
 		D3D12_CPU_DESCRIPTOR_HANDLE dsv = pOutputs[3]->GetDsv()->GetDesc()->GetCpuHandle();
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 
 		// 画面クリア
+		cmdList.FlushBarriers();
 		pCmdList->ClearRenderTargetView(rtvs[0], pOutputs[0]->GetTexture()->GetTextureDesc().clearColor, 0, nullptr);
 		pCmdList->ClearRenderTargetView(rtvs[1], pOutputs[1]->GetTexture()->GetTextureDesc().clearColor, 0, nullptr);
 		pCmdList->ClearRenderTargetView(rtvs[2], pOutputs[2]->GetTexture()->GetTextureDesc().clearColor, 0, nullptr);
@@ -1195,20 +1414,13 @@ void RenderScene()
 		// レンダーターゲット設定
 		pCmdList->OMSetRenderTargets(_countof(rtvs), rtvs, false, &dsv);
 
-		// DescriptorHeapを設定
-		ID3D12DescriptorHeap* pDescHeaps[] = {
-			g_Device_.GetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV).GetHeap(),
-			g_Device_.GetDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER).GetHeap()
-		};
-		pCmdList->SetDescriptorHeaps(_countof(pDescHeaps), pDescHeaps);
-
 		// PSOとルートシグネチャを設定
 		pCmdList->SetPipelineState(g_basePassPso_.GetPSO());
 		pCmdList->SetGraphicsRootSignature(g_basePassSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_basePassSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-		g_basePassSig_.SetDescriptor(mainCmdList, "CbMesh", g_MeshCB_.cbv_);
+		g_basePassSig_.SetDescriptor(cmdList, g_basePassCbSceneSlot_, curCB.cbv_);
+		g_basePassSig_.SetDescriptor(cmdList, g_basePassCbMeshSlot_, g_MeshCB_.cbv_);
 
 		// DrawCall
 		auto submeshCount = g_mesh_.GetSubmeshCount();
@@ -1224,20 +1436,22 @@ void RenderScene()
 			pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 			pCmdList->IASetVertexBuffers(0, _countof(views), views);
 			pCmdList->IASetIndexBuffer(&info.pSubmesh->GetIndexBufferView()->GetView());
-			pCmdList->DrawIndexedInstanced(info.numIndices, 1, 0, 0, 0);
+			cmdList.DrawIndexedInstanced(info.numIndices, 1, 0, 0, 0);
 		}
 	}
 
 	// LinearDepthPass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pInput = g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[0]);
 		sl12::RenderResource* pOutput = g_rrManager_.GetRenderResourceFromID(thisProd->GetOutputIds()[0]);
 
 		D3D12_CPU_DESCRIPTOR_HANDLE rtv = pOutput->GetRtv()->GetDesc()->GetCpuHandle();
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 
 		// レンダーターゲット設定
 		pCmdList->OMSetRenderTargets(1, &rtv, false, nullptr);
@@ -1247,19 +1461,21 @@ void RenderScene()
 		pCmdList->SetGraphicsRootSignature(g_linearDepthSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_linearDepthSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-		g_linearDepthSig_.SetDescriptor(mainCmdList, "texDepth", *pInput->GetSrv());
+		g_linearDepthSig_.SetDescriptor(cmdList, "CbScene", curCB.cbv_);
+		g_linearDepthSig_.SetDescriptor(cmdList, "texDepth", *pInput->GetSrv());
 
 		// DrawCall
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		cmdList.DrawInstanced(3, 1, 0, 0);
 	}
 
 	// LightingPass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pInputs[] = {
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[0]),		// GBuffer0
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[1]),		// GBuffer1
@@ -1269,35 +1485,62 @@ void RenderScene()
 		sl12::RenderResource* pOutput = g_rrManager_.GetRenderResourceFromID(thisProd->GetOutputIds()[0]);
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 
-		// PSOとルートシグネチャを設定
-		pCmdList->SetPipelineState(g_tiledLightPso_.GetPSO());
-		pCmdList->SetComputeRootSignature(g_tiledLightSig_.GetRootSignature()->GetRootSignature());
+		if (!g_clusteredLighting)
+		{
+			// PSOとルートシグネチャを設定
+			pCmdList->SetPipelineState(g_tiledLightPso_.GetPSO());
+			pCmdList->SetComputeRootSignature(g_tiledLightSig_.GetRootSignature()->GetRootSignature());
 
-		// デスクリプタテーブル設定
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "CbLightInfo", g_LightCB_.cbv_);
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "texGBuffer0", *pInputs[0]->GetSrv());
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "texGBuffer1", *pInputs[1]->GetSrv());
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "texGBuffer2", *pInputs[2]->GetSrv());
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "texLinearDepth", *pInputs[3]->GetSrv());
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "rLightPosBuffer", curLightPosBV);
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "rLightColorBuffer", g_LightColorBV_);
-		g_tiledLightSig_.SetDescriptor(mainCmdList, "rwFinal", *pOutput->GetUav(0));
+			// デスクリプタテーブル設定
+			// CBV, SRV, UAV をそれぞれ連続領域にまとめて設定する
+			g_tiledLightSet_.SetDescriptor("CbScene", curCB.cbv_);
+			g_tiledLightSet_.SetDescriptor("CbLightInfo", curLightCB.cbv_);
+			g_tiledLightSet_.SetDescriptor("texGBuffer0", *pInputs[0]->GetSrv());
+			g_tiledLightSet_.SetDescriptor("texGBuffer1", *pInputs[1]->GetSrv());
+			g_tiledLightSet_.SetDescriptor("texGBuffer2", *pInputs[2]->GetSrv());
+			g_tiledLightSet_.SetDescriptor("texLinearDepth", *pInputs[3]->GetSrv());
+			g_tiledLightSet_.SetDescriptor("rLightPosBuffer", curLightPosBV);
+			g_tiledLightSet_.SetDescriptor("rLightColorBuffer", g_LightColorBV_);
+			g_tiledLightSet_.SetDescriptor("rwFinal", *pOutput->GetUav(0));
+			g_tiledLightSet_.Bind(cmdList, &g_viewStaging_);
+		}
+		else
+		{
+			// PSOとルートシグネチャを設定
+			pCmdList->SetPipelineState(g_clusterLightPso_.GetPSO());
+			pCmdList->SetComputeRootSignature(g_clusterLightSig_.GetRootSignature()->GetRootSignature());
+
+			// デスクリプタテーブル設定
+			g_clusterLightSet_.SetDescriptor("CbScene", curCB.cbv_);
+			g_clusterLightSet_.SetDescriptor("CbClusterInfo", g_ClusterCB_.cbv_);
+			g_clusterLightSet_.SetDescriptor("texGBuffer0", *pInputs[0]->GetSrv());
+			g_clusterLightSet_.SetDescriptor("texGBuffer1", *pInputs[1]->GetSrv());
+			g_clusterLightSet_.SetDescriptor("texGBuffer2", *pInputs[2]->GetSrv());
+			g_clusterLightSet_.SetDescriptor("texLinearDepth", *pInputs[3]->GetSrv());
+			g_clusterLightSet_.SetDescriptor("rLightPosBuffer", curLightPosBV);
+			g_clusterLightSet_.SetDescriptor("rLightColorBuffer", g_LightColorBV_);
+			g_clusterLightSet_.SetDescriptor("rClusterRanges", curClusterRangeBV);
+			g_clusterLightSet_.SetDescriptor("rClusterLightIndices", curClusterIndexBV);
+			g_clusterLightSet_.SetDescriptor("rwFinal", *pOutput->GetUav(0));
+			g_clusterLightSet_.Bind(cmdList, &g_viewStaging_);
+		}
 
 		// DrawCall
-		pCmdList->Dispatch(kWindowWidth / kTileWidth, kWindowHeight / kTileWidth, 1);
+		cmdList.Dispatch(kWindowWidth / kTileWidth, kWindowHeight / kTileWidth, 1);
 	}
 
 	// Clear & Projection Hash Pass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pInput = g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[0]);
 		sl12::RenderResource* pOutput = g_rrManager_.GetRenderResourceFromID(thisProd->GetOutputIds()[0]);
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 
 		// Clear
 		{
@@ -1306,13 +1549,16 @@ void RenderScene()
 			pCmdList->SetComputeRootSignature(g_clearHashSig_.GetRootSignature()->GetRootSignature());
 
 			// デスクリプタテーブル設定
-			g_clearHashSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-			g_clearHashSig_.SetDescriptor(mainCmdList, "rwProjectHash", *pOutput->GetUav());
+			g_clearHashSig_.SetDescriptor(cmdList, "CbScene", curCB.cbv_);
+			g_clearHashSig_.SetDescriptor(cmdList, "rwProjectHash", *pOutput->GetUav());
 
 			// DrawCall
-			pCmdList->Dispatch(kWindowWidth / kTileWidth, kWindowHeight / kTileWidth, 1);
+			cmdList.Dispatch(kWindowWidth / kTileWidth, kWindowHeight / kTileWidth, 1);
 		}
 
+		// Clear の書き込みを Projection の前に完了させる
+		cmdList.UAVBarrier(pOutput->GetTexture());
+
 		// Projection
 		{
 			// PSOとルートシグネチャを設定
@@ -1320,19 +1566,21 @@ void RenderScene()
 			pCmdList->SetComputeRootSignature(g_projectHashSig_.GetRootSignature()->GetRootSignature());
 
 			// デスクリプタテーブル設定
-			g_projectHashSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-			g_projectHashSig_.SetDescriptor(mainCmdList, "CbWaterInfo", curWaterCB.cbv_);
-			g_projectHashSig_.SetDescriptor(mainCmdList, "texLinearDepth", *pInput->GetSrv());
-			g_projectHashSig_.SetDescriptor(mainCmdList, "rwProjectHash", *pOutput->GetUav());
+			g_projectHashSig_.SetDescriptor(cmdList, "CbScene", curCB.cbv_);
+			g_projectHashSig_.SetDescriptor(cmdList, "CbWaterInfo", curWaterCB.cbv_);
+			g_projectHashSig_.SetDescriptor(cmdList, "texLinearDepth", *pInput->GetSrv());
+			g_projectHashSig_.SetDescriptor(cmdList, "rwProjectHash", *pOutput->GetUav());
 
 			// DrawCall
-			pCmdList->Dispatch(kWindowWidth / kTileWidth, kWindowHeight / kTileWidth, 1);
+			cmdList.Dispatch(kWindowWidth / kTileWidth, kWindowHeight / kTileWidth, 1);
 		}
 	}
 
 	// Resolve Hash Pass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pInputs[] = {
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[0]),
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[1]),
@@ -1342,9 +1590,10 @@ void RenderScene()
 		D3D12_CPU_DESCRIPTOR_HANDLE rtv = pOutput->GetRtv()->GetDesc()->GetCpuHandle();
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 
 		// 画面クリア
+		cmdList.FlushBarriers();
 		pCmdList->ClearRenderTargetView(rtv, pOutput->GetTexture()->GetTextureDesc().clearColor, 0, nullptr);
 
 		// レンダーターゲット設定
@@ -1355,21 +1604,23 @@ void RenderScene()
 		pCmdList->SetGraphicsRootSignature(g_resolveHashSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_resolveHashSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-		g_resolveHashSig_.SetDescriptor(mainCmdList, "CbWaterInfo", curWaterCB.cbv_);
-		g_resolveHashSig_.SetDescriptor(mainCmdList, "texSceneColor", *pInputs[0]->GetSrv());
-		g_resolveHashSig_.SetDescriptor(mainCmdList, "texProjectHash", *pInputs[1]->GetSrv());
+		g_resolveHashSig_.SetDescriptor(cmdList, "CbScene", curCB.cbv_);
+		g_resolveHashSig_.SetDescriptor(cmdList, "CbWaterInfo", curWaterCB.cbv_);
+		g_resolveHashSig_.SetDescriptor(cmdList, "texSceneColor", *pInputs[0]->GetSrv());
+		g_resolveHashSig_.SetDescriptor(cmdList, "texProjectHash", *pInputs[1]->GetSrv());
 
 		// DrawCall
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		cmdList.DrawInstanced(3, 1, 0, 0);
 	}
 
 	// Temporal Reprojection Pass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pInputs[] = {
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[0]),
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[1]),
@@ -1379,7 +1630,7 @@ void RenderScene()
 		auto rtv = pOutput->GetRtv()->GetDesc()->GetCpuHandle();
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 
 		// レンダーターゲット設定
 		pCmdList->OMSetRenderTargets(1, &rtv, false, nullptr);
@@ -1389,10 +1640,10 @@ void RenderScene()
 		pCmdList->SetGraphicsRootSignature(g_reprojectSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_reprojectSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-		g_reprojectSig_.SetDescriptor(mainCmdList, "CbWaterInfo", curWaterCB.cbv_);
-		g_reprojectSig_.SetDescriptor(mainCmdList, "texPrevReflection", *pInputs[0]->GetSrv());
-		g_reprojectSig_.SetDescriptor(mainCmdList, "texProjectHash", *pInputs[1]->GetSrv());
+		g_reprojectSig_.SetDescriptor(cmdList, "CbScene", curCB.cbv_);
+		g_reprojectSig_.SetDescriptor(cmdList, "CbWaterInfo", curWaterCB.cbv_);
+		g_reprojectSig_.SetDescriptor(cmdList, "texPrevReflection", *pInputs[0]->GetSrv());
+		g_reprojectSig_.SetDescriptor(cmdList, "texProjectHash", *pInputs[1]->GetSrv());
 
 		// DrawCall
 		auto vb = g_WaterVBV_.GetView();
@@ -1400,12 +1651,14 @@ void RenderScene()
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 1, &vb);
 		pCmdList->IASetIndexBuffer(&ib);
-		pCmdList->DrawIndexedInstanced(6, 1, 0, 0, 0);
+		cmdList.DrawIndexedInstanced(6, 1, 0, 0, 0);
 	}
 
 	// Water Pass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pInput = g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[0]);
 		sl12::RenderResource* pOutputs[] = {
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetOutputIds()[0]),
@@ -1416,7 +1669,7 @@ void RenderScene()
 		auto dsv = pOutputs[1]->GetDsv()->GetDesc()->GetCpuHandle();
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 
 		// レンダーターゲット設定
 		pCmdList->OMSetRenderTargets(1, &rtv, false, &dsv);
@@ -1426,11 +1679,11 @@ void RenderScene()
 		pCmdList->SetGraphicsRootSignature(g_waterSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_waterSig_.SetDescriptor(mainCmdList, "CbScene", curCB.cbv_);
-		g_waterSig_.SetDescriptor(mainCmdList, "CbWaterInfo", curWaterCB.cbv_);
-		g_waterSig_.SetDescriptor(mainCmdList, "texSSPR", *pInput->GetSrv());
-		g_waterSig_.SetDescriptor(mainCmdList, "texNormal", g_WaveNormalTex_.srv_);
-		g_waterSig_.SetDescriptor(mainCmdList, "samLinear", g_sampler_);
+		g_waterSig_.SetDescriptor(cmdList, "CbScene", curCB.cbv_);
+		g_waterSig_.SetDescriptor(cmdList, "CbWaterInfo", curWaterCB.cbv_);
+		g_waterSig_.SetDescriptor(cmdList, "texSSPR", *pInput->GetSrv());
+		g_waterSig_.SetDescriptor(cmdList, "texNormal", g_WaveNormalTex_.srv_);
+		g_waterSig_.SetDescriptor(cmdList, "samLinear", g_sampler_);
 
 		// DrawCall
 		auto vb = g_WaterVBV_.GetView();
@@ -1438,12 +1691,14 @@ void RenderScene()
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 1, &vb);
 		pCmdList->IASetIndexBuffer(&ib);
-		pCmdList->DrawIndexedInstanced(6, 1, 0, 0, 0);
+		cmdList.DrawIndexedInstanced(6, 1, 0, 0, 0);
 	}
 
 	// BlurPass
 	{
-		auto thisProd = g_rrProducers_[passNo++];
+		auto thisProd = g_rrProducers_[passNo];
+		sl12::CommandList& cmdList = g_mainCmdLists_.GetPassCommandList(passNo++);
+		ID3D12GraphicsCommandList* pCmdList = cmdList.GetCommandList();
 		sl12::RenderResource* pInputs[] = {
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[0]),		// LightResult
 			g_rrManager_.GetRenderResourceFromID(thisProd->GetInputIds()[1]),		// LinearDepth
@@ -1453,9 +1708,9 @@ void RenderScene()
 		D3D12_CPU_DESCRIPTOR_HANDLE tempRtv = pTemp->GetRtv()->GetDesc()->GetCpuHandle();
 
 		// バリア
-		g_rrManager_.BarrierAllResources(mainCmdList, thisProd);
+		isScheduled &= g_rrManager_.BarrierAllResources(g_mainCmdLists_, thisProd);
 		auto tempPrevStates = thisProd->GetTempPrevStates();
-		mainCmdList.TransitionBarrier(pTemp->GetTexture(), tempPrevStates[0], D3D12_RESOURCE_STATE_RENDER_TARGET);
+		cmdList.TransitionBarrier(pTemp->GetTexture(), tempPrevStates[0], D3D12_RESOURCE_STATE_RENDER_TARGET);
 
 		//// X軸方向
 		// レンダーターゲット設定
@@ -1466,24 +1721,25 @@ void RenderScene()
 		pCmdList->SetGraphicsRootSignature(g_blurXPassSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_blurXPassSig_.SetDescriptor(mainCmdList, "CbGaussBlur", g_BlurCB_.cbv_);
-		g_blurXPassSig_.SetDescriptor(mainCmdList, "texSource", *pInputs[0]->GetSrv());
-		g_blurXPassSig_.SetDescriptor(mainCmdList, "texLinearDepth", *pInputs[1]->GetSrv());
-		g_blurXPassSig_.SetDescriptor(mainCmdList, "samLinearClamp", g_samLinearClamp_);
+		g_blurXPassSig_.SetDescriptor(cmdList, "CbGaussBlur", g_BlurCB_.cbv_);
+		g_blurXPassSig_.SetDescriptor(cmdList, "texSource", *pInputs[0]->GetSrv());
+		g_blurXPassSig_.SetDescriptor(cmdList, "texLinearDepth", *pInputs[1]->GetSrv());
+		g_blurXPassSig_.SetDescriptor(cmdList, "samLinearClamp", g_samLinearClamp_);
 
 		// DrawCall
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		cmdList.DrawInstanced(3, 1, 0, 0);
 
 
 		//// Y軸方向
 		// バリア
-		mainCmdList.TransitionBarrier(pTemp->GetTexture(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		cmdList.TransitionBarrier(pTemp->GetTexture(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
 		// 一応、画面クリア
 		const float kClearColor[] = { 0.0f, 0.0f, 0.6f, 1.0f };
+		cmdList.FlushBarriers();
 		pCmdList->ClearRenderTargetView(rtvHandle, kClearColor, 0, nullptr);
 
 		// レンダーターゲット設定
@@ -1494,23 +1750,28 @@ void RenderScene()
 		pCmdList->SetGraphicsRootSignature(g_blurYPassSig_.GetRootSignature()->GetRootSignature());
 
 		// デスクリプタテーブル設定
-		g_blurYPassSig_.SetDescriptor(mainCmdList, "CbGaussBlur", g_BlurCB_.cbv_);
-		g_blurYPassSig_.SetDescriptor(mainCmdList, "texSource", *pTemp->GetSrv());
-		g_blurYPassSig_.SetDescriptor(mainCmdList, "texLinearDepth", *pInputs[1]->GetSrv());
-		g_blurYPassSig_.SetDescriptor(mainCmdList, "samLinearClamp", g_samLinearClamp_);
+		g_blurYPassSig_.SetDescriptor(cmdList, "CbGaussBlur", g_BlurCB_.cbv_);
+		g_blurYPassSig_.SetDescriptor(cmdList, "texSource", *pTemp->GetSrv());
+		g_blurYPassSig_.SetDescriptor(cmdList, "texLinearDepth", *pInputs[1]->GetSrv());
+		g_blurYPassSig_.SetDescriptor(cmdList, "samLinearClamp", g_samLinearClamp_);
 
 		// DrawCall
 		pCmdList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 		pCmdList->IASetVertexBuffers(0, 0, nullptr);
 		pCmdList->IASetIndexBuffer(nullptr);
-		pCmdList->DrawInstanced(3, 1, 0, 0);
+		cmdList.DrawInstanced(3, 1, 0, 0);
 	}
 
+	// NOTE: 最後のコマンドリストがBlurPassと別の場合もあるので、レンダーターゲットを設定し直す
+	lastCmdList.GetCommandList()->OMSetRenderTargets(1, &rtvHandle, false, nullptr);
 	ImGui::Render();
 
-	mainCmdList.TransitionBarrier(scTex, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+	lastCmdList.TransitionBarrier(scTex, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+
+	// MakeResources に渡していないプロデューサーのパスはバリアが張られていない
+	assert(isScheduled);
 
-	mainCmdList.Close();
+	g_mainCmdLists_.Close();
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
@@ -1518,14 +1779,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 	InitWindow(hInstance, nCmdShow);
 
 	std::array<uint32_t, D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES> kDescNums
-	{ 100, 100, 20, 10 };
+	{ 100 + kViewStagingCount * kMaxFrameCount, 100, 20, 10 };
 	auto ret = g_Device_.Initialize(g_hWnd_, kWindowWidth, kWindowHeight, kDescNums);
 	assert(ret);
-	for (auto& v : g_mainCmdLists_)
-	{
-		ret = v.Initialize(&g_Device_, &g_Device_.GetGraphicsQueue());
-		assert(ret);
-	}
+	ret = g_mainCmdLists_.Initialize(&g_Device_, kMaxFrameCount);
+	assert(ret);
 	ret = g_copyCmdList_.Initialize(&g_Device_, &g_Device_.GetCopyQueue());
 	assert(ret);
 	ret = InitializeAssets();
@@ -1556,17 +1814,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE, LPSTR, int nCmdShow)
 
 		// 前回フレームのコマンドを次回フレームの頭で実行
 		// コマンドが実行中、次のフレーム用のコマンドがロードされる
-		g_mainCmdLists_[frameIndex].Execute();
+		g_mainCmdLists_.Execute(frameIndex);
 	}
 
 	g_Device_.WaitDrawDone();
 	DestroyRenderResource();
 	DestroyAssets();
 	g_copyCmdList_.Destroy();
-	for (auto& v : g_mainCmdLists_)
-		v.Destroy();
-	for (auto& v : g_mainCmdLists_)
-		v.Destroy();
+	g_mainCmdLists_.Destroy();
 	g_Device_.Destroy();
 
 	return static_cast<char>(msg.wParam);
@@ -0,0 +1,65 @@
+// Cg̃NX^
+// Cg̃NX^ւ̊蓖Ă CPU  sl12::LightClusterBinner ōs
+
+#include "const_buffer.hlsli"
+#include "point_light.hlsli"
+
+#define kTileWidth				(16)
+
+// 萔obt@
+cbuffer CbClusterInfo
+{
+	uint4	clusterGrid;		// (^CX, ^CY, XCX, ^C̃sNZ)
+	float4	clusterDepth;		// (ŏ̃XCX̐[x, XCXW, ?, ?)
+};
+
+// 
+StructuredBuffer<PointLightPos>		rLightPosBuffer;
+StructuredBuffer<PointLightColor>	rLightColorBuffer;
+StructuredBuffer<uint2>				rClusterRanges;			// NX^Ƃ (ItZbg, )
+StructuredBuffer<uint>				rClusterLightIndices;	// SNX^̃CgCfbNXXg
+
+// o
+RWTexture2D<float4>					rwFinal			: register( u0 );
+
+// [xXCXԍ߂
+// NOTE: LightClusterBinner::GetSlice() Ɠ
+uint GetClusterSlice(float viewDepth)
+{
+	if (viewDepth <= clusterDepth.x)
+	{
+		return 0;
+	}
+	uint slice = (uint)(log(viewDepth / clusterDepth.x) * clusterDepth.y);
+	return min(slice, clusterGrid.z - 1);
+}
+
+[numthreads(kTileWidth, kTileWidth, 1)]
+void main(
+	uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	// esNZ̖@A[xAAxh擾
+	uint2 frameUV = dispatchThreadId.xy;
+	SurfaceData surface = GetSurfaceData(frameUV);
+
+	// sNZ̑NX^߂
+	// ^CƂ̐[x͈͂ɈˑȂ̂ŁA[x̕sAĂ肷郉Cg͑Ȃ
+	uint2 tile = frameUV / clusterGrid.w;
+	uint slice = GetClusterSlice(surface.viewDepth);
+	uint clusterIndex = (slice * clusterGrid.y + tile.y) * clusterGrid.x + tile.x;
+	uint2 range = rClusterRanges[clusterIndex];
+
+	// CgvZ
+	float3 light_result = CalcAmbient(surface);
+	for (uint i = 0; i < range.y; ++i)
+	{
+		uint lightIndex = rClusterLightIndices[range.x + i];
+		PointLightPos lpos = rLightPosBuffer[lightIndex];
+		PointLightColor lcolor = rLightColorBuffer[lightIndex];
+
+		light_result += CalcPointLight(surface, lpos, lcolor);
+	}
+
+	// o
+	rwFinal[frameUV] = float4(light_result, 1.0);
+}
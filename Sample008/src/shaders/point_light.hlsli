@@ -0,0 +1,151 @@
+#ifndef SHADERS_POINT_LIGHT_HLSLI
+#define SHADERS_POINT_LIGHT_HLSLI
+
+// |CgCg̃CeBO
+// ^CCeBOƃNX^CeBOŋ
+
+#include "const_buffer.hlsli"
+
+// |CgCgWf[^
+struct PointLightPos
+{
+	float4	posAndRadius;
+};
+
+// |CgCgJ[f[^
+struct PointLightColor
+{
+	float4	color;
+};
+
+// T[tFCX
+struct SurfaceData
+{
+	float3	posInWorld;
+	float3	normalInWorld;
+	float3	diffuseColor;
+	float3	specularColor;
+	float	roughness;
+	float	linearDepth;
+	float	viewDepth;
+};
+
+// 
+Texture2D							texGBuffer0;
+Texture2D							texGBuffer1;
+Texture2D							texGBuffer2;
+Texture2D							texLinearDepth;
+
+// [hW擾
+float3 GetSurfaceWorldPos(uint2 uv, out float linearDepth, out float viewDepth)
+{
+	linearDepth = texLinearDepth[uv].r;
+
+	float2 screen_uv = (float2)uv / screenInfo.xy;
+	screen_uv = screen_uv * float2(2, -2) + float2(-1, 1);
+	float3 frustumVec = { frustumCorner.x * screen_uv.x, frustumCorner.y * screen_uv.y, -frustumCorner.z };
+	float3 posVS = frustumVec * linearDepth;
+	viewDepth = -posVS.z;
+	return mul(mtxViewToWorld, float4(posVS, 1)).xyz;
+}
+
+// T[tFCX擾
+SurfaceData GetSurfaceData(uint2 uv)
+{
+	SurfaceData ret = (SurfaceData)0;
+
+	ret.posInWorld = GetSurfaceWorldPos(uv, ret.linearDepth, ret.viewDepth);
+
+	// eNX`TvO
+	float3 normalWS = normalize(texGBuffer0[uv].xyz);
+	float3 baseColor = texGBuffer1[uv].rgb;
+	float2 metalRough = texGBuffer2[uv].rg;
+
+	ret.normalInWorld = normalize(normalWS);
+	ret.diffuseColor = lerp(baseColor, (0.0).xxx, metalRough.x);
+	ret.specularColor = lerp((0.0).xxx, baseColor, metalRough.x);
+	ret.roughness = metalRough.y;
+
+	return ret;
+}
+
+// |CgCǧʂ߂
+float CalcPointLightAttn(float lengthSq, float radius)
+{
+	float length_attn = 1.0 / lengthSq;
+	float rad_attn = 1.0 - pow(saturate(lengthSq / (radius * radius)), 10.0);
+	return length_attn * rad_attn;
+}
+
+#define PI	3.1415926
+
+// Lembert
+float3 CalcDiffuseLambert(float3 C)
+{
+	return C / PI;
+}
+
+// GGX
+float CalcD_GGX(float roughness, float NoH)
+{
+	float a = roughness * roughness;
+	float a2 = a * a;
+	float d = (NoH * a2 - NoH) * NoH + 1;
+	return a2 / (d * d * PI);
+}
+
+// Smith GGX Correlated
+float CalcG_SmithGGXCorrelated(float roughness, float NoV, float NoL)
+{
+	float r2 = roughness * roughness;
+	float v = NoL * sqrt((-NoV * r2 + NoV) * NoV + r2);
+	float l = NoV * sqrt((-NoL * r2 + NoL) * NoL + r2);
+	return 0.5 / (v + l);
+}
+
+// Schlick
+float3 CalcF_Schlick(float3 C, float LoH)
+{
+	float f = pow(1 - LoH, 5);
+	return f + (1 - f) * C;
+}
+
+// |CgCǧvZs
+float3 CalcPointLight(SurfaceData surface, PointLightPos lp, PointLightColor lc)
+{
+	float3 PtoL = lp.posAndRadius.xyz - surface.posInWorld;
+	float lengthSq = dot(PtoL, PtoL);
+	float3 L = normalize(PtoL);
+	float3 N = surface.normalInWorld;
+	float3 V = normalize(mtxViewToWorld._m03_m13_m23 - surface.posInWorld);
+	float3 H = normalize(V + L);
+	
+	float NoV = abs(dot(N, V)) + 1e-5;
+	float LoH = saturate(dot(L, H));
+	float NoH = saturate(dot(N, H));
+	float NoL = saturate(dot(N, L));
+
+	float3 diffuse = CalcDiffuseLambert(surface.diffuseColor);
+	float3 specular = CalcD_GGX(surface.roughness, NoH)
+		* CalcG_SmithGGXCorrelated(surface.roughness, NoV, NoL)
+		* CalcF_Schlick(surface.specularColor, LoH);
+
+	float attn = CalcPointLightAttn(lengthSq, lp.posAndRadius.w);
+
+	return (diffuse + specular) * NoL * attn * lc.color.rgb;
+}
+
+// ArGgCg߂
+// NOTE: Â̂ǂƎv̂ŋƒnʂ̐F@ŕԂ
+float3 CalcAmbient(SurfaceData surface)
+{
+	const float3 kSkyColor = float3(0.1, 0.2, 0.35);
+	const float3 kGroundColor = float3(0.33, 0.16, 0.0);
+	float3 ambient = lerp(kGroundColor, kSkyColor, surface.normalInWorld.y * 0.5 + 0.5);
+	return surface.diffuseColor * ambient;
+}
+
+#endif // SHADERS_POINT_LIGHT_HLSLI
+
+
+//	EOF
@@ -1,22 +1,11 @@
 // Cg̃^C
 
 #include "const_buffer.hlsli"
+#include "point_light.hlsli"
 
 #define kTileWidth				(16)
 #define kTileSize				(kTileWidth * kTileWidth)
-#define kMaxLight				(1024)
-
-// |CgCgWf[^
-struct PointLightPos
-{
-	float4	posAndRadius;
-};
-
-// |CgCgJ[f[^
-struct PointLightColor
-{
-	float4	color;
-};
+#define kMaxTileLight			(4096)		// ^CɐڐG郉Cg̍ő吔. CgŜ̐ɂ͐͂Ȃ
 
 // |CgCg\
 struct PointLight
@@ -26,18 +15,6 @@ struct PointLight
 	float4	attn;
 };
 
-// T[tFCX
-struct SurfaceData
-{
-	float3	posInWorld;
-	float3	normalInWorld;
-	float3	diffuseColor;
-	float3	specularColor;
-	float	roughness;
-	float	linearDepth;
-	float	viewDepth;
-};
-
 // o͍\
 struct PointVertexGS
 {
@@ -57,10 +34,6 @@ cbuffer CbLightInfo
 // 
 StructuredBuffer<PointLightPos>		rLightPosBuffer;
 StructuredBuffer<PointLightColor>	rLightColorBuffer;
-Texture2D							texGBuffer0;
-Texture2D							texGBuffer1;
-Texture2D							texGBuffer2;
-Texture2D							texLinearDepth;
 
 // o
 RWTexture2D<float4>					rwFinal			: register( u0 );
@@ -68,44 +41,11 @@ RWTexture2D<float4>					rwFinal			: register( u0 );
 // L
 groupshared uint sMinZ;		// ^C̍ŏ[x
 groupshared uint sMaxZ;		// ^C̍ő[x
-groupshared uint sTileLightIndices[kMaxLight];	// ^CɐڐGĂ|CgCg̃CfbNX
+groupshared uint sTileLightIndices[kMaxTileLight];	// ^CɐڐGĂ|CgCg̃CfbNX
 groupshared uint sTileNumLights;				// ^CɐڐGĂ|CgCg̐
 groupshared uint sPerSamplePixels[kTileSize];
 groupshared uint sNumPerSamplePixels;
 
-// [hW擾
-float3 GetSurfaceWorldPos(uint2 uv, out float linearDepth, out float viewDepth)
-{
-	linearDepth = texLinearDepth[uv].r;
-
-	float2 screen_uv = (float2)uv / screenInfo.xy;
-	screen_uv = screen_uv * float2(2, -2) + float2(-1, 1);
-	float3 frustumVec = { frustumCorner.x * screen_uv.x, frustumCorner.y * screen_uv.y, -frustumCorner.z };
-	float3 posVS = frustumVec * linearDepth;
-	viewDepth = -posVS.z;
-	return mul(mtxViewToWorld, float4(posVS, 1)).xyz;
-}
-
-// T[tFCX擾
-SurfaceData GetSurfaceData(uint2 uv)
-{
-	SurfaceData ret = (SurfaceData)0;
-
-	ret.posInWorld = GetSurfaceWorldPos(uv, ret.linearDepth, ret.viewDepth);
-
-	// eNX`TvO
-	float3 normalWS = normalize(texGBuffer0[uv].xyz);
-	float3 baseColor = texGBuffer1[uv].rgb;
-	float2 metalRough = texGBuffer2[uv].rg;
-
-	ret.normalInWorld = normalize(normalWS);
-	ret.diffuseColor = lerp(baseColor, (0.0).xxx, metalRough.x);
-	ret.specularColor = lerp((0.0).xxx, baseColor, metalRough.x);
-	ret.roughness = metalRough.y;
-
-	return ret;
-}
-
 //! ^C̐߂
 void GetTileFrustumPlane( out float4 frustumPlanes[6], uint3 groupId )
 {
@@ -135,74 +75,6 @@ void GetTileFrustumPlane( out float4 frustumPlanes[6], uint3 groupId )
 	}
 }
 
-// |CgCǧʂ߂
-float CalcPointLightAttn(float lengthSq, float radius)
-{
-	float length_attn = 1.0 / lengthSq;
-	float rad_attn = 1.0 - pow(saturate(lengthSq / (radius * radius)), 10.0);
-	return length_attn * rad_attn;
-}
-
-#define PI	3.1415926
-
-// Lembert
-float3 CalcDiffuseLambert(float3 C)
-{
-	return C / PI;
-}
-
-// GGX
-float CalcD_GGX(float roughness, float NoH)
-{
-	float a = roughness * roughness;
-	float a2 = a * a;
-	float d = (NoH * a2 - NoH) * NoH + 1;
-	return a2 / (d * d * PI);
-}
-
-// Smith GGX Correlated
-float CalcG_SmithGGXCorrelated(float roughness, float NoV, float NoL)
-{
-	float r2 = roughness * roughness;
-	float v = NoL * sqrt((-NoV * r2 + NoV) * NoV + r2);
-	float l = NoV * sqrt((-NoL * r2 + NoL) * NoL + r2);
-	return 0.5 / (v + l);
-}
-
-// Schlick
-float3 CalcF_Schlick(float3 C, float LoH)
-{
-	float f = pow(1 - LoH, 5);
-	return f + (1 - f) * C;
-}
-
-// |CgCǧvZs
-float3 CalcPointLight(SurfaceData surface, PointLightPos lp, PointLightColor lc)
-{
-	float3 PtoL = lp.posAndRadius.xyz - surface.posInWorld;
-	float lengthSq = dot(PtoL, PtoL);
-	float3 L = normalize(PtoL);
-	float3 N = surface.normalInWorld;
-	float3 V = normalize(mtxViewToWorld._m03_m13_m23 - surface.posInWorld);
-	float3 H = normalize(V + L);
-	
-	float NoV = abs(dot(N, V)) + 1e-5;
-	float LoH = saturate(dot(L, H));
-	float NoH = saturate(dot(N, H));
-	float NoL = saturate(dot(N, L));
-
-	float3 diffuse = CalcDiffuseLambert(surface.diffuseColor);
-	float3 specular = CalcD_GGX(surface.roughness, NoH)
-		* CalcG_SmithGGXCorrelated(surface.roughness, NoV, NoL)
-		* CalcF_Schlick(surface.specularColor, LoH);
-
-	float attn = CalcPointLightAttn(lengthSq, lp.posAndRadius.w);
-
-	return (diffuse + specular) * NoL * attn * lc.color.rgb;
-}
-
-
-
 [numthreads(kTileWidth, kTileWidth, 1)]
 void main(
 	uint3 groupId          : SV_GroupID,
@@ -267,21 +139,21 @@ void main(
 		{
 			uint listIndex;
 			InterlockedAdd(sTileNumLights, 1, listIndex);
-			sTileLightIndices[listIndex] = lightIndex;
+			// NOTE: 𒴂Cĝ͎Ă
+			if (listIndex < kMaxTileLight)
+			{
+				sTileLightIndices[listIndex] = lightIndex;
+			}
 		}
 	}
 
 	// œƁAsTileLightIndicesɃ^CƏՓ˂Ă郉Cg̃CfbNXς܂Ă
     GroupMemoryBarrierWithGroupSync();
 
-	// NOTE: Â̂ǂƎv̂ŃArGgCgvZĂ
-	const float3 kSkyColor = float3(0.1, 0.2, 0.35);
-	const float3 kGroundColor = float3(0.33, 0.16, 0.0);
-	float3 ambient = lerp(kGroundColor, kSkyColor, surface.normalInWorld.y * 0.5 + 0.5);
-
 	// CgvZ
-	float3 light_result = surface.diffuseColor * ambient;
-	for (uint i = 0; i < sTileNumLights; ++i)
+	float3 light_result = CalcAmbient(surface);
+	uint tileNumLights = min(sTileNumLights, kMaxTileLight);
+	for (uint i = 0; i < tileNumLights; ++i)
 	{
 		uint lightIndex = sTileLightIndices[i];
 		PointLightPos lpos = rLightPosBuffer[lightIndex];
@@ -238,7 +238,7 @@ public:
 		desc.Height = kScreenHeight;
 		desc.Depth = 1;
 		dxrCmdList->SetPipelineState1(stateObject_.GetPSO());
-		dxrCmdList->DispatchRays(&desc);
+		cmdList.DispatchRays(&desc);
 
 		cmdList.UAVBarrier(&resultTexture_);
 
@@ -246,7 +246,7 @@ public:
 		cmdList.TransitionBarrier(swapchain.GetCurrentTexture(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_DEST);
 		cmdList.TransitionBarrier(&resultTexture_, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
 
-		d3dCmdList->CopyResource(swapchain.GetCurrentTexture()->GetResourceDep(), resultTexture_.GetResourceDep());
+		cmdList.CopyResource(swapchain.GetCurrentTexture()->GetResourceDep(), resultTexture_.GetResourceDep());
 
 		cmdList.TransitionBarrier(swapchain.GetCurrentTexture(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PRESENT);
 		cmdList.TransitionBarrier(&resultTexture_, D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
@@ -1,3 +1,5 @@
+#include "random.hlsli"
+
 struct SceneCB
 {
 	float4x4	mtxProjToWorld;
@@ -11,6 +13,7 @@ struct HitData
 {
 	float4	color;
 	uint	refl_count;
+	uint	rng_state;
 };
 
 struct MyAttribute
@@ -52,9 +55,7 @@ struct Instance
 // global
 RaytracingAccelerationStructure		Scene			: register(t0, space0);
 StructuredBuffer<Instance>			Instances		: register(t1);
-StructuredBuffer<float>				RandomTable		: register(t2);
 RWTexture2D<float4>					RenderTarget	: register(u0);
-RWByteAddressBuffer					RandomSeed		: register(u1);
 ConstantBuffer<SceneCB>				cbScene			: register(b0);
 
 
@@ -175,13 +176,6 @@ float3 SkyColor(float3 w_dir)
 	return saturate((1.0).xxx * (1.0 - t) + float3(0.5, 0.7, 1.0) * t);
 }
 
-float GetRandom()
-{
-	uint adr;
-	RandomSeed.InterlockedAdd(0, 1, adr);
-	return RandomTable[adr % 65536];
-}
-
 float3 Reflect(float3 v, float3 n)
 {
 	return v - dot(v, n) * n * 2.0;
@@ -212,7 +206,11 @@ float Schlick(float cosine, float ref_idx)
 [shader("raygeneration")]
 void RayGenerateProc()
 {
-	float2 offset = { GetRandom(), GetRandom() };
+	// ̓sNZƃTvƂɓƗɐAyC[hŌ㑱̃VF[_ɓn
+	uint rng = InitRandomState(DispatchRaysIndex().xy, cbScene.loopCount);
+	float2 offset;
+	offset.x = NextRandom(rng);
+	offset.y = NextRandom(rng);
 
 	// sNZSWNbvԍWɕϊ
 	uint2 index = DispatchRaysIndex().xy;
@@ -229,7 +227,7 @@ void RayGenerateProc()
 
 	// Let's CgI
 	RayDesc ray = { origin, 0.0, direction, TMax };
-	HitData payload = { float4(0, 0, 0, 0), 0 };
+	HitData payload = { float4(0, 0, 0, 0), 0, rng };
 	TraceRay(Scene, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, ~0, 0, 1, 0, ray, payload);
 
 	// O܂ł̌ʂƃuh
@@ -339,7 +337,7 @@ void ClosestHitProc(inout HitData payload : SV_RayPayload, in MyAttribute attr :
 			}
 			// pĔ˂܂I
 			// NOTE: tl̋قǔ˂I΂₷
-			if (GetRandom() < reflect_prob)
+			if (NextRandom(payload.rng_state) < reflect_prob)
 			{
 				traceDir = reflected;
 			}
@@ -353,7 +351,7 @@ void ClosestHitProc(inout HitData payload : SV_RayPayload, in MyAttribute attr :
 		{
 			// ˃xNgɑ΂ăCg
 			RayDesc ray = { origin, 1e-2, traceDir, TMax };
-			HitData refl_payload = { float4(0, 0, 0, 0), payload.refl_count + 1 };
+			HitData refl_payload = { float4(0, 0, 0, 0), payload.refl_count + 1, payload.rng_state };
 			TraceRay(Scene, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, ~0, 0, 1, 0, ray, refl_payload);
 
 			// ʂɃCX^X̃J[Z邾
@@ -96,9 +96,7 @@ public:
 		{
 			D3D12_DESCRIPTOR_RANGE ranges[] = {
 				{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
-				{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 2, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
 				{ D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
-				{ D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
 				{ D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },
 			};
 
@@ -246,36 +244,6 @@ public:
 			}
 		}
 
-		// p̃obt@𐶐
-		{
-			if (!randomBuffer_.Initialize(&device_, sizeof(float) * 65536, sizeof(float), sl12::BufferUsage::ShaderResource, true, false))
-			{
-				return false;
-			}
-			if (!randomBufferSRV_.Initialize(&device_, &randomBuffer_, 0, sizeof(float)))
-			{
-				return false;
-			}
-			if (!seedBuffer_.Initialize(&device_, sizeof(uint32_t), 1, sl12::BufferUsage::ShaderResource, false, true))
-			{
-				return false;
-			}
-			if (!seedBufferUAV_.Initialize(&device_, &seedBuffer_))
-			{
-				return false;
-			}
-
-			auto p = reinterpret_cast<float*>(randomBuffer_.Map(nullptr));
-			std::random_device rd;
-			std::mt19937 mt(rd());
-			std::uniform_real_distribution<float> randGen01(0.0f, 1.0f);
-			for (int i = 0; i < 65536; i++)
-			{
-				p[i] = randGen01(mt);
-			}
-			randomBuffer_.Unmap();
-		}
-
 		// GUȈ
 		if (!gui_.Initialize(&device_, DXGI_FORMAT_R8G8B8A8_UNORM))
 		{
@@ -367,11 +335,9 @@ public:
 
 			// O[oݒ̃VF[_\[Xݒ肷
 			d3dCmdList->SetComputeRootDescriptorTable(0, instanceSBV_.GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootDescriptorTable(1, randomBufferSRV_.GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootDescriptorTable(2, resultTextureUAV_.GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootDescriptorTable(3, seedBufferUAV_.GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootDescriptorTable(4, sceneCBVs_[frameIndex].GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootShaderResourceView(5, topAS_.GetDxrBuffer().GetResourceDep()->GetGPUVirtualAddress());
+			d3dCmdList->SetComputeRootDescriptorTable(1, resultTextureUAV_.GetDesc()->GetGpuHandle());
+			d3dCmdList->SetComputeRootDescriptorTable(2, sceneCBVs_[frameIndex].GetDesc()->GetGpuHandle());
+			d3dCmdList->SetComputeRootShaderResourceView(3, topAS_.GetDxrBuffer().GetResourceDep()->GetGPUVirtualAddress());
 
 			// Cg[Xs
 			D3D12_DISPATCH_RAYS_DESC desc{};
@@ -387,7 +353,7 @@ public:
 			desc.Height = kScreenHeight;
 			desc.Depth = 1;
 			dxrCmdList->SetPipelineState1(stateObject_.GetPSO());
-			dxrCmdList->DispatchRays(&desc);
+			cmdList.DispatchRays(&desc);
 
 			cmdList.UAVBarrier(&resultTexture_);
 		}
@@ -463,11 +429,6 @@ public:
 		instanceSB_.Destroy();
 		spheresAABB_.Destroy();
 
-		randomBufferSRV_.Destroy();
-		randomBuffer_.Destroy();
-		seedBufferUAV_.Destroy();
-		seedBuffer_.Destroy();
-
 		resultTextureUAV_.Destroy();
 		resultTextureRTV_.Destroy();
 		resultTextureSRV_.Destroy();
@@ -568,9 +529,9 @@ private:
 		dxrDesc.AddHitGroup(kHitGroupName, false, nullptr, kClosestHitName, kIntersectName);
 
 		// VF[_RtBOTuIuWFNg
-		// payload : color(float4) + refl_count(uint)
+		// payload : color(float4) + refl_count(uint) + rng_state(uint)
 		// attribute : normal(float3)
-		dxrDesc.AddShaderConfig(sizeof(float) * 4 + sizeof(uint32_t), sizeof(float) * 3);
+		dxrDesc.AddShaderConfig(sizeof(float) * 4 + sizeof(uint32_t) * 2, sizeof(float) * 3);
 
 		// [J[gVOl`TuIuWFNg
 		// VF[_R[hƂɐݒ肳郋[gVOl`ݒ肵܂.
@@ -902,11 +863,6 @@ private:
 	sl12::RenderTargetView		resultTextureRTV_;
 	sl12::UnorderedAccessView	resultTextureUAV_;
 
-	sl12::Buffer				randomBuffer_;
-	sl12::BufferView			randomBufferSRV_;
-	sl12::Buffer				seedBuffer_;
-	sl12::UnorderedAccessView	seedBufferUAV_;
-
 	sl12::BottomAccelerationStructure	bottomAS_;
 	sl12::TopAccelerationStructure		topAS_;
 
@@ -0,0 +1,32 @@
+#ifndef RANDOM_HLSLI
+#define RANDOM_HLSLI
+
+// ԂȂ
+// sNZƃTvԍԂ̂ŁAXbhԂŋLJE^KvƂȂ
+// NOTE: SampleLib12  sl12/random.h ƓvZs
+
+// PCG hash
+uint PcgHash(uint v)
+{
+	uint state = v * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+// sNZƃTvԍ痐̏Ԃ
+uint InitRandomState(uint2 pixel, uint sampleIndex)
+{
+	return PcgHash(pixel.x + PcgHash(pixel.y + PcgHash(sampleIndex)));
+}
+
+// Ԃi߂ [0, 1) ̗Ԃ (PCG-RXS-M-XS 32)
+float NextRandom(inout uint state)
+{
+	state = state * 747796405u + 2891336453u;
+	uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	word = (word >> 22u) ^ word;
+	return float(word >> 8) * (1.0 / 16777216.0);
+}
+
+#endif // RANDOM_HLSLI
+//	EOF
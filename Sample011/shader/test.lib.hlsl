@@ -1,3 +1,5 @@
+#include "random.hlsli"
+
 struct SceneCB
 {
 	float4x4	mtxProjToWorld;
@@ -15,6 +17,7 @@ struct HitData
 	float4	color;
 	int		refl_count;
 	float	minT;
+	uint	rng_state;
 };
 #else
 struct HitData
@@ -24,6 +27,7 @@ struct HitData
 	float3	next_ray_origin;
 	float3	next_ray_dir;
 	uint	is_hit;
+	uint	rng_state;
 };
 #endif
 
@@ -34,9 +38,7 @@ struct HitData
 
 // global
 RaytracingAccelerationStructure		Scene			: register(t0, space0);
-StructuredBuffer<float>				RandomTable		: register(t1);
 RWTexture2D<float4>					RenderTarget	: register(u0);
-RWByteAddressBuffer					RandomSeed		: register(u1);
 ConstantBuffer<SceneCB>				cbScene			: register(b0);
 
 // local
@@ -171,13 +173,6 @@ float3 SkyColor(float3 w_dir)
 	return saturate((1.0).xxx * (1.0 - t) + float3(0.5, 0.7, 1.0) * t);
 }
 
-float GetRandom()
-{
-	uint adr;
-	RandomSeed.InterlockedAdd(0, 1, adr);
-	return RandomTable[adr % 65536];
-}
-
 float3 Reflect(float3 v, float3 n)
 {
 	return v - dot(v, n) * n * 2.0;
@@ -202,7 +197,11 @@ void CalcTangentSpace(float3 pos0, float3 pos1, float3 pos2, float2 uv0, float2
 [shader("raygeneration")]
 void RayGenerator()
 {
-	float2 offset = { GetRandom(), GetRandom() };
+	// ̓sNZƃTvƂɓƗɐAyC[hŌ㑱̃VF[_ɓn
+	uint rng = InitRandomState(DispatchRaysIndex().xy, cbScene.loopCount);
+	float2 offset;
+	offset.x = NextRandom(rng);
+	offset.y = NextRandom(rng);
 
 	// sNZSWNbvԍWɕϊ
 	uint2 index = DispatchRaysIndex().xy;
@@ -219,7 +218,7 @@ void RayGenerator()
 
 	// Let's CgI
 	RayDesc ray = { origin, 0.0, direction, TMax };
-	HitData payload = { float4(0, 0, 0, 0), 0, 0 };
+	HitData payload = { float4(0, 0, 0, 0), 0, 0, rng };
 	TraceRay(Scene, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, ~0, 0, 2, 0, ray, payload);
 
 	// O܂ł̌ʂƃuh
@@ -248,7 +247,7 @@ void ClosestHitProcessor(inout HitData payload : SV_RayPayload, in BuiltInTriang
 	payload.minT = RayTCurrent();
 	if (payload.refl_count < MaxReflCount)
 	{
-		float rnd = GetRandom();
+		float rnd = NextRandom(payload.rng_state);
 		uint i = (cbScene.loopCount + uint(rnd * MaxSample)) % MaxSample;
 		float2 ham = Hammersley2D(i, MaxSample);
 		float3 localDir = HemisphereSampleUniform(ham.x, ham.y);
@@ -260,7 +259,7 @@ void ClosestHitProcessor(inout HitData payload : SV_RayPayload, in BuiltInTriang
 		// ˃xNgɑ΂ăCg
 		float3 origin = WorldRayOrigin() + WorldRayDirection() * RayTCurrent() + normal * 0.01;
 		RayDesc ray = { origin, 0, traceDir, TMax };
-		HitData refl_payload = { float4(0, 0, 0, 0), payload.refl_count + 1, 0 };
+		HitData refl_payload = { float4(0, 0, 0, 0), payload.refl_count + 1, 0, payload.rng_state };
 		TraceRay(Scene, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, ~0, 0, 2, 0, ray, refl_payload);
 
 		// VhEvZp̃Cg
@@ -268,7 +267,7 @@ void ClosestHitProcessor(inout HitData payload : SV_RayPayload, in BuiltInTriang
 		qRot = QuatFromTwoVector(float3(0, 0, 1), -cbScene.lightDir.xyz);
 		traceDir = QuatRotVector(localDir, qRot);
 		RayDesc shadow_ray = { origin, 0.0, traceDir, TMax };
-		HitData shadow_payload = { float4(0, 0, 0, 0), payload.refl_count + 1, 0 };
+		HitData shadow_payload = { float4(0, 0, 0, 0), payload.refl_count + 1, 0, 0 };
 		TraceRay(Scene, RAY_FLAG_SKIP_CLOSEST_HIT_SHADER, ~0, 1, 2, 1, shadow_ray, shadow_payload);
 
 		// ڌƊԐڌ̌ʂZ
@@ -307,7 +306,11 @@ void MissShadowProcessor(inout HitData payload : SV_RayPayload)
 [shader("raygeneration")]
 void RayGenerator()
 {
-	float2 offset = { GetRandom(), GetRandom() };
+	// ̓sNZƃTvƂɓƗɐAyC[hŌ㑱̃VF[_ɓn
+	uint rng = InitRandomState(DispatchRaysIndex().xy, cbScene.loopCount);
+	float2 offset;
+	offset.x = NextRandom(rng);
+	offset.y = NextRandom(rng);
 
 	// sNZSWNbvԍWɕϊ
 	uint2 index = DispatchRaysIndex().xy;
@@ -330,12 +333,14 @@ void RayGenerator()
 	for (uint i = 0; i < cbScene.maxBounces; ++i)
 	{
 		// }eAɑ΂郌Cg
+		payload.rng_state = rng;
 		TraceRay(Scene, RAY_FLAG_CULL_BACK_FACING_TRIANGLES, ~0, 0, 2, 0, ray, payload);
+		rng = payload.rng_state;
 
 		if (payload.is_hit)
 		{
 			// VhEvZp̃Cg
-			float rnd = GetRandom();
+			float rnd = NextRandom(rng);
 			uint i = (cbScene.loopCount + uint(rnd * MaxSample)) % MaxSample;
 			float2 ham = Hammersley2D(i, MaxSample);
 			float3 localDir = HemisphereSampleCos(ham.x * 1e-4, ham.y);
@@ -397,7 +402,7 @@ void ClosestHitProcessor(inout HitData payload : SV_RayPayload, in BuiltInTriang
 	normal = normalize(normalWS);
 
 	float minT = RayTCurrent();
-	float rnd = GetRandom();
+	float rnd = NextRandom(payload.rng_state);
 	uint i = (cbScene.loopCount + uint(rnd * MaxSample)) % MaxSample;
 	float2 ham = Hammersley2D(i, MaxSample);
 	float3 localDir = HemisphereSampleUniform(ham.x, ham.y);
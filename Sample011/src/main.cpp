@@ -1,5 +1,4 @@
 #include <vector>
-#include <random>
 
 #include "sl12/application.h"
 #include "sl12/command_list.h"
@@ -115,9 +114,7 @@ public:
 		// [gVOl`̏
 		{
 			D3D12_DESCRIPTOR_RANGE ranges[] = {
-				{ D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },		// RandomTable
 				{ D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },		// RenderTarget
-				{ D3D12_DESCRIPTOR_RANGE_TYPE_UAV, 1, 1, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },		// RandomSeed
 				{ D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND },		// cbScene
 			};
 
@@ -275,36 +272,6 @@ public:
 			}
 		}
 
-		// p̃obt@𐶐
-		{
-			if (!randomBuffer_.Initialize(&device_, sizeof(float) * 65536, sizeof(float), sl12::BufferUsage::ShaderResource, true, false))
-			{
-				return false;
-			}
-			if (!randomBufferSRV_.Initialize(&device_, &randomBuffer_, 0, sizeof(float)))
-			{
-				return false;
-			}
-			if (!seedBuffer_.Initialize(&device_, sizeof(uint32_t), 1, sl12::BufferUsage::ShaderResource, false, true))
-			{
-				return false;
-			}
-			if (!seedBufferUAV_.Initialize(&device_, &seedBuffer_))
-			{
-				return false;
-			}
-
-			auto p = reinterpret_cast<float*>(randomBuffer_.Map(nullptr));
-			std::random_device rd;
-			std::mt19937 mt(rd());
-			std::uniform_real_distribution<float> randGen01(0.0f, 1.0f);
-			for (int i = 0; i < 65536; i++)
-			{
-				p[i] = randGen01(mt);
-			}
-			randomBuffer_.Unmap();
-		}
-
 		// GUȈ
 		if (!gui_.Initialize(&device_, DXGI_FORMAT_R8G8B8A8_UNORM))
 		{
@@ -441,11 +408,9 @@ public:
 			d3dCmdList->SetComputeRootSignature(globalRootSig_.GetRootSignature());
 
 			// O[oݒ̃VF[_\[Xݒ肷
-			d3dCmdList->SetComputeRootDescriptorTable(0, randomBufferSRV_.GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootDescriptorTable(1, resultTextureUAV_.GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootDescriptorTable(2, seedBufferUAV_.GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootDescriptorTable(3, sceneCBVs_[frameIndex].GetDesc()->GetGpuHandle());
-			d3dCmdList->SetComputeRootShaderResourceView(4, topAS_.GetDxrBuffer().GetResourceDep()->GetGPUVirtualAddress());
+			d3dCmdList->SetComputeRootDescriptorTable(0, resultTextureUAV_.GetDesc()->GetGpuHandle());
+			d3dCmdList->SetComputeRootDescriptorTable(1, sceneCBVs_[frameIndex].GetDesc()->GetGpuHandle());
+			d3dCmdList->SetComputeRootShaderResourceView(2, topAS_.GetDxrBuffer().GetResourceDep()->GetGPUVirtualAddress());
 
 			// Cg[Xs
 			D3D12_DISPATCH_RAYS_DESC desc{};
@@ -461,7 +426,7 @@ public:
 			desc.Height = kScreenHeight;
 			desc.Depth = 1;
 			dxrCmdList->SetPipelineState1(stateObject_.GetPSO());
-			dxrCmdList->DispatchRays(&desc);
+			cmdList.DispatchRays(&desc);
 
 			cmdList.UAVBarrier(&resultTexture_);
 		}
@@ -544,11 +509,6 @@ public:
 		instanceSB_.Destroy();
 		spheresAABB_.Destroy();
 
-		randomBufferSRV_.Destroy();
-		randomBuffer_.Destroy();
-		seedBufferUAV_.Destroy();
-		seedBuffer_.Destroy();
-
 		resultTextureUAV_.Destroy();
 		resultTextureRTV_.Destroy();
 		resultTextureSRV_.Destroy();
@@ -653,9 +613,9 @@ private:
 		// VF[_RtBOTuIuWFNg
 		// qbgVF[_A~XVF[_̈ƂȂPayload, IntersectionAttributes̍őTCYݒ肵܂.
 #if 0
-		dxrDesc.AddShaderConfig(sizeof(float) * 4 + sizeof(sl12::u32) + sizeof(float), sizeof(float) * 2);
+		dxrDesc.AddShaderConfig(sizeof(float) * 4 + sizeof(sl12::u32) + sizeof(float) + sizeof(sl12::u32), sizeof(float) * 2);
 #else
-		dxrDesc.AddShaderConfig(sizeof(float) * 4 + sizeof(float) * 3 * 3 + sizeof(sl12::u32), sizeof(float) * 2);
+		dxrDesc.AddShaderConfig(sizeof(float) * 4 + sizeof(float) * 3 * 3 + sizeof(sl12::u32) * 2, sizeof(float) * 2);
 #endif
 
 		// [J[gVOl`TuIuWFNg
@@ -969,11 +929,6 @@ private:
 	sl12::RenderTargetView		resultTextureRTV_;
 	sl12::UnorderedAccessView	resultTextureUAV_;
 
-	sl12::Buffer				randomBuffer_;
-	sl12::BufferView			randomBufferSRV_;
-	sl12::Buffer				seedBuffer_;
-	sl12::UnorderedAccessView	seedBufferUAV_;
-
 	sl12::GlbMesh			glbMesh_;
 	sl12::Sampler			imageSampler_;
 
@@ -709,7 +709,7 @@ public:
 			desc.Height = kScreenHeight;
 			desc.Depth = 1;
 			dxrCmdList->SetPipelineState1(stateObject_.GetPSO());
-			dxrCmdList->DispatchRays(&desc);
+			cmdList.DispatchRays(&desc);
 
 			cmdList.UAVBarrier(&resultTexture_);
 		}
@@ -850,7 +850,7 @@ public:
 			desc.Height = kScreenHeight;
 			desc.Depth = 1;
 			dxrCmdList->SetPipelineState1(shadowRaySystem_.stateObject.GetPSO());
-			dxrCmdList->DispatchRays(&desc);
+			cmdList.DispatchRays(&desc);
 
 			cmdList.UAVBarrier(&resultTexture_);
 		}
@@ -894,7 +894,7 @@ public:
 				d3dCmdList->SetComputeRootDescriptorTable(3, vcolor.colorUAV.GetDesc()->GetGpuHandle());
 
 				desc.Width = submesh->GetVerticesCount();
-				dxrCmdList->DispatchRays(&desc);
+				cmdList.DispatchRays(&desc);
 			}
 			for (int i = 0; i < glbMesh_.GetSubmeshCount(); i++)
 			{
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief バリアの発行先
+	 *
+	 * BarrierBatch はこのインターフェースにのみバリアを渡すので、
+	 * 差し替えればコマンドリストなしで動作を確認できる
+	*****************************************************/
+	class BarrierSink
+	{
+	public:
+		virtual ~BarrierSink()
+		{}
+
+		virtual void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) = 0;
+	};	// class BarrierSink
+
+	/*************************************************//**
+	 * @brief リソースバリアをまとめて発行するためのバッファ
+	 *
+	 * Flush までに積まれたバリアは1回の ResourceBarrier で発行する.\n
+	 * 積む際に以下をまとめる.
+	 * - 同じリソースへの連続した遷移 (A→B, B→C は A→C に、A→B→A は消去)
+	 * - 重複したUAVバリア、遷移の直後のUAVバリア
+	 *
+	 * 積まれたバリアの間にはGPUの処理が入らない前提なので、
+	 * 描画やディスパッチの前には必ず Flush すること.\n
+	 * CommandList は描画、ディスパッチ、コピーとネイティブのコマンドリストの取得の前に Flush する.
+	*****************************************************/
+	class BarrierBatch
+	{
+	public:
+		BarrierBatch()
+		{}
+		~BarrierBatch()
+		{}
+
+		/**
+		 * @brief 遷移バリアを積む
+		*/
+		void Transition(ID3D12Resource* pResource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
+		/**
+		 * @brief UAVバリアを積む
+		 *
+		 * pResource が nullptr の場合はすべてのUAVアクセスが対象
+		*/
+		void UAV(ID3D12Resource* pResource);
+
+		/**
+		 * @brief エイリアシングバリアを積む
+		 *
+		 * pBefore が nullptr の場合は、同じメモリを使用していたすべてのリソースが対象
+		*/
+		void Aliasing(ID3D12Resource* pBefore, ID3D12Resource* pAfter);
+
+		/**
+		 * @brief 分割バリアを開始する
+		 *
+		 * BEGIN_ONLY のバリアを積み、対応する EndSplit まで遷移を保留する.\n
+		 * 開始から終了までの間に他のパスの処理を挟むことで、遷移のコストを隠すことができる.
+		*/
+		void BeginSplit(ID3D12Resource* pResource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after);
+
+		/**
+		 * @brief 分割バリアを終了する
+		 *
+		 * @return 開始されていない場合は false
+		*/
+		bool EndSplit(ID3D12Resource* pResource, UINT subresource);
+
+		/**
+		 * @brief 積まれたバリアを発行する
+		*/
+		void Flush(BarrierSink& sink);
+
+		/**
+		 * @brief 積まれたバリアと分割バリアの状態を破棄する
+		*/
+		void Clear();
+
+		// getter
+		bool IsEmpty() const { return pending_.empty(); }
+		size_t GetPendingCount() const { return pending_.size(); }
+		size_t GetOpenSplitCount() const { return splits_.size(); }
+		const std::vector<D3D12_RESOURCE_BARRIER>& GetPendingBarriers() const { return pending_; }
+
+	private:
+		struct Split
+		{
+			ID3D12Resource*			pResource;
+			UINT					subresource;
+			D3D12_RESOURCE_STATES	before;
+			D3D12_RESOURCE_STATES	after;
+		};	// struct Split
+
+		int FindLastReference(ID3D12Resource* pResource) const;
+		void PushTransition(ID3D12Resource* pResource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after, D3D12_RESOURCE_BARRIER_FLAGS flags);
+
+	private:
+		std::vector<D3D12_RESOURCE_BARRIER>	pending_;
+		std::vector<Split>					splits_;
+	};	// class BarrierBatch
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,120 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <sl12/crc.h>
+#include <string>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief バインドするリソースの名前
+	 *
+	 * 名前のハッシュを生成時に計算する.\n
+	 * constexpr で定義しておけばハッシュはコンパイル時に計算される.
+	*****************************************************/
+	struct BindingName
+	{
+		const char*		name;
+		u32				hash;
+
+		constexpr BindingName(const char* n)
+			: name(n), hash(CalcFnv1a32(n))
+		{}
+	};	// struct BindingName
+
+	/*************************************************//**
+	 * @brief 解決済みのバインドスロット
+	 *
+	 * RootSignatureHandle::FindSlot で取得し、同じルートシグネチャに対してのみ使用できる.\n
+	 * 毎フレーム設定するリソースはこれを保持しておくことで名前の検索を省略できる.
+	*****************************************************/
+	struct BindingSlot
+	{
+		static const u32 kInvalidIndex = 0xffffffff;
+
+		u32		index = kInvalidIndex;
+
+		BindingSlot()
+		{}
+		explicit BindingSlot(u32 i)
+			: index(i)
+		{}
+
+		bool IsValid() const
+		{
+			return index != kInvalidIndex;
+		}
+	};	// struct BindingSlot
+
+	/*************************************************//**
+	 * @brief 名前からバインド先を引くテーブル
+	 *
+	 * 名前は FNV-1a ハッシュ順に並べ、そのインデックスをスロット番号とする.\n
+	 * 同じハッシュの名前が複数ある場合は文字列で区別する.
+	*****************************************************/
+	class BindingTable
+	{
+	public:
+		// バインド先のテーブルとテーブル内の位置
+		struct Target
+		{
+			u32		rootIndex;
+			u32		offsetInTable;
+		};	// struct Target
+
+	public:
+		/**
+		 * @brief 名前とバインド先を追加する
+		 *
+		 * すべて追加した後に Finalize を呼ぶこと
+		*/
+		void Add(const std::string& name, const Target* pTargets, u32 numTargets);
+
+		/**
+		 * @brief 名前をハッシュ順に並べてスロット番号を確定する
+		 *
+		 * 同じハッシュの名前は追加した順に並ぶ
+		*/
+		void Finalize();
+
+		/**
+		 * @brief 名前からバインドスロットを検索する
+		 *
+		 * 見つからない場合は無効なスロットを返す
+		*/
+		BindingSlot Find(const BindingName& name) const;
+
+		/**
+		 * @brief スロットのバインド先を取得する
+		*/
+		const Target* GetTargets(BindingSlot slot, u32* pNumTargets) const
+		{
+			auto&& binding = bindings_[slot.index];
+			*pNumTargets = binding.numTargets;
+			return targets_.data() + binding.firstTarget;
+		}
+
+		u32 GetNumSlots() const
+		{
+			return static_cast<u32>(bindings_.size());
+		}
+
+	private:
+		struct Binding
+		{
+			std::string		name;
+			u32				nameHash;
+			u32				firstTarget;		// targets_ の開始位置
+			u32				numTargets;
+		};	// struct Binding
+
+		std::vector<Binding>	bindings_;		// 名前のハッシュ順. インデックスがスロット番号
+		std::vector<Target>		targets_;
+	};	// class BindingTable
+
+}	// namespace sl12
+
+
+//	EOF
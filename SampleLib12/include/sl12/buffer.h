@@ -1,12 +1,14 @@
 ﻿#pragma once
 
 #include <sl12/util.h>
+#include <functional>
 
 
 namespace sl12
 {
 	class Device;
 	class CommandList;
+	class UploadManager;
 
 	struct BufferUsage
 	{
@@ -24,6 +26,10 @@ namespace sl12
 	class Buffer
 	{
 		friend class CommandList;
+		friend class UploadManager;
+
+	public:
+		typedef std::function<void(void*)>	FillFunc;
 
 	public:
 		Buffer()
@@ -38,6 +44,15 @@ namespace sl12
 		void Destroy();
 
 		void UpdateBuffer(Device* pDev, CommandList* pCmdList, const void* pData, size_t size, size_t offset = 0);
+		bool UpdateBuffer(UploadManager* pUploader, const void* pData, size_t size, size_t offset = 0);
+
+		/**
+		 * @brief アップロード用のメモリに直接書き込んで更新する
+		 *
+		 * func には size バイトの書き込み先が渡される. 中間のメモリを経由しないので、大きなバッファの初期化に使用する.\n
+		 * 書き込み先はライトコンバインメモリの場合があるので、読み出さないこと.
+		*/
+		void FillBuffer(Device* pDev, CommandList* pCmdList, size_t size, size_t offset, const FillFunc& func);
 
 		void* Map(CommandList*);
 		void Unmap();
@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <sl12/util.h>
+#include <sl12/barrier_batch.h>
 
 
 namespace sl12
@@ -38,17 +39,75 @@ namespace sl12
 		void UAVBarrier(Texture* p);
 		void UAVBarrier(Buffer* p);
 
+		// pBefore が nullptr の場合は同じメモリを使用していたすべてのリソースが対象
+		void AliasingBarrier(Texture* pBefore, Texture* pAfter);
+
+		/**
+		 * @brief 分割バリアを開始/終了する
+		 *
+		 * Begin から End までの間に別のパスを挟むと、遷移をその処理と並行させることができる.\n
+		 * 管理しているステートは Begin の時点で遷移後のものになる.
+		*/
+		void BeginSplitBarrier(Texture* p, D3D12_RESOURCE_STATES nextState);
+		void BeginSplitBarrier(Buffer* p, D3D12_RESOURCE_STATES nextState);
+		void EndSplitBarrier(Texture* p);
+		void EndSplitBarrier(Buffer* p);
+
+		/**
+		 * @brief バリアを遅延発行するか設定する
+		 *
+		 * 有効にするとバリアは次の描画、ディスパッチ、コピーの直前か FlushBarriers を呼ぶまで発行されず、まとめて1回で発行される.\n
+		 * 無効な場合も、BeginBarrierBatch から EndBarrierBatch までのバリアはまとめて発行する.
+		*/
+		void SetDeferredBarriers(bool enable);
+		void FlushBarriers();
+		void BeginBarrierBatch();
+		void EndBarrierBatch();
+
+		/**
+		 * @brief 積まれたバリアを発行してから描画、ディスパッチ、コピーを記録する
+		*/
+		void DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation);
+		void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation);
+		void Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ);
+		void DispatchRays(const D3D12_DISPATCH_RAYS_DESC* pDesc);
+		void CopyResource(ID3D12Resource* pDstResource, ID3D12Resource* pSrcResource);
+		void CopyBufferRegion(ID3D12Resource* pDstBuffer, UINT64 dstOffset, ID3D12Resource* pSrcBuffer, UINT64 srcOffset, UINT64 numBytes);
+		void CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* pDst, UINT dstX, UINT dstY, UINT dstZ, const D3D12_TEXTURE_COPY_LOCATION* pSrc, const D3D12_BOX* pSrcBox);
+
 		// getter
 		CommandQueue* GetParentQueue() { return pParentQueue_; }
 		ID3D12CommandAllocator* GetCommandAllocator() { return pCmdAllocator_; }
-		ID3D12GraphicsCommandList* GetCommandList() { return pCmdList_; };
-		ID3D12GraphicsCommandList4* GetDxrCommandList() { return pDxrCmdList_; };
+
+		/**
+		 * @brief ネイティブのコマンドリストを取得する
+		 *
+		 * 取得したコマンドリストに直接記録する処理の前にバリアが発行されるよう、積まれたバリアを発行してから返す.\n
+		 * 取得したポインタを保持したまま遅延バリアを積んだ場合は、記録の前に FlushBarriers を呼び出すこと.
+		*/
+		ID3D12GraphicsCommandList* GetCommandList()
+		{
+			FlushBarriers();
+			return pCmdList_;
+		}
+		ID3D12GraphicsCommandList4* GetDxrCommandList()
+		{
+			FlushBarriers();
+			return pDxrCmdList_;
+		}
+
+	private:
+		void FlushBarriersIfImmediate();
 
 	private:
 		CommandQueue*				pParentQueue_{ nullptr };
 		ID3D12CommandAllocator*		pCmdAllocator_{ nullptr };
 		ID3D12GraphicsCommandList*	pCmdList_{ nullptr };
 		ID3D12GraphicsCommandList4*	pDxrCmdList_{ nullptr };
+
+		BarrierBatch				barrierBatch_;
+		u32							barrierBatchDepth_{ 0 };
+		bool						isBarrierDeferred_{ false };
 	};	// class CommandList
 
 }	// namespace sl12
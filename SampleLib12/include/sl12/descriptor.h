@@ -23,17 +23,21 @@ namespace sl12
 
 		void Release();
 
+		// コピー元のハンドルに書き込んだ内容をシェーダから参照されるハンドルに反映する
+		void Commit();
+
 		// getter
 		D3D12_CPU_DESCRIPTOR_HANDLE	GetCpuHandle() { return cpuHandle_; }
 		D3D12_GPU_DESCRIPTOR_HANDLE	GetGpuHandle() { return gpuHandle_; }
+		// シェーダから参照されないヒープ上のハンドル. CopyDescriptors のコピー元に使用できる
+		D3D12_CPU_DESCRIPTOR_HANDLE	GetCpuCopySourceHandle() { return cpuCopySourceHandle_; }
 		u32 GetIndex() const { return index_; }
 
 	private:
 		DescriptorHeap*				pParentHeap_{ nullptr };
-		Descriptor*					pPrev_{ nullptr };
-		Descriptor*					pNext_{ nullptr };
 		D3D12_CPU_DESCRIPTOR_HANDLE	cpuHandle_{ 0 };
 		D3D12_GPU_DESCRIPTOR_HANDLE	gpuHandle_{ 0 };
+		D3D12_CPU_DESCRIPTOR_HANDLE	cpuCopySourceHandle_{ 0 };
 		u32							index_{ 0 };
 	};	// class Descriptor
 
@@ -0,0 +1,169 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief デスクリプタのインデックスを管理するアロケータ
+	 *
+	 * D3D12 のオブジェクトには触れず、ヒープ内のインデックスのみを扱う.\n
+	 * 1つずつの確保は、スレッドごとのキャッシュ(マガジン)とロックフリーのスタックで行う.\n
+	 * 連続領域はヒープの末尾から確保し、単体の確保は先頭から進めるので、両者は互いに向かって伸びる.\n
+	 * キャッシュへの補充はヒープの大きさに応じて制限し、空きがなくなった場合は
+	 * 他のスレッドのキャッシュを共有スタックに戻してから失敗とする.\n
+	 * 一時領域は連続領域の1つをリングバッファとして使用し、フェンス値でまとめて解放する.
+	*****************************************************/
+	class DescriptorIndexAllocator
+	{
+	public:
+		static const u32	kInvalidIndex = 0xffffffff;
+		static const u32	kMaxThreadCaches = 32;		//!< これを超えるスレッドはキャッシュを使わずにスタックを直接使用する
+		static const u32	kMagazineSize = 31;
+		static const u32	kMaxTransientMarks = 16;
+
+	public:
+		DescriptorIndexAllocator()
+		{}
+		~DescriptorIndexAllocator()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		 *
+		 * 初期化と破棄はスレッドセーフではない
+		*/
+		bool Initialize(u32 numDescriptors);
+		void Destroy();
+
+		/**
+		 * @brief 1つ確保する
+		 *
+		 * 任意のスレッドから呼び出せる
+		 * @return 確保できない場合は kInvalidIndex
+		*/
+		u32 Allocate();
+
+		/**
+		 * @brief 1つ解放する
+		 *
+		 * 任意のスレッドから呼び出せる.\n
+		 * 解放したデスクリプタは呼び出したスレッドのキャッシュに入る.
+		*/
+		void Release(u32 index);
+
+		/**
+		 * @brief 呼び出したスレッドのキャッシュを共有スタックに戻す
+		 *
+		 * 終了するスレッドのキャッシュは他のスレッドから使用できないので、
+		 * ロード用のスレッドなどは終了前に呼び出すこと
+		*/
+		void FlushThreadCache();
+
+		/**
+		 * @brief 連続領域を確保する
+		 *
+		 * 任意のスレッドから呼び出せるが、内部でロックするので頻繁な呼び出しには向かない
+		*/
+		bool AllocateRange(u32 count, u32* pBaseIndex);
+		void ReleaseRange(u32 baseIndex, u32 count);
+
+		/**
+		 * @brief 一時領域を用意する
+		 *
+		 * 連続領域を1つ確保して一時領域のリングバッファとする
+		*/
+		bool ReserveTransientRegion(u32 count);
+
+		/**
+		 * @brief 一時領域から連続したデスクリプタを確保する
+		 *
+		 * 任意のスレッドから呼び出せる.\n
+		 * 確保した領域は個別に解放せず、RetireTransient でフレーム単位に解放する.
+		*/
+		bool AllocateTransient(u32 count, u32* pBaseIndex);
+
+		/**
+		 * @brief ここまでに確保した一時領域にフェンス値を関連付ける
+		 *
+		 * コマンドを発行したスレッドから、発行時のフェンス値を渡して呼び出す
+		*/
+		bool MarkTransient(u64 fenceValue);
+
+		/**
+		 * @brief 完了したフェンス値までの一時領域を解放する
+		 *
+		 * MarkTransient と同じスレッドから呼び出すこと
+		*/
+		void RetireTransient(u64 completedFenceValue);
+
+		// getter
+		u32 GetNumDescriptors() const { return numDescriptors_; }
+		u32 GetTransientCapacity() const { return transientCount_; }
+
+	private:
+		// スレッドごとのキャッシュ
+		// 所有するスレッドと、空きがなくなった際に回収するスレッドだけが lock を取って触れる
+		struct Magazine
+		{
+			std::atomic<u32>	lock;
+			u32					count;
+			u32					indices[kMagazineSize];
+		};	// struct Magazine
+
+		struct RangeBlock
+		{
+			u32		base;
+			u32		count;
+		};	// struct RangeBlock
+
+		struct TransientMark
+		{
+			u64		fenceValue;
+			u64		head;
+		};	// struct TransientMark
+
+		static u32 GetThreadCacheSlot();
+
+		u32 PopStack();
+		void PushStack(u32 first, u32 last);
+		u32 AllocateFromBounds();
+		void FlushMagazine(Magazine& mag);
+		u32 AllocateAfterDrain();
+
+	private:
+		u32						numDescriptors_ = 0;
+
+		// 解放されたデスクリプタのスタック. 下位32bitが先頭のインデックス、上位32bitがABA対策のタグ
+		std::atomic<u64>		stackHead_;
+		std::atomic<u32>*		pStackNext_ = nullptr;
+
+		// 下位32bitが単体確保の未使用開始位置、上位32bitが連続領域の使用開始位置
+		std::atomic<u64>		bounds_;
+
+		Magazine*				pMagazines_ = nullptr;
+		u32						refillCount_ = 0;
+
+		std::mutex				rangeMutex_;
+		std::vector<RangeBlock>	freeRanges_;		// base の昇順
+
+		// 一時領域. head と tail は折り返さずに増え続ける位置で、剰余を取って使用する
+		u32						transientBase_ = 0;
+		u32						transientCount_ = 0;
+		std::atomic<u64>		transientHead_;
+		std::atomic<u64>		transientTail_;
+		TransientMark			transientMarks_[kMaxTransientMarks];
+		u32						transientMarkTop_ = 0;
+		u32						transientMarkNum_ = 0;
+	};	// class DescriptorIndexAllocator
+
+}	// namespace sl12
+
+
+//	EOF
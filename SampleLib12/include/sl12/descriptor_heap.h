@@ -1,6 +1,7 @@
 ﻿#pragma once
 
 #include <sl12/util.h>
+#include <sl12/descriptor_allocator.h>
 
 
 namespace sl12
@@ -21,20 +22,71 @@ namespace sl12
 		bool Initialize(Device* pDev, const D3D12_DESCRIPTOR_HEAP_DESC& desc);
 		void Destroy();
 
+		/**
+		 * @brief デスクリプタを1つ生成する
+		 *
+		 * 生成と解放は任意のスレッドから呼び出せる
+		*/
 		Descriptor* CreateDescriptor();
 		void ReleaseDescriptor(Descriptor* p);
 
+		/**
+		 * @brief 呼び出したスレッドがキャッシュしているデスクリプタをヒープに戻す
+		 *
+		 * ビューを生成・破棄したロード用のスレッドは終了前に呼び出すこと
+		*/
+		void FlushThreadCache();
+
+		/**
+		 * @brief コピー元ヒープの内容をシェーダから参照されるヒープに反映する
+		 *
+		 * シェーダから参照されるヒープはコピー元に使用できないので、
+		 * ビューはコピー元ヒープに生成してからこの関数で反映する
+		*/
+		void CommitDescriptor(Descriptor* p);
+
+		/**
+		 * @brief 連続したデスクリプタ領域を確保する
+		 *
+		 * 確保した領域は CreateDescriptor で返されなくなる.\n
+		 * 内部でロックするので、テーブル用の領域など頻繁に確保しないものに使用する.
+		*/
+		bool AllocateRange(u32 count, u32* pBaseIndex);
+		void ReleaseRange(u32 baseIndex, u32 count);
+
+		/**
+		 * @brief 一時デスクリプタ用の領域を用意する
+		 *
+		 * 一時デスクリプタを使用する前に1度だけ呼び出す
+		*/
+		bool ReserveTransientRegion(u32 count);
+
+		/**
+		 * @brief 一時デスクリプタの連続領域を確保する
+		 *
+		 * 任意のスレッドから呼び出せる.\n
+		 * 確保した領域は MarkTransient で渡したフェンス値が完了し、RetireTransient が呼ばれるまで有効.
+		*/
+		bool AllocateTransient(u32 count, u32* pBaseIndex);
+		bool MarkTransient(u64 fenceValue);
+		void RetireTransient(u64 completedFenceValue);
+
 		// getter
 		ID3D12DescriptorHeap* GetHeap() { return pHeap_; }
+		D3D12_DESCRIPTOR_HEAP_TYPE GetType() const { return heapDesc_.Type; }
+		u32 GetDescriptorSize() const { return descSize_; }
+		bool IsShaderVisible() const { return (heapDesc_.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) != 0; }
+		D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(u32 index) const;
+		D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(u32 index) const;
 
 	private:
+		ID3D12Device*				pDevice_{ nullptr };
 		ID3D12DescriptorHeap*		pHeap_{ nullptr };
+		ID3D12DescriptorHeap*		pCopySourceHeap_{ nullptr };
 		Descriptor*					pDescriptors_{ nullptr };
-		//Descriptor*					pUsedList_{ nullptr };
-		Descriptor*					pUnusedList_{ nullptr };
+		DescriptorIndexAllocator	allocator_;
 		D3D12_DESCRIPTOR_HEAP_DESC	heapDesc_{};
 		uint32_t					descSize_{ 0 };
-		uint32_t					take_num_{ 0 };
 	};	// class DescriptorHeap
 
 }	// namespace sl12
@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+
+
+namespace sl12
+{
+	class Device;
+	class DescriptorHeap;
+
+	/*************************************************//**
+	 * @brief 一時デスクリプタのステージング領域
+	 *
+	 * シェーダから参照されるヒープの一部をフレーム数分に分割して確保し、
+	 * 描画ごとのデスクリプタを連続した領域にコピーしてテーブルとして使用する.\n
+	 * フレームの領域は BeginFrame でまとめてリセットされるので、
+	 * 同じフレームインデックスを使用したコマンドのGPU完了は呼び出し側で保証すること.
+	*****************************************************/
+	class DescriptorStaging
+	{
+	public:
+		DescriptorStaging()
+		{}
+		~DescriptorStaging()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		 *
+		 * @param[in]	type			D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV または D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER
+		 * @param[in]	numPerFrame		1フレームで使用できるデスクリプタ数
+		 * @param[in]	numFrames		フレーム数
+		*/
+		bool Initialize(Device* pDev, D3D12_DESCRIPTOR_HEAP_TYPE type, u32 numPerFrame, u32 numFrames);
+		void Destroy();
+
+		/**
+		 * @brief フレームを開始する
+		 *
+		 * frameIndex の領域を先頭から使い直す
+		*/
+		void BeginFrame(u32 frameIndex);
+
+		/**
+		 * @brief デスクリプタを連続した領域にコピーする
+		 *
+		 * @param[in]	pSrcHandles		コピー元ヒープのハンドル. すべて設定済みであること (ptr が 0 の要素はアサート)
+		 * @param[in]	count			デスクリプタ数
+		 * @param[out]	pOut			コピー先の先頭のGPUハンドル
+		 * @return 領域が足りない場合は false
+		*/
+		bool Stage(const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcHandles, u32 count, D3D12_GPU_DESCRIPTOR_HANDLE* pOut);
+
+		//! @name 取得関数
+		//! @{
+		D3D12_DESCRIPTOR_HEAP_TYPE GetType() const
+		{
+			return type_;
+		}
+		u32 GetUsedCount() const
+		{
+			return usedCount_;
+		}
+		u32 GetCapacityPerFrame() const
+		{
+			return numPerFrame_;
+		}
+		//! @}
+
+	private:
+		ID3D12Device*				pDevice_ = nullptr;
+		DescriptorHeap*				pHeap_ = nullptr;
+		D3D12_DESCRIPTOR_HEAP_TYPE	type_ = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+		u32							baseIndex_ = 0;
+		u32							numPerFrame_ = 0;
+		u32							numFrames_ = 0;
+		u32							frameBase_ = 0;
+		u32							usedCount_ = 0;
+	};	// class DescriptorStaging
+
+}	// namespace sl12
+
+
+//	EOF
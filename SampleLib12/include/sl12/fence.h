@@ -27,6 +27,7 @@ namespace sl12
 		void WaitSignal();
 		void WaitSignal(u32 value);
 		void WaitSignal(CommandQueue* pQueue);
+		void WaitSignal(CommandQueue* pQueue, u32 value);
 
 		bool CheckSignal();
 
@@ -0,0 +1,272 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief 1次元の複素 FFT
+	 *
+	 * 実部と虚部は別々の配列に持つ.\n
+	 * 2のべき乗の長さは基数 8/4/2 の Stockham 法で計算し、それ以外の長さは Bluestein 法で2のべき乗の FFT に帰着する.\n
+	 * 回転因子は Initialize で倍精度で計算してテーブルに持つ.\n
+	 * 順変換は X[k] = Σ x[n] exp(-2πi nk/N)、逆変換は 1/N を掛ける (fft.hlsl と同じ).\n
+	 * 変換関数は作業領域を呼び出し側から受け取るので、同じプランを複数のスレッドで同時に使用できる.
+	*****************************************************/
+	class FFTPlan
+	{
+	public:
+		FFTPlan()
+		{}
+		~FFTPlan()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		 *
+		 * @param[in]	length	変換する長さ. 1以上の任意の値
+		*/
+		bool Initialize(u32 length);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief 順変換する
+		 *
+		 * @param[in,out]	pRe, pIm	GetLength() 要素
+		 * @param[in]		pWork		GetWorkSize() 要素の作業領域
+		*/
+		void Forward(float* pRe, float* pIm, float* pWork) const;
+
+		/**
+		 * @brief 逆変換する
+		*/
+		void Inverse(float* pRe, float* pIm, float* pWork) const;
+
+		/**
+		 * @brief 正規化しない順変換
+		 *
+		 * 実部と虚部を入れ替えて渡すと、正規化しない逆変換になる.
+		*/
+		void Execute(float* pRe, float* pIm, float* pWork) const;
+
+		//! @name 取得関数
+		//! @{
+		u32 GetLength() const
+		{
+			return length_;
+		}
+		bool IsBluestein() const
+		{
+			return pInner_ != nullptr;
+		}
+		//! 作業領域の float の要素数
+		size_t GetWorkSize() const
+		{
+			return workSize_;
+		}
+		//! @}
+
+	private:
+		struct Stage
+		{
+			u32		radix;
+			u32		length;				//!< このステージで分割する長さ
+			u32		stride;				//!< 同じ列の要素の間隔
+			u32		twiddleOffset;		//!< (radix - 1) x (length / radix) 個
+		};	// struct Stage
+
+		void ExecuteStockham(float* pRe, float* pIm, float* pWork) const;
+		void ExecuteBluestein(float* pRe, float* pIm, float* pWork) const;
+
+	private:
+		u32					length_ = 0;
+		size_t				workSize_ = 0;
+
+		std::vector<Stage>	stages_;
+		std::vector<float>	twiddleRe_, twiddleIm_;
+
+		// Bluestein 法
+		std::unique_ptr<FFTPlan>	pInner_;				//!< 2のべき乗の FFT
+		std::vector<float>			chirpRe_, chirpIm_;		//!< exp(-πi n^2/N)
+		std::vector<float>			filterRe_, filterIm_;	//!< 共役チャープの FFT. 1/M を掛けておく
+	};	// class FFTPlan
+
+	/*************************************************//**
+	 * @brief 実数入力の FFT
+	 *
+	 * 長さが偶数の場合は偶数番目と奇数番目の要素を実部と虚部に詰めて、半分の長さの複素 FFT で計算する.\n
+	 * 実数のスペクトルはエルミート対称なので、先頭の GetSpectrumLength() = N/2+1 要素だけを扱う.
+	*****************************************************/
+	class RealFFTPlan
+	{
+	public:
+		RealFFTPlan()
+		{}
+		~RealFFTPlan()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		*/
+		bool Initialize(u32 length);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief 順変換する
+		 *
+		 * @param[in]	pSrc		GetLength() 要素
+		 * @param[out]	pRe, pIm	GetSpectrumLength() 要素
+		*/
+		void Forward(const float* pSrc, float* pRe, float* pIm, float* pWork) const;
+
+		/**
+		 * @brief 逆変換する
+		 *
+		 * 直流とナイキスト周波数の虚部は無視する.
+		 *
+		 * @param[out]	pDst	GetLength() 要素
+		*/
+		void Inverse(const float* pRe, const float* pIm, float* pDst, float* pWork) const;
+
+		//! @name 取得関数
+		//! @{
+		u32 GetLength() const
+		{
+			return length_;
+		}
+		u32 GetSpectrumLength() const
+		{
+			return length_ / 2 + 1;
+		}
+		size_t GetWorkSize() const
+		{
+			return workSize_;
+		}
+		//! @}
+
+	private:
+		u32					length_ = 0;
+		size_t				workSize_ = 0;
+		FFTPlan				plan_;						//!< 偶数なら length / 2、奇数なら length
+		std::vector<float>	twiddleRe_, twiddleIm_;		//!< exp(-2πi k/N). k = [0, N/2]
+	};	// class RealFFTPlan
+
+	/*************************************************//**
+	 * @brief 2次元の FFT
+	 *
+	 * 行方向、列方向の順に1次元の FFT を行い、各方向の FFT は複数のスレッドで並列に行う.\n
+	 * 列方向はいくつかの列をまとめて連続したメモリにコピーしてから変換する.
+	*****************************************************/
+	class FFT2D
+	{
+	public:
+		FFT2D()
+		{}
+		~FFT2D()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		*/
+		bool Initialize(u32 width, u32 height);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief 複素数の順変換
+		 *
+		 * @param[in,out]	pRe, pIm	width x height 要素. 行優先
+		 * @param[in]		numThreads	使用するスレッド数. 0 の場合はハードウェアのスレッド数
+		*/
+		void Forward(float* pRe, float* pIm, u32 numThreads) const;
+
+		/**
+		 * @brief 複素数の逆変換
+		*/
+		void Inverse(float* pRe, float* pIm, u32 numThreads) const;
+
+		/**
+		 * @brief 実数の順変換
+		 *
+		 * 行方向に実数の FFT を行うので、列方向の FFT も約半分になる.\n
+		 * スペクトルの残りは X[y][x] = conj(X[(H-y)%H][W-x]) で求められる.
+		 *
+		 * @param[in]	pSrc		width x height 要素
+		 * @param[out]	pRe, pIm	GetSpectrumWidth() x height 要素
+		*/
+		void ForwardReal(const float* pSrc, float* pRe, float* pIm, u32 numThreads) const;
+
+		/**
+		 * @brief 実数の逆変換
+		 *
+		 * @param[in,out]	pRe, pIm	GetSpectrumWidth() x height 要素. 作業領域として上書きする
+		 * @param[out]		pDst		width x height 要素
+		*/
+		void InverseReal(float* pRe, float* pIm, float* pDst, u32 numThreads) const;
+
+		//! @name 取得関数
+		//! @{
+		u32 GetWidth() const
+		{
+			return rowPlan_.GetLength();
+		}
+		u32 GetHeight() const
+		{
+			return columnPlan_.GetLength();
+		}
+		u32 GetSpectrumWidth() const
+		{
+			return realRowPlan_.GetSpectrumLength();
+		}
+		//! @}
+
+	private:
+		void RowPass(float* pRe, float* pIm, bool isInverse, u32 numThreads) const;
+		void ColumnPass(float* pRe, float* pIm, u32 columnCount, bool isInverse, u32 numThreads) const;
+
+	private:
+		FFTPlan		rowPlan_;
+		FFTPlan		columnPlan_;
+		RealFFTPlan	realRowPlan_;
+	};	// class FFT2D
+
+	/**
+	 * @brief 倍精度の DFT
+	 *
+	 * 定義どおりに O(N^2) で計算する. FFT の精度の確認用.\n
+	 * 逆変換は 1/N を掛ける. 入力と出力は別の配列にすること.
+	*/
+	void ComputeReferenceDFT(const double* pSrcRe, const double* pSrcIm, double* pDstRe, double* pDstIm, u32 length, bool isInverse);
+
+	/**
+	 * @brief FFT の名目上の浮動小数点演算数
+	 *
+	 * 性能の比較に一般的に使われる 5 N log2(N) (実数入力は半分) を返す. 実際の演算数とは異なる.
+	*/
+	double GetFFTNominalFlops(u32 length, bool isReal);
+
+}	// namespace sl12
+
+
+//	EOF
@@ -3,6 +3,19 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#	ifndef NOMINMAX
+#		define NOMINMAX
+#	endif
+#	include <Windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
 
 
 namespace sl12
@@ -57,6 +70,136 @@ namespace sl12
 		uint64_t					size_{ 0 };
 	};	// File
 
+	/**
+	 * @brief メモリマップドファイル
+	 *
+	 * ファイル全体を読み取り専用でマップする.\n
+	 * ヒープへのコピーを行わないので、巨大なファイルでも開くコストは小さい.\n
+	 * GetData() で得られるポインタは Destroy() するまで有効.
+	*/
+	class MappedFile
+	{
+	public:
+		MappedFile()
+		{}
+		MappedFile(const char* filename)
+		{
+			Open(filename);
+		}
+		~MappedFile()
+		{
+			Destroy();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool Open(const char* filename)
+		{
+			Destroy();
+
+#if defined(_WIN32)
+			hFile_ = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (hFile_ == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(hFile_, &fileSize) || (fileSize.QuadPart == 0))
+			{
+				Destroy();
+				return false;
+			}
+
+			hMapping_ = CreateFileMappingA(hFile_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (hMapping_ == nullptr)
+			{
+				Destroy();
+				return false;
+			}
+
+			pData_ = MapViewOfFile(hMapping_, FILE_MAP_READ, 0, 0, 0);
+			if (pData_ == nullptr)
+			{
+				Destroy();
+				return false;
+			}
+			size_ = static_cast<uint64_t>(fileSize.QuadPart);
+#else
+			fd_ = open(filename, O_RDONLY);
+			if (fd_ < 0)
+			{
+				return false;
+			}
+
+			struct stat st;
+			if ((fstat(fd_, &st) != 0) || (st.st_size <= 0))
+			{
+				Destroy();
+				return false;
+			}
+
+			void* p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+			if (p == MAP_FAILED)
+			{
+				Destroy();
+				return false;
+			}
+			pData_ = p;
+			size_ = static_cast<uint64_t>(st.st_size);
+#endif
+			return true;
+		}
+
+		void Destroy()
+		{
+#if defined(_WIN32)
+			if (pData_)
+			{
+				UnmapViewOfFile(pData_);
+			}
+			if (hMapping_)
+			{
+				CloseHandle(hMapping_);
+				hMapping_ = nullptr;
+			}
+			if (hFile_ != INVALID_HANDLE_VALUE)
+			{
+				CloseHandle(hFile_);
+				hFile_ = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (pData_)
+			{
+				munmap(pData_, static_cast<size_t>(size_));
+			}
+			if (fd_ >= 0)
+			{
+				close(fd_);
+				fd_ = -1;
+			}
+#endif
+			pData_ = nullptr;
+			size_ = 0;
+		}
+
+		// getter
+		const void* GetData() const { return pData_; }
+		uint64_t GetSize() const { return size_; }
+		bool IsValid() const { return pData_ != nullptr; }
+
+	private:
+		void*		pData_{ nullptr };
+		uint64_t	size_{ 0 };
+#if defined(_WIN32)
+		HANDLE		hFile_{ INVALID_HANDLE_VALUE };
+		HANDLE		hMapping_{ nullptr };
+#else
+		int			fd_{ -1 };
+#endif
+	};	// MappedFile
+
 }	// namespace sl12
 
 
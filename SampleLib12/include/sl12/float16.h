@@ -0,0 +1,137 @@
+﻿#pragma once
+
+#include "types.h"
+#include <string.h>
+
+
+namespace sl12
+{
+	/**
+	 * @brief float を half に変換する (最近接偶数丸め)
+	 *
+	 * half で表現できない大きさの値は Inf になる.\n
+	 * NaN は仮数の上位ビットを残して quiet NaN にする. F16C の VCVTPS2PH と同じ結果になる.
+	*/
+	inline u16 FloatToHalf(float value)
+	{
+		u32 f;
+		memcpy(&f, &value, sizeof(f));
+		u32 sign = (f >> 16) & 0x8000;
+		u32 absf = f & 0x7fffffff;
+
+		if (absf >= 0x7f800000)
+		{
+			// Inf, NaN
+			return static_cast<u16>(sign | 0x7c00 | ((absf > 0x7f800000) ? (0x0200 | ((absf >> 13) & 0x03ff)) : 0));
+		}
+		if (absf >= 0x477ff000)
+		{
+			// half で表現できない値は Inf に丸める
+			return static_cast<u16>(sign | 0x7c00);
+		}
+		if (absf < 0x38800000)
+		{
+			// 非正規化数
+			if (absf < 0x33000000)
+			{
+				return static_cast<u16>(sign);
+			}
+			u32 mant = (absf & 0x007fffff) | 0x00800000;
+			u32 shift = 126 - (absf >> 23);
+			u32 h = mant >> shift;
+			u32 rem = mant & ((1u << shift) - 1);
+			u32 halfway = 1u << (shift - 1);
+			if (rem > halfway || (rem == halfway && (h & 0x1)))
+			{
+				++h;
+			}
+			return static_cast<u16>(sign | h);
+		}
+
+		// 仮数の繰り上がりは指数にそのまま伝播する
+		u32 h = ((absf - 0x38000000) >> 13);
+		u32 rem = absf & 0x1fff;
+		if (rem > 0x1000 || (rem == 0x1000 && (h & 0x1)))
+		{
+			++h;
+		}
+		return static_cast<u16>(sign | h);
+	}
+
+	/**
+	 * @brief half を float に変換する
+	 *
+	 * すべての値を誤差なく変換する. NaN は quiet NaN にする.
+	*/
+	inline float HalfToFloat(u16 value)
+	{
+		u32 sign = static_cast<u32>(value & 0x8000) << 16;
+		u32 expo = (value >> 10) & 0x1f;
+		u32 mant = value & 0x03ff;
+		u32 f;
+
+		if (expo == 0x1f)
+		{
+			f = sign | 0x7f800000 | (mant << 13) | ((mant != 0) ? 0x00400000 : 0);
+		}
+		else if (expo != 0)
+		{
+			f = sign | ((expo + 112) << 23) | (mant << 13);
+		}
+		else if (mant == 0)
+		{
+			f = sign;
+		}
+		else
+		{
+			// 非正規化数は正規化する
+			expo = 113;
+			while (!(mant & 0x0400))
+			{
+				mant <<= 1;
+				--expo;
+			}
+			f = sign | (expo << 23) | ((mant & 0x03ff) << 13);
+		}
+
+		float ret;
+		memcpy(&ret, &f, sizeof(ret));
+		return ret;
+	}
+
+	/**
+	 * @brief float の配列を half に変換する
+	 *
+	 * 結果は FloatToHalf と同じ.\n
+	 * 実行環境で使用できる最速の実装を初回呼び出し時に選択する.
+	 * x86 では F16C、ARMv8 では NEON の変換命令を使用する.
+	*/
+	void FloatToHalfArray(const float* pSrc, u16* pDst, size_t count);
+
+	/**
+	 * @brief half の配列を float に変換する
+	 *
+	 * 結果は HalfToFloat と同じ.
+	*/
+	void HalfToFloatArray(const u16* pSrc, float* pDst, size_t count);
+
+	//! @name 個別の実装
+	//! 結果の比較や計測用. 通常は上記の関数を使用すること
+	//! @{
+	void FloatToHalfArrayScalar(const float* pSrc, u16* pDst, size_t count);
+	void FloatToHalfArrayHardware(const float* pSrc, u16* pDst, size_t count);
+	void HalfToFloatArrayScalar(const u16* pSrc, float* pDst, size_t count);
+	void HalfToFloatArrayHardware(const u16* pSrc, float* pDst, size_t count);
+
+	/**
+	 * @brief half の変換命令が使用できるか
+	 *
+	 * false の場合、Hardware 版の関数は呼び出してはならない
+	*/
+	bool IsHardwareHalfSupported();
+	//! @}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <cstddef>
+#include <vector>
+
+
+namespace sl12
+{
+	struct GeometryAttribute
+	{
+		enum Type
+		{
+			Position,		//!< 頂点座標
+			Color,			//!< 三角形ごとの RGBA. A は1
+			Normal,			//!< 三角形ごとの単位ベクトル. W は0
+
+			Max
+		};
+	};	// struct GeometryAttribute
+
+	struct GeometryFormat
+	{
+		enum Type
+		{
+			Float32x3,		//!< DXGI_FORMAT_R32G32B32_FLOAT
+			Float32x4,		//!< DXGI_FORMAT_R32G32B32A32_FLOAT
+			Float16x4,		//!< DXGI_FORMAT_R16G16B16A16_FLOAT
+			Unorm8x4,		//!< DXGI_FORMAT_R8G8B8A8_UNORM
+			Snorm8x4,		//!< DXGI_FORMAT_R8G8B8A8_SNORM
+
+			Max
+		};
+	};	// struct GeometryFormat
+
+	/*************************************************//**
+	 * @brief 頂点要素の配置
+	*****************************************************/
+	struct GeometryVertexElement
+	{
+		GeometryAttribute::Type	attribute;
+		GeometryFormat::Type	format;
+		u32						offset;		//!< 頂点の先頭からのバイト数
+	};	// struct GeometryVertexElement
+
+	/*************************************************//**
+	 * @brief 三角形の属性
+	 *
+	 * 頂点フォーマットに変換する前の値.
+	*****************************************************/
+	struct GeneratedTriangle
+	{
+		float	position[3][3];
+		float	color[4];
+		float	normal[4];
+	};	// struct GeneratedTriangle
+
+	/*************************************************//**
+	 * @brief ランダムに散らばった三角形の頂点を生成する
+	 *
+	 * 三角形ごとの乱数は三角形番号とシードのハッシュ (PcgHash) から初期化するので、
+	 * 三角形は互いに独立していて、生成順やスレッド数によらず結果は同じになる.\n
+	 * 頂点フォーマットは要素の配列で指定し、三角形リストとして3頂点ずつ書き出す.\n
+	 * D3D12 には依存しないので、デバイスなしで結果を確認できる.
+	*****************************************************/
+	class GeometryGenerator
+	{
+	public:
+		struct Desc
+		{
+			u32		triangleCount = 0;
+			u32		seed = 0;
+			float	positionRange = 20.0f;		//!< 三角形の中心は [-positionRange, positionRange) の立方体に入る
+			float	triangleSize = 0.2f;		//!< 中心から頂点までの XY 方向の距離
+		};	// struct Desc
+
+	public:
+		GeometryGenerator()
+		{}
+		~GeometryGenerator()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		 *
+		 * 要素が頂点の範囲に収まらない場合は失敗する.
+		 *
+		 * @param[in]	pElements		頂点要素. 配列はコピーする
+		 * @param[in]	vertexStride	頂点のバイト数
+		*/
+		bool Initialize(const Desc& desc, const GeometryVertexElement* pElements, u32 numElements, u32 vertexStride);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief すべての三角形を生成する
+		 *
+		 * 三角形をチャンクに分けて並列に生成する. 書き込みはチャンク単位で先頭から順に行い、読み戻さないので、
+		 * Map したアップロードヒープ (ライトコンバインメモリ) に直接書き込んでよい.
+		 *
+		 * @param[out]	pDst		GetBufferSize() バイトの書き出し先
+		 * @param[in]	numThreads	使用するスレッド数. 0 の場合はハードウェアのスレッド数
+		*/
+		void Generate(void* pDst, u32 numThreads) const;
+
+		/**
+		 * @brief 一部の三角形を生成する
+		 *
+		 * @param[out]	pDst			firstTriangle 番目の三角形の先頭の頂点の書き出し先
+		*/
+		void GenerateRange(void* pDst, u32 firstTriangle, u32 triangleCount) const;
+
+		/**
+		 * @brief 三角形の属性を求める
+		 *
+		 * 頂点に書き出す値の元になる. 結果の確認用
+		*/
+		void GetTriangle(u32 index, GeneratedTriangle& out) const;
+
+		//! @name 取得関数
+		//! @{
+		const Desc& GetDesc() const
+		{
+			return desc_;
+		}
+		u32 GetVertexStride() const
+		{
+			return vertexStride_;
+		}
+		size_t GetBufferSize() const
+		{
+			return static_cast<size_t>(desc_.triangleCount) * 3 * vertexStride_;
+		}
+		//! @}
+
+	private:
+		Desc								desc_;
+		std::vector<GeometryVertexElement>	elements_;
+		u32									vertexStride_ = 0;
+	};	// class GeometryGenerator
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <sl12/swapchain.h>
+#include <sl12/timestamp.h>
+#include <sl12/profiler.h>
+#include <vector>
+
+
+namespace sl12
+{
+	class Device;
+	class CommandList;
+
+	/*************************************************//**
+	 * @brief GPU の区間計測
+	 *
+	 * 入れ子にした名前付きの区間の開始と終了でタイムスタンプを記録する.\n
+	 * タイムスタンプのクエリは Swapchain::kMaxBuffer 個用意してフレームごとに使い回し、
+	 * BeginFrame で同じ番号を前回使ったフレームの結果を読み戻す. そのフレームのコマンドは GPU で完了していること.\n
+	 * 区間はグラフィクスキューのコマンドリストに記録する.
+	*****************************************************/
+	class GpuProfiler
+	{
+	public:
+		GpuProfiler()
+		{}
+		~GpuProfiler()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		 *
+		 * @param[in]	maxScopes	1フレームで記録できる区間の最大数
+		*/
+		bool Initialize(Device* pDev, u32 maxScopes);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief フレームの記録を開始する
+		 *
+		 * 同じ番号を前回使ったフレームの結果を読み戻し、GetEvents で取得できるようにする.
+		*/
+		void BeginFrame(u32 frameIndex);
+
+		/**
+		 * @brief 区間を開始/終了する
+		 *
+		 * クエリが足りない場合、区間は記録されない.
+		*/
+		void BeginScope(CommandList* pCmdList, const char* name);
+		void EndScope(CommandList* pCmdList);
+
+		/**
+		 * @brief フレームの記録を終了する
+		 *
+		 * タイムスタンプを読み戻し用のバッファに解決する. フレームで最後に実行されるコマンドリストに記録すること.
+		*/
+		void EndFrame(CommandList* pCmdList);
+
+		//! @name 取得関数
+		//! @{
+		//! 最後に読み戻したフレームの区間. トラックは0
+		const std::vector<ProfileEvent>& GetEvents() const
+		{
+			return events_;
+		}
+		u64 GetTicksPerSecond() const
+		{
+			return ticksPerSecond_;
+		}
+		//! @}
+
+	private:
+		static const u32	kInvalidQuery = 0xffffffff;
+
+		struct Scope
+		{
+			const char*		name;
+			u32				depth;
+			u32				beginQuery;
+			u32				endQuery;
+		};	// struct Scope
+
+	private:
+		Timestamp			timestamps_[Swapchain::kMaxBuffer];
+		std::vector<Scope>	scopes_[Swapchain::kMaxBuffer];
+		bool				resolved_[Swapchain::kMaxBuffer] = {};
+		std::vector<u32>	openScopes_;		//!< 開いている区間
+		std::vector<u64>	ticks_;
+		std::vector<ProfileEvent>	events_;
+		u32					frameIndex_ = 0;
+		u64					ticksPerSecond_ = 0;
+	};	// class GpuProfiler
+
+	/*************************************************//**
+	 * @brief GPU の区間をスコープで計測する
+	*****************************************************/
+	class GpuProfileScope
+	{
+	public:
+		GpuProfileScope(GpuProfiler& profiler, CommandList* pCmdList, const char* name)
+			: profiler_(profiler), pCmdList_(pCmdList)
+		{
+			profiler_.BeginScope(pCmdList_, name);
+		}
+		~GpuProfileScope()
+		{
+			profiler_.EndScope(pCmdList_);
+		}
+
+	private:
+		GpuProfiler&	profiler_;
+		CommandList*	pCmdList_;
+	};	// class GpuProfileScope
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,180 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <DirectXMath.h>
+#include <vector>
+
+
+namespace sl12
+{
+	class PointLightSet;
+
+	/*************************************************//**
+	 * @brief ポイントライトのクラスタ(フロクセル)への割り当て
+	 *
+	 * 画面をタイルに分割し、深度方向を指数的にスライスしたフロクセルごとに、接触するライトのインデックスリストを作成する.\n
+	 * リストは全クラスタで1つの配列に詰めて格納し、クラスタごとに (オフセット, 個数) を持つ.\n
+	 * クラスタ内のライトは必ずインデックス順に並ぶので、スレッド数によらず結果は同じになる.\n
+	 * D3D12 には依存しないので、デバイスなしで結果を確認できる.\n
+	 * GridDesc::maxLightsPerCluster を指定すると、各クラスタにはインデックスの小さい順に上限までのライトだけを残す.
+	 * インデックスリストの大きさはクラスタ数 x 上限で抑えられる.
+	 *
+	 * 判定はビュー空間 (x, y, 深度) でのフロクセルのAABBと球の距離で行う.
+	 * Bin と BinReference は同じ判定式を同じ順序で計算するので、結果はビット単位で一致する.
+	*****************************************************/
+	class LightClusterBinner
+	{
+	public:
+		struct GridDesc
+		{
+			u32		screenWidth = 1920;
+			u32		screenHeight = 1080;
+			u32		tileSize = 64;			//!< タイルのピクセル数
+			u32		sliceCount = 32;		//!< 深度方向の分割数
+			float	nearZ = 1.0f;			//!< 最初のスライスの手前の深度
+			float	farZ = 10000.0f;		//!< 最後のスライスの奥の深度
+			float	fovY = 1.0f;			//!< 垂直方向の視野角 (ラジアン)
+			u32		maxLightsPerCluster = 0;	//!< クラスタごとのライト数の上限. 0 の場合は無制限
+		};	// struct GridDesc
+
+	public:
+		LightClusterBinner()
+		{}
+		~LightClusterBinner()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief フロクセルのグリッドを作成する
+		*/
+		bool Initialize(const GridDesc& desc);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief ライトをクラスタに割り当てる
+		 *
+		 * ライトを numThreads 個の連続した範囲に分けて並列に判定し、4タイルずつまとめて球とフロクセルの判定を行う.\n
+		 * 並列化には常駐の WorkerPool を使用するので、毎フレーム呼び出してもスレッドは生成しない.
+		 *
+		 * @param[in]	lights			ライト. 座標はワールド空間
+		 * @param[in]	lightCount		先頭から割り当てるライト数
+		 * @param[in]	mtxWorldToView	ビュー行列 (右手系)
+		 * @param[in]	numThreads		使用するスレッド数. 0 の場合はハードウェアのスレッド数
+		 * @return 割り当てたライトインデックスの総数
+		*/
+		u32 Bin(const PointLightSet& lights, u32 lightCount, const DirectX::XMMATRIX& mtxWorldToView, u32 numThreads);
+
+		/**
+		 * @brief 割り当てのスカラー版リファレンス
+		 *
+		 * すべてのクラスタとライトの組み合わせを判定する. Bin と同じ結果になる
+		*/
+		u32 BinReference(const PointLightSet& lights, u32 lightCount, const DirectX::XMMATRIX& mtxWorldToView);
+
+		/**
+		 * @brief インデックスリストの最大の大きさを取得する
+		 *
+		 * maxLightsPerCluster が 0 の場合は上限がないので 0 を返す
+		*/
+		u32 GetMaxIndexCount() const
+		{
+			return GetClusterCount() * desc_.maxLightsPerCluster;
+		}
+
+		/**
+		 * @brief クラスタごとの (オフセット, 個数) を書き出す
+		 *
+		 * @param[out]	pOut			u32 x 2 x クラスタ数
+		 * @param[in]	maxIndices		書き出し先のインデックスリストの容量. あふれたライトは個数から除く
+		*/
+		void WriteClusterRanges(u32* pOut, u32 maxIndices) const;
+
+		/**
+		 * @brief ライトインデックスリストを書き出す
+		 *
+		 * @return 書き出したインデックス数
+		*/
+		u32 WriteLightIndices(u32* pOut, u32 maxIndices) const;
+
+		/**
+		 * @brief 深度からスライス番号を求める
+		 *
+		 * シェーダ側も同じ式でピクセルのスライスを求める
+		*/
+		u32 GetSlice(float depth) const;
+
+		//! @name 取得関数
+		//! @{
+		const GridDesc& GetDesc() const
+		{
+			return desc_;
+		}
+		u32 GetTileCountX() const
+		{
+			return tileCountX_;
+		}
+		u32 GetTileCountY() const
+		{
+			return tileCountY_;
+		}
+		u32 GetClusterCount() const
+		{
+			return tileCountX_ * tileCountY_ * desc_.sliceCount;
+		}
+		//! log(depth / nearZ) に掛けるとスライス番号になる係数
+		float GetSliceScale() const
+		{
+			return sliceScale_;
+		}
+		//! (オフセット, 個数) x クラスタ数
+		const std::vector<u32>& GetClusterRanges() const
+		{
+			return clusterRanges_;
+		}
+		const std::vector<u32>& GetLightIndices() const
+		{
+			return lightIndices_;
+		}
+		//! @}
+
+	private:
+		struct ThreadWork
+		{
+			std::vector<u32>	counts;			//!< クラスタごとのライト数. 上限で打ち切る
+			std::vector<u32>	hitClusters;	//!< 接触したクラスタ. ライト順
+			std::vector<u32>	hitEnds;		//!< ライトごとの hitClusters の終端
+		};	// struct ThreadWork
+
+		void TransformLights(const PointLightSet& lights, u32 lightCount, const DirectX::XMMATRIX& mtxWorldToView);
+		bool TestFroxel(u32 light, u32 x, u32 y, u32 slice) const;
+		void BinLights(u32 first, u32 end, ThreadWork& work) const;
+
+	private:
+		GridDesc			desc_;
+		u32					tileCountX_ = 0;
+		u32					tileCountY_ = 0;
+		u32					tileStrideX_ = 0;	//!< 4の倍数に切り上げたタイル数
+		float				sliceScale_ = 0.0f;
+
+		// フロクセルのビュー空間のAABB
+		std::vector<float>	tileMinX_, tileMaxX_;	//!< [slice][x]
+		std::vector<float>	tileMinY_, tileMaxY_;	//!< [slice][y]
+		std::vector<float>	sliceMinZ_, sliceMaxZ_;	//!< [slice]. 深度は視線方向を正とする
+
+		// ビュー空間のライト
+		std::vector<float>	lightX_, lightY_, lightZ_, lightRadius_;
+
+		std::vector<ThreadWork>	works_;
+		std::vector<u32>		clusterRanges_;
+		std::vector<u32>		lightIndices_;
+	};	// class LightClusterBinner
+
+}	// namespace sl12
+
+
+//	EOF
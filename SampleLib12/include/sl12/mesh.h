@@ -1,12 +1,16 @@
 ﻿#pragma once
 
 #include "sl12/mesh_format.h"
+#include "sl12/mesh_view.h"
 #include "sl12/buffer.h"
 #include "sl12/buffer_view.h"
+#include <algorithm>
 
 
 namespace sl12
 {
+	class UploadManager;
+
 	/***************************************//**
 	 * @brief シェイプインスタンス
 	*******************************************/
@@ -36,7 +40,7 @@ namespace sl12
 		/**
 		 * @brief 初期化する
 		*/
-		bool Initialize(sl12::Device* pDev, sl12::CommandList* pCmdList, const MeshShape* shape, const void* p_vertex_head);
+		bool Initialize(sl12::Device* pDev, sl12::UploadManager* pUploader, const MeshShape* shape, const void* p_vertex_head);
 
 		/**
 		 * @brief 破棄する
@@ -99,8 +103,10 @@ namespace sl12
 
 		/**
 		 * @brief 初期化する
+		 *
+		 * pLods にはLOD1以降のインデックスバッファ情報を numLods 個渡す
 		*/
-		bool Initialize(sl12::Device* pDev, sl12::CommandList* pCmdList, const MeshSubmesh* shape, const void* p_vertex_head);
+		bool Initialize(sl12::Device* pDev, sl12::UploadManager* pUploader, const MeshSubmesh* shape, const void* p_vertex_head, const MeshSubmeshLod* pLods = nullptr, u32 numLods = 0);
 
 		/**
 		 * @brief 破棄する
@@ -113,16 +119,34 @@ namespace sl12
 		{
 			return pSrcSubmesh_;
 		}
-		IndexBufferView* GetIndexBufferView()
+		IndexBufferView* GetIndexBufferView(u32 lod = 0)
+		{
+			assert(lod < GetLodCount());
+			return (lod == 0) ? &indexBuffer_.view_ : &pLodBuffers_[lod - 1].view_;
+		}
+		u32 GetLodCount() const
+		{
+			return numLods_ + 1;
+		}
+		u32 GetNumIndices(u32 lod = 0) const
+		{
+			assert(lod < GetLodCount());
+			return (lod == 0) ? pSrcSubmesh_->numSubmeshIndices : pSrcLods_[lod - 1].numIndices;
+		}
+		float GetLodError(u32 lod) const
 		{
-			return &indexBuffer_.view_;
+			assert(lod < GetLodCount());
+			return (lod == 0) ? 0.0f : pSrcLods_[lod - 1].error;
 		}
 		//! @}
 
 	private:
-		const MeshSubmesh*	pSrcSubmesh_ = nullptr;
+		const MeshSubmesh*		pSrcSubmesh_ = nullptr;
+		const MeshSubmeshLod*	pSrcLods_ = nullptr;
+		u32						numLods_ = 0;
 
 		IndexBuffer			indexBuffer_;
+		IndexBuffer*		pLodBuffers_ = nullptr;
 	};	// class MeshSubmeshInstance
 
 	/***************************************//**
@@ -134,6 +158,7 @@ namespace sl12
 		MeshSubmeshInstance*	pSubmesh = nullptr;
 		const MeshMaterial*		pMaterial = nullptr;
 		s32						numIndices = 0;
+		u32						lod = 0;
 	};	// struct DrawSubmeshInfo
 
 	/***************************************//**
@@ -151,8 +176,13 @@ namespace sl12
 
 		/**
 		 * @brief 初期化する
+		 *
+		 * 転送命令はアップロードマネージャに登録するのみ\n
+		 * 描画前にアップロードマネージャ側で転送完了を待つ必要がある\n
+		 * pBin は MeshView で検証され、インスタンスはバイナリを直接参照するので破棄するまで保持すること\n
+		 * v2 の圧縮ストリームは展開して転送する. 16bitインデックスは16bitのまま転送する
 		*/
-		bool Initialize(sl12::Device* pDev, sl12::CommandList* pCmdList, const void* pBin);
+		bool Initialize(sl12::Device* pDev, sl12::UploadManager* pUploader, const void* pBin, u64 binSize);
 
 		/**
 		 * @brief 破棄する
@@ -161,6 +191,10 @@ namespace sl12
 
 		//! @name 取得関数
 		//! @{
+		const MeshView& GetView() const
+		{
+			return view_;
+		}
 		const MeshHead* GetHead() const
 		{
 			assert(pHead_ != nullptr);
@@ -186,7 +220,7 @@ namespace sl12
 			assert(pHead_ != nullptr);
 			return pHead_->numSubmeshes;
 		}
-		DrawSubmeshInfo GetDrawSubmeshInfo(s32 index) const
+		DrawSubmeshInfo GetDrawSubmeshInfo(s32 index, u32 lod = 0) const
 		{
 			assert(pHead_ != nullptr);
 			assert(pMaterials_ != nullptr);
@@ -198,13 +232,27 @@ namespace sl12
 			ret.pSubmesh = pSubmeshes_ + index;
 			ret.pShape = pShapes_ + ret.pSubmesh->GetSrcSubmesh()->shapeIndex;
 			ret.pMaterial = pMaterials_ + ret.pSubmesh->GetSrcSubmesh()->materialIndex;
-			ret.numIndices = ret.pSubmesh->GetSrcSubmesh()->numSubmeshIndices;
+			ret.lod = std::min(lod, ret.pSubmesh->GetLodCount() - 1);
+			ret.numIndices = ret.pSubmesh->GetNumIndices(ret.lod);
 
 			return ret;
 		}
 		//! @}
 
+		/**
+		 * @brief 画面上の誤差から描画するLODを選択する
+		 *
+		 * シェイプのAABBまでの距離で各LODの誤差を画面に投影し、許容誤差以下となる最も粗いLODを返す
+		 *
+		 * @param[in]	index		サブメッシュ番号
+		 * @param[in]	cameraPos	シェイプのローカル空間でのカメラ位置
+		 * @param[in]	projScale	画面の高さ(pixel) / (2 * tan(fovY / 2))
+		 * @param[in]	pixelError	許容する画面上の誤差(pixel)
+		*/
+		u32 SelectLod(s32 index, const DirectX::XMFLOAT3& cameraPos, float projScale, float pixelError) const;
+
 	private:
+		MeshView				view_;
 		const MeshHead*			pHead_ = nullptr;
 		const MeshMaterial*		pMaterials_ = nullptr;
 		MeshShapeInstance*		pShapes_ = nullptr;
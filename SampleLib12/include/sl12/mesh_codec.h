@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include "types.h"
+#include "float16.h"
+#include <string.h>
+#include <math.h>
+
+
+namespace sl12
+{
+	/**
+	 * @brief float を half に変換する (最近接偶数丸め)
+	*/
+	inline u16 MeshFloatToHalf(float value)
+	{
+		return FloatToHalf(value);
+	}
+
+	/**
+	 * @brief half を float に変換する
+	*/
+	inline float MeshHalfToFloat(u16 value)
+	{
+		return HalfToFloat(value);
+	}
+
+	/**
+	 * @brief AABB に対する相対座標を16bit正規化整数に量子化する
+	*/
+	inline void MeshQuantizePosition(const float* pPos, const float* pAabbMin, const float* pAabbMax, u16* pOut)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			float extent = pAabbMax[i] - pAabbMin[i];
+			float t = (extent > 0.0f) ? (pPos[i] - pAabbMin[i]) / extent : 0.0f;
+			t = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+			pOut[i] = static_cast<u16>(t * 65535.0f + 0.5f);
+		}
+	}
+
+	/**
+	 * @brief 16bit正規化整数の座標を復元する
+	*/
+	inline void MeshDequantizePosition(const u16* pQuant, const float* pAabbMin, const float* pAabbMax, float* pOut)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			float scale = (pAabbMax[i] - pAabbMin[i]) * (1.0f / 65535.0f);
+			pOut[i] = pAabbMin[i] + static_cast<float>(pQuant[i]) * scale;
+		}
+	}
+
+	/**
+	 * @brief 単位ベクトルを八面体エンコードする
+	*/
+	inline void MeshOctEncodeNormal(const float* pNormal, s16* pOut)
+	{
+		float x = pNormal[0], y = pNormal[1], z = pNormal[2];
+		float len = fabsf(x) + fabsf(y) + fabsf(z);
+		if (len <= 0.0f)
+		{
+			pOut[0] = pOut[1] = 0;
+			return;
+		}
+		x /= len;
+		y /= len;
+		if (z < 0.0f)
+		{
+			float ox = (1.0f - fabsf(y)) * ((x >= 0.0f) ? 1.0f : -1.0f);
+			float oy = (1.0f - fabsf(x)) * ((y >= 0.0f) ? 1.0f : -1.0f);
+			x = ox;
+			y = oy;
+		}
+
+		auto toSNorm = [](float v)
+		{
+			v = (v < -1.0f) ? -1.0f : ((v > 1.0f) ? 1.0f : v);
+			return static_cast<s16>(floorf(v * 32767.0f + 0.5f));
+		};
+		pOut[0] = toSNorm(x);
+		pOut[1] = toSNorm(y);
+	}
+
+	/**
+	 * @brief 八面体エンコードされた単位ベクトルを復元する
+	*/
+	inline void MeshOctDecodeNormal(const s16* pOct, float* pOut)
+	{
+		float x = static_cast<float>(pOct[0]) * (1.0f / 32767.0f);
+		float y = static_cast<float>(pOct[1]) * (1.0f / 32767.0f);
+		x = (x < -1.0f) ? -1.0f : x;
+		y = (y < -1.0f) ? -1.0f : y;
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		float t = (-z > 0.0f) ? -z : 0.0f;
+		x += (x >= 0.0f) ? -t : t;
+		y += (y >= 0.0f) ? -t : t;
+
+		float len = sqrtf(x * x + y * y + z * z);
+		float inv = (len > 0.0f) ? 1.0f / len : 0.0f;
+		pOut[0] = x * inv;
+		pOut[1] = y * inv;
+		pOut[2] = z * inv;
+	}
+
+	//! @name ストリーム単位のデコード
+	//! @{
+	inline void MeshDecodePositions(const u16* pSrc, u32 numVertices, const float* pAabbMin, const float* pAabbMax, float* pDst)
+	{
+		for (u32 i = 0; i < numVertices; ++i, pSrc += 3, pDst += 3)
+		{
+			MeshDequantizePosition(pSrc, pAabbMin, pAabbMax, pDst);
+		}
+	}
+	inline void MeshDecodeNormals(const s16* pSrc, u32 numVertices, float* pDst)
+	{
+		for (u32 i = 0; i < numVertices; ++i, pSrc += 2, pDst += 3)
+		{
+			MeshOctDecodeNormal(pSrc, pDst);
+		}
+	}
+	inline void MeshDecodeHalfs(const u16* pSrc, u64 count, float* pDst)
+	{
+		for (u64 i = 0; i < count; ++i)
+		{
+			pDst[i] = MeshHalfToFloat(pSrc[i]);
+		}
+	}
+	//! @}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -4,6 +4,44 @@
 
 namespace sl12
 {
+	//! .meshバイナリのバージョン
+	static const u32	kMeshVersion1 = 1;
+	static const u32	kMeshVersion2 = 2;
+	static const u32	kMeshVersionLatest = kMeshVersion2;
+
+	/**********************************************//**
+	 * @brief メッシュフラグ
+	**************************************************/
+	struct MeshFlag
+	{
+		enum Type
+		{
+			None				= 0,
+			QuantizedVertex		= 0x1 << 0,		//!< 量子化された頂点ストリームを含む
+			ShortIndex			= 0x1 << 1,		//!< 16bitインデックスのサブメッシュを含む
+			Chunk				= 0x1 << 2,		//!< サブメッシュテーブルの後ろにチャンクテーブルを持つ
+		};
+	};	// struct MeshFlag
+
+	/**********************************************//**
+	 * @brief 頂点・インデックスストリームのフォーマット
+	**************************************************/
+	struct MeshStreamFormat
+	{
+		enum Type
+		{
+			Float3,				//!< float x 3
+			Float2,				//!< float x 2
+			UNorm16x3,			//!< シェイプのAABBに対する相対座標を16bit正規化整数 x 3 で格納
+			OctSNorm16x2,		//!< 八面体エンコードした単位ベクトルを16bit符号付き正規化整数 x 2 で格納
+			Half2,				//!< half x 2
+			UInt32,				//!< 32bitインデックス
+			UInt16,				//!< 16bitインデックス
+
+			Max
+		};
+	};	// struct MeshStreamFormat
+
 	/**********************************************//**
 	 * @brief シェイプ
 	**************************************************/
@@ -15,6 +53,14 @@ namespace sl12
 		u64		positionOffset;
 		u64		normalOffset;
 		u64		texcoordOffset;
+
+		// 以下 v2 以降
+		u8		positionFormat;		//!< MeshStreamFormat::Type
+		u8		normalFormat;		//!< MeshStreamFormat::Type
+		u8		texcoordFormat;		//!< MeshStreamFormat::Type
+		u8		reserved[5];
+		float	aabbMin[3];
+		float	aabbMax[3];
 	};	// struct MeshShape
 
 	/**********************************************//**
@@ -27,6 +73,8 @@ namespace sl12
 
 	/**********************************************//**
 	 * @brief サブメッシュ
+	 *
+	 * v1 では indexFormat の位置はパディングで、内容は不定
 	**************************************************/
 	struct MeshSubmesh
 	{
@@ -34,10 +82,14 @@ namespace sl12
 		s32		materialIndex;
 		u64		indexBufferOffset;
 		u32		numSubmeshIndices;
+		u32		indexFormat;		//!< MeshStreamFormat::Type (v2 以降)
 	};	// struct MeshMaterial
 
 	/**********************************************//**
 	 * @brief メッシュヘッダ
+	 *
+	 * v1 は fourCC が "MESH" で version 以降を持たない\n
+	 * v2 以降は fourCC が "MSHV" で version と flags を持つ
 	**************************************************/
 	struct MeshHead
 	{
@@ -45,8 +97,150 @@ namespace sl12
 		s32		numShapes;
 		s32		numMaterials;
 		s32		numSubmeshes;
+
+		// 以下 v2 以降
+		u32		version;
+		u32		flags;				//!< MeshFlag::Type の組み合わせ
 	};	// struct MeshHead
 
+	/**********************************************//**
+	 * @brief チャンクテーブル
+	 *
+	 * MeshFlag::Chunk が立っている場合、サブメッシュテーブルの直後に配置され、
+	 * MeshChunk が numChunks 個続く. 頂点領域はその後ろから始まる.
+	**************************************************/
+	struct MeshChunkTable
+	{
+		u32		numChunks;
+		u32		reserved;
+	};	// struct MeshChunkTable
+
+	/**********************************************//**
+	 * @brief チャンク
+	 *
+	 * offset は他のストリームと同じく頂点領域の先頭からのオフセット\n
+	 * offset と size は8byteアラインとする
+	**************************************************/
+	struct MeshChunk
+	{
+		char	fourCC[4];
+		u32		reserved;
+		u64		offset;
+		u64		size;
+	};	// struct MeshChunk
+
+	/**********************************************//**
+	 * @brief メッシュレットチャンク ("MLET") のヘッダ
+	 *
+	 * 以下の配列が順に続く
+	 * - MeshletSubmesh x numSubmeshes
+	 * - MeshMeshlet x numMeshlets
+	 * - u32 頂点インデックス x numVertexIndices (シェイプの頂点番号)
+	 * - u32 プリミティブ x numPrimitives (メッシュレット内の頂点番号 u8 x 3 を下位24bitに格納)
+	**************************************************/
+	struct MeshletChunkHead
+	{
+		u32		numSubmeshes;
+		u32		numMeshlets;
+		u32		numVertexIndices;
+		u32		numPrimitives;
+	};	// struct MeshletChunkHead
+
+	/**********************************************//**
+	 * @brief サブメッシュごとのメッシュレット範囲
+	**************************************************/
+	struct MeshletSubmesh
+	{
+		u32		meshletOffset;
+		u32		meshletCount;
+	};	// struct MeshletSubmesh
+
+	/**********************************************//**
+	 * @brief メッシュレット
+	 *
+	 * 座標はシェイプのローカル空間.\n
+	 * dot(normalize(coneApex - cameraPos), coneAxis) >= coneCutoff の場合は全ての三角形が裏向きとなる.\n
+	 * coneCutoff が 1 以上の場合はコーンによるカリングは行えない.
+	**************************************************/
+	struct MeshMeshlet
+	{
+		float	center[3];
+		float	radius;
+		float	coneAxis[3];
+		float	coneCutoff;
+		float	coneApex[3];
+		u32		reserved;
+		u32		vertexOffset;
+		u32		vertexCount;
+		u32		primitiveOffset;
+		u32		primitiveCount;
+	};	// struct MeshMeshlet
+
+	/**********************************************//**
+	 * @brief サブメッシュLODチャンク ("SLOD") のヘッダ
+	 *
+	 * サブメッシュテーブルを拡張し、LOD1以降のインデックスバッファを記録する.\n
+	 * LOD0 は MeshSubmesh のインデックスバッファ. 以下の配列が順に続く
+	 * - MeshSubmeshLodRange x numSubmeshes
+	 * - MeshSubmeshLod x numLods
+	**************************************************/
+	struct MeshLodChunkHead
+	{
+		u32		numSubmeshes;
+		u32		numLods;
+	};	// struct MeshLodChunkHead
+
+	/**********************************************//**
+	 * @brief サブメッシュごとのLOD範囲
+	**************************************************/
+	struct MeshSubmeshLodRange
+	{
+		u32		lodOffset;
+		u32		lodCount;			//!< LOD0 を含まない数
+	};	// struct MeshSubmeshLodRange
+
+	/**********************************************//**
+	 * @brief サブメッシュのLOD
+	 *
+	 * インデックスのフォーマットは元のサブメッシュと同じで、頂点バッファも共有する
+	**************************************************/
+	struct MeshSubmeshLod
+	{
+		u64		indexBufferOffset;
+		u32		numIndices;
+		float	error;				//!< シェイプのローカル空間での幾何誤差
+	};	// struct MeshSubmeshLod
+
+	/**********************************************//**
+	 * @brief v1 のファイル上のレイアウト
+	**************************************************/
+	struct MeshHeadV1
+	{
+		char	fourCC[4];
+		s32		numShapes;
+		s32		numMaterials;
+		s32		numSubmeshes;
+	};	// struct MeshHeadV1
+
+	struct MeshShapeV1
+	{
+		char	name[64];
+		u32		numVertices;
+		u32		numIndices;
+		u64		positionOffset;
+		u64		normalOffset;
+		u64		texcoordOffset;
+	};	// struct MeshShapeV1
+
+	static_assert(sizeof(MeshHeadV1) == 16, "MeshHeadV1 size mismatch.");
+	static_assert(sizeof(MeshShapeV1) == 96, "MeshShapeV1 size mismatch.");
+	static_assert(sizeof(MeshHead) == 24, "MeshHead size mismatch.");
+	static_assert(sizeof(MeshShape) == 128, "MeshShape size mismatch.");
+	static_assert(sizeof(MeshSubmesh) == 24, "MeshSubmesh size mismatch.");
+	static_assert(sizeof(MeshChunk) == 24, "MeshChunk size mismatch.");
+	static_assert(sizeof(MeshMeshlet) == 64, "MeshMeshlet size mismatch.");
+	static_assert(sizeof(MeshSubmeshLod) == 16, "MeshSubmeshLod size mismatch.");
+
 }	// namespace sl12
 
 
@@ -0,0 +1,230 @@
+﻿#pragma once
+
+#include "sl12/mesh_format.h"
+#include <stddef.h>
+#include <vector>
+
+
+namespace sl12
+{
+	/**********************************************//**
+	 * @brief メッシュバイナリ上の連続領域
+	**************************************************/
+	template <typename T>
+	struct MeshSpan
+	{
+		const T*	pData = nullptr;
+		u64			count = 0;
+
+		const T* begin() const
+		{
+			return pData;
+		}
+		const T* end() const
+		{
+			return pData + count;
+		}
+		const T& operator[](u64 index) const
+		{
+			return pData[index];
+		}
+		u64 size() const
+		{
+			return count;
+		}
+		u64 sizeInBytes() const
+		{
+			return count * sizeof(T);
+		}
+		bool empty() const
+		{
+			return count == 0;
+		}
+	};	// struct MeshSpan
+
+	/**********************************************//**
+	 * @brief メッシュレットチャンクのビュー
+	**************************************************/
+	struct MeshletChunk
+	{
+		MeshSpan<MeshletSubmesh>	submeshes;
+		MeshSpan<MeshMeshlet>		meshlets;
+		MeshSpan<u32>				vertexIndices;
+		MeshSpan<u32>				primitives;
+	};	// struct MeshletChunk
+
+	/**********************************************//**
+	 * @brief サブメッシュLODチャンクのビュー
+	**************************************************/
+	struct MeshLodChunk
+	{
+		MeshSpan<MeshSubmeshLodRange>	ranges;
+		MeshSpan<MeshSubmeshLod>		lods;
+	};	// struct MeshLodChunk
+
+	/**********************************************//**
+	 * @brief メッシュバイナリビュー
+	 *
+	 * .meshバイナリのヘッダ、各テーブル、頂点・インデックス領域のオフセットを
+	 * ファイルサイズに対して検証し、バイナリ上を直接参照する.\n
+	 * データのコピーは行わないので、参照元のメモリは本オブジェクトより長く生存する必要がある.\n
+	 * v1 のバイナリはヘッダとシェイプ、サブメッシュのテーブルのみを最新のレイアウトに変換して保持する.
+	**************************************************/
+	class MeshView
+	{
+	public:
+		MeshView()
+		{}
+		~MeshView()
+		{}
+
+		/**
+		 * @brief バイナリを検証して初期化する
+		 *
+		 * @param[in] pData				.meshバイナリの先頭
+		 * @param[in] size				バイナリのサイズ
+		 * @param[in] checkIndexRange	trueの場合、全インデックスが頂点数未満であるかも検証する
+		 * @return 不正なバイナリの場合は false
+		*/
+		bool Initialize(const void* pData, u64 size, bool checkIndexRange = false);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		//! @name 取得関数
+		//! @{
+		bool IsValid() const
+		{
+			return pHead_ != nullptr;
+		}
+		const MeshHead* GetHead() const
+		{
+			return pHead_;
+		}
+		u32 GetVersion() const
+		{
+			return pHead_ ? pHead_->version : 0;
+		}
+		MeshSpan<MeshShape> GetShapes() const
+		{
+			return shapes_;
+		}
+		MeshSpan<MeshMaterial> GetMaterials() const
+		{
+			return materials_;
+		}
+		MeshSpan<MeshSubmesh> GetSubmeshes() const
+		{
+			return submeshes_;
+		}
+		const u8* GetVertexHead() const
+		{
+			return pVertexHead_;
+		}
+		u64 GetVertexAreaSize() const
+		{
+			return vertexAreaSize_;
+		}
+		MeshSpan<MeshChunk> GetChunks() const
+		{
+			return chunks_;
+		}
+		bool HasMeshlets() const
+		{
+			return !meshlet_.meshlets.empty();
+		}
+		const MeshletChunk& GetMeshletChunk() const
+		{
+			return meshlet_;
+		}
+		const MeshLodChunk& GetLodChunk() const
+		{
+			return lod_;
+		}
+
+		/**
+		 * @brief サブメッシュのLOD数を取得する
+		 *
+		 * LOD0 を含む. LODチャンクがない場合は 1
+		*/
+		u32 GetSubmeshLodCount(u32 submeshIndex) const;
+
+		/**
+		 * @brief サブメッシュのLOD1以降の情報を取得する
+		 *
+		 * @param[in]	lod		1 以上 GetSubmeshLodCount() 未満
+		*/
+		const MeshSubmeshLod* GetSubmeshLod(u32 submeshIndex, u32 lod) const;
+
+		/**
+		 * @brief 画面上の誤差から描画するLODを選択する
+		 *
+		 * シェイプのAABBまでの距離で各LODの誤差を画面に投影し、許容誤差以下となる最も粗いLODを返す
+		 *
+		 * @param[in]	submeshIndex	サブメッシュ番号
+		 * @param[in]	pCameraPos		シェイプのローカル空間でのカメラ位置 (float x 3)
+		 * @param[in]	projScale		画面の高さ(pixel) / (2 * tan(fovY / 2))
+		 * @param[in]	pixelError		許容する画面上の誤差(pixel)
+		*/
+		u32 SelectLod(u32 submeshIndex, const float* pCameraPos, float projScale, float pixelError) const;
+
+		/**
+		 * @brief fourCC が一致するチャンクを検索する
+		 *
+		 * @return 見つからない場合は nullptr
+		*/
+		const MeshChunk* FindChunk(const char* fourCC) const;
+
+		/**
+		 * @brief 各ストリームを非圧縮フォーマットとして取得する
+		 *
+		 * ストリームが圧縮フォーマットの場合は空を返す
+		*/
+		MeshSpan<float> GetPositions(u32 shapeIndex) const;
+		MeshSpan<float> GetNormals(u32 shapeIndex) const;
+		MeshSpan<float> GetTexcoords(u32 shapeIndex) const;
+		MeshSpan<u32> GetIndices(u32 submeshIndex) const;
+
+		/**
+		 * @brief ストリームの先頭アドレスを取得する
+		 *
+		 * フォーマットは MeshShape, MeshSubmesh の各フォーマットを参照すること
+		*/
+		const void* GetPositionData(u32 shapeIndex) const;
+		const void* GetNormalData(u32 shapeIndex) const;
+		const void* GetTexcoordData(u32 shapeIndex) const;
+		const void* GetIndexData(u32 submeshIndex) const;
+		//! @}
+
+		/**
+		 * @brief フォーマットの1要素あたりのサイズを取得する
+		*/
+		static u32 GetStreamStride(u32 format);
+
+	private:
+		static bool InitLodChunk(const u8* pChunk, u64 chunkSize, u64 areaSize, const MeshSpan<MeshShape>& shapes, const MeshSpan<MeshSubmesh>& submeshes, const u8* pVertexHead, bool checkIndexRange, MeshLodChunk* pOut);
+		static bool InitMeshletChunk(const u8* pChunk, u64 chunkSize, const MeshSpan<MeshShape>& shapes, const MeshSpan<MeshSubmesh>& submeshes, bool checkIndexRange, MeshletChunk* pOut);
+
+	private:
+		const MeshHead*			pHead_ = nullptr;
+		MeshSpan<MeshShape>		shapes_;
+		MeshSpan<MeshMaterial>	materials_;
+		MeshSpan<MeshSubmesh>	submeshes_;
+		const u8*				pVertexHead_ = nullptr;
+		u64						vertexAreaSize_ = 0;
+		MeshSpan<MeshChunk>		chunks_;
+		MeshletChunk			meshlet_;
+		MeshLodChunk			lod_;
+
+		// v1 から変換したテーブル
+		MeshHead					convHead_;
+		std::vector<MeshShape>		convShapes_;
+		std::vector<MeshSubmesh>	convSubmeshes_;
+	};	// class MeshView
+
+}	// namespace sl12
+
+
+//	EOF
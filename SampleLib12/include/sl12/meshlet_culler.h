@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <sl12/mesh_view.h>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief メッシュレットのCPUカリング
+	 *
+	 * メッシュレットの境界球とコーンを4要素ずつのSoAに並べ替えて保持し、
+	 * 4メッシュレットずつ視錐台とコーンによる裏面判定を行う.\n
+	 * 平面とカメラ位置はメッシュレットと同じシェイプのローカル空間で与えること.
+	*****************************************************/
+	class MeshletCuller
+	{
+	public:
+		static const u32	kMaxPlanes = 6;
+
+	public:
+		MeshletCuller()
+		{}
+		~MeshletCuller()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief メッシュレットのバウンディング情報を取り込む
+		*/
+		bool Initialize(const MeshSpan<MeshMeshlet>& meshlets);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief カリングを行う
+		 *
+		 * @param[in]	pPlanes		平面 (xyz:内向きの法線, w:距離) の配列. 内側は dot(n, p) + w >= 0
+		 * @param[in]	numPlanes	平面数 (最大 kMaxPlanes)
+		 * @param[in]	cameraPos	カメラ位置. コーンによる裏面判定に使用する
+		 * @param[in]	first		判定するメッシュレットの先頭
+		 * @param[in]	count		判定するメッシュレット数
+		 * @param[out]	outVisible	可視と判定されたメッシュレット番号を追加する
+		 * @return 可視と判定されたメッシュレット数
+		*/
+		u32 Cull(const DirectX::XMFLOAT4* pPlanes, u32 numPlanes, const DirectX::XMFLOAT3& cameraPos, u32 first, u32 count, std::vector<u32>& outVisible) const;
+
+		/**
+		 * @brief カリングのスカラー版リファレンス
+		 *
+		 * Cull と同じ結果を返す
+		*/
+		u32 CullReference(const DirectX::XMFLOAT4* pPlanes, u32 numPlanes, const DirectX::XMFLOAT3& cameraPos, u32 first, u32 count, std::vector<u32>& outVisible) const;
+
+		/**
+		 * @brief ビュープロジェクション行列から視錐台の6平面を取り出す
+		 *
+		 * 行列にワールド行列を含めればシェイプのローカル空間の平面が得られる\n
+		 * 平面は left, right, bottom, top, near, far の順. 遠平面が無限遠の場合は先頭5平面のみを使用すること
+		*/
+		static void ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& viewProj, DirectX::XMFLOAT4* pOutPlanes);
+
+		//! @name 取得関数
+		//! @{
+		u32 GetMeshletCount() const
+		{
+			return numMeshlets_;
+		}
+		//! @}
+
+	private:
+		// SoAの各要素
+		enum
+		{
+			kCenterX, kCenterY, kCenterZ, kRadius,
+			kAxisX, kAxisY, kAxisZ, kCutoff,
+			kApexX, kApexY, kApexZ,
+
+			kElementMax
+		};
+
+		struct MeshletBlock
+		{
+			DirectX::XMVECTOR	elements[kElementMax];
+		};	// struct MeshletBlock
+
+		std::vector<MeshletBlock>	blocks_;
+		u32							numMeshlets_ = 0;
+	};	// class MeshletCuller
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief ParallelFor を実行する常駐ワーカースレッド
+	 *
+	 * 最初に使用した時点で (ハードウェアのスレッド数 - 1) 個のスレッドを作成し、プロセス終了まで待機させておく.\n
+	 * 毎フレーム呼び出してもスレッドの生成と破棄は発生せず、起床と完了待ちのコストだけがかかる.\n
+	 * 同時に実行できるのは1つだけで、実行中に他のスレッドやジョブの中から呼び出した場合は呼び出し元で順番に実行する.
+	*****************************************************/
+	class WorkerPool
+	{
+	public:
+		typedef void (*JobFunc)(void* pContext, u32 index);
+
+	public:
+		static WorkerPool& Get();
+
+		/**
+		 * @brief [0, count) のジョブを最大 numThreads 並列で実行し、完了を待つ
+		 *
+		 * 呼び出し元のスレッドも実行に参加する
+		*/
+		void Run(u32 count, u32 numThreads, JobFunc func, void* pContext);
+
+		//! 呼び出し元を含めた最大の並列数
+		u32 GetMaxThreadCount() const
+		{
+			return static_cast<u32>(threads_.size()) + 1;
+		}
+
+	private:
+		WorkerPool();
+		~WorkerPool();
+		WorkerPool(const WorkerPool&) = delete;
+		WorkerPool& operator=(const WorkerPool&) = delete;
+
+		void WorkerMain();
+		void Work();
+
+	private:
+		std::vector<std::thread>	threads_;
+		std::mutex					runMutex_;			//!< 実行中の Run を1つに制限する
+		std::mutex					mutex_;
+		std::condition_variable		wakeCv_;
+		std::condition_variable		doneCv_;
+
+		// 以下は mutex_ で保護する
+		u64							generation_ = 0;	//!< Run のたびに進める
+		u32							helperSlots_ = 0;	//!< これから参加できるワーカー数
+		u32							activeHelpers_ = 0;	//!< 参加中のワーカー数
+		bool						isShutdown_ = false;
+
+		// 実行中のジョブ. Run の開始時に mutex_ の中で設定する
+		JobFunc						func_ = nullptr;
+		void*						pContext_ = nullptr;
+		u32							count_ = 0;
+		std::atomic<u32>			next_;
+	};	// class WorkerPool
+
+	/**
+	 * @brief func(i) を [0, count) について並列に実行する
+	 *
+	 * numThreads が 1 以下の場合は呼び出し元で順番に実行する.\n
+	 * どのスレッドがどのインデックスを実行するかは決まらないので、結果は実行順に依存しないようにすること.
+	*/
+	template <typename Func>
+	void ParallelFor(u32 count, u32 numThreads, Func func)
+	{
+		if (numThreads <= 1 || count <= 1)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		WorkerPool::Get().Run(count, numThreads, [](void* pContext, u32 index)
+		{
+			(*static_cast<Func*>(pContext))(index);
+		}, &func);
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,134 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <DirectXMath.h>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief ポイントライトの集合
+	 *
+	 * 座標、半径、カラーを4ライトずつのSoAに並べて保持し、4ライトずつまとめて座標変換する.\n
+	 * GPU側は (xyz:座標, w:半径) と (rgb:カラー, a:1) の float4 の配列を読むので、
+	 * 書き出し時に4ライト分を転置してそのまま書き込む.\n
+	 * 書き出し先はマップしたアップロードバッファを想定しているので、先頭から順に16byte単位で書き込み、読み戻しは行わない.
+	*****************************************************/
+	class PointLightSet
+	{
+	public:
+		PointLightSet()
+		{}
+		~PointLightSet()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief ライト数を指定して初期化する
+		 *
+		 * ライトはすべて原点、半径0、黒で初期化される
+		*/
+		bool Initialize(u32 count);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief ライトを設定する
+		*/
+		void SetLight(u32 index, const DirectX::XMFLOAT3& pos, float radius, const DirectX::XMFLOAT3& color);
+
+		/**
+		 * @brief ライトの座標と半径を取得する
+		 *
+		 * @return (xyz:座標, w:半径)
+		*/
+		DirectX::XMFLOAT4 GetPosAndRadius(u32 index) const;
+
+		/**
+		 * @brief ライトの座標を変換し、座標と半径を書き出す
+		 *
+		 * 保持している座標を変換後の座標で更新する.\n
+		 * 行列はアフィン変換であること. 半径はスケールしない.
+		 *
+		 * @param[in]	mtx					変換行列
+		 * @param[in]	first				変換するライトの先頭
+		 * @param[in]	count				変換するライト数
+		 * @param[out]	pOutPosAndRadius	first 番目のライトの書き出し先. float4 x count. nullptr の場合は書き出さない
+		*/
+		void Transform(const DirectX::XMMATRIX& mtx, u32 first, u32 count, DirectX::XMFLOAT4* pOutPosAndRadius);
+
+		/**
+		 * @brief 座標変換のスカラー版リファレンス
+		 *
+		 * ライトごとに XMVector3TransformCoord で変換する. Transform と同じ結果になる
+		*/
+		void TransformReference(const DirectX::XMMATRIX& mtx, u32 first, u32 count, DirectX::XMFLOAT4* pOutPosAndRadius);
+
+		/**
+		 * @brief ライトの座標と半径を書き出す
+		*/
+		void WritePosAndRadius(u32 first, u32 count, DirectX::XMFLOAT4* pOut) const;
+
+		/**
+		 * @brief ライトのカラーを書き出す
+		*/
+		void WriteColor(u32 first, u32 count, DirectX::XMFLOAT4* pOut) const;
+
+		//! @name 取得関数
+		//! @{
+		u32 GetLightCount() const
+		{
+			return numLights_;
+		}
+		u32 GetBlockCount() const
+		{
+			return static_cast<u32>(posBlocks_.size());
+		}
+		//! 4ライト分の座標と半径. x, y, z, 半径の順に4要素. 端数のレーンは0
+		const DirectX::XMVECTOR* GetPosBlock(u32 block) const
+		{
+			return posBlocks_[block].elements;
+		}
+		//! @}
+
+	private:
+		// SoAの各要素
+		// 毎フレーム変換する座標と半径、変換しないカラーは別のブロックに分けて、変換時に読むデータを減らす
+		enum
+		{
+			kPosX, kPosY, kPosZ, kRadius,
+
+			kPosElementMax
+		};
+		enum
+		{
+			kColorR, kColorG, kColorB,
+
+			kColorElementMax
+		};
+
+		struct PosBlock
+		{
+			DirectX::XMVECTOR	elements[kPosElementMax];
+		};	// struct PosBlock
+
+		struct ColorBlock
+		{
+			DirectX::XMVECTOR	elements[kColorElementMax];
+		};	// struct ColorBlock
+
+	private:
+		std::vector<PosBlock>	posBlocks_;
+		std::vector<ColorBlock>	colorBlocks_;
+		u32						numLights_ = 0;
+	};	// class PointLightSet
+
+}	// namespace sl12
+
+
+//	EOF
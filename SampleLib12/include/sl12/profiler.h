@@ -0,0 +1,290 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief 計測区間
+	 *
+	 * 時刻は計測元のティック単位.\n
+	 * name は計測元より長く生存する文字列 (文字列リテラルなど) を指す.
+	*****************************************************/
+	struct ProfileEvent
+	{
+		const char*	name = nullptr;
+		u64			begin = 0;
+		u64			end = 0;
+		u32			depth = 0;		//!< 入れ子の深さ. 最上位は0
+		u32			track = 0;		//!< スレッドやキューの番号
+	};	// struct ProfileEvent
+
+	/*************************************************//**
+	 * @brief 計測区間の統計
+	 *
+	 * トラックと親の区間が同じ同名の区間を1つの項目にまとめ、直近のフレームでの最小/平均/最大を求める.\n
+	 * 時刻はティック単位のまま受け取るので、GPU のタイムスタンプでも CPU の時刻でも同じように扱える.\n
+	 * D3D12 には依存しないので、デバイスなしで結果を確認できる.
+	*****************************************************/
+	class ProfileStats
+	{
+	public:
+		struct Entry
+		{
+			std::string		path;				//!< トラック番号と親の区間名を含めた名前. "0/Frame/Draw" など
+			std::string		name;
+			u32				depth = 0;
+			u32				track = 0;
+			float			lastMs = 0.0f;		//!< 最後に現れたフレームの時間
+			float			minMs = 0.0f;
+			float			avgMs = 0.0f;
+			float			maxMs = 0.0f;
+			u32				sampleCount = 0;	//!< 統計に含まれるフレーム数
+		};	// struct Entry
+
+	public:
+		ProfileStats()
+		{}
+		~ProfileStats()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		 *
+		 * @param[in]	historyCount	統計に含めるフレーム数
+		*/
+		bool Initialize(u32 historyCount);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief 1フレーム分の区間を追加する
+		 *
+		 * 区間はトラックごとに開始した順に並んでいること. トラック同士は混ざっていてもよい.\n
+		 * 同じフレームに同じ項目の区間が複数ある場合は合計する. フレームに現れなかった項目の統計は更新しない.
+		*/
+		void AddFrame(const ProfileEvent* events, size_t count, u64 ticksPerSecond);
+
+		//! @name 取得関数
+		//! @{
+		//! 親の項目の直後に子の項目が並ぶ. 兄弟は初めて現れた順
+		const std::vector<Entry>& GetEntries() const
+		{
+			return entries_;
+		}
+		u32 GetFrameCount() const
+		{
+			return frameCount_;
+		}
+		//! @}
+
+	private:
+		struct History
+		{
+			std::vector<float>	samples;		//!< 直近の時間. historyCount_ 個まで貯めたら古いものから上書きする
+			u32					next = 0;
+		};	// struct History
+
+		u32 FindOrAddEntry(const std::string& path, const std::string& parentPath, const ProfileEvent& e);
+
+	private:
+		u32									historyCount_ = 0;
+		u32									frameCount_ = 0;
+		std::vector<Entry>					entries_;
+		std::vector<History>				histories_;		//!< entries_ と同じ順
+		std::unordered_map<std::string, u32>	entryMap_;
+	};	// class ProfileStats
+
+	/*************************************************//**
+	 * @brief CPU の区間計測
+	 *
+	 * スレッドは初めて計測するときにバッファを1つ確保し、以降は他のスレッドと同期せずに自分のバッファに書き込む.\n
+	 * バッファの番号がそのままトラック番号になる.\n
+	 * CollectEvents はどのスレッドも計測していないとき (フレームの区切りなど) に呼ぶこと.
+	*****************************************************/
+	class CpuProfiler
+	{
+	public:
+		static const u32	kMaxDepth = 32;
+
+	public:
+		CpuProfiler()
+		{}
+		~CpuProfiler()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief 初期化する
+		 *
+		 * @param[in]	maxThreads			計測するスレッドの最大数
+		 * @param[in]	maxEventsPerThread	1スレッドが CollectEvents までに記録できる区間の最大数
+		*/
+		bool Initialize(u32 maxThreads, u32 maxEventsPerThread);
+
+		/**
+		 * @brief 破棄する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief 区間を開始/終了する
+		 *
+		 * バッファが一杯の場合やスレッド数が上限を超えた場合、区間は捨てられる.
+		*/
+		void BeginScope(const char* name);
+		void EndScope();
+
+		/**
+		 * @brief 呼び出したスレッドのトラック名を設定する
+		*/
+		void SetThreadName(const char* name);
+
+		/**
+		 * @brief 記録した区間を取り出し、バッファを空にする
+		 *
+		 * 区間はトラック順、トラック内では開始した順に並ぶ. 閉じていない区間は捨てる.
+		 *
+		 * @return 捨てた区間の数
+		*/
+		u32 CollectEvents(std::vector<ProfileEvent>& outEvents);
+
+		/**
+		 * @brief 現在の時刻を取得する
+		*/
+		static u64 GetTicks();
+		static u64 GetTicksPerSecond();
+
+		//! @name 取得関数
+		//! @{
+		u32 GetTrackCount() const;
+		const char* GetTrackName(u32 track) const;
+		//! @}
+
+	private:
+		struct ThreadBuffer
+		{
+			std::unique_ptr<ProfileEvent[]>	events;
+			u32								count = 0;
+			u32								depth = 0;
+			u32								stack[kMaxDepth];	//!< 開いている区間のインデックス
+			u32								dropped = 0;
+			const char*						name = nullptr;
+		};	// struct ThreadBuffer
+
+		ThreadBuffer* GetThreadBuffer();
+
+	private:
+		u32								id_ = 0;		//!< スレッドごとのバッファのキャッシュを区別する番号
+		u32								maxThreads_ = 0;
+		u32								maxEvents_ = 0;
+		std::unique_ptr<ThreadBuffer[]>	buffers_;
+		std::atomic<u32>				threadCount_{ 0 };	//!< 確保されたバッファ数. 上限を超えた分も数える
+	};	// class CpuProfiler
+
+	/*************************************************//**
+	 * @brief CPU の区間をスコープで計測する
+	*****************************************************/
+	class CpuProfileScope
+	{
+	public:
+		CpuProfileScope(CpuProfiler& profiler, const char* name)
+			: profiler_(profiler)
+		{
+			profiler_.BeginScope(name);
+		}
+		~CpuProfileScope()
+		{
+			profiler_.EndScope();
+		}
+
+	private:
+		CpuProfiler&	profiler_;
+	};	// class CpuProfileScope
+
+	/*************************************************//**
+	 * @brief Chrome トレース形式 (chrome://tracing, Perfetto) の JSON 出力
+	 *
+	 * プロセスごとに最初に追加した区間の開始時刻を0とするので、GPU と CPU のように時計が異なるものは別のプロセスにする.
+	*****************************************************/
+	class ChromeTraceWriter
+	{
+	public:
+		ChromeTraceWriter()
+		{}
+		~ChromeTraceWriter()
+		{}
+
+		void Clear();
+
+		/**
+		 * @brief プロセス、トラックの表示名を設定する
+		*/
+		void SetProcessName(u32 pid, const char* name);
+		void SetTrackName(u32 pid, u32 track, const char* name);
+
+		/**
+		 * @brief 区間を追加する
+		*/
+		void AddEvents(u32 pid, const ProfileEvent* events, size_t count, u64 ticksPerSecond);
+
+		/**
+		 * @brief JSON 文字列を作成する
+		*/
+		std::string ToString() const;
+
+		/**
+		 * @brief JSON をファイルに出力する
+		*/
+		bool WriteFile(const char* filename) const;
+
+		//! @name 取得関数
+		//! @{
+		size_t GetEventCount() const
+		{
+			return events_.size();
+		}
+		//! @}
+
+	private:
+		struct TraceEvent
+		{
+			std::string		name;
+			double			ts;			//!< マイクロ秒
+			double			dur;		//!< マイクロ秒
+			u32				pid;
+			u32				tid;
+		};	// struct TraceEvent
+
+		struct NameEntry
+		{
+			u32				pid;
+			u32				tid;
+			bool			isProcess;
+			std::string		name;
+		};	// struct NameEntry
+
+		void SetName(u32 pid, u32 tid, bool isProcess, const char* name);
+
+	private:
+		std::vector<TraceEvent>		events_;
+		std::vector<NameEntry>		names_;
+		std::unordered_map<u32, u64>	baseTicks_;		//!< プロセスごとの時刻の基準
+	};	// class ChromeTraceWriter
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+
+
+namespace sl12
+{
+	/**
+	 * @brief 32bitの整数ハッシュ (PCG hash)
+	 *
+	 * PCG の状態遷移と出力関数を1回だけ適用する.\n
+	 * シェーダ側の random.hlsli と同じ計算で、CPU で結果を確認するための参照実装を兼ねる.
+	*/
+	inline u32 PcgHash(u32 v)
+	{
+		u32 state = v * 747796405u + 2891336453u;
+		u32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	/**
+	 * @brief ピクセルとサンプル番号から乱数の状態を初期化する
+	 *
+	 * 状態はピクセル、サンプルごとに独立なので、共有のカウンタなしで並列に生成できる.
+	*/
+	inline u32 InitRandomState(u32 x, u32 y, u32 sampleIndex)
+	{
+		return PcgHash(x + PcgHash(y + PcgHash(sampleIndex)));
+	}
+
+	/**
+	 * @brief 状態を進めて32bitの乱数を返す (PCG-RXS-M-XS 32)
+	*/
+	inline u32 NextRandomU32(u32& state)
+	{
+		state = state * 747796405u + 2891336453u;
+		u32 word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	/**
+	 * @brief 状態を進めて [0, 1) の乱数を返す
+	 *
+	 * 上位24bitを使用するので、float で正確に表現できる.
+	*/
+	inline float NextRandom(u32& state)
+	{
+		return static_cast<float>(NextRandomU32(state) >> 8) * (1.0f / 16777216.0f);
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -1,189 +1,19 @@
 ﻿#pragma once
 
 #include <sl12/device.h>
+#include <sl12/command_list.h>
 #include <sl12/texture.h>
 #include <sl12/texture_view.h>
+#include <sl12/transient_memory_planner.h>
+#include <sl12/render_graph.h>
+#include <sl12/scheduled_command_lists.h>
 #include <vector>
 #include <map>
+#include <unordered_map>
 
 
 namespace sl12
 {
-	/************************************************//**
-	 * @brief リソースID
-	 *
-	 * 描画リソースの識別子.
-	 * ユニークか非ユニークか、一時リソースかなどによって使用する変数に違いがある.
-	****************************************************/
-	union ResourceID
-	{
-		sl12::u32				id;						//!< リソース全体のID
-		struct
-		{
-			union
-			{
-				sl12::u16		uniqueID;				//!< リソースに命名する際のユニークID
-				struct
-				{
-					sl12::u8	passNo;					//!< 前パス出力、もしくは一時リソースの主力元パス番号
-					sl12::u8	index;					//!< 前パス出力、もしくは一時リソースのリソースインデックス
-				};
-			};
-			sl12::u8			historyOffset;			//!< ヒストリーバッファのオフセット(0なら現在フレームのバッファ、1～の値は何フレーム遡ったバッファを使用するか)
-			sl12::u8			isPrevOutput	: 1;	//!< 前パス出力を使用するフラグ
-			sl12::u8			isTemporal		: 1;	//!< 一時リソースフラグ
-			sl12::u8			isSwapchain		: 1;	//!< スワップチェインフラグ
-		};
-
-		// operators
-		bool operator==(const ResourceID& x) const
-		{
-			return id == x.id;
-		}
-		bool operator!=(const ResourceID& x) const
-		{
-			return id != x.id;
-		}
-		bool operator<(const ResourceID& x) const
-		{
-			return id < x.id;
-		}
-
-		// 各種リソースID生成命令
-		static ResourceID CreateUniqueID(sl12::u16 unique_id)
-		{
-			ResourceID ret{};
-			ret.uniqueID = unique_id;
-			return ret;
-		}
-		static ResourceID CreateUniqueID(sl12::u16 unique_id, sl12::u8 history_offset)
-		{
-			ResourceID ret{};
-			ret.uniqueID = unique_id;
-			ret.historyOffset = history_offset;
-			return ret;
-		}
-		static ResourceID CreatePrevOutputID(sl12::u8 pass_no, sl12::u8 prev_index)
-		{
-			ResourceID ret{};
-			ret.passNo = pass_no;
-			ret.index = prev_index;
-			ret.isPrevOutput = 1;
-			return ret;
-		}
-		static ResourceID CreateTemporalID(sl12::u8 pass_no, sl12::u8 temp_index)
-		{
-			ResourceID ret{};
-			ret.passNo = pass_no;
-			ret.index = temp_index;
-			ret.isTemporal = 1;
-			return ret;
-		}
-		static ResourceID CreateSwapchainID()
-		{
-			ResourceID ret{};
-			ret.isSwapchain = 1;
-			return ret;
-		}
-	};	// struct ResourceID
-
-
-	/************************************************//**
-	 * @brief 描画リソース記述子
-	 *
-	 * 描画リソース生成、検索時に使用する.
-	****************************************************/
-	struct RenderResourceDesc
-	{
-		sl12::u32		width, height;				//!< バッファの幅と高さ
-		float			resolution_rate;			//!< スクリーンに対する解像度の割合(0以下の場合は width, height を使用する)
-		sl12::u32		mipLevels;					//!< ミップレベル(> 0)
-		DXGI_FORMAT		format;						//!< フォーマット
-		sl12::u32		sampleCount;				//!< サンプル数
-		sl12::u32		targetCount;				//!< RTV、もしくはDSVの数(ミップレベル以下)
-		sl12::u32		srvCount;					//!< SRVの数(ミップレベル+1以下)
-		sl12::u32		uavCount;					//!< UAVの数(ミップレベル以下)
-		sl12::u32		historyMax;					//!< ヒストリーバッファとしての保持フレーム数(0なら現在フレームのみ使用する)
-
-		RenderResourceDesc()
-			: width(0), height(0)
-			, resolution_rate(1.0f)
-			, mipLevels(1)
-			, format(DXGI_FORMAT_UNKNOWN)
-			, sampleCount(1)
-			, targetCount(1)
-			, srvCount(1)
-			, uavCount(0)
-			, historyMax(0)
-		{}
-
-		bool operator==(const RenderResourceDesc& d) const
-		{
-			if (resolution_rate > 0.0f)
-			{
-				if (resolution_rate != d.resolution_rate) { return false; }
-			}
-			else
-			{
-				if (width != d.width || height != d.height) { return false; }
-			}
-			// NOTE: ヒストリー数が一致しなくても同一記述子とみなす
-			return (mipLevels == d.mipLevels)
-				&& (format == d.format)
-				&& (sampleCount == d.sampleCount)
-				&& (targetCount == d.targetCount)
-				&& (srvCount == d.srvCount)
-				&& (uavCount == d.uavCount);
-		}
-
-		RenderResourceDesc& SetSize(sl12::u32 w, sl12::u32 h)
-		{
-			width = w;
-			height = h;
-			return *this;
-		}
-		RenderResourceDesc& SetResolutionRate(float r)
-		{
-			resolution_rate = r;
-			return *this;
-		}
-		RenderResourceDesc& SetMipLevels(sl12::u32 m)
-		{
-			mipLevels = m;
-			return *this;
-		}
-		RenderResourceDesc& SetFormat(DXGI_FORMAT f)
-		{
-			format = f;
-			return *this;
-		}
-		RenderResourceDesc& SetSampleCount(sl12::u32 c)
-		{
-			sampleCount = c;
-			return *this;
-		}
-		RenderResourceDesc& SetTargetCount(sl12::u32 c)
-		{
-			targetCount = c;
-			return *this;
-		}
-		RenderResourceDesc& SetSrvCount(sl12::u32 c)
-		{
-			srvCount = c;
-			return *this;
-		}
-		RenderResourceDesc& SetUavCount(sl12::u32 c)
-		{
-			uavCount = c;
-			return *this;
-		}
-		RenderResourceDesc& SetHistoryMax(sl12::u32 c)
-		{
-			historyMax = c;
-			return *this;
-		}
-	};	// struct RenderResourceDesc
-
 	/************************************************//**
 	 * @brief 描画リソース
 	 *
@@ -200,9 +30,19 @@ namespace sl12
 			Destroy();
 		}
 
-		bool Initialize(sl12::Device& device, const RenderResourceDesc& desc, sl12::u32 screenWidth, sl12::u32 screenHeight, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+		/**
+		 * @brief 初期化する
+		 *
+		 * pHeap を指定した場合はヒープ上の heapOffset の位置に配置する
+		*/
+		bool Initialize(sl12::Device& device, const RenderResourceDesc& desc, sl12::u32 screenWidth, sl12::u32 screenHeight, D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, ID3D12Heap* pHeap = nullptr, sl12::u64 heapOffset = 0);
 		void Destroy();
 
+		/**
+		 * @brief 描画リソース記述子からテクスチャ記述子を作成する
+		*/
+		static bool MakeTextureDesc(const RenderResourceDesc& desc, sl12::u32 screenWidth, sl12::u32 screenHeight, D3D12_RESOURCE_STATES initialState, sl12::TextureDesc* pOut);
+
 		bool IsSameDesc(const RenderResourceDesc& d) const
 		{
 			return d == desc_;
@@ -223,6 +63,16 @@ namespace sl12
 			return !uavs_.empty();
 		}
 
+		bool IsPlaced() const
+		{
+			return isPlaced_;
+		}
+
+		const RenderResourceDesc& GetDesc() const
+		{
+			return desc_;
+		}
+
 		//! @name 設定関数
 		//! @{
 		void SetState(D3D12_RESOURCE_STATES s)
@@ -293,202 +143,26 @@ namespace sl12
 		ResourceID								lastID_;			//!< 最後に使用された時のID
 		int										history_ = 0;		//!< 現在のヒストリー番号(進行フレーム)
 		int										historyMax_ = 0;	//!< ヒストリーとして保存する最大フレーム
+		bool									isPlaced_ = false;	//!< 一時リソース用のヒープに配置されているか
 	};	// class RenderResource
 
 	/************************************************//**
-	 * @brief リソースプロデューサー基底
-	 *
-	 * リソースのR/Wを管理するプロデューサークラスの基底です.\n
-	 * インターフェースとして機能します.
-	****************************************************/
-	class ResourceProducerBase
-	{
-	public:
-		//! @name 取得関数
-		//! @{
-		sl12::u32 GetInputCount() const
-		{
-			return inputCount_;
-		}
-		const ResourceID* GetInputIds() const
-		{
-			return pInputIds_;
-		}
-		const D3D12_RESOURCE_STATES* GetInputPrevStates() const
-		{
-			return pInputPrevStates_;
-		}
-
-		sl12::u32 GetOutputCount() const
-		{
-			return outputCount_;
-		}
-		const ResourceID* GetOutputIds() const
-		{
-			return pOutputIds_;
-		}
-		const RenderResourceDesc* GetOutputDescs() const
-		{
-			return pOutputDescs_;
-		}
-		const D3D12_RESOURCE_STATES* GetOutputPrevStates() const
-		{
-			return pOutputPrevStates_;
-		}
-
-		sl12::u32 GetTempCount() const
-		{
-			return tempCount_;
-		}
-		const ResourceID* GetTempIds() const
-		{
-			return pTempIds_;
-		}
-		const RenderResourceDesc* GetTempDescs() const
-		{
-			return pTempDescs_;
-		}
-		const D3D12_RESOURCE_STATES* GetTempPrevStates() const
-		{
-			return pTempPrevStates_;
-		}
-		//! @}
-
-		//! @name 設定関数
-		//! @{
-		void SetInput(sl12::u32 index, ResourceID id)
-		{
-			assert(index < inputCount_);
-			pInputIds_[index] = id;
-		}
-		void SetInputUnique(sl12::u32 index, sl12::u16 unique_id)
-		{
-			assert(index < inputCount_);
-			pInputIds_[index] = ResourceID::CreateUniqueID(unique_id);
-		}
-		void SetInputUnique(sl12::u32 index, sl12::u16 unique_id, sl12::u8 history)
-		{
-			assert(index < inputCount_);
-			pInputIds_[index] = ResourceID::CreateUniqueID(unique_id, history);
-		}
-		void SetInputFromPrevOutput(sl12::u32 index, sl12::u32 prevOutputIndex)
-		{
-			assert(index < inputCount_);
-			pInputIds_[index] = ResourceID::CreatePrevOutputID(0, prevOutputIndex);
-		}
-		void SetInputPrevState(sl12::u32 index, D3D12_RESOURCE_STATES state)
-		{
-			assert(index < inputCount_);
-			pInputPrevStates_[index] = state;
-		}
-
-		void SetOutput(sl12::u32 index, ResourceID id, const RenderResourceDesc& desc)
-		{
-			assert(index < outputCount_);
-			pOutputIds_[index] = id;
-			pOutputDescs_[index] = desc;
-		}
-		void SetOutputUnique(sl12::u32 index, sl12::u16 unique_id, const RenderResourceDesc& desc)
-		{
-			assert(index < outputCount_);
-			pOutputIds_[index] = ResourceID::CreateUniqueID(unique_id);
-			pOutputDescs_[index] = desc;
-		}
-		void SetOutputUnique(sl12::u32 index, sl12::u16 unique_id, sl12::u8 history, const RenderResourceDesc& desc)
-		{
-			assert(index < outputCount_);
-			pOutputIds_[index] = ResourceID::CreateUniqueID(unique_id, history);
-			pOutputDescs_[index] = desc;
-		}
-		void SetOutputForNextPass(sl12::u32 index, const RenderResourceDesc& desc)
-		{
-			assert(index < outputCount_);
-			pOutputIds_[index] = ResourceID::CreatePrevOutputID(0, (sl12::u8)index);
-			pOutputDescs_[index] = desc;
-		}
-		void SetOutputSwapchain(sl12::u32 index)
-		{
-			assert(index < outputCount_);
-			pOutputIds_[index] = ResourceID::CreateSwapchainID();
-		}
-		void SetOutputID(sl12::u32 index, ResourceID id)
-		{
-			assert(index < outputCount_);
-			pOutputIds_[index] = id;
-		}
-		void SetOutputPrevState(sl12::u32 index, D3D12_RESOURCE_STATES state)
-		{
-			assert(index < outputCount_);
-			pOutputPrevStates_[index] = state;
-		}
-
-		void SetTemp(sl12::u32 index, const RenderResourceDesc& desc)
-		{
-			assert(index < tempCount_);
-			pTempDescs_[index] = desc;
-		}
-		void SetTempID(sl12::u32 index, ResourceID id)
-		{
-			assert(index < tempCount_);
-			pTempIds_[index] = id;
-		}
-		void SetTempPrevState(sl12::u32 index, D3D12_RESOURCE_STATES state)
-		{
-			assert(index < tempCount_);
-			pTempPrevStates_[index] = state;
-		}
-		//! @}
-
-	protected:
-		ResourceProducerBase(
-			sl12::u32 inputCount, sl12::u32 outputCount, sl12::u32 tempCount,
-			ResourceID* resIds, RenderResourceDesc* resDescs, D3D12_RESOURCE_STATES* pPrevStates)
-			: inputCount_(inputCount), pInputIds_(resIds), pInputPrevStates_(pPrevStates)
-			, outputCount_(outputCount), pOutputIds_(resIds + inputCount), pOutputDescs_(resDescs), pOutputPrevStates_(pPrevStates + inputCount)
-			, tempCount_(tempCount), pTempIds_(resIds + inputCount + outputCount), pTempDescs_(resDescs + outputCount), pTempPrevStates_(pPrevStates + inputCount + outputCount)
-		{}
-
-	protected:
-		sl12::u32				inputCount_;
-		ResourceID*				pInputIds_;
-		D3D12_RESOURCE_STATES*	pInputPrevStates_;
-
-		sl12::u32				outputCount_;
-		ResourceID*				pOutputIds_;
-		RenderResourceDesc*		pOutputDescs_;
-		D3D12_RESOURCE_STATES*	pOutputPrevStates_;
-
-		sl12::u32				tempCount_;
-		ResourceID*				pTempIds_;
-		RenderResourceDesc*		pTempDescs_;
-		D3D12_RESOURCE_STATES*	pTempPrevStates_;
-	};	// class ResourceProducerBase
-
-	/************************************************//**
-	 * @brief リソースプロデューサー
-	 *
-	 * 基底クラスで取り扱うデータを保持するテンプレートクラス.
+	 * @brief 一時リソースのメモリ使用量
 	****************************************************/
-	template <sl12::u32 InputCount, sl12::u32 OutputCount, sl12::u32 TempCount>
-	class ResourceProducer
-		: public ResourceProducerBase
+	struct TransientMemoryStats
 	{
-	public:
-		ResourceProducer()
-			: ResourceProducerBase(InputCount, OutputCount, TempCount, resourceIds_, resourceDescs_, prevStates_)
-		{}
-
-	private:
-		ResourceID				resourceIds_[InputCount + OutputCount + TempCount];
-		RenderResourceDesc		resourceDescs_[OutputCount + TempCount];
-		D3D12_RESOURCE_STATES	prevStates_[InputCount + OutputCount + TempCount];
-	};	// class ResourceProducer
+		sl12::u64		heapSize = 0;			//!< 一時リソース用ヒープのサイズ
+		sl12::u64		peakLiveSize = 0;		//!< 同時に生存する一時リソースの合計サイズの最大値
+		sl12::u64		totalSize = 0;			//!< メモリを共有しない場合の合計サイズ
+		sl12::u32		resourceCount = 0;		//!< 一時リソースの数
+	};	// struct TransientMemoryStats
 
 	/************************************************//**
 	 * @brief 描画リソースマネージャ
 	 *
 	 * 描画リソースの生成と管理を行う.\n
-	 * 基本的に、一度生成した描画リソースは削除しない.
+	 * 基本的に、一度生成した描画リソースは削除しない.\n
+	 * プロデューサーの構成から求めたリソースの使用情報はキャッシュし、構成が変わった場合のみ作り直す.
 	****************************************************/
 	class RenderResourceManager
 	{
@@ -505,6 +179,49 @@ namespace sl12
 
 		void MakeResources(std::vector<ResourceProducerBase*>& producers);
 
+		/**
+		 * @brief 一時リソースのメモリ共有を有効にする
+		 *
+		 * ヒストリーを持たないRTV/DSVの出力を1つのヒープに配置し、使用区間が重ならないもの同士でメモリを共有する.\n
+		 * 共有したリソースは最初に出力されるパスの BarrierOutputResources でエイリアシングバリアとDiscardが行われるので、
+		 * 出力前の内容は不定になる.\n
+		 * MakeResources を呼び出す前に設定すること.
+		*/
+		void SetTransientAliasing(bool enable)
+		{
+			isTransientAliasing_ = enable;
+		}
+
+		/**
+		 * @brief 一時リソースのメモリ使用量を取得する
+		*/
+		const TransientMemoryStats& GetTransientMemoryStats() const
+		{
+			return transientStats_;
+		}
+
+		/**
+		 * @brief 非同期コンピュートを有効にする
+		 *
+		 * Compute のプロデューサーのうち、一時リソースとスワップチェインを使用しないものを非同期コンピュートキューに割り当てる.\n
+		 * 有効にした場合は ScheduledCommandLists を受け取るバリア関数を使用すること.\n
+		 * MakeResources を呼び出す前に設定すること.
+		*/
+		void SetAsyncCompute(bool enable)
+		{
+			isAsyncCompute_ = enable;
+		}
+
+		/**
+		 * @brief パスのキューへの割り当てと同期の計画を取得する
+		 *
+		 * パスの番号は MakeResources に渡したプロデューサーの順番.
+		*/
+		const RenderSchedule& GetSchedule() const
+		{
+			return graph_.GetSchedule();
+		}
+
 		/**
 		 * @brief 入力リソースにバリアを張る
 		*/
@@ -520,10 +237,23 @@ namespace sl12
 		*/
 		void BarrierAllResources(CommandList& cmdList, const ResourceProducerBase* pProd)
 		{
+			cmdList.BeginBarrierBatch();
 			BarrierInputResources(cmdList, pProd);
 			BarrierOutputResources(cmdList, pProd);
+			cmdList.EndBarrierBatch();
 		}
 
+		/**
+		 * @brief 計画に従ってパスのコマンドリストにバリアを張る
+		 *
+		 * 非同期コンピュートキューのパスで、コンピュートキューでは遷移できないステートのバリアは
+		 * 事前に実行されるグラフィクスキューのコマンドリストに張る.
+		 * @return pProd が MakeResources に渡されておらず計画に含まれていない場合は、何も記録せずに false
+		*/
+		bool BarrierInputResources(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd);
+		bool BarrierOutputResources(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd);
+		bool BarrierAllResources(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd);
+
 		/**
 		 * @brief IDから描画リソースを取得する
 		*/
@@ -534,14 +264,44 @@ namespace sl12
 		}
 
 	private:
+		// ヒープに配置した一時リソース
+		struct TransientResource
+		{
+			ResourceID				id;
+			RenderResourceDesc		desc;
+			sl12::u32				firstPass;
+			sl12::u64				offset;
+			sl12::u64				size;
+			sl12::u32				aliasBefore;
+			bool					isShared;
+			RenderResource*			pResource;
+		};	// struct TransientResource
+
 		void AllReset();
+		void CompileTransients(const std::vector<ResourceProducerBase*>& producers);
+		void DestroyTransients();
+		void BarrierTransientResources(CommandList& cmdList, const ResourceProducerBase* pProd);
+		void DiscardTransientResources(CommandList& cmdList, const ResourceProducerBase* pProd);
+		void BarrierInputResourcesDetail(CommandList& cmdList, CommandList* pPrologue, const ResourceProducerBase* pProd);
+		void BarrierOutputResourcesDetail(CommandList& cmdList, CommandList* pPrologue, const ResourceProducerBase* pProd);
+		CommandList* GetPassCommandLists(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd, CommandList** ppPrologue);
 
 	private:
 		sl12::Device*							pDevice_;
 		sl12::u32								screenWidth_, screenHeight_;
 
 		std::vector<RenderResource*>			resources_;
-		std::map<ResourceID, RenderResource*>	resource_map_;
+		std::unordered_map<ResourceID, RenderResource*, ResourceIDHash>	resource_map_;
+		RenderGraph								graph_;		//!< 毎フレーム変化するのはヒストリーの進行のみなので、構成が同じ間は使い回す
+
+		bool										isTransientAliasing_ = false;
+		ID3D12Heap*									pTransientHeap_ = nullptr;
+		std::vector<TransientResource>				transients_;
+		std::unordered_map<ResourceID, RenderResource*, ResourceIDHash>	transientMap_;
+		std::unordered_map<const ResourceProducerBase*, sl12::u32>		passIndices_;
+		TransientMemoryStats						transientStats_;
+
+		bool										isAsyncCompute_ = false;
 	};	// class RenderResourceManager
 
 }	// namespace sl12
@@ -0,0 +1,124 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <vector>
+#include <string>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief パスを実行するキュー
+	*****************************************************/
+	enum class QueueType
+	{
+		Graphics,
+		Compute,
+
+		Max
+	};	// enum class QueueType
+
+	/*************************************************//**
+	 * @brief パスのキューへの割り当てと同期の計画
+	 *
+	 * 各パスが読み書きするリソースから依存関係を求め、コンピュートのパスを非同期コンピュートキューに割り当てる.\n
+	 * パスの実行順は入力の順番のままで、キューごとに連続したパスをバッチ(1つのコマンドリスト)にまとめる.\n
+	 * 別のキューのパスに依存する場合はバッチを分け、依存先のバッチのシグナルを待つ.\n
+	 * D3D12 には依存しないので、デバイスなしで結果を確認できる.
+	*****************************************************/
+	class RenderSchedule
+	{
+	public:
+		static const u32	kInvalidIndex = 0xffffffff;
+
+		struct PassDesc
+		{
+			std::vector<u32>	reads;					//!< 読み込むリソースのキー
+			std::vector<u32>	writes;					//!< 書き込むリソースのキー
+			bool				isCompute = false;		//!< コンピュートシェーダでリソースにアクセスするか
+			bool				allowAsync = false;		//!< 非同期コンピュートキューで実行してよいか
+		};	// struct PassDesc
+
+		struct Batch
+		{
+			QueueType			queue;
+			u32					queueSeq;				//!< 同じキューのバッチ内での順番
+			std::vector<u32>	passes;					//!< 実行するパス番号. 空の場合は待機のみ行う
+			std::vector<u32>	waitBatches;			//!< 実行前に完了を待つ、他のキューのバッチ
+			bool				signal;					//!< 完了時にシグナルするか
+		};	// struct Batch
+
+	public:
+		RenderSchedule()
+		{}
+		~RenderSchedule()
+		{}
+
+		void Clear();
+
+		/**
+		 * @brief パスの情報から計画を作成する
+		 *
+		 * コンピュートのパスは、直後のグラフィクスキューのパスがそのパスに依存しない場合のみ非同期にする.\n
+		 * 依存する場合は非同期にしても並行して実行できるパスがないので、グラフィクスキューで実行する.\n
+		 * 最後のバッチはグラフィクスキューで、すべてのコンピュートキューのバッチを待つ.
+		*/
+		void Build(const std::vector<PassDesc>& passes);
+
+		/**
+		 * @brief 計画を文字列にする
+		*/
+		std::string Dump() const;
+
+		//! @name 取得関数
+		//! @{
+		u32 GetPassCount() const
+		{
+			return static_cast<u32>(passQueues_.size());
+		}
+		u32 GetBatchCount() const
+		{
+			return static_cast<u32>(batches_.size());
+		}
+		const Batch& GetBatch(u32 index) const
+		{
+			return batches_[index];
+		}
+		QueueType GetPassQueue(u32 pass) const
+		{
+			return passQueues_[pass];
+		}
+		u32 GetPassBatch(u32 pass) const
+		{
+			return passBatches_[pass];
+		}
+		//! 非同期のパスのうち、グラフィクスキューで事前にバリアを張る必要があるパスのバリアを積むバッチ. 必要ない場合は kInvalidIndex
+		u32 GetPrologueBatch(u32 pass) const
+		{
+			return prologueBatches_[pass];
+		}
+		//! 直接依存するパス
+		const std::vector<u32>& GetDependencies(u32 pass) const
+		{
+			return dependencies_[pass];
+		}
+		//! @}
+
+	private:
+		void BuildDependencies(const std::vector<PassDesc>& passes);
+		void AssignQueues(const std::vector<PassDesc>& passes);
+		void BuildBatches();
+
+	private:
+		std::vector<std::vector<u32>>	dependencies_;
+		std::vector<QueueType>			passQueues_;
+		std::vector<u32>				prologuePasses_;
+		std::vector<u32>				passBatches_;
+		std::vector<u32>				prologueBatches_;
+		std::vector<Batch>				batches_;
+	};	// class RenderSchedule
+
+}	// namespace sl12
+
+
+//	EOF
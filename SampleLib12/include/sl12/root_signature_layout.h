@@ -0,0 +1,127 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <vector>
+
+
+namespace sl12
+{
+	struct ShaderVisibility
+	{
+		enum Type
+		{
+			Vertex			= 0x01 << 0,
+			Pixel			= 0x01 << 1,
+			Geometry		= 0x01 << 2,
+			Domain			= 0x01 << 3,
+			Hull			= 0x01 << 4,
+			Compute			= 0x01 << 5,
+
+			All				= Vertex | Pixel | Geometry | Domain | Hull | Compute
+		};
+	};	// struct ShaderVisibility
+
+	struct RootParameterType
+	{
+		enum Type
+		{
+			ConstantBuffer,
+			ShaderResource,
+			UnorderedAccess,
+			Sampler,
+
+			Max
+		};
+	};	// struct RootParameterType
+
+	struct RootParameter
+	{
+		RootParameterType::Type		type;
+		u32							shaderVisibility;
+		u32							registerIndex;
+		u32							registerSpace;
+
+		RootParameter(RootParameterType::Type t = RootParameterType::ConstantBuffer, u32 shaderVis = ShaderVisibility::All, u32 regIndex = 0, u32 regSpace = 0)
+			: type(t), shaderVisibility(shaderVis), registerIndex(regIndex), registerSpace(regSpace)
+		{}
+	};	// struct RootParameter
+
+	/*************************************************//**
+	 * @brief ルートシグネチャのデスクリプタテーブル配置
+	 *
+	 * RootParameter の配列から、各ルートパラメータ(デスクリプタテーブル)と
+	 * その中のレンジの配置を決定する. D3D12に依存しない.\n
+	 * packTables が false の場合は RootParameter 1つにつき1つのテーブルを作る.\n
+	 * true の場合はリソースタイプとレジスタスペースが同じものを1つのテーブルにまとめ、
+	 * 連続したレジスタは1つのレンジにまとめる.
+	*****************************************************/
+	class RootSignatureLayout
+	{
+	public:
+		struct Range
+		{
+			RootParameterType::Type		type;
+			u32							baseRegister;
+			u32							registerSpace;
+			u32							numDescriptors;
+			u32							offsetInTable;
+		};	// struct Range
+
+		struct Table
+		{
+			RootParameterType::Type		type;
+			u32							shaderVisibility;
+			u32							firstRange;
+			u32							numRanges;
+			u32							numDescriptors;
+		};	// struct Table
+
+		struct Location
+		{
+			u32		tableIndex;
+			u32		offsetInTable;
+		};	// struct Location
+
+	public:
+		RootSignatureLayout()
+		{}
+		~RootSignatureLayout()
+		{}
+
+		/**
+		 * @brief 配置を決定する
+		*/
+		void Plan(const RootParameter* pParams, u32 numParams, bool packTables);
+
+		//! @name 取得関数
+		//! @{
+		const std::vector<Table>& GetTables() const
+		{
+			return tables_;
+		}
+		const std::vector<Range>& GetRanges() const
+		{
+			return ranges_;
+		}
+		// 入力した RootParameter ごとの配置
+		const std::vector<Location>& GetLocations() const
+		{
+			return locations_;
+		}
+		// ルートシグネチャのサイズ(DWORD). デスクリプタテーブルは1つにつき1DWORD
+		u32 GetRootDWordCost() const
+		{
+			return static_cast<u32>(tables_.size());
+		}
+		//! @}
+
+	private:
+		std::vector<Table>		tables_;
+		std::vector<Range>		ranges_;
+		std::vector<Location>	locations_;
+	};	// class RootSignatureLayout
+
+}	// namespace sl12
+
+
+//	EOF
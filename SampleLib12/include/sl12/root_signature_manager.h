@@ -7,8 +7,14 @@
 #include <sl12/buffer_view.h>
 #include <sl12/texture_view.h>
 #include <sl12/sampler.h>
+#include <sl12/crc.h>
+#include <sl12/descriptor.h>
+#include <sl12/descriptor_staging.h>
+#include <sl12/shader_set_key.h>
+#include <sl12/binding_table.h>
 #include <atomic>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 
@@ -25,6 +31,10 @@ namespace sl12
 		Shader*		pDS = nullptr;
 		Shader*		pHS = nullptr;
 		Shader*		pCS = nullptr;
+
+		// true の場合、同じタイプとレジスタスペースのリソースを1つのデスクリプタテーブルにまとめる
+		// まとめたテーブルは DescriptorSet を使って設定する
+		bool		packTables = false;
 	};	// struct RootSignatureCreateDesc
 
 	/*************************************************//**
@@ -34,6 +44,7 @@ namespace sl12
 	{
 		friend class RootSignatureManager;
 		friend class RootSignatureHandle;
+		friend class DescriptorSet;
 
 	private:
 		~RootSignatureInstance()
@@ -43,7 +54,9 @@ namespace sl12
 
 	private:
 		RootSignature								rootSig_;
-		std::map<std::string, std::vector<int>>		slotMap_;
+		RootSignatureLayout							layout_;
+		BindingTable								bindings_;
+		ShaderSetKey								key_;			// キー衝突時の比較用. 生成元のバイトコードを保持する
 		std::atomic<int>							referenceCounter_ = 0;
 		bool										isGraphics_ = true;
 	};	// struct RootSignatureInstance
@@ -54,13 +67,14 @@ namespace sl12
 	class RootSignatureHandle
 	{
 		friend class RootSignatureManager;
+		friend class DescriptorSet;
 
 	public:
 		RootSignatureHandle()
-			: pManager_(nullptr), crc_(0), pInstance_(nullptr)
+			: pManager_(nullptr), hash_(0), pInstance_(nullptr)
 		{}
 		RootSignatureHandle(RootSignatureHandle& h)
-			: pManager_(h.pManager_), crc_(h.crc_), pInstance_(h.pInstance_)
+			: pManager_(h.pManager_), hash_(h.hash_), pInstance_(h.pInstance_)
 		{
 			if (pInstance_)
 			{
@@ -75,7 +89,7 @@ namespace sl12
 		RootSignatureHandle& operator=(RootSignatureHandle& h)
 		{
 			pManager_ = h.pManager_;
-			crc_ = h.crc_;
+			hash_ = h.hash_;
 			pInstance_ = h.pInstance_;
 			if (pInstance_)
 			{
@@ -91,21 +105,50 @@ namespace sl12
 
 		void Invalid();
 
-		bool SetDescriptor(CommandList& cmdList, const char* name, ConstantBufferView& cbv);
-		bool SetDescriptor(CommandList& cmdList, const char* name, TextureView& srv);
-		bool SetDescriptor(CommandList& cmdList, const char* name, BufferView& srv);
-		bool SetDescriptor(CommandList& cmdList, const char* name, Sampler& sam);
-		bool SetDescriptor(CommandList& cmdList, const char* name, UnorderedAccessView& uav);
+		/**
+		 * @brief 名前からバインドスロットを検索する
+		 *
+		 * 見つからない場合は無効なスロットを返す
+		*/
+		BindingSlot FindSlot(const BindingName& name) const;
+
+		/**
+		 * @brief 名前を解決してデスクリプタを設定する
+		*/
+		bool SetDescriptor(CommandList& cmdList, const BindingName& name, ConstantBufferView& cbv);
+		bool SetDescriptor(CommandList& cmdList, const BindingName& name, TextureView& srv);
+		bool SetDescriptor(CommandList& cmdList, const BindingName& name, BufferView& srv);
+		bool SetDescriptor(CommandList& cmdList, const BindingName& name, Sampler& sam);
+		bool SetDescriptor(CommandList& cmdList, const BindingName& name, UnorderedAccessView& uav);
+
+		/**
+		 * @brief 解決済みのスロットにデスクリプタを設定する
+		 *
+		 * 名前の検索を行わない.\n
+		 * 複数のデスクリプタをまとめたテーブルには設定できないので、DescriptorSet を使用すること
+		*/
+		bool SetDescriptor(CommandList& cmdList, BindingSlot slot, ConstantBufferView& cbv);
+		bool SetDescriptor(CommandList& cmdList, BindingSlot slot, TextureView& srv);
+		bool SetDescriptor(CommandList& cmdList, BindingSlot slot, BufferView& srv);
+		bool SetDescriptor(CommandList& cmdList, BindingSlot slot, Sampler& sam);
+		bool SetDescriptor(CommandList& cmdList, BindingSlot slot, UnorderedAccessView& uav);
 
 		RootSignature* GetRootSignature()
 		{
 			assert(IsValid());
 			return &pInstance_->rootSig_;
 		}
+		const RootSignatureLayout& GetLayout() const
+		{
+			assert(IsValid());
+			return pInstance_->layout_;
+		}
 
 	private:
-		RootSignatureHandle(RootSignatureManager* man, u32 crc, RootSignatureInstance* ins)
-			: pManager_(man), crc_(crc), pInstance_(ins)
+		bool SetDescriptorTable(CommandList& cmdList, BindingSlot slot, D3D12_GPU_DESCRIPTOR_HANDLE handle);
+
+		RootSignatureHandle(RootSignatureManager* man, u64 hash, RootSignatureInstance* ins)
+			: pManager_(man), hash_(hash), pInstance_(ins)
 		{
 			if (pInstance_)
 			{
@@ -115,10 +158,78 @@ namespace sl12
 
 	private:
 		RootSignatureManager*		pManager_;
-		u32							crc_;
+		u64							hash_;
 		RootSignatureInstance*		pInstance_;
 	};	// class RootSignatureHandle
 
+	/*************************************************//**
+	 * @brief デスクリプタセット
+	 *
+	 * ルートシグネチャの各テーブルに設定するデスクリプタを集め、
+	 * Bind で DescriptorStaging の連続領域にコピーしてテーブルごとに1回で設定する.\n
+	 * デスクリプタはコピー元ヒープのハンドルとして保持する.\n
+	 * ルートシグネチャのハンドルは複製して保持するので、RootSignatureManager より先に破棄すること.
+	*****************************************************/
+	class DescriptorSet
+	{
+	public:
+		DescriptorSet()
+		{}
+		~DescriptorSet()
+		{
+			Destroy();
+		}
+
+		/**
+		 * @brief ルートシグネチャに合わせて初期化する
+		 *
+		 * Bind の前にすべてのデスクリプタを設定すること
+		*/
+		void Initialize(RootSignatureHandle& handle);
+
+		/**
+		 * @brief ルートシグネチャの参照を解放する
+		*/
+		void Destroy();
+
+		/**
+		 * @brief 設定したデスクリプタをすべて未設定に戻す
+		*/
+		void Reset();
+
+		/**
+		 * @brief デスクリプタを設定する
+		 *
+		 * View は GetDesc() で Descriptor を返すビューまたはサンプラー
+		*/
+		template <typename View>
+		bool SetDescriptor(BindingSlot slot, View& view)
+		{
+			return SetHandle(slot, view.GetDesc()->GetCpuCopySourceHandle());
+		}
+		template <typename View>
+		bool SetDescriptor(const BindingName& name, View& view)
+		{
+			return SetHandle(handle_.FindSlot(name), view.GetDesc()->GetCpuCopySourceHandle());
+		}
+
+		/**
+		 * @brief ステージング領域にコピーしてテーブルを設定する
+		 *
+		 * @param[in]	pViewStaging		CBV/SRV/UAV 用のステージング領域
+		 * @param[in]	pSamplerStaging		サンプラー用のステージング領域. サンプラーがない場合は nullptr でよい
+		*/
+		bool Bind(CommandList& cmdList, DescriptorStaging* pViewStaging, DescriptorStaging* pSamplerStaging = nullptr);
+
+	private:
+		bool SetHandle(BindingSlot slot, D3D12_CPU_DESCRIPTOR_HANDLE handle);
+
+	private:
+		RootSignatureHandle							handle_;
+		std::vector<u32>							tableOffsets_;		// handles_ 上の各テーブルの開始位置
+		std::vector<D3D12_CPU_DESCRIPTOR_HANDLE>	handles_;
+	};	// class DescriptorSet
+
 	/*************************************************//**
 	 * @brief ルートシグネチャマネージャ
 	*****************************************************/
@@ -146,11 +257,13 @@ namespace sl12
 		/**
 		 * @brief ルートシグネチャを解放する
 		*/
-		void ReleaseRootSignature(u32 crc, RootSignatureInstance* pInst);
+		void ReleaseRootSignature(u64 hash, RootSignatureInstance* pInst);
 
 	private:
-		Device*									pDevice_ = nullptr;
-		std::map<u32, RootSignatureInstance*>	instanceMap_;
+		typedef std::unordered_multimap<u64, RootSignatureInstance*>	InstanceMap;
+
+		Device*			pDevice_ = nullptr;
+		InstanceMap		instanceMap_;
 	};
 }	// namespace sl12
 
@@ -0,0 +1,93 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <sl12/command_list.h>
+#include <sl12/fence.h>
+#include <sl12/render_schedule.h>
+#include <vector>
+
+
+namespace sl12
+{
+	class Device;
+
+	/**
+	 * @brief RenderSchedule のバッチごとのコマンドリスト
+	 *
+	 * フレームごとにバッチの数だけコマンドリストを用意し、計画どおりにキュー間の待機とシグナルを行って実行する.\n
+	 * 計画はコマンドの記録開始時にコピーするので、実行までに計画が変わってもよい.
+	 * 最後のバッチはグラフィクスキューで他のすべてのバッチを待つので、グラフィクスキューの完了を待てばフレームの完了を待ったことになる.
+	*/
+	class ScheduledCommandLists
+	{
+	public:
+		static const u32	kQueueCount = static_cast<u32>(QueueType::Max);
+
+	public:
+		ScheduledCommandLists()
+		{}
+		~ScheduledCommandLists()
+		{
+			Destroy();
+		}
+
+		bool Initialize(Device* pDev, u32 frameCount);
+		void Destroy();
+
+		/**
+		 * @brief フレームのコマンドの記録を開始する
+		 *
+		 * 計画のバッチの数だけコマンドリストをリセットする.\n
+		 * 前回このフレームで記録したコマンドは実行が完了していなければならない.
+		*/
+		void Begin(const RenderSchedule& schedule, u32 frameIndex);
+
+		/**
+		 * @brief 記録中のコマンドリストをすべて閉じる
+		*/
+		void Close();
+
+		/**
+		 * @brief 記録済みのフレームを実行する
+		*/
+		void Execute(u32 frameIndex);
+
+		// getter
+		u32 GetBatchCount() const { return static_cast<u32>(frames_[currentFrame_].batches.size()); }
+		QueueType GetBatchQueue(u32 batch) const { return frames_[currentFrame_].batches[batch].queue; }
+		CommandList& GetBatchCommandList(u32 batch) { return *frames_[currentFrame_].batches[batch].pCmdList; }
+		CommandList& GetPassCommandList(u32 pass) { return GetBatchCommandList(frames_[currentFrame_].passBatches[pass]); }
+		//! 最後のバッチ. 必ずグラフィクスキューで、すべてのパスの後に実行される
+		CommandList& GetLastCommandList() { return GetBatchCommandList(GetBatchCount() - 1); }
+		//! 非同期のパスが、事前にグラフィクスキューでバリアを張るコマンドリスト. 必要ない場合は nullptr
+		CommandList* GetPrologueCommandList(u32 pass);
+
+	private:
+		struct Batch
+		{
+			QueueType			queue;
+			CommandList*		pCmdList;
+			std::vector<u32>	waitBatches;
+			bool				signal;
+		};	// struct Batch
+
+		struct Frame
+		{
+			std::vector<CommandList*>	cmdLists[kQueueCount];
+			std::vector<Batch>			batches;
+			std::vector<u32>			passBatches;
+			std::vector<u32>			prologueBatches;
+			std::vector<u32>			signalValues;
+		};	// struct Frame
+
+	private:
+		Device*				pDevice_{ nullptr };
+		std::vector<Frame>	frames_;
+		u32					currentFrame_{ 0 };
+		Fence				fences_[kQueueCount];
+		u32					fenceValues_[kQueueCount]{};
+	};	// class ScheduledCommandLists
+
+}	// namespace sl12
+
+//	EOF
@@ -40,10 +40,13 @@ namespace sl12
 		const void* GetData() const { return pData_; }
 		size_t GetSize() const { return size_; }
 		ShaderType::Type GetShaderType() const { return shaderType_; }
+		// バイトコードの64bitハッシュ. 初期化時に1度だけ計算する
+		u64 GetHash() const { return hash_; }
 
 	private:
 		u8*					pData_{ nullptr };
 		size_t				size_{ 0 };
+		u64					hash_{ 0 };
 		ShaderType::Type	shaderType_{ ShaderType::Max };
 	};	// class Shader
 
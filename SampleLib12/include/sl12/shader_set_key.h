@@ -0,0 +1,66 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief キーの生成に使用するシェーダのバイトコード
+	 *
+	 * hash はバイトコードから計算済みの値. 未使用のステージは pData を nullptr とする
+	*****************************************************/
+	struct ShaderCodeRef
+	{
+		const void*		pData = nullptr;
+		size_t			size = 0;
+		u64				hash = 0;
+	};	// struct ShaderCodeRef
+
+	/*************************************************//**
+	 * @brief シェーダの組み合わせによるキャッシュキー
+	 *
+	 * 検索には各ステージのハッシュを組み合わせた64bit値を使い、
+	 * 一致した場合はコピーしておいたバイトコードを比較してハッシュの衝突を検出する.
+	*****************************************************/
+	class ShaderSetKey
+	{
+	public:
+		/**
+		 * @brief 検索用のハッシュを計算する
+		 *
+		 * @param[in]	pCodes		ステージごとのバイトコード
+		 * @param[in]	numCodes	ステージ数
+		 * @param[in]	variant		シェーダ以外の生成条件
+		*/
+		static u64 CalcHash(const ShaderCodeRef* pCodes, u32 numCodes, u32 variant);
+
+		/**
+		 * @brief バイトコードをコピーしてキーを設定する
+		*/
+		void Store(const ShaderCodeRef* pCodes, u32 numCodes, u32 variant);
+
+		/**
+		 * @brief 同じシェーダの組み合わせか比較する
+		 *
+		 * ハッシュとサイズが一致した場合はバイトコードを比較する
+		*/
+		bool IsSame(const ShaderCodeRef* pCodes, u32 numCodes, u32 variant) const;
+
+	private:
+		struct Stage
+		{
+			u64					hash = 0;
+			std::vector<u8>		code;
+			bool				isUsed = false;
+		};	// struct Stage
+
+		std::vector<Stage>		stages_;
+		u32						variant_ = 0;
+	};	// class ShaderSetKey
+
+}	// namespace sl12
+
+
+//	EOF
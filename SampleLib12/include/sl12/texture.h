@@ -9,6 +9,7 @@ namespace sl12
 	class Device;
 	class CommandList;
 	class Swapchain;
+	class UploadManager;
 
 	// テクスチャの次元
 	struct TextureDimension
@@ -43,6 +44,7 @@ namespace sl12
 	class Texture
 	{
 		friend class CommandList;
+		friend class UploadManager;
 
 	public:
 		Texture()
@@ -53,22 +55,39 @@ namespace sl12
 		}
 
 		bool Initialize(Device* pDev, const TextureDesc& desc);
+		/**
+		 * @brief ヒープ上に配置されたテクスチャとして初期化する
+		 *
+		 * 同じメモリを別のリソースと共有する場合、最初の使用前にエイリアシングバリアと
+		 * クリア、またはDiscardが必要になる
+		*/
+		bool InitializePlaced(Device* pDev, const TextureDesc& desc, ID3D12Heap* pHeap, u64 heapOffset);
 		bool InitializeFromDXImage(Device* pDev, const DirectX::ScratchImage& image, bool isForceSRGB);
 		bool InitializeFromTGA(Device* pDev, CommandList* pCmdList, const void* pTgaBin, size_t size, bool isForceSRGB);
+		bool InitializeFromTGA(Device* pDev, UploadManager* pUploader, const void* pTgaBin, size_t size, bool isForceSRGB);
 		bool InitializeFromPNG(Device* pDev, CommandList* pCmdList, const void* pPngBin, size_t size, bool isForceSRGB);
+		bool InitializeFromPNG(Device* pDev, UploadManager* pUploader, const void* pPngBin, size_t size, bool isForceSRGB);
 		bool InitializeFromImageBin(Device* pDev, CommandList* pCmdList, const TextureDesc& desc, const void* pImageBin);
 		bool InitializeFromSwapchain(Device* pDev, Swapchain* pSwapchain, int bufferIndex);
 
 		bool UpdateImage(Device* pDev, CommandList* pCmdList, const DirectX::ScratchImage& image, ID3D12Resource** ppSrcImage);
 		bool UpdateImage(Device* pDev, CommandList* pCmdList, const void* pImageBin, ID3D12Resource** ppSrcImage);
+		bool UpdateImage(UploadManager* pUploader, const DirectX::ScratchImage& image);
+		bool UpdateImage(UploadManager* pUploader, const void* pImageBin);
 
 		void Destroy();
 
+		// 配置に必要なサイズとアライメントを取得する
+		static D3D12_RESOURCE_ALLOCATION_INFO GetAllocationInfo(Device* pDev, const TextureDesc& desc);
+
 		// getter
 		ID3D12Resource* GetResourceDep() { return pResource_; }
 		const TextureDesc& GetTextureDesc() const { return textureDesc_; }
 		const D3D12_RESOURCE_DESC& GetResourceDesc() const { return resourceDesc_; }
 
+	private:
+		D3D12_CLEAR_VALUE* SetupResourceDesc(const TextureDesc& desc);
+
 	private:
 		ID3D12Resource*			pResource_{ nullptr };
 		TextureDesc				textureDesc_{};
@@ -6,6 +6,7 @@
 namespace sl12
 {
 	class Device;
+	class CommandList;
 
 	class Timestamp
 	{
@@ -28,6 +29,10 @@ namespace sl12
 
 		size_t GetTimestamp(size_t start_index, size_t count, uint64_t* pOut);
 
+		// getter
+		size_t GetCount() const { return currentCount_; }
+		size_t GetMaxCount() const { return maxCount_; }
+
 	private:
 		ID3D12QueryHeap*		pQuery_ = nullptr;
 		ID3D12Resource*			pResource_ = nullptr;
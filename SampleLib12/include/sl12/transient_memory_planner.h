@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <vector>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief 一時リソースのメモリ配置を計画する
+	 *
+	 * 各リソースの使用区間(最初と最後に使用するパス番号)とサイズから、
+	 * 共有ヒープ内のオフセットを決める.\n
+	 * 使用区間が重ならないリソース同士は同じメモリを共有する.\n
+	 * D3D12 には依存しないので、パス構成だけで結果を確認できる.
+	*****************************************************/
+	class TransientMemoryPlanner
+	{
+	public:
+		static const u32	kInvalidIndex = 0xffffffff;
+
+		struct Request
+		{
+			u32		firstPass;
+			u32		lastPass;
+			u64		size;
+			u64		alignment;
+		};	// struct Request
+
+		struct Placement
+		{
+			u64		offset;
+			u32		aliasBefore;		//!< 同じメモリを先に使用していたリソース. ないか、複数ある場合は kInvalidIndex
+			bool	isShared;			//!< 他のリソースとメモリを共有しているか
+		};	// struct Placement
+
+	public:
+		TransientMemoryPlanner()
+		{}
+		~TransientMemoryPlanner()
+		{}
+
+		void Clear();
+
+		/**
+		 * @brief リソースを追加する
+		 *
+		 * @return 追加したリソースのインデックス
+		*/
+		u32 AddResource(const Request& req);
+
+		/**
+		 * @brief 配置を計画する
+		 *
+		 * サイズの大きい順に、使用区間が重なるリソースのメモリを避けて最も低いオフセットに配置する
+		*/
+		void Plan();
+
+		//! @name 取得関数
+		//! @{
+		u32 GetResourceCount() const
+		{
+			return static_cast<u32>(requests_.size());
+		}
+		const Request& GetRequest(u32 index) const
+		{
+			return requests_[index];
+		}
+		const Placement& GetPlacement(u32 index) const
+		{
+			return placements_[index];
+		}
+		//! 計画に必要なヒープサイズ
+		u64 GetHeapSize() const
+		{
+			return heapSize_;
+		}
+		//! 同時に生存するリソースの合計サイズの最大値. ヒープサイズの下限
+		u64 GetPeakLiveSize() const
+		{
+			return peakLiveSize_;
+		}
+		//! メモリを共有しない場合の合計サイズ
+		u64 GetTotalSize() const
+		{
+			return totalSize_;
+		}
+		//! @}
+
+	private:
+		std::vector<Request>	requests_;
+		std::vector<Placement>	placements_;
+		u64						heapSize_ = 0;
+		u64						peakLiveSize_ = 0;
+		u64						totalSize_ = 0;
+	};	// class TransientMemoryPlanner
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,133 @@
+﻿#pragma once
+
+#include <sl12/util.h>
+#include <sl12/command_list.h>
+#include <sl12/upload_ring_allocator.h>
+#include <functional>
+#include <vector>
+
+
+namespace DirectX
+{
+	class ScratchImage;
+}
+
+namespace sl12
+{
+	class Device;
+	class CommandQueue;
+	class Buffer;
+	class Texture;
+
+	/*************************************************//**
+	 * @brief アップロードマネージャ
+	 *
+	 * 永続的にマップされたアップロードバッファをリングとして使用し、
+	 * 複数のコピー命令を1つのコマンドリストにまとめて発行する.\n
+	 * フェンスはバッチ単位で1つだけ発行され、完了時にコールバックが呼ばれる.
+	*****************************************************/
+	class UploadManager
+		: private UploadRingBackend
+	{
+	public:
+		typedef std::function<void()>	CompleteFunc;
+
+		static const u32	kMaxBatch = 3;
+
+	public:
+		UploadManager()
+		{}
+		~UploadManager()
+		{
+			Destroy();
+		}
+
+		bool Initialize(Device* pDev, CommandQueue* pQueue, u64 ringSize = 32 * 1024 * 1024);
+		void Destroy();
+
+		/**
+		 * @brief バッファへのアップロードを登録する
+		*/
+		bool EnqueueBuffer(Buffer* pDst, const void* pData, size_t size, size_t dstOffset = 0, CompleteFunc func = nullptr);
+
+		/**
+		 * @brief テクスチャへのアップロードを登録する
+		 *
+		 * サブリソース数分のイメージを登録する
+		*/
+		bool EnqueueTexture(Texture* pDst, const DirectX::ScratchImage& image, CompleteFunc func = nullptr);
+		bool EnqueueTexture(Texture* pDst, const void* pImageBin, CompleteFunc func = nullptr);
+
+		/**
+		 * @brief 登録済みのコピー命令を発行する
+		 *
+		 * @return 発行したバッチのフェンス値、発行するものがない場合は最後に発行したフェンス値
+		*/
+		u64 Flush();
+
+		/**
+		 * @brief 完了したバッチを回収してコールバックを呼び出す
+		*/
+		void Update();
+
+		/**
+		 * @brief 指定のフェンス値まで待機する
+		*/
+		void WaitFence(u64 value);
+
+		/**
+		 * @brief すべての命令を発行し、完了まで待機する
+		*/
+		void WaitIdle();
+
+		//! @name 取得関数
+		//! @{
+		u64 GetCompletedValue() const;
+		u64 GetLastSubmittedValue() const
+		{
+			return fenceValue_ - 1;
+		}
+		const UploadRingAllocator& GetRingAllocator() const
+		{
+			return ring_;
+		}
+		//! @}
+
+	private:
+		struct BatchInfo
+		{
+			CommandList						cmdList_;
+			u64								fenceValue_ = 0;
+			bool							isRecording_ = false;
+			std::vector<CompleteFunc>		callbacks_;
+			std::vector<ID3D12Resource*>	tempResources_;
+		};	// struct BatchInfo
+
+		BatchInfo* BeginRecord();
+		u8* AllocateStaging(u64 size, u64 alignment, ID3D12Resource** ppRes, u64* pOffset);
+		void RetireBatch(BatchInfo& batch);
+
+		// UploadRingBackend
+		u64 SubmitPending() override;
+		void WaitAndRetire(u64 fenceValue) override;
+
+	private:
+		Device*					pDevice_ = nullptr;
+		CommandQueue*			pQueue_ = nullptr;
+
+		ID3D12Resource*			pRingResource_ = nullptr;
+		u8*						pRingData_ = nullptr;
+		UploadRingAllocator		ring_;
+
+		ID3D12Fence*			pFence_ = nullptr;
+		HANDLE					hEvent_ = nullptr;
+		u64						fenceValue_ = 1;
+
+		BatchInfo				batches_[kMaxBatch];
+		u32						currentBatch_ = 0;
+	};	// class UploadManager
+
+}	// namespace sl12
+
+
+//	EOF
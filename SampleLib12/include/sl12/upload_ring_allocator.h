@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include <sl12/types.h>
+#include <deque>
+
+
+namespace sl12
+{
+	/*************************************************//**
+	 * @brief アップロードリングのバッチを発行・待機する先
+	 *
+	 * UploadRingAllocator::AllocateWait は空きがない場合にこのインターフェースを通じて
+	 * バッチの発行と完了待ちを行う.\n
+	 * 差し替えればGPUなしで動作を確認できる.
+	*****************************************************/
+	class UploadRingBackend
+	{
+	public:
+		virtual ~UploadRingBackend()
+		{}
+
+		/**
+		 * @brief 記録中のバッチを発行する
+		 *
+		 * 発行したフェンス値で UploadRingAllocator::CloseBatch を呼び出すこと
+		 *
+		 * @return 発行したフェンス値、発行できなかった場合は0
+		*/
+		virtual u64 SubmitPending() = 0;
+
+		/**
+		 * @brief 指定のフェンス値の完了を待つ
+		 *
+		 * 完了したフェンス値で UploadRingAllocator::Retire を呼び出すこと
+		*/
+		virtual void WaitAndRetire(u64 fenceValue) = 0;
+	};	// class UploadRingBackend
+
+	/*************************************************//**
+	 * @brief アップロード用リングアロケータ
+	 *
+	 * GPUに依存しないステージングメモリの割り当て管理.\n
+	 * 割り当てはバッチ単位でフェンス値と紐付けられ、
+	 * フェンス値が完了した時点でまとめて解放される.
+	*****************************************************/
+	class UploadRingAllocator
+	{
+	public:
+		UploadRingAllocator()
+		{}
+		~UploadRingAllocator()
+		{}
+
+		void Initialize(u64 capacity);
+
+		/**
+		 * @brief 領域を割り当てる
+		 *
+		 * 空き領域が足りない場合は false を返す
+		*/
+		bool Allocate(u64 size, u64 alignment, u64* pOffset);
+
+		/**
+		 * @brief 空きができるまで待機して領域を割り当てる
+		 *
+		 * 記録中のバッチを発行し、それでも足りなければ発行済みの最も古いバッチの完了を待つ.\n
+		 * 発行も待機もできない、または待機したバッチが解放されない場合は false を返す
+		*/
+		bool AllocateWait(u64 size, u64 alignment, UploadRingBackend* pBackend, u64* pOffset);
+
+		/**
+		 * @brief 現在のバッチを閉じてフェンス値と紐付ける
+		*/
+		void CloseBatch(u64 fenceValue);
+
+		/**
+		 * @brief 完了したフェンス値までのバッチを解放する
+		*/
+		void Retire(u64 completedFenceValue);
+
+		//! @name 取得関数
+		//! @{
+		u64 GetCapacity() const
+		{
+			return capacity_;
+		}
+		u64 GetUsedSize() const
+		{
+			return usedSize_;
+		}
+		u64 GetPendingSize() const
+		{
+			return pendingSize_;
+		}
+		u32 GetInFlightBatchCount() const
+		{
+			return static_cast<u32>(batches_.size());
+		}
+		bool IsEmpty() const
+		{
+			return usedSize_ == 0;
+		}
+		//! @}
+
+	private:
+		struct Batch
+		{
+			u64		fenceValue;
+			u64		size;
+		};	// struct Batch
+
+		u64					capacity_ = 0;
+		u64					head_ = 0;
+		u64					usedSize_ = 0;
+		u64					pendingSize_ = 0;
+		std::deque<Batch>	batches_;
+	};	// class UploadRingAllocator
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,214 @@
+﻿#include <sl12/barrier_batch.h>
+
+
+namespace sl12
+{
+	namespace
+	{
+		inline ID3D12Resource* GetBarrierResource(const D3D12_RESOURCE_BARRIER& b)
+		{
+			switch (b.Type)
+			{
+			case D3D12_RESOURCE_BARRIER_TYPE_TRANSITION:
+				return b.Transition.pResource;
+			case D3D12_RESOURCE_BARRIER_TYPE_ALIASING:
+				return b.Aliasing.pResourceAfter;
+			case D3D12_RESOURCE_BARRIER_TYPE_UAV:
+				return b.UAV.pResource;
+			default:
+				return nullptr;
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 指定リソースを参照している最後のバリアを探す
+	//---------------------------------------
+	int BarrierBatch::FindLastReference(ID3D12Resource* pResource) const
+	{
+		for (int i = static_cast<int>(pending_.size()) - 1; i >= 0; --i)
+		{
+			if (GetBarrierResource(pending_[i]) == pResource)
+			{
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	//---------------------------------------
+	// 遷移バリアをそのまま積む
+	//---------------------------------------
+	void BarrierBatch::PushTransition(ID3D12Resource* pResource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after, D3D12_RESOURCE_BARRIER_FLAGS flags)
+	{
+		D3D12_RESOURCE_BARRIER barrier;
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = flags;
+		barrier.Transition.pResource = pResource;
+		barrier.Transition.StateBefore = before;
+		barrier.Transition.StateAfter = after;
+		barrier.Transition.Subresource = subresource;
+		pending_.push_back(barrier);
+	}
+
+	//---------------------------------------
+	// 遷移バリアを積む
+	//---------------------------------------
+	void BarrierBatch::Transition(ID3D12Resource* pResource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+	{
+		assert(pResource != nullptr);
+
+		// 分割バリアの途中なら先に終了させる
+		EndSplit(pResource, subresource);
+
+		if (before == after)
+		{
+			return;
+		}
+
+		while (true)
+		{
+			int last = FindLastReference(pResource);
+			if (last < 0)
+			{
+				break;
+			}
+
+			D3D12_RESOURCE_BARRIER& prev = pending_[last];
+			if (prev.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+			{
+				// 遷移は以前のアクセスの完了を待つので、直前のUAVバリアは不要
+				pending_.erase(pending_.begin() + last);
+				continue;
+			}
+			if (prev.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION
+				|| prev.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE
+				|| prev.Transition.Subresource != subresource
+				|| prev.Transition.StateAfter != before)
+			{
+				break;
+			}
+
+			if (prev.Transition.StateBefore != after)
+			{
+				// A→B, B→C を A→C にまとめる
+				prev.Transition.StateAfter = after;
+				return;
+			}
+
+			// A→B→A は打ち消す
+			// ただしUAVの書き込み同士の順序は遷移によって保証されていたので、UAVバリアに置き換える
+			pending_.erase(pending_.begin() + last);
+			if (after & D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
+			{
+				UAV(pResource);
+			}
+			return;
+		}
+
+		PushTransition(pResource, subresource, before, after, D3D12_RESOURCE_BARRIER_FLAG_NONE);
+	}
+
+	//---------------------------------------
+	// UAVバリアを積む
+	//---------------------------------------
+	void BarrierBatch::UAV(ID3D12Resource* pResource)
+	{
+		int last = FindLastReference(pResource);
+		if (last >= 0)
+		{
+			const D3D12_RESOURCE_BARRIER& prev = pending_[last];
+			if (prev.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+			{
+				return;
+			}
+			if (prev.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && prev.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE)
+			{
+				// 完了した遷移の後にはGPUの処理が入らないので、同期はすでに取れている
+				return;
+			}
+		}
+
+		D3D12_RESOURCE_BARRIER barrier;
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.UAV.pResource = pResource;
+		pending_.push_back(barrier);
+	}
+
+	//---------------------------------------
+	// エイリアシングバリアを積む
+	//---------------------------------------
+	void BarrierBatch::Aliasing(ID3D12Resource* pBefore, ID3D12Resource* pAfter)
+	{
+		assert(pAfter != nullptr);
+
+		D3D12_RESOURCE_BARRIER barrier;
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_ALIASING;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.Aliasing.pResourceBefore = pBefore;
+		barrier.Aliasing.pResourceAfter = pAfter;
+		pending_.push_back(barrier);
+	}
+
+	//---------------------------------------
+	// 分割バリアを開始する
+	//---------------------------------------
+	void BarrierBatch::BeginSplit(ID3D12Resource* pResource, UINT subresource, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after)
+	{
+		assert(pResource != nullptr);
+
+		EndSplit(pResource, subresource);
+		if (before == after)
+		{
+			return;
+		}
+
+		PushTransition(pResource, subresource, before, after, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+		splits_.push_back(Split{ pResource, subresource, before, after });
+	}
+
+	//---------------------------------------
+	// 分割バリアを終了する
+	//---------------------------------------
+	bool BarrierBatch::EndSplit(ID3D12Resource* pResource, UINT subresource)
+	{
+		for (auto it = splits_.begin(); it != splits_.end(); ++it)
+		{
+			if (it->pResource == pResource && it->subresource == subresource)
+			{
+				PushTransition(it->pResource, it->subresource, it->before, it->after, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY);
+				splits_.erase(it);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//---------------------------------------
+	// 積まれたバリアを発行する
+	//---------------------------------------
+	void BarrierBatch::Flush(BarrierSink& sink)
+	{
+		if (pending_.empty())
+		{
+			return;
+		}
+
+		sink.ResourceBarrier(static_cast<UINT>(pending_.size()), pending_.data());
+		pending_.clear();
+	}
+
+	//---------------------------------------
+	// 積まれたバリアと分割バリアの状態を破棄する
+	//---------------------------------------
+	void BarrierBatch::Clear()
+	{
+		pending_.clear();
+		splits_.clear();
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,45 @@
+﻿#include <sl12/binding_table.h>
+
+#include <algorithm>
+
+
+namespace sl12
+{
+	//----
+	void BindingTable::Add(const std::string& name, const Target* pTargets, u32 numTargets)
+	{
+		Binding binding;
+		binding.name = name;
+		binding.nameHash = CalcFnv1a32(name.c_str());
+		binding.firstTarget = static_cast<u32>(targets_.size());
+		binding.numTargets = numTargets;
+		targets_.insert(targets_.end(), pTargets, pTargets + numTargets);
+		bindings_.push_back(binding);
+	}
+
+	//----
+	void BindingTable::Finalize()
+	{
+		std::stable_sort(bindings_.begin(), bindings_.end(),
+			[](const Binding& l, const Binding& r) { return l.nameHash < r.nameHash; });
+	}
+
+	//----
+	BindingSlot BindingTable::Find(const BindingName& name) const
+	{
+		auto it = std::lower_bound(bindings_.begin(), bindings_.end(), name.hash,
+			[](const Binding& b, u32 hash) { return b.nameHash < hash; });
+		for (; it != bindings_.end() && it->nameHash == name.hash; ++it)
+		{
+			if (it->name == name.name)
+			{
+				return BindingSlot(static_cast<u32>(it - bindings_.begin()));
+			}
+		}
+		return BindingSlot();
+	}
+
+}	// namespace sl12
+
+
+//	EOF
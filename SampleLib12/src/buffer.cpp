@@ -3,6 +3,7 @@
 #include <sl12/device.h>
 #include <sl12/command_list.h>
 #include <sl12/fence.h>
+#include <sl12/upload_manager.h>
 
 
 namespace sl12
@@ -88,12 +89,26 @@ namespace sl12
 
 	//----
 	void Buffer::UpdateBuffer(Device* pDev, CommandList* pCmdList, const void* pData, size_t size, size_t offset)
+	{
+		if (!pData)
+		{
+			return;
+		}
+
+		FillBuffer(pDev, pCmdList, size, offset, [pData, size](void* pDst)
+		{
+			memcpy(pDst, pData, size);
+		});
+	}
+
+	//----
+	void Buffer::FillBuffer(Device* pDev, CommandList* pCmdList, size_t size, size_t offset, const FillFunc& func)
 	{
 		if (!pDev || !pCmdList)
 		{
 			return;
 		}
-		if (!pData || !size)
+		if (!func || !size)
 		{
 			return;
 		}
@@ -105,7 +120,11 @@ namespace sl12
 		if (heapProp_.Type == D3D12_HEAP_TYPE_UPLOAD)
 		{
 			u8* p = reinterpret_cast<u8*>(Map(pCmdList));
-			memcpy(p + offset, pData, size);
+			if (!p)
+			{
+				return;
+			}
+			func(p + offset);
 			Unmap();
 		}
 		else
@@ -115,10 +134,10 @@ namespace sl12
 			{
 				return;
 			}
-			src.UpdateBuffer(pDev, pCmdList, pData, size, 0);
+			src.FillBuffer(pDev, pCmdList, size, 0, func);
 
 			pCmdList->Reset();
-			pCmdList->GetCommandList()->CopyBufferRegion(pResource_, offset, src.pResource_, 0, size);
+			pCmdList->CopyBufferRegion(pResource_, offset, src.pResource_, 0, size);
 			pCmdList->Close();
 			pCmdList->Execute();
 
@@ -136,6 +155,18 @@ namespace sl12
 
 	}
 
+	//----
+	bool Buffer::UpdateBuffer(UploadManager* pUploader, const void* pData, size_t size, size_t offset)
+	{
+		if (!pUploader)
+		{
+			return false;
+		}
+
+		// コピー命令の発行と完了待ちはアップロードマネージャ側でまとめて行う
+		return pUploader->EnqueueBuffer(this, pData, size, offset);
+	}
+
 	//----
 	void* Buffer::Map(CommandList*)
 	{
@@ -33,7 +33,8 @@ namespace sl12
 		D3D12_CONSTANT_BUFFER_VIEW_DESC viewDesc{};
 		viewDesc.BufferLocation = pBuffer->GetResourceDep()->GetGPUVirtualAddress();
 		viewDesc.SizeInBytes = static_cast<u32>(pBuffer->GetResourceDesc().Width);
-		pDev->GetDeviceDep()->CreateConstantBufferView(&viewDesc, pDesc_->GetCpuHandle());
+		pDev->GetDeviceDep()->CreateConstantBufferView(&viewDesc, pDesc_->GetCpuCopySourceHandle());
+		pDesc_->Commit();
 
 		return true;
 	}
@@ -123,7 +124,8 @@ namespace sl12
 			return false;
 		}
 
-		pDev->GetDeviceDep()->CreateShaderResourceView(pBuffer->GetResourceDep(), &viewDesc, pDesc_->GetCpuHandle());
+		pDev->GetDeviceDep()->CreateShaderResourceView(pBuffer->GetResourceDep(), &viewDesc, pDesc_->GetCpuCopySourceHandle());
+		pDesc_->Commit();
 
 		return true;
 	}
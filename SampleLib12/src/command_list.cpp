@@ -54,11 +54,18 @@ namespace sl12
 
 		hr = pCmdList_->Reset(pCmdAllocator_, nullptr);
 		assert(SUCCEEDED(hr));
+
+		// 前回の記録で発行されなかったバリアは破棄する
+		assert(barrierBatch_.GetOpenSplitCount() == 0);
+		barrierBatch_.Clear();
+		barrierBatchDepth_ = 0;
 	}
 
 	//----
 	void CommandList::Close()
 	{
+		FlushBarriers();
+
 		auto hr = pCmdList_->Close();
 		assert(SUCCEEDED(hr));
 	}
@@ -78,14 +85,8 @@ namespace sl12
 
 		if (p->currentState_ != nextState)
 		{
-			D3D12_RESOURCE_BARRIER barrier;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			barrier.Transition.pResource = p->pResource_;
-			barrier.Transition.StateBefore = p->currentState_;
-			barrier.Transition.StateAfter = nextState;
-			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-			GetCommandList()->ResourceBarrier(1, &barrier);
+			barrierBatch_.Transition(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, p->currentState_, nextState);
+			FlushBarriersIfImmediate();
 
 			p->currentState_ = nextState;
 		}
@@ -99,14 +100,8 @@ namespace sl12
 
 		if (p->currentState_ != nextState)
 		{
-			D3D12_RESOURCE_BARRIER barrier;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			barrier.Transition.pResource = p->pResource_;
-			barrier.Transition.StateBefore = p->currentState_;
-			barrier.Transition.StateAfter = nextState;
-			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-			GetCommandList()->ResourceBarrier(1, &barrier);
+			barrierBatch_.Transition(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, p->currentState_, nextState);
+			FlushBarriersIfImmediate();
 
 			p->currentState_ = nextState;
 		}
@@ -120,14 +115,8 @@ namespace sl12
 
 		if (prevState != nextState)
 		{
-			D3D12_RESOURCE_BARRIER barrier;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			barrier.Transition.pResource = p->pResource_;
-			barrier.Transition.StateBefore = prevState;
-			barrier.Transition.StateAfter = nextState;
-			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-			GetCommandList()->ResourceBarrier(1, &barrier);
+			barrierBatch_.Transition(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, prevState, nextState);
+			FlushBarriersIfImmediate();
 		}
 	}
 
@@ -139,14 +128,8 @@ namespace sl12
 
 		if (prevState != nextState)
 		{
-			D3D12_RESOURCE_BARRIER barrier;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			barrier.Transition.pResource = p->pResource_;
-			barrier.Transition.StateBefore = prevState;
-			barrier.Transition.StateAfter = nextState;
-			barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-			GetCommandList()->ResourceBarrier(1, &barrier);
+			barrierBatch_.Transition(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, prevState, nextState);
+			FlushBarriersIfImmediate();
 		}
 	}
 
@@ -156,27 +139,186 @@ namespace sl12
 		if (!p)
 			return;
 
+		barrierBatch_.UAV(p->pResource_);
+		FlushBarriersIfImmediate();
+	}
+
+	//----
+	void CommandList::UAVBarrier(Buffer* p)
+	{
+		if (!p)
+			return;
+
+		barrierBatch_.UAV(p->pResource_);
+		FlushBarriersIfImmediate();
+	}
+
+	//----
+	void CommandList::AliasingBarrier(Texture* pBefore, Texture* pAfter)
+	{
+		if (!pAfter)
+			return;
+
+		barrierBatch_.Aliasing(pBefore ? pBefore->pResource_ : nullptr, pAfter->pResource_);
+		FlushBarriersIfImmediate();
+	}
+
+	//----
+	void CommandList::BeginSplitBarrier(Texture* p, D3D12_RESOURCE_STATES nextState)
+	{
+		if (!p)
+			return;
+
+		if (p->currentState_ != nextState)
+		{
+			barrierBatch_.BeginSplit(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, p->currentState_, nextState);
+			FlushBarriersIfImmediate();
+
+			p->currentState_ = nextState;
+		}
+	}
+
+	//----
+	void CommandList::BeginSplitBarrier(Buffer* p, D3D12_RESOURCE_STATES nextState)
+	{
+		if (!p)
+			return;
+
+		if (p->currentState_ != nextState)
 		{
-			D3D12_RESOURCE_BARRIER barrier;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			barrier.UAV.pResource = p->pResource_;
-			GetCommandList()->ResourceBarrier(1, &barrier);
+			barrierBatch_.BeginSplit(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, p->currentState_, nextState);
+			FlushBarriersIfImmediate();
+
+			p->currentState_ = nextState;
 		}
 	}
 
 	//----
-	void CommandList::UAVBarrier(Buffer* p)
+	void CommandList::EndSplitBarrier(Texture* p)
 	{
 		if (!p)
 			return;
 
+		if (barrierBatch_.EndSplit(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES))
+		{
+			FlushBarriersIfImmediate();
+		}
+	}
+
+	//----
+	void CommandList::EndSplitBarrier(Buffer* p)
+	{
+		if (!p)
+			return;
+
+		if (barrierBatch_.EndSplit(p->pResource_, D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES))
+		{
+			FlushBarriersIfImmediate();
+		}
+	}
+
+	//----
+	void CommandList::SetDeferredBarriers(bool enable)
+	{
+		isBarrierDeferred_ = enable;
+		FlushBarriersIfImmediate();
+	}
+
+	//----
+	void CommandList::FlushBarriers()
+	{
+		// コマンドリストに直接発行する
+		class Sink
+			: public BarrierSink
+		{
+		public:
+			Sink(ID3D12GraphicsCommandList* p)
+				: pCmdList_(p)
+			{}
+			void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) override
+			{
+				pCmdList_->ResourceBarrier(numBarriers, pBarriers);
+			}
+
+		private:
+			ID3D12GraphicsCommandList*	pCmdList_;
+		};	// class Sink
+
+		Sink sink(pCmdList_);
+		barrierBatch_.Flush(sink);
+	}
+
+	//----
+	void CommandList::DrawInstanced(UINT vertexCountPerInstance, UINT instanceCount, UINT startVertexLocation, UINT startInstanceLocation)
+	{
+		FlushBarriers();
+		pCmdList_->DrawInstanced(vertexCountPerInstance, instanceCount, startVertexLocation, startInstanceLocation);
+	}
+
+	//----
+	void CommandList::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation)
+	{
+		FlushBarriers();
+		pCmdList_->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+	}
+
+	//----
+	void CommandList::Dispatch(UINT threadGroupCountX, UINT threadGroupCountY, UINT threadGroupCountZ)
+	{
+		FlushBarriers();
+		pCmdList_->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+	}
+
+	//----
+	void CommandList::DispatchRays(const D3D12_DISPATCH_RAYS_DESC* pDesc)
+	{
+		assert(pDxrCmdList_ != nullptr);
+
+		FlushBarriers();
+		pDxrCmdList_->DispatchRays(pDesc);
+	}
+
+	//----
+	void CommandList::CopyResource(ID3D12Resource* pDstResource, ID3D12Resource* pSrcResource)
+	{
+		FlushBarriers();
+		pCmdList_->CopyResource(pDstResource, pSrcResource);
+	}
+
+	//----
+	void CommandList::CopyBufferRegion(ID3D12Resource* pDstBuffer, UINT64 dstOffset, ID3D12Resource* pSrcBuffer, UINT64 srcOffset, UINT64 numBytes)
+	{
+		FlushBarriers();
+		pCmdList_->CopyBufferRegion(pDstBuffer, dstOffset, pSrcBuffer, srcOffset, numBytes);
+	}
+
+	//----
+	void CommandList::CopyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION* pDst, UINT dstX, UINT dstY, UINT dstZ, const D3D12_TEXTURE_COPY_LOCATION* pSrc, const D3D12_BOX* pSrcBox)
+	{
+		FlushBarriers();
+		pCmdList_->CopyTextureRegion(pDst, dstX, dstY, dstZ, pSrc, pSrcBox);
+	}
+
+	//----
+	void CommandList::BeginBarrierBatch()
+	{
+		barrierBatchDepth_++;
+	}
+
+	//----
+	void CommandList::EndBarrierBatch()
+	{
+		assert(barrierBatchDepth_ > 0);
+		barrierBatchDepth_--;
+		FlushBarriersIfImmediate();
+	}
+
+	//----
+	void CommandList::FlushBarriersIfImmediate()
+	{
+		if (!isBarrierDeferred_ && barrierBatchDepth_ == 0)
 		{
-			D3D12_RESOURCE_BARRIER barrier;
-			barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-			barrier.UAV.pResource = p->pResource_;
-			GetCommandList()->ResourceBarrier(1, &barrier);
+			FlushBarriers();
 		}
 	}
 
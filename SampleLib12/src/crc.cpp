@@ -0,0 +1,422 @@
+﻿#include <sl12/crc.h>
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#	define SL12_CRC_X86
+#	include <nmmintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define SL12_CRC_TARGET
+#	else
+#		include <cpuid.h>
+#		define SL12_CRC_TARGET	__attribute__((target("sse4.2")))
+#	endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#	define SL12_CRC_ARM64
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define SL12_CRC_TARGET
+#	else
+#		include <arm_acle.h>
+#		define SL12_CRC_TARGET	__attribute__((target("+crc")))
+#	endif
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#	define SL12_CRC_BIG_ENDIAN
+#endif
+
+
+namespace sl12
+{
+	namespace
+	{
+		static const u32 kCrc32Poly = 0xedb88320;		// IEEE 802.3 (反転表現)
+		static const u32 kCrc32CPoly = 0x82f63b78;		// Castagnoli (反転表現)
+
+		/**************************************************//**
+		 * @brief slice-by-8 用のテーブル
+		 *
+		 * table[0] は1byte単位のテーブル.\n
+		 * table[k] は k byte 後ろにあるバイトの寄与を1回で求めるためのテーブル.
+		******************************************************/
+		struct CrcTable
+		{
+			u32		table[8][256];
+
+			explicit CrcTable(u32 poly)
+			{
+				for (u32 i = 0; i < 256; ++i)
+				{
+					u32 c = i;
+					for (int j = 0; j < 8; ++j)
+					{
+						c = (c & 1) ? (poly ^ (c >> 1)) : (c >> 1);
+					}
+					table[0][i] = c;
+				}
+				for (u32 i = 0; i < 256; ++i)
+				{
+					for (int k = 1; k < 8; ++k)
+					{
+						table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+					}
+				}
+			}
+		};	// struct CrcTable
+
+		const CrcTable& GetCrc32Table()
+		{
+			static const CrcTable kTable(kCrc32Poly);
+			return kTable;
+		}
+		const CrcTable& GetCrc32CTable()
+		{
+			static const CrcTable kTable(kCrc32CPoly);
+			return kTable;
+		}
+
+		// リトルエンディアンとして読み込む
+		// slice-by-8 と XXH64 はバイト列をリトルエンディアンの整数として扱う前提
+		inline u32 Read32(const u8* p)
+		{
+			u32 ret;
+			memcpy(&ret, p, sizeof(ret));
+#if defined(SL12_CRC_BIG_ENDIAN)
+			ret = __builtin_bswap32(ret);
+#endif
+			return ret;
+		}
+		inline u64 Read64(const u8* p)
+		{
+			u64 ret;
+			memcpy(&ret, p, sizeof(ret));
+#if defined(SL12_CRC_BIG_ENDIAN)
+			ret = __builtin_bswap64(ret);
+#endif
+			return ret;
+		}
+
+		//---------------------------------------
+		// 1byte単位で計算する
+		//---------------------------------------
+		inline u32 UpdateBytewise(const CrcTable& t, u32 crc, const u8* p, size_t size)
+		{
+			for (size_t i = 0; i < size; ++i)
+			{
+				crc = t.table[0][(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+			}
+			return crc;
+		}
+
+		//---------------------------------------
+		// 8byte単位で計算する
+		// リトルエンディアンを前提とする
+		//---------------------------------------
+		u32 UpdateSlice8(const CrcTable& t, u32 crc, const u8* p, size_t size)
+		{
+			while (size >= 8)
+			{
+				u32 one = Read32(p) ^ crc;
+				u32 two = Read32(p + 4);
+				crc = t.table[7][one & 0xff]
+					^ t.table[6][(one >> 8) & 0xff]
+					^ t.table[5][(one >> 16) & 0xff]
+					^ t.table[4][one >> 24]
+					^ t.table[3][two & 0xff]
+					^ t.table[2][(two >> 8) & 0xff]
+					^ t.table[1][(two >> 16) & 0xff]
+					^ t.table[0][two >> 24];
+				p += 8;
+				size -= 8;
+			}
+			return UpdateBytewise(t, crc, p, size);
+		}
+
+#if defined(SL12_CRC_X86)
+		//---------------------------------------
+		// SSE4.2 のCRC32命令で計算する (CRC32Cのみ)
+		//---------------------------------------
+		SL12_CRC_TARGET u32 UpdateCrc32CSse42(u32 crc, const u8* p, size_t size)
+		{
+#if defined(_M_X64) || defined(__x86_64__)
+			u64 crc64 = crc;
+			while (size >= 8)
+			{
+				crc64 = _mm_crc32_u64(crc64, Read64(p));
+				p += 8;
+				size -= 8;
+			}
+			crc = static_cast<u32>(crc64);
+#endif
+			while (size >= 4)
+			{
+				crc = _mm_crc32_u32(crc, Read32(p));
+				p += 4;
+				size -= 4;
+			}
+			while (size > 0)
+			{
+				crc = _mm_crc32_u8(crc, *p++);
+				--size;
+			}
+			return crc;
+		}
+
+		bool CheckSse42()
+		{
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			return (info[2] & (1 << 20)) != 0;
+#else
+			unsigned int eax, ebx, ecx, edx;
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			{
+				return false;
+			}
+			return (ecx & (1 << 20)) != 0;
+#endif
+		}
+#endif
+
+#if defined(SL12_CRC_ARM64)
+		//---------------------------------------
+		// ARMv8 のCRC命令で計算する
+		//---------------------------------------
+		SL12_CRC_TARGET u32 UpdateCrc32Arm(u32 crc, const u8* p, size_t size)
+		{
+			while (size >= 8)
+			{
+				crc = __crc32d(crc, Read64(p));
+				p += 8;
+				size -= 8;
+			}
+			while (size > 0)
+			{
+				crc = __crc32b(crc, *p++);
+				--size;
+			}
+			return crc;
+		}
+		SL12_CRC_TARGET u32 UpdateCrc32CArm(u32 crc, const u8* p, size_t size)
+		{
+			while (size >= 8)
+			{
+				crc = __crc32cd(crc, Read64(p));
+				p += 8;
+				size -= 8;
+			}
+			while (size > 0)
+			{
+				crc = __crc32cb(crc, *p++);
+				--size;
+			}
+			return crc;
+		}
+
+		bool CheckArmCrc()
+		{
+#if defined(_MSC_VER)
+			return IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE) != FALSE;
+#elif defined(__ARM_FEATURE_CRC32)
+			return true;
+#else
+			return false;
+#endif
+		}
+#endif
+
+		typedef u32 (*CrcFunc)(const void*, size_t, u32);
+
+		//---------------------------------------
+		// XXH64
+		//---------------------------------------
+		static const u64 kPrime64_1 = 0x9e3779b185ebca87ULL;
+		static const u64 kPrime64_2 = 0xc2b2ae3d27d4eb4fULL;
+		static const u64 kPrime64_3 = 0x165667b19e3779f9ULL;
+		static const u64 kPrime64_4 = 0x85ebca77c2b2ae63ULL;
+		static const u64 kPrime64_5 = 0x27d4eb2f165667c5ULL;
+
+		inline u64 Rotl64(u64 x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+		inline u64 XxhRound(u64 acc, u64 input)
+		{
+			acc += input * kPrime64_2;
+			acc = Rotl64(acc, 31);
+			return acc * kPrime64_1;
+		}
+		inline u64 XxhMergeRound(u64 acc, u64 val)
+		{
+			acc ^= XxhRound(0, val);
+			return acc * kPrime64_1 + kPrime64_4;
+		}
+	}	// namespace
+
+
+	//---------------------------------------
+	// 1byte単位のテーブル参照でCRC32を計算する
+	//---------------------------------------
+	u32 CalcCrc32Bytewise(const void* data, size_t dataSize, u32 crcBaseValue)
+	{
+		return ~UpdateBytewise(GetCrc32Table(), crcBaseValue, reinterpret_cast<const u8*>(data), dataSize);
+	}
+
+	//---------------------------------------
+	// slice-by-8 でCRC32を計算する
+	//---------------------------------------
+	u32 CalcCrc32Slice8(const void* data, size_t dataSize, u32 crcBaseValue)
+	{
+		return ~UpdateSlice8(GetCrc32Table(), crcBaseValue, reinterpret_cast<const u8*>(data), dataSize);
+	}
+
+	//---------------------------------------
+	// CRC命令でCRC32を計算する
+	//---------------------------------------
+	u32 CalcCrc32Hardware(const void* data, size_t dataSize, u32 crcBaseValue)
+	{
+#if defined(SL12_CRC_ARM64)
+		return ~UpdateCrc32Arm(crcBaseValue, reinterpret_cast<const u8*>(data), dataSize);
+#else
+		// x86 のCRC32命令は CRC32C 専用なので slice-by-8 を使う
+		return CalcCrc32Slice8(data, dataSize, crcBaseValue);
+#endif
+	}
+
+	//---------------------------------------
+	// slice-by-8 でCRC32Cを計算する
+	//---------------------------------------
+	u32 CalcCrc32CSlice8(const void* data, size_t dataSize, u32 crcBaseValue)
+	{
+		return ~UpdateSlice8(GetCrc32CTable(), crcBaseValue, reinterpret_cast<const u8*>(data), dataSize);
+	}
+
+	//---------------------------------------
+	// CRC命令でCRC32Cを計算する
+	//---------------------------------------
+	u32 CalcCrc32CHardware(const void* data, size_t dataSize, u32 crcBaseValue)
+	{
+#if defined(SL12_CRC_X86)
+		return ~UpdateCrc32CSse42(crcBaseValue, reinterpret_cast<const u8*>(data), dataSize);
+#elif defined(SL12_CRC_ARM64)
+		return ~UpdateCrc32CArm(crcBaseValue, reinterpret_cast<const u8*>(data), dataSize);
+#else
+		return CalcCrc32CSlice8(data, dataSize, crcBaseValue);
+#endif
+	}
+
+	//---------------------------------------
+	// CRC命令が使用できるか
+	//---------------------------------------
+	bool IsHardwareCrc32Supported()
+	{
+#if defined(SL12_CRC_ARM64)
+		static const bool kSupported = CheckArmCrc();
+		return kSupported;
+#else
+		return false;
+#endif
+	}
+	bool IsHardwareCrc32CSupported()
+	{
+#if defined(SL12_CRC_X86)
+		static const bool kSupported = CheckSse42();
+		return kSupported;
+#elif defined(SL12_CRC_ARM64)
+		static const bool kSupported = CheckArmCrc();
+		return kSupported;
+#else
+		return false;
+#endif
+	}
+
+	//---------------------------------------
+	// CRC32を計算する
+	//---------------------------------------
+	u32 CalcCrc32(const void* data, size_t dataSize, u32 crcBaseValue)
+	{
+		static const CrcFunc kFunc = IsHardwareCrc32Supported() ? &CalcCrc32Hardware : &CalcCrc32Slice8;
+		return kFunc(data, dataSize, crcBaseValue);
+	}
+
+	//---------------------------------------
+	// CRC32Cを計算する
+	//---------------------------------------
+	u32 CalcCrc32C(const void* data, size_t dataSize, u32 crcBaseValue)
+	{
+		static const CrcFunc kFunc = IsHardwareCrc32CSupported() ? &CalcCrc32CHardware : &CalcCrc32CSlice8;
+		return kFunc(data, dataSize, crcBaseValue);
+	}
+
+	//---------------------------------------
+	// 64bitハッシュを計算する
+	//---------------------------------------
+	u64 CalcHash64(const void* data, size_t dataSize, u64 seed)
+	{
+		const u8* p = reinterpret_cast<const u8*>(data);
+		const u8* end = p + dataSize;
+		u64 h;
+
+		if (dataSize >= 32)
+		{
+			u64 v1 = seed + kPrime64_1 + kPrime64_2;
+			u64 v2 = seed + kPrime64_2;
+			u64 v3 = seed;
+			u64 v4 = seed - kPrime64_1;
+			const u8* limit = end - 32;
+			do
+			{
+				v1 = XxhRound(v1, Read64(p));
+				v2 = XxhRound(v2, Read64(p + 8));
+				v3 = XxhRound(v3, Read64(p + 16));
+				v4 = XxhRound(v4, Read64(p + 24));
+				p += 32;
+			} while (p <= limit);
+
+			h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+			h = XxhMergeRound(h, v1);
+			h = XxhMergeRound(h, v2);
+			h = XxhMergeRound(h, v3);
+			h = XxhMergeRound(h, v4);
+		}
+		else
+		{
+			h = seed + kPrime64_5;
+		}
+
+		h += static_cast<u64>(dataSize);
+
+		while (p + 8 <= end)
+		{
+			h ^= XxhRound(0, Read64(p));
+			h = Rotl64(h, 27) * kPrime64_1 + kPrime64_4;
+			p += 8;
+		}
+		if (p + 4 <= end)
+		{
+			h ^= static_cast<u64>(Read32(p)) * kPrime64_1;
+			h = Rotl64(h, 23) * kPrime64_2 + kPrime64_3;
+			p += 4;
+		}
+		while (p < end)
+		{
+			h ^= static_cast<u64>(*p) * kPrime64_5;
+			h = Rotl64(h, 11) * kPrime64_1;
+			++p;
+		}
+
+		h ^= h >> 33;
+		h *= kPrime64_2;
+		h ^= h >> 29;
+		h *= kPrime64_3;
+		h ^= h >> 32;
+		return h;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -19,6 +19,15 @@ namespace sl12
 		}
 	}
 
+	//----
+	void Descriptor::Commit()
+	{
+		if (pParentHeap_)
+		{
+			pParentHeap_->CommitDescriptor(this);
+		}
+	}
+
 }	// namespace sl12
 
 //	EOF
@@ -0,0 +1,479 @@
+﻿#include <sl12/descriptor_allocator.h>
+
+#include <algorithm>
+#include <thread>
+
+
+namespace sl12
+{
+	namespace
+	{
+		inline u64 MakeStackHead(u64 prev, u32 index)
+		{
+			// タグを進めて、同じインデックスが再度積まれた場合も区別できるようにする
+			return (((prev >> 32) + 1) << 32) | index;
+		}
+
+		inline u64 MakeBounds(u32 singleTop, u32 rangeBottom)
+		{
+			return (static_cast<u64>(rangeBottom) << 32) | singleTop;
+		}
+
+		std::atomic<u32>	s_threadSlotCounter(0);
+
+		// キャッシュのロック
+		// 所有するスレッド以外が触れるのは空きがなくなった場合だけなので、通常は競合しない
+		template <typename Magazine>
+		class MagazineLock
+		{
+		public:
+			explicit MagazineLock(Magazine& mag)
+				: mag_(mag)
+			{
+				while (mag_.lock.exchange(1, std::memory_order_acquire) != 0)
+				{
+					std::this_thread::yield();
+				}
+			}
+			~MagazineLock()
+			{
+				mag_.lock.store(0, std::memory_order_release);
+			}
+
+		private:
+			Magazine&	mag_;
+		};	// class MagazineLock
+	}
+
+	//---------------------------------------
+	// 呼び出したスレッドのキャッシュ番号を取得する
+	//---------------------------------------
+	u32 DescriptorIndexAllocator::GetThreadCacheSlot()
+	{
+		// 番号は使い回さないので、上限を超えたスレッドはキャッシュを使用しない
+		thread_local u32 slot = s_threadSlotCounter.fetch_add(1, std::memory_order_relaxed);
+		return slot;
+	}
+
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool DescriptorIndexAllocator::Initialize(u32 numDescriptors)
+	{
+		Destroy();
+
+		if (numDescriptors == 0 || numDescriptors == kInvalidIndex)
+		{
+			return false;
+		}
+
+		numDescriptors_ = numDescriptors;
+		pStackNext_ = new std::atomic<u32>[numDescriptors];
+		for (u32 i = 0; i < numDescriptors; i++)
+		{
+			pStackNext_[i].store(kInvalidIndex, std::memory_order_relaxed);
+		}
+		stackHead_.store(kInvalidIndex, std::memory_order_relaxed);
+		bounds_.store(MakeBounds(0, numDescriptors), std::memory_order_relaxed);
+
+		pMagazines_ = new Magazine[kMaxThreadCaches];
+		for (u32 i = 0; i < kMaxThreadCaches; i++)
+		{
+			pMagazines_[i].lock.store(0, std::memory_order_relaxed);
+			pMagazines_[i].count = 0;
+		}
+
+		// 全スレッドのキャッシュがヒープの半分を超えて抱え込まないように補充数を制限する
+		refillCount_ = std::max(1u, std::min(kMagazineSize / 2, numDescriptors / (2 * kMaxThreadCaches)));
+
+		freeRanges_.clear();
+
+		transientBase_ = transientCount_ = 0;
+		transientHead_.store(0, std::memory_order_relaxed);
+		transientTail_.store(0, std::memory_order_relaxed);
+		transientMarkTop_ = transientMarkNum_ = 0;
+
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void DescriptorIndexAllocator::Destroy()
+	{
+		delete[] pStackNext_;
+		pStackNext_ = nullptr;
+		delete[] pMagazines_;
+		pMagazines_ = nullptr;
+		freeRanges_.clear();
+		transientBase_ = transientCount_ = 0;
+		transientMarkTop_ = transientMarkNum_ = 0;
+		numDescriptors_ = 0;
+	}
+
+	//---------------------------------------
+	// 共有スタックから1つ取り出す
+	//---------------------------------------
+	u32 DescriptorIndexAllocator::PopStack()
+	{
+		u64 head = stackHead_.load(std::memory_order_acquire);
+		while (true)
+		{
+			u32 index = static_cast<u32>(head);
+			if (index == kInvalidIndex)
+			{
+				return kInvalidIndex;
+			}
+
+			// 他のスレッドが先に取り出していても、タグが変わるので CAS が失敗する
+			u32 next = pStackNext_[index].load(std::memory_order_relaxed);
+			if (stackHead_.compare_exchange_weak(head, MakeStackHead(head, next), std::memory_order_acquire, std::memory_order_acquire))
+			{
+				return index;
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 連結済みのリストを共有スタックにまとめて積む
+	//---------------------------------------
+	void DescriptorIndexAllocator::PushStack(u32 first, u32 last)
+	{
+		u64 head = stackHead_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			pStackNext_[last].store(static_cast<u32>(head), std::memory_order_relaxed);
+			if (stackHead_.compare_exchange_weak(head, MakeStackHead(head, first), std::memory_order_release, std::memory_order_relaxed))
+			{
+				return;
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 未使用領域の先頭から1つ確保する
+	//---------------------------------------
+	u32 DescriptorIndexAllocator::AllocateFromBounds()
+	{
+		u64 bounds = bounds_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			u32 singleTop = static_cast<u32>(bounds);
+			u32 rangeBottom = static_cast<u32>(bounds >> 32);
+			if (singleTop >= rangeBottom)
+			{
+				return kInvalidIndex;
+			}
+			if (bounds_.compare_exchange_weak(bounds, MakeBounds(singleTop + 1, rangeBottom), std::memory_order_relaxed))
+			{
+				return singleTop;
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 1つ確保する
+	//---------------------------------------
+	u32 DescriptorIndexAllocator::Allocate()
+	{
+		u32 slot = GetThreadCacheSlot();
+		if (slot >= kMaxThreadCaches)
+		{
+			u32 index = PopStack();
+			index = (index != kInvalidIndex) ? index : AllocateFromBounds();
+			return (index != kInvalidIndex) ? index : AllocateAfterDrain();
+		}
+
+		{
+			Magazine& mag = pMagazines_[slot];
+			MagazineLock<Magazine> lock(mag);
+			if (mag.count == 0)
+			{
+				while (mag.count < refillCount_)
+				{
+					u32 index = PopStack();
+					if (index == kInvalidIndex)
+					{
+						index = AllocateFromBounds();
+						if (index == kInvalidIndex)
+						{
+							break;
+						}
+					}
+					mag.indices[mag.count++] = index;
+				}
+			}
+			if (mag.count > 0)
+			{
+				return mag.indices[--mag.count];
+			}
+		}
+
+		// 自分のキャッシュのロックを外してから他のキャッシュを回収する
+		return AllocateAfterDrain();
+	}
+
+	//---------------------------------------
+	// 全スレッドのキャッシュを共有スタックに戻してから確保する
+	//---------------------------------------
+	u32 DescriptorIndexAllocator::AllocateAfterDrain()
+	{
+		for (u32 i = 0; i < kMaxThreadCaches; i++)
+		{
+			Magazine& mag = pMagazines_[i];
+			MagazineLock<Magazine> lock(mag);
+			FlushMagazine(mag);
+		}
+		return PopStack();
+	}
+
+	//---------------------------------------
+	// 1つ解放する
+	//---------------------------------------
+	void DescriptorIndexAllocator::Release(u32 index)
+	{
+		assert(index < numDescriptors_);
+
+		u32 slot = GetThreadCacheSlot();
+		if (slot >= kMaxThreadCaches)
+		{
+			PushStack(index, index);
+			return;
+		}
+
+		Magazine& mag = pMagazines_[slot];
+		MagazineLock<Magazine> lock(mag);
+		if (mag.count == kMagazineSize)
+		{
+			// 古い方の半分を連結して共有スタックに戻す
+			u32 num = kMagazineSize / 2;
+			for (u32 i = 0; i + 1 < num; i++)
+			{
+				pStackNext_[mag.indices[i]].store(mag.indices[i + 1], std::memory_order_relaxed);
+			}
+			PushStack(mag.indices[0], mag.indices[num - 1]);
+			std::copy(mag.indices + num, mag.indices + mag.count, mag.indices);
+			mag.count -= num;
+		}
+		mag.indices[mag.count++] = index;
+	}
+
+	//---------------------------------------
+	// 呼び出したスレッドのキャッシュを共有スタックに戻す
+	//---------------------------------------
+	void DescriptorIndexAllocator::FlushThreadCache()
+	{
+		u32 slot = GetThreadCacheSlot();
+		if (slot >= kMaxThreadCaches || !pMagazines_)
+		{
+			return;
+		}
+
+		Magazine& mag = pMagazines_[slot];
+		MagazineLock<Magazine> lock(mag);
+		FlushMagazine(mag);
+	}
+
+	//---------------------------------------
+	// キャッシュの中身を連結して共有スタックに戻す
+	// 呼び出し側でキャッシュのロックを取っておくこと
+	//---------------------------------------
+	void DescriptorIndexAllocator::FlushMagazine(Magazine& mag)
+	{
+		if (mag.count == 0)
+		{
+			return;
+		}
+		for (u32 i = 0; i + 1 < mag.count; i++)
+		{
+			pStackNext_[mag.indices[i]].store(mag.indices[i + 1], std::memory_order_relaxed);
+		}
+		PushStack(mag.indices[0], mag.indices[mag.count - 1]);
+		mag.count = 0;
+	}
+
+	//---------------------------------------
+	// 連続領域を確保する
+	//---------------------------------------
+	bool DescriptorIndexAllocator::AllocateRange(u32 count, u32* pBaseIndex)
+	{
+		assert(pBaseIndex != nullptr);
+		if (count == 0 || count > numDescriptors_)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(rangeMutex_);
+
+		// 解放済みの連続領域から先に探す
+		for (auto it = freeRanges_.begin(); it != freeRanges_.end(); ++it)
+		{
+			if (it->count >= count)
+			{
+				*pBaseIndex = it->base;
+				it->base += count;
+				it->count -= count;
+				if (it->count == 0)
+				{
+					freeRanges_.erase(it);
+				}
+				return true;
+			}
+		}
+
+		// 単体確保の領域とぶつからない範囲で末尾側を伸ばす
+		u64 bounds = bounds_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			u32 singleTop = static_cast<u32>(bounds);
+			u32 rangeBottom = static_cast<u32>(bounds >> 32);
+			if (rangeBottom - singleTop < count)
+			{
+				return false;
+			}
+			if (bounds_.compare_exchange_weak(bounds, MakeBounds(singleTop, rangeBottom - count), std::memory_order_relaxed))
+			{
+				*pBaseIndex = rangeBottom - count;
+				return true;
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 連続領域を解放する
+	//---------------------------------------
+	void DescriptorIndexAllocator::ReleaseRange(u32 baseIndex, u32 count)
+	{
+		assert(baseIndex + count <= numDescriptors_);
+		if (count == 0)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(rangeMutex_);
+
+		// 前後の空き領域と結合する
+		auto it = std::lower_bound(freeRanges_.begin(), freeRanges_.end(), baseIndex,
+			[](const RangeBlock& b, u32 v) { return b.base < v; });
+		it = freeRanges_.insert(it, RangeBlock{ baseIndex, count });
+		auto next = it + 1;
+		if (next != freeRanges_.end() && it->base + it->count == next->base)
+		{
+			it->count += next->count;
+			freeRanges_.erase(next);
+		}
+		if (it != freeRanges_.begin())
+		{
+			auto prev = it - 1;
+			if (prev->base + prev->count == it->base)
+			{
+				prev->count += it->count;
+				freeRanges_.erase(it);
+			}
+		}
+
+		// 末尾側の先頭に接していれば、単体確保でも使えるように境界を戻す
+		if (!freeRanges_.empty())
+		{
+			RangeBlock front = freeRanges_.front();
+			u64 bounds = bounds_.load(std::memory_order_relaxed);
+			while (static_cast<u32>(bounds >> 32) == front.base)
+			{
+				if (bounds_.compare_exchange_weak(bounds, MakeBounds(static_cast<u32>(bounds), front.base + front.count), std::memory_order_relaxed))
+				{
+					freeRanges_.erase(freeRanges_.begin());
+					break;
+				}
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 一時領域を用意する
+	//---------------------------------------
+	bool DescriptorIndexAllocator::ReserveTransientRegion(u32 count)
+	{
+		assert(transientCount_ == 0);
+
+		if (!AllocateRange(count, &transientBase_))
+		{
+			return false;
+		}
+		transientCount_ = count;
+		transientHead_.store(0, std::memory_order_relaxed);
+		transientTail_.store(0, std::memory_order_relaxed);
+		transientMarkTop_ = transientMarkNum_ = 0;
+		return true;
+	}
+
+	//---------------------------------------
+	// 一時領域から連続したデスクリプタを確保する
+	//---------------------------------------
+	bool DescriptorIndexAllocator::AllocateTransient(u32 count, u32* pBaseIndex)
+	{
+		assert(pBaseIndex != nullptr);
+		if (count == 0 || count > transientCount_)
+		{
+			return false;
+		}
+
+		u64 head = transientHead_.load(std::memory_order_relaxed);
+		while (true)
+		{
+			// 末尾をまたぐ場合は残りを捨てて先頭から確保する
+			u64 pos = head % transientCount_;
+			u64 pad = (pos + count > transientCount_) ? transientCount_ - pos : 0;
+			u64 newHead = head + pad + count;
+			if (newHead - transientTail_.load(std::memory_order_acquire) > transientCount_)
+			{
+				return false;
+			}
+			if (transientHead_.compare_exchange_weak(head, newHead, std::memory_order_relaxed))
+			{
+				*pBaseIndex = transientBase_ + static_cast<u32>((head + pad) % transientCount_);
+				return true;
+			}
+		}
+	}
+
+	//---------------------------------------
+	// ここまでに確保した一時領域にフェンス値を関連付ける
+	//---------------------------------------
+	bool DescriptorIndexAllocator::MarkTransient(u64 fenceValue)
+	{
+		if (transientMarkNum_ == kMaxTransientMarks)
+		{
+			return false;
+		}
+
+		u32 index = (transientMarkTop_ + transientMarkNum_) % kMaxTransientMarks;
+		transientMarks_[index].fenceValue = fenceValue;
+		transientMarks_[index].head = transientHead_.load(std::memory_order_relaxed);
+		transientMarkNum_++;
+		return true;
+	}
+
+	//---------------------------------------
+	// 完了したフェンス値までの一時領域を解放する
+	//---------------------------------------
+	void DescriptorIndexAllocator::RetireTransient(u64 completedFenceValue)
+	{
+		u64 tail = transientTail_.load(std::memory_order_relaxed);
+		while (transientMarkNum_ > 0)
+		{
+			const TransientMark& mark = transientMarks_[transientMarkTop_];
+			if (mark.fenceValue > completedFenceValue)
+			{
+				break;
+			}
+			tail = mark.head;
+			transientMarkTop_ = (transientMarkTop_ + 1) % kMaxTransientMarks;
+			transientMarkNum_--;
+		}
+		transientTail_.store(tail, std::memory_order_release);
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -15,72 +15,141 @@ namespace sl12
 			return false;
 		}
 
-		pDescriptors_ = new Descriptor[desc.NumDescriptors + 2];
-		//pUsedList_ = pDescriptors_;
-		//pUsedList_->pPrev_ = pUsedList_->pNext_ = pUsedList_;
-		pUnusedList_ = pDescriptors_ + 1;
-		pUnusedList_->pPrev_ = pUnusedList_->pNext_ = pUnusedList_;
+		// シェーダから参照されるヒープはコピー元にできないので、同じサイズのコピー元ヒープを用意する
+		if (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
+		{
+			D3D12_DESCRIPTOR_HEAP_DESC copyDesc = desc;
+			copyDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+			hr = pDev->GetDeviceDep()->CreateDescriptorHeap(&copyDesc, IID_PPV_ARGS(&pCopySourceHeap_));
+			if (FAILED(hr))
+			{
+				return false;
+			}
+		}
+		pDevice_ = pDev->GetDeviceDep();
+
+		if (!allocator_.Initialize(desc.NumDescriptors))
+		{
+			return false;
+		}
 
 		heapDesc_ = desc;
 		descSize_ = pDev->GetDeviceDep()->GetDescriptorHandleIncrementSize(desc.Type);
 
-		// すべてUnusedListに接続
-		Descriptor* p = pUnusedList_ + 1;
+		// デスクリプタはインデックスで管理し、確保はアロケータに任せる
+		pDescriptors_ = new Descriptor[desc.NumDescriptors];
+		Descriptor* p = pDescriptors_;
 		D3D12_CPU_DESCRIPTOR_HANDLE hCpu = pHeap_->GetCPUDescriptorHandleForHeapStart();
 		D3D12_GPU_DESCRIPTOR_HANDLE hGpu = pHeap_->GetGPUDescriptorHandleForHeapStart();
-		for (u32 i = 0; i < desc.NumDescriptors; i++, p++, hCpu.ptr += descSize_, hGpu.ptr += descSize_)
+		D3D12_CPU_DESCRIPTOR_HANDLE hCopy = pCopySourceHeap_ ? pCopySourceHeap_->GetCPUDescriptorHandleForHeapStart() : hCpu;
+		for (u32 i = 0; i < desc.NumDescriptors; i++, p++, hCpu.ptr += descSize_, hGpu.ptr += descSize_, hCopy.ptr += descSize_)
 		{
 			p->pParentHeap_ = this;
 			p->cpuHandle_ = hCpu;
 			p->gpuHandle_ = hGpu;
+			p->cpuCopySourceHandle_ = hCopy;
 			p->index_ = i;
-
-			Descriptor* next = pUnusedList_->pNext_;
-			pUnusedList_->pNext_ = next->pPrev_ = p;
-			p->pPrev_ = pUnusedList_;
-			p->pNext_ = next;
 		}
 
-		take_num_ = 0;
-
 		return true;
 	}
 
 	//----
 	void DescriptorHeap::Destroy()
 	{
-		//assert(pUsedList_->pNext_ == pUsedList_);
 		delete[] pDescriptors_;
+		pDescriptors_ = nullptr;
+		allocator_.Destroy();
+		SafeRelease(pCopySourceHeap_);
 		SafeRelease(pHeap_);
+		pDevice_ = nullptr;
 	}
 
 	//----
 	Descriptor* DescriptorHeap::CreateDescriptor()
 	{
-		if (pUnusedList_->pNext_ == pUnusedList_)
+		u32 index = allocator_.Allocate();
+		if (index == DescriptorIndexAllocator::kInvalidIndex)
 		{
 			return nullptr;
 		}
 
-		Descriptor* ret = pUnusedList_->pNext_;
-		ret->pPrev_->pNext_ = ret->pNext_;
-		ret->pNext_->pPrev_ = ret->pPrev_;
-		ret->pNext_ = ret->pPrev_ = ret;
-		take_num_++;
-
-		return ret;
+		return pDescriptors_ + index;
 	}
 
 	//----
 	void DescriptorHeap::ReleaseDescriptor(Descriptor* p)
 	{
-		assert((pDescriptors_ <= p) && (p <= pDescriptors_ + heapDesc_.NumDescriptors + 2));
+		assert((pDescriptors_ <= p) && (p < pDescriptors_ + heapDesc_.NumDescriptors));
+
+		allocator_.Release(p->index_);
+	}
+
+	//----
+	void DescriptorHeap::FlushThreadCache()
+	{
+		allocator_.FlushThreadCache();
+	}
+
+	//----
+	void DescriptorHeap::CommitDescriptor(Descriptor* p)
+	{
+		if (pCopySourceHeap_)
+		{
+			pDevice_->CopyDescriptorsSimple(1, p->cpuHandle_, p->cpuCopySourceHandle_, heapDesc_.Type);
+		}
+	}
+
+	//----
+	bool DescriptorHeap::AllocateRange(u32 count, u32* pBaseIndex)
+	{
+		return allocator_.AllocateRange(count, pBaseIndex);
+	}
+
+	//----
+	void DescriptorHeap::ReleaseRange(u32 baseIndex, u32 count)
+	{
+		allocator_.ReleaseRange(baseIndex, count);
+	}
+
+	//----
+	bool DescriptorHeap::ReserveTransientRegion(u32 count)
+	{
+		return allocator_.ReserveTransientRegion(count);
+	}
+
+	//----
+	bool DescriptorHeap::AllocateTransient(u32 count, u32* pBaseIndex)
+	{
+		return allocator_.AllocateTransient(count, pBaseIndex);
+	}
 
-		Descriptor* next = pUnusedList_->pNext_;
-		pUnusedList_->pNext_ = next->pPrev_ = p;
-		p->pPrev_ = pUnusedList_;
-		p->pNext_ = next;
-		take_num_--;
+	//----
+	bool DescriptorHeap::MarkTransient(u64 fenceValue)
+	{
+		return allocator_.MarkTransient(fenceValue);
+	}
+
+	//----
+	void DescriptorHeap::RetireTransient(u64 completedFenceValue)
+	{
+		allocator_.RetireTransient(completedFenceValue);
+	}
+
+	//----
+	D3D12_CPU_DESCRIPTOR_HANDLE DescriptorHeap::GetCpuHandle(u32 index) const
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE ret = pHeap_->GetCPUDescriptorHandleForHeapStart();
+		ret.ptr += static_cast<SIZE_T>(index) * descSize_;
+		return ret;
+	}
+
+	//----
+	D3D12_GPU_DESCRIPTOR_HANDLE DescriptorHeap::GetGpuHandle(u32 index) const
+	{
+		D3D12_GPU_DESCRIPTOR_HANDLE ret = pHeap_->GetGPUDescriptorHandleForHeapStart();
+		ret.ptr += static_cast<UINT64>(index) * descSize_;
+		return ret;
 	}
 
 }	// namespace sl12
@@ -0,0 +1,99 @@
+﻿#include <sl12/descriptor_staging.h>
+
+#include <sl12/device.h>
+#include <sl12/descriptor_heap.h>
+
+
+namespace sl12
+{
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool DescriptorStaging::Initialize(Device* pDev, D3D12_DESCRIPTOR_HEAP_TYPE type, u32 numPerFrame, u32 numFrames)
+	{
+		assert(pDev != nullptr);
+		assert(type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+
+		Destroy();
+
+		// 全フレーム分をまとめて確保する
+		DescriptorHeap* pHeap = &pDev->GetDescriptorHeap(type);
+		if (!pHeap->AllocateRange(numPerFrame * numFrames, &baseIndex_))
+		{
+			return false;
+		}
+
+		pDevice_ = pDev->GetDeviceDep();
+		pHeap_ = pHeap;
+		type_ = type;
+		numPerFrame_ = numPerFrame;
+		numFrames_ = numFrames;
+		frameBase_ = baseIndex_;
+		usedCount_ = 0;
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void DescriptorStaging::Destroy()
+	{
+		if (pHeap_)
+		{
+			pHeap_->ReleaseRange(baseIndex_, numPerFrame_ * numFrames_);
+			pHeap_ = nullptr;
+		}
+		pDevice_ = nullptr;
+		numPerFrame_ = numFrames_ = 0;
+		usedCount_ = 0;
+	}
+
+	//---------------------------------------
+	// フレームを開始する
+	//---------------------------------------
+	void DescriptorStaging::BeginFrame(u32 frameIndex)
+	{
+		assert(frameIndex < numFrames_);
+
+		frameBase_ = baseIndex_ + numPerFrame_ * frameIndex;
+		usedCount_ = 0;
+	}
+
+	//---------------------------------------
+	// デスクリプタを連続した領域にコピーする
+	//---------------------------------------
+	bool DescriptorStaging::Stage(const D3D12_CPU_DESCRIPTOR_HANDLE* pSrcHandles, u32 count, D3D12_GPU_DESCRIPTOR_HANDLE* pOut)
+	{
+		assert(pHeap_ != nullptr);
+		assert(pOut != nullptr);
+
+		if (count > numPerFrame_ - usedCount_)
+		{
+			return false;
+		}
+
+		u32 dstIndex = frameBase_ + usedCount_;
+		usedCount_ += count;
+		*pOut = pHeap_->GetGpuHandle(dstIndex);
+
+		// 未設定のハンドルがあるとテーブルのその位置に以前の内容が残るので許可しない
+		for (u32 i = 0; i < count; ++i)
+		{
+			assert(pSrcHandles[i].ptr != 0);
+		}
+
+		// コピー元のレンジサイズに nullptr を渡すとすべて1として扱われる
+		if (count > 0)
+		{
+			D3D12_CPU_DESCRIPTOR_HANDLE dstStart = pHeap_->GetCpuHandle(dstIndex);
+			UINT dstSize = count;
+			pDevice_->CopyDescriptors(1, &dstStart, &dstSize, dstSize, pSrcHandles, nullptr, type_);
+		}
+
+		return true;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -73,6 +73,12 @@ namespace sl12
 		pQueue->GetQueueDep()->Wait(pFence_, waitValue_);
 	}
 
+	//----
+	void Fence::WaitSignal(CommandQueue* pQueue, u32 value)
+	{
+		pQueue->GetQueueDep()->Wait(pFence_, value);
+	}
+
 	//----
 	bool Fence::CheckSignal()
 	{
@@ -0,0 +1,1084 @@
+﻿#include <sl12/fft.h>
+
+#include <sl12/parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#	define SL12_FFT_SSE
+#	include <xmmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#	define SL12_FFT_NEON
+#	include <arm_neon.h>
+#endif
+#if defined(SL12_FFT_SSE) || defined(SL12_FFT_NEON)
+#	define SL12_FFT_SIMD
+#endif
+
+
+namespace sl12
+{
+	namespace
+	{
+		const double kPi = 3.14159265358979323846;
+
+		// 1つのジョブで変換する行数
+		const u32 kRowsPerJob = 16;
+		// 列方向の FFT で連続したメモリにまとめる列数
+		const u32 kColumnBlock = 16;
+
+		u32 GetThreadCount(u32 numThreads, u32 jobCount)
+		{
+			if (numThreads == 0)
+			{
+				numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+			}
+			return std::min(numThreads, std::max(jobCount, 1u));
+		}
+
+		bool IsPowerOfTwo(u32 v)
+		{
+			return (v != 0) && ((v & (v - 1)) == 0);
+		}
+
+		template <typename V>
+		struct Complex
+		{
+			V	re, im;
+		};	// struct Complex
+
+		/**************************************************//**
+		 * @brief スカラーのロード/ストア
+		******************************************************/
+		struct ScalarOps
+		{
+			typedef float V;
+			static const u32 kLanes = 1;
+
+			static float Load(const float* p)
+			{
+				return *p;
+			}
+			static void Store(float* p, float v)
+			{
+				*p = v;
+			}
+			static float Splat(float v)
+			{
+				return v;
+			}
+		};	// struct ScalarOps
+
+#if defined(SL12_FFT_SSE)
+		struct Vec4
+		{
+			__m128	v;
+		};	// struct Vec4
+
+		inline Vec4 operator+(const Vec4& a, const Vec4& b)
+		{
+			Vec4 r = { _mm_add_ps(a.v, b.v) };
+			return r;
+		}
+		inline Vec4 operator-(const Vec4& a, const Vec4& b)
+		{
+			Vec4 r = { _mm_sub_ps(a.v, b.v) };
+			return r;
+		}
+		inline Vec4 operator-(const Vec4& a)
+		{
+			Vec4 r = { _mm_sub_ps(_mm_setzero_ps(), a.v) };
+			return r;
+		}
+		inline Vec4 operator*(const Vec4& a, const Vec4& b)
+		{
+			Vec4 r = { _mm_mul_ps(a.v, b.v) };
+			return r;
+		}
+
+		struct SimdOps
+		{
+			typedef Vec4 V;
+			static const u32 kLanes = 4;
+
+			static Vec4 Load(const float* p)
+			{
+				Vec4 r = { _mm_loadu_ps(p) };
+				return r;
+			}
+			static void Store(float* p, const Vec4& v)
+			{
+				_mm_storeu_ps(p, v.v);
+			}
+			static Vec4 Splat(float v)
+			{
+				Vec4 r = { _mm_set1_ps(v) };
+				return r;
+			}
+		};	// struct SimdOps
+
+		inline void Transpose4(Vec4& r0, Vec4& r1, Vec4& r2, Vec4& r3)
+		{
+			_MM_TRANSPOSE4_PS(r0.v, r1.v, r2.v, r3.v);
+		}
+
+		// p[0..7] を偶数番目と奇数番目に分ける
+		inline void Deinterleave(const float* p, Vec4& even, Vec4& odd)
+		{
+			__m128 a = _mm_loadu_ps(p);
+			__m128 b = _mm_loadu_ps(p + 4);
+			even.v = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+			odd.v = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+		}
+		inline void Interleave(const Vec4& even, const Vec4& odd, float* p)
+		{
+			_mm_storeu_ps(p, _mm_unpacklo_ps(even.v, odd.v));
+			_mm_storeu_ps(p + 4, _mm_unpackhi_ps(even.v, odd.v));
+		}
+#elif defined(SL12_FFT_NEON)
+		struct Vec4
+		{
+			float32x4_t	v;
+		};	// struct Vec4
+
+		inline Vec4 operator+(const Vec4& a, const Vec4& b)
+		{
+			Vec4 r = { vaddq_f32(a.v, b.v) };
+			return r;
+		}
+		inline Vec4 operator-(const Vec4& a, const Vec4& b)
+		{
+			Vec4 r = { vsubq_f32(a.v, b.v) };
+			return r;
+		}
+		inline Vec4 operator-(const Vec4& a)
+		{
+			Vec4 r = { vnegq_f32(a.v) };
+			return r;
+		}
+		inline Vec4 operator*(const Vec4& a, const Vec4& b)
+		{
+			Vec4 r = { vmulq_f32(a.v, b.v) };
+			return r;
+		}
+
+		struct SimdOps
+		{
+			typedef Vec4 V;
+			static const u32 kLanes = 4;
+
+			static Vec4 Load(const float* p)
+			{
+				Vec4 r = { vld1q_f32(p) };
+				return r;
+			}
+			static void Store(float* p, const Vec4& v)
+			{
+				vst1q_f32(p, v.v);
+			}
+			static Vec4 Splat(float v)
+			{
+				Vec4 r = { vdupq_n_f32(v) };
+				return r;
+			}
+		};	// struct SimdOps
+
+		inline void Transpose4(Vec4& r0, Vec4& r1, Vec4& r2, Vec4& r3)
+		{
+			float32x4x2_t t01 = vtrnq_f32(r0.v, r1.v);
+			float32x4x2_t t23 = vtrnq_f32(r2.v, r3.v);
+			r0.v = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+			r1.v = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+			r2.v = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+			r3.v = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+		}
+
+		inline void Deinterleave(const float* p, Vec4& even, Vec4& odd)
+		{
+			float32x4x2_t t = vuzpq_f32(vld1q_f32(p), vld1q_f32(p + 4));
+			even.v = t.val[0];
+			odd.v = t.val[1];
+		}
+		inline void Interleave(const Vec4& even, const Vec4& odd, float* p)
+		{
+			float32x4x2_t t = vzipq_f32(even.v, odd.v);
+			vst1q_f32(p, t.val[0]);
+			vst1q_f32(p + 4, t.val[1]);
+		}
+#endif
+
+		/**************************************************//**
+		 * @brief 基数 R の DFT
+		 *
+		 * 回転因子は掛けない. h は 1/√2
+		******************************************************/
+		template <u32 R, typename V>
+		struct Butterfly;
+
+		template <typename V>
+		struct Butterfly<2, V>
+		{
+			static void Run(Complex<V>* a, const V&)
+			{
+				Complex<V> t = a[1];
+				a[1].re = a[0].re - t.re;
+				a[1].im = a[0].im - t.im;
+				a[0].re = a[0].re + t.re;
+				a[0].im = a[0].im + t.im;
+			}
+		};	// struct Butterfly<2, V>
+
+		template <typename V>
+		struct Butterfly<4, V>
+		{
+			static void Run(Complex<V>& a0, Complex<V>& a1, Complex<V>& a2, Complex<V>& a3)
+			{
+				V t0r = a0.re + a2.re, t0i = a0.im + a2.im;
+				V t1r = a0.re - a2.re, t1i = a0.im - a2.im;
+				V t2r = a1.re + a3.re, t2i = a1.im + a3.im;
+				V t3r = a1.re - a3.re, t3i = a1.im - a3.im;
+				a0.re = t0r + t2r;
+				a0.im = t0i + t2i;
+				a2.re = t0r - t2r;
+				a2.im = t0i - t2i;
+				// t1 - i * t3, t1 + i * t3
+				a1.re = t1r + t3i;
+				a1.im = t1i - t3r;
+				a3.re = t1r - t3i;
+				a3.im = t1i + t3r;
+			}
+			static void Run(Complex<V>* a, const V&)
+			{
+				Run(a[0], a[1], a[2], a[3]);
+			}
+		};	// struct Butterfly<4, V>
+
+		template <typename V>
+		struct Butterfly<8, V>
+		{
+			static void Run(Complex<V>* a, const V& h)
+			{
+				// 偶数番目の出力は a[j] + a[j+4] の DFT4、奇数番目は (a[j] - a[j+4]) * W8^j の DFT4
+				Complex<V> b[4], d[4];
+				for (int j = 0; j < 4; ++j)
+				{
+					b[j].re = a[j].re + a[j + 4].re;
+					b[j].im = a[j].im + a[j + 4].im;
+					d[j].re = a[j].re - a[j + 4].re;
+					d[j].im = a[j].im - a[j + 4].im;
+				}
+				V r = d[1].re, i = d[1].im;
+				d[1].re = (r + i) * h;
+				d[1].im = (i - r) * h;
+				r = d[2].re;
+				d[2].re = d[2].im;
+				d[2].im = -r;
+				r = d[3].re;
+				i = d[3].im;
+				d[3].re = (i - r) * h;
+				d[3].im = -((r + i) * h);
+
+				Butterfly<4, V>::Run(b[0], b[1], b[2], b[3]);
+				Butterfly<4, V>::Run(d[0], d[1], d[2], d[3]);
+				for (int k = 0; k < 4; ++k)
+				{
+					a[k * 2 + 0] = b[k];
+					a[k * 2 + 1] = d[k];
+				}
+			}
+		};	// struct Butterfly<8, V>
+
+		//---------------------------------------
+		// Stockham 法の1ステージ
+		// x[q + s*(p + j*m)] の DFT に回転因子 W_n^(pk) を掛けて y[q + s*(R*p + k)] に書き出す
+		// q 方向に Ops::kLanes 要素ずつ計算する
+		//---------------------------------------
+		template <u32 R, typename Ops>
+		void StageStrided(const float* xr, const float* xi, float* yr, float* yi, u32 n, u32 s, const float* twr, const float* twi)
+		{
+			typedef typename Ops::V V;
+			const u32 m = n / R;
+			const V h = Ops::Splat(0.70710678118654752f);
+
+			for (u32 p = 0; p < m; ++p)
+			{
+				V wr[R], wi[R];
+				for (u32 k = 1; k < R; ++k)
+				{
+					wr[k] = Ops::Splat(twr[(k - 1) * m + p]);
+					wi[k] = Ops::Splat(twi[(k - 1) * m + p]);
+				}
+
+				const size_t src = static_cast<size_t>(s) * p;
+				const size_t dst = static_cast<size_t>(s) * R * p;
+				for (u32 q = 0; q < s; q += Ops::kLanes)
+				{
+					Complex<V> a[R];
+					for (u32 j = 0; j < R; ++j)
+					{
+						size_t index = src + static_cast<size_t>(s) * j * m + q;
+						a[j].re = Ops::Load(xr + index);
+						a[j].im = Ops::Load(xi + index);
+					}
+
+					Butterfly<R, V>::Run(a, h);
+
+					Ops::Store(yr + dst + q, a[0].re);
+					Ops::Store(yi + dst + q, a[0].im);
+					for (u32 k = 1; k < R; ++k)
+					{
+						size_t index = dst + static_cast<size_t>(s) * k + q;
+						Ops::Store(yr + index, a[k].re * wr[k] - a[k].im * wi[k]);
+						Ops::Store(yi + index, a[k].re * wi[k] + a[k].im * wr[k]);
+					}
+				}
+			}
+		}
+
+#if defined(SL12_FFT_SIMD)
+		//---------------------------------------
+		// 最初のステージ (s = 1)
+		// p 方向に4要素ずつ計算し、転置して連続したメモリに書き出す
+		//---------------------------------------
+		template <u32 R>
+		void StageFirstSimd(const float* xr, const float* xi, float* yr, float* yi, u32 n, const float* twr, const float* twi)
+		{
+			static_assert((R % 4) == 0, "radix must be a multiple of 4.");
+			const u32 m = n / R;
+			const Vec4 h = SimdOps::Splat(0.70710678118654752f);
+
+			for (u32 p = 0; p < m; p += 4)
+			{
+				Complex<Vec4> a[R];
+				for (u32 j = 0; j < R; ++j)
+				{
+					a[j].re = SimdOps::Load(xr + j * m + p);
+					a[j].im = SimdOps::Load(xi + j * m + p);
+				}
+
+				Butterfly<R, Vec4>::Run(a, h);
+
+				for (u32 k = 1; k < R; ++k)
+				{
+					Vec4 wr = SimdOps::Load(twr + (k - 1) * m + p);
+					Vec4 wi = SimdOps::Load(twi + (k - 1) * m + p);
+					Vec4 re = a[k].re * wr - a[k].im * wi;
+					a[k].im = a[k].re * wi + a[k].im * wr;
+					a[k].re = re;
+				}
+
+				// a[k] は p..p+3 の k 番目の出力なので、4x4 ずつ転置すると y[R*p] から連続する
+				for (u32 k = 0; k < R; k += 4)
+				{
+					Transpose4(a[k].re, a[k + 1].re, a[k + 2].re, a[k + 3].re);
+					Transpose4(a[k].im, a[k + 1].im, a[k + 2].im, a[k + 3].im);
+					for (u32 l = 0; l < 4; ++l)
+					{
+						SimdOps::Store(yr + R * (p + l) + k, a[k + l].re);
+						SimdOps::Store(yi + R * (p + l) + k, a[k + l].im);
+					}
+				}
+			}
+		}
+#endif
+
+		template <u32 R>
+		void RunStage(const float* xr, const float* xi, float* yr, float* yi, u32 n, u32 s, const float* twr, const float* twi)
+		{
+#if defined(SL12_FFT_SIMD)
+			if ((s % SimdOps::kLanes) == 0)
+			{
+				StageStrided<R, SimdOps>(xr, xi, yr, yi, n, s, twr, twi);
+				return;
+			}
+			if (s == 1 && ((n / R) % 4) == 0)
+			{
+				StageFirstSimd<R>(xr, xi, yr, yi, n, twr, twi);
+				return;
+			}
+#endif
+			StageStrided<R, ScalarOps>(xr, xi, yr, yi, n, s, twr, twi);
+		}
+
+		// 基数2は最後のステージにしか現れないので、最初のステージ用の実装は持たない
+		void RunStage2(const float* xr, const float* xi, float* yr, float* yi, u32 n, u32 s, const float* twr, const float* twi)
+		{
+#if defined(SL12_FFT_SIMD)
+			if ((s % SimdOps::kLanes) == 0)
+			{
+				StageStrided<2, SimdOps>(xr, xi, yr, yi, n, s, twr, twi);
+				return;
+			}
+#endif
+			StageStrided<2, ScalarOps>(xr, xi, yr, yi, n, s, twr, twi);
+		}
+
+		//---------------------------------------
+		// 複素数の要素ごとの積
+		// 出力は入力と同じ配列でもよい
+		//---------------------------------------
+		void MultiplyComplex(const float* pAr, const float* pAi, const float* pBr, const float* pBi, float* pOutR, float* pOutI, u32 count)
+		{
+			u32 i = 0;
+#if defined(SL12_FFT_SIMD)
+			for (; i + 4 <= count; i += 4)
+			{
+				Vec4 ar = SimdOps::Load(pAr + i), ai = SimdOps::Load(pAi + i);
+				Vec4 br = SimdOps::Load(pBr + i), bi = SimdOps::Load(pBi + i);
+				SimdOps::Store(pOutR + i, ar * br - ai * bi);
+				SimdOps::Store(pOutI + i, ar * bi + ai * br);
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				float ar = pAr[i], ai = pAi[i];
+				float br = pBr[i], bi = pBi[i];
+				pOutR[i] = ar * br - ai * bi;
+				pOutI[i] = ar * bi + ai * br;
+			}
+		}
+
+		void Scale(float* p, float scale, u32 count)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				p[i] *= scale;
+			}
+		}
+
+		//---------------------------------------
+		// 偶数番目と奇数番目の要素に分ける
+		//---------------------------------------
+		void SplitEvenOdd(const float* pSrc, float* pEven, float* pOdd, u32 count)
+		{
+			u32 i = 0;
+#if defined(SL12_FFT_SIMD)
+			for (; i + 4 <= count; i += 4)
+			{
+				Vec4 even, odd;
+				Deinterleave(pSrc + i * 2, even, odd);
+				SimdOps::Store(pEven + i, even);
+				SimdOps::Store(pOdd + i, odd);
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				pEven[i] = pSrc[i * 2 + 0];
+				pOdd[i] = pSrc[i * 2 + 1];
+			}
+		}
+		void MergeEvenOdd(const float* pEven, const float* pOdd, float scale, float* pDst, u32 count)
+		{
+			u32 i = 0;
+#if defined(SL12_FFT_SIMD)
+			const Vec4 s = SimdOps::Splat(scale);
+			for (; i + 4 <= count; i += 4)
+			{
+				Interleave(SimdOps::Load(pEven + i) * s, SimdOps::Load(pOdd + i) * s, pDst + i * 2);
+			}
+#endif
+			for (; i < count; ++i)
+			{
+				pDst[i * 2 + 0] = pEven[i] * scale;
+				pDst[i * 2 + 1] = pOdd[i] * scale;
+			}
+		}
+
+	}	// namespace
+
+
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool FFTPlan::Initialize(u32 length)
+	{
+		Destroy();
+
+		// Bluestein 法の内部の FFT が u32 に収まる範囲
+		if (length == 0 || length > (1u << 30))
+		{
+			return false;
+		}
+		length_ = length;
+
+		if (IsPowerOfTwo(length))
+		{
+			// 基数8を優先し、余った4か2は最後のステージにする
+			// 最初のステージ以外は s が4の倍数になり、列方向に SIMD で計算できる
+			u32 log2 = 0;
+			while ((1u << log2) < length)
+			{
+				++log2;
+			}
+			std::vector<u32> radices(log2 / 3, 8);
+			if ((log2 % 3) == 1)
+			{
+				radices.push_back(2);
+			}
+			else if ((log2 % 3) == 2)
+			{
+				radices.push_back(4);
+			}
+
+			u32 n = length, s = 1;
+			for (auto radix : radices)
+			{
+				Stage stage;
+				stage.radix = radix;
+				stage.length = n;
+				stage.stride = s;
+				stage.twiddleOffset = static_cast<u32>(twiddleRe_.size());
+
+				// W_n^(pk). p * k < n なので剰余は不要
+				const u32 m = n / radix;
+				for (u32 k = 1; k < radix; ++k)
+				{
+					for (u32 p = 0; p < m; ++p)
+					{
+						double a = -2.0 * kPi * static_cast<double>(p * k) / static_cast<double>(n);
+						twiddleRe_.push_back(static_cast<float>(cos(a)));
+						twiddleIm_.push_back(static_cast<float>(sin(a)));
+					}
+				}
+				stages_.push_back(stage);
+
+				n /= radix;
+				s *= radix;
+			}
+
+			workSize_ = static_cast<size_t>(length) * 2;
+			return true;
+		}
+
+		// Bluestein 法
+		// X[k] = w[k] Σ (x[n] w[n]) conj(w[k-n]), w[n] = exp(-πi n^2/N) を長さ M >= 2N-1 の巡回畳み込みで求める
+		u32 innerLength = 1;
+		while (innerLength < length * 2 - 1)
+		{
+			innerLength <<= 1;
+		}
+		pInner_.reset(new FFTPlan());
+		if (!pInner_->Initialize(innerLength))
+		{
+			Destroy();
+			return false;
+		}
+
+		chirpRe_.resize(length);
+		chirpIm_.resize(length);
+		for (u32 i = 0; i < length; ++i)
+		{
+			// n^2 は大きくなるので、周期 2N の剰余を整数で求めてから角度にする
+			u64 sq = (static_cast<u64>(i) * i) % (static_cast<u64>(length) * 2);
+			double a = -kPi * static_cast<double>(sq) / static_cast<double>(length);
+			chirpRe_[i] = static_cast<float>(cos(a));
+			chirpIm_[i] = static_cast<float>(sin(a));
+		}
+
+		filterRe_.assign(innerLength, 0.0f);
+		filterIm_.assign(innerLength, 0.0f);
+		filterRe_[0] = chirpRe_[0];
+		filterIm_[0] = -chirpIm_[0];
+		for (u32 i = 1; i < length; ++i)
+		{
+			filterRe_[i] = filterRe_[innerLength - i] = chirpRe_[i];
+			filterIm_[i] = filterIm_[innerLength - i] = -chirpIm_[i];
+		}
+		std::vector<float> work(pInner_->GetWorkSize());
+		pInner_->Execute(filterRe_.data(), filterIm_.data(), work.data());
+		// 逆変換の正規化をここで済ませておく
+		Scale(filterRe_.data(), 1.0f / static_cast<float>(innerLength), innerLength);
+		Scale(filterIm_.data(), 1.0f / static_cast<float>(innerLength), innerLength);
+
+		workSize_ = static_cast<size_t>(innerLength) * 2 + pInner_->GetWorkSize();
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void FFTPlan::Destroy()
+	{
+		length_ = 0;
+		workSize_ = 0;
+		stages_.clear();
+		twiddleRe_.clear();
+		twiddleIm_.clear();
+		pInner_.reset();
+		chirpRe_.clear();
+		chirpIm_.clear();
+		filterRe_.clear();
+		filterIm_.clear();
+	}
+
+	//---------------------------------------
+	// 順変換する
+	//---------------------------------------
+	void FFTPlan::Forward(float* pRe, float* pIm, float* pWork) const
+	{
+		Execute(pRe, pIm, pWork);
+	}
+
+	//---------------------------------------
+	// 逆変換する
+	// 実部と虚部を入れ替えた順変換で計算する
+	//---------------------------------------
+	void FFTPlan::Inverse(float* pRe, float* pIm, float* pWork) const
+	{
+		Execute(pIm, pRe, pWork);
+
+		const float scale = 1.0f / static_cast<float>(length_);
+		Scale(pRe, scale, length_);
+		Scale(pIm, scale, length_);
+	}
+
+	//---------------------------------------
+	// 正規化しない順変換
+	//---------------------------------------
+	void FFTPlan::Execute(float* pRe, float* pIm, float* pWork) const
+	{
+		if (pInner_)
+		{
+			ExecuteBluestein(pRe, pIm, pWork);
+		}
+		else
+		{
+			ExecuteStockham(pRe, pIm, pWork);
+		}
+	}
+
+	//---------------------------------------
+	// Stockham 法
+	// ステージごとに入力と作業領域を入れ替える
+	//---------------------------------------
+	void FFTPlan::ExecuteStockham(float* pRe, float* pIm, float* pWork) const
+	{
+		float* xr = pRe;
+		float* xi = pIm;
+		float* yr = pWork;
+		float* yi = pWork + length_;
+
+		for (auto&& stage : stages_)
+		{
+			const float* twr = twiddleRe_.data() + stage.twiddleOffset;
+			const float* twi = twiddleIm_.data() + stage.twiddleOffset;
+			switch (stage.radix)
+			{
+			case 8: RunStage<8>(xr, xi, yr, yi, stage.length, stage.stride, twr, twi); break;
+			case 4: RunStage<4>(xr, xi, yr, yi, stage.length, stage.stride, twr, twi); break;
+			default: RunStage2(xr, xi, yr, yi, stage.length, stage.stride, twr, twi); break;
+			}
+			std::swap(xr, yr);
+			std::swap(xi, yi);
+		}
+
+		// ステージ数が奇数の場合は結果が作業領域にある
+		if (xr != pRe)
+		{
+			memcpy(pRe, xr, sizeof(float) * length_);
+			memcpy(pIm, xi, sizeof(float) * length_);
+		}
+	}
+
+	//---------------------------------------
+	// Bluestein 法
+	//---------------------------------------
+	void FFTPlan::ExecuteBluestein(float* pRe, float* pIm, float* pWork) const
+	{
+		const u32 innerLength = pInner_->GetLength();
+		float* ar = pWork;
+		float* ai = pWork + innerLength;
+		float* pInnerWork = pWork + static_cast<size_t>(innerLength) * 2;
+
+		MultiplyComplex(pRe, pIm, chirpRe_.data(), chirpIm_.data(), ar, ai, length_);
+		memset(ar + length_, 0, sizeof(float) * (innerLength - length_));
+		memset(ai + length_, 0, sizeof(float) * (innerLength - length_));
+
+		// 巡回畳み込み. フィルタは 1/M を掛けてあるので、逆変換は正規化しない
+		pInner_->Execute(ar, ai, pInnerWork);
+		MultiplyComplex(ar, ai, filterRe_.data(), filterIm_.data(), ar, ai, innerLength);
+		pInner_->Execute(ai, ar, pInnerWork);
+
+		MultiplyComplex(ar, ai, chirpRe_.data(), chirpIm_.data(), pRe, pIm, length_);
+	}
+
+
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool RealFFTPlan::Initialize(u32 length)
+	{
+		Destroy();
+
+		if (length == 0)
+		{
+			return false;
+		}
+
+		if ((length % 2) != 0)
+		{
+			// 奇数の場合は虚部を0にして複素 FFT で計算する
+			if (!plan_.Initialize(length))
+			{
+				return false;
+			}
+			length_ = length;
+			workSize_ = static_cast<size_t>(length) * 2 + plan_.GetWorkSize();
+			return true;
+		}
+
+		const u32 half = length / 2;
+		if (!plan_.Initialize(half))
+		{
+			return false;
+		}
+		length_ = length;
+
+		twiddleRe_.resize(half + 1);
+		twiddleIm_.resize(half + 1);
+		for (u32 k = 0; k <= half; ++k)
+		{
+			double a = -2.0 * kPi * static_cast<double>(k) / static_cast<double>(length);
+			twiddleRe_[k] = static_cast<float>(cos(a));
+			twiddleIm_[k] = static_cast<float>(sin(a));
+		}
+
+		workSize_ = static_cast<size_t>(half) * 2 + plan_.GetWorkSize();
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void RealFFTPlan::Destroy()
+	{
+		length_ = 0;
+		workSize_ = 0;
+		plan_.Destroy();
+		twiddleRe_.clear();
+		twiddleIm_.clear();
+	}
+
+	//---------------------------------------
+	// 順変換する
+	// z[n] = x[2n] + i x[2n+1] の FFT Z から、偶数番目の FFT E と奇数番目の FFT O を取り出して
+	// X[k] = E[k] + W_N^k O[k] とする
+	//---------------------------------------
+	void RealFFTPlan::Forward(const float* pSrc, float* pRe, float* pIm, float* pWork) const
+	{
+		if ((length_ % 2) != 0)
+		{
+			float* zr = pWork;
+			float* zi = pWork + length_;
+			memcpy(zr, pSrc, sizeof(float) * length_);
+			memset(zi, 0, sizeof(float) * length_);
+			plan_.Execute(zr, zi, pWork + static_cast<size_t>(length_) * 2);
+			memcpy(pRe, zr, sizeof(float) * GetSpectrumLength());
+			memcpy(pIm, zi, sizeof(float) * GetSpectrumLength());
+			return;
+		}
+
+		const u32 half = length_ / 2;
+		float* zr = pWork;
+		float* zi = pWork + half;
+		SplitEvenOdd(pSrc, zr, zi, half);
+		plan_.Execute(zr, zi, pWork + static_cast<size_t>(half) * 2);
+
+		// 直流とナイキスト周波数は Z[0] だけから求まる
+		pRe[0] = zr[0] + zi[0];
+		pIm[0] = 0.0f;
+		pRe[half] = zr[0] - zi[0];
+		pIm[half] = 0.0f;
+
+		for (u32 k = 1; k < half; ++k)
+		{
+			// E = (Z[k] + conj(Z[H-k])) / 2, O = (Z[k] - conj(Z[H-k])) / 2i
+			float ar = zr[k], ai = zi[k];
+			float br = zr[half - k], bi = -zi[half - k];
+			float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+			float orr = 0.5f * (ai - bi), oi = -0.5f * (ar - br);
+			float wr = twiddleRe_[k], wi = twiddleIm_[k];
+			pRe[k] = er + (wr * orr - wi * oi);
+			pIm[k] = ei + (wr * oi + wi * orr);
+		}
+	}
+
+	//---------------------------------------
+	// 逆変換する
+	// E[k] = (X[k] + conj(X[H-k])) / 2, O[k] = (X[k] - conj(X[H-k])) / 2 * conj(W_N^k) から
+	// Z[k] = E[k] + i O[k] を作り、半分の長さで逆変換する
+	//---------------------------------------
+	void RealFFTPlan::Inverse(const float* pRe, const float* pIm, float* pDst, float* pWork) const
+	{
+		if ((length_ % 2) != 0)
+		{
+			// エルミート対称なスペクトルに戻して複素 FFT で逆変換する
+			float* zr = pWork;
+			float* zi = pWork + length_;
+			zr[0] = pRe[0];
+			zi[0] = 0.0f;
+			for (u32 k = 1; k < GetSpectrumLength(); ++k)
+			{
+				zr[k] = zr[length_ - k] = pRe[k];
+				zi[k] = pIm[k];
+				zi[length_ - k] = -pIm[k];
+			}
+			plan_.Execute(zi, zr, pWork + static_cast<size_t>(length_) * 2);
+			const float scale = 1.0f / static_cast<float>(length_);
+			for (u32 i = 0; i < length_; ++i)
+			{
+				pDst[i] = zr[i] * scale;
+			}
+			return;
+		}
+
+		const u32 half = length_ / 2;
+		float* zr = pWork;
+		float* zi = pWork + half;
+		for (u32 k = 0; k < half; ++k)
+		{
+			float ar = pRe[k], ai = (k == 0) ? 0.0f : pIm[k];
+			float br = pRe[half - k], bi = (k == 0) ? 0.0f : -pIm[half - k];
+			float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+			float dr = 0.5f * (ar - br), di = 0.5f * (ai - bi);
+			float wr = twiddleRe_[k], wi = twiddleIm_[k];
+			float orr = dr * wr + di * wi, oi = di * wr - dr * wi;
+			zr[k] = er - oi;
+			zi[k] = ei + orr;
+		}
+
+		plan_.Execute(zi, zr, pWork + static_cast<size_t>(half) * 2);
+		MergeEvenOdd(zr, zi, 1.0f / static_cast<float>(half), pDst, half);
+	}
+
+
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool FFT2D::Initialize(u32 width, u32 height)
+	{
+		Destroy();
+
+		if (!rowPlan_.Initialize(width) || !columnPlan_.Initialize(height) || !realRowPlan_.Initialize(width))
+		{
+			Destroy();
+			return false;
+		}
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void FFT2D::Destroy()
+	{
+		rowPlan_.Destroy();
+		columnPlan_.Destroy();
+		realRowPlan_.Destroy();
+	}
+
+	//---------------------------------------
+	// 複素数の順変換
+	//---------------------------------------
+	void FFT2D::Forward(float* pRe, float* pIm, u32 numThreads) const
+	{
+		RowPass(pRe, pIm, false, numThreads);
+		ColumnPass(pRe, pIm, GetWidth(), false, numThreads);
+	}
+
+	//---------------------------------------
+	// 複素数の逆変換
+	//---------------------------------------
+	void FFT2D::Inverse(float* pRe, float* pIm, u32 numThreads) const
+	{
+		RowPass(pRe, pIm, true, numThreads);
+		ColumnPass(pRe, pIm, GetWidth(), true, numThreads);
+	}
+
+	//---------------------------------------
+	// 実数の順変換
+	//---------------------------------------
+	void FFT2D::ForwardReal(const float* pSrc, float* pRe, float* pIm, u32 numThreads) const
+	{
+		const u32 width = GetWidth();
+		const u32 height = GetHeight();
+		const u32 spectrumWidth = GetSpectrumWidth();
+		const u32 jobCount = (height + kRowsPerJob - 1) / kRowsPerJob;
+		ParallelFor(jobCount, GetThreadCount(numThreads, jobCount), [&](u32 job)
+		{
+			std::vector<float> work(realRowPlan_.GetWorkSize());
+			const u32 last = std::min(job * kRowsPerJob + kRowsPerJob, height);
+			for (u32 y = job * kRowsPerJob; y < last; ++y)
+			{
+				realRowPlan_.Forward(pSrc + static_cast<size_t>(y) * width, pRe + static_cast<size_t>(y) * spectrumWidth, pIm + static_cast<size_t>(y) * spectrumWidth, work.data());
+			}
+		});
+
+		ColumnPass(pRe, pIm, spectrumWidth, false, numThreads);
+	}
+
+	//---------------------------------------
+	// 実数の逆変換
+	//---------------------------------------
+	void FFT2D::InverseReal(float* pRe, float* pIm, float* pDst, u32 numThreads) const
+	{
+		const u32 width = GetWidth();
+		const u32 height = GetHeight();
+		const u32 spectrumWidth = GetSpectrumWidth();
+		ColumnPass(pRe, pIm, spectrumWidth, true, numThreads);
+
+		const u32 jobCount = (height + kRowsPerJob - 1) / kRowsPerJob;
+		ParallelFor(jobCount, GetThreadCount(numThreads, jobCount), [&](u32 job)
+		{
+			std::vector<float> work(realRowPlan_.GetWorkSize());
+			const u32 last = std::min(job * kRowsPerJob + kRowsPerJob, height);
+			for (u32 y = job * kRowsPerJob; y < last; ++y)
+			{
+				realRowPlan_.Inverse(pRe + static_cast<size_t>(y) * spectrumWidth, pIm + static_cast<size_t>(y) * spectrumWidth, pDst + static_cast<size_t>(y) * width, work.data());
+			}
+		});
+	}
+
+	//---------------------------------------
+	// 行方向の FFT
+	//---------------------------------------
+	void FFT2D::RowPass(float* pRe, float* pIm, bool isInverse, u32 numThreads) const
+	{
+		const u32 width = GetWidth();
+		const u32 height = GetHeight();
+		const u32 jobCount = (height + kRowsPerJob - 1) / kRowsPerJob;
+		ParallelFor(jobCount, GetThreadCount(numThreads, jobCount), [&](u32 job)
+		{
+			std::vector<float> work(rowPlan_.GetWorkSize());
+			const u32 last = std::min(job * kRowsPerJob + kRowsPerJob, height);
+			for (u32 y = job * kRowsPerJob; y < last; ++y)
+			{
+				float* re = pRe + static_cast<size_t>(y) * width;
+				float* im = pIm + static_cast<size_t>(y) * width;
+				if (isInverse)
+				{
+					rowPlan_.Inverse(re, im, work.data());
+				}
+				else
+				{
+					rowPlan_.Forward(re, im, work.data());
+				}
+			}
+		});
+	}
+
+	//---------------------------------------
+	// 列方向の FFT
+	// kColumnBlock 列ずつ連続したメモリにコピーして変換し、書き戻す
+	//---------------------------------------
+	void FFT2D::ColumnPass(float* pRe, float* pIm, u32 columnCount, bool isInverse, u32 numThreads) const
+	{
+		const u32 height = GetHeight();
+		const u32 jobCount = (columnCount + kColumnBlock - 1) / kColumnBlock;
+		ParallelFor(jobCount, GetThreadCount(numThreads, jobCount), [&](u32 job)
+		{
+			std::vector<float> lines(static_cast<size_t>(kColumnBlock) * height * 2);
+			std::vector<float> work(columnPlan_.GetWorkSize());
+			float* lr = lines.data();
+			float* li = lines.data() + static_cast<size_t>(kColumnBlock) * height;
+
+			const u32 first = job * kColumnBlock;
+			const u32 count = std::min(kColumnBlock, columnCount - first);
+			for (u32 y = 0; y < height; ++y)
+			{
+				const float* sr = pRe + static_cast<size_t>(y) * columnCount + first;
+				const float* si = pIm + static_cast<size_t>(y) * columnCount + first;
+				for (u32 c = 0; c < count; ++c)
+				{
+					lr[c * height + y] = sr[c];
+					li[c * height + y] = si[c];
+				}
+			}
+
+			for (u32 c = 0; c < count; ++c)
+			{
+				if (isInverse)
+				{
+					columnPlan_.Inverse(lr + c * height, li + c * height, work.data());
+				}
+				else
+				{
+					columnPlan_.Forward(lr + c * height, li + c * height, work.data());
+				}
+			}
+
+			for (u32 y = 0; y < height; ++y)
+			{
+				float* dr = pRe + static_cast<size_t>(y) * columnCount + first;
+				float* di = pIm + static_cast<size_t>(y) * columnCount + first;
+				for (u32 c = 0; c < count; ++c)
+				{
+					dr[c] = lr[c * height + y];
+					di[c] = li[c * height + y];
+				}
+			}
+		});
+	}
+
+
+	//---------------------------------------
+	// 倍精度の DFT
+	//---------------------------------------
+	void ComputeReferenceDFT(const double* pSrcRe, const double* pSrcIm, double* pDstRe, double* pDstIm, u32 length, bool isInverse)
+	{
+		if (length == 0)
+		{
+			return;
+		}
+
+		// nk の剰余で引くので、角度の誤差が n や k に比例して大きくならない
+		std::vector<double> cosTable(length), sinTable(length);
+		const double sign = isInverse ? 1.0 : -1.0;
+		for (u32 i = 0; i < length; ++i)
+		{
+			double a = 2.0 * kPi * static_cast<double>(i) / static_cast<double>(length);
+			cosTable[i] = cos(a);
+			sinTable[i] = sign * sin(a);
+		}
+
+		const double scale = isInverse ? 1.0 / static_cast<double>(length) : 1.0;
+		for (u32 k = 0; k < length; ++k)
+		{
+			double sr = 0.0, si = 0.0;
+			u32 index = 0;
+			for (u32 n = 0; n < length; ++n)
+			{
+				const double c = cosTable[index], s = sinTable[index];
+				sr += pSrcRe[n] * c - pSrcIm[n] * s;
+				si += pSrcRe[n] * s + pSrcIm[n] * c;
+				index += k;
+				if (index >= length)
+				{
+					index -= length;
+				}
+			}
+			pDstRe[k] = sr * scale;
+			pDstIm[k] = si * scale;
+		}
+	}
+
+	//---------------------------------------
+	// 名目上の浮動小数点演算数
+	//---------------------------------------
+	double GetFFTNominalFlops(u32 length, bool isReal)
+	{
+		if (length < 2)
+		{
+			return 0.0;
+		}
+		double n = static_cast<double>(length);
+		double flops = 5.0 * n * std::log2(n);
+		return isReal ? flops * 0.5 : flops;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,227 @@
+﻿#include <sl12/float16.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#	define SL12_F16_X86
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define SL12_F16_TARGET
+#	else
+#		include <cpuid.h>
+#		define SL12_F16_TARGET	__attribute__((target("avx,f16c")))
+#	endif
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#	define SL12_F16_ARM64
+#	include <arm_neon.h>
+#endif
+
+
+namespace sl12
+{
+	namespace
+	{
+#if defined(SL12_F16_X86)
+		//---------------------------------------
+		// F16C で8要素ずつ変換する
+		//---------------------------------------
+		SL12_F16_TARGET void FloatToHalfF16c(const float* pSrc, u16* pDst, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m256 v0 = _mm256_loadu_ps(pSrc + i);
+				__m256 v1 = _mm256_loadu_ps(pSrc + i + 8);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm256_cvtps_ph(v0, _MM_FROUND_TO_NEAREST_INT));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i + 8), _mm256_cvtps_ph(v1, _MM_FROUND_TO_NEAREST_INT));
+			}
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256 v = _mm256_loadu_ps(pSrc + i);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pDst + i), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+			}
+			_mm256_zeroupper();
+			for (; i < count; ++i)
+			{
+				pDst[i] = FloatToHalf(pSrc[i]);
+			}
+		}
+		SL12_F16_TARGET void HalfToFloatF16c(const u16* pSrc, float* pDst, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m128i h0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+				__m128i h1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i + 8));
+				_mm256_storeu_ps(pDst + i, _mm256_cvtph_ps(h0));
+				_mm256_storeu_ps(pDst + i + 8, _mm256_cvtph_ps(h1));
+			}
+			for (; i + 8 <= count; i += 8)
+			{
+				__m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSrc + i));
+				_mm256_storeu_ps(pDst + i, _mm256_cvtph_ps(h));
+			}
+			_mm256_zeroupper();
+			for (; i < count; ++i)
+			{
+				pDst[i] = HalfToFloat(pSrc[i]);
+			}
+		}
+
+		//---------------------------------------
+		// F16C と AVX が使用できるか調べる
+		// AVX のレジスタを OS が保存するかも確認する
+		//---------------------------------------
+		bool CheckF16c()
+		{
+			const int kOsxsave = 1 << 27;
+			const int kAvx = 1 << 28;
+			const int kF16c = 1 << 29;
+			const int kRequired = kOsxsave | kAvx | kF16c;
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			if ((info[2] & kRequired) != kRequired)
+			{
+				return false;
+			}
+			unsigned long long xcr0 = _xgetbv(0);
+#else
+			unsigned int eax, ebx, ecx, edx;
+			if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+			{
+				return false;
+			}
+			if ((ecx & kRequired) != kRequired)
+			{
+				return false;
+			}
+			unsigned int xcr0Lo, xcr0Hi;
+			__asm__ volatile("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+			unsigned long long xcr0 = (static_cast<unsigned long long>(xcr0Hi) << 32) | xcr0Lo;
+#endif
+			// XMM と YMM の状態
+			return (xcr0 & 0x6) == 0x6;
+		}
+#endif
+
+#if defined(SL12_F16_ARM64)
+		//---------------------------------------
+		// NEON で8要素ずつ変換する
+		// 丸めは FPCR の設定 (既定は最近接偶数丸め) に従う
+		//---------------------------------------
+		void FloatToHalfNeon(const float* pSrc, u16* pDst, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				float16x4_t h0 = vcvt_f16_f32(vld1q_f32(pSrc + i));
+				float16x4_t h1 = vcvt_f16_f32(vld1q_f32(pSrc + i + 4));
+				vst1q_u16(pDst + i, vcombine_u16(vreinterpret_u16_f16(h0), vreinterpret_u16_f16(h1)));
+			}
+			for (; i < count; ++i)
+			{
+				pDst[i] = FloatToHalf(pSrc[i]);
+			}
+		}
+		void HalfToFloatNeon(const u16* pSrc, float* pDst, size_t count)
+		{
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				uint16x8_t h = vld1q_u16(pSrc + i);
+				vst1q_f32(pDst + i, vcvt_f32_f16(vreinterpret_f16_u16(vget_low_u16(h))));
+				vst1q_f32(pDst + i + 4, vcvt_f32_f16(vreinterpret_f16_u16(vget_high_u16(h))));
+			}
+			for (; i < count; ++i)
+			{
+				pDst[i] = HalfToFloat(pSrc[i]);
+			}
+		}
+#endif
+
+		typedef void (*FloatToHalfFunc)(const float*, u16*, size_t);
+		typedef void (*HalfToFloatFunc)(const u16*, float*, size_t);
+
+	}	// namespace
+
+
+	//---------------------------------------
+	// スカラーで変換する
+	//---------------------------------------
+	void FloatToHalfArrayScalar(const float* pSrc, u16* pDst, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			pDst[i] = FloatToHalf(pSrc[i]);
+		}
+	}
+	void HalfToFloatArrayScalar(const u16* pSrc, float* pDst, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			pDst[i] = HalfToFloat(pSrc[i]);
+		}
+	}
+
+	//---------------------------------------
+	// 変換命令で変換する
+	//---------------------------------------
+	void FloatToHalfArrayHardware(const float* pSrc, u16* pDst, size_t count)
+	{
+#if defined(SL12_F16_X86)
+		FloatToHalfF16c(pSrc, pDst, count);
+#elif defined(SL12_F16_ARM64)
+		FloatToHalfNeon(pSrc, pDst, count);
+#else
+		FloatToHalfArrayScalar(pSrc, pDst, count);
+#endif
+	}
+	void HalfToFloatArrayHardware(const u16* pSrc, float* pDst, size_t count)
+	{
+#if defined(SL12_F16_X86)
+		HalfToFloatF16c(pSrc, pDst, count);
+#elif defined(SL12_F16_ARM64)
+		HalfToFloatNeon(pSrc, pDst, count);
+#else
+		HalfToFloatArrayScalar(pSrc, pDst, count);
+#endif
+	}
+
+	//---------------------------------------
+	// half の変換命令が使用できるか
+	//---------------------------------------
+	bool IsHardwareHalfSupported()
+	{
+#if defined(SL12_F16_X86)
+		static const bool kSupported = CheckF16c();
+		return kSupported;
+#elif defined(SL12_F16_ARM64)
+		// ARMv8 の Advanced SIMD には必ず含まれる
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	//---------------------------------------
+	// float の配列を half に変換する
+	//---------------------------------------
+	void FloatToHalfArray(const float* pSrc, u16* pDst, size_t count)
+	{
+		static const FloatToHalfFunc kFunc = IsHardwareHalfSupported() ? &FloatToHalfArrayHardware : &FloatToHalfArrayScalar;
+		kFunc(pSrc, pDst, count);
+	}
+
+	//---------------------------------------
+	// half の配列を float に変換する
+	//---------------------------------------
+	void HalfToFloatArray(const u16* pSrc, float* pDst, size_t count)
+	{
+		static const HalfToFloatFunc kFunc = IsHardwareHalfSupported() ? &HalfToFloatArrayHardware : &HalfToFloatArrayScalar;
+		kFunc(pSrc, pDst, count);
+	}
+
+}	// namespace sl12
+
+
+//	EOF
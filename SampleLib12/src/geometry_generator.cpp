@@ -0,0 +1,275 @@
+﻿#include <sl12/geometry_generator.h>
+
+#include <sl12/random.h>
+#include <sl12/float16.h>
+#include <sl12/parallel.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+
+namespace sl12
+{
+	namespace
+	{
+		// 1回に生成する三角形数. 作業領域がL2に収まる程度にする
+		const u32 kChunkTriangles = 1024;
+
+		u32 GetFormatSize(GeometryFormat::Type format)
+		{
+			switch (format)
+			{
+			case GeometryFormat::Float32x3: return sizeof(float) * 3;
+			case GeometryFormat::Float32x4: return sizeof(float) * 4;
+			case GeometryFormat::Float16x4: return sizeof(u16) * 4;
+			case GeometryFormat::Unorm8x4: return sizeof(u8) * 4;
+			case GeometryFormat::Snorm8x4: return sizeof(s8) * 4;
+			default: return 0;
+			}
+		}
+
+		//---------------------------------------
+		// 頂点の属性を4要素で取り出す
+		// 座標の W は1
+		//---------------------------------------
+		inline void GetAttribute(const GeneratedTriangle& tri, u32 vertex, GeometryAttribute::Type attribute, float* pOut)
+		{
+			switch (attribute)
+			{
+			case GeometryAttribute::Position:
+				memcpy(pOut, tri.position[vertex], sizeof(float) * 3);
+				pOut[3] = 1.0f;
+				break;
+			case GeometryAttribute::Color:
+				memcpy(pOut, tri.color, sizeof(float) * 4);
+				break;
+			default:
+				memcpy(pOut, tri.normal, sizeof(float) * 4);
+				break;
+			}
+		}
+
+		inline u8 ToUnorm8(float v)
+		{
+			v = std::min(std::max(v, 0.0f), 1.0f);
+			return static_cast<u8>(v * 255.0f + 0.5f);
+		}
+		inline s8 ToSnorm8(float v)
+		{
+			v = std::min(std::max(v, -1.0f), 1.0f);
+			return static_cast<s8>(v * 127.0f + ((v >= 0.0f) ? 0.5f : -0.5f));
+		}
+
+		/**************************************************//**
+		 * @brief スレッドごとの作業領域
+		******************************************************/
+		struct ChunkWork
+		{
+			std::vector<GeneratedTriangle>	triangles;
+			std::vector<float>				halfSrc;	//!< half に変換する値. 4要素 x 頂点数
+			std::vector<u16>				halfDst;
+			std::vector<u8>					vertices;	//!< 書き出す前の頂点
+		};	// struct ChunkWork
+
+	}	// namespace
+
+
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool GeometryGenerator::Initialize(const Desc& desc, const GeometryVertexElement* pElements, u32 numElements, u32 vertexStride)
+	{
+		Destroy();
+
+		if (!pElements || numElements == 0 || vertexStride == 0)
+		{
+			return false;
+		}
+		for (u32 i = 0; i < numElements; ++i)
+		{
+			const GeometryVertexElement& e = pElements[i];
+			if (e.attribute >= GeometryAttribute::Max || e.format >= GeometryFormat::Max)
+			{
+				return false;
+			}
+			if (e.offset + GetFormatSize(e.format) > vertexStride)
+			{
+				return false;
+			}
+		}
+
+		desc_ = desc;
+		elements_.assign(pElements, pElements + numElements);
+		vertexStride_ = vertexStride;
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void GeometryGenerator::Destroy()
+	{
+		desc_ = Desc();
+		elements_.clear();
+		vertexStride_ = 0;
+	}
+
+	//---------------------------------------
+	// 三角形の属性を求める
+	// 要素の使用の有無にかかわらず、すべての乱数を同じ順序で引く
+	//---------------------------------------
+	void GeometryGenerator::GetTriangle(u32 index, GeneratedTriangle& out) const
+	{
+		u32 state = PcgHash(index + PcgHash(desc_.seed));
+
+		float center[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			center[i] = (NextRandom(state) * 2.0f - 1.0f) * desc_.positionRange;
+		}
+
+		out.color[0] = NextRandom(state);
+		out.color[1] = NextRandom(state);
+		out.color[2] = NextRandom(state);
+		out.color[3] = 1.0f;
+
+		float n[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			n[i] = NextRandom(state) * 2.0f - 1.0f;
+		}
+		float lenSq = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+		if (lenSq > 1e-12f)
+		{
+			float inv = 1.0f / sqrtf(lenSq);
+			out.normal[0] = n[0] * inv;
+			out.normal[1] = n[1] * inv;
+			out.normal[2] = n[2] * inv;
+		}
+		else
+		{
+			out.normal[0] = 0.0f;
+			out.normal[1] = 0.0f;
+			out.normal[2] = 1.0f;
+		}
+		out.normal[3] = 0.0f;
+
+		const float s = desc_.triangleSize;
+		out.position[0][0] = center[0];
+		out.position[0][1] = center[1] + s;
+		out.position[0][2] = center[2];
+		out.position[1][0] = center[0] - s;
+		out.position[1][1] = center[1] - s;
+		out.position[1][2] = center[2];
+		out.position[2][0] = center[0] + s;
+		out.position[2][1] = center[1] - s;
+		out.position[2][2] = center[2];
+	}
+
+	//---------------------------------------
+	// 一部の三角形を生成する
+	//---------------------------------------
+	void GeometryGenerator::GenerateRange(void* pDst, u32 firstTriangle, u32 triangleCount) const
+	{
+		ChunkWork work;
+		u8* pOut = reinterpret_cast<u8*>(pDst);
+		const size_t triangleBytes = static_cast<size_t>(vertexStride_) * 3;
+
+		for (u32 first = 0; first < triangleCount; first += kChunkTriangles)
+		{
+			const u32 count = std::min(kChunkTriangles, triangleCount - first);
+			const u32 vertexCount = count * 3;
+
+			work.triangles.resize(count);
+			for (u32 i = 0; i < count; ++i)
+			{
+				GetTriangle(firstTriangle + first + i, work.triangles[i]);
+			}
+
+			work.vertices.resize(vertexCount * vertexStride_);
+			for (auto&& e : elements_)
+			{
+				u8* pElem = work.vertices.data() + e.offset;
+
+				if (e.format == GeometryFormat::Float16x4)
+				{
+					// half はチャンク単位でまとめて変換する
+					work.halfSrc.resize(vertexCount * 4);
+					work.halfDst.resize(vertexCount * 4);
+					for (u32 v = 0; v < vertexCount; ++v)
+					{
+						GetAttribute(work.triangles[v / 3], v % 3, e.attribute, &work.halfSrc[v * 4]);
+					}
+					FloatToHalfArray(work.halfSrc.data(), work.halfDst.data(), vertexCount * 4);
+					for (u32 v = 0; v < vertexCount; ++v, pElem += vertexStride_)
+					{
+						memcpy(pElem, &work.halfDst[v * 4], sizeof(u16) * 4);
+					}
+					continue;
+				}
+
+				for (u32 v = 0; v < vertexCount; ++v, pElem += vertexStride_)
+				{
+					float value[4];
+					GetAttribute(work.triangles[v / 3], v % 3, e.attribute, value);
+					switch (e.format)
+					{
+					case GeometryFormat::Float32x3:
+						memcpy(pElem, value, sizeof(float) * 3);
+						break;
+					case GeometryFormat::Float32x4:
+						memcpy(pElem, value, sizeof(float) * 4);
+						break;
+					case GeometryFormat::Unorm8x4:
+						{
+							u8 packed[4] = { ToUnorm8(value[0]), ToUnorm8(value[1]), ToUnorm8(value[2]), ToUnorm8(value[3]) };
+							memcpy(pElem, packed, sizeof(packed));
+						}
+						break;
+					case GeometryFormat::Snorm8x4:
+						{
+							s8 packed[4] = { ToSnorm8(value[0]), ToSnorm8(value[1]), ToSnorm8(value[2]), ToSnorm8(value[3]) };
+							memcpy(pElem, packed, sizeof(packed));
+						}
+						break;
+					default:
+						break;
+					}
+				}
+			}
+
+			// 要素の隙間も含めて頂点をまとめて書き出す
+			memcpy(pOut + triangleBytes * first, work.vertices.data(), triangleBytes * count);
+		}
+	}
+
+	//---------------------------------------
+	// すべての三角形を生成する
+	//---------------------------------------
+	void GeometryGenerator::Generate(void* pDst, u32 numThreads) const
+	{
+		if (numThreads == 0)
+		{
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+
+		// スレッド間の偏りを減らすため、チャンクより大きめの単位で取り合う
+		const u32 kTrianglesPerJob = kChunkTriangles * 16;
+		const u32 jobCount = (desc_.triangleCount + kTrianglesPerJob - 1) / kTrianglesPerJob;
+		numThreads = std::min(numThreads, std::max(jobCount, 1u));
+
+		u8* pOut = reinterpret_cast<u8*>(pDst);
+		const size_t triangleBytes = static_cast<size_t>(vertexStride_) * 3;
+		ParallelFor(jobCount, numThreads, [&](u32 job)
+		{
+			u32 first = job * kTrianglesPerJob;
+			u32 count = std::min(kTrianglesPerJob, desc_.triangleCount - first);
+			GenerateRange(pOut + triangleBytes * first, first, count);
+		});
+	}
+
+}	// namespace sl12
+
+
+//	EOF
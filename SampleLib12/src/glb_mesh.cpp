@@ -9,6 +9,8 @@
 #include "GLTFSDK/Deserialize.h"
 
 #include "sl12/util.h"
+#include "sl12/command_list.h"
+#include "sl12/upload_manager.h"
 
 #include "../../External/stb/stb_image.h"
 
@@ -179,6 +181,13 @@ namespace sl12
 
 		auto document = Deserialize(manifest);
 
+		// テクスチャのアップロードはまとめて発行する
+		UploadManager uploader;
+		if (!uploader.Initialize(pDev, pCmdList->GetParentQueue()))
+		{
+			return false;
+		}
+
 		// イメージ生成
 		textures_.resize(document.images.Size());
 		auto texture = textures_.data();
@@ -189,7 +198,7 @@ namespace sl12
 			texture->pTex = new Texture();
 			texture->pView = new TextureView();
 
-			if (!texture->pTex->InitializeFromPNG(pDev, pCmdList, data.data(), data.size(), false))
+			if (!texture->pTex->InitializeFromPNG(pDev, &uploader, data.data(), data.size(), false))
 			{
 				return false;
 			}
@@ -200,6 +209,7 @@ namespace sl12
 
 			texture++;
 		}
+		uploader.WaitIdle();
 
 		// マテリアル生成
 		for (auto&& mat : document.materials.Elements())
@@ -0,0 +1,148 @@
+﻿#include <sl12/gpu_profiler.h>
+
+#include <sl12/device.h>
+#include <sl12/command_list.h>
+#include <sl12/command_queue.h>
+
+
+namespace sl12
+{
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool GpuProfiler::Initialize(Device* pDev, u32 maxScopes)
+	{
+		Destroy();
+
+		// 区間ごとに開始と終了の2つのクエリを使う
+		for (auto&& v : timestamps_)
+		{
+			if (!v.Initialize(pDev, maxScopes * 2))
+			{
+				return false;
+			}
+		}
+		ticksPerSecond_ = pDev->GetGraphicsQueue().GetTimestampFrequency();
+
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void GpuProfiler::Destroy()
+	{
+		for (auto&& v : timestamps_)
+		{
+			v.Destroy();
+		}
+		for (u32 i = 0; i < Swapchain::kMaxBuffer; ++i)
+		{
+			scopes_[i].clear();
+			resolved_[i] = false;
+		}
+		openScopes_.clear();
+		events_.clear();
+	}
+
+	//---------------------------------------
+	// フレームの記録を開始する
+	//---------------------------------------
+	void GpuProfiler::BeginFrame(u32 frameIndex)
+	{
+		frameIndex_ = frameIndex % Swapchain::kMaxBuffer;
+
+		auto&& ts = timestamps_[frameIndex_];
+		auto&& scopes = scopes_[frameIndex_];
+		// NOTE: 解決していない場合は結果なしとして、前のフレームの結果を残さない
+		events_.clear();
+		if (resolved_[frameIndex_])
+		{
+			ticks_.resize(ts.GetCount());
+			ts.GetTimestamp(0, ticks_.size(), ticks_.data());
+
+			for (auto&& s : scopes)
+			{
+				if (s.beginQuery == kInvalidQuery || s.endQuery == kInvalidQuery)
+				{
+					continue;
+				}
+				ProfileEvent e;
+				e.name = s.name;
+				e.begin = ticks_[s.beginQuery];
+				e.end = ticks_[s.endQuery];
+				e.depth = s.depth;
+				e.track = 0;
+				events_.push_back(e);
+			}
+		}
+
+		ts.Reset();
+		scopes.clear();
+		resolved_[frameIndex_] = false;
+		openScopes_.clear();
+	}
+
+	//---------------------------------------
+	// 区間を開始する
+	//---------------------------------------
+	void GpuProfiler::BeginScope(CommandList* pCmdList, const char* name)
+	{
+		auto&& ts = timestamps_[frameIndex_];
+		auto&& scopes = scopes_[frameIndex_];
+
+		Scope s;
+		s.name = name;
+		s.depth = (u32)openScopes_.size();
+		s.beginQuery = kInvalidQuery;
+		s.endQuery = kInvalidQuery;
+
+		// 開いている区間を含め、すべての区間を閉じられるだけのクエリが残っている場合のみ記録する
+		if (ts.GetCount() + 2 + openScopes_.size() <= ts.GetMaxCount())
+		{
+			s.beginQuery = (u32)ts.GetCount();
+			ts.Query(pCmdList);
+		}
+
+		openScopes_.push_back((u32)scopes.size());
+		scopes.push_back(s);
+	}
+
+	//---------------------------------------
+	// 区間を終了する
+	//---------------------------------------
+	void GpuProfiler::EndScope(CommandList* pCmdList)
+	{
+		if (openScopes_.empty())
+		{
+			return;
+		}
+
+		auto&& ts = timestamps_[frameIndex_];
+		auto&& s = scopes_[frameIndex_][openScopes_.back()];
+		openScopes_.pop_back();
+
+		if (s.beginQuery != kInvalidQuery)
+		{
+			s.endQuery = (u32)ts.GetCount();
+			ts.Query(pCmdList);
+		}
+	}
+
+	//---------------------------------------
+	// フレームの記録を終了する
+	//---------------------------------------
+	void GpuProfiler::EndFrame(CommandList* pCmdList)
+	{
+		auto&& ts = timestamps_[frameIndex_];
+		if (ts.GetCount() > 0)
+		{
+			ts.Resolve(pCmdList);
+			resolved_[frameIndex_] = true;
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,445 @@
+﻿#include <sl12/light_cluster_binner.h>
+
+#include <sl12/point_light_set.h>
+#include <sl12/parallel.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+
+namespace sl12
+{
+	namespace
+	{
+		// 範囲外のタイルに入れておく値. 距離の2乗が必ず半径の2乗を超える
+		const float kOutsideTile = 3.0e38f;
+
+		// 区間 [minV, maxV] と値の距離. 区間内なら0
+		inline float AxisDistance(float minV, float maxV, float v)
+		{
+			return std::max(std::max(minV - v, v - maxV), 0.0f);
+		}
+	}
+
+	//---------------------------------------
+	// フロクセルのグリッドを作成する
+	//---------------------------------------
+	bool LightClusterBinner::Initialize(const GridDesc& desc)
+	{
+		Destroy();
+
+		if (desc.screenWidth == 0 || desc.screenHeight == 0 || desc.tileSize == 0 || desc.sliceCount == 0)
+		{
+			return false;
+		}
+		if (desc.nearZ <= 0.0f || desc.farZ <= desc.nearZ)
+		{
+			return false;
+		}
+
+		desc_ = desc;
+		tileCountX_ = (desc.screenWidth + desc.tileSize - 1) / desc.tileSize;
+		tileCountY_ = (desc.screenHeight + desc.tileSize - 1) / desc.tileSize;
+		tileStrideX_ = (tileCountX_ + 3) & ~3u;
+		sliceScale_ = (float)desc.sliceCount / logf(desc.farZ / desc.nearZ);
+
+		// スライスの境界. 隣接するスライスで境界の値を共有する
+		std::vector<float> bounds(desc.sliceCount + 1);
+		for (u32 k = 0; k < desc.sliceCount; ++k)
+		{
+			bounds[k] = desc.nearZ * powf(desc.farZ / desc.nearZ, (float)k / (float)desc.sliceCount);
+		}
+		bounds[desc.sliceCount] = desc.farZ;
+
+		float tanY = tanf(desc.fovY * 0.5f);
+		float tanX = tanY * (float)desc.screenWidth / (float)desc.screenHeight;
+
+		sliceMinZ_.resize(desc.sliceCount);
+		sliceMaxZ_.resize(desc.sliceCount);
+		tileMinX_.resize(desc.sliceCount * tileStrideX_);
+		tileMaxX_.resize(desc.sliceCount * tileStrideX_);
+		tileMinY_.resize(desc.sliceCount * tileCountY_);
+		tileMaxY_.resize(desc.sliceCount * tileCountY_);
+		for (u32 k = 0; k < desc.sliceCount; ++k)
+		{
+			float z0 = bounds[k];
+			float z1 = bounds[k + 1];
+			sliceMinZ_[k] = z0;
+			sliceMaxZ_[k] = z1;
+
+			// 錐台の断面は深度に比例して広がるので、AABBは手前と奥の断面の範囲になる
+			for (u32 x = 0; x < tileStrideX_; ++x)
+			{
+				u32 index = k * tileStrideX_ + x;
+				if (x < tileCountX_)
+				{
+					float e0 = ((float)(x * desc.tileSize) / (float)desc.screenWidth * 2.0f - 1.0f) * tanX;
+					float e1 = ((float)((x + 1) * desc.tileSize) / (float)desc.screenWidth * 2.0f - 1.0f) * tanX;
+					tileMinX_[index] = std::min(e0 * z0, e0 * z1);
+					tileMaxX_[index] = std::max(e1 * z0, e1 * z1);
+				}
+				else
+				{
+					tileMinX_[index] = kOutsideTile;
+					tileMaxX_[index] = kOutsideTile;
+				}
+			}
+			for (u32 y = 0; y < tileCountY_; ++y)
+			{
+				// 画面の上端が y の正方向
+				u32 index = k * tileCountY_ + y;
+				float e0 = (1.0f - (float)((y + 1) * desc.tileSize) / (float)desc.screenHeight * 2.0f) * tanY;
+				float e1 = (1.0f - (float)(y * desc.tileSize) / (float)desc.screenHeight * 2.0f) * tanY;
+				tileMinY_[index] = std::min(e0 * z0, e0 * z1);
+				tileMaxY_[index] = std::max(e1 * z0, e1 * z1);
+			}
+		}
+
+		clusterRanges_.assign(GetClusterCount() * 2, 0);
+
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void LightClusterBinner::Destroy()
+	{
+		tileCountX_ = tileCountY_ = tileStrideX_ = 0;
+		tileMinX_.clear();
+		tileMaxX_.clear();
+		tileMinY_.clear();
+		tileMaxY_.clear();
+		sliceMinZ_.clear();
+		sliceMaxZ_.clear();
+		lightX_.clear();
+		lightY_.clear();
+		lightZ_.clear();
+		lightRadius_.clear();
+		works_.clear();
+		clusterRanges_.clear();
+		lightIndices_.clear();
+	}
+
+	//---------------------------------------
+	// 深度からスライス番号を求める
+	//---------------------------------------
+	u32 LightClusterBinner::GetSlice(float depth) const
+	{
+		if (depth <= desc_.nearZ)
+		{
+			return 0;
+		}
+		u32 slice = (u32)(logf(depth / desc_.nearZ) * sliceScale_);
+		return std::min(slice, desc_.sliceCount - 1);
+	}
+
+	//---------------------------------------
+	// ライトをビュー空間に変換する
+	//---------------------------------------
+	void LightClusterBinner::TransformLights(const PointLightSet& lights, u32 lightCount, const DirectX::XMMATRIX& mtxWorldToView)
+	{
+		using namespace DirectX;
+
+		assert(lightCount <= lights.GetLightCount());
+
+		u32 blockCount = (lightCount + 3) / 4;
+		lightX_.resize(blockCount * 4);
+		lightY_.resize(blockCount * 4);
+		lightZ_.resize(blockCount * 4);
+		lightRadius_.resize(blockCount * 4);
+
+		XMVECTOR m[4][3];
+		for (int r = 0; r < 4; ++r)
+		{
+			m[r][0] = XMVectorSplatX(mtxWorldToView.r[r]);
+			m[r][1] = XMVectorSplatY(mtxWorldToView.r[r]);
+			m[r][2] = XMVectorSplatZ(mtxWorldToView.r[r]);
+		}
+
+		// NOTE: 積和は乗算と加算に分けて、FMAの有無で結果が変わらないようにする
+		for (u32 b = 0; b < blockCount; ++b)
+		{
+			const XMVECTOR* e = lights.GetPosBlock(b);
+			XMVECTOR x = XMVectorAdd(XMVectorMultiply(e[2], m[2][0]), m[3][0]);
+			XMVECTOR y = XMVectorAdd(XMVectorMultiply(e[2], m[2][1]), m[3][1]);
+			XMVECTOR z = XMVectorAdd(XMVectorMultiply(e[2], m[2][2]), m[3][2]);
+			x = XMVectorAdd(XMVectorMultiply(e[1], m[1][0]), x);
+			y = XMVectorAdd(XMVectorMultiply(e[1], m[1][1]), y);
+			z = XMVectorAdd(XMVectorMultiply(e[1], m[1][2]), z);
+			x = XMVectorAdd(XMVectorMultiply(e[0], m[0][0]), x);
+			y = XMVectorAdd(XMVectorMultiply(e[0], m[0][1]), y);
+			z = XMVectorAdd(XMVectorMultiply(e[0], m[0][2]), z);
+
+			// 右手系なので視線方向は -z
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&lightX_[b * 4]), x);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&lightY_[b * 4]), y);
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&lightZ_[b * 4]), XMVectorNegate(z));
+			XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&lightRadius_[b * 4]), e[3]);
+		}
+	}
+
+	//---------------------------------------
+	// ライトとフロクセルの判定
+	//---------------------------------------
+	bool LightClusterBinner::TestFroxel(u32 light, u32 x, u32 y, u32 slice) const
+	{
+		// NOTE: Bin の4タイルまとめた判定と同じ順序で計算する
+		float r = lightRadius_[light];
+		float r2 = r * r;
+		float dz = AxisDistance(sliceMinZ_[slice], sliceMaxZ_[slice], lightZ_[light]);
+		float dy = AxisDistance(tileMinY_[slice * tileCountY_ + y], tileMaxY_[slice * tileCountY_ + y], lightY_[light]);
+		float dx = AxisDistance(tileMinX_[slice * tileStrideX_ + x], tileMaxX_[slice * tileStrideX_ + x], lightX_[light]);
+		float dz2 = dz * dz;
+		float dy2 = dy * dy;
+		float dyz = dy2 + dz2;
+		float dx2 = dx * dx;
+		float d2 = dx2 + dyz;
+		return d2 <= r2;
+	}
+
+	//---------------------------------------
+	// 範囲内のライトを判定する
+	//---------------------------------------
+	void LightClusterBinner::BinLights(u32 first, u32 end, ThreadWork& work) const
+	{
+		using namespace DirectX;
+
+		work.counts.assign(GetClusterCount(), 0);
+		work.hitClusters.clear();
+		work.hitEnds.resize(end - first);
+
+		// 同じスレッドで上限に達したクラスタには、後続のライトは必ず入らないので記録しない
+		const u32 sliceCount = desc_.sliceCount;
+		const u32 maxLights = (desc_.maxLightsPerCluster > 0) ? desc_.maxLightsPerCluster : 0xffffffff;
+		for (u32 light = first; light < end; ++light)
+		{
+			float cx = lightX_[light];
+			float cy = lightY_[light];
+			float cz = lightZ_[light];
+			float r = lightRadius_[light];
+			float r2 = r * r;
+
+			// 候補の範囲は丸め誤差を考えて前後に1つ広げ、候補ごとに正確に判定する
+			u32 k0 = GetSlice(cz - r);
+			u32 k1 = GetSlice(cz + r);
+			k0 = (k0 > 0) ? k0 - 1 : 0;
+			k1 = std::min(k1 + 1, sliceCount - 1);
+
+			XMVECTOR vcx = XMVectorReplicate(cx);
+			XMVECTOR vr2 = XMVectorReplicate(r2);
+			for (u32 k = k0; k <= k1; ++k)
+			{
+				float dz = AxisDistance(sliceMinZ_[k], sliceMaxZ_[k], cz);
+				float dz2 = dz * dz;
+				if (dz2 > r2)
+				{
+					continue;
+				}
+
+				// タイルのAABBは x は右へ、y は下へ単調に並ぶ
+				const float* minX = &tileMinX_[k * tileStrideX_];
+				const float* maxX = &tileMaxX_[k * tileStrideX_];
+				const float* minY = &tileMinY_[k * tileCountY_];
+				const float* maxY = &tileMaxY_[k * tileCountY_];
+				u32 x0 = (u32)(std::lower_bound(maxX, maxX + tileCountX_, cx - r) - maxX);
+				u32 x1 = (u32)(std::upper_bound(minX, minX + tileCountX_, cx + r) - minX);
+				u32 y0 = (u32)(std::partition_point(minY, minY + tileCountY_, [&](float v) { return v > cy + r; }) - minY);
+				u32 y1 = (u32)(std::partition_point(maxY, maxY + tileCountY_, [&](float v) { return v >= cy - r; }) - maxY);
+				x0 = (x0 > 0) ? x0 - 1 : 0;
+				x1 = std::min(x1 + 1, tileCountX_);
+				y0 = (y0 > 0) ? y0 - 1 : 0;
+				y1 = std::min(y1 + 1, tileCountY_);
+
+				for (u32 y = y0; y < y1; ++y)
+				{
+					float dy = AxisDistance(minY[y], maxY[y], cy);
+					float dy2 = dy * dy;
+					float dyz = dy2 + dz2;
+					if (dyz > r2)
+					{
+						continue;
+					}
+
+					// 4タイルずつ判定する. 範囲外のレーンは kOutsideTile で必ず外れる
+					XMVECTOR vdyz = XMVectorReplicate(dyz);
+					u32 clusterBase = (k * tileCountY_ + y) * tileCountX_;
+					for (u32 x = x0 & ~3u; x < x1; x += 4)
+					{
+						XMVECTOR vmin = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(minX + x));
+						XMVECTOR vmax = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(maxX + x));
+						XMVECTOR dx = XMVectorMax(XMVectorMax(XMVectorSubtract(vmin, vcx), XMVectorSubtract(vcx, vmax)), XMVectorZero());
+						XMVECTOR d2 = XMVectorAdd(XMVectorMultiply(dx, dx), vdyz);
+						XMVECTOR hit = XMVectorLessOrEqual(d2, vr2);
+						if (XMVector4EqualInt(hit, XMVectorFalseInt()))
+						{
+							continue;
+						}
+
+						XMUINT4 mask;
+						XMStoreUInt4(&mask, hit);
+						const u32 lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+						for (u32 lane = 0; lane < 4; ++lane)
+						{
+							if (lanes[lane])
+							{
+								u32 cluster = clusterBase + x + lane;
+								if (work.counts[cluster] < maxLights)
+								{
+									work.counts[cluster]++;
+									work.hitClusters.push_back(cluster);
+								}
+							}
+						}
+					}
+				}
+			}
+			work.hitEnds[light - first] = (u32)work.hitClusters.size();
+		}
+	}
+
+	//---------------------------------------
+	// ライトをクラスタに割り当てる
+	//---------------------------------------
+	u32 LightClusterBinner::Bin(const PointLightSet& lights, u32 lightCount, const DirectX::XMMATRIX& mtxWorldToView, u32 numThreads)
+	{
+		TransformLights(lights, lightCount, mtxWorldToView);
+
+		// ライトが少ない場合はワーカーを起こして待つ方が高くつく
+		static const u32 kMinLightsPerThread = 256;
+		if (numThreads == 0)
+		{
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+		numThreads = std::max(std::min(numThreads, lightCount / kMinLightsPerThread), 1u);
+		if (works_.size() < numThreads)
+		{
+			works_.resize(numThreads);
+		}
+
+		// スレッドごとに連続したライトを判定する
+		ParallelFor(numThreads, numThreads, [&](u32 t)
+		{
+			u32 first = (u32)((u64)lightCount * t / numThreads);
+			u32 end = (u32)((u64)lightCount * (t + 1) / numThreads);
+			BinLights(first, end, works_[t]);
+		});
+
+		// クラスタごとに、スレッド順 = ライト順に詰める
+		// 各スレッドの counts は書き込み位置に置き換え、上限を超えた位置は書き込まない
+		u32 clusterCount = GetClusterCount();
+		const u32 maxLights = (desc_.maxLightsPerCluster > 0) ? desc_.maxLightsPerCluster : 0xffffffff;
+		u32 total = 0;
+		for (u32 c = 0; c < clusterCount; ++c)
+		{
+			u32 count = 0;
+			for (u32 t = 0; t < numThreads; ++t)
+			{
+				u32 threadCount = works_[t].counts[c];
+				works_[t].counts[c] = total + count;
+				count += threadCount;
+			}
+			count = std::min(count, maxLights);
+			clusterRanges_[c * 2 + 0] = total;
+			clusterRanges_[c * 2 + 1] = count;
+			total += count;
+		}
+
+		lightIndices_.resize(total);
+		ParallelFor(numThreads, numThreads, [&](u32 t)
+		{
+			auto&& work = works_[t];
+			u32 first = (u32)((u64)lightCount * t / numThreads);
+			u32 hit = 0;
+			for (u32 i = 0; i < (u32)work.hitEnds.size(); ++i)
+			{
+				for (; hit < work.hitEnds[i]; ++hit)
+				{
+					u32 cluster = work.hitClusters[hit];
+					u32 pos = work.counts[cluster]++;
+					if (pos < clusterRanges_[cluster * 2 + 0] + clusterRanges_[cluster * 2 + 1])
+					{
+						lightIndices_[pos] = first + i;
+					}
+				}
+			}
+		});
+
+		return total;
+	}
+
+	//---------------------------------------
+	// 割り当てのスカラー版リファレンス
+	//---------------------------------------
+	u32 LightClusterBinner::BinReference(const PointLightSet& lights, u32 lightCount, const DirectX::XMMATRIX& mtxWorldToView)
+	{
+		TransformLights(lights, lightCount, mtxWorldToView);
+
+		const u32 maxLights = (desc_.maxLightsPerCluster > 0) ? desc_.maxLightsPerCluster : 0xffffffff;
+		lightIndices_.clear();
+		for (u32 k = 0; k < desc_.sliceCount; ++k)
+		{
+			for (u32 y = 0; y < tileCountY_; ++y)
+			{
+				for (u32 x = 0; x < tileCountX_; ++x)
+				{
+					u32 cluster = (k * tileCountY_ + y) * tileCountX_ + x;
+					u32 offset = (u32)lightIndices_.size();
+					for (u32 light = 0; light < lightCount && (u32)lightIndices_.size() - offset < maxLights; ++light)
+					{
+						if (TestFroxel(light, x, y, k))
+						{
+							lightIndices_.push_back(light);
+						}
+					}
+					clusterRanges_[cluster * 2 + 0] = offset;
+					clusterRanges_[cluster * 2 + 1] = (u32)lightIndices_.size() - offset;
+				}
+			}
+		}
+
+		return (u32)lightIndices_.size();
+	}
+
+	//---------------------------------------
+	// クラスタごとの (オフセット, 個数) を書き出す
+	//---------------------------------------
+	void LightClusterBinner::WriteClusterRanges(u32* pOut, u32 maxIndices) const
+	{
+		u32 clusterCount = GetClusterCount();
+		for (u32 c = 0; c < clusterCount; ++c)
+		{
+			u32 offset = clusterRanges_[c * 2 + 0];
+			u32 count = clusterRanges_[c * 2 + 1];
+			if (offset >= maxIndices)
+			{
+				offset = count = 0;
+			}
+			else
+			{
+				count = std::min(count, maxIndices - offset);
+			}
+			pOut[c * 2 + 0] = offset;
+			pOut[c * 2 + 1] = count;
+		}
+	}
+
+	//---------------------------------------
+	// ライトインデックスリストを書き出す
+	//---------------------------------------
+	u32 LightClusterBinner::WriteLightIndices(u32* pOut, u32 maxIndices) const
+	{
+		u32 count = std::min((u32)lightIndices_.size(), maxIndices);
+		if (count > 0)
+		{
+			memcpy(pOut, lightIndices_.data(), sizeof(u32) * count);
+		}
+		return count;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -1,19 +1,24 @@
 ﻿#include "sl12/mesh.h"
 
+#include "sl12/upload_manager.h"
+#include "sl12/mesh_codec.h"
+#include "sl12/float16.h"
+#include <vector>
+
 
 namespace sl12
 {
 	//---------------------------------------
 	// 初期化する
 	//---------------------------------------
-	bool MeshShapeInstance::Initialize(sl12::Device* pDev, sl12::CommandList* pCmdList, const MeshShape* shape, const void* p_vertex_head)
+	bool MeshShapeInstance::Initialize(sl12::Device* pDev, sl12::UploadManager* pUploader, const MeshShape* shape, const void* p_vertex_head)
 	{
 		assert(shape != nullptr);
 		assert(p_vertex_head != nullptr);
 
 		pSrcShape_ = shape;
 
-		auto vbInitFunc = [&](VertexBuffer& vb, size_t stride, size_t offset)
+		auto vbInitFunc = [&](VertexBuffer& vb, size_t stride, const void* pData)
 		{
 			if (!vb.buffer_.Initialize(pDev, stride * shape->numVertices, stride, sl12::BufferUsage::VertexBuffer, false, false))
 			{
@@ -24,25 +29,49 @@ namespace sl12
 				return false;
 			}
 		
-			vb.buffer_.UpdateBuffer(pDev, pCmdList, reinterpret_cast<const u8*>(p_vertex_head) + offset, stride * shape->numVertices);
-			
-			return true;
+			return vb.buffer_.UpdateBuffer(pUploader, pData, stride * shape->numVertices);
 		};
 
+		// 圧縮されたストリームはここで展開してから転送する
+		// 転送データはアップロードマネージャの登録時にコピーされるので、展開先は使い回せる
+		const u8* pHead = reinterpret_cast<const u8*>(p_vertex_head);
+		std::vector<float> decoded;
+
 		// 座標
-		if (!vbInitFunc(vbPosition_, sizeof(float) * 3, shape->positionOffset))
+		const void* pPosition = pHead + shape->positionOffset;
+		if (shape->positionFormat == MeshStreamFormat::UNorm16x3)
+		{
+			decoded.resize(shape->numVertices * 3);
+			MeshDecodePositions(reinterpret_cast<const u16*>(pPosition), shape->numVertices, shape->aabbMin, shape->aabbMax, decoded.data());
+			pPosition = decoded.data();
+		}
+		if (!vbInitFunc(vbPosition_, sizeof(float) * 3, pPosition))
 		{
 			return false;
 		}
 
 		// 法線
-		if (!vbInitFunc(vbNormal_, sizeof(float) * 3, shape->normalOffset))
+		const void* pNormal = pHead + shape->normalOffset;
+		if (shape->normalFormat == MeshStreamFormat::OctSNorm16x2)
+		{
+			decoded.resize(shape->numVertices * 3);
+			MeshDecodeNormals(reinterpret_cast<const s16*>(pNormal), shape->numVertices, decoded.data());
+			pNormal = decoded.data();
+		}
+		if (!vbInitFunc(vbNormal_, sizeof(float) * 3, pNormal))
 		{
 			return false;
 		}
 
 		// テクスチャ座標
-		if (!vbInitFunc(vbTexcoord_, sizeof(float) * 2, shape->texcoordOffset))
+		const void* pTexcoord = pHead + shape->texcoordOffset;
+		if (shape->texcoordFormat == MeshStreamFormat::Half2)
+		{
+			decoded.resize(shape->numVertices * 2);
+			HalfToFloatArray(reinterpret_cast<const u16*>(pTexcoord), decoded.data(), shape->numVertices * 2);
+			pTexcoord = decoded.data();
+		}
+		if (!vbInitFunc(vbTexcoord_, sizeof(float) * 2, pTexcoord))
 		{
 			return false;
 		}
@@ -64,23 +93,49 @@ namespace sl12
 	//---------------------------------------
 	// 初期化する
 	//---------------------------------------
-	bool MeshSubmeshInstance::Initialize(sl12::Device* pDev, sl12::CommandList* pCmdList, const MeshSubmesh* submesh, const void* p_vertex_head)
+	bool MeshSubmeshInstance::Initialize(sl12::Device* pDev, sl12::UploadManager* pUploader, const MeshSubmesh* submesh, const void* p_vertex_head, const MeshSubmeshLod* pLods, u32 numLods)
 	{
 		assert(submesh != nullptr);
 		assert(p_vertex_head != nullptr);
+		assert(numLods == 0 || pLods != nullptr);
 
 		pSrcSubmesh_ = submesh;
+		pSrcLods_ = pLods;
+		numLods_ = numLods;
 
-		if (!indexBuffer_.buffer_.Initialize(pDev, sizeof(u32) * submesh->numSubmeshIndices, sizeof(u32), BufferUsage::IndexBuffer, false, false))
+		// 16bitインデックスはそのまま転送し、ビューのフォーマットで切り替える
+		size_t stride = (submesh->indexFormat == MeshStreamFormat::UInt16) ? sizeof(u16) : sizeof(u32);
+		auto ibInitFunc = [&](IndexBuffer& ib, u64 offset, u32 numIndices)
 		{
-			return false;
-		}
-		if (!indexBuffer_.view_.Initialize(pDev, &indexBuffer_.buffer_))
+			if (!ib.buffer_.Initialize(pDev, stride * numIndices, stride, BufferUsage::IndexBuffer, false, false))
+			{
+				return false;
+			}
+			if (!ib.view_.Initialize(pDev, &ib.buffer_))
+			{
+				return false;
+			}
+
+			return ib.buffer_.UpdateBuffer(pUploader, reinterpret_cast<const u8*>(p_vertex_head) + offset, stride * numIndices);
+		};
+
+		if (!ibInitFunc(indexBuffer_, submesh->indexBufferOffset, submesh->numSubmeshIndices))
 		{
 			return false;
 		}
 
-		indexBuffer_.buffer_.UpdateBuffer(pDev, pCmdList, reinterpret_cast<const u8*>(p_vertex_head) + submesh->indexBufferOffset, sizeof(u32) * submesh->numSubmeshIndices);
+		// LODは頂点バッファを共有し、インデックスバッファのみを持つ
+		if (numLods > 0)
+		{
+			pLodBuffers_ = new IndexBuffer[numLods];
+			for (u32 i = 0; i < numLods; ++i)
+			{
+				if (!ibInitFunc(pLodBuffers_[i], pLods[i].indexBufferOffset, pLods[i].numIndices))
+				{
+					return false;
+				}
+			}
+		}
 
 		return true;
 	}
@@ -91,31 +146,35 @@ namespace sl12
 	void MeshSubmeshInstance::Destroy()
 	{
 		indexBuffer_.~IndexBuffer();
+		sl12::SafeDeleteArray(pLodBuffers_);
+		pSrcLods_ = nullptr;
+		numLods_ = 0;
 	}
 
 
 	//---------------------------------------
 	// 初期化する
 	//---------------------------------------
-	bool MeshInstance::Initialize(sl12::Device* pDev, sl12::CommandList* pCmdList, const void* pBin)
+	bool MeshInstance::Initialize(sl12::Device* pDev, sl12::UploadManager* pUploader, const void* pBin, u64 binSize)
 	{
 		assert(pDev != nullptr);
-		assert(pCmdList != nullptr);
+		assert(pUploader != nullptr);
 		assert(pBin != nullptr);
 
-		// ヘッダを確認
-		pHead_ = reinterpret_cast<const MeshHead*>(pBin);
-		if (pHead_->fourCC[0] != 'M' || pHead_->fourCC[1] != 'E' || pHead_->fourCC[2] != 'S' || pHead_->fourCC[3] != 'H')
+		// ヘッダと各オフセットを検証する
+		// 不正なバイナリはGPUへの転送前にここで弾く
+		// v1 のバイナリはビュー内で変換されたテーブルを参照するため、ビューはインスタンスと同じ寿命とする
+		if (!view_.Initialize(pBin, binSize))
 		{
 			return false;
 		}
 
-		const MeshShape* pSrcShapes = reinterpret_cast<const MeshShape*>(pHead_ + 1);
-		const MeshMaterial* pSrcMaterials = reinterpret_cast<const MeshMaterial*>(pSrcShapes + pHead_->numShapes);
-		const MeshSubmesh* pSrcSubmeshes = reinterpret_cast<const MeshSubmesh*>(pSrcMaterials + pHead_->numMaterials);
-		const void* pVertexHead = pSrcSubmeshes + pHead_->numSubmeshes;
+		pHead_ = view_.GetHead();
+		const MeshShape* pSrcShapes = view_.GetShapes().begin();
+		const MeshSubmesh* pSrcSubmeshes = view_.GetSubmeshes().begin();
+		const void* pVertexHead = view_.GetVertexHead();
 
-		pMaterials_ = pSrcMaterials;
+		pMaterials_ = view_.GetMaterials().begin();
 		pShapes_ = new MeshShapeInstance[pHead_->numShapes];
 		pSubmeshes_ = new MeshSubmeshInstance[pHead_->numSubmeshes];
 		assert(pShapes_ != nullptr);
@@ -124,7 +183,7 @@ namespace sl12
 		// シェイプの初期化
 		for (s32 i = 0; i < pHead_->numShapes; ++i)
 		{
-			if (!pShapes_[i].Initialize(pDev, pCmdList, &pSrcShapes[i], pVertexHead))
+			if (!pShapes_[i].Initialize(pDev, pUploader, &pSrcShapes[i], pVertexHead))
 			{
 				return false;
 			}
@@ -133,7 +192,9 @@ namespace sl12
 		// サブメッシュの初期化
 		for (s32 i = 0; i < pHead_->numSubmeshes; ++i)
 		{
-			if (!pSubmeshes_[i].Initialize(pDev, pCmdList, &pSrcSubmeshes[i], pVertexHead))
+			u32 numLods = view_.GetSubmeshLodCount(i) - 1;
+			const MeshSubmeshLod* pLods = (numLods > 0) ? view_.GetSubmeshLod(i, 1) : nullptr;
+			if (!pSubmeshes_[i].Initialize(pDev, pUploader, &pSrcSubmeshes[i], pVertexHead, pLods, numLods))
 			{
 				return false;
 			}
@@ -142,6 +203,18 @@ namespace sl12
 		return true;
 	}
 
+	//---------------------------------------
+	// 画面上の誤差から描画するLODを選択する
+	//---------------------------------------
+	u32 MeshInstance::SelectLod(s32 index, const DirectX::XMFLOAT3& cameraPos, float projScale, float pixelError) const
+	{
+		assert(pSubmeshes_ != nullptr);
+		assert(0 <= index && index < pHead_->numSubmeshes);
+
+		const float pos[3] = { cameraPos.x, cameraPos.y, cameraPos.z };
+		return view_.SelectLod(static_cast<u32>(index), pos, projScale, pixelError);
+	}
+
 	//---------------------------------------
 	// 破棄する
 	//---------------------------------------
@@ -151,6 +224,7 @@ namespace sl12
 		sl12::SafeDeleteArray(pSubmeshes_);
 		pHead_ = nullptr;
 		pMaterials_ = nullptr;
+		view_.Destroy();
 	}
 
 }	// namespace sl12
@@ -0,0 +1,642 @@
+﻿#include "sl12/mesh_view.h"
+
+#include <algorithm>
+#include <string.h>
+#include <math.h>
+
+
+namespace sl12
+{
+	namespace
+	{
+		// 頂点領域内の [offset, offset + count * stride) が有効かを調べる
+		bool IsValidRange(u64 areaSize, u64 offset, u64 count, u64 stride, u64 alignment)
+		{
+			if (offset % alignment)
+			{
+				return false;
+			}
+			if (offset > areaSize)
+			{
+				return false;
+			}
+			// オーバーフローしないように除算で比較する
+			return count <= (areaSize - offset) / stride;
+		}
+
+		// 固定長の名前が終端されているかを調べる
+		bool IsTerminated(const char* name, size_t length)
+		{
+			return memchr(name, '\0', length) != nullptr;
+		}
+
+		// フォーマットの要素のアライメント
+		u64 GetStreamAlignment(u32 format)
+		{
+			switch (format)
+			{
+			case MeshStreamFormat::Float3:
+			case MeshStreamFormat::Float2:
+			case MeshStreamFormat::UInt32:
+				return 4;
+			default:
+				return 2;
+			}
+		}
+
+		// 全インデックスが頂点数未満であるかを調べる
+		template <typename T>
+		bool IsValidIndices(const T* pIndex, u32 count, u32 numVertices)
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				if (pIndex[i] >= numVertices)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		template <typename T>
+		MeshSpan<T> MakeSpan(const u8* p, u64 count)
+		{
+			MeshSpan<T> ret;
+			ret.pData = reinterpret_cast<const T*>(p);
+			ret.count = count;
+			return ret;
+		}
+	}
+
+	//---------------------------------------
+	// バイナリを検証して初期化する
+	//---------------------------------------
+	bool MeshView::Initialize(const void* pData, u64 size, bool checkIndexRange)
+	{
+		Destroy();
+
+		if (!pData || size < sizeof(MeshHeadV1))
+		{
+			return false;
+		}
+
+		// ヘッダを確認
+		const u8* pBin = reinterpret_cast<const u8*>(pData);
+		const MeshHeadV1* pHeadV1 = reinterpret_cast<const MeshHeadV1*>(pBin);
+		bool isV1 = memcmp(pHeadV1->fourCC, "MESH", 4) == 0;
+		bool isVersioned = memcmp(pHeadV1->fourCC, "MSHV", 4) == 0;
+		if (!isV1 && !isVersioned)
+		{
+			return false;
+		}
+		if (pHeadV1->numShapes < 0 || pHeadV1->numMaterials < 0 || pHeadV1->numSubmeshes < 0)
+		{
+			return false;
+		}
+		if (isVersioned)
+		{
+			if (size < sizeof(MeshHead))
+			{
+				return false;
+			}
+			u32 version = reinterpret_cast<const MeshHead*>(pBin)->version;
+			if (version < kMeshVersion2 || version > kMeshVersionLatest)
+			{
+				return false;
+			}
+		}
+
+		// 各テーブルがファイル内に収まっているか確認
+		// NOTE: 各数値は31bit以下なので64bitの積和でオーバーフローしない
+		u64 shapeOffset = isV1 ? sizeof(MeshHeadV1) : sizeof(MeshHead);
+		u64 shapeStride = isV1 ? sizeof(MeshShapeV1) : sizeof(MeshShape);
+		u64 materialOffset = shapeOffset + shapeStride * static_cast<u64>(pHeadV1->numShapes);
+		u64 submeshOffset = materialOffset + sizeof(MeshMaterial) * static_cast<u64>(pHeadV1->numMaterials);
+		u64 vertexOffset = submeshOffset + sizeof(MeshSubmesh) * static_cast<u64>(pHeadV1->numSubmeshes);
+		if (vertexOffset > size)
+		{
+			return false;
+		}
+
+		// チャンクテーブルがある場合は頂点領域の前に配置される
+		MeshSpan<MeshChunk> chunks;
+		if (isVersioned && (reinterpret_cast<const MeshHead*>(pBin)->flags & MeshFlag::Chunk))
+		{
+			if (vertexOffset + sizeof(MeshChunkTable) > size)
+			{
+				return false;
+			}
+			u32 numChunks = reinterpret_cast<const MeshChunkTable*>(pBin + vertexOffset)->numChunks;
+			vertexOffset += sizeof(MeshChunkTable);
+			chunks = MakeSpan<MeshChunk>(pBin + vertexOffset, numChunks);
+			vertexOffset += sizeof(MeshChunk) * static_cast<u64>(numChunks);
+			if (vertexOffset > size)
+			{
+				return false;
+			}
+		}
+
+		const MeshHead* pHead = reinterpret_cast<const MeshHead*>(pBin);
+		auto shapes = MakeSpan<MeshShape>(pBin + shapeOffset, pHeadV1->numShapes);
+		auto materials = MakeSpan<MeshMaterial>(pBin + materialOffset, pHeadV1->numMaterials);
+		auto submeshes = MakeSpan<MeshSubmesh>(pBin + submeshOffset, pHeadV1->numSubmeshes);
+		const u8* pVertexHead = pBin + vertexOffset;
+		u64 areaSize = size - vertexOffset;
+
+		// v1 のテーブルは最新のレイアウトに変換する
+		// 頂点・インデックスストリーム自体はそのまま参照する
+		MeshHead convHead;
+		std::vector<MeshShape> convShapes;
+		std::vector<MeshSubmesh> convSubmeshes;
+		if (isV1)
+		{
+			memcpy(&convHead, pHeadV1, sizeof(MeshHeadV1));
+			convHead.version = kMeshVersion1;
+			convHead.flags = MeshFlag::None;
+			pHead = &convHead;
+
+			const MeshShapeV1* pShapesV1 = reinterpret_cast<const MeshShapeV1*>(pBin + shapeOffset);
+			convShapes.resize(pHeadV1->numShapes);
+			for (s32 i = 0; i < pHeadV1->numShapes; ++i)
+			{
+				MeshShape& dst = convShapes[i];
+				memset(&dst, 0, sizeof(dst));
+				memcpy(&dst, &pShapesV1[i], sizeof(MeshShapeV1));
+				dst.positionFormat = MeshStreamFormat::Float3;
+				dst.normalFormat = MeshStreamFormat::Float3;
+				dst.texcoordFormat = MeshStreamFormat::Float2;
+			}
+			shapes.pData = convShapes.data();
+
+			// v1 の indexFormat はパディング領域なので上書きする
+			convSubmeshes.assign(submeshes.begin(), submeshes.end());
+			for (auto&& submesh : convSubmeshes)
+			{
+				submesh.indexFormat = MeshStreamFormat::UInt32;
+			}
+			submeshes.pData = convSubmeshes.data();
+		}
+
+		// シェイプの頂点ストリームを確認
+		for (auto&& shape : shapes)
+		{
+			if (!IsTerminated(shape.name, sizeof(shape.name)))
+			{
+				return false;
+			}
+			if (shape.positionFormat != MeshStreamFormat::Float3 && shape.positionFormat != MeshStreamFormat::UNorm16x3)
+			{
+				return false;
+			}
+			if (shape.normalFormat != MeshStreamFormat::Float3 && shape.normalFormat != MeshStreamFormat::OctSNorm16x2)
+			{
+				return false;
+			}
+			if (shape.texcoordFormat != MeshStreamFormat::Float2 && shape.texcoordFormat != MeshStreamFormat::Half2)
+			{
+				return false;
+			}
+			if (!IsValidRange(areaSize, shape.positionOffset, shape.numVertices, GetStreamStride(shape.positionFormat), GetStreamAlignment(shape.positionFormat))
+				|| !IsValidRange(areaSize, shape.normalOffset, shape.numVertices, GetStreamStride(shape.normalFormat), GetStreamAlignment(shape.normalFormat))
+				|| !IsValidRange(areaSize, shape.texcoordOffset, shape.numVertices, GetStreamStride(shape.texcoordFormat), GetStreamAlignment(shape.texcoordFormat)))
+			{
+				return false;
+			}
+		}
+
+		// マテリアル名を確認
+		for (auto&& mat : materials)
+		{
+			if (!IsTerminated(mat.name, sizeof(mat.name)))
+			{
+				return false;
+			}
+		}
+
+		// サブメッシュのインデックスストリームを確認
+		for (auto&& submesh : submeshes)
+		{
+			if (submesh.shapeIndex < 0 || submesh.shapeIndex >= pHead->numShapes)
+			{
+				return false;
+			}
+			if (submesh.materialIndex < 0 || submesh.materialIndex >= pHead->numMaterials)
+			{
+				return false;
+			}
+			if (submesh.indexFormat != MeshStreamFormat::UInt32 && submesh.indexFormat != MeshStreamFormat::UInt16)
+			{
+				return false;
+			}
+			if (!IsValidRange(areaSize, submesh.indexBufferOffset, submesh.numSubmeshIndices, GetStreamStride(submesh.indexFormat), GetStreamAlignment(submesh.indexFormat)))
+			{
+				return false;
+			}
+
+			if (checkIndexRange)
+			{
+				// 全インデックスを走査するため、マップしたファイルの全ページに触れることになる
+				u32 numVertices = shapes[submesh.shapeIndex].numVertices;
+				const u8* pIndex = pVertexHead + submesh.indexBufferOffset;
+				bool isValid = (submesh.indexFormat == MeshStreamFormat::UInt16)
+					? IsValidIndices(reinterpret_cast<const u16*>(pIndex), submesh.numSubmeshIndices, numVertices)
+					: IsValidIndices(reinterpret_cast<const u32*>(pIndex), submesh.numSubmeshIndices, numVertices);
+				if (!isValid)
+				{
+					return false;
+				}
+			}
+		}
+
+		// チャンクの範囲を確認
+		MeshletChunk meshlet;
+		MeshLodChunk lod;
+		for (auto&& chunk : chunks)
+		{
+			if ((chunk.size % 8) != 0 || !IsValidRange(areaSize, chunk.offset, chunk.size, 1, 8))
+			{
+				return false;
+			}
+			if (memcmp(chunk.fourCC, "MLET", 4) == 0)
+			{
+				if (!InitMeshletChunk(pVertexHead + chunk.offset, chunk.size, shapes, submeshes, checkIndexRange, &meshlet))
+				{
+					return false;
+				}
+			}
+			else if (memcmp(chunk.fourCC, "SLOD", 4) == 0)
+			{
+				if (!InitLodChunk(pVertexHead + chunk.offset, chunk.size, areaSize, shapes, submeshes, pVertexHead, checkIndexRange, &lod))
+				{
+					return false;
+				}
+			}
+		}
+
+		if (isV1)
+		{
+			convHead_ = convHead;
+			convShapes_.swap(convShapes);
+			convSubmeshes_.swap(convSubmeshes);
+			pHead = &convHead_;
+			shapes.pData = convShapes_.data();
+			submeshes.pData = convSubmeshes_.data();
+		}
+
+		pHead_ = pHead;
+		shapes_ = shapes;
+		materials_ = materials;
+		submeshes_ = submeshes;
+		pVertexHead_ = pVertexHead;
+		vertexAreaSize_ = areaSize;
+		chunks_ = chunks;
+		meshlet_ = meshlet;
+		lod_ = lod;
+		return true;
+	}
+
+	//---------------------------------------
+	// メッシュレットチャンクを検証する
+	//---------------------------------------
+	bool MeshView::InitMeshletChunk(const u8* pChunk, u64 chunkSize, const MeshSpan<MeshShape>& shapes, const MeshSpan<MeshSubmesh>& submeshes, bool checkIndexRange, MeshletChunk* pOut)
+	{
+		if (chunkSize < sizeof(MeshletChunkHead))
+		{
+			return false;
+		}
+		const MeshletChunkHead* pHead = reinterpret_cast<const MeshletChunkHead*>(pChunk);
+		if (pHead->numSubmeshes != submeshes.size())
+		{
+			return false;
+		}
+
+		// NOTE: 各数値は32bit以下なので64bitの積和でオーバーフローしない
+		u64 submeshOffset = sizeof(MeshletChunkHead);
+		u64 meshletOffset = submeshOffset + sizeof(MeshletSubmesh) * static_cast<u64>(pHead->numSubmeshes);
+		u64 vertexOffset = meshletOffset + sizeof(MeshMeshlet) * static_cast<u64>(pHead->numMeshlets);
+		u64 primitiveOffset = vertexOffset + sizeof(u32) * static_cast<u64>(pHead->numVertexIndices);
+		u64 endOffset = primitiveOffset + sizeof(u32) * static_cast<u64>(pHead->numPrimitives);
+		if (endOffset > chunkSize)
+		{
+			return false;
+		}
+
+		MeshletChunk ret;
+		ret.submeshes = MakeSpan<MeshletSubmesh>(pChunk + submeshOffset, pHead->numSubmeshes);
+		ret.meshlets = MakeSpan<MeshMeshlet>(pChunk + meshletOffset, pHead->numMeshlets);
+		ret.vertexIndices = MakeSpan<u32>(pChunk + vertexOffset, pHead->numVertexIndices);
+		ret.primitives = MakeSpan<u32>(pChunk + primitiveOffset, pHead->numPrimitives);
+
+		for (u64 i = 0; i < ret.submeshes.size(); ++i)
+		{
+			auto&& range = ret.submeshes[i];
+			if (range.meshletOffset > ret.meshlets.size() || range.meshletCount > ret.meshlets.size() - range.meshletOffset)
+			{
+				return false;
+			}
+
+			for (u32 m = 0; m < range.meshletCount; ++m)
+			{
+				auto&& meshlet = ret.meshlets[range.meshletOffset + m];
+				if (meshlet.vertexOffset > ret.vertexIndices.size() || meshlet.vertexCount > ret.vertexIndices.size() - meshlet.vertexOffset)
+				{
+					return false;
+				}
+				if (meshlet.primitiveOffset > ret.primitives.size() || meshlet.primitiveCount > ret.primitives.size() - meshlet.primitiveOffset)
+				{
+					return false;
+				}
+
+				if (checkIndexRange)
+				{
+					u32 numVertices = shapes[submeshes[i].shapeIndex].numVertices;
+					if (!IsValidIndices(ret.vertexIndices.begin() + meshlet.vertexOffset, meshlet.vertexCount, numVertices))
+					{
+						return false;
+					}
+					for (u32 p = 0; p < meshlet.primitiveCount; ++p)
+					{
+						u32 prim = ret.primitives[meshlet.primitiveOffset + p];
+						if ((prim & 0xff) >= meshlet.vertexCount || ((prim >> 8) & 0xff) >= meshlet.vertexCount || ((prim >> 16) & 0xff) >= meshlet.vertexCount)
+						{
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		*pOut = ret;
+		return true;
+	}
+
+	//---------------------------------------
+	// サブメッシュLODチャンクを検証する
+	//---------------------------------------
+	bool MeshView::InitLodChunk(const u8* pChunk, u64 chunkSize, u64 areaSize, const MeshSpan<MeshShape>& shapes, const MeshSpan<MeshSubmesh>& submeshes, const u8* pVertexHead, bool checkIndexRange, MeshLodChunk* pOut)
+	{
+		if (chunkSize < sizeof(MeshLodChunkHead))
+		{
+			return false;
+		}
+		const MeshLodChunkHead* pHead = reinterpret_cast<const MeshLodChunkHead*>(pChunk);
+		if (pHead->numSubmeshes != submeshes.size())
+		{
+			return false;
+		}
+
+		u64 rangeOffset = sizeof(MeshLodChunkHead);
+		u64 lodOffset = rangeOffset + sizeof(MeshSubmeshLodRange) * static_cast<u64>(pHead->numSubmeshes);
+		u64 endOffset = lodOffset + sizeof(MeshSubmeshLod) * static_cast<u64>(pHead->numLods);
+		if (endOffset > chunkSize)
+		{
+			return false;
+		}
+
+		MeshLodChunk ret;
+		ret.ranges = MakeSpan<MeshSubmeshLodRange>(pChunk + rangeOffset, pHead->numSubmeshes);
+		ret.lods = MakeSpan<MeshSubmeshLod>(pChunk + lodOffset, pHead->numLods);
+
+		for (u64 i = 0; i < ret.ranges.size(); ++i)
+		{
+			auto&& range = ret.ranges[i];
+			if (range.lodOffset > ret.lods.size() || range.lodCount > ret.lods.size() - range.lodOffset)
+			{
+				return false;
+			}
+
+			auto&& submesh = submeshes[i];
+			for (u32 l = 0; l < range.lodCount; ++l)
+			{
+				auto&& lod = ret.lods[range.lodOffset + l];
+				if (!IsValidRange(areaSize, lod.indexBufferOffset, lod.numIndices, MeshView::GetStreamStride(submesh.indexFormat), GetStreamAlignment(submesh.indexFormat)))
+				{
+					return false;
+				}
+
+				if (checkIndexRange)
+				{
+					u32 numVertices = shapes[submesh.shapeIndex].numVertices;
+					const u8* pIndex = pVertexHead + lod.indexBufferOffset;
+					bool isValid = (submesh.indexFormat == MeshStreamFormat::UInt16)
+						? IsValidIndices(reinterpret_cast<const u16*>(pIndex), lod.numIndices, numVertices)
+						: IsValidIndices(reinterpret_cast<const u32*>(pIndex), lod.numIndices, numVertices);
+					if (!isValid)
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		*pOut = ret;
+		return true;
+	}
+
+	//---------------------------------------
+	// サブメッシュのLOD数を取得する
+	//---------------------------------------
+	u32 MeshView::GetSubmeshLodCount(u32 submeshIndex) const
+	{
+		if (submeshIndex >= lod_.ranges.size())
+		{
+			return 1;
+		}
+		return lod_.ranges[submeshIndex].lodCount + 1;
+	}
+
+	//---------------------------------------
+	// サブメッシュのLOD1以降の情報を取得する
+	//---------------------------------------
+	const MeshSubmeshLod* MeshView::GetSubmeshLod(u32 submeshIndex, u32 lod) const
+	{
+		if (lod == 0 || lod >= GetSubmeshLodCount(submeshIndex))
+		{
+			return nullptr;
+		}
+		return &lod_.lods[lod_.ranges[submeshIndex].lodOffset + lod - 1];
+	}
+
+	//---------------------------------------
+	// 画面上の誤差から描画するLODを選択する
+	//---------------------------------------
+	u32 MeshView::SelectLod(u32 submeshIndex, const float* pCameraPos, float projScale, float pixelError) const
+	{
+		u32 lodCount = GetSubmeshLodCount(submeshIndex);
+		if (lodCount <= 1)
+		{
+			return 0;
+		}
+
+		// カメラからシェイプのAABBまでの距離
+		const MeshShape& shape = shapes_[submeshes_[submeshIndex].shapeIndex];
+		float dist2 = 0.0f;
+		for (int i = 0; i < 3; ++i)
+		{
+			float d = std::max(std::max(shape.aabbMin[i] - pCameraPos[i], pCameraPos[i] - shape.aabbMax[i]), 0.0f);
+			dist2 += d * d;
+		}
+		float dist = sqrtf(dist2);
+		if (dist <= 0.0f)
+		{
+			// AABB内部にいる場合は最も詳細なLODを使う
+			return 0;
+		}
+
+		// 誤差はLODが進むほど大きくなるので、許容誤差を超えた時点で止める
+		float maxError = pixelError * dist / projScale;
+		u32 ret = 0;
+		for (u32 lod = 1; lod < lodCount; ++lod)
+		{
+			if (GetSubmeshLod(submeshIndex, lod)->error > maxError)
+			{
+				break;
+			}
+			ret = lod;
+		}
+		return ret;
+	}
+
+	//---------------------------------------
+	// チャンクを検索する
+	//---------------------------------------
+	const MeshChunk* MeshView::FindChunk(const char* fourCC) const
+	{
+		for (auto&& chunk : chunks_)
+		{
+			if (memcmp(chunk.fourCC, fourCC, 4) == 0)
+			{
+				return &chunk;
+			}
+		}
+		return nullptr;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void MeshView::Destroy()
+	{
+		pHead_ = nullptr;
+		shapes_ = MeshSpan<MeshShape>();
+		materials_ = MeshSpan<MeshMaterial>();
+		submeshes_ = MeshSpan<MeshSubmesh>();
+		pVertexHead_ = nullptr;
+		vertexAreaSize_ = 0;
+		chunks_ = MeshSpan<MeshChunk>();
+		meshlet_ = MeshletChunk();
+		lod_ = MeshLodChunk();
+		convShapes_.clear();
+		convSubmeshes_.clear();
+	}
+
+	//---------------------------------------
+	// フォーマットの1要素あたりのサイズを取得する
+	//---------------------------------------
+	u32 MeshView::GetStreamStride(u32 format)
+	{
+		switch (format)
+		{
+		case MeshStreamFormat::Float3:			return sizeof(float) * 3;
+		case MeshStreamFormat::Float2:			return sizeof(float) * 2;
+		case MeshStreamFormat::UNorm16x3:		return sizeof(u16) * 3;
+		case MeshStreamFormat::OctSNorm16x2:	return sizeof(s16) * 2;
+		case MeshStreamFormat::Half2:			return sizeof(u16) * 2;
+		case MeshStreamFormat::UInt32:			return sizeof(u32);
+		case MeshStreamFormat::UInt16:			return sizeof(u16);
+		default:								return 0;
+		}
+	}
+
+	//---------------------------------------
+	// 座標ストリームを取得する
+	//---------------------------------------
+	MeshSpan<float> MeshView::GetPositions(u32 shapeIndex) const
+	{
+		if (shapeIndex >= shapes_.size())
+		{
+			return MeshSpan<float>();
+		}
+		auto&& shape = shapes_[shapeIndex];
+		if (shape.positionFormat != MeshStreamFormat::Float3)
+		{
+			return MeshSpan<float>();
+		}
+		return MakeSpan<float>(pVertexHead_ + shape.positionOffset, static_cast<u64>(shape.numVertices) * 3);
+	}
+
+	//---------------------------------------
+	// 法線ストリームを取得する
+	//---------------------------------------
+	MeshSpan<float> MeshView::GetNormals(u32 shapeIndex) const
+	{
+		if (shapeIndex >= shapes_.size())
+		{
+			return MeshSpan<float>();
+		}
+		auto&& shape = shapes_[shapeIndex];
+		if (shape.normalFormat != MeshStreamFormat::Float3)
+		{
+			return MeshSpan<float>();
+		}
+		return MakeSpan<float>(pVertexHead_ + shape.normalOffset, static_cast<u64>(shape.numVertices) * 3);
+	}
+
+	//---------------------------------------
+	// テクスチャ座標ストリームを取得する
+	//---------------------------------------
+	MeshSpan<float> MeshView::GetTexcoords(u32 shapeIndex) const
+	{
+		if (shapeIndex >= shapes_.size())
+		{
+			return MeshSpan<float>();
+		}
+		auto&& shape = shapes_[shapeIndex];
+		if (shape.texcoordFormat != MeshStreamFormat::Float2)
+		{
+			return MeshSpan<float>();
+		}
+		return MakeSpan<float>(pVertexHead_ + shape.texcoordOffset, static_cast<u64>(shape.numVertices) * 2);
+	}
+
+	//---------------------------------------
+	// インデックスストリームを取得する
+	//---------------------------------------
+	MeshSpan<u32> MeshView::GetIndices(u32 submeshIndex) const
+	{
+		if (submeshIndex >= submeshes_.size())
+		{
+			return MeshSpan<u32>();
+		}
+		auto&& submesh = submeshes_[submeshIndex];
+		if (submesh.indexFormat != MeshStreamFormat::UInt32)
+		{
+			return MeshSpan<u32>();
+		}
+		return MakeSpan<u32>(pVertexHead_ + submesh.indexBufferOffset, submesh.numSubmeshIndices);
+	}
+
+	//---------------------------------------
+	// ストリームの先頭アドレスを取得する
+	//---------------------------------------
+	const void* MeshView::GetPositionData(u32 shapeIndex) const
+	{
+		return (shapeIndex < shapes_.size()) ? pVertexHead_ + shapes_[shapeIndex].positionOffset : nullptr;
+	}
+	const void* MeshView::GetNormalData(u32 shapeIndex) const
+	{
+		return (shapeIndex < shapes_.size()) ? pVertexHead_ + shapes_[shapeIndex].normalOffset : nullptr;
+	}
+	const void* MeshView::GetTexcoordData(u32 shapeIndex) const
+	{
+		return (shapeIndex < shapes_.size()) ? pVertexHead_ + shapes_[shapeIndex].texcoordOffset : nullptr;
+	}
+	const void* MeshView::GetIndexData(u32 submeshIndex) const
+	{
+		return (submeshIndex < submeshes_.size()) ? pVertexHead_ + submeshes_[submeshIndex].indexBufferOffset : nullptr;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
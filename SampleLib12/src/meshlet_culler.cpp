@@ -0,0 +1,209 @@
+﻿#include <sl12/meshlet_culler.h>
+
+
+namespace sl12
+{
+	//---------------------------------------
+	// メッシュレットのバウンディング情報を取り込む
+	//---------------------------------------
+	bool MeshletCuller::Initialize(const MeshSpan<MeshMeshlet>& meshlets)
+	{
+		Destroy();
+
+		numMeshlets_ = static_cast<u32>(meshlets.size());
+		blocks_.resize((numMeshlets_ + 3) / 4);
+
+		for (size_t b = 0; b < blocks_.size(); ++b)
+		{
+			float values[kElementMax][4];
+			for (u32 lane = 0; lane < 4; ++lane)
+			{
+				u64 index = b * 4 + lane;
+				if (index < numMeshlets_)
+				{
+					auto&& m = meshlets[index];
+					values[kCenterX][lane] = m.center[0];
+					values[kCenterY][lane] = m.center[1];
+					values[kCenterZ][lane] = m.center[2];
+					values[kRadius][lane] = m.radius;
+					values[kAxisX][lane] = m.coneAxis[0];
+					values[kAxisY][lane] = m.coneAxis[1];
+					values[kAxisZ][lane] = m.coneAxis[2];
+					values[kCutoff][lane] = m.coneCutoff;
+					values[kApexX][lane] = m.coneApex[0];
+					values[kApexY][lane] = m.coneApex[1];
+					values[kApexZ][lane] = m.coneApex[2];
+				}
+				else
+				{
+					// 端数のレーンは結果を使わないが、NaNを避けるため値を入れておく
+					for (int e = 0; e < kElementMax; ++e)
+					{
+						values[e][lane] = 0.0f;
+					}
+					values[kCutoff][lane] = 2.0f;
+				}
+			}
+
+			for (int e = 0; e < kElementMax; ++e)
+			{
+				blocks_[b].elements[e] = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(values[e]));
+			}
+		}
+
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void MeshletCuller::Destroy()
+	{
+		blocks_.clear();
+		numMeshlets_ = 0;
+	}
+
+	//---------------------------------------
+	// カリングを行う
+	//---------------------------------------
+	u32 MeshletCuller::Cull(const DirectX::XMFLOAT4* pPlanes, u32 numPlanes, const DirectX::XMFLOAT3& cameraPos, u32 first, u32 count, std::vector<u32>& outVisible) const
+	{
+		using namespace DirectX;
+
+		assert(numPlanes <= kMaxPlanes);
+		assert(first + count <= numMeshlets_);
+
+		// 平面とカメラ位置は各要素を4レーンに複製しておく
+		XMVECTOR planes[kMaxPlanes][4];
+		for (u32 p = 0; p < numPlanes; ++p)
+		{
+			planes[p][0] = XMVectorReplicate(pPlanes[p].x);
+			planes[p][1] = XMVectorReplicate(pPlanes[p].y);
+			planes[p][2] = XMVectorReplicate(pPlanes[p].z);
+			planes[p][3] = XMVectorReplicate(pPlanes[p].w);
+		}
+		XMVECTOR camX = XMVectorReplicate(cameraPos.x);
+		XMVECTOR camY = XMVectorReplicate(cameraPos.y);
+		XMVECTOR camZ = XMVectorReplicate(cameraPos.z);
+
+		u32 end = first + count;
+		u32 numVisible = 0;
+		for (u32 b = first / 4; b * 4 < end; ++b)
+		{
+			const XMVECTOR* e = blocks_[b].elements;
+
+			// 視錐台: いずれかの平面の外側に球が完全に出ていれば不可視
+			XMVECTOR negRadius = XMVectorNegate(e[kRadius]);
+			XMVECTOR culled = XMVectorFalseInt();
+			for (u32 p = 0; p < numPlanes; ++p)
+			{
+				XMVECTOR d = XMVectorMultiplyAdd(planes[p][0], e[kCenterX], planes[p][3]);
+				d = XMVectorMultiplyAdd(planes[p][1], e[kCenterY], d);
+				d = XMVectorMultiplyAdd(planes[p][2], e[kCenterZ], d);
+				culled = XMVectorOrInt(culled, XMVectorLess(d, negRadius));
+			}
+
+			// コーン: dot(apex - cam, axis) >= cutoff * |apex - cam| なら裏向き
+			// cutoff >= 1 はコーンが無効. カメラが頂点に一致すると 0 >= 0 で裏向きと判定されるので除外する
+			XMVECTOR vx = XMVectorSubtract(e[kApexX], camX);
+			XMVECTOR vy = XMVectorSubtract(e[kApexY], camY);
+			XMVECTOR vz = XMVectorSubtract(e[kApexZ], camZ);
+			XMVECTOR len = XMVectorSqrt(XMVectorMultiplyAdd(vx, vx, XMVectorMultiplyAdd(vy, vy, XMVectorMultiply(vz, vz))));
+			XMVECTOR dp = XMVectorMultiplyAdd(vx, e[kAxisX], XMVectorMultiplyAdd(vy, e[kAxisY], XMVectorMultiply(vz, e[kAxisZ])));
+			XMVECTOR backface = XMVectorGreaterOrEqual(dp, XMVectorMultiply(e[kCutoff], len));
+			XMVECTOR coneEnabled = XMVectorLess(e[kCutoff], XMVectorSplatOne());
+			culled = XMVectorOrInt(culled, XMVectorAndInt(backface, coneEnabled));
+
+			XMUINT4 mask;
+			XMStoreUInt4(&mask, culled);
+			const u32 lanes[4] = { mask.x, mask.y, mask.z, mask.w };
+			for (u32 lane = 0; lane < 4; ++lane)
+			{
+				u32 index = b * 4 + lane;
+				if (index >= first && index < end && !lanes[lane])
+				{
+					outVisible.push_back(index);
+					++numVisible;
+				}
+			}
+		}
+
+		return numVisible;
+	}
+
+	//---------------------------------------
+	// カリングのスカラー版リファレンス
+	//---------------------------------------
+	u32 MeshletCuller::CullReference(const DirectX::XMFLOAT4* pPlanes, u32 numPlanes, const DirectX::XMFLOAT3& cameraPos, u32 first, u32 count, std::vector<u32>& outVisible) const
+	{
+		assert(numPlanes <= kMaxPlanes);
+		assert(first + count <= numMeshlets_);
+
+		u32 numVisible = 0;
+		for (u32 index = first; index < first + count; ++index)
+		{
+			float v[kElementMax];
+			for (int e = 0; e < kElementMax; ++e)
+			{
+				v[e] = DirectX::XMVectorGetByIndex(blocks_[index / 4].elements[e], index % 4);
+			}
+
+			bool culled = false;
+			for (u32 p = 0; p < numPlanes; ++p)
+			{
+				float d = pPlanes[p].x * v[kCenterX] + pPlanes[p].w;
+				d = pPlanes[p].y * v[kCenterY] + d;
+				d = pPlanes[p].z * v[kCenterZ] + d;
+				culled |= d < -v[kRadius];
+			}
+
+			float vx = v[kApexX] - cameraPos.x;
+			float vy = v[kApexY] - cameraPos.y;
+			float vz = v[kApexZ] - cameraPos.z;
+			float len = sqrtf(vx * vx + (vy * vy + vz * vz));
+			float dp = vx * v[kAxisX] + (vy * v[kAxisY] + vz * v[kAxisZ]);
+			culled |= (v[kCutoff] < 1.0f) && (dp >= v[kCutoff] * len);
+
+			if (!culled)
+			{
+				outVisible.push_back(index);
+				++numVisible;
+			}
+		}
+
+		return numVisible;
+	}
+
+	//---------------------------------------
+	// ビュープロジェクション行列から視錐台の6平面を取り出す
+	//---------------------------------------
+	void MeshletCuller::ExtractFrustumPlanes(const DirectX::XMFLOAT4X4& m, DirectX::XMFLOAT4* pOutPlanes)
+	{
+		using namespace DirectX;
+
+		// 行ベクトル形式 (p * M) の行列から Gribb-Hartmann の方法で取り出す
+		// D3D のクリップ空間は 0 <= z <= w
+		XMVECTOR col[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			col[i] = XMVectorSet(m.m[0][i], m.m[1][i], m.m[2][i], m.m[3][i]);
+		}
+
+		XMVECTOR planes[6] = {
+			XMVectorAdd(col[3], col[0]),		// left
+			XMVectorSubtract(col[3], col[0]),	// right
+			XMVectorAdd(col[3], col[1]),		// bottom
+			XMVectorSubtract(col[3], col[1]),	// top
+			col[2],								// near
+			XMVectorSubtract(col[3], col[2]),	// far
+		};
+		for (int i = 0; i < 6; ++i)
+		{
+			XMStoreFloat4(&pOutPlanes[i], XMPlaneNormalize(planes[i]));
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,131 @@
+﻿#include <sl12/parallel.h>
+
+#include <algorithm>
+
+
+namespace sl12
+{
+	//---------------------------------------
+	// 共有のワーカーを取得する
+	//---------------------------------------
+	WorkerPool& WorkerPool::Get()
+	{
+		static WorkerPool s_pool;
+		return s_pool;
+	}
+
+	//---------------------------------------
+	// ワーカーを作成する
+	//---------------------------------------
+	WorkerPool::WorkerPool()
+		: next_(0)
+	{
+		u32 count = std::max(std::thread::hardware_concurrency(), 1u) - 1;
+		for (u32 i = 0; i < count; ++i)
+		{
+			threads_.emplace_back([this]() { WorkerMain(); });
+		}
+	}
+
+	//---------------------------------------
+	// ワーカーを終了する
+	//---------------------------------------
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			isShutdown_ = true;
+		}
+		wakeCv_.notify_all();
+		for (auto&& t : threads_)
+		{
+			t.join();
+		}
+	}
+
+	//---------------------------------------
+	// ジョブを取り出して実行する
+	//---------------------------------------
+	void WorkerPool::Work()
+	{
+		while (true)
+		{
+			u32 i = next_.fetch_add(1);
+			if (i >= count_)
+			{
+				break;
+			}
+			func_(pContext_, i);
+		}
+	}
+
+	//---------------------------------------
+	// ワーカーのメインループ
+	//---------------------------------------
+	void WorkerPool::WorkerMain()
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		u64 seenGeneration = generation_;
+		while (true)
+		{
+			wakeCv_.wait(lock, [&]() { return isShutdown_ || ((generation_ != seenGeneration) && (helperSlots_ > 0)); });
+			if (isShutdown_)
+			{
+				return;
+			}
+
+			seenGeneration = generation_;
+			helperSlots_--;
+			activeHelpers_++;
+
+			lock.unlock();
+			Work();
+			lock.lock();
+
+			if (--activeHelpers_ == 0)
+			{
+				doneCv_.notify_all();
+			}
+		}
+	}
+
+	//---------------------------------------
+	// ジョブを並列に実行する
+	//---------------------------------------
+	void WorkerPool::Run(u32 count, u32 numThreads, JobFunc func, void* pContext)
+	{
+		// 他の実行中や、ジョブの中から呼ばれた場合は呼び出し元で実行する
+		std::unique_lock<std::mutex> runLock(runMutex_, std::try_to_lock);
+		if (!runLock.owns_lock() || threads_.empty())
+		{
+			for (u32 i = 0; i < count; ++i)
+			{
+				func(pContext, i);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			func_ = func;
+			pContext_ = pContext;
+			count_ = count;
+			next_.store(0);
+			helperSlots_ = std::min(numThreads, count) - 1;
+			helperSlots_ = std::min(helperSlots_, static_cast<u32>(threads_.size()));
+			generation_++;
+		}
+		wakeCv_.notify_all();
+
+		Work();
+
+		// 参加していないワーカーはもう参加させず、参加中のワーカーの完了を待つ
+		std::unique_lock<std::mutex> lock(mutex_);
+		helperSlots_ = 0;
+		doneCv_.wait(lock, [&]() { return activeHelpers_ == 0; });
+	}
+
+}	// namespace sl12
+
+
+//	EOF
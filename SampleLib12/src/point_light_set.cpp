@@ -0,0 +1,225 @@
+﻿#include <sl12/point_light_set.h>
+
+#include <cassert>
+
+
+namespace sl12
+{
+	namespace
+	{
+		// 4ライト分の要素を転置して、範囲内のライトのみ書き出す
+		void StoreBlock(DirectX::FXMVECTOR v0, DirectX::FXMVECTOR v1, DirectX::FXMVECTOR v2, DirectX::GXMVECTOR v3, u32 base, u32 first, u32 end, DirectX::XMFLOAT4* pOut)
+		{
+			DirectX::XMMATRIX t = DirectX::XMMatrixTranspose(DirectX::XMMATRIX(v0, v1, v2, v3));
+			if (base >= first && base + 4 <= end)
+			{
+				DirectX::XMFLOAT4* p = pOut + (base - first);
+				DirectX::XMStoreFloat4(p + 0, t.r[0]);
+				DirectX::XMStoreFloat4(p + 1, t.r[1]);
+				DirectX::XMStoreFloat4(p + 2, t.r[2]);
+				DirectX::XMStoreFloat4(p + 3, t.r[3]);
+				return;
+			}
+			for (u32 lane = 0; lane < 4; ++lane)
+			{
+				u32 index = base + lane;
+				if (index >= first && index < end)
+				{
+					DirectX::XMStoreFloat4(&pOut[index - first], t.r[lane]);
+				}
+			}
+		}
+	}
+
+	//---------------------------------------
+	// ライト数を指定して初期化する
+	//---------------------------------------
+	bool PointLightSet::Initialize(u32 count)
+	{
+		Destroy();
+
+		numLights_ = count;
+		posBlocks_.resize((numLights_ + 3) / 4);
+		colorBlocks_.resize(posBlocks_.size());
+		for (auto&& block : posBlocks_)
+		{
+			for (auto&& e : block.elements)
+			{
+				e = DirectX::XMVectorZero();
+			}
+		}
+		for (auto&& block : colorBlocks_)
+		{
+			for (auto&& e : block.elements)
+			{
+				e = DirectX::XMVectorZero();
+			}
+		}
+
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void PointLightSet::Destroy()
+	{
+		posBlocks_.clear();
+		colorBlocks_.clear();
+		numLights_ = 0;
+	}
+
+	//---------------------------------------
+	// ライトを設定する
+	//---------------------------------------
+	void PointLightSet::SetLight(u32 index, const DirectX::XMFLOAT3& pos, float radius, const DirectX::XMFLOAT3& color)
+	{
+		assert(index < numLights_);
+
+		auto e = posBlocks_[index / 4].elements;
+		auto c = colorBlocks_[index / 4].elements;
+		u32 lane = index % 4;
+		e[kPosX] = DirectX::XMVectorSetByIndex(e[kPosX], pos.x, lane);
+		e[kPosY] = DirectX::XMVectorSetByIndex(e[kPosY], pos.y, lane);
+		e[kPosZ] = DirectX::XMVectorSetByIndex(e[kPosZ], pos.z, lane);
+		e[kRadius] = DirectX::XMVectorSetByIndex(e[kRadius], radius, lane);
+		c[kColorR] = DirectX::XMVectorSetByIndex(c[kColorR], color.x, lane);
+		c[kColorG] = DirectX::XMVectorSetByIndex(c[kColorG], color.y, lane);
+		c[kColorB] = DirectX::XMVectorSetByIndex(c[kColorB], color.z, lane);
+	}
+
+	//---------------------------------------
+	// ライトの座標と半径を取得する
+	//---------------------------------------
+	DirectX::XMFLOAT4 PointLightSet::GetPosAndRadius(u32 index) const
+	{
+		assert(index < numLights_);
+
+		auto e = posBlocks_[index / 4].elements;
+		u32 lane = index % 4;
+		return DirectX::XMFLOAT4(
+			DirectX::XMVectorGetByIndex(e[kPosX], lane),
+			DirectX::XMVectorGetByIndex(e[kPosY], lane),
+			DirectX::XMVectorGetByIndex(e[kPosZ], lane),
+			DirectX::XMVectorGetByIndex(e[kRadius], lane));
+	}
+
+	//---------------------------------------
+	// ライトの座標を変換し、座標と半径を書き出す
+	//---------------------------------------
+	void PointLightSet::Transform(const DirectX::XMMATRIX& mtx, u32 first, u32 count, DirectX::XMFLOAT4* pOutPosAndRadius)
+	{
+		using namespace DirectX;
+
+		assert(first + count <= numLights_);
+
+		// 行列の各要素は4レーンに複製しておく
+		XMVECTOR m[4][3];
+		for (int r = 0; r < 4; ++r)
+		{
+			m[r][0] = XMVectorSplatX(mtx.r[r]);
+			m[r][1] = XMVectorSplatY(mtx.r[r]);
+			m[r][2] = XMVectorSplatZ(mtx.r[r]);
+		}
+
+		u32 end = first + count;
+		for (u32 b = first / 4; b * 4 < end; ++b)
+		{
+			XMVECTOR* e = posBlocks_[b].elements;
+			u32 base = b * 4;
+
+			// NOTE: XMVector3TransformCoord と同じ順序で積和を行い、結果を一致させる
+			//       アフィン変換なら w は必ず1になるので除算は不要
+			XMVECTOR x = XMVectorMultiplyAdd(e[kPosZ], m[2][0], m[3][0]);
+			XMVECTOR y = XMVectorMultiplyAdd(e[kPosZ], m[2][1], m[3][1]);
+			XMVECTOR z = XMVectorMultiplyAdd(e[kPosZ], m[2][2], m[3][2]);
+			x = XMVectorMultiplyAdd(e[kPosY], m[1][0], x);
+			y = XMVectorMultiplyAdd(e[kPosY], m[1][1], y);
+			z = XMVectorMultiplyAdd(e[kPosY], m[1][2], z);
+			x = XMVectorMultiplyAdd(e[kPosX], m[0][0], x);
+			y = XMVectorMultiplyAdd(e[kPosX], m[0][1], y);
+			z = XMVectorMultiplyAdd(e[kPosX], m[0][2], z);
+
+			// 範囲外のレーンは変換前の値を残す
+			if (base < first || base + 4 > end)
+			{
+				XMVECTOR sel = XMVectorSelectControl(
+					(base + 0 >= first && base + 0 < end) ? 1 : 0,
+					(base + 1 >= first && base + 1 < end) ? 1 : 0,
+					(base + 2 >= first && base + 2 < end) ? 1 : 0,
+					(base + 3 >= first && base + 3 < end) ? 1 : 0);
+				x = XMVectorSelect(e[kPosX], x, sel);
+				y = XMVectorSelect(e[kPosY], y, sel);
+				z = XMVectorSelect(e[kPosZ], z, sel);
+			}
+			e[kPosX] = x;
+			e[kPosY] = y;
+			e[kPosZ] = z;
+
+			if (pOutPosAndRadius)
+			{
+				StoreBlock(x, y, z, e[kRadius], base, first, end, pOutPosAndRadius);
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 座標変換のスカラー版リファレンス
+	//---------------------------------------
+	void PointLightSet::TransformReference(const DirectX::XMMATRIX& mtx, u32 first, u32 count, DirectX::XMFLOAT4* pOutPosAndRadius)
+	{
+		assert(first + count <= numLights_);
+
+		for (u32 index = first; index < first + count; ++index)
+		{
+			DirectX::XMFLOAT4 pr = GetPosAndRadius(index);
+			DirectX::XMVECTOR p = DirectX::XMVectorSet(pr.x, pr.y, pr.z, 1.0f);
+			p = DirectX::XMVector3TransformCoord(p, mtx);
+
+			auto e = posBlocks_[index / 4].elements;
+			u32 lane = index % 4;
+			e[kPosX] = DirectX::XMVectorSetByIndex(e[kPosX], DirectX::XMVectorGetX(p), lane);
+			e[kPosY] = DirectX::XMVectorSetByIndex(e[kPosY], DirectX::XMVectorGetY(p), lane);
+			e[kPosZ] = DirectX::XMVectorSetByIndex(e[kPosZ], DirectX::XMVectorGetZ(p), lane);
+
+			if (pOutPosAndRadius)
+			{
+				pOutPosAndRadius[index - first] = GetPosAndRadius(index);
+			}
+		}
+	}
+
+	//---------------------------------------
+	// ライトの座標と半径を書き出す
+	//---------------------------------------
+	void PointLightSet::WritePosAndRadius(u32 first, u32 count, DirectX::XMFLOAT4* pOut) const
+	{
+		assert(first + count <= numLights_);
+
+		u32 end = first + count;
+		for (u32 b = first / 4; b * 4 < end; ++b)
+		{
+			const DirectX::XMVECTOR* e = posBlocks_[b].elements;
+			StoreBlock(e[kPosX], e[kPosY], e[kPosZ], e[kRadius], b * 4, first, end, pOut);
+		}
+	}
+
+	//---------------------------------------
+	// ライトのカラーを書き出す
+	//---------------------------------------
+	void PointLightSet::WriteColor(u32 first, u32 count, DirectX::XMFLOAT4* pOut) const
+	{
+		assert(first + count <= numLights_);
+
+		u32 end = first + count;
+		for (u32 b = first / 4; b * 4 < end; ++b)
+		{
+			const DirectX::XMVECTOR* e = colorBlocks_[b].elements;
+			StoreBlock(e[kColorR], e[kColorG], e[kColorB], DirectX::XMVectorSplatOne(), b * 4, first, end, pOut);
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,538 @@
+﻿#include <sl12/profiler.h>
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+
+namespace sl12
+{
+	namespace
+	{
+		static const u32 kInvalidIndex = 0xffffffff;
+
+		// CpuProfiler の初期化ごとに割り振る番号
+		std::atomic<u32>	s_cpuProfilerId(0);
+
+		// スレッドが確保したバッファ. (プロファイラの番号, バッファ)
+		thread_local std::vector<std::pair<u32, void*>>	t_threadBuffers;
+
+		// JSON の文字列としてエスケープする
+		void AppendJsonString(std::string& out, const std::string& str)
+		{
+			out += '"';
+			for (char c : str)
+			{
+				switch (c)
+				{
+				case '"':	out += "\\\""; break;
+				case '\\':	out += "\\\\"; break;
+				case '\n':	out += "\\n"; break;
+				case '\r':	out += "\\r"; break;
+				case '\t':	out += "\\t"; break;
+				default:
+					if ((unsigned char)c < 0x20)
+					{
+						char buf[8];
+						snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+						out += buf;
+					}
+					else
+					{
+						out += c;
+					}
+					break;
+				}
+			}
+			out += '"';
+		}
+	}
+
+
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool ProfileStats::Initialize(u32 historyCount)
+	{
+		Destroy();
+
+		if (historyCount == 0)
+		{
+			return false;
+		}
+		historyCount_ = historyCount;
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void ProfileStats::Destroy()
+	{
+		historyCount_ = 0;
+		frameCount_ = 0;
+		entries_.clear();
+		histories_.clear();
+		entryMap_.clear();
+	}
+
+	//---------------------------------------
+	// 項目を検索し、なければ追加する
+	//---------------------------------------
+	u32 ProfileStats::FindOrAddEntry(const std::string& path, const std::string& parentPath, const ProfileEvent& e)
+	{
+		auto it = entryMap_.find(path);
+		if (it != entryMap_.end())
+		{
+			return it->second;
+		}
+
+		// 親の子孫の末尾に挿入する. 親が見つからない場合は最後に追加する
+		size_t pos = entries_.size();
+		auto parent = parentPath.empty() ? entryMap_.end() : entryMap_.find(parentPath);
+		if (parent != entryMap_.end())
+		{
+			std::string prefix = parentPath + "/";
+			pos = parent->second + 1;
+			while (pos < entries_.size() && entries_[pos].path.compare(0, prefix.size(), prefix) == 0)
+			{
+				pos++;
+			}
+		}
+
+		Entry entry;
+		entry.path = path;
+		entry.name = e.name ? e.name : "";
+		entry.depth = e.depth;
+		entry.track = e.track;
+		entries_.insert(entries_.begin() + pos, entry);
+		histories_.insert(histories_.begin() + pos, History());
+
+		// 挿入位置以降の番号がずれるので作り直す
+		for (size_t i = pos; i < entries_.size(); ++i)
+		{
+			entryMap_[entries_[i].path] = (u32)i;
+		}
+		return (u32)pos;
+	}
+
+	//---------------------------------------
+	// 1フレーム分の区間を追加する
+	//---------------------------------------
+	void ProfileStats::AddFrame(const ProfileEvent* events, size_t count, u64 ticksPerSecond)
+	{
+		if (historyCount_ == 0 || ticksPerSecond == 0)
+		{
+			return;
+		}
+
+		struct FrameItem
+		{
+			std::string		path;
+			std::string		parentPath;
+			size_t			event;
+			double			ms;
+		};	// struct FrameItem
+
+		// 区間ごとの項目名を求め、同じ項目の時間を合計する
+		std::vector<FrameItem> items;
+		std::unordered_map<std::string, size_t> itemMap;
+		std::unordered_map<u32, std::vector<std::string>> stacks;	// トラックごとの親の項目名
+		const double toMs = 1000.0 / (double)ticksPerSecond;
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto&& e = events[i];
+			auto&& stack = stacks[e.track];
+			stack.resize(e.depth);
+
+			std::string parentPath = (e.depth == 0) ? std::string() : stack[e.depth - 1];
+			std::string path = ((e.depth == 0) ? std::to_string(e.track) : parentPath) + "/" + (e.name ? e.name : "");
+			stack.push_back(path);
+
+			double ms = (e.end > e.begin) ? (double)(e.end - e.begin) * toMs : 0.0;
+			auto it = itemMap.find(path);
+			if (it != itemMap.end())
+			{
+				items[it->second].ms += ms;
+			}
+			else
+			{
+				itemMap[path] = items.size();
+				items.push_back({ path, parentPath, i, ms });
+			}
+		}
+
+		// 親は子より先に現れるので、この順に追加すれば親の直後に子が並ぶ
+		for (auto&& item : items)
+		{
+			FindOrAddEntry(item.path, item.parentPath, events[item.event]);
+		}
+
+		for (auto&& item : items)
+		{
+			u32 index = entryMap_[item.path];
+			auto&& entry = entries_[index];
+			auto&& history = histories_[index];
+
+			float ms = (float)item.ms;
+			if (history.samples.size() < historyCount_)
+			{
+				history.samples.push_back(ms);
+			}
+			else
+			{
+				history.samples[history.next] = ms;
+			}
+			history.next = (history.next + 1) % historyCount_;
+
+			float minMs = history.samples[0];
+			float maxMs = history.samples[0];
+			double sum = 0.0;
+			for (float v : history.samples)
+			{
+				minMs = std::min(minMs, v);
+				maxMs = std::max(maxMs, v);
+				sum += v;
+			}
+			entry.lastMs = ms;
+			entry.minMs = minMs;
+			entry.maxMs = maxMs;
+			entry.avgMs = (float)(sum / (double)history.samples.size());
+			entry.sampleCount = (u32)history.samples.size();
+		}
+
+		frameCount_++;
+	}
+
+
+	//---------------------------------------
+	// 初期化する
+	//---------------------------------------
+	bool CpuProfiler::Initialize(u32 maxThreads, u32 maxEventsPerThread)
+	{
+		Destroy();
+
+		if (maxThreads == 0 || maxEventsPerThread == 0)
+		{
+			return false;
+		}
+
+		// 前回の初期化でスレッドが確保したバッファを使わないように、番号を変える
+		id_ = ++s_cpuProfilerId;
+		maxThreads_ = maxThreads;
+		maxEvents_ = maxEventsPerThread;
+		buffers_.reset(new ThreadBuffer[maxThreads]);
+		for (u32 i = 0; i < maxThreads; ++i)
+		{
+			buffers_[i].events.reset(new ProfileEvent[maxEventsPerThread]);
+		}
+		threadCount_ = 0;
+
+		return true;
+	}
+
+	//---------------------------------------
+	// 破棄する
+	//---------------------------------------
+	void CpuProfiler::Destroy()
+	{
+		buffers_.reset();
+		maxThreads_ = maxEvents_ = 0;
+		threadCount_ = 0;
+		id_ = 0;
+	}
+
+	//---------------------------------------
+	// 呼び出したスレッドのバッファを取得する
+	//---------------------------------------
+	CpuProfiler::ThreadBuffer* CpuProfiler::GetThreadBuffer()
+	{
+		for (auto&& v : t_threadBuffers)
+		{
+			if (v.first == id_)
+			{
+				return static_cast<ThreadBuffer*>(v.second);
+			}
+		}
+
+		// 初めて計測するスレッドはバッファを1つ確保する
+		// 上限を超えた場合もキャッシュしておき、以降は計測しない
+		u32 index = threadCount_.fetch_add(1);
+		ThreadBuffer* p = (index < maxThreads_) ? &buffers_[index] : nullptr;
+		t_threadBuffers.push_back(std::make_pair(id_, static_cast<void*>(p)));
+		return p;
+	}
+
+	//---------------------------------------
+	// 区間を開始する
+	//---------------------------------------
+	void CpuProfiler::BeginScope(const char* name)
+	{
+		if (!buffers_)
+		{
+			return;
+		}
+		ThreadBuffer* p = GetThreadBuffer();
+		if (!p)
+		{
+			return;
+		}
+
+		u32 index = kInvalidIndex;
+		if (p->count < maxEvents_ && p->depth < kMaxDepth)
+		{
+			index = p->count++;
+			auto&& e = p->events[index];
+			e.name = name;
+			e.depth = p->depth;
+			e.track = (u32)(p - buffers_.get());
+			e.end = 0;
+			e.begin = GetTicks();
+		}
+		else
+		{
+			p->dropped++;
+		}
+
+		if (p->depth < kMaxDepth)
+		{
+			p->stack[p->depth] = index;
+		}
+		p->depth++;
+	}
+
+	//---------------------------------------
+	// 区間を終了する
+	//---------------------------------------
+	void CpuProfiler::EndScope()
+	{
+		u64 ticks = GetTicks();
+
+		if (!buffers_)
+		{
+			return;
+		}
+		ThreadBuffer* p = GetThreadBuffer();
+		if (!p || p->depth == 0)
+		{
+			return;
+		}
+
+		p->depth--;
+		if (p->depth < kMaxDepth && p->stack[p->depth] != kInvalidIndex)
+		{
+			p->events[p->stack[p->depth]].end = ticks;
+		}
+	}
+
+	//---------------------------------------
+	// 呼び出したスレッドのトラック名を設定する
+	//---------------------------------------
+	void CpuProfiler::SetThreadName(const char* name)
+	{
+		if (!buffers_)
+		{
+			return;
+		}
+		ThreadBuffer* p = GetThreadBuffer();
+		if (p)
+		{
+			p->name = name;
+		}
+	}
+
+	//---------------------------------------
+	// 記録した区間を取り出し、バッファを空にする
+	//---------------------------------------
+	u32 CpuProfiler::CollectEvents(std::vector<ProfileEvent>& outEvents)
+	{
+		u32 dropped = 0;
+		u32 trackCount = GetTrackCount();
+		for (u32 t = 0; t < trackCount; ++t)
+		{
+			auto&& buffer = buffers_[t];
+			for (u32 i = 0; i < buffer.count; ++i)
+			{
+				// NOTE: 閉じていない区間は、終了時に書き込まないよう下で無効にする
+				if (buffer.events[i].end != 0)
+				{
+					outEvents.push_back(buffer.events[i]);
+				}
+				else
+				{
+					dropped++;
+				}
+			}
+			dropped += buffer.dropped;
+
+			buffer.count = 0;
+			buffer.dropped = 0;
+			u32 openCount = (buffer.depth < kMaxDepth) ? buffer.depth : kMaxDepth;
+			for (u32 d = 0; d < openCount; ++d)
+			{
+				buffer.stack[d] = kInvalidIndex;
+			}
+		}
+		return dropped;
+	}
+
+	//---------------------------------------
+	// 現在の時刻を取得する
+	//---------------------------------------
+	u64 CpuProfiler::GetTicks()
+	{
+		auto t = std::chrono::steady_clock::now().time_since_epoch();
+		return (u64)std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+	}
+
+	//---------------------------------------
+	// 1秒あたりのティック数を取得する
+	//---------------------------------------
+	u64 CpuProfiler::GetTicksPerSecond()
+	{
+		return 1000000000ull;
+	}
+
+	//---------------------------------------
+	// トラック数を取得する
+	//---------------------------------------
+	u32 CpuProfiler::GetTrackCount() const
+	{
+		return buffers_ ? std::min(threadCount_.load(), maxThreads_) : 0;
+	}
+
+	//---------------------------------------
+	// トラック名を取得する
+	//---------------------------------------
+	const char* CpuProfiler::GetTrackName(u32 track) const
+	{
+		assert(track < GetTrackCount());
+		return buffers_[track].name;
+	}
+
+
+	//---------------------------------------
+	// 追加した区間と名前をすべて削除する
+	//---------------------------------------
+	void ChromeTraceWriter::Clear()
+	{
+		events_.clear();
+		names_.clear();
+		baseTicks_.clear();
+	}
+
+	//---------------------------------------
+	// プロセス、トラックの表示名を設定する
+	//---------------------------------------
+	void ChromeTraceWriter::SetName(u32 pid, u32 tid, bool isProcess, const char* name)
+	{
+		for (auto&& v : names_)
+		{
+			if (v.pid == pid && v.tid == tid && v.isProcess == isProcess)
+			{
+				v.name = name;
+				return;
+			}
+		}
+		names_.push_back({ pid, tid, isProcess, name });
+	}
+	void ChromeTraceWriter::SetProcessName(u32 pid, const char* name)
+	{
+		SetName(pid, 0, true, name);
+	}
+	void ChromeTraceWriter::SetTrackName(u32 pid, u32 track, const char* name)
+	{
+		SetName(pid, track, false, name);
+	}
+
+	//---------------------------------------
+	// 区間を追加する
+	//---------------------------------------
+	void ChromeTraceWriter::AddEvents(u32 pid, const ProfileEvent* events, size_t count, u64 ticksPerSecond)
+	{
+		if (count == 0 || ticksPerSecond == 0)
+		{
+			return;
+		}
+
+		auto it = baseTicks_.find(pid);
+		if (it == baseTicks_.end())
+		{
+			u64 base = events[0].begin;
+			for (size_t i = 1; i < count; ++i)
+			{
+				base = std::min(base, events[i].begin);
+			}
+			it = baseTicks_.insert(std::make_pair(pid, base)).first;
+		}
+
+		const double toUs = 1000000.0 / (double)ticksPerSecond;
+		for (size_t i = 0; i < count; ++i)
+		{
+			auto&& e = events[i];
+			TraceEvent te;
+			te.name = e.name ? e.name : "";
+			te.ts = (double)(s64)(e.begin - it->second) * toUs;
+			te.dur = (e.end > e.begin) ? (double)(e.end - e.begin) * toUs : 0.0;
+			te.pid = pid;
+			te.tid = e.track;
+			events_.push_back(te);
+		}
+	}
+
+	//---------------------------------------
+	// JSON 文字列を作成する
+	//---------------------------------------
+	std::string ChromeTraceWriter::ToString() const
+	{
+		std::string out = "{\"traceEvents\":[";
+		bool first = true;
+		char buf[128];
+
+		for (auto&& v : names_)
+		{
+			out += first ? "\n" : ",\n";
+			first = false;
+			out += v.isProcess ? "{\"name\":\"process_name\",\"ph\":\"M\"" : "{\"name\":\"thread_name\",\"ph\":\"M\"";
+			snprintf(buf, sizeof(buf), ",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", v.pid, v.tid);
+			out += buf;
+			AppendJsonString(out, v.name);
+			out += "}}";
+		}
+
+		// 区間は完了イベント ("X") として出力する
+		for (auto&& e : events_)
+		{
+			out += first ? "\n" : ",\n";
+			first = false;
+			out += "{\"name\":";
+			AppendJsonString(out, e.name);
+			snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u}", e.ts, e.dur, e.pid, e.tid);
+			out += buf;
+		}
+
+		out += "\n],\"displayTimeUnit\":\"ms\"}\n";
+		return out;
+	}
+
+	//---------------------------------------
+	// JSON をファイルに出力する
+	//---------------------------------------
+	bool ChromeTraceWriter::WriteFile(const char* filename) const
+	{
+		std::ofstream ofs(filename, std::ios::out | std::ios::binary);
+		if (!ofs)
+		{
+			return false;
+		}
+		std::string json = ToString();
+		ofs.write(json.data(), json.size());
+		return ofs.good();
+	}
+
+}	// namespace sl12
+
+
+//	EOF
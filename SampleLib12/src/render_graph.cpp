@@ -0,0 +1,249 @@
+﻿#include <sl12/render_graph.h>
+#include <sl12/crc.h>
+#include <algorithm>
+#include <cstring>
+
+
+namespace sl12
+{
+	namespace
+	{
+		// 各IDの最初と最後のアクセスパス番号を記録する
+		void MakeResourceHistory(const std::vector<ResourceProducerBase*>& producers, RenderGraph::PassIndexMap& firstAccess, RenderGraph::PassIndexMap& lastAccess)
+		{
+			sl12::u32 passNo = 0;
+			for (auto&& prod : producers)
+			{
+				auto record = [&](const ResourceID* ids, sl12::u32 cnt)
+				{
+					for (sl12::u32 i = 0; i < cnt; ++i)
+					{
+						firstAccess.insert(std::make_pair(ids[i], passNo));
+						lastAccess[ids[i]] = passNo;
+					}
+				};
+				record(prod->GetOutputIds(), prod->GetOutputCount());
+				record(prod->GetInputIds(), prod->GetInputCount());
+				record(prod->GetTempIds(), prod->GetTempCount());
+
+				passNo++;
+			}
+		}
+
+	}
+
+	//---------------------------------------
+	// 描画リソース記述子のハッシュを求める
+	//---------------------------------------
+	sl12::u64 HashResourceDesc(const RenderResourceDesc& desc, sl12::u64 seed)
+	{
+		sl12::u32 key[8];
+		if (desc.resolution_rate > 0.0f)
+		{
+			memcpy(&key[0], &desc.resolution_rate, sizeof(float));
+			key[1] = 0xffffffff;
+		}
+		else
+		{
+			key[0] = desc.width;
+			key[1] = desc.height;
+		}
+		key[2] = desc.mipLevels;
+		key[3] = static_cast<sl12::u32>(desc.format);
+		key[4] = desc.sampleCount;
+		key[5] = desc.targetCount;
+		key[6] = desc.srvCount;
+		key[7] = desc.uavCount;
+		return CalcHash64(key, sizeof(key), seed);
+	}
+
+	//---------------------------------------
+	// プロデューサーのIDを加工し、構成のハッシュを求める
+	//---------------------------------------
+	sl12::u64 RenderGraph::NormalizeProducers(std::vector<ResourceProducerBase*>& producers, sl12::u64 seed)
+	{
+		sl12::u64 hash = seed;
+		sl12::u16 passNo = 0;
+		ResourceProducerBase* prev_prod = nullptr;
+		for (auto&& prod : producers)
+		{
+			// 出力リソースを処理する
+			auto cnt = prod->GetOutputCount();
+			auto ids = prod->GetOutputIds();
+			for (sl12::u16 i = 0; i < cnt; ++i)
+			{
+				// IDの加工を行う
+				// 特定用途を持たないただの出力バッファ(kPrevOutputID)の場合、パス番号と出力番号からユニークなIDを生成する
+				auto id = ids[i];
+				if (id.isPrevOutput)
+				{
+					id = ResourceID::CreatePrevOutputID((sl12::u8)passNo, (sl12::u8)i);
+					prod->SetOutputID(i, id);		// IDをセットし直す
+				}
+			}
+
+			// 入力リソースを処理する
+			cnt = prod->GetInputCount();
+			ids = prod->GetInputIds();
+			for (sl12::u16 i = 0; i < cnt; ++i)
+			{
+				// IDの加工を行う
+				// kPrevOutputID以上の場合は前回パスの出力を用いる
+				// 入力IDとしては (kPrevOutputID | prevOutputIndex) を指定するものとする
+				auto id = ids[i];
+				if (id.isPrevOutput)
+				{
+					assert(prev_prod != nullptr);
+					assert(id.index < prev_prod->GetOutputCount());
+
+					id = ResourceID::CreatePrevOutputID(passNo - 1, id.index);
+					prod->SetInput(i, id);			// IDをセットし直す
+				}
+			}
+
+			// 一時リソースに自動的にIDを割り当てる
+			cnt = prod->GetTempCount();
+			for (sl12::u16 i = 0; i < cnt; ++i)
+			{
+				prod->SetTempID(i, ResourceID::CreateTemporalID((sl12::u8)passNo, (sl12::u8)i));
+			}
+
+			// 加工後のIDと記述子からハッシュを求める
+			// NOTE: 前回状態はこの後の処理で決まるので含めない
+			sl12::u32 counts[] = { prod->GetInputCount(), prod->GetOutputCount(), prod->GetTempCount(), static_cast<sl12::u32>(prod->GetQueueType()) };
+			hash = CalcHash64(counts, sizeof(counts), hash);
+			hash = CalcHash64(prod->GetInputIds(), sizeof(ResourceID) * counts[0], hash);
+			hash = CalcHash64(prod->GetOutputIds(), sizeof(ResourceID) * counts[1], hash);
+			// NOTE: 記述子はパディングを含むので項目ごとに求める
+			//       ヒストリー数は比較に使用しないが、ヒストリーバッファの保持に影響するので含める
+			auto hashDescs = [&hash](const RenderResourceDesc* descs, sl12::u32 count)
+			{
+				for (sl12::u32 i = 0; i < count; ++i)
+				{
+					hash = HashResourceDesc(descs[i], hash);
+					hash = CalcHash64(&descs[i].historyMax, sizeof(descs[i].historyMax), hash);
+				}
+			};
+			hashDescs(prod->GetOutputDescs(), counts[1]);
+			hashDescs(prod->GetTempDescs(), counts[2]);
+
+			prev_prod = prod;
+			passNo++;
+		}
+		return hash;
+	}
+
+	//---------------------------------------
+	// プロデューサーの構成からリソースの使用情報を求める
+	//---------------------------------------
+	bool RenderGraph::Compile(std::vector<ResourceProducerBase*>& producers, sl12::u64 seed, bool isAsyncCompute)
+	{
+		// 構成が前回と同じなら使い回す
+		auto hash = NormalizeProducers(producers, seed);
+		if (isValid_ && (hash_ == hash))
+		{
+			return false;
+		}
+
+		// 各IDの最初と最後のアクセスパス番号を記録する
+		firstAccess_.clear();
+		lastAccess_.clear();
+		MakeResourceHistory(producers, firstAccess_, lastAccess_);
+
+		// パスごとに、そのパスで最後に使用されるIDをまとめる
+		// NOTE: 未使用リソースの再利用順が実行ごとに変わらないようにソートしておく
+		releaseIds_.assign(producers.size(), std::vector<ResourceID>());
+		for (auto&& access : lastAccess_)
+		{
+			if (!access.first.isSwapchain)
+			{
+				releaseIds_[access.second].push_back(access.first);
+			}
+		}
+		for (auto&& ids : releaseIds_)
+		{
+			std::sort(ids.begin(), ids.end());
+		}
+
+		// 出力IDの記述子を記録する
+		outputDescs_.clear();
+		for (auto&& prod : producers)
+		{
+			auto cnt = prod->GetOutputCount();
+			auto ids = prod->GetOutputIds();
+			auto descs = prod->GetOutputDescs();
+			for (sl12::u32 i = 0; i < cnt; i++)
+			{
+				if (!ids[i].isSwapchain)
+				{
+					outputDescs_.insert(std::make_pair(ids[i], descs[i]));
+				}
+			}
+		}
+
+		// キューの割り当てを決める
+		CompileSchedule(producers, isAsyncCompute);
+
+		hash_ = hash;
+		isValid_ = true;
+		return true;
+	}
+
+	//---------------------------------------
+	// 使用情報を破棄する
+	//---------------------------------------
+	void RenderGraph::Clear()
+	{
+		hash_ = 0;
+		isValid_ = false;
+		releaseIds_.clear();
+		outputDescs_.clear();
+		firstAccess_.clear();
+		lastAccess_.clear();
+		schedule_.Clear();
+	}
+
+	//---------------------------------------
+	// プロデューサーのリソースの読み書きからキューの割り当てを決める
+	//---------------------------------------
+	void RenderGraph::CompileSchedule(const std::vector<ResourceProducerBase*>& producers, bool isAsyncCompute)
+	{
+		std::vector<RenderSchedule::PassDesc> passes(producers.size());
+		for (size_t p = 0; p < producers.size(); p++)
+		{
+			auto prod = producers[p];
+			auto&& pass = passes[p];
+			bool useSwapchain = false;
+
+			auto cnt = prod->GetInputCount();
+			auto ids = prod->GetInputIds();
+			for (sl12::u32 i = 0; i < cnt; i++)
+			{
+				pass.reads.push_back(ids[i].id);
+			}
+			cnt = prod->GetOutputCount();
+			ids = prod->GetOutputIds();
+			for (sl12::u32 i = 0; i < cnt; i++)
+			{
+				pass.writes.push_back(ids[i].id);
+				useSwapchain = useSwapchain || ids[i].isSwapchain;
+			}
+			cnt = prod->GetTempCount();
+			ids = prod->GetTempIds();
+			for (sl12::u32 i = 0; i < cnt; i++)
+			{
+				pass.writes.push_back(ids[i].id);
+			}
+
+			// 一時リソースはバリアをユーザーが張るので、キューを移すとステートを管理できない
+			pass.isCompute = (prod->GetQueueType() == QueueType::Compute);
+			pass.allowAsync = isAsyncCompute && pass.isCompute && (prod->GetTempCount() == 0) && !useSwapchain;
+		}
+
+		schedule_.Build(passes);
+	}
+
+}	// namespace sl12
+
+
+//	EOF
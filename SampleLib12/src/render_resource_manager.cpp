@@ -1,14 +1,17 @@
 ﻿#include <sl12/render_resource_manager.h>
 #include <sl12/command_list.h>
 #include <sl12/swapchain.h>
+#include <algorithm>
+#include <cstring>
+#include <set>
 
 
 namespace sl12
 {
 	//-------------------------------------------
-	// レンダリングリソースの初期化
+	// 描画リソース記述子からテクスチャ記述子を作成する
 	//-------------------------------------------
-	bool RenderResource::Initialize(sl12::Device& device, const RenderResourceDesc& desc, sl12::u32 screenWidth, sl12::u32 screenHeight, D3D12_RESOURCE_STATES initialState)
+	bool RenderResource::MakeTextureDesc(const RenderResourceDesc& desc, sl12::u32 screenWidth, sl12::u32 screenHeight, D3D12_RESOURCE_STATES initialState, sl12::TextureDesc* pOut)
 	{
 		// ミップレベルは明示する必要がある
 		if (desc.mipLevels == 0)
@@ -23,8 +26,6 @@ namespace sl12
 			return false;
 		}
 
-		desc_ = desc;
-
 		// 幅と高さを決定する
 		sl12::u32 width = desc.width;
 		sl12::u32 height = desc.height;
@@ -32,7 +33,6 @@ namespace sl12
 		{
 			width = static_cast<sl12::u32>(static_cast<float>(screenWidth) * desc.resolution_rate);
 			height = static_cast<sl12::u32>(static_cast<float>(screenHeight) * desc.resolution_rate);
-			desc_.width = desc_.height = 0;
 		}
 
 		// RTVかDSVかを決定する
@@ -50,26 +50,59 @@ namespace sl12
 			}
 		}
 
+		sl12::TextureDesc& td = *pOut;
+		td = sl12::TextureDesc();
+		td.dimension = sl12::TextureDimension::Texture2D;
+		td.width = width;
+		td.height = height;
+		td.depth = 1;
+		td.format = desc.format;
+		td.mipLevels = desc.mipLevels;
+		td.sampleCount = desc.sampleCount;
+		td.initialState = initialState;
+		td.clearDepth = 1.0f;
+		td.isRenderTarget = isRtv;
+		td.isDepthBuffer = isDsv;
+		td.isUav = desc.uavCount > 0;
+		return true;
+	}
+
+	//-------------------------------------------
+	// レンダリングリソースの初期化
+	//-------------------------------------------
+	bool RenderResource::Initialize(sl12::Device& device, const RenderResourceDesc& desc, sl12::u32 screenWidth, sl12::u32 screenHeight, D3D12_RESOURCE_STATES initialState, ID3D12Heap* pHeap, sl12::u64 heapOffset)
+	{
+		sl12::TextureDesc td;
+		if (!MakeTextureDesc(desc, screenWidth, screenHeight, initialState, &td))
+		{
+			return false;
+		}
+
+		desc_ = desc;
+		if (desc.resolution_rate > 0.0f)
+		{
+			desc_.width = desc_.height = 0;
+		}
+		bool isRtv = td.isRenderTarget;
+		bool isDsv = td.isDepthBuffer;
+
 		// テクスチャオブジェクト生成
+		// ヒープが指定されている場合は他のリソースとメモリを共有する
+		if (pHeap)
+		{
+			if (!texture_.InitializePlaced(&device, td, pHeap, heapOffset))
+			{
+				return false;
+			}
+		}
+		else
 		{
-			sl12::TextureDesc td{};
-			td.dimension = sl12::TextureDimension::Texture2D;
-			td.width = width;
-			td.height = height;
-			td.depth = 1;
-			td.format = desc.format;
-			td.mipLevels = desc.mipLevels;
-			td.sampleCount = desc.sampleCount;
-			td.initialState = initialState;
-			td.clearDepth = 1.0f;
-			td.isRenderTarget = isRtv;
-			td.isDepthBuffer = isDsv;
-			td.isUav = desc.uavCount > 0;
 			if (!texture_.Initialize(&device, td))
 			{
 				return false;
 			}
 		}
+		isPlaced_ = (pHeap != nullptr);
 
 		// RTV生成
 		if (isRtv)
@@ -179,136 +212,130 @@ namespace sl12
 	//-------------------------------------------
 	void RenderResourceManager::AllReset()
 	{
+		DestroyTransients();
 		for (auto&& v : resources_)
 		{
 			delete v;
 		}
 		resources_.clear();
 		resource_map_.clear();
+		graph_.Clear();
 	}
 
 	namespace
 	{
-		typedef std::map<ResourceID, sl12::u32>		LastAccessPassInfo;
+		typedef std::unordered_map<ResourceID, RenderResource*, ResourceIDHash>			ResourceMap;
 
-		void MakeResourceHistory(std::vector<ResourceProducerBase*>& producers, LastAccessPassInfo& lastAccess)
+		// パスの種類ごとの入力リソースのステート
+		D3D12_RESOURCE_STATES GetInputState(const ResourceProducerBase* prod)
 		{
-			auto prodCnt = producers.size();
-			sl12::u16 passNo = 0;
-			ResourceProducerBase* prev_prod = nullptr;
-			for (auto&& prod : producers)
-			{
-				// 出力リソースを処理する
-				auto cnt = prod->GetOutputCount();
-				auto ids = prod->GetOutputIds();
-				for (sl12::u16 i = 0; i < cnt; ++i)
-				{
-					// IDの加工を行う
-					// 特定用途を持たないただの出力バッファ(kPrevOutputID)の場合、パス番号と出力番号からユニークなIDを生成する
-					auto id = ids[i];
-					if (id.isPrevOutput)
-					{
-						id = ResourceID::CreatePrevOutputID((sl12::u8)passNo, (sl12::u8)i);
-						prod->SetOutputID(i, id);		// IDをセットし直す
-					}
-
-					lastAccess[id] = passNo;
-				}
-
-				// 入力リソースを処理する
-				cnt = prod->GetInputCount();
-				ids = prod->GetInputIds();
-				for (sl12::u16 i = 0; i < cnt; ++i)
-				{
-					// IDの加工を行う
-					// kPrevOutputID以上の場合は前回パスの出力を用いる
-					// 入力IDとしては (kPrevOutputID | prevOutputIndex) を指定するものとする
-					auto id = ids[i];
-					if (id.isPrevOutput)
-					{
-						assert(prev_prod != nullptr);
-						assert(id.index < prev_prod->GetOutputCount());
-
-						id = ResourceID::CreatePrevOutputID(passNo - 1, id.index);
-						prod->SetInput(i, id);			// IDをセットし直す
-					}
-
-					lastAccess[id] = passNo;
-				}
-
-				// 一時リソースに自動的にIDを割り当てる
-				cnt = prod->GetTempCount();
-				for (sl12::u16 i = 0; i < cnt; ++i)
-				{
-					auto id = ResourceID::CreateTemporalID((sl12::u8)passNo, (sl12::u8)i);
-					prod->SetTempID(i, id);
-					lastAccess[id] = passNo;
-				}
+			return (prod->GetQueueType() == QueueType::Compute)
+				? D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+				: D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		}
 
-				prev_prod = prod;
-				passNo++;
+		// パスの種類ごとの出力リソースのステート
+		D3D12_RESOURCE_STATES GetOutputState(const ResourceProducerBase* prod, const RenderResource* res)
+		{
+			if (prod->GetQueueType() == QueueType::Compute)
+			{
+				assert(res->IsUav());
+				return D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
 			}
+			return res->IsRtv() ? D3D12_RESOURCE_STATE_RENDER_TARGET : D3D12_RESOURCE_STATE_DEPTH_WRITE;
+		}
+
+		// コンピュートキューのコマンドリストで遷移できるステートか
+		bool IsComputeQueueState(D3D12_RESOURCE_STATES state)
+		{
+			const D3D12_RESOURCE_STATES kComputeStates = D3D12_RESOURCE_STATE_UNORDERED_ACCESS
+				| D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE
+				| D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT
+				| D3D12_RESOURCE_STATE_COPY_DEST
+				| D3D12_RESOURCE_STATE_COPY_SOURCE;
+			return (state & ~kComputeStates) == 0;
 		}
 
-		// 未使用リソースから使えるものを探す
-		std::vector<RenderResource*>::iterator FindFromUnusedResource(std::vector<RenderResource*>& unusedRes, const RenderResourceDesc& desc)
+		// 非同期コンピュートキューのパスの完了をグラフィクスキューが待つまでに実行される最後のパス番号
+		sl12::u32 FindAsyncJoinPass(const RenderSchedule& schedule, sl12::u32 pass)
 		{
-			for (auto it = unusedRes.begin(); it != unusedRes.end(); it++)
+			auto batch = schedule.GetPassBatch(pass);
+			for (sl12::u32 i = batch + 1; i < schedule.GetBatchCount(); i++)
 			{
-				if ((*it)->IsSameDesc(desc))
+				// コンピュートキューは順番に実行されるので、後のバッチを待つ場合も含める
+				auto&& b = schedule.GetBatch(i);
+				auto waitIt = std::find_if(b.waitBatches.begin(), b.waitBatches.end(), [batch](sl12::u32 w) { return w >= batch; });
+				if ((b.queue == QueueType::Graphics) && (waitIt != b.waitBatches.end()))
 				{
-					return it;
+					return b.passes.empty() ? schedule.GetPassCount() - 1 : b.passes.front() - 1;
 				}
 			}
-			return unusedRes.end();
+			return schedule.GetPassCount() - 1;
 		}
 
-		// ヒストリーバッファの記述子を検索する
-		bool FindDescForHistoryBuffer(RenderResourceDesc* pOut, const std::vector<ResourceProducerBase*>& producers, ResourceID id)
+		// 未使用リソースを記述子ごとに分けて保持する
+		class UnusedResourcePool
 		{
-			id.historyOffset = 0;
-			for (auto&& prod : producers)
+		public:
+			void Add(RenderResource* res)
+			{
+				buckets_[static_cast<size_t>(HashResourceDesc(res->GetDesc()))].push_back(res);
+			}
+
+			// 記述子が同じリソースを取り出す. 見つからなければ nullptr
+			RenderResource* Take(const RenderResourceDesc& desc)
 			{
-				// 出力バッファを検索する
-				auto cnt = prod->GetOutputCount();
-				auto ids = prod->GetOutputIds();
-				for (u32 i = 0; i < cnt; i++)
+				auto it = buckets_.find(static_cast<size_t>(HashResourceDesc(desc)));
+				if (it == buckets_.end())
+				{
+					return nullptr;
+				}
+
+				// ハッシュが衝突している可能性があるので記述子も比較する
+				auto&& list = it->second;
+				for (size_t i = list.size(); i > 0; i--)
 				{
-					if (ids[i] == id)
+					auto res = list[i - 1];
+					if (res->IsSameDesc(desc))
 					{
-						*pOut = prod->GetOutputDescs()[i];
-						return true;
+						list.erase(list.begin() + (i - 1));
+						return res;
 					}
 				}
+				return nullptr;
 			}
-			return false;
-		}
+
+		private:
+			std::unordered_map<size_t, std::vector<RenderResource*>>	buckets_;
+		};	// class UnusedResourcePool
 
 		// リソース生成
 		void MakeResourcesDetail(
 			sl12::Device& device,
 			sl12::u32 screenWidth, sl12::u32 screenHeight,
-			const LastAccessPassInfo& lastAccess,
+			const std::vector<std::vector<ResourceID>>& releaseIds,
+			const RenderGraph::ResourceDescMap& outputDescs,
+			const ResourceMap& placedRes,
 			std::vector<ResourceProducerBase*>& producers,
 			std::vector<RenderResource*>& outResources,
-			std::map<ResourceID, RenderResource*>& outResourceMap)
+			ResourceMap& outResourceMap)
 		{
 			const D3D12_RESOURCE_STATES kInitialState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
 			const D3D12_RESOURCE_STATES kInputState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
 			const D3D12_RESOURCE_STATES kRtvState = D3D12_RESOURCE_STATE_RENDER_TARGET;
-			const D3D12_RESOURCE_STATES kDsvState = D3D12_RESOURCE_STATE_DEPTH_WRITE;
 
 			sl12::u16 passNo = 0;
-			std::map<ResourceID, RenderResource*> usedRes;
-			std::vector<RenderResource*> unusedRes;
+			ResourceMap usedRes;
+			UnusedResourcePool unusedRes;
 
 			// 前回フレームのリソースを使用中リストと未使用リストに振り分ける
+			usedRes.reserve(outResources.size());
 			outResourceMap.clear();
 			for (auto&& res : outResources)
 			{
 				if (res->IsHistoryEnd())
 				{
-					unusedRes.push_back(res);
+					unusedRes.Add(res);
 				}
 				else
 				{
@@ -334,7 +361,7 @@ namespace sl12
 						// 使用中リストに見つかったので状態を保存
 						auto res = findIt->second;
 						prod->SetInputPrevState(i, res->GetState());
-						res->SetState(kInputState);
+						res->SetState(GetInputState(prod));
 					}
 					else
 					{
@@ -342,18 +369,20 @@ namespace sl12
 						assert(id.historyOffset > 0);
 						// 入力リソースには記述子が指定されていないので、プロデューサーから対応する記述子を検索する
 						// NOTE: ヒストリーバッファに描画するパスが存在しないはずはないが、存在しない場合はAssertする
-						RenderResourceDesc desc;
-						bool isFindHBDesc = FindDescForHistoryBuffer(&desc, producers, id);
-						assert(isFindHBDesc);
+						auto baseId = id;
+						baseId.historyOffset = 0;
+						auto descIt = outputDescs.find(baseId);
+						assert(descIt != outputDescs.end());
 						// 新規リソースを作成する
 						auto res = new RenderResource();
-						res->Initialize(device, desc, screenWidth, screenHeight, kInitialState);
+						res->Initialize(device, descIt->second, screenWidth, screenHeight, kInitialState);
+						res->SetState(GetInputState(prod));
 						res->SetHistoryMax(0);
 						res->SetLastID(id);
 						outResources.push_back(res);
 						usedRes[id] = res;
 						outResourceMap[id] = res;
-						prod->SetOutputPrevState(i, kInitialState);
+						prod->SetInputPrevState(i, kInitialState);
 					}
 				}
 
@@ -372,7 +401,7 @@ namespace sl12
 						if (!id.isSwapchain)
 						{
 							prod->SetOutputPrevState(i, res->GetState());
-							res->SetState(res->IsRtv() ? kRtvState : kDsvState);
+							res->SetState(GetOutputState(prod, res));
 						}
 						else
 						{
@@ -388,16 +417,13 @@ namespace sl12
 					}
 					else
 					{
-						RenderResource* res;
 						auto&& desc = descs[i];
 
-						// 未使用リソースに使えるものがあるかチェック
-						auto unusedIt = FindFromUnusedResource(unusedRes, desc);
-						if (unusedIt != unusedRes.end())
+						// 一時リソース用ヒープに配置済みならそれを使い、なければ未使用リソースから探す
+						auto placedIt = placedRes.find(id);
+						RenderResource* res = (placedIt != placedRes.end()) ? placedIt->second : unusedRes.Take(desc);
+						if (res)
 						{
-							// 未使用リソースが見つかったので利用する
-							res = *unusedIt;
-							unusedRes.erase(unusedIt);
 							prod->SetOutputPrevState(i, res->GetState());
 						}
 						else
@@ -410,7 +436,7 @@ namespace sl12
 						}
 
 						// 使用中リストに登録する
-						res->SetState(res->IsRtv() ? kRtvState : kDsvState);
+						res->SetState(GetOutputState(prod, res));
 						res->SetHistoryMax(desc.historyMax);
 						res->SetLastID(id);
 						usedRes[id] = res;
@@ -424,15 +450,11 @@ namespace sl12
 				descs = prod->GetTempDescs();
 				for (sl12::u32 i = 0; i < cnt; i++)
 				{
-					RenderResource* res;
-
 					auto id = ids[i];
-					auto unusedIt = FindFromUnusedResource(unusedRes, descs[i]);
-					if (unusedIt != unusedRes.end())
+					RenderResource* res = unusedRes.Take(descs[i]);
+					if (res)
 					{
 						// 未使用リソースが見つかったので利用する
-						res = *unusedIt;
-						unusedRes.erase(unusedIt);
 						prod->SetTempPrevState(i, res->GetState());
 					}
 					else
@@ -453,28 +475,20 @@ namespace sl12
 				}
 
 				// 使用中リストを整理する
-				auto usedIt = usedRes.begin();
-				while (usedIt != usedRes.end())
+				// このパスで最後に使用されたIDのみを調べればよい
+				for (auto&& releaseId : releaseIds[passNo])
 				{
-					if (usedIt->first.isSwapchain)
-					{
-						usedIt++;
-						continue;
-					}
-
-					auto findIt = lastAccess.find(usedIt->first);
-					if (usedIt->second->IsHistoryEnd() && (findIt != lastAccess.end()) && (findIt->second <= passNo))
+					auto usedIt = usedRes.find(releaseId);
+					if ((usedIt != usedRes.end()) && usedIt->second->IsHistoryEnd())
 					{
 						// すでに不要になったリソースを未使用リストに移動する
 						// NOTE: ヒストリーバッファは保持するフレーム数を経過するまで未使用にできない
-						unusedRes.push_back(usedIt->second);
-						auto thisIt = usedIt;
-						usedIt++;
-						usedRes.erase(thisIt);
-					}
-					else
-					{
-						usedIt++;
+						// NOTE: ヒープに配置した一時リソースは他の出力に使い回さない
+						if (!usedIt->second->IsPlaced())
+						{
+							unusedRes.Add(usedIt->second);
+						}
+						usedRes.erase(usedIt);
 					}
 				}
 
@@ -491,43 +505,187 @@ namespace sl12
 	{
 		assert(pDevice_ != nullptr);
 
-		// 各IDの最終アクセスパス番号を記録する
-		LastAccessPassInfo lastAccess;
-		MakeResourceHistory(producers, lastAccess);
+		// 構成が前回と同じならリソースの使用情報を使い回す
+		// NOTE: 一時リソースや非同期コンピュートの設定が変わった場合も作り直す
+		sl12::u64 seed = (isTransientAliasing_ ? 1 : 0) | (isAsyncCompute_ ? 2 : 0);
+		bool isCompiled = graph_.Compile(producers, seed, isAsyncCompute_);
+
+		// パス番号を記録する
+		// NOTE: 構成のハッシュはプロデューサーのアドレスを含まないので、構成が同じでも毎回作り直す
+		passIndices_.clear();
+		for (sl12::u32 i = 0; i < (sl12::u32)producers.size(); i++)
+		{
+			passIndices_[producers[i]] = i;
+		}
+
+		// 一時リソースのメモリ配置を決める
+		// NOTE: 一時リソースの配置はキューの割り当ての結果を使用する
+		if (isCompiled)
+		{
+			if (isTransientAliasing_)
+			{
+				CompileTransients(producers);
+			}
+			else if (pTransientHeap_)
+			{
+				pDevice_->WaitDrawDone();
+				DestroyTransients();
+			}
+		}
 
 		// 実際のリソース生成
-		MakeResourcesDetail(*pDevice_, screenWidth_, screenHeight_, lastAccess, producers, resources_, resource_map_);
+		MakeResourcesDetail(*pDevice_, screenWidth_, screenHeight_, graph_.GetReleaseIds(), graph_.GetOutputDescs(), transientMap_, producers, resources_, resource_map_);
 	}
 
 	//-------------------------------------------
 	// 入力リソースにバリアを張る
 	//-------------------------------------------
 	void RenderResourceManager::BarrierInputResources(CommandList& cmdList, const ResourceProducerBase* pProd)
+	{
+		BarrierInputResourcesDetail(cmdList, nullptr, pProd);
+	}
+
+	//-------------------------------------------
+	// 出力リソースにバリアを張る
+	//-------------------------------------------
+	void RenderResourceManager::BarrierOutputResources(CommandList& cmdList, const ResourceProducerBase* pProd)
+	{
+		BarrierOutputResourcesDetail(cmdList, nullptr, pProd);
+	}
+
+	//-------------------------------------------
+	// 計画に従って入力リソースにバリアを張る
+	//-------------------------------------------
+	bool RenderResourceManager::BarrierInputResources(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd)
+	{
+		CommandList* pPrologue = nullptr;
+		auto pCmdList = GetPassCommandLists(cmdLists, pProd, &pPrologue);
+		if (!pCmdList)
+		{
+			return false;
+		}
+		BarrierInputResourcesDetail(*pCmdList, pPrologue, pProd);
+		return true;
+	}
+
+	//-------------------------------------------
+	// 計画に従って出力リソースにバリアを張る
+	//-------------------------------------------
+	bool RenderResourceManager::BarrierOutputResources(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd)
+	{
+		CommandList* pPrologue = nullptr;
+		auto pCmdList = GetPassCommandLists(cmdLists, pProd, &pPrologue);
+		if (!pCmdList)
+		{
+			return false;
+		}
+		BarrierOutputResourcesDetail(*pCmdList, pPrologue, pProd);
+		return true;
+	}
+
+	//-------------------------------------------
+	// 計画に従って入出力リソースにバリアを張る
+	//-------------------------------------------
+	bool RenderResourceManager::BarrierAllResources(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd)
+	{
+		CommandList* pPrologue = nullptr;
+		auto pCmdList = GetPassCommandLists(cmdLists, pProd, &pPrologue);
+		if (!pCmdList)
+		{
+			return false;
+		}
+
+		auto&& cmdList = *pCmdList;
+		cmdList.BeginBarrierBatch();
+		if (pPrologue)
+		{
+			pPrologue->BeginBarrierBatch();
+		}
+		BarrierInputResourcesDetail(cmdList, pPrologue, pProd);
+		BarrierOutputResourcesDetail(cmdList, pPrologue, pProd);
+		if (pPrologue)
+		{
+			pPrologue->EndBarrierBatch();
+		}
+		cmdList.EndBarrierBatch();
+		return true;
+	}
+
+	//-------------------------------------------
+	// パスを記録するコマンドリストを取得する
+	// MakeResources に渡されていないプロデューサーの場合は nullptr を返す
+	//-------------------------------------------
+	CommandList* RenderResourceManager::GetPassCommandLists(ScheduledCommandLists& cmdLists, const ResourceProducerBase* pProd, CommandList** ppPrologue)
+	{
+		*ppPrologue = nullptr;
+
+		auto passIt = passIndices_.find(pProd);
+		if (passIt == passIndices_.end())
+		{
+			return nullptr;
+		}
+
+		auto pass = passIt->second;
+		if (graph_.GetSchedule().GetPassQueue(pass) == QueueType::Compute)
+		{
+			*ppPrologue = cmdLists.GetPrologueCommandList(pass);
+		}
+		return &cmdLists.GetPassCommandList(pass);
+	}
+
+	//-------------------------------------------
+	// 入力リソースにバリアを張る
+	// pPrologue が指定されている場合、コンピュートキューで遷移できないバリアはそちらに張る
+	//-------------------------------------------
+	void RenderResourceManager::BarrierInputResourcesDetail(CommandList& cmdList, CommandList* pPrologue, const ResourceProducerBase* pProd)
 	{
 		auto count = pProd->GetInputCount();
 		auto ids = pProd->GetInputIds();
 		auto end = ids + count;
 		auto prevState = pProd->GetInputPrevStates();
+		auto nextState = GetInputState(pProd);
+
+		// 全リソースのバリアを1回で発行する
+		cmdList.BeginBarrierBatch();
+		if (pPrologue)
+		{
+			pPrologue->BeginBarrierBatch();
+		}
 		for (; ids != end; ids++)
 		{
-			if (*prevState != (D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE))
+			if (*prevState != nextState)
 			{
 				auto res = GetRenderResourceFromID(*ids);
-				cmdList.TransitionBarrier(res->GetTexture(), *prevState, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+				auto&& target = (pPrologue && !IsComputeQueueState(*prevState)) ? *pPrologue : cmdList;
+				target.TransitionBarrier(res->GetTexture(), *prevState, nextState);
 			}
 			prevState++;
 		}
+		if (pPrologue)
+		{
+			pPrologue->EndBarrierBatch();
+		}
+		cmdList.EndBarrierBatch();
 	}
 
 	//-------------------------------------------
 	// 出力リソースにバリアを張る
+	// pPrologue が指定されている場合、コンピュートキューで遷移できないバリアはそちらに張る
 	//-------------------------------------------
-	void RenderResourceManager::BarrierOutputResources(CommandList& cmdList, const ResourceProducerBase* pProd)
+	void RenderResourceManager::BarrierOutputResourcesDetail(CommandList& cmdList, CommandList* pPrologue, const ResourceProducerBase* pProd)
 	{
 		auto count = pProd->GetOutputCount();
 		auto ids = pProd->GetOutputIds();
 		auto end = ids + count;
 		auto prevState = pProd->GetOutputPrevStates();
+
+		// 全リソースのバリアを1回で発行する
+		cmdList.BeginBarrierBatch();
+		if (pPrologue)
+		{
+			pPrologue->BeginBarrierBatch();
+		}
+		BarrierTransientResources(cmdList, pProd);
 		for (; ids != end; ids++)
 		{
 			if (ids->isSwapchain)
@@ -541,17 +699,293 @@ namespace sl12
 			else
 			{
 				auto res = GetRenderResourceFromID(*ids);
-				if (res->IsRtv() && (*prevState != D3D12_RESOURCE_STATE_RENDER_TARGET))
+				auto nextState = GetOutputState(pProd, res);
+				if (*prevState != nextState)
 				{
-					cmdList.TransitionBarrier(res->GetTexture(), *prevState, D3D12_RESOURCE_STATE_RENDER_TARGET);
+					auto&& target = (pPrologue && !IsComputeQueueState(*prevState)) ? *pPrologue : cmdList;
+					target.TransitionBarrier(res->GetTexture(), *prevState, nextState);
 				}
-				else if (res->IsDsv() && (*prevState != D3D12_RESOURCE_STATE_DEPTH_WRITE))
+				else if (nextState == D3D12_RESOURCE_STATE_UNORDERED_ACCESS)
 				{
-					cmdList.TransitionBarrier(res->GetTexture(), *prevState, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+					// 前のパスのUAVへの書き込みを待つ
+					cmdList.UAVBarrier(res->GetTexture());
 				}
 			}
 			prevState++;
 		}
+		if (pPrologue)
+		{
+			pPrologue->EndBarrierBatch();
+		}
+		cmdList.EndBarrierBatch();
+
+		DiscardTransientResources(cmdList, pProd);
+	}
+
+	//-------------------------------------------
+	// 一時リソースのメモリ配置を決める
+	//-------------------------------------------
+	void RenderResourceManager::CompileTransients(const std::vector<ResourceProducerBase*>& producers)
+	{
+		auto&& schedule = graph_.GetSchedule();
+		auto&& firstAccess = graph_.GetFirstAccess();
+		auto&& lastAccess = graph_.GetLastAccess();
+		const D3D12_RESOURCE_STATES kInitialState = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+
+		// ヒストリーを持たないRTV/DSVの出力を対象とする
+		std::map<ResourceID, TransientResource> candidates;
+		std::set<ResourceID> excluded;
+		RenderGraph::PassIndexMap asyncLastAccess;
+		sl12::u32 passNo = 0;
+		for (auto&& prod : producers)
+		{
+			// 非同期コンピュートキューのパスは後続のパスと並行するので、使用するリソースはグラフィクスキューが完了を待つまで生存させる
+			// 出力リソースは共有しない. エイリアシングバリアとDiscardはグラフィクスキューで行う
+			if (schedule.GetPassQueue(passNo) == QueueType::Compute)
+			{
+				auto joinPass = FindAsyncJoinPass(schedule, passNo);
+				auto cnt = prod->GetInputCount();
+				auto ids = prod->GetInputIds();
+				for (sl12::u32 i = 0; i < cnt; i++)
+				{
+					auto&& last = asyncLastAccess[ids[i]];
+					last = std::max(last, joinPass);
+				}
+				cnt = prod->GetOutputCount();
+				ids = prod->GetOutputIds();
+				for (sl12::u32 i = 0; i < cnt; i++)
+				{
+					excluded.insert(ids[i]);
+				}
+			}
+
+			auto cnt = prod->GetOutputCount();
+			auto ids = prod->GetOutputIds();
+			auto descs = prod->GetOutputDescs();
+			for (sl12::u32 i = 0; i < cnt; i++)
+			{
+				auto id = ids[i];
+				if (id.isSwapchain)
+				{
+					continue;
+				}
+				if ((descs[i].historyMax > 0) || (descs[i].targetCount == 0) || (id.historyOffset > 0))
+				{
+					excluded.insert(id);
+					continue;
+				}
+				if (candidates.find(id) == candidates.end())
+				{
+					TransientResource t{};
+					t.id = id;
+					t.desc = descs[i];
+					t.firstPass = passNo;
+					candidates[id] = t;
+				}
+			}
+
+			// 過去フレームの内容を参照されるリソースは共有できない
+			cnt = prod->GetInputCount();
+			ids = prod->GetInputIds();
+			for (sl12::u32 i = 0; i < cnt; i++)
+			{
+				if (ids[i].historyOffset > 0)
+				{
+					auto id = ids[i];
+					id.historyOffset = 0;
+					excluded.insert(id);
+				}
+			}
+
+			passNo++;
+		}
+
+		TransientMemoryPlanner planner;
+		std::vector<TransientResource> list;
+		for (auto&& c : candidates)
+		{
+			auto&& t = c.second;
+			if (excluded.find(t.id) != excluded.end())
+			{
+				continue;
+			}
+
+			// 出力前に読み込まれるリソースは前フレームの内容を使っているので共有できない
+			auto firstIt = firstAccess.find(t.id);
+			auto lastIt = lastAccess.find(t.id);
+			if (firstIt == firstAccess.end() || lastIt == lastAccess.end() || firstIt->second < t.firstPass)
+			{
+				continue;
+			}
+			auto lastPass = lastIt->second;
+			auto asyncIt = asyncLastAccess.find(t.id);
+			if (asyncIt != asyncLastAccess.end())
+			{
+				lastPass = std::max(lastPass, asyncIt->second);
+			}
+
+			sl12::TextureDesc td;
+			if (!RenderResource::MakeTextureDesc(t.desc, screenWidth_, screenHeight_, kInitialState, &td))
+			{
+				continue;
+			}
+			auto info = sl12::Texture::GetAllocationInfo(pDevice_, td);
+			t.size = info.SizeInBytes;
+			planner.AddResource(TransientMemoryPlanner::Request{ t.firstPass, lastPass, info.SizeInBytes, info.Alignment });
+			list.push_back(t);
+		}
+
+		planner.Plan();
+		sl12::u64 heapAlignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+		for (sl12::u32 i = 0; i < planner.GetResourceCount(); i++)
+		{
+			auto&& placement = planner.GetPlacement(i);
+			list[i].offset = placement.offset;
+			list[i].aliasBefore = placement.aliasBefore;
+			list[i].isShared = placement.isShared;
+			if (planner.GetRequest(i).alignment > heapAlignment)
+			{
+				heapAlignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+			}
+		}
+		TransientMemoryStats stats;
+		stats.heapSize = planner.GetHeapSize();
+		stats.peakLiveSize = planner.GetPeakLiveSize();
+		stats.totalSize = planner.GetTotalSize();
+		stats.resourceCount = planner.GetResourceCount();
+
+		// 前回と同じ配置ならリソースをそのまま使う
+		bool isSame = (pTransientHeap_ != nullptr) && (list.size() == transients_.size());
+		for (size_t i = 0; isSame && i < list.size(); i++)
+		{
+			auto&& a = list[i];
+			auto&& b = transients_[i];
+			isSame = (a.id == b.id) && (a.desc == b.desc) && (a.offset == b.offset) && (a.size == b.size);
+		}
+		if (isSame)
+		{
+			for (size_t i = 0; i < list.size(); i++)
+			{
+				list[i].pResource = transients_[i].pResource;
+			}
+			transients_ = list;
+			transientStats_ = stats;
+			return;
+		}
+
+		// 配置が変わったので作り直す
+		// NOTE: 前フレームのコマンドが参照している可能性があるので、GPUの完了を待つ
+		// NOTE: 破棄で使用量がリセットされるので、使用量はその後に設定する
+		if (pTransientHeap_)
+		{
+			pDevice_->WaitDrawDone();
+			DestroyTransients();
+		}
+		transientStats_ = stats;
+		if (list.empty())
+		{
+			return;
+		}
+
+		D3D12_HEAP_DESC hd{};
+		hd.SizeInBytes = planner.GetHeapSize();
+		hd.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+		hd.Properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		hd.Properties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		hd.Properties.CreationNodeMask = 1;
+		hd.Properties.VisibleNodeMask = 1;
+		hd.Alignment = heapAlignment;
+		hd.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+		auto hr = pDevice_->GetDeviceDep()->CreateHeap(&hd, IID_PPV_ARGS(&pTransientHeap_));
+		if (FAILED(hr))
+		{
+			// ヒープが作れない場合は通常のリソースとして生成させる
+			pTransientHeap_ = nullptr;
+			return;
+		}
+
+		for (auto&& t : list)
+		{
+			auto res = new RenderResource();
+			if (!res->Initialize(*pDevice_, t.desc, screenWidth_, screenHeight_, kInitialState, pTransientHeap_, t.offset))
+			{
+				delete res;
+				transients_ = list;
+				DestroyTransients();
+				return;
+			}
+			t.pResource = res;
+			transientMap_[t.id] = res;
+		}
+		transients_ = list;
+	}
+
+	//-------------------------------------------
+	// 一時リソースを破棄する
+	//-------------------------------------------
+	void RenderResourceManager::DestroyTransients()
+	{
+		for (auto&& t : transients_)
+		{
+			delete t.pResource;
+		}
+		transients_.clear();
+		transientMap_.clear();
+		SafeRelease(pTransientHeap_);
+		transientStats_ = TransientMemoryStats();
+	}
+
+	//-------------------------------------------
+	// このパスから使用を開始する一時リソースにエイリアシングバリアを張る
+	//-------------------------------------------
+	void RenderResourceManager::BarrierTransientResources(CommandList& cmdList, const ResourceProducerBase* pProd)
+	{
+		auto passIt = passIndices_.find(pProd);
+		if (passIt == passIndices_.end())
+		{
+			return;
+		}
+
+		for (auto&& t : transients_)
+		{
+			if (t.firstPass != passIt->second || !t.isShared)
+			{
+				continue;
+			}
+
+			// 直前の使用者がフレーム内にない場合は、前フレームの使用者を含めて対象にする
+			auto pBefore = (t.aliasBefore != TransientMemoryPlanner::kInvalidIndex) ? transients_[t.aliasBefore].pResource->GetTexture() : nullptr;
+			cmdList.AliasingBarrier(pBefore, t.pResource->GetTexture());
+		}
+	}
+
+	//-------------------------------------------
+	// このパスから使用を開始する一時リソースをDiscardする
+	//-------------------------------------------
+	void RenderResourceManager::DiscardTransientResources(CommandList& cmdList, const ResourceProducerBase* pProd)
+	{
+		auto passIt = passIndices_.find(pProd);
+		if (passIt == passIndices_.end())
+		{
+			return;
+		}
+
+		// 配置リソースは最初にクリアかDiscardをしなければならない
+		// Discard はRTV、DSVのステートで行う必要があるので、出力のバリアを発行してから行う
+		bool isFlushed = false;
+		for (auto&& t : transients_)
+		{
+			if (t.firstPass != passIt->second)
+			{
+				continue;
+			}
+			if (!isFlushed)
+			{
+				cmdList.FlushBarriers();
+				isFlushed = true;
+			}
+			cmdList.GetCommandList()->DiscardResource(t.pResource->GetTexture()->GetResourceDep(), nullptr);
+		}
 	}
 
 }	// namespace sl12
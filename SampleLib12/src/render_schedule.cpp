@@ -0,0 +1,418 @@
+﻿#include <sl12/render_schedule.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <cstdio>
+
+
+namespace sl12
+{
+	namespace
+	{
+		const char* kQueueNames[] = { "Graphics", "Compute" };
+
+		inline u32 ToIndex(QueueType q)
+		{
+			return static_cast<u32>(q);
+		}
+
+		inline QueueType OtherQueue(QueueType q)
+		{
+			return (q == QueueType::Graphics) ? QueueType::Compute : QueueType::Graphics;
+		}
+
+		void AppendFormat(std::string& out, const char* format, u32 value)
+		{
+			char buf[32];
+			snprintf(buf, sizeof(buf), format, value);
+			out += buf;
+		}
+	}
+
+	const u32 RenderSchedule::kInvalidIndex;
+
+	//---------------------------------------
+	// 計画をクリアする
+	//---------------------------------------
+	void RenderSchedule::Clear()
+	{
+		dependencies_.clear();
+		passQueues_.clear();
+		prologuePasses_.clear();
+		passBatches_.clear();
+		prologueBatches_.clear();
+		batches_.clear();
+	}
+
+	//---------------------------------------
+	// パスの情報から計画を作成する
+	//---------------------------------------
+	void RenderSchedule::Build(const std::vector<PassDesc>& passes)
+	{
+		Clear();
+
+		BuildDependencies(passes);
+		AssignQueues(passes);
+		BuildBatches();
+	}
+
+	//---------------------------------------
+	// リソースの読み書きからパスの依存関係を求める
+	//---------------------------------------
+	void RenderSchedule::BuildDependencies(const std::vector<PassDesc>& passes)
+	{
+		struct Access
+		{
+			u32					lastWriter = kInvalidIndex;
+			std::vector<u32>	readers;				// 最後の書き込み以降に読み込んだパス
+			bool				isComputeRead = false;
+		};	// struct Access
+
+		const u32 passCount = static_cast<u32>(passes.size());
+		std::unordered_map<u32, Access> accesses;
+		dependencies_.resize(passCount);
+		for (u32 pass = 0; pass < passCount; pass++)
+		{
+			auto&& desc = passes[pass];
+			auto&& deps = dependencies_[pass];
+
+			// 書き込み後の読み込み
+			for (auto key : desc.reads)
+			{
+				auto&& a = accesses[key];
+				if (a.lastWriter != kInvalidIndex)
+				{
+					deps.push_back(a.lastWriter);
+				}
+
+				// グラフィクスとコンピュートでは読み込み時のステートが異なる
+				// ステートの遷移は書き込みと同じく、それまでの読み込みの完了を待つ必要がある
+				if (!a.readers.empty() && (a.isComputeRead != desc.isCompute))
+				{
+					deps.insert(deps.end(), a.readers.begin(), a.readers.end());
+					a.readers.clear();
+				}
+				a.isComputeRead = desc.isCompute;
+				a.readers.push_back(pass);
+			}
+
+			// 書き込み後の書き込み、読み込み後の書き込み
+			for (auto key : desc.writes)
+			{
+				auto&& a = accesses[key];
+				if (a.lastWriter != kInvalidIndex)
+				{
+					deps.push_back(a.lastWriter);
+				}
+				deps.insert(deps.end(), a.readers.begin(), a.readers.end());
+				a.readers.clear();
+				a.lastWriter = pass;
+			}
+
+			deps.erase(std::remove(deps.begin(), deps.end(), pass), deps.end());
+			std::sort(deps.begin(), deps.end());
+			deps.erase(std::unique(deps.begin(), deps.end()), deps.end());
+		}
+	}
+
+	//---------------------------------------
+	// 各パスを実行するキューを決める
+	//---------------------------------------
+	void RenderSchedule::AssignQueues(const std::vector<PassDesc>& passes)
+	{
+		const u32 passCount = static_cast<u32>(passes.size());
+		passQueues_.assign(passCount, QueueType::Graphics);
+		prologuePasses_.assign(passCount, kInvalidIndex);
+
+		// 各パスに依存するパスを求める
+		// 依存は必ず前のパスに向かうので、後ろから順に求められる
+		std::vector<std::vector<bool>> isDescendant(passCount, std::vector<bool>(passCount, false));
+		for (u32 pass = passCount; pass > 0; pass--)
+		{
+			u32 p = pass - 1;
+			for (auto d : dependencies_[p])
+			{
+				isDescendant[d][p] = true;
+				for (u32 q = p + 1; q < passCount; q++)
+				{
+					if (isDescendant[p][q])
+					{
+						isDescendant[d][q] = true;
+					}
+				}
+			}
+		}
+
+		// 後ろのパスから決める
+		// 直後にグラフィクスキューで実行されるパスが依存していなければ、並行して実行できる
+		for (u32 pass = passCount; pass > 0; pass--)
+		{
+			u32 p = pass - 1;
+			if (!passes[p].isCompute || !passes[p].allowAsync)
+			{
+				continue;
+			}
+
+			u32 next = p + 1;
+			while ((next < passCount) && (passQueues_[next] != QueueType::Graphics))
+			{
+				next++;
+			}
+			if ((next < passCount) && !isDescendant[p][next])
+			{
+				passQueues_[p] = QueueType::Compute;
+			}
+		}
+
+		// 非同期のパスがグラフィクスキューでバリアを張る必要があるか調べる
+		// このフレームでまだ使われていないか、最後にグラフィクスキューで使われたリソースはグラフィクスキューのステートになっている
+		std::unordered_map<u32, QueueType> lastUsers;
+		u32 lastGraphics = kInvalidIndex;
+		for (u32 p = 0; p < passCount; p++)
+		{
+			auto&& desc = passes[p];
+			if (passQueues_[p] == QueueType::Compute)
+			{
+				// 前にグラフィクスキューのパスがない場合は同期が取れないので、グラフィクスキューで実行する
+				if (lastGraphics == kInvalidIndex)
+				{
+					passQueues_[p] = QueueType::Graphics;
+				}
+				else
+				{
+					bool isPrologueNeeded = false;
+					auto check = [&](const std::vector<u32>& keys)
+					{
+						for (auto key : keys)
+						{
+							auto it = lastUsers.find(key);
+							if ((it == lastUsers.end()) || (it->second == QueueType::Graphics))
+							{
+								isPrologueNeeded = true;
+							}
+						}
+					};
+					check(desc.reads);
+					check(desc.writes);
+					prologuePasses_[p] = isPrologueNeeded ? lastGraphics : kInvalidIndex;
+				}
+			}
+			if (passQueues_[p] == QueueType::Graphics)
+			{
+				lastGraphics = p;
+			}
+
+			for (auto key : desc.reads)
+			{
+				lastUsers[key] = passQueues_[p];
+			}
+			for (auto key : desc.writes)
+			{
+				lastUsers[key] = passQueues_[p];
+			}
+		}
+	}
+
+	//---------------------------------------
+	// パスをバッチにまとめ、キュー間の同期を決める
+	//---------------------------------------
+	void RenderSchedule::BuildBatches()
+	{
+		const u32 passCount = static_cast<u32>(passQueues_.size());
+		const u32 kQueueCount = static_cast<u32>(QueueType::Max);
+
+		Batch openBatches[kQueueCount];
+		bool isOpen[kQueueCount] = {};
+		u32 waitedSeqs[kQueueCount];							// 他のキューのバッチをどこまで待ったか
+		std::vector<u32> seqToBatch[kQueueCount];				// キュー内の順番からバッチ番号への変換
+		std::vector<u32> passSeqs(passCount, kInvalidIndex);
+		for (u32 q = 0; q < kQueueCount; q++)
+		{
+			waitedSeqs[q] = kInvalidIndex;
+		}
+		passBatches_.assign(passCount, kInvalidIndex);
+
+		auto openBatch = [&](QueueType queue)
+		{
+			u32 q = ToIndex(queue);
+			openBatches[q] = Batch{ queue, static_cast<u32>(seqToBatch[q].size()), {}, {}, false };
+			seqToBatch[q].push_back(kInvalidIndex);
+			isOpen[q] = true;
+		};
+		auto closeBatch = [&](QueueType queue)
+		{
+			u32 q = ToIndex(queue);
+			if (!isOpen[q])
+			{
+				return;
+			}
+			u32 index = static_cast<u32>(batches_.size());
+			for (auto p : openBatches[q].passes)
+			{
+				passBatches_[p] = index;
+			}
+			seqToBatch[q][openBatches[q].queueSeq] = index;
+			batches_.push_back(openBatches[q]);
+			isOpen[q] = false;
+		};
+		auto isWaited = [&](QueueType queue, u32 otherSeq)
+		{
+			u32 waited = waitedSeqs[ToIndex(queue)];
+			return (waited != kInvalidIndex) && (otherSeq <= waited);
+		};
+		// 他のキューのバッチを待つ
+		// 待たれるバッチは先に閉じて、実行順で必ず前になるようにする
+		auto waitBatch = [&](QueueType queue, u32 otherSeq)
+		{
+			u32 q = ToIndex(queue);
+			u32 o = ToIndex(OtherQueue(queue));
+			if (isOpen[o] && (openBatches[o].queueSeq == otherSeq))
+			{
+				openBatches[o].signal = true;
+				closeBatch(OtherQueue(queue));
+			}
+			else
+			{
+				batches_[seqToBatch[o][otherSeq]].signal = true;
+			}
+
+			if (isOpen[q] && !openBatches[q].passes.empty())
+			{
+				closeBatch(queue);
+			}
+			if (!isOpen[q])
+			{
+				openBatch(queue);
+			}
+			openBatches[q].waitBatches.push_back(seqToBatch[o][otherSeq]);
+			waitedSeqs[q] = otherSeq;
+		};
+
+		u32 lastGraphics = kInvalidIndex;
+		for (u32 p = 0; p < passCount; p++)
+		{
+			QueueType queue = passQueues_[p];
+			u32 q = ToIndex(queue);
+
+			// 他のキューの依存先のうち、最も後のバッチを待てばよい
+			u32 needSeq = kInvalidIndex;
+			auto require = [&](u32 dep)
+			{
+				if ((dep == kInvalidIndex) || (passQueues_[dep] == queue))
+				{
+					return;
+				}
+				u32 seq = passSeqs[dep];
+				if (!isWaited(queue, seq) && ((needSeq == kInvalidIndex) || (seq > needSeq)))
+				{
+					needSeq = seq;
+				}
+			};
+			for (auto d : dependencies_[p])
+			{
+				require(d);
+			}
+			require(prologuePasses_[p]);
+
+			// 新しいコンピュートのバッチは、前フレームのグラフィクスキューとの順序を保証するため必ずグラフィクスキューを待つ
+			if ((queue == QueueType::Compute) && !isOpen[q])
+			{
+				require(lastGraphics);
+			}
+
+			if (needSeq != kInvalidIndex)
+			{
+				waitBatch(queue, needSeq);
+			}
+			if (!isOpen[q])
+			{
+				openBatch(queue);
+			}
+			openBatches[q].passes.push_back(p);
+			passSeqs[p] = openBatches[q].queueSeq;
+			if (queue == QueueType::Graphics)
+			{
+				lastGraphics = p;
+			}
+		}
+
+		// 最後にすべてのコンピュートキューのバッチを待つ
+		// これによってグラフィクスキューの完了を待てば、フレームのすべての処理が完了している
+		closeBatch(QueueType::Compute);
+		u32 computeCount = static_cast<u32>(seqToBatch[ToIndex(QueueType::Compute)].size());
+		if ((computeCount > 0) && !isWaited(QueueType::Graphics, computeCount - 1))
+		{
+			waitBatch(QueueType::Graphics, computeCount - 1);
+		}
+		if (!isOpen[ToIndex(QueueType::Graphics)] && batches_.empty())
+		{
+			openBatch(QueueType::Graphics);
+		}
+		closeBatch(QueueType::Graphics);
+
+		prologueBatches_.assign(passCount, kInvalidIndex);
+		for (u32 p = 0; p < passCount; p++)
+		{
+			if (prologuePasses_[p] != kInvalidIndex)
+			{
+				prologueBatches_[p] = passBatches_[prologuePasses_[p]];
+			}
+		}
+	}
+
+	//---------------------------------------
+	// 計画を文字列にする
+	//---------------------------------------
+	std::string RenderSchedule::Dump() const
+	{
+		std::string ret;
+		for (u32 p = 0; p < GetPassCount(); p++)
+		{
+			AppendFormat(ret, "Pass %2u : ", p);
+			ret += kQueueNames[ToIndex(passQueues_[p])];
+			AppendFormat(ret, ", Batch %u", passBatches_[p]);
+			if (prologueBatches_[p] != kInvalidIndex)
+			{
+				AppendFormat(ret, ", Prologue %u", prologueBatches_[p]);
+			}
+			ret += ", Deps {";
+			for (auto d : dependencies_[p])
+			{
+				AppendFormat(ret, " %u", d);
+			}
+			ret += " }\n";
+		}
+		for (u32 b = 0; b < GetBatchCount(); b++)
+		{
+			auto&& batch = batches_[b];
+			AppendFormat(ret, "Batch %2u : ", b);
+			ret += kQueueNames[ToIndex(batch.queue)];
+			AppendFormat(ret, " #%u", batch.queueSeq);
+			if (!batch.waitBatches.empty())
+			{
+				ret += ", Wait {";
+				for (auto w : batch.waitBatches)
+				{
+					AppendFormat(ret, " %u", w);
+				}
+				ret += " }";
+			}
+			ret += ", Passes {";
+			for (auto p : batch.passes)
+			{
+				AppendFormat(ret, " %u", p);
+			}
+			ret += " }";
+			if (batch.signal)
+			{
+				ret += ", Signal";
+			}
+			ret += "\n";
+		}
+		return ret;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
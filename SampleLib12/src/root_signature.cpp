@@ -8,23 +8,28 @@ namespace sl12
 	//----
 	bool RootSignature::Initialize(Device* pDev, const RootSignatureDesc& desc)
 	{
-		static const u32 kMaxParameters = 64;
-		D3D12_DESCRIPTOR_RANGE ranges[kMaxParameters];
-		D3D12_ROOT_PARAMETER rootParameters[kMaxParameters];
+		RootSignatureLayout layout;
+		layout.Plan(desc.pParameters, desc.numParameters, desc.packTables);
+		return Initialize(pDev, layout, desc.flags);
+	}
 
-		auto getRangeFunc = [&](u32 index)
-		{
-			static const D3D12_DESCRIPTOR_RANGE_TYPE kType[] = {
-				D3D12_DESCRIPTOR_RANGE_TYPE_CBV,
-				D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
-				D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
-				D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER,
-			};
-			return kType[desc.pParameters[index].type];
+	//----
+	bool RootSignature::Initialize(Device* pDev, const RootSignatureLayout& layout, D3D12_ROOT_SIGNATURE_FLAGS flags)
+	{
+		auto&& srcTables = layout.GetTables();
+		auto&& srcRanges = layout.GetRanges();
+		std::vector<D3D12_DESCRIPTOR_RANGE> ranges(srcRanges.size());
+		std::vector<D3D12_ROOT_PARAMETER> rootParameters(srcTables.size());
+
+		static const D3D12_DESCRIPTOR_RANGE_TYPE kType[] = {
+			D3D12_DESCRIPTOR_RANGE_TYPE_CBV,
+			D3D12_DESCRIPTOR_RANGE_TYPE_SRV,
+			D3D12_DESCRIPTOR_RANGE_TYPE_UAV,
+			D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER,
 		};
-		auto getShaderVisFunc = [&](u32 index)
+		auto getShaderVisFunc = [&](u32 shaderVisibility)
 		{
-			switch (desc.pParameters[index].shaderVisibility)
+			switch (shaderVisibility)
 			{
 			case ShaderVisibility::Vertex: return D3D12_SHADER_VISIBILITY_VERTEX;
 			case ShaderVisibility::Pixel: return D3D12_SHADER_VISIBILITY_PIXEL;
@@ -35,26 +40,28 @@ namespace sl12
 			}
 		};
 
-		for (u32 i = 0; i < desc.numParameters; ++i)
+		for (size_t i = 0; i < srcRanges.size(); ++i)
+		{
+			ranges[i].RangeType = kType[srcRanges[i].type];
+			ranges[i].NumDescriptors = srcRanges[i].numDescriptors;
+			ranges[i].BaseShaderRegister = srcRanges[i].baseRegister;
+			ranges[i].RegisterSpace = srcRanges[i].registerSpace;
+			ranges[i].OffsetInDescriptorsFromTableStart = srcRanges[i].offsetInTable;
+		}
+		for (size_t i = 0; i < srcTables.size(); ++i)
 		{
-			ranges[i].RangeType = getRangeFunc(i);
-			ranges[i].NumDescriptors = 1;
-			ranges[i].BaseShaderRegister = desc.pParameters[i].registerIndex;
-			ranges[i].RegisterSpace = 0;
-			ranges[i].OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
-
 			rootParameters[i].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
-			rootParameters[i].DescriptorTable.NumDescriptorRanges = 1;
-			rootParameters[i].DescriptorTable.pDescriptorRanges = &ranges[i];
-			rootParameters[i].ShaderVisibility = getShaderVisFunc(i);
+			rootParameters[i].DescriptorTable.NumDescriptorRanges = srcTables[i].numRanges;
+			rootParameters[i].DescriptorTable.pDescriptorRanges = ranges.data() + srcTables[i].firstRange;
+			rootParameters[i].ShaderVisibility = getShaderVisFunc(srcTables[i].shaderVisibility);
 		}
 
 		D3D12_ROOT_SIGNATURE_DESC rd{};
-		rd.NumParameters = desc.numParameters;
-		rd.pParameters = rootParameters;
+		rd.NumParameters = static_cast<UINT>(rootParameters.size());
+		rd.pParameters = rootParameters.data();
 		rd.NumStaticSamplers = 0;
 		rd.pStaticSamplers = nullptr;
-		rd.Flags = desc.flags;
+		rd.Flags = flags;
 
 		ID3DBlob* pSignature{ nullptr };
 		ID3DBlob* pError{ nullptr };
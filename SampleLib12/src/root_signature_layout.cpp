@@ -0,0 +1,92 @@
+﻿#include <sl12/root_signature_layout.h>
+
+#include <algorithm>
+
+
+namespace sl12
+{
+	//----
+	void RootSignatureLayout::Plan(const RootParameter* pParams, u32 numParams, bool packTables)
+	{
+		tables_.clear();
+		ranges_.clear();
+		locations_.assign(numParams, Location());
+
+		if (!packTables)
+		{
+			// 1パラメータ1テーブル
+			for (u32 i = 0; i < numParams; ++i)
+			{
+				auto&& param = pParams[i];
+
+				Range range{ param.type, param.registerIndex, param.registerSpace, 1, 0 };
+				Table table{ param.type, param.shaderVisibility, static_cast<u32>(ranges_.size()), 1, 1 };
+				locations_[i] = Location{ static_cast<u32>(tables_.size()), 0 };
+				ranges_.push_back(range);
+				tables_.push_back(table);
+			}
+			return;
+		}
+
+		// タイプ、レジスタスペース、可視性、レジスタ番号の順に並べる
+		// 可視性が異なるものは同じレジスタ番号を別のリソースに使うことがあるので別テーブルとする
+		std::vector<u32> order(numParams);
+		for (u32 i = 0; i < numParams; ++i)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](u32 l, u32 r)
+		{
+			auto&& pl = pParams[l];
+			auto&& pr = pParams[r];
+			if (pl.type != pr.type) return pl.type < pr.type;
+			if (pl.registerSpace != pr.registerSpace) return pl.registerSpace < pr.registerSpace;
+			if (pl.shaderVisibility != pr.shaderVisibility) return pl.shaderVisibility < pr.shaderVisibility;
+			return pl.registerIndex < pr.registerIndex;
+		});
+
+		const RootParameter* pPrev = nullptr;
+		u32 prevIndex = 0;
+		for (auto index : order)
+		{
+			auto&& param = pParams[index];
+			bool isNewTable = !pPrev
+				|| (pPrev->type != param.type)
+				|| (pPrev->registerSpace != param.registerSpace)
+				|| (pPrev->shaderVisibility != param.shaderVisibility);
+			if (isNewTable)
+			{
+				Table table{ param.type, param.shaderVisibility, static_cast<u32>(ranges_.size()), 0, 0 };
+				tables_.push_back(table);
+			}
+
+			auto&& table = tables_.back();
+			if (!isNewTable && pPrev->registerIndex == param.registerIndex)
+			{
+				// 同じレジスタは同じデスクリプタを参照する
+				locations_[index] = locations_[prevIndex];
+				pPrev = &param;
+				prevIndex = index;
+				continue;
+			}
+
+			if (isNewTable || pPrev->registerIndex + 1 != param.registerIndex)
+			{
+				// レジスタが連続していない場合は新しいレンジ
+				Range range{ param.type, param.registerIndex, param.registerSpace, 0, table.numDescriptors };
+				ranges_.push_back(range);
+				table.numRanges++;
+			}
+
+			locations_[index] = Location{ static_cast<u32>(tables_.size() - 1), table.numDescriptors };
+			ranges_.back().numDescriptors++;
+			table.numDescriptors++;
+			pPrev = &param;
+			prevIndex = index;
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -3,6 +3,7 @@
 #include <d3dcompiler.h>
 #include <sl12/crc.h>
 #include <sl12/descriptor.h>
+#include <algorithm>
 
 
 namespace sl12
@@ -14,125 +15,101 @@ namespace sl12
 	{
 		if (pInstance_)
 		{
-			pManager_->ReleaseRootSignature(crc_, pInstance_);
+			pManager_->ReleaseRootSignature(hash_, pInstance_);
 			pManager_ = nullptr;
 			pInstance_ = nullptr;
 		}
 	}
 
 	//-------------------------------------------------
-	// CBVデスクリプタを設定する
+	// 名前からバインドスロットを検索する
 	//-------------------------------------------------
-	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const char* name, ConstantBufferView& cbv)
+	BindingSlot RootSignatureHandle::FindSlot(const BindingName& name) const
 	{
 		assert(IsValid());
-
-		auto it = pInstance_->slotMap_.find(name);
-		auto isGraphics = pInstance_->isGraphics_;
-		if (it != pInstance_->slotMap_.end())
-		{
-			for (auto index : it->second)
-			{
-				if (isGraphics)
-					cmdList.GetCommandList()->SetGraphicsRootDescriptorTable(index, cbv.GetDesc()->GetGpuHandle());
-				else
-					cmdList.GetCommandList()->SetComputeRootDescriptorTable(index, cbv.GetDesc()->GetGpuHandle());
-			}
-			return true;
-		}
-		return false;
+		return pInstance_->bindings_.Find(name);
 	}
 
 	//-------------------------------------------------
-	// テクスチャSRVデスクリプタを設定する
+	// デスクリプタテーブルを設定する
 	//-------------------------------------------------
-	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const char* name, TextureView& srv)
+	bool RootSignatureHandle::SetDescriptorTable(CommandList& cmdList, BindingSlot slot, D3D12_GPU_DESCRIPTOR_HANDLE handle)
 	{
 		assert(IsValid());
 
-		auto it = pInstance_->slotMap_.find(name);
-		auto isGraphics = pInstance_->isGraphics_;
-		if (it != pInstance_->slotMap_.end())
+		if (!slot.IsValid())
 		{
-			for (auto index : it->second)
-			{
-				if (isGraphics)
-					cmdList.GetCommandList()->SetGraphicsRootDescriptorTable(index, srv.GetDesc()->GetGpuHandle());
-				else
-					cmdList.GetCommandList()->SetComputeRootDescriptorTable(index, srv.GetDesc()->GetGpuHandle());
-			}
-			return true;
+			return false;
 		}
-		return false;
-	}
+		assert(slot.index < pInstance_->bindings_.GetNumSlots());
 
-	//-------------------------------------------------
-	// バッファSRVデスクリプタを設定する
-	//-------------------------------------------------
-	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const char* name, BufferView& srv)
-	{
-		assert(IsValid());
-
-		auto it = pInstance_->slotMap_.find(name);
-		auto isGraphics = pInstance_->isGraphics_;
-		if (it != pInstance_->slotMap_.end())
+		u32 numTargets;
+		const BindingTable::Target* pTargets = pInstance_->bindings_.GetTargets(slot, &numTargets);
+		auto&& tables = pInstance_->layout_.GetTables();
+		auto pNativeList = cmdList.GetCommandList();
+		for (u32 i = 0; i < numTargets; ++i)
 		{
-			for (auto index : it->second)
+			// 複数のデスクリプタを持つテーブルは直接設定できない
+			if (tables[pTargets[i].rootIndex].numDescriptors != 1)
 			{
-				if (isGraphics)
-					cmdList.GetCommandList()->SetGraphicsRootDescriptorTable(index, srv.GetDesc()->GetGpuHandle());
-				else
-					cmdList.GetCommandList()->SetComputeRootDescriptorTable(index, srv.GetDesc()->GetGpuHandle());
+				return false;
 			}
-			return true;
+
+			if (pInstance_->isGraphics_)
+				pNativeList->SetGraphicsRootDescriptorTable(pTargets[i].rootIndex, handle);
+			else
+				pNativeList->SetComputeRootDescriptorTable(pTargets[i].rootIndex, handle);
 		}
-		return false;
+		return true;
 	}
 
+
 	//-------------------------------------------------
-	// サンプラーデスクリプタを設定する
+	// 名前を解決してデスクリプタを設定する
 	//-------------------------------------------------
-	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const char* name, Sampler& sam)
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const BindingName& name, ConstantBufferView& cbv)
 	{
-		assert(IsValid());
-
-		auto it = pInstance_->slotMap_.find(name);
-		auto isGraphics = pInstance_->isGraphics_;
-		if (it != pInstance_->slotMap_.end())
-		{
-			for (auto index : it->second)
-			{
-				if (isGraphics)
-					cmdList.GetCommandList()->SetGraphicsRootDescriptorTable(index, sam.GetDesc()->GetGpuHandle());
-				else
-					cmdList.GetCommandList()->SetComputeRootDescriptorTable(index, sam.GetDesc()->GetGpuHandle());
-			}
-			return true;
-		}
-		return false;
+		return SetDescriptorTable(cmdList, FindSlot(name), cbv.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const BindingName& name, TextureView& srv)
+	{
+		return SetDescriptorTable(cmdList, FindSlot(name), srv.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const BindingName& name, BufferView& srv)
+	{
+		return SetDescriptorTable(cmdList, FindSlot(name), srv.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const BindingName& name, Sampler& sam)
+	{
+		return SetDescriptorTable(cmdList, FindSlot(name), sam.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const BindingName& name, UnorderedAccessView& uav)
+	{
+		return SetDescriptorTable(cmdList, FindSlot(name), uav.GetDesc()->GetGpuHandle());
 	}
 
 	//-------------------------------------------------
-	// UAVデスクリプタを設定する
+	// 解決済みのスロットにデスクリプタを設定する
 	//-------------------------------------------------
-	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, const char* name, UnorderedAccessView& uav)
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, BindingSlot slot, ConstantBufferView& cbv)
 	{
-		assert(IsValid());
-
-		auto it = pInstance_->slotMap_.find(name);
-		auto isGraphics = pInstance_->isGraphics_;
-		if (it != pInstance_->slotMap_.end())
-		{
-			for (auto index : it->second)
-			{
-				if (isGraphics)
-					cmdList.GetCommandList()->SetGraphicsRootDescriptorTable(index, uav.GetDesc()->GetGpuHandle());
-				else
-					cmdList.GetCommandList()->SetComputeRootDescriptorTable(index, uav.GetDesc()->GetGpuHandle());
-			}
-			return true;
-		}
-		return false;
+		return SetDescriptorTable(cmdList, slot, cbv.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, BindingSlot slot, TextureView& srv)
+	{
+		return SetDescriptorTable(cmdList, slot, srv.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, BindingSlot slot, BufferView& srv)
+	{
+		return SetDescriptorTable(cmdList, slot, srv.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, BindingSlot slot, Sampler& sam)
+	{
+		return SetDescriptorTable(cmdList, slot, sam.GetDesc()->GetGpuHandle());
+	}
+	bool RootSignatureHandle::SetDescriptor(CommandList& cmdList, BindingSlot slot, UnorderedAccessView& uav)
+	{
+		return SetDescriptorTable(cmdList, slot, uav.GetDesc()->GetGpuHandle());
 	}
 
 
@@ -163,31 +140,46 @@ namespace sl12
 	//-------------------------------------------------
 	RootSignatureHandle RootSignatureManager::CreateRootSignature(const RootSignatureCreateDesc& desc)
 	{
-		// シェーダからCRC32を計算する
-		u32 crc;
+		// 各ステージのシェーダ
+		// コンピュートシェーダが指定されている場合は他のステージを無視する
+		const Shader* pShaders[ShaderType::Max] = {};
 		if (desc.pCS)
 		{
-			// コンピュートシェーダ
-			crc = CalcCrc32(desc.pCS->GetData(), desc.pCS->GetSize());
+			pShaders[ShaderType::Compute] = desc.pCS;
 		}
 		else
 		{
-			// ラスタライザ
-			u8 zero = 0;
-			crc = desc.pVS != nullptr ? CalcCrc32(desc.pVS->GetData(), desc.pVS->GetSize()) : CalcCrc32(&zero, sizeof(zero));
-			crc = desc.pPS != nullptr ? CalcCrc32(desc.pPS->GetData(), desc.pPS->GetSize(), crc) : CalcCrc32(&zero, sizeof(zero), crc);
-			crc = desc.pGS != nullptr ? CalcCrc32(desc.pGS->GetData(), desc.pGS->GetSize(), crc) : CalcCrc32(&zero, sizeof(zero), crc);
-			crc = desc.pDS != nullptr ? CalcCrc32(desc.pDS->GetData(), desc.pDS->GetSize(), crc) : CalcCrc32(&zero, sizeof(zero), crc);
-			crc = desc.pHS != nullptr ? CalcCrc32(desc.pHS->GetData(), desc.pHS->GetSize(), crc) : CalcCrc32(&zero, sizeof(zero), crc);
+			pShaders[ShaderType::Vertex] = desc.pVS;
+			pShaders[ShaderType::Pixel] = desc.pPS;
+			pShaders[ShaderType::Geometry] = desc.pGS;
+			pShaders[ShaderType::Domain] = desc.pDS;
+			pShaders[ShaderType::Hull] = desc.pHS;
+		}
+
+		// シェーダが保持しているハッシュを組み合わせてキーとする
+		ShaderCodeRef codes[ShaderType::Max];
+		for (int i = 0; i < ShaderType::Max; ++i)
+		{
+			if (pShaders[i])
+			{
+				codes[i].pData = pShaders[i]->GetData();
+				codes[i].size = pShaders[i]->GetSize();
+				codes[i].hash = pShaders[i]->GetHash();
+			}
 		}
+		const u32 variant = desc.packTables ? 1 : 0;
+		u64 hash = ShaderSetKey::CalcHash(codes, ShaderType::Max, variant);
 
-		// CRCから生成済みルートシグネチャを検索する
-		// CRCの衝突は起きないことを祈る
-		auto it = instanceMap_.find(crc);
-		if (it != instanceMap_.end())
+		// ハッシュから生成済みルートシグネチャを検索する
+		// キーが一致した場合もバイトコードを比較し、衝突した場合は別インスタンスとする
+		auto range = instanceMap_.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
 		{
-			// 見つかった
-			return RootSignatureHandle(this, it->first, it->second);
+			if (it->second->key_.IsSame(codes, ShaderType::Max, variant))
+			{
+				// 見つかった
+				return RootSignatureHandle(this, it->first, it->second);
+			}
 		}
 
 		std::vector<RootParameter> rootParams;
@@ -249,7 +241,7 @@ namespace sl12
 							// 同名のリソースは同一タイプのみを許容
 							return false;
 						}
-						if (param.registerIndex == bd.BindPoint)
+						if (param.registerIndex == bd.BindPoint && param.registerSpace == bd.Space)
 						{
 							param.shaderVisibility |= shaderVisibility;
 							isStored = true;
@@ -262,6 +254,7 @@ namespace sl12
 						param.type = paramType;
 						param.shaderVisibility = shaderVisibility;
 						param.registerIndex = bd.BindPoint;
+						param.registerSpace = bd.Space;
 						findIt->second.push_back((int)rootParams.size());
 						rootParams.push_back(param);
 					}
@@ -273,6 +266,7 @@ namespace sl12
 					param.type = paramType;
 					param.shaderVisibility = shaderVisibility;
 					param.registerIndex = bd.BindPoint;
+					param.registerSpace = bd.Space;
 
 					std::vector<int> indices;
 					indices.push_back((int)rootParams.size());
@@ -320,30 +314,45 @@ namespace sl12
 		// 新規ルートシグネチャを生成する
 		RootSignatureInstance* pNewInstance = new RootSignatureInstance();
 		pNewInstance->isGraphics_ = isGraphics;
-		pNewInstance->slotMap_ = paramMap;
+		pNewInstance->layout_.Plan(rootParams.data(), (u32)rootParams.size(), desc.packTables);
+		auto&& locations = pNewInstance->layout_.GetLocations();
+
+		// 名前をハッシュ順の連番スロットに変換する
+		// 同じハッシュの名前が複数ある場合は名前順に並べる
+		std::vector<BindingTable::Target> targets;
+		for (auto&& v : paramMap)
+		{
+			targets.clear();
+			for (auto index : v.second)
+			{
+				BindingTable::Target target = { locations[index].tableIndex, locations[index].offsetInTable };
+				targets.push_back(target);
+			}
+			pNewInstance->bindings_.Add(v.first, targets.data(), (u32)targets.size());
+		}
+		pNewInstance->bindings_.Finalize();
+		pNewInstance->key_.Store(codes, ShaderType::Max, variant);
 
 		RootSignatureDesc rsDesc;
-		rsDesc.numParameters = (u32)rootParams.size();
-		rsDesc.pParameters = rootParams.data();
-		if (!pNewInstance->rootSig_.Initialize(pDevice_, rsDesc))
+		if (!pNewInstance->rootSig_.Initialize(pDevice_, pNewInstance->layout_, rsDesc.flags))
 		{
 			delete pNewInstance;
 			return RootSignatureHandle(nullptr, 0, nullptr);
 		}
 
 		// マップに登録
-		instanceMap_[crc] = pNewInstance;
+		instanceMap_.insert(InstanceMap::value_type(hash, pNewInstance));
 
-		return RootSignatureHandle(this, crc, pNewInstance);
+		return RootSignatureHandle(this, hash, pNewInstance);
 	}
 
 	//-------------------------------------------------
 	// ルートシグネチャを解放する
 	//-------------------------------------------------
-	void RootSignatureManager::ReleaseRootSignature(u32 crc, RootSignatureInstance* pInst)
+	void RootSignatureManager::ReleaseRootSignature(u64 hash, RootSignatureInstance* pInst)
 	{
-		auto findIt = instanceMap_.find(crc);
-		if (findIt != instanceMap_.end())
+		auto range = instanceMap_.equal_range(hash);
+		for (auto findIt = range.first; findIt != range.second; ++findIt)
 		{
 			if (findIt->second == pInst)
 			{
@@ -353,10 +362,109 @@ namespace sl12
 					delete pInst;
 					instanceMap_.erase(findIt);
 				}
+				break;
 			}
 		}
 	}
 
+
+	//-------------------------------------------------
+	// ルートシグネチャに合わせて初期化する
+	//-------------------------------------------------
+	void DescriptorSet::Initialize(RootSignatureHandle& handle)
+	{
+		assert(handle.IsValid());
+
+		handle_.Invalid();
+		handle_ = handle;
+
+		auto&& tables = handle.pInstance_->layout_.GetTables();
+		tableOffsets_.resize(tables.size());
+		u32 total = 0;
+		for (size_t i = 0; i < tables.size(); ++i)
+		{
+			tableOffsets_[i] = total;
+			total += tables[i].numDescriptors;
+		}
+		handles_.resize(total);
+		Reset();
+	}
+
+	//-------------------------------------------------
+	// ルートシグネチャの参照を解放する
+	//-------------------------------------------------
+	void DescriptorSet::Destroy()
+	{
+		handle_.Invalid();
+		tableOffsets_.clear();
+		handles_.clear();
+	}
+
+	//-------------------------------------------------
+	// 設定したデスクリプタをすべて未設定に戻す
+	//-------------------------------------------------
+	void DescriptorSet::Reset()
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE null = {};
+		std::fill(handles_.begin(), handles_.end(), null);
+	}
+
+	//-------------------------------------------------
+	// デスクリプタを設定する
+	//-------------------------------------------------
+	bool DescriptorSet::SetHandle(BindingSlot slot, D3D12_CPU_DESCRIPTOR_HANDLE handle)
+	{
+		assert(handle_.IsValid());
+
+		if (!slot.IsValid())
+		{
+			return false;
+		}
+
+		RootSignatureInstance* pInstance = handle_.pInstance_;
+		assert(slot.index < pInstance->bindings_.GetNumSlots());
+
+		u32 numTargets;
+		const BindingTable::Target* pTargets = pInstance->bindings_.GetTargets(slot, &numTargets);
+		for (u32 i = 0; i < numTargets; ++i)
+		{
+			handles_[tableOffsets_[pTargets[i].rootIndex] + pTargets[i].offsetInTable] = handle;
+		}
+		return true;
+	}
+
+	//-------------------------------------------------
+	// ステージング領域にコピーしてテーブルを設定する
+	//-------------------------------------------------
+	bool DescriptorSet::Bind(CommandList& cmdList, DescriptorStaging* pViewStaging, DescriptorStaging* pSamplerStaging)
+	{
+		assert(handle_.IsValid());
+
+		RootSignatureInstance* pInstance = handle_.pInstance_;
+		auto&& tables = pInstance->layout_.GetTables();
+		auto pNativeList = cmdList.GetCommandList();
+		for (u32 i = 0; i < (u32)tables.size(); ++i)
+		{
+			DescriptorStaging* pStaging = (tables[i].type == RootParameterType::Sampler) ? pSamplerStaging : pViewStaging;
+			if (!pStaging)
+			{
+				return false;
+			}
+
+			D3D12_GPU_DESCRIPTOR_HANDLE gpuHandle;
+			if (!pStaging->Stage(handles_.data() + tableOffsets_[i], tables[i].numDescriptors, &gpuHandle))
+			{
+				return false;
+			}
+
+			if (pInstance->isGraphics_)
+				pNativeList->SetGraphicsRootDescriptorTable(i, gpuHandle);
+			else
+				pNativeList->SetComputeRootDescriptorTable(i, gpuHandle);
+		}
+		return true;
+	}
+
 }	// namespace sl12
 
 
@@ -15,7 +15,8 @@ namespace sl12
 			return false;
 		}
 
-		pDev->GetDeviceDep()->CreateSampler(&desc, pDesc_->GetCpuHandle());
+		pDev->GetDeviceDep()->CreateSampler(&desc, pDesc_->GetCpuCopySourceHandle());
+		pDesc_->Commit();
 
 		samplerDesc_ = desc;
 
@@ -0,0 +1,143 @@
+﻿#include <sl12/scheduled_command_lists.h>
+
+#include <sl12/device.h>
+#include <sl12/command_queue.h>
+
+
+namespace sl12
+{
+	namespace
+	{
+		CommandQueue* GetQueue(Device* pDev, QueueType type)
+		{
+			return (type == QueueType::Compute) ? &pDev->GetComputeQueue() : &pDev->GetGraphicsQueue();
+		}
+	}
+
+	//----
+	bool ScheduledCommandLists::Initialize(Device* pDev, u32 frameCount)
+	{
+		pDevice_ = pDev;
+		frames_.resize(frameCount);
+		for (u32 q = 0; q < kQueueCount; q++)
+		{
+			if (!fences_[q].Initialize(pDev))
+			{
+				return false;
+			}
+			fenceValues_[q] = 0;
+		}
+		return true;
+	}
+
+	//----
+	void ScheduledCommandLists::Destroy()
+	{
+		for (auto&& frame : frames_)
+		{
+			for (auto&& lists : frame.cmdLists)
+			{
+				for (auto&& p : lists)
+				{
+					delete p;
+				}
+				lists.clear();
+			}
+		}
+		frames_.clear();
+		for (auto&& f : fences_)
+		{
+			f.Destroy();
+		}
+		pDevice_ = nullptr;
+	}
+
+	//----
+	void ScheduledCommandLists::Begin(const RenderSchedule& schedule, u32 frameIndex)
+	{
+		assert(frameIndex < frames_.size());
+		currentFrame_ = frameIndex;
+
+		auto&& frame = frames_[frameIndex];
+		u32 listCounts[kQueueCount]{};
+		frame.batches.resize(schedule.GetBatchCount());
+		for (u32 i = 0; i < schedule.GetBatchCount(); i++)
+		{
+			auto&& src = schedule.GetBatch(i);
+			auto&& dst = frame.batches[i];
+			u32 q = static_cast<u32>(src.queue);
+
+			// 足りないコマンドリストは追加する
+			auto&& lists = frame.cmdLists[q];
+			if (listCounts[q] == lists.size())
+			{
+				auto p = new CommandList();
+				bool isInit = p->Initialize(pDevice_, GetQueue(pDevice_, src.queue));
+				assert(isInit);
+				lists.push_back(p);
+			}
+
+			dst.queue = src.queue;
+			dst.pCmdList = lists[listCounts[q]++];
+			dst.waitBatches = src.waitBatches;
+			dst.signal = src.signal;
+			dst.pCmdList->Reset();
+		}
+
+		frame.passBatches.resize(schedule.GetPassCount());
+		frame.prologueBatches.resize(schedule.GetPassCount());
+		for (u32 i = 0; i < schedule.GetPassCount(); i++)
+		{
+			frame.passBatches[i] = schedule.GetPassBatch(i);
+			frame.prologueBatches[i] = schedule.GetPrologueBatch(i);
+		}
+		frame.signalValues.assign(frame.batches.size(), 0);
+	}
+
+	//----
+	void ScheduledCommandLists::Close()
+	{
+		for (auto&& batch : frames_[currentFrame_].batches)
+		{
+			batch.pCmdList->Close();
+		}
+	}
+
+	//----
+	void ScheduledCommandLists::Execute(u32 frameIndex)
+	{
+		auto&& frame = frames_[frameIndex];
+		for (u32 i = 0; i < (u32)frame.batches.size(); i++)
+		{
+			auto&& batch = frame.batches[i];
+			auto pQueue = batch.pCmdList->GetParentQueue();
+
+			// 待つバッチは必ず先に実行されているので、シグナルの値は決まっている
+			for (auto w : batch.waitBatches)
+			{
+				u32 q = static_cast<u32>(frame.batches[w].queue);
+				fences_[q].WaitSignal(pQueue, frame.signalValues[w]);
+			}
+
+			batch.pCmdList->Execute();
+
+			if (batch.signal)
+			{
+				u32 q = static_cast<u32>(batch.queue);
+				frame.signalValues[i] = ++fenceValues_[q];
+				fences_[q].Signal(pQueue, frame.signalValues[i]);
+			}
+		}
+	}
+
+	//----
+	CommandList* ScheduledCommandLists::GetPrologueCommandList(u32 pass)
+	{
+		auto&& frame = frames_[currentFrame_];
+		u32 batch = frame.prologueBatches[pass];
+		return (batch != RenderSchedule::kInvalidIndex) ? frame.batches[batch].pCmdList : nullptr;
+	}
+
+}	// namespace sl12
+
+//	EOF
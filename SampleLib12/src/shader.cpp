@@ -2,6 +2,7 @@
 
 #include <sl12/device.h>
 #include <sl12/file.h>
+#include <sl12/crc.h>
 
 
 namespace sl12
@@ -39,6 +40,7 @@ namespace sl12
 		memcpy(pData_, pData, size);
 
 		size_ = size;
+		hash_ = CalcHash64(pData_, size_);
 		shaderType_ = type;
 
 		return true;
@@ -48,6 +50,8 @@ namespace sl12
 	void Shader::Destroy()
 	{
 		sl12::SafeDeleteArray(pData_);
+		size_ = 0;
+		hash_ = 0;
 	}
 
 }	// namespace sl12
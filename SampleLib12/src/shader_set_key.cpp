@@ -0,0 +1,76 @@
+﻿#include <sl12/shader_set_key.h>
+
+#include <sl12/crc.h>
+#include <string.h>
+
+
+namespace sl12
+{
+	//----
+	u64 ShaderSetKey::CalcHash(const ShaderCodeRef* pCodes, u32 numCodes, u32 variant)
+	{
+		// シェーダが保持しているハッシュを組み合わせる
+		// バイトコードの再計算は行わない
+		std::vector<u64> hashes(numCodes);
+		for (u32 i = 0; i < numCodes; ++i)
+		{
+			hashes[i] = pCodes[i].pData ? pCodes[i].hash : 0;
+		}
+		return CalcHash64(hashes.data(), hashes.size() * sizeof(u64), variant);
+	}
+
+	//----
+	void ShaderSetKey::Store(const ShaderCodeRef* pCodes, u32 numCodes, u32 variant)
+	{
+		stages_.clear();
+		stages_.resize(numCodes);
+		for (u32 i = 0; i < numCodes; ++i)
+		{
+			if (pCodes[i].pData)
+			{
+				const u8* p = static_cast<const u8*>(pCodes[i].pData);
+				stages_[i].hash = pCodes[i].hash;
+				stages_[i].code.assign(p, p + pCodes[i].size);
+				stages_[i].isUsed = true;
+			}
+		}
+		variant_ = variant;
+	}
+
+	//----
+	bool ShaderSetKey::IsSame(const ShaderCodeRef* pCodes, u32 numCodes, u32 variant) const
+	{
+		if (variant_ != variant || stages_.size() != numCodes)
+		{
+			return false;
+		}
+
+		// ハッシュとサイズで先に判定し、一致した場合のみバイトコードを比較する
+		for (u32 i = 0; i < numCodes; ++i)
+		{
+			auto&& stage = stages_[i];
+			bool isUsed = (pCodes[i].pData != nullptr);
+			if (stage.isUsed != isUsed)
+			{
+				return false;
+			}
+			if (isUsed && (stage.hash != pCodes[i].hash || stage.code.size() != pCodes[i].size))
+			{
+				return false;
+			}
+		}
+		for (u32 i = 0; i < numCodes; ++i)
+		{
+			auto&& stage = stages_[i];
+			if (stage.isUsed && !stage.code.empty() && memcmp(stage.code.data(), pCodes[i].pData, stage.code.size()) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -4,12 +4,13 @@
 #include <sl12/command_list.h>
 #include <sl12/fence.h>
 #include <sl12/swapchain.h>
+#include <sl12/upload_manager.h>
 
 
 namespace sl12
 {
 	//----
-	bool Texture::Initialize(Device* pDev, const TextureDesc& desc)
+	D3D12_CLEAR_VALUE* Texture::SetupResourceDesc(const TextureDesc& desc)
 	{
 		const D3D12_RESOURCE_DIMENSION kDimensionTable[] = {
 			D3D12_RESOURCE_DIMENSION_TEXTURE1D,
@@ -17,15 +18,6 @@ namespace sl12
 			D3D12_RESOURCE_DIMENSION_TEXTURE3D,
 		};
 
-		D3D12_HEAP_PROPERTIES prop{};
-		prop.Type = D3D12_HEAP_TYPE_DEFAULT;
-		prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
-		prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
-		prop.CreationNodeMask = 1;
-		prop.VisibleNodeMask = 1;
-
-		D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_NONE;
-
 		resourceDesc_.Dimension = kDimensionTable[desc.dimension];
 		resourceDesc_.Alignment = 0;
 		resourceDesc_.Width = desc.width;
@@ -56,7 +48,6 @@ namespace sl12
 		currentState_ = desc.initialState;
 
 		D3D12_CLEAR_VALUE* pClearValue = nullptr;
-		D3D12_CLEAR_VALUE clearValue{};
 		if (desc.isRenderTarget)
 		{
 			pClearValue = &clearValue_;
@@ -82,6 +73,23 @@ namespace sl12
 				currentState_ = D3D12_RESOURCE_STATE_COPY_DEST;
 		}
 
+		return pClearValue;
+	}
+
+	//----
+	bool Texture::Initialize(Device* pDev, const TextureDesc& desc)
+	{
+		D3D12_HEAP_PROPERTIES prop{};
+		prop.Type = D3D12_HEAP_TYPE_DEFAULT;
+		prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+		prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+		prop.CreationNodeMask = 1;
+		prop.VisibleNodeMask = 1;
+
+		D3D12_HEAP_FLAGS flags = D3D12_HEAP_FLAG_NONE;
+
+		D3D12_CLEAR_VALUE* pClearValue = SetupResourceDesc(desc);
+
 		auto hr = pDev->GetDeviceDep()->CreateCommittedResource(&prop, flags, &resourceDesc_, currentState_, pClearValue, IID_PPV_ARGS(&pResource_));
 		if (FAILED(hr))
 		{
@@ -93,6 +101,30 @@ namespace sl12
 		return true;
 	}
 
+	//----
+	bool Texture::InitializePlaced(Device* pDev, const TextureDesc& desc, ID3D12Heap* pHeap, u64 heapOffset)
+	{
+		D3D12_CLEAR_VALUE* pClearValue = SetupResourceDesc(desc);
+
+		auto hr = pDev->GetDeviceDep()->CreatePlacedResource(pHeap, heapOffset, &resourceDesc_, currentState_, pClearValue, IID_PPV_ARGS(&pResource_));
+		if (FAILED(hr))
+		{
+			return false;
+		}
+
+		textureDesc_ = desc;
+
+		return true;
+	}
+
+	//----
+	D3D12_RESOURCE_ALLOCATION_INFO Texture::GetAllocationInfo(Device* pDev, const TextureDesc& desc)
+	{
+		Texture tmp;
+		tmp.SetupResourceDesc(desc);
+		return pDev->GetDeviceDep()->GetResourceAllocationInfo(0, 1, &tmp.resourceDesc_);
+	}
+
 	//----
 	bool Texture::InitializeFromDXImage(Device* pDev, const DirectX::ScratchImage& image, bool isForceSRGB)
 	{
@@ -274,6 +306,66 @@ namespace sl12
 		return true;
 	}
 
+	//----
+	bool Texture::InitializeFromTGA(Device* pDev, UploadManager* pUploader, const void* pTgaBin, size_t size, bool isForceSRGB)
+	{
+		if (!pDev || !pUploader)
+		{
+			return false;
+		}
+		if (!pTgaBin || !size)
+		{
+			return false;
+		}
+
+		// TGAファイルフォーマットからイメージリソースを作成
+		DirectX::ScratchImage image;
+		auto hr = DirectX::LoadFromTGAMemory(pTgaBin, size, nullptr, image);
+		if (FAILED(hr))
+		{
+			return false;
+		}
+
+		// D3D12リソースを作成
+		if (!InitializeFromDXImage(pDev, image, isForceSRGB))
+		{
+			return false;
+		}
+
+		// コピー命令を登録、完了待ちはアップロードマネージャ側で行う
+		return UpdateImage(pUploader, image);
+	}
+
+	//----
+	bool Texture::InitializeFromPNG(Device* pDev, UploadManager* pUploader, const void* pPngBin, size_t size, bool isForceSRGB)
+	{
+		if (!pDev || !pUploader)
+		{
+			return false;
+		}
+		if (!pPngBin || !size)
+		{
+			return false;
+		}
+
+		// PNGファイルフォーマットからイメージリソースを作成
+		DirectX::ScratchImage image;
+		auto hr = DirectX::LoadFromWICMemory(pPngBin, size, DirectX::WIC_FLAGS_NONE, nullptr, image);
+		if (FAILED(hr))
+		{
+			return false;
+		}
+
+		// D3D12リソースを作成
+		if (!InitializeFromDXImage(pDev, image, isForceSRGB))
+		{
+			return false;
+		}
+
+		// コピー命令を登録、完了待ちはアップロードマネージャ側で行う
+		return UpdateImage(pUploader, image);
+	}
+
 	//----
 	bool Texture::InitializeFromImageBin(Device* pDev, CommandList* pCmdList, const TextureDesc& desc, const void* pImageBin)
 	{
@@ -432,7 +524,7 @@ namespace sl12
 			dst.pResource = pResource_;
 			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
 			dst.SubresourceIndex = i;
-			pCmdList->GetCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			pCmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
 		}
 
 		*ppSrcImage = pSrcImage;
@@ -516,7 +608,7 @@ namespace sl12
 			dst.pResource = pResource_;
 			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
 			dst.SubresourceIndex = i;
-			pCmdList->GetCommandList()->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+			pCmdList->CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
 		}
 
 		*ppSrcImage = pSrcImage;
@@ -524,6 +616,26 @@ namespace sl12
 		return true;
 	}
 
+	//----
+	bool Texture::UpdateImage(UploadManager* pUploader, const DirectX::ScratchImage& image)
+	{
+		if (!pUploader)
+		{
+			return false;
+		}
+		return pUploader->EnqueueTexture(this, image);
+	}
+
+	//----
+	bool Texture::UpdateImage(UploadManager* pUploader, const void* pImageBin)
+	{
+		if (!pUploader)
+		{
+			return false;
+		}
+		return pUploader->EnqueueTexture(this, pImageBin);
+	}
+
 	//----
 	void Texture::Destroy()
 	{
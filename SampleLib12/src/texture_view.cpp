@@ -116,7 +116,8 @@ namespace sl12
 			return false;
 		}
 
-		pDev->GetDeviceDep()->CreateShaderResourceView(pTex->GetResourceDep(), &viewDesc, pDesc_->GetCpuHandle());
+		pDev->GetDeviceDep()->CreateShaderResourceView(pTex->GetResourceDep(), &viewDesc, pDesc_->GetCpuCopySourceHandle());
+		pDesc_->Commit();
 
 		return true;
 	}
@@ -350,7 +351,8 @@ namespace sl12
 			return false;
 		}
 
-		pDev->GetDeviceDep()->CreateUnorderedAccessView(pTex->GetResourceDep(), nullptr, &viewDesc, pDesc_->GetCpuHandle());
+		pDev->GetDeviceDep()->CreateUnorderedAccessView(pTex->GetResourceDep(), nullptr, &viewDesc, pDesc_->GetCpuCopySourceHandle());
+		pDesc_->Commit();
 
 		return true;
 	}
@@ -386,7 +388,8 @@ namespace sl12
 			return false;
 		}
 
-		pDev->GetDeviceDep()->CreateUnorderedAccessView(pBuff->GetResourceDep(), nullptr, &viewDesc, pDesc_->GetCpuHandle());
+		pDev->GetDeviceDep()->CreateUnorderedAccessView(pBuff->GetResourceDep(), nullptr, &viewDesc, pDesc_->GetCpuCopySourceHandle());
+		pDesc_->Commit();
 
 		return true;
 	}
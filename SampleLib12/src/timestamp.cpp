@@ -68,6 +68,11 @@ namespace sl12
 	//----
 	void Timestamp::Query(CommandList* pCmdList)
 	{
+		// NOTE: クエリヒープの範囲外には書き込まない
+		if (currentCount_ >= maxCount_)
+		{
+			return;
+		}
 		pCmdList->GetCommandList()->EndQuery(pQuery_, D3D12_QUERY_TYPE_TIMESTAMP, (UINT)currentCount_);
 		currentCount_++;
 	}
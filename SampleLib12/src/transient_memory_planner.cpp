@@ -0,0 +1,161 @@
+﻿#include <sl12/transient_memory_planner.h>
+
+#include <algorithm>
+#include <cassert>
+
+
+namespace sl12
+{
+	namespace
+	{
+		inline u64 AlignUp(u64 v, u64 alignment)
+		{
+			return (alignment > 1) ? ((v + alignment - 1) / alignment * alignment) : v;
+		}
+
+		inline bool IsLifetimeOverlapped(const TransientMemoryPlanner::Request& a, const TransientMemoryPlanner::Request& b)
+		{
+			return (a.firstPass <= b.lastPass) && (b.firstPass <= a.lastPass);
+		}
+
+		inline bool IsMemoryOverlapped(u64 offsetA, u64 sizeA, u64 offsetB, u64 sizeB)
+		{
+			return (offsetA < offsetB + sizeB) && (offsetB < offsetA + sizeA);
+		}
+	}
+
+	//---------------------------------------
+	// 計画をクリアする
+	//---------------------------------------
+	void TransientMemoryPlanner::Clear()
+	{
+		requests_.clear();
+		placements_.clear();
+		heapSize_ = peakLiveSize_ = totalSize_ = 0;
+	}
+
+	//---------------------------------------
+	// リソースを追加する
+	//---------------------------------------
+	u32 TransientMemoryPlanner::AddResource(const Request& req)
+	{
+		assert(req.firstPass <= req.lastPass);
+		requests_.push_back(req);
+		return static_cast<u32>(requests_.size() - 1);
+	}
+
+	//---------------------------------------
+	// 配置を計画する
+	//---------------------------------------
+	void TransientMemoryPlanner::Plan()
+	{
+		const u32 count = GetResourceCount();
+		placements_.assign(count, Placement{ 0, kInvalidIndex, false });
+		heapSize_ = peakLiveSize_ = totalSize_ = 0;
+		if (count == 0)
+		{
+			return;
+		}
+
+		// 大きいリソースから配置すると隙間が少なくなる
+		// 同じサイズなら使用開始の早い順にして、結果を入力順に依存させない
+		std::vector<u32> order(count);
+		for (u32 i = 0; i < count; i++)
+		{
+			order[i] = i;
+		}
+		std::sort(order.begin(), order.end(), [&](u32 a, u32 b)
+		{
+			const Request& ra = requests_[a];
+			const Request& rb = requests_[b];
+			if (ra.size != rb.size) return ra.size > rb.size;
+			if (ra.firstPass != rb.firstPass) return ra.firstPass < rb.firstPass;
+			return a < b;
+		});
+
+		std::vector<u32> placed;
+		std::vector<std::pair<u64, u64>> blocked;		// offset, end
+		placed.reserve(count);
+		for (auto index : order)
+		{
+			const Request& req = requests_[index];
+
+			// 使用区間が重なるリソースが使っているメモリを避ける
+			blocked.clear();
+			for (auto other : placed)
+			{
+				if (IsLifetimeOverlapped(req, requests_[other]))
+				{
+					u64 offset = placements_[other].offset;
+					blocked.push_back(std::make_pair(offset, offset + requests_[other].size));
+				}
+			}
+			std::sort(blocked.begin(), blocked.end());
+
+			u64 offset = 0;
+			for (auto&& b : blocked)
+			{
+				offset = AlignUp(offset, req.alignment);
+				if (offset + req.size <= b.first)
+				{
+					break;
+				}
+				offset = std::max(offset, b.second);
+			}
+			offset = AlignUp(offset, req.alignment);
+
+			placements_[index].offset = offset;
+			placed.push_back(index);
+			heapSize_ = std::max(heapSize_, offset + req.size);
+			totalSize_ += req.size;
+		}
+
+		// メモリが重なり、先に使用を終えたリソースをエイリアシングバリアの対象とする
+		// 対象が複数ある場合はそれぞれの処理の完了順が決まらないので、特定しない
+		for (u32 i = 0; i < count; i++)
+		{
+			const Request& req = requests_[i];
+			u32 before = kInvalidIndex;
+			u32 numBefore = 0;
+			for (u32 j = 0; j < count; j++)
+			{
+				const Request& other = requests_[j];
+				if (j == i || !IsMemoryOverlapped(placements_[i].offset, req.size, placements_[j].offset, other.size))
+				{
+					continue;
+				}
+				placements_[i].isShared = true;
+				if (other.lastPass >= req.firstPass)
+				{
+					continue;
+				}
+				before = j;
+				numBefore++;
+			}
+			placements_[i].aliasBefore = (numBefore == 1) ? before : kInvalidIndex;
+		}
+
+		// 各パスで同時に生存するリソースの合計を求める
+		u32 lastPass = 0;
+		for (auto&& r : requests_)
+		{
+			lastPass = std::max(lastPass, r.lastPass);
+		}
+		for (u32 pass = 0; pass <= lastPass; pass++)
+		{
+			u64 live = 0;
+			for (auto&& r : requests_)
+			{
+				if (r.firstPass <= pass && pass <= r.lastPass)
+				{
+					live += r.size;
+				}
+			}
+			peakLiveSize_ = std::max(peakLiveSize_, live);
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,498 @@
+﻿#include <sl12/upload_manager.h>
+
+#include <sl12/device.h>
+#include <sl12/command_queue.h>
+#include <sl12/buffer.h>
+#include <sl12/texture.h>
+#include <algorithm>
+
+
+namespace sl12
+{
+	namespace
+	{
+		// アップロードヒープにバッファを生成する
+		ID3D12Resource* CreateUploadResource(Device* pDev, u64 size)
+		{
+			D3D12_HEAP_PROPERTIES prop{};
+			prop.Type = D3D12_HEAP_TYPE_UPLOAD;
+			prop.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+			prop.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+			prop.CreationNodeMask = 1;
+			prop.VisibleNodeMask = 1;
+
+			D3D12_RESOURCE_DESC desc{};
+			desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+			desc.Alignment = 0;
+			desc.Width = size;
+			desc.Height = 1;
+			desc.DepthOrArraySize = 1;
+			desc.MipLevels = 1;
+			desc.Format = DXGI_FORMAT_UNKNOWN;
+			desc.SampleDesc.Count = 1;
+			desc.SampleDesc.Quality = 0;
+			desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+			desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+			ID3D12Resource* pRes = nullptr;
+			auto hr = pDev->GetDeviceDep()->CreateCommittedResource(&prop, D3D12_HEAP_FLAG_NONE, &desc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&pRes));
+			if (FAILED(hr))
+			{
+				return nullptr;
+			}
+			return pRes;
+		}
+	}
+
+
+	//-------------------------------------------------
+	// 初期化
+	//-------------------------------------------------
+	bool UploadManager::Initialize(Device* pDev, CommandQueue* pQueue, u64 ringSize)
+	{
+		if (!pDev || !pQueue || !ringSize)
+		{
+			return false;
+		}
+
+		pDevice_ = pDev;
+		pQueue_ = pQueue;
+
+		// リングバッファは永続的にマップしておく
+		pRingResource_ = CreateUploadResource(pDev, ringSize);
+		if (!pRingResource_)
+		{
+			return false;
+		}
+		auto hr = pRingResource_->Map(0, nullptr, reinterpret_cast<void**>(&pRingData_));
+		if (FAILED(hr))
+		{
+			return false;
+		}
+		ring_.Initialize(ringSize);
+
+		hr = pDev->GetDeviceDep()->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&pFence_));
+		if (FAILED(hr))
+		{
+			return false;
+		}
+		fenceValue_ = 1;
+
+		hEvent_ = CreateEventEx(nullptr, FALSE, FALSE, EVENT_ALL_ACCESS);
+		if (hEvent_ == nullptr)
+		{
+			return false;
+		}
+
+		for (auto&& b : batches_)
+		{
+			if (!b.cmdList_.Initialize(pDev, pQueue))
+			{
+				return false;
+			}
+			b.fenceValue_ = 0;
+			b.isRecording_ = false;
+		}
+		currentBatch_ = 0;
+
+		return true;
+	}
+
+	//-------------------------------------------------
+	// 破棄
+	//-------------------------------------------------
+	void UploadManager::Destroy()
+	{
+		if (pFence_)
+		{
+			WaitIdle();
+		}
+
+		for (auto&& b : batches_)
+		{
+			RetireBatch(b);
+			b.cmdList_.Destroy();
+		}
+
+		if (hEvent_)
+		{
+			CloseHandle(hEvent_);
+			hEvent_ = nullptr;
+		}
+		SafeRelease(pFence_);
+
+		if (pRingResource_ && pRingData_)
+		{
+			pRingResource_->Unmap(0, nullptr);
+		}
+		pRingData_ = nullptr;
+		SafeRelease(pRingResource_);
+
+		pQueue_ = nullptr;
+		pDevice_ = nullptr;
+	}
+
+	//-------------------------------------------------
+	// 記録中のバッチを取得する
+	//-------------------------------------------------
+	UploadManager::BatchInfo* UploadManager::BeginRecord()
+	{
+		BatchInfo& b = batches_[currentBatch_];
+		if (!b.isRecording_)
+		{
+			// 前回このバッチを使用したコマンドの完了を待つ
+			if (b.fenceValue_ > 0)
+			{
+				WaitFence(b.fenceValue_);
+				Update();
+			}
+
+			b.cmdList_.Reset();
+			b.isRecording_ = true;
+		}
+		return &b;
+	}
+
+	//-------------------------------------------------
+	// ステージングメモリを確保する
+	//-------------------------------------------------
+	u8* UploadManager::AllocateStaging(u64 size, u64 alignment, ID3D12Resource** ppRes, u64* pOffset)
+	{
+		// リングに収まらないサイズは専用のリソースを生成する
+		if (size > ring_.GetCapacity())
+		{
+			ID3D12Resource* pRes = CreateUploadResource(pDevice_, size);
+			if (!pRes)
+			{
+				return nullptr;
+			}
+			u8* pData = nullptr;
+			auto hr = pRes->Map(0, nullptr, reinterpret_cast<void**>(&pData));
+			if (FAILED(hr))
+			{
+				SafeRelease(pRes);
+				return nullptr;
+			}
+			*ppRes = pRes;
+			*pOffset = 0;
+			return pData;
+		}
+
+		// 空きがなければ発行済みのバッチの完了を待つ
+		u64 offset;
+		if (!ring_.AllocateWait(size, alignment, this, &offset))
+		{
+			return nullptr;
+		}
+
+		*ppRes = pRingResource_;
+		*pOffset = offset;
+		return pRingData_ + offset;
+	}
+
+	//-------------------------------------------------
+	// バッファへのアップロードを登録する
+	//-------------------------------------------------
+	bool UploadManager::EnqueueBuffer(Buffer* pDst, const void* pData, size_t size, size_t dstOffset, CompleteFunc func)
+	{
+		if (!pDst || !pData || !size)
+		{
+			return false;
+		}
+		if (dstOffset + size > pDst->GetSize())
+		{
+			return false;
+		}
+
+		// アップロードヒープ上のバッファは直接書き込む
+		if (pDst->heapProp_.Type == D3D12_HEAP_TYPE_UPLOAD)
+		{
+			u8* p = reinterpret_cast<u8*>(pDst->Map(nullptr));
+			if (!p)
+			{
+				return false;
+			}
+			memcpy(p + dstOffset, pData, size);
+			pDst->Unmap();
+			if (func)
+			{
+				func();
+			}
+			return true;
+		}
+
+		ID3D12Resource* pSrc = nullptr;
+		u64 srcOffset = 0;
+		u8* pStaging = AllocateStaging(size, 4, &pSrc, &srcOffset);
+		if (!pStaging)
+		{
+			return false;
+		}
+		memcpy(pStaging, pData, size);
+
+		BatchInfo* pBatch = BeginRecord();
+		if (pSrc != pRingResource_)
+		{
+			pBatch->tempResources_.push_back(pSrc);
+		}
+		pBatch->cmdList_.CopyBufferRegion(pDst->pResource_, dstOffset, pSrc, srcOffset, size);
+		if (func)
+		{
+			pBatch->callbacks_.push_back(func);
+		}
+
+		return true;
+	}
+
+	//-------------------------------------------------
+	// テクスチャへのアップロードを登録する
+	//-------------------------------------------------
+	bool UploadManager::EnqueueTexture(Texture* pDst, const DirectX::ScratchImage& image, CompleteFunc func)
+	{
+		if (!pDst || !pDst->pResource_)
+		{
+			return false;
+		}
+
+		const DirectX::TexMetadata& meta = image.GetMetadata();
+
+		// リソースのサイズ等を取得
+		u32 numSubresources = static_cast<u32>(meta.arraySize * meta.mipLevels);
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprint(numSubresources);
+		std::vector<u32> numRows(numSubresources);
+		std::vector<u64> rowSize(numSubresources);
+		u64 totalSize;
+		pDevice_->GetDeviceDep()->GetCopyableFootprints(&pDst->resourceDesc_, 0, numSubresources, 0, footprint.data(), numRows.data(), rowSize.data(), &totalSize);
+
+		ID3D12Resource* pSrc = nullptr;
+		u64 srcOffset = 0;
+		u8* pStaging = AllocateStaging(totalSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &pSrc, &srcOffset);
+		if (!pStaging)
+		{
+			return false;
+		}
+
+		// 行ピッチが異なる可能性があるので行単位でコピーする
+		for (u32 d = 0; d < meta.arraySize; d++)
+		{
+			for (u32 m = 0; m < meta.mipLevels; m++)
+			{
+				size_t i = d * meta.mipLevels + m;
+				const DirectX::Image* pImage = image.GetImage(m, 0, d);
+				u8* pDstRow = pStaging + footprint[i].Offset;
+				const u8* pSrcRow = pImage->pixels;
+				size_t copySize = std::min<size_t>(static_cast<size_t>(rowSize[i]), pImage->rowPitch);
+				for (u32 y = 0; y < numRows[i]; y++)
+				{
+					memcpy(pDstRow, pSrcRow, copySize);
+					pDstRow += footprint[i].Footprint.RowPitch;
+					pSrcRow += pImage->rowPitch;
+				}
+			}
+		}
+
+		// コピー命令を発行
+		BatchInfo* pBatch = BeginRecord();
+		if (pSrc != pRingResource_)
+		{
+			pBatch->tempResources_.push_back(pSrc);
+		}
+		for (u32 i = 0; i < numSubresources; i++)
+		{
+			D3D12_TEXTURE_COPY_LOCATION src, dst;
+			src.pResource = pSrc;
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.PlacedFootprint = footprint[i];
+			src.PlacedFootprint.Offset += srcOffset;
+			dst.pResource = pDst->pResource_;
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.SubresourceIndex = i;
+			pBatch->cmdList_.CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+		if (func)
+		{
+			pBatch->callbacks_.push_back(func);
+		}
+
+		return true;
+	}
+
+	//-------------------------------------------------
+	// テクスチャへのアップロードを登録する
+	//-------------------------------------------------
+	bool UploadManager::EnqueueTexture(Texture* pDst, const void* pImageBin, CompleteFunc func)
+	{
+		if (!pDst || !pDst->pResource_ || !pImageBin)
+		{
+			return false;
+		}
+
+		// リソースのサイズ等を取得
+		auto&& resDesc = pDst->resourceDesc_;
+		u32 numSubresources = resDesc.DepthOrArraySize * resDesc.MipLevels;
+		std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> footprint(numSubresources);
+		std::vector<u32> numRows(numSubresources);
+		std::vector<u64> rowSize(numSubresources);
+		u64 totalSize;
+		pDevice_->GetDeviceDep()->GetCopyableFootprints(&resDesc, 0, numSubresources, 0, footprint.data(), numRows.data(), rowSize.data(), &totalSize);
+
+		ID3D12Resource* pSrc = nullptr;
+		u64 srcOffset = 0;
+		u8* pStaging = AllocateStaging(totalSize, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT, &pSrc, &srcOffset);
+		if (!pStaging)
+		{
+			return false;
+		}
+
+		// NOTE: バイナリはフットプリントの行ピッチで並んでいるものとする
+		memcpy(pStaging + footprint[0].Offset, pImageBin, footprint[0].Footprint.RowPitch * footprint[0].Footprint.Height);
+
+		// コピー命令を発行
+		BatchInfo* pBatch = BeginRecord();
+		if (pSrc != pRingResource_)
+		{
+			pBatch->tempResources_.push_back(pSrc);
+		}
+		for (u32 i = 0; i < numSubresources; i++)
+		{
+			D3D12_TEXTURE_COPY_LOCATION src, dst;
+			src.pResource = pSrc;
+			src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+			src.PlacedFootprint = footprint[i];
+			src.PlacedFootprint.Offset += srcOffset;
+			dst.pResource = pDst->pResource_;
+			dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+			dst.SubresourceIndex = i;
+			pBatch->cmdList_.CopyTextureRegion(&dst, 0, 0, 0, &src, nullptr);
+		}
+		if (func)
+		{
+			pBatch->callbacks_.push_back(func);
+		}
+
+		return true;
+	}
+
+	//-------------------------------------------------
+	// 登録済みのコピー命令を発行する
+	//-------------------------------------------------
+	u64 UploadManager::Flush()
+	{
+		BatchInfo& b = batches_[currentBatch_];
+		if (!b.isRecording_)
+		{
+			return GetLastSubmittedValue();
+		}
+
+		b.cmdList_.Close();
+		b.cmdList_.Execute();
+
+		b.fenceValue_ = fenceValue_++;
+		pQueue_->GetQueueDep()->Signal(pFence_, b.fenceValue_);
+		ring_.CloseBatch(b.fenceValue_);
+		b.isRecording_ = false;
+
+		currentBatch_ = (currentBatch_ + 1) % kMaxBatch;
+
+		return b.fenceValue_;
+	}
+
+	//-------------------------------------------------
+	// 完了したバッチを回収する
+	//-------------------------------------------------
+	void UploadManager::Update()
+	{
+		u64 completed = GetCompletedValue();
+		ring_.Retire(completed);
+
+		// 発行順に回収する
+		for (u32 i = 1; i <= kMaxBatch; i++)
+		{
+			BatchInfo& b = batches_[(currentBatch_ + i) % kMaxBatch];
+			if (!b.isRecording_ && (b.fenceValue_ > 0) && (b.fenceValue_ <= completed))
+			{
+				RetireBatch(b);
+			}
+		}
+	}
+
+	//-------------------------------------------------
+	// バッチのリソースを解放し、コールバックを呼び出す
+	//-------------------------------------------------
+	void UploadManager::RetireBatch(BatchInfo& batch)
+	{
+		for (auto&& res : batch.tempResources_)
+		{
+			SafeRelease(res);
+		}
+		batch.tempResources_.clear();
+
+		// コールバック内でEnqueueされる可能性があるので退避してから呼び出す
+		std::vector<CompleteFunc> callbacks;
+		callbacks.swap(batch.callbacks_);
+		for (auto&& func : callbacks)
+		{
+			func();
+		}
+	}
+
+	//-------------------------------------------------
+	// 記録中のバッチを発行する
+	//-------------------------------------------------
+	u64 UploadManager::SubmitPending()
+	{
+		if (!batches_[currentBatch_].isRecording_)
+		{
+			return 0;
+		}
+		return Flush();
+	}
+
+	//-------------------------------------------------
+	// 指定のフェンス値の完了を待ってバッチを回収する
+	//-------------------------------------------------
+	void UploadManager::WaitAndRetire(u64 fenceValue)
+	{
+		WaitFence(fenceValue);
+		Update();
+	}
+
+	//-------------------------------------------------
+	// 指定のフェンス値まで待機する
+	//-------------------------------------------------
+	void UploadManager::WaitFence(u64 value)
+	{
+		if (value >= fenceValue_)
+		{
+			// まだ発行されていない
+			return;
+		}
+		if (pFence_->GetCompletedValue() < value)
+		{
+			pFence_->SetEventOnCompletion(value, hEvent_);
+			WaitForSingleObject(hEvent_, INFINITE);
+		}
+	}
+
+	//-------------------------------------------------
+	// すべての命令の完了を待つ
+	//-------------------------------------------------
+	void UploadManager::WaitIdle()
+	{
+		Flush();
+		WaitFence(GetLastSubmittedValue());
+		Update();
+	}
+
+	//-------------------------------------------------
+	// 完了済みのフェンス値を取得する
+	//-------------------------------------------------
+	u64 UploadManager::GetCompletedValue() const
+	{
+		return pFence_ ? pFence_->GetCompletedValue() : 0;
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,148 @@
+﻿#include <sl12/upload_ring_allocator.h>
+
+#include <cassert>
+#include <cstddef>
+
+
+namespace sl12
+{
+	namespace
+	{
+		u64 AlignUp(u64 v, u64 alignment)
+		{
+			return (v + alignment - 1) / alignment * alignment;
+		}
+	}
+
+
+	//-------------------------------------------------
+	// リングアロケータを初期化する
+	//-------------------------------------------------
+	void UploadRingAllocator::Initialize(u64 capacity)
+	{
+		capacity_ = capacity;
+		head_ = 0;
+		usedSize_ = 0;
+		pendingSize_ = 0;
+		batches_.clear();
+	}
+
+	//-------------------------------------------------
+	// 領域を割り当てる
+	//-------------------------------------------------
+	bool UploadRingAllocator::Allocate(u64 size, u64 alignment, u64* pOffset)
+	{
+		assert(pOffset != nullptr);
+		assert(alignment > 0);
+
+		if (!size || size > capacity_)
+		{
+			return false;
+		}
+
+		// 空き領域は head_ から末尾(tail)までの連続領域
+		// 末尾を跨ぐ場合は終端までをパディングとして消費し、先頭から割り当てる
+		u64 offset = AlignUp(head_, alignment);
+		u64 padding = offset - head_;
+		if (offset + size > capacity_)
+		{
+			padding = capacity_ - head_;
+			offset = 0;
+		}
+
+		if (usedSize_ + padding + size > capacity_)
+		{
+			return false;
+		}
+
+		head_ = offset + size;
+		if (head_ >= capacity_)
+		{
+			head_ = 0;
+		}
+		usedSize_ += padding + size;
+		pendingSize_ += padding + size;
+
+		*pOffset = offset;
+		return true;
+	}
+
+	//-------------------------------------------------
+	// 空きができるまで待機して領域を割り当てる
+	//-------------------------------------------------
+	bool UploadRingAllocator::AllocateWait(u64 size, u64 alignment, UploadRingBackend* pBackend, u64* pOffset)
+	{
+		assert(pBackend != nullptr);
+
+		if (!size || size > capacity_)
+		{
+			return false;
+		}
+
+		while (!Allocate(size, alignment, pOffset))
+		{
+			if (pendingSize_ > 0)
+			{
+				// 記録中のバッチを発行して待機できるようにする
+				u64 fence = pBackend->SubmitPending();
+				if (!fence || pendingSize_ > 0)
+				{
+					return false;
+				}
+			}
+			else if (!batches_.empty())
+			{
+				// 発行済みの最も古いバッチの完了を待つ
+				// 完了しても解放されない場合は、発行されていないフェンス値を待っていることになるので失敗とする
+				size_t prevCount = batches_.size();
+				pBackend->WaitAndRetire(batches_.front().fenceValue);
+				if (batches_.size() >= prevCount)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				// 発行も待機もできるものがない
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//-------------------------------------------------
+	// 現在のバッチを閉じる
+	//-------------------------------------------------
+	void UploadRingAllocator::CloseBatch(u64 fenceValue)
+	{
+		assert(batches_.empty() || batches_.back().fenceValue < fenceValue);
+
+		Batch b;
+		b.fenceValue = fenceValue;
+		b.size = pendingSize_;
+		batches_.push_back(b);
+		pendingSize_ = 0;
+	}
+
+	//-------------------------------------------------
+	// 完了したバッチを解放する
+	//-------------------------------------------------
+	void UploadRingAllocator::Retire(u64 completedFenceValue)
+	{
+		while (!batches_.empty() && (batches_.front().fenceValue <= completedFenceValue))
+		{
+			usedSize_ -= batches_.front().size;
+			batches_.pop_front();
+		}
+
+		// 完全に空になった場合は先頭から使い直す
+		if (usedSize_ == 0)
+		{
+			head_ = 0;
+		}
+	}
+
+}	// namespace sl12
+
+
+//	EOF
@@ -0,0 +1,103 @@
+﻿// SampleLib12 のうち GPU を使用しないモジュールのテスト
+//
+// 使い方: SampleLib12Test [-bench] [名前の一部...]
+//   -bench を指定するとベンチマークも実行する.
+//   名前を指定すると、名前にその文字列を含むテストだけを実行する.
+// いずれかのテストが失敗した場合は 1 を返す.
+
+#include "test.h"
+#include <cstring>
+#include <vector>
+
+
+namespace test
+{
+	namespace
+	{
+		struct TestEntry
+		{
+			const char*	name;
+			TestFunc	func;
+			bool		isBenchmark;
+		};	// struct TestEntry
+
+		std::vector<TestEntry>& GetTests()
+		{
+			// 登録は静的初期化の中で行われるので、関数内の静的変数で初期化順を保証する
+			static std::vector<TestEntry> s_tests;
+			return s_tests;
+		}
+
+		int		g_failCount = 0;
+	}
+
+	//---------------------------------------
+	// テストを登録する
+	//---------------------------------------
+	bool Register(const char* name, TestFunc func, bool isBenchmark)
+	{
+		GetTests().push_back(TestEntry{ name, func, isBenchmark });
+		return true;
+	}
+
+	//---------------------------------------
+	// 失敗を記録する
+	//---------------------------------------
+	void Fail(const char* file, int line, const char* expr)
+	{
+		fprintf(stderr, "  %s(%d): CHECK(%s) failed\n", file, line, expr);
+		g_failCount++;
+	}
+
+}	// namespace test
+
+
+int main(int argc, char* argv[])
+{
+	bool runBench = false;
+	std::vector<const char*> filters;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-bench") == 0)
+		{
+			runBench = true;
+		}
+		else
+		{
+			filters.push_back(argv[i]);
+		}
+	}
+
+	int runCount = 0, failedCount = 0;
+	for (auto&& t : test::GetTests())
+	{
+		if (t.isBenchmark && !runBench)
+		{
+			continue;
+		}
+		bool isMatch = filters.empty();
+		for (auto f : filters)
+		{
+			isMatch = isMatch || (strstr(t.name, f) != nullptr);
+		}
+		if (!isMatch)
+		{
+			continue;
+		}
+
+		printf("[ RUN  ] %s\n", t.name);
+		fflush(stdout);
+		int prevFail = test::g_failCount;
+		t.func();
+		bool isPassed = (test::g_failCount == prevFail);
+		printf("[ %s ] %s\n", isPassed ? " OK " : "FAIL", t.name);
+		runCount++;
+		failedCount += isPassed ? 0 : 1;
+	}
+
+	printf("%d tests, %d failed\n", runCount, failedCount);
+	return (failedCount == 0) ? 0 : 1;
+}
+
+
+//	EOF
@@ -0,0 +1,47 @@
+﻿#pragma once
+
+#include <cstdio>
+
+
+namespace test
+{
+	typedef void (*TestFunc)();
+
+	/**
+	 * @brief テストを登録する
+	 *
+	 * TEST_CASE, BENCH_CASE マクロから呼び出される.
+	 *
+	 * @param[in]	isBenchmark		true の場合は -bench 指定時のみ実行する
+	*/
+	bool Register(const char* name, TestFunc func, bool isBenchmark);
+
+	/**
+	 * @brief 失敗を記録する
+	 *
+	 * 実行中のテストを失敗とし、場所と式を出力する. テストは続行する.
+	*/
+	void Fail(const char* file, int line, const char* expr);
+
+}	// namespace test
+
+// テストを定義する. 登録はファイルスコープの静的変数の初期化で行う
+#define TEST_CASE(name)													\
+	static void name();													\
+	static const bool name##_registered = test::Register(#name, name, false);	\
+	static void name()
+
+// ベンチマークを定義する. 結果は printf で出力する
+#define BENCH_CASE(name)												\
+	static void name();													\
+	static const bool name##_registered = test::Register(#name, name, true);	\
+	static void name()
+
+#define CHECK(expr)														\
+	do { if (!(expr)) { test::Fail(__FILE__, __LINE__, #expr); } } while (0)
+
+#define CHECK_EQ(a, b)		CHECK((a) == (b))
+#define CHECK_NEAR(a, b, eps)	CHECK(((a) - (b)) <= (eps) && ((b) - (a)) <= (eps))
+
+
+//	EOF
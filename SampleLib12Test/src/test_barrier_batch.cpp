@@ -0,0 +1,177 @@
+﻿#include "test.h"
+#include <sl12/barrier_batch.h>
+#include <cstdint>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// 発行されたバリアを ResourceBarrier の呼び出しごとに記録する
+	class MockSink
+		: public BarrierSink
+	{
+	public:
+		void ResourceBarrier(UINT numBarriers, const D3D12_RESOURCE_BARRIER* pBarriers) override
+		{
+			calls.push_back(std::vector<D3D12_RESOURCE_BARRIER>(pBarriers, pBarriers + numBarriers));
+		}
+
+		std::vector<std::vector<D3D12_RESOURCE_BARRIER>>	calls;
+	};	// class MockSink
+
+	// ポインタの比較にしか使われないので、実体のないアドレスで代用する
+	ID3D12Resource* FakeResource(uintptr_t id)
+	{
+		return reinterpret_cast<ID3D12Resource*>(id * 0x100);
+	}
+
+	static const UINT kAll = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+	bool IsTransition(const D3D12_RESOURCE_BARRIER& b, ID3D12Resource* p, D3D12_RESOURCE_STATES before, D3D12_RESOURCE_STATES after, D3D12_RESOURCE_BARRIER_FLAGS flags = D3D12_RESOURCE_BARRIER_FLAG_NONE)
+	{
+		return b.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION
+			&& b.Flags == flags
+			&& b.Transition.pResource == p
+			&& b.Transition.StateBefore == before
+			&& b.Transition.StateAfter == after;
+	}
+
+	bool IsUAV(const D3D12_RESOURCE_BARRIER& b, ID3D12Resource* p)
+	{
+		return b.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV && b.UAV.pResource == p;
+	}
+}
+
+// 積まれたバリアは1回の呼び出しで発行され、空なら呼び出さない
+TEST_CASE(BarrierBatch_FlushOnce)
+{
+	BarrierBatch batch;
+	MockSink sink;
+	batch.Flush(sink);
+	CHECK(sink.calls.empty());
+
+	batch.Transition(FakeResource(1), kAll, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+	batch.Transition(FakeResource(2), kAll, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batch.Aliasing(nullptr, FakeResource(3));
+	batch.Flush(sink);
+	CHECK_EQ(sink.calls.size(), 1u);
+	CHECK_EQ(sink.calls[0].size(), 3u);
+	CHECK(batch.IsEmpty());
+
+	batch.Flush(sink);
+	CHECK_EQ(sink.calls.size(), 1u);
+}
+
+// 連続した遷移はまとめられ、往復は打ち消される
+TEST_CASE(BarrierBatch_MergeTransitions)
+{
+	BarrierBatch batch;
+	MockSink sink;
+	auto pA = FakeResource(1);
+	auto pB = FakeResource(2);
+
+	batch.Transition(pA, kAll, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	batch.Transition(pA, kAll, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	batch.Transition(pB, kAll, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
+	batch.Transition(pB, kAll, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON);
+	batch.Flush(sink);
+
+	CHECK_EQ(sink.calls.size(), 1u);
+	CHECK_EQ(sink.calls[0].size(), 1u);
+	CHECK(IsTransition(sink.calls[0][0], pA, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE));
+}
+
+// UAVを経由する往復は、書き込みの順序を保つためにUAVバリアに置き換わる
+TEST_CASE(BarrierBatch_RoundTripKeepsUAVOrder)
+{
+	BarrierBatch batch;
+	MockSink sink;
+	auto pA = FakeResource(1);
+
+	batch.Transition(pA, kAll, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	batch.Transition(pA, kAll, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batch.Flush(sink);
+
+	CHECK_EQ(sink.calls.size(), 1u);
+	CHECK_EQ(sink.calls[0].size(), 1u);
+	CHECK(IsUAV(sink.calls[0][0], pA));
+}
+
+// 処理を挟まない重複したUAVバリアと、遷移の直後のUAVバリアは省略される
+TEST_CASE(BarrierBatch_MergeUAVWithinFlush)
+{
+	BarrierBatch batch;
+	MockSink sink;
+	auto pA = FakeResource(1);
+	auto pB = FakeResource(2);
+
+	batch.UAV(pA);
+	batch.UAV(pA);
+	batch.Transition(pB, kAll, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batch.UAV(pB);
+	batch.Flush(sink);
+
+	CHECK_EQ(sink.calls.size(), 1u);
+	CHECK_EQ(sink.calls[0].size(), 2u);
+	CHECK(IsUAV(sink.calls[0][0], pA));
+	CHECK(IsTransition(sink.calls[0][1], pB, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+}
+
+// 連続したディスパッチの間のUAVバリアは、Flush を越えてまとめられない
+// CommandList はディスパッチの前に Flush するので、この順序で呼び出される
+TEST_CASE(BarrierBatch_UAVAcrossDispatches)
+{
+	BarrierBatch batch;
+	MockSink sink;
+	auto pA = FakeResource(1);
+
+	batch.Transition(pA, kAll, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+	batch.Flush(sink);		// Dispatch 1
+	batch.UAV(pA);
+	batch.Flush(sink);		// Dispatch 2
+	batch.UAV(pA);
+	batch.Flush(sink);		// Dispatch 3
+	batch.Transition(pA, kAll, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
+	batch.Flush(sink);
+
+	CHECK_EQ(sink.calls.size(), 4u);
+	CHECK(IsTransition(sink.calls[0][0], pA, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS));
+	CHECK_EQ(sink.calls[1].size(), 1u);
+	CHECK(IsUAV(sink.calls[1][0], pA));
+	CHECK_EQ(sink.calls[2].size(), 1u);
+	CHECK(IsUAV(sink.calls[2][0], pA));
+	CHECK_EQ(sink.calls[3].size(), 1u);
+	CHECK(IsTransition(sink.calls[3][0], pA, D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE));
+}
+
+// 分割バリアは BEGIN_ONLY と END_ONLY の組で発行され、途中の遷移は分割を終了させる
+TEST_CASE(BarrierBatch_SplitBarrier)
+{
+	BarrierBatch batch;
+	MockSink sink;
+	auto pA = FakeResource(1);
+	auto pB = FakeResource(2);
+
+	batch.BeginSplit(pA, kAll, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	batch.BeginSplit(pB, kAll, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+	CHECK_EQ(batch.GetOpenSplitCount(), 2u);
+	batch.Flush(sink);
+
+	CHECK(batch.EndSplit(pA, kAll));
+	CHECK(!batch.EndSplit(pA, kAll));
+	batch.Transition(pB, kAll, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE);
+	CHECK_EQ(batch.GetOpenSplitCount(), 0u);
+	batch.Flush(sink);
+
+	CHECK_EQ(sink.calls.size(), 2u);
+	CHECK(IsTransition(sink.calls[0][0], pA, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY));
+	CHECK_EQ(sink.calls[1].size(), 3u);
+	CHECK(IsTransition(sink.calls[1][0], pA, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+	CHECK(IsTransition(sink.calls[1][1], pB, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_BARRIER_FLAG_END_ONLY));
+	CHECK(IsTransition(sink.calls[1][2], pB, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_SOURCE));
+}
+
+
+//	EOF
@@ -0,0 +1,171 @@
+﻿#include "test.h"
+#include <sl12/binding_table.h>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// スロット番号と名前の対応を確認しやすいように、名前ごとに異なるバインド先を登録する
+	void AddName(BindingTable& table, const char* name, u32 rootIndex, u32 numTargets = 1)
+	{
+		std::vector<BindingTable::Target> targets;
+		for (u32 i = 0; i < numTargets; ++i)
+		{
+			targets.push_back({ rootIndex + i, i });
+		}
+		table.Add(name, targets.data(), numTargets);
+	}
+
+	u32 GetFirstRootIndex(const BindingTable& table, BindingSlot slot)
+	{
+		u32 numTargets;
+		const BindingTable::Target* pTargets = table.GetTargets(slot, &numTargets);
+		return (numTargets > 0) ? pTargets[0].rootIndex : 0xffffffff;
+	}
+
+	const char* kNames[] =
+	{
+		"CbScene", "CbMesh", "CbMaterial", "CbLight",
+		"texColor", "texNormal", "texRoughness", "texMetallic",
+		"texShadow", "texAO", "texEnv", "texBrdf",
+		"samLinear", "samPoint", "samShadow", "samAniso",
+		"rwOutput", "rwHistory", "rwCounter", "rwIndirect",
+		"sbLights", "sbInstances", "sbMeshlets", "sbVisibility",
+	};
+	const u32 kNumNames = sizeof(kNames) / sizeof(kNames[0]);
+}
+
+// 登録した名前はすべて異なるスロットに解決され、未登録の名前は無効になる
+TEST_CASE(BindingTable_FindSlot)
+{
+	BindingTable table;
+	for (u32 i = 0; i < kNumNames; ++i)
+	{
+		AddName(table, kNames[i], i * 10, (i % 3) + 1);
+	}
+	table.Finalize();
+	CHECK_EQ(table.GetNumSlots(), kNumNames);
+
+	std::vector<bool> used(kNumNames, false);
+	for (u32 i = 0; i < kNumNames; ++i)
+	{
+		BindingSlot slot = table.Find(BindingName(kNames[i]));
+		CHECK(slot.IsValid());
+		if (!slot.IsValid())
+		{
+			continue;
+		}
+		CHECK(slot.index < kNumNames);
+		CHECK(!used[slot.index]);
+		used[slot.index] = true;
+
+		u32 numTargets;
+		const BindingTable::Target* pTargets = table.GetTargets(slot, &numTargets);
+		CHECK_EQ(numTargets, (i % 3) + 1);
+		for (u32 t = 0; t < numTargets; ++t)
+		{
+			CHECK_EQ(pTargets[t].rootIndex, i * 10 + t);
+			CHECK_EQ(pTargets[t].offsetInTable, t);
+		}
+	}
+
+	CHECK(!table.Find(BindingName("CbUnknown")).IsValid());
+	CHECK(!table.Find(BindingName("")).IsValid());
+
+	// constexpr で定義した名前はコンパイル時にハッシュが決まる
+	static constexpr BindingName kCbMesh("CbMesh");
+	static_assert(kCbMesh.hash == CalcFnv1a32("CbMesh"), "BindingName hash must be constexpr.");
+	CHECK_EQ(table.Find(kCbMesh).index, table.Find(BindingName("CbMesh")).index);
+}
+
+// FNV-1a が衝突する別名は文字列で区別される
+TEST_CASE(BindingTable_HashCollision)
+{
+	// 既知の FNV-1a 32bit の衝突
+	CHECK_EQ(CalcFnv1a32("costarring"), CalcFnv1a32("liquid"));
+	CHECK_EQ(CalcFnv1a32("declinate"), CalcFnv1a32("macallums"));
+
+	BindingTable table;
+	AddName(table, "texColor", 1);
+	AddName(table, "costarring", 2);
+	AddName(table, "liquid", 3);
+	AddName(table, "declinate", 4);
+	table.Finalize();
+
+	BindingSlot a = table.Find(BindingName("costarring"));
+	BindingSlot b = table.Find(BindingName("liquid"));
+	CHECK(a.IsValid());
+	CHECK(b.IsValid());
+	CHECK(a.index != b.index);
+	CHECK_EQ(GetFirstRootIndex(table, a), 2u);
+	CHECK_EQ(GetFirstRootIndex(table, b), 3u);
+	CHECK_EQ(GetFirstRootIndex(table, table.Find(BindingName("declinate"))), 4u);
+
+	// ハッシュだけが一致する未登録の名前は見つからない
+	CHECK(!table.Find(BindingName("macallums")).IsValid());
+}
+
+// 解決済みスロット、名前の検索、std::map による文字列検索のバインド1回あたりのコストを比較する
+BENCH_CASE(Bench_BindingLookup)
+{
+	static const u32 kIterations = 200000;
+
+	BindingTable table;
+	std::map<std::string, std::vector<int>> stringMap;
+	for (u32 i = 0; i < kNumNames; ++i)
+	{
+		AddName(table, kNames[i], i);
+		stringMap[kNames[i]] = std::vector<int>(1, (int)i);
+	}
+	table.Finalize();
+
+	std::vector<BindingName> names;
+	std::vector<BindingSlot> slots;
+	for (u32 i = 0; i < kNumNames; ++i)
+	{
+		names.push_back(BindingName(kNames[i]));
+		slots.push_back(table.Find(names.back()));
+	}
+
+	auto measure = [&](const char* label, u32 (*func)(const BindingTable&, const std::map<std::string, std::vector<int>>&, const BindingName&, BindingSlot, const char*))
+	{
+		u32 sum = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (u32 it = 0; it < kIterations; ++it)
+		{
+			for (u32 i = 0; i < kNumNames; ++i)
+			{
+				sum += func(table, stringMap, names[i], slots[i], kNames[i]);
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)kIterations * kNumNames);
+		printf("  %-22s %7.2f ns/bind (sum %u)\n", label, ns, sum);
+	};
+
+	measure("resolved slot", [](const BindingTable& t, const std::map<std::string, std::vector<int>>&, const BindingName&, BindingSlot slot, const char*)
+	{
+		return GetFirstRootIndex(t, slot);
+	});
+	measure("FindSlot (constexpr)", [](const BindingTable& t, const std::map<std::string, std::vector<int>>&, const BindingName& name, BindingSlot, const char*)
+	{
+		return GetFirstRootIndex(t, t.Find(name));
+	});
+	measure("FindSlot (runtime)", [](const BindingTable& t, const std::map<std::string, std::vector<int>>&, const BindingName&, BindingSlot, const char* str)
+	{
+		return GetFirstRootIndex(t, t.Find(BindingName(str)));
+	});
+	measure("std::map<std::string>", [](const BindingTable&, const std::map<std::string, std::vector<int>>& m, const BindingName&, BindingSlot, const char* str)
+	{
+		auto it = m.find(str);
+		return (it != m.end()) ? (u32)it->second[0] : 0u;
+	});
+}
+
+
+//	EOF
@@ -0,0 +1,143 @@
+﻿#include "test.h"
+#include <sl12/crc.h>
+#include <chrono>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	std::vector<u8> CreateRandomBytes(size_t size)
+	{
+		std::vector<u8> ret(size);
+		u32 seed = 1;
+		for (auto&& b : ret)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			b = static_cast<u8>(seed >> 24);
+		}
+		return ret;
+	}
+}
+
+// 標準のチェック値と一致する
+TEST_CASE(Crc_KnownValues)
+{
+	const char* kCheck = "123456789";
+	CHECK_EQ(CalcCrc32(kCheck, 9), 0xcbf43926u);
+	CHECK_EQ(CalcCrc32Bytewise(kCheck, 9), 0xcbf43926u);
+	CHECK_EQ(CalcCrc32Slice8(kCheck, 9), 0xcbf43926u);
+	CHECK_EQ(CalcCrc32C(kCheck, 9), 0xe3069283u);
+	CHECK_EQ(CalcCrc32CSlice8(kCheck, 9), 0xe3069283u);
+
+	// XXH64 のリファレンス実装の値
+	CHECK_EQ(CalcHash64("", 0), 0xef46db3751d8e999ull);
+	CHECK_EQ(CalcHash64("abc", 3), 0x44bc2cf5ad770999ull);
+
+	CHECK_EQ(CalcFnv1a32(""), 0x811c9dc5u);
+	CHECK_EQ(CalcFnv1a32("a"), 0xe40c292cu);
+}
+
+// すべての実装が、アライメントと長さによらず同じ値を返す
+TEST_CASE(Crc_ImplementationsMatch)
+{
+	std::vector<u8> buf = CreateRandomBytes(1024);
+	bool hasCrc32 = IsHardwareCrc32Supported();
+	bool hasCrc32C = IsHardwareCrc32CSupported();
+	for (size_t offset = 0; offset < 8; offset++)
+	{
+		for (size_t size = 0; size < 300; size++)
+		{
+			const u8* p = buf.data() + offset;
+			u32 crc = CalcCrc32Bytewise(p, size);
+			CHECK_EQ(CalcCrc32Slice8(p, size), crc);
+			CHECK_EQ(CalcCrc32(p, size), crc);
+			if (hasCrc32)
+			{
+				CHECK_EQ(CalcCrc32Hardware(p, size), crc);
+			}
+
+			u32 crcC = CalcCrc32CSlice8(p, size);
+			CHECK_EQ(CalcCrc32C(p, size), crcC);
+			if (hasCrc32C)
+			{
+				CHECK_EQ(CalcCrc32CHardware(p, size), crcC);
+			}
+
+			// ハッシュは読み込み位置のアライメントに依存しない
+			std::vector<u8> copy(p, p + size);
+			CHECK_EQ(CalcHash64(p, size, 7), CalcHash64(copy.data(), size, 7));
+		}
+	}
+}
+
+// 最終値の反転を戻して渡せば分割して計算できる
+TEST_CASE(Crc_Chained)
+{
+	std::vector<u8> buf = CreateRandomBytes(1000);
+	for (size_t split = 0; split <= buf.size(); split += 37)
+	{
+		u32 head = CalcCrc32(buf.data(), split);
+		CHECK_EQ(CalcCrc32(buf.data() + split, buf.size() - split, ~head), CalcCrc32(buf.data(), buf.size()));
+		u32 headC = CalcCrc32C(buf.data(), split);
+		CHECK_EQ(CalcCrc32C(buf.data() + split, buf.size() - split, ~headC), CalcCrc32C(buf.data(), buf.size()));
+	}
+}
+
+// 1ビットの違いでハッシュが変わり、シードでも変わる
+TEST_CASE(Crc_Hash64BitFlip)
+{
+	std::vector<u8> buf = CreateRandomBytes(100);
+	u64 base = CalcHash64(buf.data(), buf.size());
+	CHECK(CalcHash64(buf.data(), buf.size(), 1) != base);
+	for (size_t i = 0; i < buf.size() * 8; i++)
+	{
+		buf[i / 8] ^= static_cast<u8>(1 << (i % 8));
+		CHECK(CalcHash64(buf.data(), buf.size()) != base);
+		buf[i / 8] ^= static_cast<u8>(1 << (i % 8));
+	}
+	CHECK_EQ(CalcHash64(buf.data(), buf.size()), base);
+}
+
+// 各実装のスループットを出力する
+BENCH_CASE(Bench_Crc)
+{
+	std::vector<u8> buf = CreateRandomBytes(16 * 1024 * 1024);
+	struct Entry
+	{
+		const char*	name;
+		u64			(*func)(const std::vector<u8>&);
+		bool		isSupported;
+	};
+	const Entry entries[] = {
+		{ "CalcCrc32Bytewise",  [](const std::vector<u8>& b) -> u64 { return CalcCrc32Bytewise(b.data(), b.size()); }, true },
+		{ "CalcCrc32Slice8",    [](const std::vector<u8>& b) -> u64 { return CalcCrc32Slice8(b.data(), b.size()); }, true },
+		{ "CalcCrc32Hardware",  [](const std::vector<u8>& b) -> u64 { return CalcCrc32Hardware(b.data(), b.size()); }, IsHardwareCrc32Supported() },
+		{ "CalcCrc32CSlice8",   [](const std::vector<u8>& b) -> u64 { return CalcCrc32CSlice8(b.data(), b.size()); }, true },
+		{ "CalcCrc32CHardware", [](const std::vector<u8>& b) -> u64 { return CalcCrc32CHardware(b.data(), b.size()); }, IsHardwareCrc32CSupported() },
+		{ "CalcHash64",         [](const std::vector<u8>& b) -> u64 { return CalcHash64(b.data(), b.size()); }, true },
+	};
+
+	const int kLoop = 8;
+	for (auto&& e : entries)
+	{
+		if (!e.isSupported)
+		{
+			printf("  %-20s not supported\n", e.name);
+			continue;
+		}
+		u64 result = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < kLoop; i++)
+		{
+			result += e.func(buf);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double sec = std::chrono::duration<double>(end - start).count();
+		printf("  %-20s %6.2f GB/s  (%016llx)\n", e.name, double(buf.size()) * kLoop / sec / 1e9, static_cast<unsigned long long>(result));
+	}
+}
+
+
+//	EOF
@@ -0,0 +1,343 @@
+﻿#include "test.h"
+#include <sl12/descriptor_allocator.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	static const u32 kInvalid = DescriptorIndexAllocator::kInvalidIndex;
+}
+
+// 単体と連続領域で同じインデックスを返さず、解放すれば再利用できる
+TEST_CASE(DescriptorAllocator_Basic)
+{
+	DescriptorIndexAllocator alloc;
+	CHECK(!alloc.Initialize(0));
+	CHECK(alloc.Initialize(64));
+
+	std::vector<bool> used(64, false);
+	u32 base;
+	CHECK(alloc.AllocateRange(16, &base));
+	CHECK_EQ(base, 48u);
+	for (u32 i = 0; i < 16; i++)
+	{
+		used[base + i] = true;
+	}
+	std::vector<u32> singles;
+	for (u32 i = 0; i < 48; i++)
+	{
+		u32 index = alloc.Allocate();
+		CHECK(index < 48u);
+		if (index < 64)
+		{
+			CHECK(!used[index]);
+			used[index] = true;
+		}
+		singles.push_back(index);
+	}
+	CHECK_EQ(alloc.Allocate(), kInvalid);
+	CHECK(!alloc.AllocateRange(1, &base));
+
+	// 連続領域を戻すと単体でも使えるようになる
+	alloc.ReleaseRange(48, 16);
+	CHECK(alloc.Allocate() != kInvalid);
+
+	for (auto index : singles)
+	{
+		alloc.Release(index);
+	}
+	alloc.FlushThreadCache();
+}
+
+// 他のスレッドのキャッシュに残ったインデックスも確保できる
+TEST_CASE(DescriptorAllocator_SmallHeapNoHoarding)
+{
+	DescriptorIndexAllocator alloc;
+	CHECK(alloc.Initialize(10));
+
+	std::thread t([&alloc]()
+	{
+		u32 index = alloc.Allocate();
+		alloc.Release(index);
+	});
+	t.join();
+
+	std::vector<u32> indices;
+	for (u32 i = 0; i < 10; i++)
+	{
+		u32 index = alloc.Allocate();
+		CHECK(index != kInvalid);
+		indices.push_back(index);
+	}
+	CHECK_EQ(alloc.Allocate(), kInvalid);
+	std::sort(indices.begin(), indices.end());
+	CHECK(std::unique(indices.begin(), indices.end()) == indices.end());
+}
+
+// 1スレッドがすべて確保して解放した後でも、別スレッドがすべて確保できる
+TEST_CASE(DescriptorAllocator_ReleasedOnOtherThread)
+{
+	DescriptorIndexAllocator alloc;
+	CHECK(alloc.Initialize(24));
+
+	std::thread t([&alloc]()
+	{
+		std::vector<u32> indices;
+		for (u32 i = 0; i < 24; i++)
+		{
+			indices.push_back(alloc.Allocate());
+		}
+		for (auto index : indices)
+		{
+			alloc.Release(index);
+		}
+	});
+	t.join();
+
+	u32 count = 0;
+	while (alloc.Allocate() != kInvalid)
+	{
+		count++;
+	}
+	CHECK_EQ(count, 24u);
+}
+
+// 16スレッドで単体と連続領域の確保・解放を繰り返しても、重複せず、すべて回収できる
+TEST_CASE(DescriptorAllocator_Stress)
+{
+	const u32 kNum = 4096;
+	const u32 kThreads = 16;
+	DescriptorIndexAllocator alloc;
+	CHECK(alloc.Initialize(kNum));
+
+	std::unique_ptr<std::atomic<int>[]> owner(new std::atomic<int>[kNum]);
+	for (u32 i = 0; i < kNum; i++)
+	{
+		owner[i].store(0);
+	}
+	std::atomic<int> duplicates(0);
+
+	std::vector<std::thread> threads;
+	for (u32 t = 0; t < kThreads; t++)
+	{
+		threads.emplace_back([&, t]()
+		{
+			std::vector<u32> mine;
+			u32 seed = t * 7919 + 1;
+			for (int it = 0; it < 100000; it++)
+			{
+				seed = seed * 1103515245u + 12345u;
+				if (((seed >> 16) & 1) && mine.size() < 100)
+				{
+					u32 index = alloc.Allocate();
+					if (index != kInvalid)
+					{
+						if (owner[index].fetch_add(1) != 0)
+						{
+							duplicates++;
+						}
+						mine.push_back(index);
+					}
+				}
+				else if (!mine.empty())
+				{
+					u32 index = mine.back();
+					mine.pop_back();
+					owner[index].fetch_sub(1);
+					alloc.Release(index);
+				}
+
+				if (it % 5000 == 0)
+				{
+					u32 base;
+					if (alloc.AllocateRange(8, &base))
+					{
+						for (u32 k = 0; k < 8; k++)
+						{
+							if (owner[base + k].fetch_add(1) != 0)
+							{
+								duplicates++;
+							}
+						}
+						for (u32 k = 0; k < 8; k++)
+						{
+							owner[base + k].fetch_sub(1);
+						}
+						alloc.ReleaseRange(base, 8);
+					}
+				}
+			}
+			for (auto index : mine)
+			{
+				owner[index].fetch_sub(1);
+				alloc.Release(index);
+			}
+			alloc.FlushThreadCache();
+		});
+	}
+	for (auto&& t : threads)
+	{
+		t.join();
+	}
+
+	CHECK_EQ(duplicates.load(), 0);
+	u32 recovered = 0;
+	while (alloc.Allocate() != kInvalid)
+	{
+		recovered++;
+	}
+	CHECK_EQ(recovered, kNum);
+}
+
+// 一時領域はフェンスが完了するまで再利用されず、完了後は先頭に折り返して再利用される
+TEST_CASE(DescriptorAllocator_TransientRecycle)
+{
+	DescriptorIndexAllocator alloc;
+	CHECK(alloc.Initialize(256));
+	CHECK(alloc.ReserveTransientRegion(64));
+	CHECK_EQ(alloc.GetTransientCapacity(), 64u);
+
+	u32 first, base;
+	CHECK(alloc.AllocateTransient(20, &first));
+	CHECK(alloc.AllocateTransient(20, &base));
+	CHECK_EQ(base, first + 20);
+	CHECK(alloc.AllocateTransient(20, &base));
+	CHECK_EQ(base, first + 40);
+	CHECK(alloc.MarkTransient(1));
+
+	// 残りは4つなので、末尾をまたぐ確保は失敗する
+	CHECK(!alloc.AllocateTransient(20, &base));
+	CHECK(alloc.AllocateTransient(4, &base));
+	CHECK_EQ(base, first + 60);
+	CHECK(alloc.MarkTransient(2));
+
+	// 完了していないフェンスでは解放されない
+	alloc.RetireTransient(0);
+	CHECK(!alloc.AllocateTransient(1, &base));
+
+	// フェンス1までの60個が解放され、先頭から使い直す
+	alloc.RetireTransient(1);
+	CHECK(alloc.AllocateTransient(30, &base));
+	CHECK_EQ(base, first);
+	CHECK(alloc.AllocateTransient(30, &base));
+	CHECK_EQ(base, first + 30);
+	CHECK(!alloc.AllocateTransient(4, &base));
+
+	alloc.RetireTransient(2);
+	CHECK(alloc.AllocateTransient(4, &base));
+	CHECK_EQ(base, first + 60);
+
+	// 一時領域は単体確保と重ならない
+	for (u32 i = 0; i < 256 - 64; i++)
+	{
+		u32 index = alloc.Allocate();
+		CHECK(index != kInvalid);
+		CHECK(index < first || index >= first + 64);
+	}
+	CHECK_EQ(alloc.Allocate(), kInvalid);
+}
+
+// 8スレッドで一時領域を確保しながらフレームを進めても、処理中のフレームの領域と重ならない
+TEST_CASE(DescriptorAllocator_TransientMultithread)
+{
+	const u32 kCapacity = 4096;
+	const u32 kThreads = 8;
+	const u32 kAllocsPerFrame = 16;
+	const u32 kFrames = 200;
+	DescriptorIndexAllocator alloc;
+	CHECK(alloc.Initialize(kCapacity * 2));
+	CHECK(alloc.ReserveTransientRegion(kCapacity));
+
+	u32 regionBase = kInvalid;
+	{
+		u32 base;
+		CHECK(alloc.AllocateTransient(1, &base));
+		regionBase = base;
+		alloc.MarkTransient(0);
+		alloc.RetireTransient(0);
+	}
+
+	std::unique_ptr<std::atomic<int>[]> owner(new std::atomic<int>[kCapacity]);
+	for (u32 i = 0; i < kCapacity; i++)
+	{
+		owner[i].store(0);
+	}
+	std::atomic<int> duplicates(0), outOfRegion(0), failures(0);
+	std::atomic<u64> totalAllocated(0);
+
+	// フレームごとの確保範囲. GPUが1フレーム遅れて完了するものとして、2フレーム前の分を解放する
+	std::vector<std::vector<std::pair<u32, u32>>> frameRanges(kFrames + 1);
+	for (u32 frame = 1; frame <= kFrames; frame++)
+	{
+		std::vector<std::vector<std::pair<u32, u32>>> threadRanges(kThreads);
+		std::vector<std::thread> threads;
+		for (u32 t = 0; t < kThreads; t++)
+		{
+			threads.emplace_back([&, t]()
+			{
+				u32 seed = frame * 7919 + t * 104729 + 1;
+				for (u32 i = 0; i < kAllocsPerFrame; i++)
+				{
+					seed = seed * 1103515245u + 12345u;
+					u32 count = ((seed >> 16) % 8) + 1;
+					u32 base;
+					if (!alloc.AllocateTransient(count, &base))
+					{
+						failures++;
+						continue;
+					}
+					if (base < regionBase || base + count > regionBase + kCapacity)
+					{
+						outOfRegion++;
+						continue;
+					}
+					for (u32 k = 0; k < count; k++)
+					{
+						if (owner[base - regionBase + k].fetch_add(1) != 0)
+						{
+							duplicates++;
+						}
+					}
+					totalAllocated += count;
+					threadRanges[t].push_back(std::make_pair(base, count));
+				}
+			});
+		}
+		for (auto&& t : threads)
+		{
+			t.join();
+		}
+		for (auto&& r : threadRanges)
+		{
+			frameRanges[frame].insert(frameRanges[frame].end(), r.begin(), r.end());
+		}
+		CHECK(alloc.MarkTransient(frame));
+
+		if (frame >= 2)
+		{
+			for (auto&& r : frameRanges[frame - 1])
+			{
+				for (u32 k = 0; k < r.second; k++)
+				{
+					owner[r.first - regionBase + k].fetch_sub(1);
+				}
+			}
+			alloc.RetireTransient(frame - 1);
+		}
+	}
+
+	CHECK_EQ(duplicates.load(), 0);
+	CHECK_EQ(outOfRegion.load(), 0);
+	CHECK_EQ(failures.load(), 0);
+	// 何周も折り返して再利用されている
+	CHECK(totalAllocated.load() > static_cast<u64>(kCapacity) * 4);
+}
+
+
+//	EOF
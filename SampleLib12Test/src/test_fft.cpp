@@ -0,0 +1,315 @@
+﻿#include "test.h"
+#include <sl12/fft.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <random>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// 単精度の FFT に許す相対 RMS 誤差
+	static const double kMaxRelativeError = 1e-5;
+
+	// 2のべき乗、小さな素数、Bluestein 法になる大きな長さ
+	static const u32 kExtraLengths[] = { 128, 256, 997, 1000, 1023, 1024, 4096 };
+
+	std::vector<float> MakeSignal(u32 count, u32 seed)
+	{
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::vector<float> ret(count);
+		for (auto&& v : ret)
+		{
+			v = dist(rng);
+		}
+		return ret;
+	}
+
+	// リファレンスとの相対 RMS 誤差
+	double RelativeError(const float* pRe, const float* pIm, const double* pRefRe, const double* pRefIm, u32 count)
+	{
+		double err = 0.0, norm = 0.0;
+		for (u32 i = 0; i < count; i++)
+		{
+			double dr = pRe[i] - pRefRe[i];
+			double di = pIm ? pIm[i] - pRefIm[i] : 0.0;
+			err += dr * dr + di * di;
+			norm += pRefRe[i] * pRefRe[i] + (pIm ? pRefIm[i] * pRefIm[i] : 0.0);
+		}
+		return std::sqrt(err / (norm + 1e-30));
+	}
+
+	// 1..70 と kExtraLengths
+	std::vector<u32> TestLengths()
+	{
+		std::vector<u32> ret;
+		for (u32 n = 1; n <= 70; n++)
+		{
+			ret.push_back(n);
+		}
+		ret.insert(ret.end(), std::begin(kExtraLengths), std::end(kExtraLengths));
+		return ret;
+	}
+
+	// 倍精度の2次元 DFT. 行方向、列方向の順に1次元の DFT を行う
+	void Reference2D(const std::vector<float>& src, u32 width, u32 height, std::vector<double>& outRe, std::vector<double>& outIm)
+	{
+		outRe.assign(src.begin(), src.end());
+		outIm.assign(src.size(), 0.0);
+		std::vector<double> ir(std::max(width, height)), ii(ir.size()), or_(ir.size()), oi(ir.size());
+		for (u32 y = 0; y < height; y++)
+		{
+			for (u32 x = 0; x < width; x++)
+			{
+				ir[x] = outRe[y * width + x];
+				ii[x] = outIm[y * width + x];
+			}
+			ComputeReferenceDFT(ir.data(), ii.data(), or_.data(), oi.data(), width, false);
+			for (u32 x = 0; x < width; x++)
+			{
+				outRe[y * width + x] = or_[x];
+				outIm[y * width + x] = oi[x];
+			}
+		}
+		for (u32 x = 0; x < width; x++)
+		{
+			for (u32 y = 0; y < height; y++)
+			{
+				ir[y] = outRe[y * width + x];
+				ii[y] = outIm[y * width + x];
+			}
+			ComputeReferenceDFT(ir.data(), ii.data(), or_.data(), oi.data(), height, false);
+			for (u32 y = 0; y < height; y++)
+			{
+				outRe[y * width + x] = or_[y];
+				outIm[y * width + x] = oi[y];
+			}
+		}
+	}
+}
+
+// インパルスは全て1、定数は直流成分だけになる. 長さ0は初期化に失敗する
+TEST_CASE(FFT_KnownValues)
+{
+	FFTPlan plan;
+	CHECK(!plan.Initialize(0));
+
+	const u32 lengths[] = { 8, 12 };
+	for (u32 n : lengths)
+	{
+		CHECK(plan.Initialize(n));
+		CHECK_EQ(plan.IsBluestein(), (n & (n - 1)) != 0);
+		std::vector<float> re(n, 0.0f), im(n, 0.0f), work(plan.GetWorkSize());
+		re[0] = 1.0f;
+		plan.Forward(re.data(), im.data(), work.data());
+		for (u32 i = 0; i < n; i++)
+		{
+			CHECK_NEAR(re[i], 1.0f, 1e-5f);
+			CHECK_NEAR(im[i], 0.0f, 1e-5f);
+		}
+
+		std::fill(re.begin(), re.end(), 1.0f);
+		std::fill(im.begin(), im.end(), 0.0f);
+		plan.Forward(re.data(), im.data(), work.data());
+		CHECK_NEAR(re[0], (float)n, 1e-4f);
+		for (u32 i = 1; i < n; i++)
+		{
+			CHECK_NEAR(re[i], 0.0f, 1e-4f);
+			CHECK_NEAR(im[i], 0.0f, 1e-4f);
+		}
+	}
+}
+
+// 任意の長さで倍精度の DFT と一致し、逆変換で元に戻る
+TEST_CASE(FFT_MatchesDFT)
+{
+	for (u32 n : TestLengths())
+	{
+		FFTPlan plan;
+		CHECK(plan.Initialize(n));
+		std::vector<float> re = MakeSignal(n, n), im = MakeSignal(n, n + 1000);
+		std::vector<float> work(plan.GetWorkSize());
+		std::vector<double> srcRe(re.begin(), re.end()), srcIm(im.begin(), im.end()), refRe(n), refIm(n);
+
+		ComputeReferenceDFT(srcRe.data(), srcIm.data(), refRe.data(), refIm.data(), n, false);
+		plan.Forward(re.data(), im.data(), work.data());
+		double err = RelativeError(re.data(), im.data(), refRe.data(), refIm.data(), n);
+		if (err > kMaxRelativeError)
+		{
+			printf("  forward n=%u: %g\n", n, err);
+		}
+		CHECK(err <= kMaxRelativeError);
+
+		plan.Inverse(re.data(), im.data(), work.data());
+		err = RelativeError(re.data(), im.data(), srcRe.data(), srcIm.data(), n);
+		if (err > kMaxRelativeError)
+		{
+			printf("  inverse n=%u: %g\n", n, err);
+		}
+		CHECK(err <= kMaxRelativeError);
+	}
+}
+
+// 実数入力の FFT は複素 DFT の先頭 N/2+1 要素と一致し、逆変換で元に戻る
+TEST_CASE(RealFFT_MatchesDFT)
+{
+	for (u32 n : TestLengths())
+	{
+		RealFFTPlan plan;
+		CHECK(plan.Initialize(n));
+		const u32 specLen = plan.GetSpectrumLength();
+		CHECK_EQ(specLen, n / 2 + 1);
+
+		std::vector<float> src = MakeSignal(n, n + 2000), re(specLen), im(specLen), dst(n), work(plan.GetWorkSize());
+		std::vector<double> srcRe(src.begin(), src.end()), srcIm(n, 0.0), refRe(n), refIm(n);
+
+		ComputeReferenceDFT(srcRe.data(), srcIm.data(), refRe.data(), refIm.data(), n, false);
+		plan.Forward(src.data(), re.data(), im.data(), work.data());
+		double err = RelativeError(re.data(), im.data(), refRe.data(), refIm.data(), specLen);
+		if (err > kMaxRelativeError)
+		{
+			printf("  real forward n=%u: %g\n", n, err);
+		}
+		CHECK(err <= kMaxRelativeError);
+
+		plan.Inverse(re.data(), im.data(), dst.data(), work.data());
+		err = RelativeError(dst.data(), nullptr, srcRe.data(), nullptr, n);
+		if (err > kMaxRelativeError)
+		{
+			printf("  real inverse n=%u: %g\n", n, err);
+		}
+		CHECK(err <= kMaxRelativeError);
+	}
+}
+
+// 2次元の FFT が倍精度の DFT と一致し、実数版は複素版の左半分と一致する
+TEST_CASE(FFT2D_MatchesDFT)
+{
+	const u32 sizes[][2] = { { 1, 1 }, { 1, 7 }, { 7, 1 }, { 3, 2 }, { 16, 16 }, { 30, 17 }, { 64, 48 } };
+	for (auto&& size : sizes)
+	{
+		const u32 width = size[0], height = size[1], count = width * height;
+		FFT2D fft;
+		CHECK(fft.Initialize(width, height));
+		const u32 specWidth = fft.GetSpectrumWidth();
+		CHECK_EQ(specWidth, width / 2 + 1);
+
+		std::vector<float> src = MakeSignal(count, width * 100 + height);
+		std::vector<double> refRe, refIm;
+		Reference2D(src, width, height, refRe, refIm);
+
+		std::vector<float> re(src), im(count, 0.0f);
+		fft.Forward(re.data(), im.data(), 3);
+		CHECK(RelativeError(re.data(), im.data(), refRe.data(), refIm.data(), count) <= kMaxRelativeError);
+
+		std::vector<float> specRe(specWidth * height), specIm(specWidth * height);
+		std::vector<double> halfRe(specWidth * height), halfIm(specWidth * height);
+		fft.ForwardReal(src.data(), specRe.data(), specIm.data(), 3);
+		for (u32 y = 0; y < height; y++)
+		{
+			for (u32 x = 0; x < specWidth; x++)
+			{
+				halfRe[y * specWidth + x] = refRe[y * width + x];
+				halfIm[y * specWidth + x] = refIm[y * width + x];
+			}
+		}
+		CHECK(RelativeError(specRe.data(), specIm.data(), halfRe.data(), halfIm.data(), specWidth * height) <= kMaxRelativeError);
+
+		// 逆変換で元に戻る
+		std::vector<double> srcD(src.begin(), src.end()), zero(count, 0.0);
+		fft.Inverse(re.data(), im.data(), 3);
+		CHECK(RelativeError(re.data(), im.data(), srcD.data(), zero.data(), count) <= kMaxRelativeError);
+
+		std::vector<float> dst(count);
+		fft.InverseReal(specRe.data(), specIm.data(), dst.data(), 3);
+		CHECK(RelativeError(dst.data(), nullptr, srcD.data(), nullptr, count) <= kMaxRelativeError);
+	}
+}
+
+// 2次元の FFT の結果はスレッド数によらずビット単位で一致する
+TEST_CASE(FFT2D_ThreadCountIndependent)
+{
+	const u32 width = 96, height = 80, count = width * height;
+	FFT2D fft;
+	CHECK(fft.Initialize(width, height));
+	const u32 specCount = fft.GetSpectrumWidth() * height;
+	std::vector<float> src = MakeSignal(count, 7);
+
+	std::vector<float> baseRe, baseIm, baseSpecRe, baseSpecIm;
+	const u32 threadCounts[] = { 1, 3, 0 };
+	for (u32 threads : threadCounts)
+	{
+		std::vector<float> re(src), im(count, 0.0f);
+		fft.Forward(re.data(), im.data(), threads);
+		std::vector<float> specRe(specCount), specIm(specCount);
+		fft.ForwardReal(src.data(), specRe.data(), specIm.data(), threads);
+
+		if (threads == 1)
+		{
+			baseRe = re;
+			baseIm = im;
+			baseSpecRe = specRe;
+			baseSpecIm = specIm;
+		}
+		else
+		{
+			CHECK(re == baseRe);
+			CHECK(im == baseIm);
+			CHECK(specRe == baseSpecRe);
+			CHECK(specIm == baseSpecIm);
+		}
+	}
+}
+
+// 1次元と2次元の FFT の速度. GFlops は名目上の演算数から求める
+BENCH_CASE(Bench_FFT)
+{
+	const u32 lengths[] = { 1024, 1000, 4096 };
+	for (u32 n : lengths)
+	{
+		const u32 kRuns = 2000;
+		FFTPlan plan;
+		plan.Initialize(n);
+		std::vector<float> re = MakeSignal(n, 1), im = MakeSignal(n, 2), work(plan.GetWorkSize());
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (u32 r = 0; r < kRuns; r++)
+		{
+			plan.Execute(re.data(), im.data(), work.data());
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		double us = std::chrono::duration<double, std::micro>(t1 - t0).count() / kRuns;
+		printf("  1D %5u%s: %.2f us (%.2f GFlops)\n", n, plan.IsBluestein() ? " (Bluestein)" : "", us, GetFFTNominalFlops(n, false) / (us * 1000.0));
+	}
+
+	{
+		const u32 kSize = 512, kRuns = 10;
+		FFT2D fft;
+		fft.Initialize(kSize, kSize);
+		std::vector<float> src = MakeSignal(kSize * kSize, 3), re(src), im(src.size(), 0.0f);
+		std::vector<float> specRe(fft.GetSpectrumWidth() * kSize), specIm(specRe.size());
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		for (u32 r = 0; r < kRuns; r++)
+		{
+			fft.Forward(re.data(), im.data(), 0);
+		}
+		auto t1 = std::chrono::high_resolution_clock::now();
+		for (u32 r = 0; r < kRuns; r++)
+		{
+			fft.ForwardReal(src.data(), specRe.data(), specIm.data(), 0);
+		}
+		auto t2 = std::chrono::high_resolution_clock::now();
+		double msComplex = std::chrono::duration<double, std::milli>(t1 - t0).count() / kRuns;
+		double msReal = std::chrono::duration<double, std::milli>(t2 - t1).count() / kRuns;
+		printf("  2D %ux%u complex: %.3f ms, real: %.3f ms\n", kSize, kSize, msComplex, msReal);
+	}
+}
+
+
+//	EOF
@@ -0,0 +1,193 @@
+﻿#include "test.h"
+#include <sl12/float16.h>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	float BitsToFloat(u32 bits)
+	{
+		float ret;
+		memcpy(&ret, &bits, sizeof(ret));
+		return ret;
+	}
+
+	u32 FloatToBits(float value)
+	{
+		u32 ret;
+		memcpy(&ret, &value, sizeof(ret));
+		return ret;
+	}
+
+	// 丸めの境界を多く含むように、ビット列を素数の間隔で走査する
+	std::vector<float> MakeSampleFloats()
+	{
+		std::vector<float> ret;
+		for (u64 bits = 0; bits < (1ull << 32); bits += 4099)
+		{
+			ret.push_back(BitsToFloat(static_cast<u32>(bits)));
+		}
+		// half の各値と、その前後の中間点
+		for (u32 h = 0; h < 0x7c00; h++)
+		{
+			u32 f = FloatToBits(HalfToFloat(static_cast<u16>(h)));
+			const u32 kOffsets[] = { 0, 0x0fff, 0x1000, 0x1001 };
+			for (auto o : kOffsets)
+			{
+				ret.push_back(BitsToFloat(f + o));
+				ret.push_back(BitsToFloat((f + o) | 0x80000000));
+			}
+		}
+		return ret;
+	}
+}
+
+// 代表的な値の変換
+TEST_CASE(Float16_KnownValues)
+{
+	CHECK_EQ(FloatToHalf(0.0f), 0x0000);
+	CHECK_EQ(FloatToHalf(-0.0f), 0x8000);
+	CHECK_EQ(FloatToHalf(1.0f), 0x3c00);
+	CHECK_EQ(FloatToHalf(-2.0f), 0xc000);
+	CHECK_EQ(FloatToHalf(65504.0f), 0x7bff);
+	CHECK_EQ(FloatToHalf(65520.0f), 0x7c00);			// 最大値を超えて丸められる
+	CHECK_EQ(FloatToHalf(BitsToFloat(0x7f800000)), 0x7c00);
+	CHECK_EQ(FloatToHalf(5.9604645e-8f), 0x0001);		// 最小の非正規化数
+	CHECK_EQ(FloatToHalf(2.9802322e-8f), 0x0000);		// その半分は偶数に丸められる
+	CHECK_EQ(FloatToHalf(1.0f + 1.0f / 2048.0f), 0x3c00);	// 中間点は偶数へ
+	CHECK_EQ(FloatToHalf(1.0f + 3.0f / 2048.0f), 0x3c02);
+	CHECK_EQ(FloatToHalf(BitsToFloat(0x7fc00000)) & 0x7e00, 0x7e00);
+
+	CHECK_EQ(HalfToFloat(0x3c00), 1.0f);
+	CHECK_EQ(HalfToFloat(0x0001), 5.9604645e-8f);
+	CHECK_EQ(FloatToBits(HalfToFloat(0xfc00)), 0xff800000u);
+}
+
+// NaN 以外のすべての half は float を経由して元に戻る
+TEST_CASE(Float16_RoundTrip)
+{
+	u32 mismatches = 0;
+	for (u32 h = 0; h < 0x10000; h++)
+	{
+		bool isNaN = ((h & 0x7c00) == 0x7c00) && ((h & 0x03ff) != 0);
+		if (isNaN)
+		{
+			// NaN は quiet NaN になる
+			mismatches += (FloatToHalf(HalfToFloat(static_cast<u16>(h))) != (h | 0x0200)) ? 1 : 0;
+		}
+		else
+		{
+			mismatches += (FloatToHalf(HalfToFloat(static_cast<u16>(h))) != h) ? 1 : 0;
+		}
+	}
+	CHECK_EQ(mismatches, 0u);
+}
+
+// 配列の変換はスカラー版、ハードウェア版ともに1要素ずつの変換と一致する
+TEST_CASE(Float16_ArrayMatchesScalar)
+{
+	auto src = MakeSampleFloats();
+	std::vector<u16> expected(src.size());
+	for (size_t i = 0; i < src.size(); i++)
+	{
+		expected[i] = FloatToHalf(src[i]);
+	}
+
+	std::vector<u16> dst(src.size());
+	FloatToHalfArrayScalar(src.data(), dst.data(), src.size());
+	CHECK(dst == expected);
+	FloatToHalfArray(src.data(), dst.data(), src.size());
+	CHECK(dst == expected);
+	if (IsHardwareHalfSupported())
+	{
+		FloatToHalfArrayHardware(src.data(), dst.data(), src.size());
+		CHECK(dst == expected);
+	}
+
+	std::vector<u16> halves(0x10000);
+	std::vector<float> floats(halves.size()), floatsExpected(halves.size());
+	for (u32 h = 0; h < 0x10000; h++)
+	{
+		halves[h] = static_cast<u16>(h);
+		floatsExpected[h] = HalfToFloat(static_cast<u16>(h));
+	}
+	HalfToFloatArray(halves.data(), floats.data(), halves.size());
+	CHECK(memcmp(floats.data(), floatsExpected.data(), sizeof(float) * floats.size()) == 0);
+	if (IsHardwareHalfSupported())
+	{
+		HalfToFloatArrayHardware(halves.data(), floats.data(), halves.size());
+		CHECK(memcmp(floats.data(), floatsExpected.data(), sizeof(float) * floats.size()) == 0);
+	}
+}
+
+// 端数の要素数でも書き出し先の範囲外に書き込まない
+TEST_CASE(Float16_ArrayTail)
+{
+	for (size_t count = 0; count <= 17; count++)
+	{
+		std::vector<float> src(count + 1);
+		for (size_t i = 0; i < src.size(); i++)
+		{
+			src[i] = static_cast<float>(i) * 0.5f;
+		}
+		std::vector<u16> dst(count + 1, 0xcdcd);
+		FloatToHalfArray(src.data(), dst.data(), count);
+		CHECK_EQ(dst[count], 0xcdcd);
+		for (size_t i = 0; i < count; i++)
+		{
+			CHECK_EQ(dst[i], FloatToHalf(src[i]));
+		}
+
+		std::vector<float> back(count + 1, -1.0f);
+		HalfToFloatArray(dst.data(), back.data(), count);
+		CHECK_EQ(back[count], -1.0f);
+		for (size_t i = 0; i < count; i++)
+		{
+			CHECK_EQ(back[i], src[i]);
+		}
+	}
+}
+
+BENCH_CASE(Bench_Float16)
+{
+	const size_t kCount = 4 * 1024 * 1024;
+	std::vector<float> src(kCount);
+	for (size_t i = 0; i < kCount; i++)
+	{
+		src[i] = static_cast<float>(i) * 0.001f - 2000.0f;
+	}
+	std::vector<u16> dst(kCount);
+
+	struct Func
+	{
+		const char*	name;
+		void		(*func)(const float*, u16*, size_t);
+	};
+	const Func kFuncs[] = {
+		{ "Scalar", FloatToHalfArrayScalar },
+		{ "Hardware", FloatToHalfArrayHardware },
+	};
+	for (auto&& f : kFuncs)
+	{
+		if ((f.func == FloatToHalfArrayHardware) && !IsHardwareHalfSupported())
+		{
+			continue;
+		}
+		const int kLoop = 10;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < kLoop; i++)
+		{
+			f.func(src.data(), dst.data(), kCount);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double sec = std::chrono::duration<double>(end - start).count() / kLoop;
+		printf("  FloatToHalf %-8s : %.2f Gelem/s\n", f.name, kCount / sec * 1e-9);
+	}
+}
+
+
+//	EOF
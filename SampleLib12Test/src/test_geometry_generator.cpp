@@ -0,0 +1,161 @@
+﻿#include "test.h"
+#include <sl12/geometry_generator.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// Sample004 の圧縮頂点と同じ配置
+	static const GeometryVertexElement kCompressElements[] = {
+		{ GeometryAttribute::Position, GeometryFormat::Float32x3, 0 },
+		{ GeometryAttribute::Normal, GeometryFormat::Float16x4, sizeof(float) * 3 },
+	};
+	static const u32 kCompressStride = sizeof(float) * 3 + sizeof(u16) * 4;
+
+	// 要素の間に隙間のある配置
+	static const GeometryVertexElement kGapElements[] = {
+		{ GeometryAttribute::Position, GeometryFormat::Float32x3, 0 },
+		{ GeometryAttribute::Color, GeometryFormat::Unorm8x4, 16 },
+		{ GeometryAttribute::Normal, GeometryFormat::Snorm8x4, 24 },
+	};
+	static const u32 kGapStride = 32;
+
+	// 書き出し先を fill で埋めてから生成する
+	std::vector<u8> Generate(const GeometryGenerator& gen, u32 numThreads, u8 fill)
+	{
+		std::vector<u8> ret(gen.GetBufferSize(), fill);
+		gen.Generate(ret.data(), numThreads);
+		return ret;
+	}
+}
+
+// スレッド数や書き出し先の初期値によらず同じバイト列になる
+TEST_CASE(GeometryGenerator_Deterministic)
+{
+	struct Layout
+	{
+		const GeometryVertexElement*	pElements;
+		u32								numElements;
+		u32								stride;
+	};
+	const Layout kLayouts[] = {
+		{ kCompressElements, 2, kCompressStride },
+		{ kGapElements, 3, kGapStride },
+	};
+
+	for (auto&& layout : kLayouts)
+	{
+		// ジョブの単位で割り切れない三角形数
+		GeometryGenerator::Desc desc;
+		desc.triangleCount = 50000;
+		desc.seed = 1234;
+		GeometryGenerator gen;
+		CHECK(gen.Initialize(desc, layout.pElements, layout.numElements, layout.stride));
+
+		auto expected = Generate(gen, 1, 0x00);
+		CHECK(Generate(gen, 1, 0xcd) == expected);
+		CHECK(Generate(gen, 3, 0xcd) == expected);
+		CHECK(Generate(gen, 0, 0xff) == expected);
+
+		// 一部だけ生成しても同じ値になる
+		const u32 kFirst = 12345, kCount = 777;
+		std::vector<u8> part(static_cast<size_t>(kCount) * 3 * layout.stride, 0xcd);
+		gen.GenerateRange(part.data(), kFirst, kCount);
+		CHECK(memcmp(part.data(), expected.data() + static_cast<size_t>(kFirst) * 3 * layout.stride, part.size()) == 0);
+	}
+}
+
+// 書き出した座標は GetTriangle と一致し、シードを変えると別の三角形になる
+TEST_CASE(GeometryGenerator_MatchesTriangles)
+{
+	GeometryGenerator::Desc desc;
+	desc.triangleCount = 1000;
+	desc.seed = 7;
+	GeometryGenerator gen;
+	CHECK(gen.Initialize(desc, kCompressElements, 2, kCompressStride));
+	auto bytes = Generate(gen, 0, 0x00);
+
+	for (u32 t = 0; t < desc.triangleCount; t += 97)
+	{
+		GeneratedTriangle tri;
+		gen.GetTriangle(t, tri);
+		for (u32 v = 0; v < 3; v++)
+		{
+			float pos[3];
+			memcpy(pos, bytes.data() + (static_cast<size_t>(t) * 3 + v) * kCompressStride, sizeof(pos));
+			CHECK(memcmp(pos, tri.position[v], sizeof(pos)) == 0);
+			for (u32 i = 0; i < 3; i++)
+			{
+				CHECK(pos[i] >= -desc.positionRange - desc.triangleSize);
+				CHECK(pos[i] <= desc.positionRange + desc.triangleSize);
+			}
+		}
+	}
+
+	GeometryGenerator other;
+	desc.seed = 8;
+	CHECK(other.Initialize(desc, kCompressElements, 2, kCompressStride));
+	CHECK(Generate(other, 0, 0x00) != bytes);
+}
+
+// 頂点からはみ出す要素は受け付けない
+TEST_CASE(GeometryGenerator_InvalidLayout)
+{
+	GeometryGenerator::Desc desc;
+	desc.triangleCount = 1;
+	GeometryGenerator gen;
+	CHECK(!gen.Initialize(desc, kCompressElements, 2, kCompressStride - 1));
+	CHECK(!gen.Initialize(desc, kGapElements, 3, 24));
+}
+
+
+// 頂点フォーマットとスレッド数ごとの生成速度
+BENCH_CASE(Bench_GeometryGenerator)
+{
+	struct Layout
+	{
+		const char*						name;
+		const GeometryVertexElement*	pElements;
+		u32								numElements;
+		u32								stride;
+	};
+	const Layout kLayouts[] = {
+		{ "Float16x4 normal", kCompressElements, 2, kCompressStride },
+		{ "8bit color/normal", kGapElements, 3, kGapStride },
+	};
+	const u32 kThreadCounts[] = { 1, 2, 4, 0 };
+	const int kRuns = 5;
+
+	for (auto&& layout : kLayouts)
+	{
+		GeometryGenerator::Desc desc;
+		desc.triangleCount = 1000000;
+		GeometryGenerator gen;
+		gen.Initialize(desc, layout.pElements, layout.numElements, layout.stride);
+		std::vector<u8> buffer(gen.GetBufferSize());
+
+		for (u32 threads : kThreadCounts)
+		{
+			// 最初の1回はページフォルトを含むので除く
+			gen.Generate(buffer.data(), threads);
+			double best = 1e30;
+			for (int r = 0; r < kRuns; r++)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				gen.Generate(buffer.data(), threads);
+				auto end = std::chrono::high_resolution_clock::now();
+				best = std::min(best, std::chrono::duration<double>(end - start).count());
+			}
+			printf("  %-18s threads %u: %7.3f ms (%6.1f M triangles/s, %5.2f GB/s)\n",
+				layout.name, threads, best * 1000.0, desc.triangleCount / best / 1e6, buffer.size() / best / 1e9);
+		}
+	}
+}
+
+
+//	EOF
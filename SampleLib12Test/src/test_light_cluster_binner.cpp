@@ -0,0 +1,261 @@
+﻿#include "test.h"
+#include <sl12/light_cluster_binner.h>
+#include <sl12/point_light_set.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// Sample008 と同じグリッド
+	LightClusterBinner::GridDesc MakeGridDesc()
+	{
+		LightClusterBinner::GridDesc desc;
+		desc.screenWidth = 1920;
+		desc.screenHeight = 1080;
+		desc.tileSize = 64;
+		desc.sliceCount = 32;
+		desc.nearZ = 1.0f;
+		desc.farZ = 10000.0f;
+		desc.fovY = DirectX::XMConvertToRadians(60.0f);
+		return desc;
+	}
+
+	// 視錐台の内外にまたがるようにライトを配置する
+	void MakeLights(PointLightSet& lights, u32 count, u32 seed)
+	{
+		u32 state = seed;
+		auto next = [&state]()
+		{
+			state = state * 1664525u + 1013904223u;
+			return (float)(state >> 8) / 16777216.0f;
+		};
+
+		lights.Initialize(count);
+		for (u32 i = 0; i < count; i++)
+		{
+			DirectX::XMFLOAT3 pos(next() * 4000.0f - 2000.0f, next() * 1000.0f - 200.0f, next() * 4000.0f - 2000.0f);
+			float radius = 5.0f + next() * 200.0f;
+			lights.SetLight(i, pos, radius, DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+		}
+	}
+
+	// Sample008 と同じ配置. 半径が大きく、1つのライトが多数のクラスタにかかる
+	void MakeSampleLights(PointLightSet& lights, u32 count, u32 seed)
+	{
+		u32 state = seed;
+		auto next = [&state](float minV, float maxV)
+		{
+			state = state * 1664525u + 1013904223u;
+			return (maxV - minV) * (float)(state >> 8) / 16777216.0f + minV;
+		};
+
+		lights.Initialize(count);
+		for (u32 i = 0; i < count; i++)
+		{
+			DirectX::XMFLOAT3 pos;
+			pos.x = next(-1000.0f, 1000.0f);
+			pos.y = next(100.0f, 400.0f);
+			pos.z = next(-500.0f, 500.0f);
+			lights.SetLight(i, pos, next(100.0f, 500.0f), DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f));
+		}
+	}
+
+	DirectX::XMMATRIX MakeViewMatrix()
+	{
+		auto eye = DirectX::XMVectorSet(-1000.0f, 200.0f, 0.0f, 1.0f);
+		auto focus = DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		auto up = DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		return DirectX::XMMatrixLookAtRH(eye, focus, up);
+	}
+}
+
+// Bin はスレッド数によらず BinReference とビット単位で同じ結果になる
+TEST_CASE(LightClusterBinner_MatchesReference)
+{
+	LightClusterBinner binner;
+	CHECK(binner.Initialize(MakeGridDesc()));
+	auto mtxView = MakeViewMatrix();
+
+	// 端数のレーンと、複数スレッドに分かれるライト数
+	const u32 kLightCounts[] = { 1, 7, 1027 };
+	for (auto lightCount : kLightCounts)
+	{
+		PointLightSet lights;
+		MakeLights(lights, lightCount, lightCount);
+
+		u32 refTotal = binner.BinReference(lights, lightCount, mtxView);
+		std::vector<u32> refRanges = binner.GetClusterRanges();
+		std::vector<u32> refIndices = binner.GetLightIndices();
+		CHECK_EQ((u32)refIndices.size(), refTotal);
+		if (lightCount > 100)
+		{
+			CHECK(refTotal > lightCount);
+		}
+
+		const u32 kThreadCounts[] = { 1, 3, 0 };
+		for (auto numThreads : kThreadCounts)
+		{
+			u32 total = binner.Bin(lights, lightCount, mtxView, numThreads);
+			CHECK_EQ(total, refTotal);
+			CHECK(binner.GetClusterRanges() == refRanges);
+			CHECK(binner.GetLightIndices() == refIndices);
+		}
+	}
+}
+
+// 書き出しは容量を超えたクラスタの個数を切り詰める
+TEST_CASE(LightClusterBinner_WriteClamp)
+{
+	LightClusterBinner binner;
+	CHECK(binner.Initialize(MakeGridDesc()));
+
+	PointLightSet lights;
+	MakeLights(lights, 300, 1);
+	u32 total = binner.Bin(lights, 300, MakeViewMatrix(), 0);
+	CHECK(total > 0);
+
+	u32 maxIndices = total / 2;
+	std::vector<u32> ranges(binner.GetClusterCount() * 2);
+	std::vector<u32> indices(maxIndices);
+	binner.WriteClusterRanges(ranges.data(), maxIndices);
+	CHECK_EQ(binner.WriteLightIndices(indices.data(), maxIndices), maxIndices);
+	for (u32 c = 0; c < binner.GetClusterCount(); c++)
+	{
+		CHECK(ranges[c * 2 + 0] + ranges[c * 2 + 1] <= maxIndices);
+	}
+}
+
+// クラスタごとの上限を指定すると、上限なしの結果の先頭から上限までが残り、Bin と BinReference は一致する
+TEST_CASE(LightClusterBinner_MaxLightsPerCluster)
+{
+	const u32 kMaxLights = 16;
+	const u32 kLightCount = 1024;
+	PointLightSet lights;
+	MakeSampleLights(lights, kLightCount, 5);
+	auto mtxView = MakeViewMatrix();
+
+	LightClusterBinner full;
+	CHECK(full.Initialize(MakeGridDesc()));
+	full.Bin(lights, kLightCount, mtxView, 1);
+
+	LightClusterBinner::GridDesc desc = MakeGridDesc();
+	desc.maxLightsPerCluster = kMaxLights;
+	LightClusterBinner capped;
+	CHECK(capped.Initialize(desc));
+	CHECK_EQ(capped.GetMaxIndexCount(), capped.GetClusterCount() * kMaxLights);
+
+	u32 refTotal = capped.BinReference(lights, kLightCount, mtxView);
+	std::vector<u32> refRanges = capped.GetClusterRanges();
+	std::vector<u32> refIndices = capped.GetLightIndices();
+	CHECK(refTotal <= capped.GetMaxIndexCount());
+
+	// 上限に達するクラスタがあること
+	bool isSaturated = false;
+	for (u32 c = 0; c < capped.GetClusterCount(); c++)
+	{
+		u32 fullOffset = full.GetClusterRanges()[c * 2 + 0];
+		u32 fullCount = full.GetClusterRanges()[c * 2 + 1];
+		u32 offset = refRanges[c * 2 + 0];
+		u32 count = refRanges[c * 2 + 1];
+		CHECK_EQ(count, std::min(fullCount, kMaxLights));
+		isSaturated |= (fullCount > kMaxLights);
+		for (u32 i = 0; i < count; i++)
+		{
+			CHECK_EQ(refIndices[offset + i], full.GetLightIndices()[fullOffset + i]);
+		}
+	}
+	CHECK(isSaturated);
+
+	const u32 kThreadCounts[] = { 1, 3, 0 };
+	for (auto numThreads : kThreadCounts)
+	{
+		CHECK_EQ(capped.Bin(lights, kLightCount, mtxView, numThreads), refTotal);
+		CHECK(capped.GetClusterRanges() == refRanges);
+		CHECK(capped.GetLightIndices() == refIndices);
+	}
+}
+
+// スライス番号は範囲内に収まり、深度に対して単調に増える
+TEST_CASE(LightClusterBinner_Slice)
+{
+	LightClusterBinner binner;
+	CHECK(binner.Initialize(MakeGridDesc()));
+	CHECK_EQ(binner.GetSlice(0.0f), 0u);
+	CHECK_EQ(binner.GetSlice(1.0f), 0u);
+	CHECK_EQ(binner.GetSlice(20000.0f), 31u);
+
+	u32 prev = 0;
+	for (float z = 1.0f; z < 10000.0f; z *= 1.01f)
+	{
+		u32 slice = binner.GetSlice(z);
+		CHECK(slice >= prev);
+		prev = slice;
+	}
+
+	LightClusterBinner::GridDesc invalid = MakeGridDesc();
+	invalid.farZ = invalid.nearZ;
+	CHECK(!binner.Initialize(invalid));
+}
+
+BENCH_CASE(Bench_LightClusterBinner)
+{
+	LightClusterBinner binner;
+	binner.Initialize(MakeGridDesc());
+	PointLightSet lights;
+	MakeLights(lights, 65536, 3);
+	auto mtxView = MakeViewMatrix();
+
+	const u32 kThreadCounts[] = { 1, 0 };
+	for (auto numThreads : kThreadCounts)
+	{
+		const int kLoop = 20;
+		u32 total = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < kLoop; i++)
+		{
+			total += binner.Bin(lights, 65536, mtxView, numThreads);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration<double, std::milli>(end - start).count() / kLoop;
+		printf("  Bin 65536 lights, threads %u : %.3f ms (%u indices)\n", numThreads, ms, total / kLoop);
+	}
+}
+
+// Sample008 の配置でのライト数と上限ごとのコスト. 上限なしではインデックス数がライト数にほぼ比例して増える
+BENCH_CASE(Bench_LightClusterBinner_SampleScene)
+{
+	auto mtxView = MakeViewMatrix();
+	const u32 kLightCounts[] = { 1024, 4096 };
+	const u32 kMaxLights[] = { 0, 32 };
+	for (auto lightCount : kLightCounts)
+	{
+		PointLightSet lights;
+		MakeSampleLights(lights, lightCount, 7);
+		for (auto maxLights : kMaxLights)
+		{
+			LightClusterBinner::GridDesc desc = MakeGridDesc();
+			desc.maxLightsPerCluster = maxLights;
+			LightClusterBinner binner;
+			binner.Initialize(desc);
+
+			const int kLoop = 5;
+			u32 total = 0;
+			auto start = std::chrono::high_resolution_clock::now();
+			for (int i = 0; i < kLoop; i++)
+			{
+				total = binner.Bin(lights, lightCount, mtxView, 1);
+			}
+			auto end = std::chrono::high_resolution_clock::now();
+			double ms = std::chrono::duration<double, std::milli>(end - start).count() / kLoop;
+			printf("  Bin %u lights, max %u per cluster : %.3f ms (%u indices, %.1f MB)\n",
+				lightCount, maxLights, ms, total, (double)total * sizeof(u32) / (1024.0 * 1024.0));
+		}
+	}
+}
+
+
+//	EOF
@@ -0,0 +1,193 @@
+﻿#include "test.h"
+#include "test_mesh_data.h"
+#include <sl12/mesh_codec.h>
+#include <sl12/mesh_view.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// 同じメッシュノードから v1 と圧縮した v2 のバイナリを生成する
+	struct RoundTripData
+	{
+		std::vector<std::unique_ptr<MeshNode>>	nodes;
+		std::vector<char>						v1;
+		std::vector<char>						v2;
+	};
+
+	bool BuildRoundTripData(const std::vector<int>& sizes, RoundTripData& out)
+	{
+		ConvertOptions options;
+		std::vector<MeshNode*> meshes;
+		for (int size : sizes)
+		{
+			std::string name = "grid" + std::to_string(size);
+			out.nodes.push_back(test::CreateGridMeshNode(name.c_str(), size, 3, options));
+			meshes.push_back(out.nodes.back().get());
+		}
+
+		MaterialNode materials[3];
+		std::vector<MaterialNode*> material_ptrs;
+		for (auto&& mat : materials)
+		{
+			mat.name_ = "material";
+			material_ptrs.push_back(&mat);
+		}
+
+		if (!BuildMeshBinary(meshes, material_ptrs, options, out.v1))
+		{
+			return false;
+		}
+		options.compress = true;
+		return BuildMeshBinary(meshes, material_ptrs, options, out.v2);
+	}
+
+	// サブメッシュのインデックスを32bitに展開する
+	std::vector<u32> ReadIndices(const MeshView& view, u32 submeshIndex)
+	{
+		auto&& submesh = view.GetSubmeshes()[submeshIndex];
+		std::vector<u32> ret(submesh.numSubmeshIndices);
+		const void* p = view.GetIndexData(submeshIndex);
+		if (view.GetVersion() >= kMeshVersion2 && submesh.indexFormat == MeshStreamFormat::UInt16)
+		{
+			const u16* p16 = static_cast<const u16*>(p);
+			std::copy(p16, p16 + ret.size(), ret.begin());
+		}
+		else
+		{
+			memcpy(ret.data(), p, ret.size() * sizeof(u32));
+		}
+		return ret;
+	}
+}
+
+// v1 は元の頂点とビット単位で一致し、v2 は量子化誤差の範囲で一致する
+TEST_CASE(MeshCodec_RoundTripV1V2)
+{
+	RoundTripData data;
+	CHECK(BuildRoundTripData({ 9, 1, 30 }, data));
+
+	MeshView v1, v2;
+	CHECK(v1.Initialize(data.v1.data(), data.v1.size(), true));
+	CHECK(v2.Initialize(data.v2.data(), data.v2.size(), true));
+	CHECK_EQ(v1.GetVersion(), kMeshVersion1);
+	CHECK_EQ(v2.GetVersion(), kMeshVersion2);
+	CHECK_EQ(v1.GetShapes().size(), data.nodes.size());
+	CHECK_EQ(v2.GetShapes().size(), data.nodes.size());
+	CHECK(data.v2.size() < data.v1.size());
+	if (v1.GetShapes().size() != data.nodes.size() || v2.GetShapes().size() != data.nodes.size())
+	{
+		return;
+	}
+
+	for (u32 s = 0; s < (u32)data.nodes.size(); ++s)
+	{
+		auto&& node = *data.nodes[s];
+		auto&& shape = v2.GetShapes()[s];
+		u32 numVertices = (u32)node.vertices_.size();
+		CHECK_EQ(v1.GetShapes()[s].numVertices, numVertices);
+		CHECK_EQ(shape.numVertices, numVertices);
+
+		// v1
+		auto positions = v1.GetPositions(s);
+		auto normals = v1.GetNormals(s);
+		auto texcoords = v1.GetTexcoords(s);
+		CHECK_EQ(positions.size(), (u64)numVertices * 3);
+		CHECK_EQ(normals.size(), (u64)numVertices * 3);
+		CHECK_EQ(texcoords.size(), (u64)numVertices * 2);
+		for (u32 i = 0; i < numVertices && positions.size() == (u64)numVertices * 3; ++i)
+		{
+			auto&& v = node.vertices_[i];
+			CHECK(memcmp(&positions[i * 3], &v.position, sizeof(v.position)) == 0);
+			CHECK(memcmp(&normals[i * 3], &v.normal, sizeof(v.normal)) == 0);
+			CHECK(memcmp(&texcoords[i * 2], &v.texcoord, sizeof(v.texcoord)) == 0);
+		}
+
+		// v2
+		CHECK_EQ(shape.positionFormat, MeshStreamFormat::UNorm16x3);
+		CHECK_EQ(shape.normalFormat, MeshStreamFormat::OctSNorm16x2);
+		CHECK_EQ(shape.texcoordFormat, MeshStreamFormat::Half2);
+		std::vector<float> decPositions(numVertices * 3), decNormals(numVertices * 3), decTexcoords(numVertices * 2);
+		MeshDecodePositions(static_cast<const u16*>(v2.GetPositionData(s)), numVertices, shape.aabbMin, shape.aabbMax, decPositions.data());
+		MeshDecodeNormals(static_cast<const s16*>(v2.GetNormalData(s)), numVertices, decNormals.data());
+		MeshDecodeHalfs(static_cast<const u16*>(v2.GetTexcoordData(s)), (u64)numVertices * 2, decTexcoords.data());
+
+		float posTolerance[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			posTolerance[c] = (shape.aabbMax[c] - shape.aabbMin[c]) / 65535.0f + 1e-5f;
+		}
+		for (u32 i = 0; i < numVertices; ++i)
+		{
+			auto&& v = node.vertices_[i];
+			CHECK_NEAR(decPositions[i * 3 + 0], v.position.x, posTolerance[0]);
+			CHECK_NEAR(decPositions[i * 3 + 1], v.position.y, posTolerance[1]);
+			CHECK_NEAR(decPositions[i * 3 + 2], v.position.z, posTolerance[2]);
+
+			// 16bit八面体エンコードの誤差は 1e-4 程度
+			float dot = decNormals[i * 3 + 0] * v.normal.x + decNormals[i * 3 + 1] * v.normal.y + decNormals[i * 3 + 2] * v.normal.z;
+			CHECK(dot > 0.99999f);
+
+			// UVは [0, 1] なので half の誤差は 2^-11 以下
+			CHECK_NEAR(decTexcoords[i * 2 + 0], v.texcoord.x, 1.0f / 2048.0f);
+			CHECK_NEAR(decTexcoords[i * 2 + 1], v.texcoord.y, 1.0f / 2048.0f);
+		}
+	}
+
+	// インデックスは形式によらず一致する
+	CHECK_EQ(v1.GetSubmeshes().size(), v2.GetSubmeshes().size());
+	for (u32 i = 0; i < (u32)std::min(v1.GetSubmeshes().size(), v2.GetSubmeshes().size()); ++i)
+	{
+		CHECK_EQ(v2.GetSubmeshes()[i].indexFormat, MeshStreamFormat::UInt16);
+		CHECK(ReadIndices(v1, i) == ReadIndices(v2, i));
+	}
+}
+
+// v1 と v2 のファイルサイズと、v2 の頂点ストリームのデコード速度を計測する
+BENCH_CASE(Bench_MeshCodec)
+{
+	static const int kRuns = 5;
+
+	RoundTripData data;
+	CHECK(BuildRoundTripData({ 250, 250, 250, 250 }, data));
+
+	MeshView v2;
+	CHECK(v2.Initialize(data.v2.data(), data.v2.size()));
+	u64 totalVertices = 0;
+	for (auto&& shape : v2.GetShapes())
+	{
+		totalVertices += shape.numVertices;
+	}
+	printf("  v1 %.2f MB, v2 %.2f MB (%.1f%%), %llu vertices\n",
+		(double)data.v1.size() / (1024.0 * 1024.0), (double)data.v2.size() / (1024.0 * 1024.0),
+		100.0 * (double)data.v2.size() / (double)data.v1.size(), (unsigned long long)totalVertices);
+
+	std::vector<float> positions, normals, texcoords;
+	double best = 1e30;
+	for (int run = 0; run < kRuns; ++run)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (u32 s = 0; s < (u32)v2.GetShapes().size(); ++s)
+		{
+			auto&& shape = v2.GetShapes()[s];
+			positions.resize(shape.numVertices * 3);
+			normals.resize(shape.numVertices * 3);
+			texcoords.resize(shape.numVertices * 2);
+			MeshDecodePositions(static_cast<const u16*>(v2.GetPositionData(s)), shape.numVertices, shape.aabbMin, shape.aabbMax, positions.data());
+			MeshDecodeNormals(static_cast<const s16*>(v2.GetNormalData(s)), shape.numVertices, normals.data());
+			MeshDecodeHalfs(static_cast<const u16*>(v2.GetTexcoordData(s)), (u64)shape.numVertices * 2, texcoords.data());
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+	}
+	printf("  decode %.3f ms (%.1f M vertices/s)\n", best, (double)totalVertices / (best * 1000.0));
+}
+
+
+//	EOF
@@ -0,0 +1,94 @@
+﻿#pragma once
+
+#include "../../USDtoMesh/mesh_export.h"
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+
+namespace test
+{
+	/**
+	 * @brief (n x n) 個の四角形からなる波打ったグリッドのメッシュノードを作成する
+	 *
+	 * 法線とUVは角ごとに持ち、マテリアルはX方向に帯状に割り当てる.\n
+	 * 溶接、三角形化と最適化まで行う.
+	*/
+	inline std::unique_ptr<MeshNode> CreateGridMeshNode(const char* name, int n, int numMaterials, const ConvertOptions& options)
+	{
+		std::unique_ptr<MeshNode> mesh(new MeshNode);
+		mesh->name_ = name;
+
+		auto height = [](float x, float z)
+		{
+			return sinf(x * 0.3f) * cosf(z * 0.2f);
+		};
+		for (int y = 0; y <= n; ++y)
+		{
+			for (int x = 0; x <= n; ++x)
+			{
+				mesh->positions_.push_back({ (float)x, height((float)x, (float)y), (float)y });
+			}
+		}
+
+		std::vector<int> poly_materials;
+		for (int y = 0; y < n; ++y)
+		{
+			for (int x = 0; x < n; ++x)
+			{
+				int quad[4] = { y * (n + 1) + x, (y + 1) * (n + 1) + x, (y + 1) * (n + 1) + x + 1, y * (n + 1) + x + 1 };
+				for (int index : quad)
+				{
+					// 高さの勾配から法線を求める
+					auto&& p = mesh->positions_[index];
+					float dx = 0.3f * cosf(p.x * 0.3f) * cosf(p.z * 0.2f);
+					float dz = -0.2f * sinf(p.x * 0.3f) * sinf(p.z * 0.2f);
+					float len = sqrtf(dx * dx + 1.0f + dz * dz);
+					mesh->normals_.push_back({ -dx / len, 1.0f / len, -dz / len });
+					mesh->texcoords_.push_back({ p.x / (float)n, p.z / (float)n });
+					mesh->poly_vertex_indices_.push_back(index);
+				}
+				mesh->poly_vertex_counts_.push_back(4);
+				poly_materials.push_back(x * numMaterials / n);
+			}
+		}
+
+		TriangulateMeshNode(*mesh, poly_materials, options.weld_epsilon);
+		OptimizeMeshNode(*mesh, options);
+		return mesh;
+	}
+
+	/**
+	 * @brief 指定サイズのグリッドを1シェイプずつ持つ .mesh バイナリを生成する
+	 *
+	 * マテリアルは3つ
+	*/
+	inline bool BuildGridBinary(const ConvertOptions& options, const std::vector<int>& sizes, std::vector<char>& out, MeshBinaryInfo* pInfo = nullptr)
+	{
+		static const int kNumMaterials = 3;
+
+		std::vector<std::unique_ptr<MeshNode>> nodes;
+		std::vector<MeshNode*> meshes;
+		for (int size : sizes)
+		{
+			std::string name = "grid" + std::to_string(size);
+			nodes.push_back(CreateGridMeshNode(name.c_str(), size, kNumMaterials, options));
+			meshes.push_back(nodes.back().get());
+		}
+
+		MaterialNode materials[kNumMaterials];
+		std::vector<MaterialNode*> material_ptrs;
+		for (int i = 0; i < kNumMaterials; ++i)
+		{
+			materials[i].name_ = "material" + std::to_string(i);
+			material_ptrs.push_back(&materials[i]);
+		}
+
+		return BuildMeshBinary(meshes, material_ptrs, options, out, pInfo);
+	}
+
+}	// namespace test
+
+
+//	EOF
@@ -0,0 +1,158 @@
+﻿#include "test.h"
+#include "test_mesh_data.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <vector>
+
+
+namespace
+{
+	// サイズの異なる複数のシェイプから .mesh バイナリを生成する
+	bool BuildGridBinary(const ConvertOptions& options, std::vector<char>& out, MeshBinaryInfo* pInfo = nullptr)
+	{
+		return test::BuildGridBinary(options, { 12, 3, 40, 1, 25 }, out, pInfo);
+	}
+}
+
+// スレッド数を変えても出力がバイト単位で一致する
+TEST_CASE(MeshExport_SameOutputAcrossThreadCounts)
+{
+	ConvertOptions variants[3];
+	variants[1].compress = true;
+	variants[2].compress = true;
+	variants[2].build_meshlets = true;
+	variants[2].num_lods = 2;
+
+	for (auto&& base : variants)
+	{
+		std::vector<char> reference;
+		MeshBinaryInfo info;
+		ConvertOptions options = base;
+		options.num_threads = 1;
+		CHECK(BuildGridBinary(options, reference, &info));
+		CHECK(!reference.empty());
+		CHECK_EQ(info.version, (options.compress || options.build_meshlets) ? sl12::kMeshVersion2 : sl12::kMeshVersion1);
+		CHECK_EQ(info.numMeshlets > 0, options.build_meshlets);
+		CHECK_EQ(info.numLods > 0, options.num_lods > 0);
+
+		for (int num_threads : { 2, 3, 8 })
+		{
+			std::vector<char> binary;
+			options.num_threads = num_threads;
+			CHECK(BuildGridBinary(options, binary));
+			CHECK(binary == reference);
+		}
+	}
+}
+
+
+// チャンクの先頭とサイズが8byteアラインで、頂点領域に収まる
+TEST_CASE(MeshExport_ChunkAlignment)
+{
+	ConvertOptions options;
+	options.build_meshlets = true;
+	options.num_lods = 2;
+
+	for (bool compress : { false, true })
+	{
+		options.compress = compress;
+		std::vector<char> binary;
+		CHECK(BuildGridBinary(options, binary));
+
+		sl12::MeshHead head;
+		memcpy(&head, binary.data(), sizeof(head));
+		CHECK((head.flags & sl12::MeshFlag::Chunk) != 0);
+
+		size_t offset = sizeof(sl12::MeshHead)
+			+ sizeof(sl12::MeshShape) * head.numShapes
+			+ sizeof(sl12::MeshMaterial) * head.numMaterials
+			+ sizeof(sl12::MeshSubmesh) * head.numSubmeshes;
+		sl12::MeshChunkTable table;
+		memcpy(&table, binary.data() + offset, sizeof(table));
+		CHECK_EQ(table.numChunks, 2u);
+		offset += sizeof(table);
+
+		size_t vertex_head = offset + sizeof(sl12::MeshChunk) * table.numChunks;
+		CHECK_EQ(vertex_head % 8, 0u);
+		for (sl12::u32 i = 0; i < table.numChunks; ++i)
+		{
+			sl12::MeshChunk chunk;
+			memcpy(&chunk, binary.data() + offset + sizeof(chunk) * i, sizeof(chunk));
+			CHECK_EQ(chunk.offset % 8, 0u);
+			CHECK_EQ(chunk.size % 8, 0u);
+			CHECK(vertex_head + chunk.offset + chunk.size <= binary.size());
+		}
+	}
+}
+
+
+// 頂点溶接の処理速度 (角/秒) を計測する
+// 角ごとの頂点は隣接する4つの四角形で共有されるので、一意な頂点数は角の数の約1/4になる
+BENCH_CASE(Bench_VertexWelder)
+{
+	static const int kGridSize = 700;
+	static const int kRuns = 3;
+
+	// 平面グリッドの四角形ごとの角を並べる
+	std::vector<Vertex> corners;
+	corners.reserve((size_t)kGridSize * kGridSize * 4);
+	for (int y = 0; y < kGridSize; ++y)
+	{
+		for (int x = 0; x < kGridSize; ++x)
+		{
+			int quad[4] = { y * (kGridSize + 1) + x, (y + 1) * (kGridSize + 1) + x, (y + 1) * (kGridSize + 1) + x + 1, y * (kGridSize + 1) + x + 1 };
+			for (int index : quad)
+			{
+				Vertex v;
+				v.position = { (float)(index % (kGridSize + 1)), 0.0f, (float)(index / (kGridSize + 1)) };
+				v.normal = { 0.0f, 1.0f, 0.0f };
+				v.texcoord = { v.position.x / (float)kGridSize, v.position.z / (float)kGridSize };
+				corners.push_back(v);
+			}
+		}
+	}
+
+	auto report = [&](const char* label, double ms, size_t unique)
+	{
+		printf("  %-20s %8.3f ms, %7.1f M corners/s, %zu unique\n", label, ms, (double)corners.size() / (ms * 1000.0), unique);
+	};
+
+	for (float epsilon : { 0.0f, 1e-3f })
+	{
+		double best = 1e30;
+		size_t unique = 0;
+		for (int run = 0; run < kRuns; ++run)
+		{
+			std::vector<Vertex> vertices;
+			vertices.reserve(corners.size());
+			auto start = std::chrono::high_resolution_clock::now();
+			VertexWelder welder(corners.size(), epsilon);
+			for (auto&& v : corners)
+			{
+				welder.FindOrAdd(v, vertices);
+			}
+			auto end = std::chrono::high_resolution_clock::now();
+			best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+			unique = vertices.size();
+		}
+		CHECK_EQ(unique, (size_t)(kGridSize + 1) * (kGridSize + 1));
+		report(epsilon > 0.0f ? "welder (eps 1e-3)" : "welder (exact)", best, unique);
+	}
+
+	// 比較用に std::map で重複を検出する
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		std::map<Vertex, int> map;
+		for (auto&& v : corners)
+		{
+			map.insert(std::make_pair(v, (int)map.size()));
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		report("std::map", std::chrono::duration<double, std::milli>(end - start).count(), map.size());
+	}
+}
+
+
+//	EOF
@@ -0,0 +1,90 @@
+﻿#include "test.h"
+#include "test_mesh_data.h"
+#include "../../USDtoMesh/mesh_simplify.h"
+#include <vector>
+
+
+namespace
+{
+	SimplifyVertexInput MakeInput(const MeshNode& mesh)
+	{
+		SimplifyVertexInput input;
+		input.pPositions = &mesh.vertices_[0].position.x;
+		input.pNormals = &mesh.vertices_[0].normal.x;
+		input.pTexcoords = &mesh.vertices_[0].texcoord.x;
+		input.stride = sizeof(Vertex);
+		input.numVertices = (uint32_t)mesh.vertices_.size();
+		return input;
+	}
+
+	// 縮退した三角形と範囲外のインデックスを含まない
+	bool IsValidTriangles(const std::vector<uint32_t>& indices, uint32_t numVertices)
+	{
+		if (indices.size() % 3 != 0)
+		{
+			return false;
+		}
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			if (a >= numVertices || b >= numVertices || c >= numVertices || a == b || b == c || c == a)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+// LODが進むごとに三角形数は減り、誤差は減らない
+TEST_CASE(MeshSimplify_MonotonicChain)
+{
+	ConvertOptions options;
+	auto mesh = test::CreateGridMeshNode("grid", 40, 1, options);
+	auto&& lod0 = mesh->sub_mesh_indices_.begin()->second;
+	auto input = MakeInput(*mesh);
+
+	std::vector<SimplifyLod> lods;
+	SimplifyLodChain(lod0, input, 5, 0.5f, 1.0f, lods);
+	CHECK(lods.size() >= 3);
+
+	size_t prevCount = lod0.size();
+	float prevError = 0.0f;
+	for (auto&& lod : lods)
+	{
+		CHECK(IsValidTriangles(lod.indices, input.numVertices));
+		CHECK(!lod.indices.empty());
+		CHECK(lod.indices.size() < prevCount);
+		CHECK(lod.error >= prevError);
+		prevCount = lod.indices.size();
+		prevError = lod.error;
+	}
+
+	// 波打った面なので、最も粗いLODの誤差は0にならない
+	CHECK(!lods.empty() && lods.back().error > 0.0f);
+}
+
+// 平面の簡略化では幾何誤差がほぼ0になる
+TEST_CASE(MeshSimplify_FlatPlaneHasNoError)
+{
+	ConvertOptions options;
+	auto mesh = test::CreateGridMeshNode("grid", 20, 1, options);
+	for (auto&& v : mesh->vertices_)
+	{
+		v.position.y = 0.0f;
+		v.normal = { 0.0f, 1.0f, 0.0f };
+	}
+	auto&& lod0 = mesh->sub_mesh_indices_.begin()->second;
+
+	std::vector<SimplifyLod> lods;
+	SimplifyLodChain(lod0, MakeInput(*mesh), 3, 0.5f, 1.0f, lods);
+	CHECK(!lods.empty());
+	for (auto&& lod : lods)
+	{
+		CHECK(lod.indices.size() < lod0.size());
+		CHECK_NEAR(lod.error, 0.0f, 1e-4f);
+	}
+}
+
+
+//	EOF
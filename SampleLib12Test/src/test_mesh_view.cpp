@@ -0,0 +1,215 @@
+﻿#include "test.h"
+#include "test_mesh_data.h"
+#include <sl12/mesh_view.h>
+#include <sl12/file.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// 検証の対象とするバイナリのバリエーション
+	struct Variant
+	{
+		const char*	name;
+		bool		compress;
+		bool		meshlets;
+		u32			lods;
+	};
+	const Variant kVariants[] =
+	{
+		{ "v1", false, false, 0 },
+		{ "v2 compressed", true, false, 0 },
+		{ "v2 meshlet+lod", false, true, 2 },
+		{ "v2 compressed meshlet+lod", true, true, 2 },
+	};
+
+	ConvertOptions MakeOptions(const Variant& variant)
+	{
+		ConvertOptions options;
+		options.compress = variant.compress;
+		options.build_meshlets = variant.meshlets;
+		options.num_lods = variant.lods;
+		return options;
+	}
+}
+
+// エクスポータの出力を検証して読み込める
+TEST_CASE(MeshView_AcceptsExporterOutput)
+{
+	const std::vector<int> sizes = { 6, 1, 17 };
+	for (auto&& variant : kVariants)
+	{
+		std::vector<char> binary;
+		MeshBinaryInfo info;
+		CHECK(test::BuildGridBinary(MakeOptions(variant), sizes, binary, &info));
+
+		MeshView view;
+		CHECK(view.Initialize(binary.data(), binary.size(), true));
+		CHECK(view.IsValid());
+		CHECK_EQ(view.GetVersion(), info.version);
+		CHECK_EQ(view.GetShapes().size(), sizes.size());
+		CHECK_EQ(view.GetMaterials().size(), 3u);
+		CHECK_EQ(view.HasMeshlets(), variant.meshlets);
+
+		u32 numSubmeshLods = 0;
+		for (u32 i = 0; i < view.GetSubmeshes().size(); ++i)
+		{
+			numSubmeshLods += view.GetSubmeshLodCount(i) - 1;
+		}
+		CHECK_EQ(numSubmeshLods > 0, variant.lods > 0);
+
+		// 非圧縮の場合はストリームをそのまま参照できる
+		for (u32 i = 0; i < view.GetShapes().size(); ++i)
+		{
+			u64 numVertices = view.GetShapes()[i].numVertices;
+			CHECK_EQ(view.GetPositions(i).size(), variant.compress ? 0 : numVertices * 3);
+			CHECK_EQ(view.GetTexcoords(i).size(), variant.compress ? 0 : numVertices * 2);
+		}
+	}
+}
+
+// 途中で切れたバイナリはどの位置で切れても初期化に失敗する
+TEST_CASE(MeshView_RejectsTruncated)
+{
+	for (auto&& variant : kVariants)
+	{
+		// 16bitインデックスの末尾のパディングは切り落としても有効なので、32bitインデックスのみを対象とする
+		if (variant.compress)
+		{
+			continue;
+		}
+
+		std::vector<char> binary;
+		CHECK(test::BuildGridBinary(MakeOptions(variant), { 2, 3 }, binary));
+
+		for (size_t size = 0; size < binary.size(); ++size)
+		{
+			// 切れた位置より後ろを読まないよう、ちょうどのサイズの領域にコピーする
+			std::vector<char> truncated(binary.begin(), binary.begin() + size);
+			MeshView view;
+			bool accepted = view.Initialize(truncated.data(), truncated.size(), true);
+			CHECK(!accepted);
+			CHECK(!view.IsValid());
+			if (accepted)
+			{
+				break;
+			}
+		}
+	}
+}
+
+// 画面上の誤差に収まる最も粗いLODを選択し、遠ざかるほど粗いLODになる
+TEST_CASE(MeshView_SelectLod)
+{
+	static const float kProjScale = 1080.0f / (2.0f * 0.41421356f);	// 1080p, fovY 45度
+	static const float kPixelError = 1.0f;
+
+	ConvertOptions options;
+	options.num_lods = 3;
+	std::vector<char> binary;
+	CHECK(test::BuildGridBinary(options, { 30 }, binary));
+
+	MeshView view;
+	CHECK(view.Initialize(binary.data(), binary.size(), true));
+	CHECK(view.GetSubmeshes().size() > 0);
+	for (u32 s = 0; s < (u32)view.GetSubmeshes().size(); ++s)
+	{
+		u32 lodCount = view.GetSubmeshLodCount(s);
+		CHECK(lodCount > 1);
+		auto&& shape = view.GetShapes()[view.GetSubmeshes()[s].shapeIndex];
+
+		// AABB内部では常にLOD0
+		float center[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			center[i] = (shape.aabbMin[i] + shape.aabbMax[i]) * 0.5f;
+		}
+		CHECK_EQ(view.SelectLod(s, center, kProjScale, 1000.0f), 0u);
+
+		// +Y方向に遠ざける
+		u32 prevLod = 0;
+		for (float dist = 0.5f; dist < 1e6f; dist *= 2.0f)
+		{
+			float pos[3] = { center[0], shape.aabbMax[1] + dist, center[2] };
+			u32 lod = view.SelectLod(s, pos, kProjScale, kPixelError);
+			CHECK(lod < lodCount);
+			CHECK(lod >= prevLod);
+			prevLod = lod;
+
+			// 選択したLODは許容誤差以下で、次のLODは許容誤差を超える
+			float maxError = kPixelError * dist / kProjScale;
+			if (lod > 0)
+			{
+				CHECK(view.GetSubmeshLod(s, lod)->error <= maxError);
+			}
+			if (lod + 1 < lodCount)
+			{
+				CHECK(view.GetSubmeshLod(s, lod + 1)->error > maxError);
+			}
+		}
+		CHECK_EQ(prevLod, lodCount - 1);
+
+		// 許容誤差が0ならLOD0
+		float far[3] = { center[0], shape.aabbMax[1] + 1000.0f, center[2] };
+		CHECK_EQ(view.SelectLod(s, far, kProjScale, 0.0f), 0u);
+	}
+}
+
+// ifstream で全体を読み込む場合と、メモリマップする場合の読み込み時間を比較する
+BENCH_CASE(Bench_MeshViewLoad)
+{
+	static const char* kFilename = "Bench_MeshViewLoad.mesh";
+	static const int kRuns = 5;
+
+	ConvertOptions options;
+	options.compress = true;
+	std::vector<char> binary;
+	CHECK(test::BuildGridBinary(options, { 400, 300, 300, 200 }, binary));
+
+	FILE* fp = fopen(kFilename, "wb");
+	CHECK(fp != nullptr);
+	if (!fp)
+	{
+		return;
+	}
+	fwrite(binary.data(), binary.size(), 1, fp);
+	fclose(fp);
+	printf("  file size %.2f MB\n", (double)binary.size() / (1024.0 * 1024.0));
+
+	for (bool checkIndexRange : { false, true })
+	{
+		double best_read = 1e30, best_map = 1e30;
+		for (int run = 0; run < kRuns; ++run)
+		{
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				File file;
+				CHECK(file.ReadFile(kFilename));
+				MeshView view;
+				CHECK(view.Initialize(file.GetData(), file.GetSize(), checkIndexRange));
+				auto end = std::chrono::high_resolution_clock::now();
+				best_read = std::min(best_read, std::chrono::duration<double, std::milli>(end - start).count());
+			}
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				MappedFile file;
+				CHECK(file.Open(kFilename));
+				MeshView view;
+				CHECK(view.Initialize(file.GetData(), file.GetSize(), checkIndexRange));
+				auto end = std::chrono::high_resolution_clock::now();
+				best_map = std::min(best_map, std::chrono::duration<double, std::milli>(end - start).count());
+			}
+		}
+		printf("  %-16s ifstream %8.3f ms, mmap %8.3f ms\n", checkIndexRange ? "index check" : "header only", best_read, best_map);
+	}
+
+	remove(kFilename);
+}
+
+
+//	EOF
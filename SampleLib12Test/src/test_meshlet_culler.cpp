@@ -0,0 +1,210 @@
+﻿#include "test.h"
+#include <sl12/meshlet_culler.h>
+#include <chrono>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	MeshMeshlet CreateMeshlet(float cx, float cy, float cz, float radius)
+	{
+		MeshMeshlet m = {};
+		m.center[0] = cx;
+		m.center[1] = cy;
+		m.center[2] = cz;
+		m.radius = radius;
+		m.coneApex[0] = cx;
+		m.coneApex[1] = cy;
+		m.coneApex[2] = cz;
+		m.coneCutoff = 1.0f;
+		return m;
+	}
+
+	void SetCone(MeshMeshlet& m, float ax, float ay, float az, float cutoff)
+	{
+		m.coneAxis[0] = ax;
+		m.coneAxis[1] = ay;
+		m.coneAxis[2] = az;
+		m.coneCutoff = cutoff;
+	}
+
+	MeshSpan<MeshMeshlet> ToSpan(const std::vector<MeshMeshlet>& meshlets)
+	{
+		MeshSpan<MeshMeshlet> span;
+		span.pData = meshlets.data();
+		span.count = meshlets.size();
+		return span;
+	}
+
+	// 原点を中心とした [-size, size] の立方体の内向きの6平面
+	void CreateBoxPlanes(float size, DirectX::XMFLOAT4* pPlanes)
+	{
+		pPlanes[0] = DirectX::XMFLOAT4( 1.0f, 0.0f, 0.0f, size);
+		pPlanes[1] = DirectX::XMFLOAT4(-1.0f, 0.0f, 0.0f, size);
+		pPlanes[2] = DirectX::XMFLOAT4(0.0f,  1.0f, 0.0f, size);
+		pPlanes[3] = DirectX::XMFLOAT4(0.0f, -1.0f, 0.0f, size);
+		pPlanes[4] = DirectX::XMFLOAT4(0.0f, 0.0f,  1.0f, size);
+		pPlanes[5] = DirectX::XMFLOAT4(0.0f, 0.0f, -1.0f, size);
+	}
+}
+
+// コーンが無効なメッシュレットは、カメラがコーンの頂点に一致しても可視
+TEST_CASE(MeshletCuller_ConeDisabledAtApex)
+{
+	std::vector<MeshMeshlet> meshlets;
+	meshlets.push_back(CreateMeshlet(0.0f, 0.0f, 0.0f, 1.0f));
+	meshlets.push_back(CreateMeshlet(2.0f, 0.0f, 0.0f, 1.0f));
+	SetCone(meshlets[1], 0.0f, 0.0f, 1.0f, 1.0f);
+
+	MeshletCuller culler;
+	CHECK(culler.Initialize(ToSpan(meshlets)));
+
+	for (u32 i = 0; i < 2; i++)
+	{
+		DirectX::XMFLOAT3 camera(meshlets[i].coneApex[0], meshlets[i].coneApex[1], meshlets[i].coneApex[2]);
+		std::vector<u32> visible, visibleRef;
+		CHECK_EQ(culler.Cull(nullptr, 0, camera, 0, 2, visible), 2u);
+		CHECK_EQ(culler.CullReference(nullptr, 0, camera, 0, 2, visibleRef), 2u);
+		CHECK(visible == visibleRef);
+	}
+}
+
+// コーンの後ろ側からは裏向きとしてカリングされる
+TEST_CASE(MeshletCuller_ConeBackface)
+{
+	std::vector<MeshMeshlet> meshlets;
+	meshlets.push_back(CreateMeshlet(0.0f, 0.0f, 0.0f, 1.0f));
+	SetCone(meshlets[0], 0.0f, 0.0f, 1.0f, 0.5f);
+
+	MeshletCuller culler;
+	CHECK(culler.Initialize(ToSpan(meshlets)));
+
+	std::vector<u32> visible;
+	// 法線はすべて -z 寄り. -z 側のカメラからは表、+z 側からは裏
+	CHECK_EQ(culler.Cull(nullptr, 0, DirectX::XMFLOAT3(0.0f, 0.0f, 5.0f), 0, 1, visible), 1u);
+	CHECK_EQ(culler.Cull(nullptr, 0, DirectX::XMFLOAT3(0.0f, 0.0f, -5.0f), 0, 1, visible), 0u);
+	CHECK_EQ(culler.CullReference(nullptr, 0, DirectX::XMFLOAT3(0.0f, 0.0f, -5.0f), 0, 1, visible), 0u);
+	// コーンの外側 (真横) からは可視
+	CHECK_EQ(culler.Cull(nullptr, 0, DirectX::XMFLOAT3(5.0f, 0.0f, 0.0f), 0, 1, visible), 1u);
+}
+
+// 平面の外側に完全に出ている球だけがカリングされる
+TEST_CASE(MeshletCuller_Frustum)
+{
+	std::vector<MeshMeshlet> meshlets;
+	meshlets.push_back(CreateMeshlet(0.0f, 0.0f, 0.0f, 1.0f));		// 内側
+	meshlets.push_back(CreateMeshlet(10.5f, 0.0f, 0.0f, 1.0f));		// 境界と交差
+	meshlets.push_back(CreateMeshlet(0.0f, -12.0f, 0.0f, 1.0f));	// 外側
+	meshlets.push_back(CreateMeshlet(0.0f, 0.0f, 20.0f, 5.0f));		// 外側
+	meshlets.push_back(CreateMeshlet(0.0f, 0.0f, 14.0f, 5.0f));		// 境界と交差
+
+	MeshletCuller culler;
+	CHECK(culler.Initialize(ToSpan(meshlets)));
+
+	DirectX::XMFLOAT4 planes[6];
+	CreateBoxPlanes(10.0f, planes);
+	std::vector<u32> visible;
+	CHECK_EQ(culler.Cull(planes, 6, DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), 0, 5, visible), 3u);
+	std::vector<u32> expected = { 0, 1, 4 };
+	CHECK(visible == expected);
+}
+
+// SIMD版とスカラー版がランダムな入力と範囲で一致する
+TEST_CASE(MeshletCuller_MatchesReference)
+{
+	u32 seed = 1;
+	auto rand01 = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return static_cast<float>(seed >> 8) / 16777216.0f;
+	};
+
+	std::vector<MeshMeshlet> meshlets;
+	for (u32 i = 0; i < 1023; i++)
+	{
+		MeshMeshlet m = CreateMeshlet(rand01() * 40.0f - 20.0f, rand01() * 40.0f - 20.0f, rand01() * 40.0f - 20.0f, rand01() * 3.0f);
+		float ax = rand01() - 0.5f, ay = rand01() - 0.5f, az = rand01() - 0.5f;
+		float len = sqrtf(ax * ax + ay * ay + az * az);
+		// 一部はコーン無効とし、一部はコーンの頂点にカメラを置く
+		SetCone(m, ax / len, ay / len, az / len, (i % 5 == 0) ? 1.0f : rand01());
+		m.coneApex[0] -= m.coneAxis[0] * 2.0f;
+		m.coneApex[1] -= m.coneAxis[1] * 2.0f;
+		m.coneApex[2] -= m.coneAxis[2] * 2.0f;
+		meshlets.push_back(m);
+	}
+
+	MeshletCuller culler;
+	CHECK(culler.Initialize(ToSpan(meshlets)));
+	CHECK_EQ(culler.GetMeshletCount(), 1023u);
+
+	DirectX::XMFLOAT4 planes[6];
+	CreateBoxPlanes(12.0f, planes);
+	for (u32 iter = 0; iter < 64; iter++)
+	{
+		u32 first = static_cast<u32>(rand01() * 1023.0f);
+		u32 count = static_cast<u32>(rand01() * (1023 - first));
+		DirectX::XMFLOAT3 camera(rand01() * 30.0f - 15.0f, rand01() * 30.0f - 15.0f, rand01() * 30.0f - 15.0f);
+		if (iter % 8 == 0)
+		{
+			auto&& m = meshlets[first];
+			camera = DirectX::XMFLOAT3(m.coneApex[0], m.coneApex[1], m.coneApex[2]);
+		}
+
+		std::vector<u32> visible, visibleRef;
+		u32 n = culler.Cull(planes, 6, camera, first, count, visible);
+		u32 nRef = culler.CullReference(planes, 6, camera, first, count, visibleRef);
+		CHECK_EQ(n, nRef);
+		CHECK(visible == visibleRef);
+	}
+}
+
+// SIMD版とスカラー版の処理時間を出力する
+BENCH_CASE(Bench_MeshletCuller)
+{
+	std::vector<MeshMeshlet> meshlets;
+	u32 seed = 1;
+	for (u32 i = 0; i < 65536; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		float x = static_cast<float>(seed % 1000) * 0.1f - 50.0f;
+		float y = static_cast<float>((seed >> 10) % 1000) * 0.1f - 50.0f;
+		MeshMeshlet m = CreateMeshlet(x, y, 0.0f, 0.5f);
+		SetCone(m, 0.0f, 0.0f, (i & 1) ? 1.0f : -1.0f, 0.5f);
+		meshlets.push_back(m);
+	}
+	MeshletCuller culler;
+	culler.Initialize(ToSpan(meshlets));
+
+	DirectX::XMFLOAT4 planes[6];
+	CreateBoxPlanes(25.0f, planes);
+	DirectX::XMFLOAT3 camera(0.0f, 0.0f, -10.0f);
+	std::vector<u32> visible;
+	visible.reserve(meshlets.size());
+
+	const int kLoop = 100;
+	double ms[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int i = 0; i < kLoop; i++)
+		{
+			visible.clear();
+			if (mode == 0)
+			{
+				culler.Cull(planes, 6, camera, 0, culler.GetMeshletCount(), visible);
+			}
+			else
+			{
+				culler.CullReference(planes, 6, camera, 0, culler.GetMeshletCount(), visible);
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		ms[mode] = std::chrono::duration<double, std::milli>(end - start).count() / kLoop;
+	}
+	printf("  %u meshlets, %zu visible  Cull %.3f ms  CullReference %.3f ms\n", culler.GetMeshletCount(), visible.size(), ms[0], ms[1]);
+}
+
+
+//	EOF
@@ -0,0 +1,204 @@
+﻿#include "test.h"
+#include <sl12/point_light_set.h>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// 書き出し範囲外を検出する値
+	static const float kSentinel = -12345.0f;
+
+	void MakeLights(PointLightSet& lights, u32 count)
+	{
+		lights.Initialize(count);
+		for (u32 i = 0; i < count; i++)
+		{
+			float f = (float)i;
+			lights.SetLight(i, DirectX::XMFLOAT3(f * 3.0f - 10.0f, f * 0.5f + 1.0f, 20.0f - f * 2.0f), 1.0f + f, DirectX::XMFLOAT3(f * 0.1f, f * 0.2f, f * 0.3f));
+		}
+	}
+
+	DirectX::XMMATRIX MakeMatrix()
+	{
+		return DirectX::XMMatrixMultiply(DirectX::XMMatrixRotationY(0.7f), DirectX::XMMatrixTranslation(5.0f, -3.0f, 100.0f));
+	}
+
+	bool IsNear(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b)
+	{
+		const float eps = 1e-4f;
+		return std::fabs(a.x - b.x) <= eps * std::fmax(1.0f, std::fabs(b.x))
+			&& std::fabs(a.y - b.y) <= eps * std::fmax(1.0f, std::fabs(b.y))
+			&& std::fabs(a.z - b.z) <= eps * std::fmax(1.0f, std::fabs(b.z))
+			&& a.w == b.w;
+	}
+
+	bool IsSentinel(const DirectX::XMFLOAT4& v)
+	{
+		return v.x == kSentinel && v.y == kSentinel && v.z == kSentinel && v.w == kSentinel;
+	}
+}
+
+// 初期化直後は原点、半径0、黒で、端数のレーンは0
+TEST_CASE(PointLightSet_Initialize)
+{
+	PointLightSet lights;
+	CHECK(lights.Initialize(6));
+	CHECK_EQ(lights.GetLightCount(), 6u);
+	CHECK_EQ(lights.GetBlockCount(), 2u);
+	for (u32 i = 0; i < 6; i++)
+	{
+		auto pr = lights.GetPosAndRadius(i);
+		CHECK(pr.x == 0.0f && pr.y == 0.0f && pr.z == 0.0f && pr.w == 0.0f);
+	}
+
+	lights.SetLight(5, DirectX::XMFLOAT3(1.0f, 2.0f, 3.0f), 4.0f, DirectX::XMFLOAT3(0.5f, 0.25f, 0.125f));
+	auto pr = lights.GetPosAndRadius(5);
+	CHECK(pr.x == 1.0f && pr.y == 2.0f && pr.z == 3.0f && pr.w == 4.0f);
+
+	// ライト6, 7 のレーンは0のまま
+	const DirectX::XMVECTOR* e = lights.GetPosBlock(1);
+	for (u32 c = 0; c < 4; c++)
+	{
+		CHECK_EQ(DirectX::XMVectorGetByIndex(e[c], 2), 0.0f);
+		CHECK_EQ(DirectX::XMVectorGetByIndex(e[c], 3), 0.0f);
+	}
+	CHECK_EQ(DirectX::XMVectorGetByIndex(e[3], 1), 4.0f);
+}
+
+// 4ライト境界にそろわない範囲でも指定したライトだけを書き出す
+TEST_CASE(PointLightSet_Write)
+{
+	const u32 kCount = 11;
+	PointLightSet lights;
+	MakeLights(lights, kCount);
+
+	for (u32 first = 0; first < kCount; first++)
+	{
+		for (u32 count = 0; first + count <= kCount; count++)
+		{
+			std::vector<DirectX::XMFLOAT4> pos(count + 1, DirectX::XMFLOAT4(kSentinel, kSentinel, kSentinel, kSentinel));
+			std::vector<DirectX::XMFLOAT4> color(pos);
+			lights.WritePosAndRadius(first, count, pos.data());
+			lights.WriteColor(first, count, color.data());
+
+			bool isMatch = true;
+			for (u32 i = 0; i < count; i++)
+			{
+				float f = (float)(first + i);
+				auto&& p = pos[i];
+				auto&& c = color[i];
+				isMatch = isMatch && p.x == f * 3.0f - 10.0f && p.y == f * 0.5f + 1.0f && p.z == 20.0f - f * 2.0f && p.w == 1.0f + f;
+				isMatch = isMatch && c.x == f * 0.1f && c.y == f * 0.2f && c.z == f * 0.3f && c.w == 1.0f;
+			}
+			CHECK(isMatch);
+			CHECK(IsSentinel(pos[count]));
+			CHECK(IsSentinel(color[count]));
+		}
+	}
+}
+
+// Transform は範囲内のライトだけを変換し、TransformReference と同じ結果になる
+TEST_CASE(PointLightSet_TransformMatchesReference)
+{
+	const u32 kCount = 13;
+	const auto mtx = MakeMatrix();
+	const u32 ranges[][2] = { { 0, 13 }, { 0, 4 }, { 1, 6 }, { 3, 1 }, { 5, 8 }, { 12, 1 }, { 4, 0 } };
+	for (auto&& range : ranges)
+	{
+		const u32 first = range[0], count = range[1];
+		PointLightSet fast, ref;
+		MakeLights(fast, kCount);
+		MakeLights(ref, kCount);
+
+		std::vector<DirectX::XMFLOAT4> outFast(count + 1, DirectX::XMFLOAT4(kSentinel, kSentinel, kSentinel, kSentinel));
+		std::vector<DirectX::XMFLOAT4> outRef(outFast);
+		fast.Transform(mtx, first, count, outFast.data());
+		ref.TransformReference(mtx, first, count, outRef.data());
+
+		bool isMatch = true;
+		for (u32 i = 0; i < count; i++)
+		{
+			isMatch = isMatch && IsNear(outFast[i], outRef[i]);
+		}
+		CHECK(isMatch);
+		CHECK(IsSentinel(outFast[count]));
+
+		// 保持している座標も更新され、範囲外のライトは変わらない
+		PointLightSet orig;
+		MakeLights(orig, kCount);
+		bool isStoredMatch = true, isOutsideUntouched = true;
+		for (u32 i = 0; i < kCount; i++)
+		{
+			auto a = fast.GetPosAndRadius(i);
+			isStoredMatch = isStoredMatch && IsNear(a, ref.GetPosAndRadius(i));
+			if (i < first || i >= first + count)
+			{
+				auto o = orig.GetPosAndRadius(i);
+				isOutsideUntouched = isOutsideUntouched && a.x == o.x && a.y == o.y && a.z == o.z && a.w == o.w;
+			}
+		}
+		CHECK(isStoredMatch);
+		CHECK(isOutsideUntouched);
+
+		// 端数のレーンは0のまま
+		const DirectX::XMVECTOR* e = fast.GetPosBlock(fast.GetBlockCount() - 1);
+		for (u32 lane = kCount % 4; lane < 4 && kCount % 4 != 0; lane++)
+		{
+			for (u32 c = 0; c < 4; c++)
+			{
+				CHECK_EQ(DirectX::XMVectorGetByIndex(e[c], lane), 0.0f);
+			}
+		}
+	}
+
+	// 書き出し先がなくても変換される
+	PointLightSet lights, ref;
+	MakeLights(lights, kCount);
+	MakeLights(ref, kCount);
+	lights.Transform(mtx, 2, 9, nullptr);
+	ref.TransformReference(mtx, 2, 9, nullptr);
+	bool isMatch = true;
+	for (u32 i = 0; i < kCount; i++)
+	{
+		isMatch = isMatch && IsNear(lights.GetPosAndRadius(i), ref.GetPosAndRadius(i));
+	}
+	CHECK(isMatch);
+}
+
+
+// 1k/10k/100k ライトの変換を、SoA の Transform とライトごとの TransformReference で比べる
+BENCH_CASE(Bench_PointLightSet_Transform)
+{
+	// 繰り返し変換しても座標が発散しないよう、回転のみの行列を使う
+	const auto mtx = DirectX::XMMatrixRotationY(0.7f);
+	const u32 kTotalLights = 10000000;
+	const u32 counts[] = { 1000, 10000, 100000 };
+	for (auto count : counts)
+	{
+		PointLightSet lights;
+		MakeLights(lights, count);
+		std::vector<DirectX::XMFLOAT4> out(count);
+		const u32 iterations = kTotalLights / count;
+
+		auto measure = [&](const char* label, void (PointLightSet::*func)(const DirectX::XMMATRIX&, u32, u32, DirectX::XMFLOAT4*))
+		{
+			auto start = std::chrono::high_resolution_clock::now();
+			for (u32 it = 0; it < iterations; it++)
+			{
+				(lights.*func)(mtx, 0, count, out.data());
+			}
+			auto end = std::chrono::high_resolution_clock::now();
+			double ns = std::chrono::duration<double, std::nano>(end - start).count() / ((double)iterations * count);
+			printf("  %6u lights %-10s %6.2f ns/light (last x %.1f)\n", count, label, ns, out[count - 1].x);
+		};
+		measure("reference", &PointLightSet::TransformReference);
+		measure("SoA", &PointLightSet::Transform);
+	}
+}
+
+
+//	EOF
@@ -0,0 +1,370 @@
+﻿#include "test.h"
+#include <sl12/profiler.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// ticksPerSecond = 1000 とすれば、ティック数がそのままミリ秒になる
+	static const u64 kTicksPerSecond = 1000;
+
+	ProfileEvent MakeEvent(const char* name, u64 begin, u64 end, u32 depth, u32 track)
+	{
+		ProfileEvent e;
+		e.name = name;
+		e.begin = begin;
+		e.end = end;
+		e.depth = depth;
+		e.track = track;
+		return e;
+	}
+
+	const ProfileStats::Entry* FindEntry(const ProfileStats& stats, const char* path)
+	{
+		for (auto&& e : stats.GetEntries())
+		{
+			if (e.path == path)
+			{
+				return &e;
+			}
+		}
+		return nullptr;
+	}
+}
+
+// 項目名はトラックと親を含み、親の直後に子が並ぶ. 同じフレームの同じ項目は合計される
+TEST_CASE(ProfileStats_Hierarchy)
+{
+	ProfileStats stats;
+	CHECK(!stats.Initialize(0));
+	CHECK(stats.Initialize(4));
+
+	{
+		ProfileEvent events[] = {
+			MakeEvent("Frame", 0, 10, 0, 0),
+			MakeEvent("Worker", 2, 5, 0, 1),
+			MakeEvent("Draw", 1, 4, 1, 0),
+			MakeEvent("Shadow", 4, 6, 1, 0),
+			MakeEvent("Draw", 6, 8, 1, 0),
+		};
+		stats.AddFrame(events, sizeof(events) / sizeof(events[0]), kTicksPerSecond);
+	}
+
+	auto&& entries = stats.GetEntries();
+	CHECK_EQ(entries.size(), 4u);
+	if (entries.size() == 4)
+	{
+		CHECK(entries[0].path == "0/Frame");
+		CHECK(entries[1].path == "0/Frame/Draw");
+		CHECK(entries[2].path == "0/Frame/Shadow");
+		CHECK(entries[3].path == "1/Worker");
+		CHECK(entries[1].name == "Draw");
+		CHECK_EQ(entries[1].depth, 1u);
+		CHECK_EQ(entries[3].track, 1u);
+		CHECK_NEAR(entries[0].lastMs, 10.0f, 1e-4f);
+		CHECK_NEAR(entries[1].lastMs, 5.0f, 1e-4f);
+		CHECK_NEAR(entries[2].lastMs, 2.0f, 1e-4f);
+		CHECK_NEAR(entries[3].lastMs, 3.0f, 1e-4f);
+	}
+
+	// 後から現れた子は他のトラックの項目より前、兄弟の末尾に入る
+	{
+		ProfileEvent events[] = {
+			MakeEvent("Frame", 0, 10, 0, 0),
+			MakeEvent("Post", 8, 9, 1, 0),
+			MakeEvent("Tonemap", 8, 9, 2, 0),
+			MakeEvent("Shadow", 1, 3, 1, 0),
+		};
+		stats.AddFrame(events, sizeof(events) / sizeof(events[0]), kTicksPerSecond);
+	}
+	CHECK_EQ(stats.GetFrameCount(), 2u);
+	CHECK_EQ(entries.size(), 6u);
+	if (entries.size() == 6)
+	{
+		CHECK(entries[0].path == "0/Frame");
+		CHECK(entries[1].path == "0/Frame/Draw");
+		CHECK(entries[2].path == "0/Frame/Shadow");
+		CHECK(entries[3].path == "0/Frame/Post");
+		CHECK(entries[4].path == "0/Frame/Post/Tonemap");
+		CHECK(entries[5].path == "1/Worker");
+	}
+
+	// 同名でも親が異なれば別の項目になる
+	CHECK(FindEntry(stats, "0/Frame/Shadow") != nullptr);
+	CHECK(FindEntry(stats, "0/Shadow") == nullptr);
+}
+
+// 最小/平均/最大は直近 historyCount フレームから求め、現れなかった項目は更新しない
+TEST_CASE(ProfileStats_History)
+{
+	ProfileStats stats;
+	CHECK(stats.Initialize(3));
+
+	const u64 durations[] = { 1, 2, 3, 4 };
+	for (u64 d : durations)
+	{
+		ProfileEvent events[] = {
+			MakeEvent("Frame", 100, 100 + d, 0, 0),
+		};
+		stats.AddFrame(events, 1, kTicksPerSecond);
+	}
+
+	const ProfileStats::Entry* pFrame = FindEntry(stats, "0/Frame");
+	CHECK(pFrame != nullptr);
+	if (pFrame)
+	{
+		CHECK_EQ(pFrame->sampleCount, 3u);
+		CHECK_NEAR(pFrame->lastMs, 4.0f, 1e-4f);
+		CHECK_NEAR(pFrame->minMs, 2.0f, 1e-4f);
+		CHECK_NEAR(pFrame->avgMs, 3.0f, 1e-4f);
+		CHECK_NEAR(pFrame->maxMs, 4.0f, 1e-4f);
+	}
+
+	// 別の項目だけのフレーム
+	{
+		ProfileEvent events[] = {
+			MakeEvent("Other", 0, 7, 0, 0),
+		};
+		stats.AddFrame(events, 1, kTicksPerSecond);
+	}
+	pFrame = FindEntry(stats, "0/Frame");
+	CHECK(pFrame != nullptr);
+	if (pFrame)
+	{
+		CHECK_EQ(pFrame->sampleCount, 3u);
+		CHECK_NEAR(pFrame->lastMs, 4.0f, 1e-4f);
+		CHECK_NEAR(pFrame->avgMs, 3.0f, 1e-4f);
+	}
+	const ProfileStats::Entry* pOther = FindEntry(stats, "0/Other");
+	CHECK(pOther != nullptr);
+	if (pOther)
+	{
+		CHECK_EQ(pOther->sampleCount, 1u);
+		CHECK_NEAR(pOther->minMs, 7.0f, 1e-4f);
+		CHECK_NEAR(pOther->maxMs, 7.0f, 1e-4f);
+	}
+	CHECK_EQ(stats.GetFrameCount(), 5u);
+}
+
+// 入れ子の区間が深さと開始順で記録され、子は親の範囲に収まる
+TEST_CASE(CpuProfiler_Scopes)
+{
+	CpuProfiler profiler;
+	CHECK(!profiler.Initialize(0, 16));
+	CHECK(profiler.Initialize(2, 16));
+
+	profiler.SetThreadName("Main");
+	{
+		CpuProfileScope frame(profiler, "Frame");
+		{
+			CpuProfileScope a(profiler, "A");
+			CpuProfileScope b(profiler, "B");
+		}
+		CpuProfileScope c(profiler, "C");
+	}
+
+	std::vector<ProfileEvent> events;
+	CHECK_EQ(profiler.CollectEvents(events), 0u);
+	CHECK_EQ(profiler.GetTrackCount(), 1u);
+	CHECK(strcmp(profiler.GetTrackName(0), "Main") == 0);
+	CHECK_EQ(events.size(), 4u);
+	if (events.size() == 4)
+	{
+		const char* names[] = { "Frame", "A", "B", "C" };
+		const u32 depths[] = { 0, 1, 2, 1 };
+		for (size_t i = 0; i < 4; i++)
+		{
+			CHECK(strcmp(events[i].name, names[i]) == 0);
+			CHECK_EQ(events[i].depth, depths[i]);
+			CHECK_EQ(events[i].track, 0u);
+			CHECK(events[i].begin <= events[i].end);
+		}
+		CHECK(events[0].begin <= events[1].begin && events[1].end <= events[0].end);
+		CHECK(events[1].begin <= events[2].begin && events[2].end <= events[1].end);
+		CHECK(events[1].end <= events[3].begin && events[3].end <= events[0].end);
+	}
+
+	// 取り出した後は空になる
+	events.clear();
+	CHECK_EQ(profiler.CollectEvents(events), 0u);
+	CHECK(events.empty());
+}
+
+// 閉じていない区間、バッファの溢れ、深さの上限を超えた区間は捨てた数として返る
+TEST_CASE(CpuProfiler_Dropped)
+{
+	std::vector<ProfileEvent> events;
+
+	// 閉じていない区間は捨て、後から閉じても次の取り出しに現れない
+	{
+		CpuProfiler profiler;
+		CHECK(profiler.Initialize(1, 16));
+		profiler.BeginScope("Open");
+		profiler.BeginScope("Closed");
+		profiler.EndScope();
+		CHECK_EQ(profiler.CollectEvents(events), 1u);
+		CHECK_EQ(events.size(), 1u);
+		if (events.size() == 1)
+		{
+			CHECK(strcmp(events[0].name, "Closed") == 0);
+		}
+		profiler.EndScope();
+
+		events.clear();
+		CHECK_EQ(profiler.CollectEvents(events), 0u);
+		CHECK(events.empty());
+
+		// 深さは元に戻っている
+		profiler.BeginScope("Next");
+		profiler.EndScope();
+		CHECK_EQ(profiler.CollectEvents(events), 0u);
+		CHECK_EQ(events.size(), 1u);
+		if (events.size() == 1)
+		{
+			CHECK_EQ(events[0].depth, 0u);
+		}
+	}
+
+	// バッファが一杯
+	{
+		CpuProfiler profiler;
+		CHECK(profiler.Initialize(1, 2));
+		for (int i = 0; i < 3; i++)
+		{
+			CpuProfileScope s(profiler, "Scope");
+		}
+		events.clear();
+		CHECK_EQ(profiler.CollectEvents(events), 1u);
+		CHECK_EQ(events.size(), 2u);
+	}
+
+	// 深さの上限を超えた区間は捨て、それより浅い区間は正しく閉じる
+	{
+		const u32 kNest = CpuProfiler::kMaxDepth + 2;
+		CpuProfiler profiler;
+		CHECK(profiler.Initialize(1, 64));
+		for (u32 i = 0; i < kNest; i++)
+		{
+			profiler.BeginScope("Nest");
+		}
+		for (u32 i = 0; i < kNest; i++)
+		{
+			profiler.EndScope();
+		}
+		events.clear();
+		CHECK_EQ(profiler.CollectEvents(events), 2u);
+		CHECK_EQ(events.size(), (size_t)CpuProfiler::kMaxDepth);
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			CHECK_EQ(events[i].depth, (u32)i);
+			CHECK(events[i].end != 0);
+		}
+	}
+}
+
+// スレッドごとに別のトラックになり、上限を超えたスレッドは計測しない
+TEST_CASE(CpuProfiler_Threads)
+{
+	std::vector<ProfileEvent> events;
+	{
+		CpuProfiler profiler;
+		CHECK(profiler.Initialize(2, 16));
+		profiler.BeginScope("Main");
+		profiler.EndScope();
+		std::thread worker([&profiler]()
+		{
+			profiler.SetThreadName("Worker");
+			CpuProfileScope s(profiler, "Job");
+		});
+		worker.join();
+
+		CHECK_EQ(profiler.CollectEvents(events), 0u);
+		CHECK_EQ(profiler.GetTrackCount(), 2u);
+		CHECK(profiler.GetTrackName(0) == nullptr);
+		CHECK(strcmp(profiler.GetTrackName(1), "Worker") == 0);
+		CHECK_EQ(events.size(), 2u);
+		if (events.size() == 2)
+		{
+			CHECK(strcmp(events[0].name, "Main") == 0);
+			CHECK_EQ(events[0].track, 0u);
+			CHECK(strcmp(events[1].name, "Job") == 0);
+			CHECK_EQ(events[1].track, 1u);
+		}
+	}
+
+	{
+		CpuProfiler profiler;
+		CHECK(profiler.Initialize(1, 16));
+		profiler.BeginScope("Main");
+		profiler.EndScope();
+		std::thread worker([&profiler]()
+		{
+			CpuProfileScope s(profiler, "Job");
+		});
+		worker.join();
+
+		events.clear();
+		CHECK_EQ(profiler.CollectEvents(events), 0u);
+		CHECK_EQ(profiler.GetTrackCount(), 1u);
+		CHECK_EQ(events.size(), 1u);
+	}
+}
+
+// 時刻はプロセスごとに最初の区間を0としたマイクロ秒になり、名前はエスケープされる
+TEST_CASE(ChromeTrace_Json)
+{
+	ChromeTraceWriter writer;
+	writer.SetProcessName(0, "CPU");
+	writer.SetProcessName(0, "CPU \"Main\"");
+	writer.SetTrackName(0, 1, "Worker\\1");
+
+	ProfileEvent events[] = {
+		MakeEvent("Frame\n\x01", 5000, 7000, 0, 0),
+		MakeEvent("Job", 6000, 6500, 0, 1),
+	};
+	writer.AddEvents(0, events, 2, 1000000);
+	writer.AddEvents(1, events + 1, 1, 1000000);
+	CHECK_EQ(writer.GetEventCount(), 3u);
+
+	std::string json = writer.ToString();
+	CHECK(json.find("\"args\":{\"name\":\"CPU \\\"Main\\\"\"}") != std::string::npos);
+	CHECK(json.find("\"args\":{\"name\":\"CPU\"}") == std::string::npos);
+	CHECK(json.find("\"args\":{\"name\":\"Worker\\\\1\"}") != std::string::npos);
+	CHECK(json.find("{\"name\":\"Frame\\n\\u0001\",\"ph\":\"X\",\"ts\":0.000,\"dur\":2000.000,\"pid\":0,\"tid\":0}") != std::string::npos);
+	CHECK(json.find("{\"name\":\"Job\",\"ph\":\"X\",\"ts\":1000.000,\"dur\":500.000,\"pid\":0,\"tid\":1}") != std::string::npos);
+	CHECK(json.find("{\"name\":\"Job\",\"ph\":\"X\",\"ts\":0.000,\"dur\":500.000,\"pid\":1,\"tid\":1}") != std::string::npos);
+
+	writer.Clear();
+	CHECK_EQ(writer.GetEventCount(), 0u);
+	CHECK(writer.ToString() == "{\"traceEvents\":[\n],\"displayTimeUnit\":\"ms\"}\n");
+}
+
+// 計測区間の開始/終了のコスト
+BENCH_CASE(Bench_CpuProfiler)
+{
+	const u32 kCount = 1000000;
+	CpuProfiler profiler;
+	profiler.Initialize(1, kCount);
+
+	auto t0 = std::chrono::high_resolution_clock::now();
+	for (u32 i = 0; i < kCount; i++)
+	{
+		CpuProfileScope s(profiler, "Scope");
+	}
+	auto t1 = std::chrono::high_resolution_clock::now();
+
+	std::vector<ProfileEvent> events;
+	events.reserve(kCount);
+	profiler.CollectEvents(events);
+	double ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+	printf("  %u scopes: %.3f ms (%.1f ns/scope)\n", kCount, ms, ms * 1000000.0 / kCount);
+}
+
+
+//	EOF
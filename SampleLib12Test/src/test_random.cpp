@@ -0,0 +1,109 @@
+﻿#include "test.h"
+#include <sl12/random.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	static const u32 kWidth = 512;
+	static const u32 kHeight = 512;
+}
+
+// シェーダ (random.hlsli) と同じ値になることを固定値で確認する
+TEST_CASE(Random_KnownValues)
+{
+	CHECK_EQ(PcgHash(0), 129708002u);
+	CHECK_EQ(PcgHash(1), 2831084092u);
+	CHECK_EQ(PcgHash(0xffffffffu), 3861530882u);
+
+	u32 state = InitRandomState(3, 5, 7);
+	u32 expected = state;
+	CHECK_EQ(NextRandomU32(state), PcgHash(expected));
+}
+
+// [0, 1) の範囲に収まり、1ピクセルの最初の値が一様に分布する
+TEST_CASE(Random_Uniformity)
+{
+	std::vector<double> bins(256, 0.0);
+	float minValue = 1.0f, maxValue = 0.0f;
+	for (u32 y = 0; y < kHeight; y++)
+	{
+		for (u32 x = 0; x < kWidth; x++)
+		{
+			u32 state = InitRandomState(x, y, 0);
+			float v = NextRandom(state);
+			minValue = std::min(minValue, v);
+			maxValue = std::max(maxValue, v);
+			bins[static_cast<size_t>(v * 256.0f)] += 1.0;
+		}
+	}
+	CHECK(minValue >= 0.0f);
+	CHECK(maxValue < 1.0f);
+
+	// 自由度 255 のカイ二乗. 上側 0.1% 点は約 330
+	double expected = double(kWidth * kHeight) / 256.0;
+	double chi2 = 0.0;
+	for (auto b : bins)
+	{
+		chi2 += (b - expected) * (b - expected) / expected;
+	}
+	CHECK(chi2 < 330.0);
+}
+
+// 同じピクセルの連続した値、隣のピクセル、隣のサンプル番号の間に相関がない
+TEST_CASE(Random_Correlation)
+{
+	double sumSeq = 0.0, sumAdj = 0.0, sumSample = 0.0;
+	u32 count = 0;
+	for (u32 y = 0; y < kHeight; y++)
+	{
+		for (u32 x = 0; x + 1 < kWidth; x++)
+		{
+			u32 s0 = InitRandomState(x, y, 0);
+			u32 s1 = InitRandomState(x + 1, y, 0);
+			u32 s2 = InitRandomState(x, y, 1);
+			double a = NextRandom(s0) - 0.5;
+			double b = NextRandom(s0) - 0.5;
+			double c = NextRandom(s1) - 0.5;
+			double d = NextRandom(s2) - 0.5;
+			sumSeq += a * b;
+			sumAdj += a * c;
+			sumSample += a * d;
+			count++;
+		}
+	}
+	// 一様分布の分散は 1/12. 相関係数の標準誤差は 1/sqrt(count) ≒ 0.002
+	double scale = 12.0 / count;
+	CHECK(std::fabs(sumSeq * scale) < 0.01);
+	CHECK(std::fabs(sumAdj * scale) < 0.01);
+	CHECK(std::fabs(sumSample * scale) < 0.01);
+}
+
+// ピクセルごとの初期状態がほとんど重複しない
+TEST_CASE(Random_SeedCollision)
+{
+	std::vector<u32> seeds;
+	seeds.reserve(kWidth * kHeight);
+	for (u32 y = 0; y < kHeight; y++)
+	{
+		for (u32 x = 0; x < kWidth; x++)
+		{
+			seeds.push_back(InitRandomState(x, y, 0));
+		}
+	}
+	std::sort(seeds.begin(), seeds.end());
+	size_t duplicates = 0;
+	for (size_t i = 1; i < seeds.size(); i++)
+	{
+		duplicates += (seeds[i] == seeds[i - 1]) ? 1 : 0;
+	}
+	// 誕生日問題による期待値は n^2 / 2^33 ≒ 8
+	CHECK(duplicates < 40);
+}
+
+
+//	EOF
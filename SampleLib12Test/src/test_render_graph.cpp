@@ -0,0 +1,174 @@
+﻿#include "test.h"
+#include <sl12/render_graph.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	typedef ResourceProducer<2, 1, 1>	GraphicsProducer;
+	typedef ResourceProducer<1, 1, 0>	ComputeProducer;
+
+	// 合成したパスの構成
+	// 5パスごとに、前パス出力を読むコンピュートパスを挟む. その出力は2パス後で読む
+	// パス p の出力はユニークID (p + 1) で、10パスごとにヒストリーを持つ
+	struct SyntheticGraph
+	{
+		std::vector<std::unique_ptr<ResourceProducerBase>>	holders;
+		std::vector<ResourceProducerBase*>					producers;
+	};	// struct SyntheticGraph
+
+	RenderResourceDesc MakeDesc(u32 pass)
+	{
+		RenderResourceDesc desc;
+		desc.SetFormat(DXGI_FORMAT_R8G8B8A8_UNORM).SetHistoryMax((pass % 10 == 0) ? 1 : 0);
+		return desc;
+	}
+
+	void MakeSyntheticGraph(u32 passCount, SyntheticGraph& graph)
+	{
+		graph.holders.clear();
+		graph.producers.clear();
+		for (u32 p = 0; p < passCount; p++)
+		{
+			if (p % 5 == 4)
+			{
+				auto prod = new ComputeProducer();
+				prod->SetInputFromPrevOutput(0, 0);
+				prod->SetOutputUnique(0, (u16)(p + 1), MakeDesc(p).SetTargetCount(0).SetUavCount(1));
+				prod->SetQueueType(QueueType::Compute);
+				graph.holders.emplace_back(prod);
+			}
+			else
+			{
+				auto prod = new GraphicsProducer();
+				if (p == 0)
+				{
+					// 最初のパスは自身の前フレームの出力を読む
+					prod->SetInputUnique(0, 1, 1);
+					prod->SetInputUnique(1, 1, 1);
+				}
+				else if (p % 5 == 0)
+				{
+					// コンピュートパスの直後のパスはその出力を読まないので、並行して実行できる
+					prod->SetInputUnique(0, (u16)(p - 2));
+					prod->SetInputUnique(1, (u16)(p / 2 + 1));
+				}
+				else
+				{
+					prod->SetInputUnique(0, (u16)p);
+					prod->SetInputUnique(1, (u16)((p % 5 == 1 && p > 1) ? p - 1 : p / 2 + 1));
+				}
+				if (p % 5 == 3)
+				{
+					prod->SetOutputForNextPass(0, MakeDesc(p));
+				}
+				else
+				{
+					prod->SetOutputUnique(0, (u16)(p + 1), MakeDesc(p));
+				}
+				prod->SetTemp(0, RenderResourceDesc().SetFormat(DXGI_FORMAT_R16G16B16A16_FLOAT).SetResolutionRate(0.5f));
+				graph.holders.emplace_back(prod);
+			}
+			graph.producers.push_back(graph.holders.back().get());
+		}
+	}
+}
+
+// 構成が変わらない間は使用情報を使い回し、変わったら作り直す
+TEST_CASE(RenderGraph_CompileCachesTopology)
+{
+	SyntheticGraph synth;
+	MakeSyntheticGraph(20, synth);
+
+	RenderGraph graph;
+	CHECK(graph.Compile(synth.producers, 0, true));
+	CHECK(graph.IsValid());
+	auto hash = graph.GetHash();
+
+	// 加工済みのIDを再度加工しても構成は変わらない
+	CHECK(!graph.Compile(synth.producers, 0, true));
+	CHECK_EQ(graph.GetHash(), hash);
+
+	// 前パス出力と一時リソースのIDはパス番号から決まる
+	auto prevOut = synth.producers[3]->GetOutputIds()[0];
+	CHECK(prevOut.isPrevOutput);
+	CHECK_EQ((u32)prevOut.passNo, 3u);
+	CHECK(synth.producers[4]->GetInputIds()[0] == prevOut);
+	auto temp = synth.producers[7]->GetTempIds()[0];
+	CHECK(temp.isTemporal);
+	CHECK_EQ((u32)temp.passNo, 7u);
+
+	// 各IDは最後にアクセスするパスで1度だけ解放される
+	auto&& releaseIds = graph.GetReleaseIds();
+	CHECK_EQ(releaseIds.size(), synth.producers.size());
+	u32 releaseCount = 0;
+	for (u32 p = 0; p < (u32)releaseIds.size(); p++)
+	{
+		for (auto&& id : releaseIds[p])
+		{
+			auto it = graph.GetLastAccess().find(id);
+			CHECK(it != graph.GetLastAccess().end());
+			CHECK_EQ(it->second, p);
+			releaseCount++;
+		}
+	}
+	CHECK_EQ((size_t)releaseCount, graph.GetLastAccess().size());
+
+	// コンピュートパスは非同期コンピュートキューに割り当てられる
+	CHECK(graph.GetSchedule().GetPassQueue(4) == QueueType::Compute);
+
+	// 記述子が変わったら作り直す
+	auto desc = synth.producers[10]->GetOutputDescs()[0];
+	static_cast<GraphicsProducer*>(synth.producers[10])->SetOutput(0, synth.producers[10]->GetOutputIds()[0], RenderResourceDesc(desc).SetFormat(DXGI_FORMAT_R16G16B16A16_FLOAT));
+	CHECK(graph.Compile(synth.producers, 0, true));
+	CHECK(graph.GetHash() != hash);
+	static_cast<GraphicsProducer*>(synth.producers[10])->SetOutput(0, synth.producers[10]->GetOutputIds()[0], desc);
+	CHECK(graph.Compile(synth.producers, 0, true));
+	CHECK_EQ(graph.GetHash(), hash);
+
+	// シードが変わったら作り直す
+	CHECK(graph.Compile(synth.producers, 1, false));
+	CHECK(graph.GetSchedule().GetPassQueue(4) == QueueType::Graphics);
+
+	graph.Clear();
+	CHECK(!graph.IsValid());
+	CHECK(graph.Compile(synth.producers, 1, false));
+}
+
+// 200パスの構成を毎フレーム再生し、使用情報を使い回す場合と毎フレーム作り直す場合を比べる
+BENCH_CASE(Bench_RenderGraph_Replay200)
+{
+	static const u32 kPassCount = 200;
+	static const u32 kFrames = 1000;
+
+	SyntheticGraph synth;
+	MakeSyntheticGraph(kPassCount, synth);
+
+	auto measure = [&](const char* label, bool forceCompile)
+	{
+		RenderGraph graph;
+		u32 compileCount = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (u32 frame = 0; frame < kFrames; frame++)
+		{
+			if (forceCompile)
+			{
+				graph.Clear();
+			}
+			compileCount += graph.Compile(synth.producers, 0, true) ? 1 : 0;
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double us = std::chrono::duration<double, std::micro>(end - start).count() / kFrames;
+		printf("  %-10s %8.2f us/frame (%u compiles, %u passes)\n", label, us, compileCount, kPassCount);
+	};
+
+	measure("cached", false);
+	measure("recompile", true);
+}
+
+
+//	EOF
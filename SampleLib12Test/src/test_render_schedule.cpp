@@ -0,0 +1,245 @@
+﻿#include "test.h"
+#include <sl12/render_schedule.h>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	typedef RenderSchedule::PassDesc PassDesc;
+
+	PassDesc Graphics(std::vector<u32> reads, std::vector<u32> writes)
+	{
+		PassDesc ret;
+		ret.reads = reads;
+		ret.writes = writes;
+		return ret;
+	}
+
+	PassDesc AsyncCompute(std::vector<u32> reads, std::vector<u32> writes)
+	{
+		PassDesc ret;
+		ret.reads = reads;
+		ret.writes = writes;
+		ret.isCompute = true;
+		ret.allowAsync = true;
+		return ret;
+	}
+
+	// 別のバッチ from の完了が、バッチ to の開始より前に保証されているか
+	// 同じキューのバッチは順番に実行され、他のキューのバッチとは待機でのみ同期する
+	bool IsOrdered(const RenderSchedule& schedule, u32 from, u32 to)
+	{
+		auto&& f = schedule.GetBatch(from);
+		std::vector<bool> visited(schedule.GetBatchCount(), false);
+		std::vector<u32> stack(1, to);
+		while (!stack.empty())
+		{
+			u32 b = stack.back();
+			stack.pop_back();
+			if (visited[b])
+			{
+				continue;
+			}
+			visited[b] = true;
+
+			auto&& batch = schedule.GetBatch(b);
+			if ((batch.queue == f.queue) && (batch.queueSeq >= f.queueSeq))
+			{
+				return true;
+			}
+			// 同じキューの前のバッチと、待機しているバッチをたどる
+			for (u32 i = 0; i < schedule.GetBatchCount(); i++)
+			{
+				auto&& other = schedule.GetBatch(i);
+				if ((other.queue == batch.queue) && (other.queueSeq + 1 == batch.queueSeq))
+				{
+					stack.push_back(i);
+				}
+			}
+			for (auto w : batch.waitBatches)
+			{
+				CHECK(schedule.GetBatch(w).signal);
+				stack.push_back(w);
+			}
+		}
+		return false;
+	}
+
+	// すべての依存関係と、最後のバッチがすべてのバッチの後に完了することを確認する
+	void CheckSchedule(const RenderSchedule& schedule)
+	{
+		u32 batchCount = schedule.GetBatchCount();
+		CHECK(batchCount > 0);
+		auto&& last = schedule.GetBatch(batchCount - 1);
+		CHECK(last.queue == QueueType::Graphics);
+
+		for (u32 p = 0; p < schedule.GetPassCount(); p++)
+		{
+			u32 batch = schedule.GetPassBatch(p);
+			CHECK(batch < batchCount);
+			CHECK(schedule.GetBatch(batch).queue == schedule.GetPassQueue(p));
+			for (auto d : schedule.GetDependencies(p))
+			{
+				CHECK(d < p);
+				u32 depBatch = schedule.GetPassBatch(d);
+				CHECK((depBatch == batch) || IsOrdered(schedule, depBatch, batch));
+			}
+			u32 prologue = schedule.GetPrologueBatch(p);
+			if (prologue != RenderSchedule::kInvalidIndex)
+			{
+				CHECK(schedule.GetPassQueue(p) == QueueType::Compute);
+				CHECK(schedule.GetBatch(prologue).queue == QueueType::Graphics);
+				CHECK(IsOrdered(schedule, prologue, batch));
+			}
+		}
+		for (u32 b = 0; b + 1 < batchCount; b++)
+		{
+			CHECK(IsOrdered(schedule, b, batchCount - 1));
+		}
+	}
+}
+
+// 読み書きから依存関係が求められる
+TEST_CASE(RenderSchedule_Dependencies)
+{
+	std::vector<PassDesc> passes;
+	passes.push_back(Graphics({}, { 1 }));			// 0
+	passes.push_back(Graphics({ 1 }, { 2 }));		// 1 : 書き込み後の読み込み
+	passes.push_back(Graphics({ 1 }, { 3 }));		// 2
+	passes.push_back(Graphics({}, { 1 }));			// 3 : 読み込み後の書き込み、書き込み後の書き込み
+	PassDesc computeRead = Graphics({ 2 }, { 4 });
+	computeRead.isCompute = true;
+	passes.push_back(Graphics({ 2 }, {}));			// 4
+	passes.push_back(computeRead);					// 5 : 読み込みステートの変更
+
+	RenderSchedule schedule;
+	schedule.Build(passes);
+	CHECK_EQ(schedule.GetPassCount(), 6u);
+	CHECK(schedule.GetDependencies(0).empty());
+	CHECK(schedule.GetDependencies(1) == std::vector<u32>({ 0 }));
+	CHECK(schedule.GetDependencies(2) == std::vector<u32>({ 0 }));
+	CHECK(schedule.GetDependencies(3) == std::vector<u32>({ 0, 1, 2 }));
+	CHECK(schedule.GetDependencies(4) == std::vector<u32>({ 1 }));
+	CHECK(schedule.GetDependencies(5) == std::vector<u32>({ 1, 4 }));
+	CheckSchedule(schedule);
+}
+
+// 後続のグラフィクスのパスが依存しないコンピュートのパスは非同期になる
+TEST_CASE(RenderSchedule_AsyncCompute)
+{
+	std::vector<PassDesc> passes;
+	passes.push_back(Graphics({}, { 1 }));					// 0
+	passes.push_back(AsyncCompute({ 1 }, { 2 }));			// 1
+	passes.push_back(Graphics({}, { 3 }));					// 2 : 1 と並行して実行できる
+	passes.push_back(Graphics({ 2, 3 }, {}));				// 3
+
+	RenderSchedule schedule;
+	schedule.Build(passes);
+	CHECK(schedule.GetPassQueue(0) == QueueType::Graphics);
+	CHECK(schedule.GetPassQueue(1) == QueueType::Compute);
+	CHECK(schedule.GetPassQueue(2) == QueueType::Graphics);
+	CHECK(schedule.GetPassQueue(3) == QueueType::Graphics);
+
+	// 0 → (1 || 2) → 3
+	CHECK_EQ(schedule.GetBatchCount(), 4u);
+	CHECK(schedule.GetPassBatch(1) != schedule.GetPassBatch(0));
+	CHECK(schedule.GetPassBatch(2) != schedule.GetPassBatch(3));
+	CHECK(!IsOrdered(schedule, schedule.GetPassBatch(1), schedule.GetPassBatch(2)));
+	CHECK(!IsOrdered(schedule, schedule.GetPassBatch(2), schedule.GetPassBatch(1)));
+
+	// リソース 1 はグラフィクスキューのステートなので、事前にバリアを張る
+	CHECK_EQ(schedule.GetPrologueBatch(1), schedule.GetPassBatch(0));
+	CheckSchedule(schedule);
+}
+
+// 直後のグラフィクスのパスが依存する場合や、前にグラフィクスのパスがない場合は非同期にしない
+TEST_CASE(RenderSchedule_AsyncFallback)
+{
+	RenderSchedule schedule;
+
+	std::vector<PassDesc> dependent;
+	dependent.push_back(Graphics({}, { 1 }));
+	dependent.push_back(AsyncCompute({ 1 }, { 2 }));
+	dependent.push_back(Graphics({ 2 }, {}));
+	schedule.Build(dependent);
+	CHECK(schedule.GetPassQueue(1) == QueueType::Graphics);
+	CHECK_EQ(schedule.GetBatchCount(), 1u);
+	CheckSchedule(schedule);
+
+	std::vector<PassDesc> first;
+	first.push_back(AsyncCompute({}, { 1 }));
+	first.push_back(Graphics({}, { 2 }));
+	schedule.Build(first);
+	CHECK(schedule.GetPassQueue(0) == QueueType::Graphics);
+	CHECK_EQ(schedule.GetBatchCount(), 1u);
+	CheckSchedule(schedule);
+
+	PassDesc notAsync = AsyncCompute({ 1 }, { 2 });
+	notAsync.allowAsync = false;
+	std::vector<PassDesc> disallowed;
+	disallowed.push_back(Graphics({}, { 1 }));
+	disallowed.push_back(notAsync);
+	disallowed.push_back(Graphics({}, { 3 }));
+	schedule.Build(disallowed);
+	CHECK(schedule.GetPassQueue(1) == QueueType::Graphics);
+	CheckSchedule(schedule);
+}
+
+// パスがなくてもグラフィクスキューのバッチが1つ作られる
+TEST_CASE(RenderSchedule_Empty)
+{
+	RenderSchedule schedule;
+	schedule.Build(std::vector<PassDesc>());
+	CHECK_EQ(schedule.GetPassCount(), 0u);
+	CHECK_EQ(schedule.GetBatchCount(), 1u);
+	CHECK(schedule.GetBatch(0).queue == QueueType::Graphics);
+	CHECK(schedule.GetBatch(0).passes.empty());
+	CHECK(!schedule.Dump().empty());
+}
+
+// ランダムなパス構成でも依存関係がキュー間の同期で守られる
+TEST_CASE(RenderSchedule_RandomGraphs)
+{
+	u32 state = 7;
+	auto next = [&state](u32 range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return (state >> 8) % range;
+	};
+
+	RenderSchedule schedule;
+	u32 asyncCount = 0;
+	for (int trial = 0; trial < 300; trial++)
+	{
+		std::vector<PassDesc> passes(next(16) + 1);
+		for (auto&& pass : passes)
+		{
+			u32 readCount = next(3);
+			u32 writeCount = next(3);
+			for (u32 i = 0; i < readCount; i++)
+			{
+				pass.reads.push_back(next(8));
+			}
+			for (u32 i = 0; i < writeCount; i++)
+			{
+				pass.writes.push_back(next(8));
+			}
+			pass.isCompute = next(2) != 0;
+			pass.allowAsync = pass.isCompute && (next(3) != 0);
+		}
+		schedule.Build(passes);
+		CHECK_EQ(schedule.GetPassCount(), static_cast<u32>(passes.size()));
+		CheckSchedule(schedule);
+
+		for (u32 p = 0; p < schedule.GetPassCount(); p++)
+		{
+			asyncCount += (schedule.GetPassQueue(p) == QueueType::Compute) ? 1 : 0;
+		}
+	}
+	CHECK(asyncCount > 0);
+}
+
+
+//	EOF
@@ -0,0 +1,140 @@
+﻿#include "test.h"
+#include <sl12/root_signature_layout.h>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	typedef RootParameterType RPT;
+	typedef ShaderVisibility SV;
+}
+
+// まとめない場合は1パラメータ1テーブル
+TEST_CASE(RootSignatureLayout_Unpacked)
+{
+	const RootParameter params[] = {
+		RootParameter(RPT::ConstantBuffer, SV::Compute, 0),
+		RootParameter(RPT::ShaderResource, SV::Compute, 0),
+		RootParameter(RPT::ShaderResource, SV::Compute, 1),
+		RootParameter(RPT::UnorderedAccess, SV::Compute, 0),
+	};
+	RootSignatureLayout layout;
+	layout.Plan(params, 4, false);
+
+	CHECK_EQ(layout.GetTables().size(), 4u);
+	CHECK_EQ(layout.GetRanges().size(), 4u);
+	CHECK_EQ(layout.GetRootDWordCost(), 4u);
+	for (u32 i = 0; i < 4; i++)
+	{
+		CHECK_EQ(layout.GetLocations()[i].tableIndex, i);
+		CHECK_EQ(layout.GetLocations()[i].offsetInTable, 0u);
+		CHECK_EQ(layout.GetTables()[i].numDescriptors, 1u);
+		CHECK_EQ(layout.GetRanges()[i].baseRegister, params[i].registerIndex);
+	}
+}
+
+// Sample008 のタイルライティング: CBV 2, SRV 6, UAV 1 が3テーブルにまとまる
+TEST_CASE(RootSignatureLayout_PackedTiledLighting)
+{
+	const RootParameter params[] = {
+		RootParameter(RPT::ConstantBuffer, SV::Compute, 0),		// CbScene
+		RootParameter(RPT::ConstantBuffer, SV::Compute, 1),		// CbLightInfo
+		RootParameter(RPT::ShaderResource, SV::Compute, 0),		// texGBuffer0
+		RootParameter(RPT::ShaderResource, SV::Compute, 1),
+		RootParameter(RPT::ShaderResource, SV::Compute, 2),
+		RootParameter(RPT::ShaderResource, SV::Compute, 3),		// texLinearDepth
+		RootParameter(RPT::ShaderResource, SV::Compute, 4),		// rLightPosBuffer
+		RootParameter(RPT::ShaderResource, SV::Compute, 5),		// rLightColorBuffer
+		RootParameter(RPT::UnorderedAccess, SV::Compute, 0),	// rwFinal
+	};
+	RootSignatureLayout unpacked, packed;
+	unpacked.Plan(params, 9, false);
+	packed.Plan(params, 9, true);
+
+	CHECK_EQ(unpacked.GetRootDWordCost(), 9u);
+	CHECK_EQ(packed.GetRootDWordCost(), 3u);
+	CHECK_EQ(packed.GetTables().size(), 3u);
+	CHECK_EQ(packed.GetRanges().size(), 3u);
+
+	auto&& tables = packed.GetTables();
+	CHECK(tables[0].type == RPT::ConstantBuffer);
+	CHECK_EQ(tables[0].numDescriptors, 2u);
+	CHECK(tables[1].type == RPT::ShaderResource);
+	CHECK_EQ(tables[1].numDescriptors, 6u);
+	CHECK_EQ(tables[1].numRanges, 1u);
+	CHECK(tables[2].type == RPT::UnorderedAccess);
+	CHECK_EQ(tables[2].numDescriptors, 1u);
+
+	// テーブル内の位置はレジスタ番号順
+	for (u32 i = 2; i < 8; i++)
+	{
+		CHECK_EQ(packed.GetLocations()[i].tableIndex, 1u);
+		CHECK_EQ(packed.GetLocations()[i].offsetInTable, i - 2);
+	}
+}
+
+// 連続しないレジスタは同じテーブルの別レンジになる
+TEST_CASE(RootSignatureLayout_PackedRanges)
+{
+	const RootParameter params[] = {
+		RootParameter(RPT::ShaderResource, SV::Pixel, 5),
+		RootParameter(RPT::ShaderResource, SV::Pixel, 0),
+		RootParameter(RPT::ShaderResource, SV::Pixel, 1),
+		RootParameter(RPT::ShaderResource, SV::Pixel, 6),
+		RootParameter(RPT::ShaderResource, SV::Pixel, 9),
+	};
+	RootSignatureLayout layout;
+	layout.Plan(params, 5, true);
+
+	CHECK_EQ(layout.GetRootDWordCost(), 1u);
+	CHECK_EQ(layout.GetTables()[0].numDescriptors, 5u);
+	CHECK_EQ(layout.GetTables()[0].numRanges, 3u);
+
+	auto&& ranges = layout.GetRanges();
+	CHECK_EQ(ranges.size(), 3u);
+	CHECK_EQ(ranges[0].baseRegister, 0u);
+	CHECK_EQ(ranges[0].numDescriptors, 2u);
+	CHECK_EQ(ranges[0].offsetInTable, 0u);
+	CHECK_EQ(ranges[1].baseRegister, 5u);
+	CHECK_EQ(ranges[1].numDescriptors, 2u);
+	CHECK_EQ(ranges[1].offsetInTable, 2u);
+	CHECK_EQ(ranges[2].baseRegister, 9u);
+	CHECK_EQ(ranges[2].numDescriptors, 1u);
+	CHECK_EQ(ranges[2].offsetInTable, 4u);
+
+	CHECK_EQ(layout.GetLocations()[0].offsetInTable, 2u);
+	CHECK_EQ(layout.GetLocations()[1].offsetInTable, 0u);
+	CHECK_EQ(layout.GetLocations()[4].offsetInTable, 4u);
+}
+
+// レジスタスペースと可視性が異なるものは別テーブル、同じレジスタは同じ位置を共有する
+TEST_CASE(RootSignatureLayout_PackedSpacesAndVisibility)
+{
+	const RootParameter params[] = {
+		RootParameter(RPT::ConstantBuffer, SV::Vertex, 0),
+		RootParameter(RPT::ConstantBuffer, SV::Pixel, 0),
+		RootParameter(RPT::ConstantBuffer, SV::Pixel, 1),
+		RootParameter(RPT::ConstantBuffer, SV::Pixel, 1),
+		RootParameter(RPT::ShaderResource, SV::Pixel, 0, 0),
+		RootParameter(RPT::ShaderResource, SV::Pixel, 0, 1),
+		RootParameter(RPT::Sampler, SV::Pixel, 0),
+	};
+	RootSignatureLayout layout;
+	layout.Plan(params, 7, true);
+
+	// CBV(VS), CBV(PS), SRV(space0), SRV(space1), Sampler
+	CHECK_EQ(layout.GetRootDWordCost(), 5u);
+	auto&& loc = layout.GetLocations();
+	CHECK(loc[0].tableIndex != loc[1].tableIndex);
+	CHECK_EQ(loc[1].tableIndex, loc[2].tableIndex);
+	CHECK_EQ(loc[2].tableIndex, loc[3].tableIndex);
+	CHECK_EQ(loc[2].offsetInTable, loc[3].offsetInTable);
+	CHECK_EQ(layout.GetTables()[loc[1].tableIndex].numDescriptors, 2u);
+	CHECK(loc[4].tableIndex != loc[5].tableIndex);
+	CHECK(layout.GetTables()[loc[6].tableIndex].type == RPT::Sampler);
+}
+
+
+//	EOF
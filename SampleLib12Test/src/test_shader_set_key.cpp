@@ -0,0 +1,133 @@
+﻿#include "test.h"
+#include <sl12/shader_set_key.h>
+#include <sl12/crc.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	static const u32 kNumStages = 3;
+
+	// ダミーのバイトコード
+	std::vector<u8> MakeCode(u32 size, u8 seed)
+	{
+		std::vector<u8> ret(size);
+		for (u32 i = 0; i < size; ++i)
+		{
+			ret[i] = static_cast<u8>(seed + i * 7);
+		}
+		return ret;
+	}
+
+	ShaderCodeRef MakeRef(const std::vector<u8>& code)
+	{
+		ShaderCodeRef ret;
+		ret.pData = code.data();
+		ret.size = code.size();
+		ret.hash = CalcHash64(code.data(), code.size());
+		return ret;
+	}
+}
+
+// 同じバイトコードなら別のバッファでも一致する
+TEST_CASE(ShaderSetKey_Hit)
+{
+	auto vs = MakeCode(256, 1), ps = MakeCode(512, 2);
+	ShaderCodeRef codes[kNumStages] = { MakeRef(vs), MakeRef(ps), ShaderCodeRef() };
+
+	ShaderSetKey key;
+	key.Store(codes, kNumStages, 0);
+
+	auto vs2 = vs, ps2 = ps;
+	ShaderCodeRef codes2[kNumStages] = { MakeRef(vs2), MakeRef(ps2), ShaderCodeRef() };
+	CHECK(codes2[0].pData != codes[0].pData);
+	CHECK_EQ(ShaderSetKey::CalcHash(codes, kNumStages, 0), ShaderSetKey::CalcHash(codes2, kNumStages, 0));
+	CHECK(key.IsSame(codes2, kNumStages, 0));
+
+	// キーはバイトコードを複製して保持するので、元のバッファを破棄しても比較できる
+	vs.assign(vs.size(), 0xff);
+	ps.clear();
+	CHECK(key.IsSame(codes2, kNumStages, 0));
+}
+
+// ステージ、内容、サイズ、生成条件のいずれかが異なれば一致しない
+TEST_CASE(ShaderSetKey_Miss)
+{
+	auto vs = MakeCode(256, 1), ps = MakeCode(512, 2), other = MakeCode(512, 3), longer = MakeCode(520, 2);
+	ShaderCodeRef codes[kNumStages] = { MakeRef(vs), MakeRef(ps), ShaderCodeRef() };
+	u64 hash = ShaderSetKey::CalcHash(codes, kNumStages, 0);
+
+	ShaderSetKey key;
+	key.Store(codes, kNumStages, 0);
+
+	ShaderCodeRef diffContent[kNumStages] = { MakeRef(vs), MakeRef(other), ShaderCodeRef() };
+	ShaderCodeRef diffSize[kNumStages] = { MakeRef(vs), MakeRef(longer), ShaderCodeRef() };
+	ShaderCodeRef diffStage[kNumStages] = { MakeRef(vs), ShaderCodeRef(), MakeRef(ps) };
+	ShaderCodeRef missingStage[kNumStages] = { MakeRef(vs), ShaderCodeRef(), ShaderCodeRef() };
+	CHECK(!key.IsSame(diffContent, kNumStages, 0));
+	CHECK(!key.IsSame(diffSize, kNumStages, 0));
+	CHECK(!key.IsSame(diffStage, kNumStages, 0));
+	CHECK(!key.IsSame(missingStage, kNumStages, 0));
+	CHECK(!key.IsSame(codes, kNumStages, 1));
+	CHECK(!key.IsSame(codes, kNumStages - 1, 0));
+
+	CHECK(ShaderSetKey::CalcHash(diffContent, kNumStages, 0) != hash);
+	CHECK(ShaderSetKey::CalcHash(diffStage, kNumStages, 0) != hash);
+	CHECK(ShaderSetKey::CalcHash(codes, kNumStages, 1) != hash);
+}
+
+// ハッシュとサイズが衝突しても、バイトコードが異なれば別のエントリになる
+TEST_CASE(ShaderSetKey_ForcedCollision)
+{
+	auto a = MakeCode(384, 10), b = MakeCode(384, 20);
+	ShaderCodeRef codesA[kNumStages] = { MakeRef(a), ShaderCodeRef(), ShaderCodeRef() };
+	ShaderCodeRef codesB[kNumStages] = { MakeRef(b), ShaderCodeRef(), ShaderCodeRef() };
+	codesB[0].hash = codesA[0].hash;
+
+	u64 hashA = ShaderSetKey::CalcHash(codesA, kNumStages, 0);
+	u64 hashB = ShaderSetKey::CalcHash(codesB, kNumStages, 0);
+	CHECK_EQ(hashA, hashB);
+
+	// RootSignatureManager と同じく、ハッシュをキーとするマルチマップで検索する
+	typedef std::unordered_multimap<u64, std::unique_ptr<ShaderSetKey>> KeyMap;
+	KeyMap map;
+	auto find = [&](const ShaderCodeRef* pCodes) -> ShaderSetKey*
+	{
+		auto range = map.equal_range(ShaderSetKey::CalcHash(pCodes, kNumStages, 0));
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (it->second->IsSame(pCodes, kNumStages, 0))
+			{
+				return it->second.get();
+			}
+		}
+		return nullptr;
+	};
+	auto insert = [&](const ShaderCodeRef* pCodes)
+	{
+		std::unique_ptr<ShaderSetKey> key(new ShaderSetKey);
+		key->Store(pCodes, kNumStages, 0);
+		ShaderSetKey* ret = key.get();
+		map.insert(KeyMap::value_type(ShaderSetKey::CalcHash(pCodes, kNumStages, 0), std::move(key)));
+		return ret;
+	};
+
+	CHECK(find(codesA) == nullptr);
+	ShaderSetKey* pKeyA = insert(codesA);
+	CHECK(find(codesA) == pKeyA);
+
+	// 衝突した B は A に一致しない
+	CHECK(find(codesB) == nullptr);
+	ShaderSetKey* pKeyB = insert(codesB);
+	CHECK(pKeyB != pKeyA);
+	CHECK_EQ(map.count(hashA), 2u);
+	CHECK(find(codesA) == pKeyA);
+	CHECK(find(codesB) == pKeyB);
+}
+
+
+//	EOF
@@ -0,0 +1,139 @@
+﻿#include "test.h"
+#include <sl12/transient_memory_planner.h>
+
+using namespace sl12;
+
+
+namespace
+{
+	typedef TransientMemoryPlanner Planner;
+
+	static const u64 kAlignment = 64 * 1024;
+
+	// 1920x1080 のレンダーターゲットを 64KB 単位に切り上げたサイズ
+	u64 TargetSize(u64 bytesPerPixel)
+	{
+		u64 size = 1920ull * 1080ull * bytesPerPixel;
+		return (size + kAlignment - 1) / kAlignment * kAlignment;
+	}
+
+	// 使用区間が重なるリソースのメモリが重ならず、アラインメントとヒープサイズを守っている
+	void CheckPlacements(const Planner& planner)
+	{
+		u32 count = planner.GetResourceCount();
+		for (u32 i = 0; i < count; i++)
+		{
+			auto&& a = planner.GetRequest(i);
+			auto&& pa = planner.GetPlacement(i);
+			CHECK_EQ(pa.offset % a.alignment, 0u);
+			CHECK(pa.offset + a.size <= planner.GetHeapSize());
+
+			for (u32 j = i + 1; j < count; j++)
+			{
+				auto&& b = planner.GetRequest(j);
+				auto&& pb = planner.GetPlacement(j);
+				bool isLiveOverlap = (a.firstPass <= b.lastPass) && (b.firstPass <= a.lastPass);
+				bool isMemoryOverlap = (pa.offset < pb.offset + b.size) && (pb.offset < pa.offset + a.size);
+				CHECK(!(isLiveOverlap && isMemoryOverlap));
+			}
+		}
+		CHECK(planner.GetHeapSize() >= planner.GetPeakLiveSize());
+	}
+}
+
+// Sample007 のパス構成
+// GBuffer(0) → LinearDepth(1) → Lighting(2) → Blur(3)
+TEST_CASE(TransientPlanner_Sample007)
+{
+	Planner planner;
+	planner.AddResource({ 0, 2, TargetSize(8), kAlignment });		// GBuffer0 (RGBA16F)
+	planner.AddResource({ 0, 2, TargetSize(4), kAlignment });		// GBuffer1
+	planner.AddResource({ 0, 2, TargetSize(4), kAlignment });		// GBuffer2
+	planner.AddResource({ 0, 1, TargetSize(4), kAlignment });		// Depth
+	planner.AddResource({ 1, 3, TargetSize(4), kAlignment });		// LinearDepth
+	u32 lightResult = planner.AddResource({ 2, 3, TargetSize(8), kAlignment });	// LightResult (RGBA16F)
+	planner.Plan();
+	CheckPlacements(planner);
+
+	// 63.5MB → 55.6MB. 下限に達している
+	CHECK_EQ(planner.GetTotalSize(), 2 * TargetSize(8) + 4 * TargetSize(4));
+	CHECK_EQ(planner.GetPeakLiveSize(), 2 * TargetSize(8) + 3 * TargetSize(4));
+	CHECK_EQ(planner.GetHeapSize(), planner.GetPeakLiveSize());
+
+	// LightResult は生存期間の終わった Depth のメモリを引き継ぐ
+	auto&& p = planner.GetPlacement(lightResult);
+	CHECK(p.isShared);
+	CHECK_EQ(p.aliasBefore, 3u);
+}
+
+// Sample008 のパス構成
+// クラスタ分割のパス(3..5)が加わり、LinearDepth と LightResult の生存期間が延びる
+TEST_CASE(TransientPlanner_Sample008)
+{
+	Planner planner;
+	planner.AddResource({ 0, 2, TargetSize(8), kAlignment });		// GBuffer0 (RGBA16F)
+	planner.AddResource({ 0, 2, TargetSize(4), kAlignment });		// GBuffer1
+	planner.AddResource({ 0, 2, TargetSize(4), kAlignment });		// GBuffer2
+	planner.AddResource({ 0, 6, TargetSize(4), kAlignment });		// Depth
+	planner.AddResource({ 1, 7, TargetSize(4), kAlignment });		// LinearDepth
+	planner.AddResource({ 2, 7, TargetSize(8), kAlignment });		// LightResult (RGBA16F)
+	u32 cluster = planner.AddResource({ 3, 5, TargetSize(4), kAlignment });
+	planner.Plan();
+	CheckPlacements(planner);
+
+	// 71.4MB → 63.5MB
+	CHECK_EQ(planner.GetTotalSize(), 2 * TargetSize(8) + 5 * TargetSize(4));
+	CHECK_EQ(planner.GetHeapSize(), planner.GetPeakLiveSize());
+	CHECK_EQ(planner.GetHeapSize(), planner.GetTotalSize() - TargetSize(4));
+
+	// GBuffer の後のパスで使うリソースは GBuffer のメモリを共有する
+	CHECK(planner.GetPlacement(cluster).isShared);
+	CHECK(planner.GetPlacement(cluster).aliasBefore != Planner::kInvalidIndex);
+}
+
+// 使用区間の重ならないリソースだけなら、最大のリソースと同じヒープサイズになる
+TEST_CASE(TransientPlanner_Sequential)
+{
+	Planner planner;
+	for (u32 i = 0; i < 8; i++)
+	{
+		planner.AddResource({ i, i, (i + 1) * kAlignment, kAlignment });
+	}
+	planner.Plan();
+	CheckPlacements(planner);
+	CHECK_EQ(planner.GetHeapSize(), 8 * kAlignment);
+	CHECK_EQ(planner.GetPlacement(0).aliasBefore, Planner::kInvalidIndex);
+
+	planner.Clear();
+	CHECK_EQ(planner.GetResourceCount(), 0u);
+}
+
+// ランダムなパス構成でも重なりとアラインメント違反がない
+TEST_CASE(TransientPlanner_RandomGraphs)
+{
+	u32 state = 1;
+	auto next = [&state](u32 range)
+	{
+		state = state * 1664525u + 1013904223u;
+		return (state >> 8) % range;
+	};
+
+	Planner planner;
+	for (int trial = 0; trial < 200; trial++)
+	{
+		planner.Clear();
+		u32 count = next(40) + 1;
+		for (u32 i = 0; i < count; i++)
+		{
+			u32 first = next(20);
+			u32 last = first + next(5);
+			u64 alignment = next(2) ? kAlignment : 4 * 1024 * 1024;
+			planner.AddResource({ first, last, (next(50) + 1) * kAlignment, alignment });
+		}
+		planner.Plan();
+		CheckPlacements(planner);
+	}
+}
+
+
+//	EOF
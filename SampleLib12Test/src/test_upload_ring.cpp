@@ -0,0 +1,225 @@
+﻿#include "test.h"
+#include <sl12/upload_ring_allocator.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// GPUの代わりにフェンス値を管理するバックエンド
+	class MockBackend
+		: public UploadRingBackend
+	{
+	public:
+		MockBackend(UploadRingAllocator* pRing)
+			: pRing_(pRing)
+		{}
+
+		u64 SubmitPending() override
+		{
+			submitCount++;
+			if (!canSubmit)
+			{
+				return 0;
+			}
+			u64 fence = ++submittedValue;
+			pRing_->CloseBatch(fence);
+			return fence;
+		}
+		void WaitAndRetire(u64 fenceValue) override
+		{
+			waitCount++;
+			// 発行されていないフェンス値は完了しない
+			if (fenceValue <= submittedValue && completedValue < fenceValue)
+			{
+				completedValue = fenceValue;
+			}
+			if (canComplete)
+			{
+				pRing_->Retire(completedValue);
+			}
+		}
+
+		u64		submittedValue = 0;
+		u64		completedValue = 0;
+		u32		submitCount = 0;
+		u32		waitCount = 0;
+		bool	canSubmit = true;
+		bool	canComplete = true;
+
+	private:
+		UploadRingAllocator*	pRing_;
+	};	// class MockBackend
+}
+
+// アライメントと終端を跨ぐ割り当て
+TEST_CASE(UploadRing_AllocateWrap)
+{
+	UploadRingAllocator ring;
+	ring.Initialize(1024);
+
+	u64 offset;
+	CHECK(ring.Allocate(100, 1, &offset));
+	CHECK_EQ(offset, 0u);
+	CHECK(ring.Allocate(100, 256, &offset));
+	CHECK_EQ(offset, 256u);
+	CHECK_EQ(ring.GetUsedSize(), 356u);
+	ring.CloseBatch(1);
+
+	CHECK(ring.Allocate(600, 1, &offset));
+	CHECK_EQ(offset, 356u);
+	ring.CloseBatch(2);
+
+	// 残りは末尾の68バイトだけなので、バッチ1の完了まで割り当てられない
+	CHECK(!ring.Allocate(100, 1, &offset));
+	ring.Retire(1);
+	CHECK(ring.Allocate(100, 1, &offset));
+	CHECK_EQ(offset, 0u);
+	// 末尾のパディングも使用量に含まれる
+	CHECK_EQ(ring.GetUsedSize(), 600u + 68u + 100u);
+
+	ring.CloseBatch(3);
+	ring.Retire(3);
+	CHECK(ring.IsEmpty());
+	CHECK_EQ(ring.GetInFlightBatchCount(), 0u);
+}
+
+// 容量を超える、またはサイズ0の割り当ては失敗する
+TEST_CASE(UploadRing_InvalidSize)
+{
+	UploadRingAllocator ring;
+	ring.Initialize(256);
+	MockBackend backend(&ring);
+
+	u64 offset;
+	CHECK(!ring.Allocate(0, 1, &offset));
+	CHECK(!ring.Allocate(257, 1, &offset));
+	CHECK(!ring.AllocateWait(257, 1, &backend, &offset));
+	CHECK_EQ(backend.submitCount, 0u);
+}
+
+// 空きがない場合は記録中のバッチを発行し、古いバッチから順に完了を待つ
+TEST_CASE(UploadRing_AllocateWaitRetiresOldest)
+{
+	UploadRingAllocator ring;
+	ring.Initialize(1024);
+	MockBackend backend(&ring);
+
+	u64 offset;
+	for (u32 i = 0; i < 16; i++)
+	{
+		CHECK(ring.AllocateWait(256, 1, &backend, &offset));
+		CHECK_EQ(offset, (i % 4) * 256u);
+	}
+	// 4回の割り当てごとに1回発行され、完了待ちは必要な分だけ行われる
+	CHECK_EQ(backend.submitCount, 3u);
+	CHECK_EQ(backend.waitCount, 3u);
+	CHECK_EQ(backend.completedValue, 3u);
+	CHECK_EQ(ring.GetPendingSize(), 1024u);
+}
+
+// 記録中のバッチを発行できない場合は待ち続けずに失敗する
+TEST_CASE(UploadRing_AllocateWaitFailsWithoutSubmit)
+{
+	UploadRingAllocator ring;
+	ring.Initialize(1024);
+	MockBackend backend(&ring);
+	backend.canSubmit = false;
+
+	u64 offset;
+	CHECK(ring.AllocateWait(1024, 1, &backend, &offset));
+	CHECK(!ring.AllocateWait(1, 1, &backend, &offset));
+	CHECK_EQ(backend.submitCount, 1u);
+	CHECK_EQ(backend.waitCount, 0u);
+}
+
+// 待機してもバッチが解放されない場合は失敗する
+TEST_CASE(UploadRing_AllocateWaitFailsWhenNotRetired)
+{
+	UploadRingAllocator ring;
+	ring.Initialize(1024);
+	MockBackend backend(&ring);
+	backend.canComplete = false;
+
+	u64 offset;
+	CHECK(ring.AllocateWait(1024, 1, &backend, &offset));
+	CHECK(!ring.AllocateWait(1, 1, &backend, &offset));
+	CHECK_EQ(backend.submitCount, 1u);
+	CHECK_EQ(backend.waitCount, 1u);
+}
+
+// 多数の割り当てでも使用量が容量を超えず、すべて完了すれば空になる
+TEST_CASE(UploadRing_Stress)
+{
+	UploadRingAllocator ring;
+	ring.Initialize(64 * 1024);
+	MockBackend backend(&ring);
+
+	u32 seed = 12345;
+	for (u32 i = 0; i < 10000; i++)
+	{
+		seed = seed * 1664525u + 1013904223u;
+		u64 size = 1 + (seed >> 16) % 8192;
+		u64 alignment = 1ull << ((seed >> 8) % 10);
+		u64 offset;
+		CHECK(ring.AllocateWait(size, alignment, &backend, &offset));
+		CHECK_EQ(offset % alignment, 0u);
+		CHECK(offset + size <= ring.GetCapacity());
+		CHECK(ring.GetUsedSize() <= ring.GetCapacity());
+		if ((i % 7) == 0)
+		{
+			backend.SubmitPending();
+		}
+	}
+	backend.SubmitPending();
+	backend.WaitAndRetire(backend.submittedValue);
+	CHECK(ring.IsEmpty());
+}
+
+
+// 割り当てのスループット. 64 回ごとにバッチを閉じ、2つ前のバッチまでが完了したものとする
+BENCH_CASE(Bench_UploadRing)
+{
+	const u32 kAllocCount = 4000000;
+	const u64 kCapacities[] = { 1024 * 1024, 32 * 1024 * 1024 };
+	for (u64 capacity : kCapacities)
+	{
+		UploadRingAllocator ring;
+		ring.Initialize(capacity);
+		MockBackend backend(&ring);
+
+		u32 seed = 12345;
+		u64 maxUsed = 0;
+		u32 failCount = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		for (u32 i = 0; i < kAllocCount; i++)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			u64 size = 256 + (seed >> 16) % 16384;
+			u64 offset;
+			if (!ring.AllocateWait(size, 256, &backend, &offset))
+			{
+				failCount++;
+			}
+			maxUsed = std::max(maxUsed, ring.GetUsedSize());
+			if ((i % 64) == 63)
+			{
+				backend.SubmitPending();
+				if (backend.submittedValue > 2)
+				{
+					ring.Retire(backend.submittedValue - 2);
+				}
+			}
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double sec = std::chrono::duration<double>(end - start).count();
+		printf("  capacity %3llu MB: %6.1f M allocs/s, peak %6.2f MB used, %u waits, %u failed\n",
+			static_cast<unsigned long long>(capacity >> 20), kAllocCount / sec / 1e6, maxUsed / (1024.0 * 1024.0), backend.waitCount, failCount);
+	}
+}
+
+
+//	EOF
@@ -0,0 +1,229 @@
+﻿#include "test.h"
+#include "../../Sample004/src/world_transform.h"
+#include <sl12/float16.h>
+#include <sl12/geometry_generator.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace sl12;
+
+
+namespace
+{
+	// シェーダのレイアウトと、頂点間に隙間があるレイアウト
+	static const WorldTransformLayout kLayouts[] = {
+		kWorldTransformFp16,
+		kWorldTransformFp32,
+		{ 32, 16, true },
+	};
+
+	// Y軸回転 + 平行移動
+	void MakeMatrix(float* m)
+	{
+		const float c = cosf(0.5f), s = sinf(0.5f);
+		const float mtx[16] = {
+			c, 0.0f, -s, 0.0f,
+			0.0f, 1.0f, 0.0f, 0.0f,
+			s, 0.0f, c, 0.0f,
+			1.0f, 2.0f, 3.0f, 1.0f,
+		};
+		memcpy(m, mtx, sizeof(mtx));
+	}
+
+	// 頂点を生成する. 頂点数は3の倍数に切り捨てる
+	std::vector<u8> MakeVertices(const WorldTransformLayout& layout, u32 vertexCount)
+	{
+		GeometryGenerator::Desc desc;
+		desc.triangleCount = vertexCount / 3;
+		desc.seed = 11;
+		const GeometryVertexElement elements[] = {
+			{ GeometryAttribute::Position, GeometryFormat::Float32x3, 0 },
+			{ GeometryAttribute::Normal, layout.isHalfNormal ? GeometryFormat::Float16x4 : GeometryFormat::Float32x3, layout.normalOffset },
+		};
+		GeometryGenerator generator;
+		std::vector<u8> ret;
+		if (generator.Initialize(desc, elements, 2, layout.vertexStride))
+		{
+			ret.resize(generator.GetBufferSize());
+			generator.Generate(ret.data(), 1);
+		}
+		return ret;
+	}
+}
+
+// 平行移動は座標だけに掛かり、half の法線の W は0になる
+TEST_CASE(WorldTransform_KnownValues)
+{
+	const float m[16] = {
+		0.0f, 1.0f, 0.0f, 0.0f,
+		-1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 2.0f, 0.0f,
+		10.0f, 20.0f, 30.0f, 1.0f,
+	};
+
+	u8 src[20], dst[20];
+	const float pos[3] = { 1.0f, 2.0f, 3.0f };
+	const u16 normal[4] = { FloatToHalf(1.0f), FloatToHalf(0.5f), FloatToHalf(0.25f), FloatToHalf(1.0f) };
+	memcpy(src, pos, sizeof(pos));
+	memcpy(src + 12, normal, sizeof(normal));
+	TransformVerticesScalar(kWorldTransformFp16, m, src, dst, 1);
+
+	float outPos[3];
+	u16 outNormal[4];
+	memcpy(outPos, dst, sizeof(outPos));
+	memcpy(outNormal, dst + 12, sizeof(outNormal));
+	CHECK_EQ(outPos[0], 8.0f);
+	CHECK_EQ(outPos[1], 21.0f);
+	CHECK_EQ(outPos[2], 36.0f);
+	CHECK_EQ(HalfToFloat(outNormal[0]), -0.5f);
+	CHECK_EQ(HalfToFloat(outNormal[1]), 1.0f);
+	CHECK_EQ(HalfToFloat(outNormal[2]), 0.5f);
+	CHECK_EQ(outNormal[3], 0);
+}
+
+// AVX2 版は8の倍数でない頂点数も含めてスカラー版とビット単位で一致し、頂点間の隙間には書き込まない
+TEST_CASE(WorldTransform_Avx2MatchesScalar)
+{
+	float m[16];
+	MakeMatrix(m);
+	for (auto&& layout : kLayouts)
+	{
+		std::vector<u8> src = MakeVertices(layout, 3 * 37);
+		for (u32 count = 0; count <= 3 * 37; count += (count < 24) ? 1 : 29)
+		{
+			std::vector<u8> expected(src.size(), 0xcd), actual(src.size(), 0xcd);
+			TransformVerticesScalar(layout, m, src.data(), expected.data(), count);
+			TransformVerticesAvx2(layout, m, src.data(), actual.data(), count);
+			CHECK(expected == actual);
+
+			// 変換しなかった頂点と隙間はそのまま
+			size_t written = (size_t)count * layout.vertexStride;
+			bool isUntouched = true;
+			for (size_t i = written; i < expected.size(); i++)
+			{
+				isUntouched = isUntouched && (expected[i] == 0xcd);
+			}
+			CHECK(isUntouched);
+		}
+
+		// 隙間のバイトは書き込まれない
+		if (layout.vertexStride == 32)
+		{
+			std::vector<u8> dst(src.size(), 0xcd);
+			TransformVerticesAvx2(layout, m, src.data(), dst.data(), 3 * 37);
+			bool isGapUntouched = true;
+			for (u32 v = 0; v < 3 * 37; v++)
+			{
+				for (u32 b = 12; b < 16; b++)
+				{
+					isGapUntouched = isGapUntouched && (dst[v * 32 + b] == 0xcd);
+				}
+				for (u32 b = 24; b < 32; b++)
+				{
+					isGapUntouched = isGapUntouched && (dst[v * 32 + b] == 0xcd);
+				}
+			}
+			CHECK(isGapUntouched);
+		}
+	}
+}
+
+// 並列版はスレッド数によらずスカラー版と一致する
+TEST_CASE(WorldTransform_ParallelMatchesScalar)
+{
+	// スレッドあたり 64K 頂点未満は分割しないので、3分割できる頂点数にする
+	const u32 kVertexCount = 3 * 67001;
+	float m[16];
+	MakeMatrix(m);
+	for (auto&& layout : kLayouts)
+	{
+		std::vector<u8> src = MakeVertices(layout, kVertexCount);
+		std::vector<u8> expected(src.size(), 0xcd);
+		TransformVerticesScalar(layout, m, src.data(), expected.data(), kVertexCount);
+
+		const u32 threadCounts[] = { 1, 3, 0 };
+		for (u32 threads : threadCounts)
+		{
+			std::vector<u8> actual(src.size(), 0xcd);
+			TransformVerticesParallel(layout, m, src.data(), actual.data(), kVertexCount, threads);
+			CHECK(expected == actual);
+		}
+	}
+}
+
+// 許容誤差を超えた頂点だけを数え、最初の頂点番号を返す
+TEST_CASE(WorldTransform_Validate)
+{
+	float m[16];
+	MakeMatrix(m);
+	const u32 kVertexCount = 3 * 10;
+	for (auto&& layout : kLayouts)
+	{
+		std::vector<u8> src = MakeVertices(layout, kVertexCount);
+		std::vector<u8> expected(src.size()), actual;
+		TransformVerticesScalar(layout, m, src.data(), expected.data(), kVertexCount);
+
+		actual = expected;
+		WorldTransformValidation result = ValidateTransformedVertices(layout, expected.data(), actual.data(), kVertexCount, 0, 0, 0.0f);
+		CHECK_EQ(result.checkedCount, kVertexCount);
+		CHECK_EQ(result.errorCount, 0u);
+		CHECK_EQ(result.maxPositionUlp, 0u);
+		CHECK_EQ(result.maxNormalUlp, 0u);
+
+		// 頂点5の座標を 2ULP、頂点7の法線を 1ULP ずらす
+		s32 bits;
+		memcpy(&bits, &actual[5 * layout.vertexStride + 4], sizeof(bits));
+		bits += 2;
+		memcpy(&actual[5 * layout.vertexStride + 4], &bits, sizeof(bits));
+		if (layout.isHalfNormal)
+		{
+			u16 h;
+			memcpy(&h, &actual[7 * layout.vertexStride + layout.normalOffset], sizeof(h));
+			h = (h == 0) ? 1 : h + 1;
+			memcpy(&actual[7 * layout.vertexStride + layout.normalOffset], &h, sizeof(h));
+		}
+		else
+		{
+			memcpy(&bits, &actual[7 * layout.vertexStride + layout.normalOffset], sizeof(bits));
+			bits += 1;
+			memcpy(&actual[7 * layout.vertexStride + layout.normalOffset], &bits, sizeof(bits));
+		}
+
+		result = ValidateTransformedVertices(layout, expected.data(), actual.data(), kVertexCount, 2, 1, 0.0f);
+		CHECK_EQ(result.errorCount, 0u);
+		CHECK_EQ(result.maxPositionUlp, 2u);
+		CHECK_EQ(result.maxNormalUlp, 1u);
+
+		result = ValidateTransformedVertices(layout, expected.data(), actual.data(), kVertexCount, 1, 0, 0.0f);
+		CHECK_EQ(result.errorCount, 2u);
+		CHECK_EQ(result.firstErrorVertex, 5u);
+
+		// 絶対誤差が許容範囲内なら一致とみなす
+		result = ValidateTransformedVertices(layout, expected.data(), actual.data(), kVertexCount, 0, 0, 1e-2f);
+		CHECK_EQ(result.errorCount, 0u);
+	}
+}
+
+// スカラー/AVX2/並列の変換速度
+BENCH_CASE(Bench_WorldTransform)
+{
+	// AVX2 非対応の環境では AVX2 版はスカラー版を使用するので、速度も同じになる
+	printf("  AVX2 %s\n", IsWorldTransformAvx2Supported() ? "supported" : "not supported");
+
+	const WorldTransformLayout* layouts[] = { &kWorldTransformFp16, &kWorldTransformFp32 };
+	const char* names[] = { "fp16", "fp32" };
+	for (int l = 0; l < 2; l++)
+	{
+		WorldTransformBenchmark results[3];
+		BenchmarkWorldTransform(*layouts[l], 3 * 1000000, 5, results);
+		for (auto&& r : results)
+		{
+			printf("  %s %-8s: %.3f ms (%.1f Mvertices/s, %.2f GB/s)\n",
+				names[l], r.name, r.msPerRun, r.verticesPerSecond * 1e-6, r.bytesPerSecond * 1e-9);
+		}
+	}
+}
+
+
+//	EOF
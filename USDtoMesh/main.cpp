@@ -12,7 +12,11 @@
 #include "pxr/usd/usdRi/materialAPI.h"
 #include "pxr/usd/usdUtils/pipeline.h"
 
-#include "../SampleLib12/include/sl12/mesh_format.h"
+#include <chrono>
+#include <thread>
+
+#include "../SampleLib12/include/sl12/parallel.h"
+#include "mesh_export.h"
 
 /**********************************************//**
  * @brief ヘルプを表示
@@ -27,144 +31,50 @@ void DisplayHelp()
 	fprintf(stdout, "\n");
 	fprintf(stdout, "	オプション\n");
 	fprintf(stdout, "		-h		: ヘルプを表示\n");
+	fprintf(stdout, "		-c		: 頂点とインデックスを圧縮したv2形式で出力\n");
+	fprintf(stdout, "		-w <eps>	: 法線とUVの差が eps 程度の頂点を溶接する\n");
+	fprintf(stdout, "		-j <num>	: 使用するスレッド数 (省略時はハードウェアスレッド数)\n");
+	fprintf(stdout, "		-v		: 各処理の時間を表示\n");
+	fprintf(stdout, "		-m		: メッシュレットを生成してv2形式で出力\n");
+	fprintf(stdout, "		-l <num>	: 三角形数を半分ずつ減らしたLODを最大 num 段生成してv2形式で出力\n");
 }
 
 /**********************************************//**
- * @brief 浮動小数点ベクトル
-**************************************************/
-struct Vec2
-{
-	float	x, y;
-};
-struct Vec3
-{
-	float	x, y, z;
-};
-
-/**********************************************//**
- * @brief 頂点データ
-**************************************************/
-struct Vertex
-{
-	Vec3	position;
-	Vec3	normal;
-	Vec2	texcoord;
-
-	bool operator==(const Vertex& v) const
-	{
-		return memcmp(this, &v, sizeof(*this)) == 0;
-	}
-	bool operator!=(const Vertex& v) const
-	{
-		return !operator==(v);
-	}
-	bool operator<(const Vertex& v) const
-	{
-		return memcmp(this, &v, sizeof(*this)) < 0;
-	}
-	bool operator>(const Vertex& v) const
-	{
-		return memcmp(this, &v, sizeof(*this)) > 0;
-	}
-};	// struct Vertex
-
-/**********************************************//**
- * @brief バイナリデータ
+ * @brief 処理時間の計測
 **************************************************/
-class BinData
+class StageTimer
 {
 public:
-	BinData(size_t init_capa = 1024)
-	{
-		pData_ = (char*)malloc(init_capa);
-		assert(pData_ != nullptr);
-		size_ = 0;
-		capacity_ = init_capa;
-	}
-	~BinData()
-	{
-		if (pData_)
-		{
-			free(pData_);
-		}
-	}
-
-	const char* GetData() const
-	{
-		return pData_;
-	}
-	size_t GetSize() const
-	{
-		return size_;
-	}
+	StageTimer(bool enable)
+		: enable_(enable), start_(std::chrono::high_resolution_clock::now())
+	{}
 
-	size_t PushBack(void* p, size_t s)
+	void Report(const char* stage)
 	{
-		if (size_ + s > capacity_)
+		auto now = std::chrono::high_resolution_clock::now();
+		if (enable_)
 		{
-			// メモリの確保し直し
-			capacity_ = std::max<size_t>(size_ + s, capacity_ * 2);
-			char* pNew = (char*)malloc(capacity_);
-			assert(pNew != nullptr);
-			memcpy(pNew, pData_, size_);
-			free(pData_);
-			pData_ = pNew;
+			double ms = std::chrono::duration<double, std::milli>(now - start_).count();
+			fprintf(stdout, "[TIME] %-10s : %10.3f ms\n", stage, ms);
 		}
-
-		char* p_write = pData_ + size_;
-		memcpy(p_write, p, s);
-		size_t ret = size_;
-		size_ += s;
-		return ret;
+		start_ = now;
 	}
 
 private:
-	char*		pData_;
-	size_t		size_;
-	size_t		capacity_;
-};	// class BinData
-
-/**********************************************//**
- * @brief メッシュノード
-**************************************************/
-struct MeshNode
-{
-	pxr::UsdGeomMesh	src_mesh_;
-
-	std::string			name_;
-
-	std::vector<Vec3>	positions_;
-	std::vector<Vec3>	normals_;
-	std::vector<Vec2>	texcoords_;
-	std::vector<int>	poly_vertex_counts_;
-	std::vector<int>	poly_vertex_indices_;
-
-	std::vector<Vertex>	vertices_;
-	std::vector<int>	triangle_indices_;
-	std::vector<int>	triangle_material_indices_;
-	std::map<int, std::vector<sl12::u32>>	sub_mesh_indices_;
-};	// struct MeshNode
-
-/**********************************************//**
- * @brief マテリアルノード
-**************************************************/
-struct MaterialNode
-{
-	pxr::UsdShadeMaterial	src_material_;
-
-	std::string				name_;
-};	// struct MaterialNode
+	bool	enable_;
+	std::chrono::high_resolution_clock::time_point	start_;
+};	// class StageTimer
 
 /**********************************************//**
  * @brief マテリアルインデックスを検索する
 **************************************************/
-int FindMaterialIndex(const std::vector<MaterialNode*>& materials, pxr::SdfPath path)
+int FindMaterialIndex(const std::vector<pxr::SdfPath>& material_paths, pxr::SdfPath path)
 {
 	int ret = 0;
 
-	for (auto&& mat : materials)
+	for (auto&& mat_path : material_paths)
 	{
-		if (mat->src_material_.GetPath() == path)
+		if (mat_path == path)
 		{
 			return ret;
 		}
@@ -176,10 +86,8 @@ int FindMaterialIndex(const std::vector<MaterialNode*>& materials, pxr::SdfPath
 /**********************************************//**
  * @brief メッシュノードをインポートする
 **************************************************/
-bool ImportMesh(MeshNode& out_mesh, pxr::UsdGeomMesh& in_mesh, const std::vector<MaterialNode*>& materials)
+bool ImportMesh(MeshNode& out_mesh, pxr::UsdGeomMesh& in_mesh, const std::vector<pxr::SdfPath>& material_paths, float weld_epsilon)
 {
-	out_mesh.src_mesh_ = in_mesh;
-
 	// 名前の取得
 	{
 		std::string name = in_mesh.GetPath().GetString();
@@ -312,7 +220,7 @@ bool ImportMesh(MeshNode& out_mesh, pxr::UsdGeomMesh& in_mesh, const std::vector
 		auto&& mat_path = targets[mat_no];
 		auto&& face_count = counts[mat_no];
 
-		int mat_index = FindMaterialIndex(materials, mat_path);
+		int mat_index = FindMaterialIndex(material_paths, mat_path);
 		if (mat_index < 0)
 		{
 			fprintf(stderr, "[ERROR] 存在しないマテリアルがアサインされています. (%s)\n", mat_path.GetString().c_str());
@@ -325,88 +233,8 @@ bool ImportMesh(MeshNode& out_mesh, pxr::UsdGeomMesh& in_mesh, const std::vector
 		}
 	}
 
-	// 頂点データをまとめる
-	std::vector<int> new_indices;
-	std::map<Vertex, int> vertex_dic;
-	int count = 0;
-	for (auto&& index : out_mesh.poly_vertex_indices_)
-	{
-		Vertex v;
-		v.position = out_mesh.positions_[index];
-		v.normal = out_mesh.normals_[count];
-		v.texcoord = out_mesh.texcoords_[count];
-		++count;
-
-		auto&& it = vertex_dic.find(v);
-		if (it == vertex_dic.end())
-		{
-			int new_index = (int)out_mesh.vertices_.size();
-			out_mesh.vertices_.push_back(v);
-			new_indices.push_back(new_index);
-			vertex_dic[v] = new_index;
-		}
-		else
-		{
-			new_indices.push_back(it->second);
-		}
-	}
-	out_mesh.poly_vertex_indices_ = new_indices;
-
-	// ポリゴンをトライアングル化して展開する
-	for (size_t findex = 0, vindex = 0; findex < out_mesh.poly_vertex_counts_.size(); ++findex)
-	{
-		int vertex_count = out_mesh.poly_vertex_counts_[findex];
-		int mat_index = mat_assign_index[findex];
-		auto p_index = out_mesh.poly_vertex_indices_.data();
-
-		int s = 0;
-		int e = vertex_count - 1;
-		for (int i = 0; i < (vertex_count - 2); ++i)
-		{
-			if (i & 0x01)
-			{
-				// odd
-				out_mesh.triangle_indices_.push_back(p_index[vindex + s + 1]);
-				out_mesh.triangle_indices_.push_back(p_index[vindex + e - 1]);
-				out_mesh.triangle_indices_.push_back(p_index[vindex + e]);
-				s++;
-				e--;
-			}
-			else
-			{
-				// even
-				out_mesh.triangle_indices_.push_back(p_index[vindex + s]);
-				out_mesh.triangle_indices_.push_back(p_index[vindex + s + 1]);
-				out_mesh.triangle_indices_.push_back(p_index[vindex + e]);
-			}
-			out_mesh.triangle_material_indices_.push_back(mat_index);
-		}
-
-		vindex += vertex_count;
-	}
-
-	// アサインされてるマテリアルごとにグループ化し、サブメッシュとして登録する
-	int triangle_index = 0;
-	for (auto&& mat_index : out_mesh.triangle_material_indices_)
-	{
-		auto&& it = out_mesh.sub_mesh_indices_.find(mat_index);
-		if (it == out_mesh.sub_mesh_indices_.end())
-		{
-			std::vector<sl12::u32> indices;
-			indices.push_back(out_mesh.triangle_indices_[triangle_index * 3 + 0]);
-			indices.push_back(out_mesh.triangle_indices_[triangle_index * 3 + 1]);
-			indices.push_back(out_mesh.triangle_indices_[triangle_index * 3 + 2]);
-			out_mesh.sub_mesh_indices_[mat_index] = indices;
-		}
-		else
-		{
-			out_mesh.sub_mesh_indices_[mat_index].push_back(out_mesh.triangle_indices_[triangle_index * 3 + 0]);
-			out_mesh.sub_mesh_indices_[mat_index].push_back(out_mesh.triangle_indices_[triangle_index * 3 + 1]);
-			out_mesh.sub_mesh_indices_[mat_index].push_back(out_mesh.triangle_indices_[triangle_index * 3 + 2]);
-		}
-
-		++triangle_index;
-	}
+	// 頂点を溶接し、トライアングル化してサブメッシュにまとめる
+	TriangulateMeshNode(out_mesh, mat_assign_index, weld_epsilon);
 
 	return true;
 }
@@ -416,8 +244,6 @@ bool ImportMesh(MeshNode& out_mesh, pxr::UsdGeomMesh& in_mesh, const std::vector
 **************************************************/
 bool ImportMaterial(MaterialNode& out_mat, pxr::UsdShadeMaterial& in_mat)
 {
-	out_mat.src_material_ = in_mat;
-
 	// 名前
 	{
 		std::string name = in_mat.GetPath().GetString();
@@ -432,102 +258,6 @@ bool ImportMaterial(MaterialNode& out_mat, pxr::UsdShadeMaterial& in_mat)
 	return true;
 }
 
-/**********************************************//**
- * @brief .meshバイナリをエクスポートする
-**************************************************/
-bool ExportMeshBinary(const std::vector<MeshNode*>& meshes, const std::vector<MaterialNode*>& materials, const std::string& out_name)
-{
-	// ヘッダ
-	sl12::MeshHead mesh_head;
-	mesh_head.fourCC[0] = 'M';
-	mesh_head.fourCC[1] = 'E';
-	mesh_head.fourCC[2] = 'S';
-	mesh_head.fourCC[3] = 'H';
-	mesh_head.numShapes = (sl12::s32)meshes.size();
-	mesh_head.numMaterials = (sl12::s32)materials.size();
-	mesh_head.numSubmeshes = 0;
-
-	// シェイプ
-	std::vector<sl12::MeshShape> mesh_shapes;
-	mesh_shapes.resize(meshes.size());
-	BinData vertexBuffer(4 * 1024 * 1024);
-	for (size_t i = 0; i < meshes.size(); ++i)
-	{
-		auto&& in_mesh = meshes[i];
-		auto&& out_mesh = mesh_shapes[i];
-
-		strcpy_s(out_mesh.name, in_mesh->name_.c_str());
-		out_mesh.numVertices = (sl12::u32)in_mesh->vertices_.size();
-		out_mesh.numIndices = (sl12::u32)in_mesh->triangle_indices_.size();
-
-		out_mesh.positionOffset = vertexBuffer.GetSize();
-		for (auto&& v : in_mesh->vertices_)
-		{
-			vertexBuffer.PushBack(&v.position, sizeof(v.position));
-		}
-
-		out_mesh.normalOffset = vertexBuffer.GetSize();
-		for (auto&& v : in_mesh->vertices_)
-		{
-			vertexBuffer.PushBack(&v.normal, sizeof(v.normal));
-		}
-
-		out_mesh.texcoordOffset = vertexBuffer.GetSize();
-		for (auto&& v : in_mesh->vertices_)
-		{
-			vertexBuffer.PushBack(&v.texcoord, sizeof(v.texcoord));
-		}
-	}
-
-	// マテリアル
-	std::vector<sl12::MeshMaterial> mesh_materials;
-	mesh_materials.resize(materials.size());
-	for (size_t i = 0; i < materials.size(); ++i)
-	{
-		auto&& in_mat = materials[i];
-		auto&& out_mat = mesh_materials[i];
-
-		strcpy_s(out_mat.name, in_mat->name_.c_str());
-	}
-
-	// サブメッシュ
-	std::vector<sl12::MeshSubmesh> mesh_submeshes;
-	BinData indexBuffer(1024 * 1024);
-	for (size_t i = 0; i < meshes.size(); ++i)
-	{
-		auto&& mesh = meshes[i];
-
-		sl12::MeshSubmesh submesh;
-		submesh.shapeIndex = (sl12::s32)i;
-
-		for (auto&& sm : mesh->sub_mesh_indices_)
-		{
-			submesh.materialIndex = sm.first;
-			submesh.numSubmeshIndices = (sl12::u32)sm.second.size();
-			submesh.indexBufferOffset = vertexBuffer.GetSize() + indexBuffer.PushBack(sm.second.data(), sm.second.size() * sizeof(sl12::u32));
-			mesh_submeshes.push_back(submesh);
-
-			++mesh_head.numSubmeshes;
-		}
-	}
-
-	// バイナリに保存する
-	FILE* fp = nullptr;
-	if (fopen_s(&fp, out_name.c_str(), "wb") != 0)
-	{
-		return false;
-	}
-	fwrite(&mesh_head, sizeof(mesh_head), 1, fp);
-	fwrite(mesh_shapes.data(), sizeof(sl12::MeshShape), mesh_shapes.size(), fp);
-	fwrite(mesh_materials.data(), sizeof(sl12::MeshMaterial), mesh_materials.size(), fp);
-	fwrite(mesh_submeshes.data(), sizeof(sl12::MeshSubmesh), mesh_submeshes.size(), fp);
-	fwrite(vertexBuffer.GetData(), vertexBuffer.GetSize(), 1, fp);
-	fwrite(indexBuffer.GetData(), indexBuffer.GetSize(), 1, fp);
-	fclose(fp);
-
-	return true;
-}
-
 int main(int argc, char* argv[])
 {
 	if (argc <= 2)
@@ -537,6 +267,8 @@ int main(int argc, char* argv[])
 	}
 
 	std::string input_filepath, output_filepath;
+	ConvertOptions options;
+	options.num_threads = (int)std::thread::hardware_concurrency();
 	for (int i = 1; i < argc; ++i)
 	{
 		std::string arg(argv[i]);
@@ -548,6 +280,45 @@ int main(int argc, char* argv[])
 				DisplayHelp();
 				return 0;
 			}
+			else if (arg == "-c")
+			{
+				options.compress = true;
+			}
+			else if (arg == "-w")
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "[ERROR] -w オプションには値を指定してください.\n");
+					return -1;
+				}
+				options.weld_epsilon = (float)atof(argv[++i]);
+			}
+			else if (arg == "-j")
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "[ERROR] -j オプションには値を指定してください.\n");
+					return -1;
+				}
+				options.num_threads = atoi(argv[++i]);
+			}
+			else if (arg == "-v")
+			{
+				options.verbose = true;
+			}
+			else if (arg == "-m")
+			{
+				options.build_meshlets = true;
+			}
+			else if (arg == "-l")
+			{
+				if (i + 1 >= argc)
+				{
+					fprintf(stderr, "[ERROR] -l オプションには値を指定してください.\n");
+					return -1;
+				}
+				options.num_lods = (sl12::u32)std::max(atoi(argv[++i]), 0);
+			}
 			else
 			{
 				fprintf(stderr, "[ERROR] 無効なオプションです. (%s)\n", arg.c_str());
@@ -575,6 +346,7 @@ int main(int argc, char* argv[])
 		return -1;
 	}
 
+	StageTimer timer(options.verbose);
 	auto stage = pxr::UsdStage::Open(input_filepath, pxr::UsdStage::LoadNone);
 	if (stage == nullptr)
 	{
@@ -592,6 +364,7 @@ int main(int argc, char* argv[])
 
 	// マテリアルをインポート
 	std::vector<MaterialNode*> materials;
+	std::vector<pxr::SdfPath> material_paths;
 	for (auto&& prim : range)
 	{
 		if (prim.GetTypeName() == "Material")
@@ -601,30 +374,79 @@ int main(int argc, char* argv[])
 			if (ImportMaterial(*mat_node, mat))
 			{
 				materials.push_back(mat_node);
+				material_paths.push_back(mat.GetPath());
 			}
 		}
 	}
 
 	// メッシュをインポート
-	std::vector<MeshNode*> meshes;
+	// インポートと最適化はメッシュ単位で並列に行い、結果は元の順序で並べる
+	std::vector<pxr::UsdPrim> mesh_prims;
 	for (auto&& prim : range)
 	{
 		if (prim.GetTypeName() == "Mesh")
 		{
-			pxr::UsdGeomMesh mesh(prim);
-			MeshNode* mesh_node = new MeshNode;
-			if (ImportMesh(*mesh_node, mesh, materials))
-			{
-				meshes.push_back(mesh_node);
-			}
+			mesh_prims.push_back(prim);
 		}
 	}
+	timer.Report("load");
+
+	std::vector<MeshNode*> mesh_nodes(mesh_prims.size(), nullptr);
+	sl12::ParallelFor((sl12::u32)mesh_prims.size(), (sl12::u32)std::max(options.num_threads, 1), [&](sl12::u32 i)
+	{
+		pxr::UsdGeomMesh mesh(mesh_prims[i]);
+		MeshNode* mesh_node = new MeshNode;
+		if (ImportMesh(*mesh_node, mesh, material_paths, options.weld_epsilon))
+		{
+			OptimizeMeshNode(*mesh_node, options);
+			mesh_nodes[i] = mesh_node;
+		}
+		else
+		{
+			delete mesh_node;
+		}
+	});
+	std::vector<MeshNode*> meshes;
+	for (auto&& mesh_node : mesh_nodes)
+	{
+		if (mesh_node)
+		{
+			meshes.push_back(mesh_node);
+			fprintf(stdout, "[INFO] %s : ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", mesh_node->name_.c_str(),
+				mesh_node->cache_stats_before_.acmr, mesh_node->cache_stats_after_.acmr,
+				mesh_node->cache_stats_before_.atvr, mesh_node->cache_stats_after_.atvr);
+		}
+	}
+	timer.Report("import");
 
 	// バイナリを生成して保存する
-	if (!ExportMeshBinary(meshes, materials, output_filepath))
+	std::vector<char> binary;
+	MeshBinaryInfo info;
+	if (!BuildMeshBinary(meshes, materials, options, binary, &info))
 	{
-		return false;
+		return -1;
+	}
+	if (info.numMeshlets > 0)
+	{
+		fprintf(stdout, "[INFO] メッシュレット数 : %u\n", info.numMeshlets);
 	}
+	if (info.numLods > 0)
+	{
+		fprintf(stdout, "[INFO] LOD数 : %u\n", info.numLods);
+	}
+	timer.Report("build");
+
+	FILE* fp = nullptr;
+	if (fopen_s(&fp, output_filepath.c_str(), "wb") != 0)
+	{
+		fprintf(stderr, "[ERROR] 出力ファイルを開けません. (%s)\n", output_filepath.c_str());
+		return -1;
+	}
+	fwrite(binary.data(), binary.size(), 1, fp);
+	fclose(fp);
+	timer.Report("write");
+
+	fprintf(stdout, "[INFO] 頂点・インデックス領域のサイズ : %lld bytes (ver %u)\n", (long long)info.bodySize, info.version);
 
 	// 終了処理
 	for (auto&& v : materials) delete v;
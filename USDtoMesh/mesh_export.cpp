@@ -0,0 +1,690 @@
+﻿#include "mesh_export.h"
+
+#include <algorithm>
+#include <math.h>
+#include <assert.h>
+
+#include "../SampleLib12/include/sl12/mesh_codec.h"
+#include "../SampleLib12/include/sl12/parallel.h"
+
+
+namespace
+{
+	/**********************************************//**
+	 * @brief シェイプの出力レイアウト
+	 *
+	 * 頂点領域先頭からのオフセットとサイズ.\n
+	 * 各ストリームの先頭は4byteアラインとする.
+	**************************************************/
+	struct ShapeLayout
+	{
+		size_t	vertexOffset = 0;
+		size_t	vertexSize = 0;
+		size_t	indexOffset = 0;
+		size_t	indexSize = 0;
+		bool	isShortIndex = false;
+	};	// struct ShapeLayout
+
+	inline size_t AlignSize(size_t size)
+	{
+		return (size + 3) & ~(size_t)3;
+	}
+
+	// チャンクは u64 を含むデータをそのまま参照できるように、先頭とサイズを8byteアラインとする
+	inline size_t AlignChunkSize(size_t size)
+	{
+		return (size + 7) & ~(size_t)7;
+	}
+}
+
+//---------------------------------------
+// 頂点溶接テーブルを初期化する
+//---------------------------------------
+VertexWelder::VertexWelder(size_t max_vertices, float epsilon)
+	: inv_epsilon_(epsilon > 0.0f ? 1.0f / epsilon : 0.0f)
+{
+	// 一意な頂点数は角の数を超えないので、負荷率が 0.5 以下になるように確保する
+	size_t size = 16;
+	while (size < max_vertices * 2)
+	{
+		size <<= 1;
+	}
+	table_.resize(size, -1);
+	mask_ = size - 1;
+	keys_.reserve(max_vertices);
+}
+
+//---------------------------------------
+// 頂点を検索し、なければ追加する
+//---------------------------------------
+int VertexWelder::FindOrAdd(const Vertex& v, std::vector<Vertex>& vertices)
+{
+	Vertex key = MakeKey(v);
+	size_t slot = Hash(key) & mask_;
+	while (true)
+	{
+		int index = table_[slot];
+		if (index < 0)
+		{
+			assert(keys_.size() < table_.size() / 2);
+			index = (int)vertices.size();
+			vertices.push_back(v);
+			keys_.push_back(key);
+			table_[slot] = index;
+			return index;
+		}
+		if (keys_[index] == key)
+		{
+			return index;
+		}
+		slot = (slot + 1) & mask_;
+	}
+}
+
+//---------------------------------------
+// 溶接用のキーを生成する
+//---------------------------------------
+Vertex VertexWelder::MakeKey(const Vertex& v) const
+{
+	if (inv_epsilon_ <= 0.0f)
+	{
+		return v;
+	}
+
+	auto q = [this](float x)
+	{
+		// -0.0 と 0.0 が別のキーにならないように 0.0 を足す
+		return floorf(x * inv_epsilon_ + 0.5f) + 0.0f;
+	};
+	Vertex ret = v;
+	ret.normal.x = q(v.normal.x);
+	ret.normal.y = q(v.normal.y);
+	ret.normal.z = q(v.normal.z);
+	ret.texcoord.x = q(v.texcoord.x);
+	ret.texcoord.y = q(v.texcoord.y);
+	return ret;
+}
+
+//---------------------------------------
+// キーのハッシュ値を求める
+//---------------------------------------
+size_t VertexWelder::Hash(const Vertex& v)
+{
+	static_assert(sizeof(Vertex) % sizeof(uint32_t) == 0, "Vertex must be packed in 32bit words.");
+
+	// 32bitワード単位で混ぜ合わせる
+	uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+	memcpy(words, &v, sizeof(words));
+	uint64_t h = 0x9e3779b97f4a7c15ull;
+	for (auto w : words)
+	{
+		h ^= w;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 32;
+	}
+	return (size_t)h;
+}
+
+//---------------------------------------
+// ポリゴンの角を溶接し、三角形に分割してマテリアルごとのサブメッシュにまとめる
+//---------------------------------------
+void TriangulateMeshNode(MeshNode& out_mesh, const std::vector<int>& poly_material_indices, float weld_epsilon)
+{
+	// 一意な頂点数は角の数以下なので、角の数から各バッファを確保しておく
+	size_t corner_count = out_mesh.poly_vertex_indices_.size();
+	std::vector<int> new_indices;
+	new_indices.reserve(corner_count);
+	out_mesh.vertices_.reserve(corner_count);
+	VertexWelder welder(corner_count, weld_epsilon);
+	int count = 0;
+	for (auto&& index : out_mesh.poly_vertex_indices_)
+	{
+		Vertex v;
+		v.position = out_mesh.positions_[index];
+		v.normal = out_mesh.normals_[count];
+		v.texcoord = out_mesh.texcoords_[count];
+		++count;
+
+		new_indices.push_back(welder.FindOrAdd(v, out_mesh.vertices_));
+	}
+	out_mesh.poly_vertex_indices_.swap(new_indices);
+	out_mesh.vertices_.shrink_to_fit();
+
+	// ポリゴンをトライアングル化して展開する
+	for (size_t findex = 0, vindex = 0; findex < out_mesh.poly_vertex_counts_.size(); ++findex)
+	{
+		int vertex_count = out_mesh.poly_vertex_counts_[findex];
+		int mat_index = poly_material_indices[findex];
+		auto p_index = out_mesh.poly_vertex_indices_.data();
+
+		int s = 0;
+		int e = vertex_count - 1;
+		for (int i = 0; i < (vertex_count - 2); ++i)
+		{
+			if (i & 0x01)
+			{
+				// odd
+				out_mesh.triangle_indices_.push_back(p_index[vindex + s + 1]);
+				out_mesh.triangle_indices_.push_back(p_index[vindex + e - 1]);
+				out_mesh.triangle_indices_.push_back(p_index[vindex + e]);
+				s++;
+				e--;
+			}
+			else
+			{
+				// even
+				out_mesh.triangle_indices_.push_back(p_index[vindex + s]);
+				out_mesh.triangle_indices_.push_back(p_index[vindex + s + 1]);
+				out_mesh.triangle_indices_.push_back(p_index[vindex + e]);
+			}
+			out_mesh.triangle_material_indices_.push_back(mat_index);
+		}
+
+		vindex += vertex_count;
+	}
+
+	// アサインされてるマテリアルごとにグループ化し、サブメッシュとして登録する
+	int triangle_index = 0;
+	for (auto&& mat_index : out_mesh.triangle_material_indices_)
+	{
+		auto&& it = out_mesh.sub_mesh_indices_.find(mat_index);
+		if (it == out_mesh.sub_mesh_indices_.end())
+		{
+			std::vector<sl12::u32> indices;
+			indices.push_back(out_mesh.triangle_indices_[triangle_index * 3 + 0]);
+			indices.push_back(out_mesh.triangle_indices_[triangle_index * 3 + 1]);
+			indices.push_back(out_mesh.triangle_indices_[triangle_index * 3 + 2]);
+			out_mesh.sub_mesh_indices_[mat_index] = indices;
+		}
+		else
+		{
+			out_mesh.sub_mesh_indices_[mat_index].push_back(out_mesh.triangle_indices_[triangle_index * 3 + 0]);
+			out_mesh.sub_mesh_indices_[mat_index].push_back(out_mesh.triangle_indices_[triangle_index * 3 + 1]);
+			out_mesh.sub_mesh_indices_[mat_index].push_back(out_mesh.triangle_indices_[triangle_index * 3 + 2]);
+		}
+
+		++triangle_index;
+	}
+}
+
+//---------------------------------------
+// シェイプ全体の頂点キャッシュ統計を取得する
+//---------------------------------------
+VertexCacheStats AnalyzeMeshNode(const MeshNode& mesh)
+{
+	VertexCacheStats ret;
+	size_t num_triangles = 0;
+	for (auto&& sm : mesh.sub_mesh_indices_)
+	{
+		auto stats = AnalyzeVertexCache(sm.second.data(), sm.second.size(), (uint32_t)mesh.vertices_.size());
+		ret.numTransformed += stats.numTransformed;
+		num_triangles += sm.second.size() / 3;
+	}
+	if (num_triangles > 0 && !mesh.vertices_.empty())
+	{
+		ret.acmr = (float)ret.numTransformed / (float)num_triangles;
+		ret.atvr = (float)ret.numTransformed / (float)mesh.vertices_.size();
+	}
+	return ret;
+}
+
+//---------------------------------------
+// メッシュノードの頂点キャッシュと頂点フェッチを最適化する
+//---------------------------------------
+void OptimizeMeshNode(MeshNode& mesh, const ConvertOptions& options)
+{
+	mesh.cache_stats_before_ = AnalyzeMeshNode(mesh);
+
+	// 頂点キャッシュ最適化
+	uint32_t num_vertices = (uint32_t)mesh.vertices_.size();
+	for (auto&& sm : mesh.sub_mesh_indices_)
+	{
+		OptimizeVertexCache(sm.second, num_vertices);
+	}
+
+	// 頂点フェッチ最適化
+	std::vector<const std::vector<sl12::u32>*> index_lists;
+	for (auto&& sm : mesh.sub_mesh_indices_)
+	{
+		index_lists.push_back(&sm.second);
+	}
+	auto remap = BuildVertexFetchRemap(index_lists, num_vertices);
+
+	std::vector<Vertex> new_vertices(mesh.vertices_.size());
+	for (size_t i = 0; i < mesh.vertices_.size(); ++i)
+	{
+		new_vertices[remap[i]] = mesh.vertices_[i];
+	}
+	mesh.vertices_.swap(new_vertices);
+	for (auto&& sm : mesh.sub_mesh_indices_)
+	{
+		for (auto&& index : sm.second)
+		{
+			index = remap[index];
+		}
+	}
+	for (auto&& index : mesh.triangle_indices_)
+	{
+		index = remap[index];
+	}
+
+	mesh.cache_stats_after_ = AnalyzeMeshNode(mesh);
+
+	// LOD生成
+	// 頂点は縮約先の既存頂点を参照するので、LODも同じ頂点バッファを使う
+	if (options.num_lods > 0)
+	{
+		SimplifyVertexInput input;
+		if (!mesh.vertices_.empty())
+		{
+			input.pPositions = &mesh.vertices_[0].position.x;
+			input.pNormals = &mesh.vertices_[0].normal.x;
+			input.pTexcoords = &mesh.vertices_[0].texcoord.x;
+		}
+		input.stride = sizeof(Vertex);
+		input.numVertices = num_vertices;
+
+		for (auto&& sm : mesh.sub_mesh_indices_)
+		{
+			std::vector<SimplifyLod> lods;
+			if (!mesh.vertices_.empty())
+			{
+				SimplifyLodChain(sm.second, input, options.num_lods, options.lod_reduction, options.lod_attribute_weight, lods);
+			}
+			for (auto&& lod : lods)
+			{
+				OptimizeVertexCache(lod.indices, num_vertices);
+			}
+			mesh.sub_mesh_lods_.push_back(std::move(lods));
+		}
+	}
+
+	// メッシュレット生成
+	// 最適化後の三角形の順序で詰めるので、キャッシュ効率の良い順序がそのまま局所性になる
+	if (options.build_meshlets)
+	{
+		for (auto&& sm : mesh.sub_mesh_indices_)
+		{
+			sl12::u32 count = 0;
+			if (!mesh.vertices_.empty())
+			{
+				count = BuildMeshlets(sm.second, &mesh.vertices_[0].position.x, sizeof(Vertex), num_vertices,
+					options.meshlet_max_vertices, options.meshlet_max_primitives, mesh.meshlets_);
+			}
+			mesh.sub_mesh_meshlet_counts_.push_back(count);
+		}
+	}
+}
+
+//---------------------------------------
+// .meshバイナリを生成する
+//---------------------------------------
+bool BuildMeshBinary(const std::vector<MeshNode*>& meshes, const std::vector<MaterialNode*>& materials, const ConvertOptions& options, std::vector<char>& out_binary, MeshBinaryInfo* pInfo)
+{
+	const bool compress = options.compress;
+	const bool versioned = options.compress || options.build_meshlets || (options.num_lods > 0);
+
+	// ヘッダ
+	sl12::MeshHead mesh_head;
+	memset(&mesh_head, 0, sizeof(mesh_head));
+	memcpy(mesh_head.fourCC, versioned ? "MSHV" : "MESH", 4);
+	mesh_head.numShapes = (sl12::s32)meshes.size();
+	mesh_head.numMaterials = (sl12::s32)materials.size();
+	mesh_head.numSubmeshes = 0;
+	mesh_head.version = versioned ? sl12::kMeshVersion2 : sl12::kMeshVersion1;
+	mesh_head.flags = compress ? sl12::MeshFlag::QuantizedVertex : sl12::MeshFlag::None;
+
+	const size_t position_stride = compress ? sizeof(sl12::u16) * 3 : sizeof(Vec3);
+	const size_t normal_stride = compress ? sizeof(sl12::s16) * 2 : sizeof(Vec3);
+	const size_t texcoord_stride = compress ? sizeof(sl12::u16) * 2 : sizeof(Vec2);
+
+	// 各シェイプのサイズを求め、累積和で出力位置を決める
+	std::vector<ShapeLayout> layouts(meshes.size());
+	size_t vertex_total = 0, index_total = 0;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		auto&& mesh = meshes[i];
+		auto&& layout = layouts[i];
+		size_t num_vertices = mesh->vertices_.size();
+
+		layout.isShortIndex = compress && (num_vertices <= 65536);
+		layout.vertexOffset = vertex_total;
+		layout.vertexSize = AlignSize(num_vertices * position_stride) + AlignSize(num_vertices * normal_stride) + AlignSize(num_vertices * texcoord_stride);
+		vertex_total += layout.vertexSize;
+
+		size_t index_stride = layout.isShortIndex ? sizeof(sl12::u16) : sizeof(sl12::u32);
+		layout.indexOffset = index_total;
+		for (auto&& sm : mesh->sub_mesh_indices_)
+		{
+			layout.indexSize += AlignSize(sm.second.size() * index_stride);
+		}
+		for (auto&& lods : mesh->sub_mesh_lods_)
+		{
+			for (auto&& lod : lods)
+			{
+				layout.indexSize += AlignSize(lod.indices.size() * index_stride);
+			}
+		}
+		index_total += layout.indexSize;
+
+		if (layout.isShortIndex)
+		{
+			mesh_head.flags |= sl12::MeshFlag::ShortIndex;
+		}
+	}
+
+	// シェイプとサブメッシュのテーブル
+	std::vector<sl12::MeshShape> mesh_shapes(meshes.size());
+	std::vector<sl12::MeshSubmesh> mesh_submeshes;
+	std::vector<sl12::MeshSubmeshLodRange> lod_ranges;
+	std::vector<sl12::MeshSubmeshLod> lod_entries;
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		auto&& in_mesh = meshes[i];
+		auto&& out_mesh = mesh_shapes[i];
+		auto&& layout = layouts[i];
+		size_t num_vertices = in_mesh->vertices_.size();
+
+		memset(&out_mesh, 0, sizeof(out_mesh));
+		strcpy_s(out_mesh.name, in_mesh->name_.c_str());
+		out_mesh.numVertices = (sl12::u32)num_vertices;
+		out_mesh.numIndices = (sl12::u32)in_mesh->triangle_indices_.size();
+		out_mesh.positionFormat = compress ? sl12::MeshStreamFormat::UNorm16x3 : sl12::MeshStreamFormat::Float3;
+		out_mesh.normalFormat = compress ? sl12::MeshStreamFormat::OctSNorm16x2 : sl12::MeshStreamFormat::Float3;
+		out_mesh.texcoordFormat = compress ? sl12::MeshStreamFormat::Half2 : sl12::MeshStreamFormat::Float2;
+		out_mesh.positionOffset = layout.vertexOffset;
+		out_mesh.normalOffset = out_mesh.positionOffset + AlignSize(num_vertices * position_stride);
+		out_mesh.texcoordOffset = out_mesh.normalOffset + AlignSize(num_vertices * normal_stride);
+
+		// AABB
+		if (!in_mesh->vertices_.empty())
+		{
+			auto&& p0 = in_mesh->vertices_[0].position;
+			out_mesh.aabbMin[0] = out_mesh.aabbMax[0] = p0.x;
+			out_mesh.aabbMin[1] = out_mesh.aabbMax[1] = p0.y;
+			out_mesh.aabbMin[2] = out_mesh.aabbMax[2] = p0.z;
+		}
+		for (auto&& v : in_mesh->vertices_)
+		{
+			out_mesh.aabbMin[0] = std::min(out_mesh.aabbMin[0], v.position.x);
+			out_mesh.aabbMin[1] = std::min(out_mesh.aabbMin[1], v.position.y);
+			out_mesh.aabbMin[2] = std::min(out_mesh.aabbMin[2], v.position.z);
+			out_mesh.aabbMax[0] = std::max(out_mesh.aabbMax[0], v.position.x);
+			out_mesh.aabbMax[1] = std::max(out_mesh.aabbMax[1], v.position.y);
+			out_mesh.aabbMax[2] = std::max(out_mesh.aabbMax[2], v.position.z);
+		}
+
+		// サブメッシュ
+		sl12::MeshSubmesh submesh;
+		memset(&submesh, 0, sizeof(submesh));
+		submesh.shapeIndex = (sl12::s32)i;
+		submesh.indexFormat = layout.isShortIndex ? sl12::MeshStreamFormat::UInt16 : sl12::MeshStreamFormat::UInt32;
+		size_t index_stride = layout.isShortIndex ? sizeof(sl12::u16) : sizeof(sl12::u32);
+		size_t index_offset = vertex_total + layout.indexOffset;
+		for (auto&& sm : in_mesh->sub_mesh_indices_)
+		{
+			submesh.materialIndex = sm.first;
+			submesh.numSubmeshIndices = (sl12::u32)sm.second.size();
+			submesh.indexBufferOffset = index_offset;
+			index_offset += AlignSize(sm.second.size() * index_stride);
+			mesh_submeshes.push_back(submesh);
+
+			++mesh_head.numSubmeshes;
+		}
+
+		// LODのインデックスは全サブメッシュのLOD0の後ろに並べる
+		for (size_t s = 0; s < in_mesh->sub_mesh_indices_.size(); ++s)
+		{
+			sl12::MeshSubmeshLodRange range = { (sl12::u32)lod_entries.size(), 0 };
+			if (s < in_mesh->sub_mesh_lods_.size())
+			{
+				for (auto&& lod : in_mesh->sub_mesh_lods_[s])
+				{
+					sl12::MeshSubmeshLod entry;
+					memset(&entry, 0, sizeof(entry));
+					entry.indexBufferOffset = index_offset;
+					entry.numIndices = (sl12::u32)lod.indices.size();
+					entry.error = lod.error;
+					index_offset += AlignSize(lod.indices.size() * index_stride);
+					lod_entries.push_back(entry);
+					++range.lodCount;
+				}
+			}
+			lod_ranges.push_back(range);
+		}
+	}
+
+	// マテリアル
+	std::vector<sl12::MeshMaterial> mesh_materials;
+	mesh_materials.resize(materials.size());
+	for (size_t i = 0; i < materials.size(); ++i)
+	{
+		auto&& in_mat = materials[i];
+		auto&& out_mat = mesh_materials[i];
+
+		strcpy_s(out_mat.name, in_mat->name_.c_str());
+	}
+
+	// 頂点・インデックス領域を確保し、シェイプ単位で並列に書き込む
+	// パディングは0で埋めておく
+	std::vector<char> body(vertex_total + index_total, 0);
+	sl12::ParallelFor((sl12::u32)meshes.size(), (sl12::u32)std::max(options.num_threads, 1), [&](sl12::u32 i)
+	{
+		auto&& in_mesh = meshes[i];
+		auto&& out_mesh = mesh_shapes[i];
+		auto&& layout = layouts[i];
+
+		char* p_position = body.data() + out_mesh.positionOffset;
+		char* p_normal = body.data() + out_mesh.normalOffset;
+		char* p_texcoord = body.data() + out_mesh.texcoordOffset;
+		for (auto&& v : in_mesh->vertices_)
+		{
+			if (!compress)
+			{
+				memcpy(p_position, &v.position, sizeof(v.position));
+				memcpy(p_normal, &v.normal, sizeof(v.normal));
+				memcpy(p_texcoord, &v.texcoord, sizeof(v.texcoord));
+			}
+			else
+			{
+				sl12::u16 q[3];
+				sl12::MeshQuantizePosition(&v.position.x, out_mesh.aabbMin, out_mesh.aabbMax, q);
+				memcpy(p_position, q, sizeof(q));
+
+				sl12::s16 oct[2];
+				sl12::MeshOctEncodeNormal(&v.normal.x, oct);
+				memcpy(p_normal, oct, sizeof(oct));
+
+				sl12::u16 uv[2] = { sl12::MeshFloatToHalf(v.texcoord.x), sl12::MeshFloatToHalf(v.texcoord.y) };
+				memcpy(p_texcoord, uv, sizeof(uv));
+			}
+			p_position += position_stride;
+			p_normal += normal_stride;
+			p_texcoord += texcoord_stride;
+		}
+
+		char* p_index = body.data() + vertex_total + layout.indexOffset;
+		auto write_indices = [&](const std::vector<sl12::u32>& indices)
+		{
+			if (layout.isShortIndex)
+			{
+				sl12::u16* p = (sl12::u16*)p_index;
+				for (auto index : indices)
+				{
+					*p++ = (sl12::u16)index;
+				}
+				p_index += AlignSize(indices.size() * sizeof(sl12::u16));
+			}
+			else
+			{
+				memcpy(p_index, indices.data(), indices.size() * sizeof(sl12::u32));
+				p_index += indices.size() * sizeof(sl12::u32);
+			}
+		};
+		for (auto&& sm : in_mesh->sub_mesh_indices_)
+		{
+			write_indices(sm.second);
+		}
+		for (auto&& lods : in_mesh->sub_mesh_lods_)
+		{
+			for (auto&& lod : lods)
+			{
+				write_indices(lod.indices);
+			}
+		}
+	});
+
+	sl12::u32 num_meshlets = 0, num_lods = 0;
+
+	// チャンクはインデックス領域の直後に順に置く
+	struct ChunkData
+	{
+		char				fourCC[4];
+		std::vector<char>	data;
+	};	// struct ChunkData
+	std::vector<ChunkData> chunks;
+	auto append_chunk = [&](const char* fourCC)
+	{
+		chunks.emplace_back();
+		memcpy(chunks.back().fourCC, fourCC, 4);
+		return &chunks.back().data;
+	};
+
+	// メッシュレットチャンク
+	// 各シェイプの結果を連結し、オフセットを全体に対するものに直す
+	if (options.build_meshlets)
+	{
+		sl12::MeshletChunkHead chunk_head = {};
+		std::vector<sl12::MeshletSubmesh> chunk_submeshes;
+		std::vector<sl12::MeshMeshlet> chunk_meshlets;
+		std::vector<sl12::u32> chunk_vertices, chunk_primitives;
+		for (auto&& mesh : meshes)
+		{
+			sl12::u32 meshlet_offset = (sl12::u32)chunk_meshlets.size();
+			for (auto count : mesh->sub_mesh_meshlet_counts_)
+			{
+				sl12::MeshletSubmesh range = { meshlet_offset, count };
+				chunk_submeshes.push_back(range);
+				meshlet_offset += count;
+			}
+
+			sl12::u32 vertex_base = (sl12::u32)chunk_vertices.size();
+			sl12::u32 primitive_base = (sl12::u32)chunk_primitives.size();
+			for (auto meshlet : mesh->meshlets_.meshlets)
+			{
+				meshlet.vertexOffset += vertex_base;
+				meshlet.primitiveOffset += primitive_base;
+				chunk_meshlets.push_back(meshlet);
+			}
+			chunk_vertices.insert(chunk_vertices.end(), mesh->meshlets_.vertexIndices.begin(), mesh->meshlets_.vertexIndices.end());
+			chunk_primitives.insert(chunk_primitives.end(), mesh->meshlets_.primitives.begin(), mesh->meshlets_.primitives.end());
+		}
+		chunk_head.numSubmeshes = (sl12::u32)chunk_submeshes.size();
+		chunk_head.numMeshlets = (sl12::u32)chunk_meshlets.size();
+		chunk_head.numVertexIndices = (sl12::u32)chunk_vertices.size();
+		chunk_head.numPrimitives = (sl12::u32)chunk_primitives.size();
+
+		std::vector<char>* meshlet_chunk = append_chunk("MLET");
+		auto append = [&](const void* p, size_t size)
+		{
+			meshlet_chunk->insert(meshlet_chunk->end(), (const char*)p, (const char*)p + size);
+		};
+		append(&chunk_head, sizeof(chunk_head));
+		append(chunk_submeshes.data(), chunk_submeshes.size() * sizeof(sl12::MeshletSubmesh));
+		append(chunk_meshlets.data(), chunk_meshlets.size() * sizeof(sl12::MeshMeshlet));
+		append(chunk_vertices.data(), chunk_vertices.size() * sizeof(sl12::u32));
+		append(chunk_primitives.data(), chunk_primitives.size() * sizeof(sl12::u32));
+
+		mesh_head.flags |= sl12::MeshFlag::Chunk;
+		num_meshlets = chunk_head.numMeshlets;
+	}
+
+	// サブメッシュLODチャンク
+	if (!lod_entries.empty())
+	{
+		sl12::MeshLodChunkHead chunk_head = {};
+		chunk_head.numSubmeshes = (sl12::u32)lod_ranges.size();
+		chunk_head.numLods = (sl12::u32)lod_entries.size();
+
+		std::vector<char>* lod_chunk = append_chunk("SLOD");
+		auto append = [&](const void* p, size_t size)
+		{
+			lod_chunk->insert(lod_chunk->end(), (const char*)p, (const char*)p + size);
+		};
+		append(&chunk_head, sizeof(chunk_head));
+		append(lod_ranges.data(), lod_ranges.size() * sizeof(sl12::MeshSubmeshLodRange));
+		append(lod_entries.data(), lod_entries.size() * sizeof(sl12::MeshSubmeshLod));
+
+		mesh_head.flags |= sl12::MeshFlag::Chunk;
+		num_lods = chunk_head.numLods;
+	}
+
+	// チャンクの先頭とサイズを8byteアラインに揃える
+	// v2 のヘッダとテーブルはすべて8byteの倍数なので、頂点領域の先頭も8byteアラインになる
+	if (!chunks.empty())
+	{
+		body.resize(AlignChunkSize(body.size()), 0);
+		for (auto&& c : chunks)
+		{
+			c.data.resize(AlignChunkSize(c.data.size()), 0);
+		}
+	}
+
+	// ファイルの内容を連結する
+	out_binary.clear();
+	auto append_binary = [&](const void* p, size_t size)
+	{
+		out_binary.insert(out_binary.end(), (const char*)p, (const char*)p + size);
+	};
+	if (versioned)
+	{
+		append_binary(&mesh_head, sizeof(mesh_head));
+		append_binary(mesh_shapes.data(), sizeof(sl12::MeshShape) * mesh_shapes.size());
+	}
+	else
+	{
+		// v1 はヘッダとシェイプの先頭部分のみを出力する
+		append_binary(&mesh_head, sizeof(sl12::MeshHeadV1));
+		for (auto&& shape : mesh_shapes)
+		{
+			append_binary(&shape, sizeof(sl12::MeshShapeV1));
+		}
+	}
+	append_binary(mesh_materials.data(), sizeof(sl12::MeshMaterial) * mesh_materials.size());
+	append_binary(mesh_submeshes.data(), sizeof(sl12::MeshSubmesh) * mesh_submeshes.size());
+	if (!chunks.empty())
+	{
+		sl12::MeshChunkTable chunk_table = { (sl12::u32)chunks.size(), 0 };
+		append_binary(&chunk_table, sizeof(chunk_table));
+
+		size_t chunk_offset = body.size();
+		for (auto&& c : chunks)
+		{
+			sl12::MeshChunk chunk;
+			memset(&chunk, 0, sizeof(chunk));
+			memcpy(chunk.fourCC, c.fourCC, 4);
+			chunk.offset = chunk_offset;
+			chunk.size = c.data.size();
+			append_binary(&chunk, sizeof(chunk));
+			chunk_offset += c.data.size();
+		}
+	}
+	append_binary(body.data(), body.size());
+	for (auto&& c : chunks)
+	{
+		append_binary(c.data.data(), c.data.size());
+	}
+
+	if (pInfo)
+	{
+		pInfo->version = mesh_head.version;
+		pInfo->bodySize = body.size();
+		pInfo->numMeshlets = num_meshlets;
+		pInfo->numLods = num_lods;
+	}
+
+	return true;
+}
+
+
+// EOF
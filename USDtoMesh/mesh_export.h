@@ -0,0 +1,197 @@
+﻿#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../SampleLib12/include/sl12/mesh_format.h"
+#include "mesh_optimize.h"
+#include "mesh_simplify.h"
+
+
+/**********************************************//**
+ * @brief 変換オプション
+**************************************************/
+struct ConvertOptions
+{
+	float	weld_epsilon = 0.0f;
+	bool	compress = false;
+	bool	build_meshlets = false;
+	int		num_threads = 1;
+	bool	verbose = false;
+
+	// メッシュレットの上限
+	sl12::u32	meshlet_max_vertices = 64;
+	sl12::u32	meshlet_max_primitives = 124;
+
+	// LOD生成
+	sl12::u32	num_lods = 0;
+	float		lod_reduction = 0.5f;
+	float		lod_attribute_weight = 1.0f;
+};	// struct ConvertOptions
+
+/**********************************************//**
+ * @brief 浮動小数点ベクトル
+**************************************************/
+struct Vec2
+{
+	float	x, y;
+};
+struct Vec3
+{
+	float	x, y, z;
+};
+
+/**********************************************//**
+ * @brief 頂点データ
+**************************************************/
+struct Vertex
+{
+	Vec3	position;
+	Vec3	normal;
+	Vec2	texcoord;
+
+	bool operator==(const Vertex& v) const
+	{
+		return memcmp(this, &v, sizeof(*this)) == 0;
+	}
+	bool operator!=(const Vertex& v) const
+	{
+		return !operator==(v);
+	}
+	bool operator<(const Vertex& v) const
+	{
+		return memcmp(this, &v, sizeof(*this)) < 0;
+	}
+	bool operator>(const Vertex& v) const
+	{
+		return memcmp(this, &v, sizeof(*this)) > 0;
+	}
+};	// struct Vertex
+
+/**********************************************//**
+ * @brief 頂点溶接用ハッシュテーブル
+ *
+ * オープンアドレス法 (線形探索) で頂点のビット列をキーに重複を検出する.\n
+ * epsilon が正の場合は法線とUVを epsilon 単位の格子に量子化したものをキーとし、
+ * 最初に登録された頂点を代表として使用する.
+**************************************************/
+class VertexWelder
+{
+public:
+	VertexWelder(size_t max_vertices, float epsilon);
+
+	/**
+	 * @brief 頂点を検索し、なければ追加する
+	 *
+	 * @return 頂点インデックス
+	*/
+	int FindOrAdd(const Vertex& v, std::vector<Vertex>& vertices);
+
+private:
+	Vertex MakeKey(const Vertex& v) const;
+	static size_t Hash(const Vertex& v);
+
+private:
+	std::vector<int>		table_;
+	std::vector<Vertex>		keys_;
+	size_t					mask_;
+	float					inv_epsilon_;
+};	// class VertexWelder
+
+/**********************************************//**
+ * @brief メッシュノード
+ *
+ * USD から読み込んだポリゴンと、変換後の三角形、最適化結果を保持する
+**************************************************/
+struct MeshNode
+{
+	std::string			name_;
+
+	std::vector<Vec3>	positions_;
+	std::vector<Vec3>	normals_;				//!< 角ごと
+	std::vector<Vec2>	texcoords_;				//!< 角ごと
+	std::vector<int>	poly_vertex_counts_;
+	std::vector<int>	poly_vertex_indices_;
+
+	std::vector<Vertex>	vertices_;
+	std::vector<int>	triangle_indices_;
+	std::vector<int>	triangle_material_indices_;
+	std::map<int, std::vector<sl12::u32>>	sub_mesh_indices_;
+
+	VertexCacheStats	cache_stats_before_;
+	VertexCacheStats	cache_stats_after_;
+
+	MeshletBuildResult		meshlets_;
+	std::vector<sl12::u32>	sub_mesh_meshlet_counts_;
+
+	// sub_mesh_indices_ と同じ順序で、LOD1以降を格納する
+	std::vector<std::vector<SimplifyLod>>	sub_mesh_lods_;
+};	// struct MeshNode
+
+/**********************************************//**
+ * @brief マテリアルノード
+**************************************************/
+struct MaterialNode
+{
+	std::string				name_;
+};	// struct MaterialNode
+
+/**********************************************//**
+ * @brief 出力したバイナリの情報
+**************************************************/
+struct MeshBinaryInfo
+{
+	sl12::u32	version = 0;
+	size_t		bodySize = 0;		//!< 頂点・インデックス領域のサイズ
+	sl12::u32	numMeshlets = 0;
+	sl12::u32	numLods = 0;
+};	// struct MeshBinaryInfo
+
+/**
+ * @brief ポリゴンの角を溶接し、三角形に分割してマテリアルごとのサブメッシュにまとめる
+ *
+ * positions_, normals_, texcoords_, poly_vertex_counts_, poly_vertex_indices_ を読み込んだメッシュに対して呼び出す.
+ *
+ * @param[in,out]	out_mesh				メッシュノード
+ * @param[in]		poly_material_indices	ポリゴンごとのマテリアル番号
+ * @param[in]		weld_epsilon			法線とUVの溶接の許容値. 0 の場合はビット単位で一致する頂点のみ溶接する
+*/
+void TriangulateMeshNode(MeshNode& out_mesh, const std::vector<int>& poly_material_indices, float weld_epsilon);
+
+/**
+ * @brief シェイプ全体の頂点キャッシュ統計を取得する
+ *
+ * サブメッシュごとに描画するので、キャッシュはサブメッシュ単位でリセットして計測する
+*/
+VertexCacheStats AnalyzeMeshNode(const MeshNode& mesh);
+
+/**
+ * @brief メッシュノードの頂点キャッシュと頂点フェッチを最適化する
+ *
+ * サブメッシュごとに三角形を並べ替えた後、頂点を初出順に並べ替える.\n
+ * オプションに応じてLODとメッシュレットも生成する.
+*/
+void OptimizeMeshNode(MeshNode& mesh, const ConvertOptions& options);
+
+/**
+ * @brief .meshバイナリを生成する
+ *
+ * compress が true の場合はv2形式で出力し、
+ * 座標はAABB相対の16bit、法線は八面体エンコード、UVはhalf、
+ * 頂点数が65536以下のシェイプのインデックスは16bitで格納する\n
+ * メッシュレットやLODを生成した場合は非圧縮でもv2形式とし、インデックス領域の後ろにチャンクとして格納する\n
+ * LODのインデックスは各シェイプのインデックス領域内、LOD0の後ろに格納する\n
+ * 各シェイプの出力位置はサイズの累積和で先に決定し、ストリームの書き込みは並列に行う.\n
+ * 出力はスレッド数によらず同一になる.
+ *
+ * @param[out]	out_binary	ファイルの内容全体
+ * @param[out]	pInfo		nullptr でなければ出力したバイナリの情報を格納する
+*/
+bool BuildMeshBinary(const std::vector<MeshNode*>& meshes, const std::vector<MaterialNode*>& materials, const ConvertOptions& options, std::vector<char>& out_binary, MeshBinaryInfo* pInfo = nullptr);
+
+
+// EOF
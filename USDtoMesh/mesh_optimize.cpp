@@ -0,0 +1,502 @@
+﻿#include "mesh_optimize.h"
+
+#include <algorithm>
+#include <math.h>
+#include <assert.h>
+
+
+namespace
+{
+	// Forsyth のスコア計算に使用するLRUキャッシュのサイズ
+	static const int	kCacheSize = 32;
+
+	static const float	kCacheDecayPower = 1.5f;
+	static const float	kLastTriScore = 0.75f;
+	static const float	kValenceBoostScale = 2.0f;
+	static const float	kValenceBoostPower = 0.5f;
+
+	/**********************************************//**
+	 * @brief 頂点ごとの作業データ
+	**************************************************/
+	struct VertexWork
+	{
+		int			cachePos = -1;			//!< LRUキャッシュ内の位置 (-1はキャッシュ外)
+		uint32_t	numRemaining = 0;		//!< 未出力の隣接三角形数
+		uint32_t	adjacencyStart = 0;		//!< 隣接三角形リストの開始位置
+		float		score = 0.0f;
+	};	// struct VertexWork
+
+	// 頂点のスコアを計算する
+	float CalcVertexScore(int cachePos, uint32_t numRemaining)
+	{
+		if (numRemaining == 0)
+		{
+			// 残りの三角形がない頂点は選ばれないようにする
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (cachePos >= 0)
+		{
+			if (cachePos < 3)
+			{
+				// 直前の三角形で使われた頂点は、次に続けて使うと効率が悪い
+				score = kLastTriScore;
+			}
+			else
+			{
+				const float scaler = 1.0f / static_cast<float>(kCacheSize - 3);
+				score = 1.0f - static_cast<float>(cachePos - 3) * scaler;
+				score = powf(score, kCacheDecayPower);
+			}
+		}
+
+		// 残り三角形が少ない頂点を優先して消化する
+		score += kValenceBoostScale * powf(static_cast<float>(numRemaining), -kValenceBoostPower);
+		return score;
+	}
+}
+
+//---------------------------------------
+// 頂点キャッシュに合わせて三角形を並べ替える
+//---------------------------------------
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t numVertices)
+{
+	const size_t numTriangles = indices.size() / 3;
+	if (numTriangles == 0 || numVertices == 0)
+	{
+		return;
+	}
+
+	// 頂点ごとの隣接三角形リストを生成する
+	std::vector<VertexWork> vertices(numVertices);
+	for (auto index : indices)
+	{
+		assert(index < numVertices);
+		vertices[index].numRemaining++;
+	}
+	uint32_t offset = 0;
+	for (auto&& v : vertices)
+	{
+		v.adjacencyStart = offset;
+		offset += v.numRemaining;
+	}
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(numVertices, 0);
+		for (size_t tri = 0; tri < numTriangles; ++tri)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[tri * 3 + k];
+				adjacency[vertices[v].adjacencyStart + fill[v]++] = static_cast<uint32_t>(tri);
+			}
+		}
+	}
+
+	// 初期スコア
+	for (auto&& v : vertices)
+	{
+		v.score = CalcVertexScore(v.cachePos, v.numRemaining);
+	}
+	std::vector<float> triScores(numTriangles);
+	std::vector<bool> triEmitted(numTriangles, false);
+	for (size_t tri = 0; tri < numTriangles; ++tri)
+	{
+		triScores[tri] = vertices[indices[tri * 3 + 0]].score + vertices[indices[tri * 3 + 1]].score + vertices[indices[tri * 3 + 2]].score;
+	}
+
+	std::vector<uint32_t> result;
+	result.reserve(indices.size());
+
+	int cache[kCacheSize + 3];
+	int cacheCount = 0;
+	size_t scanCursor = 0;
+	size_t bestTri = 0;
+	float bestScore = triScores[0];
+	for (size_t tri = 1; tri < numTriangles; ++tri)
+	{
+		if (triScores[tri] > bestScore)
+		{
+			bestScore = triScores[tri];
+			bestTri = tri;
+		}
+	}
+
+	for (size_t emitted = 0; emitted < numTriangles; ++emitted)
+	{
+		if (bestScore < 0.0f)
+		{
+			// キャッシュ内に候補がない場合は未出力の三角形を先頭から探す
+			while (triEmitted[scanCursor])
+			{
+				++scanCursor;
+			}
+			bestTri = scanCursor;
+		}
+
+		// 三角形を出力し、隣接リストから取り除く
+		triEmitted[bestTri] = true;
+		const uint32_t* pTri = &indices[bestTri * 3];
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t vi = pTri[k];
+			result.push_back(vi);
+
+			VertexWork& v = vertices[vi];
+			uint32_t* pAdj = &adjacency[v.adjacencyStart];
+			for (uint32_t a = 0; a < v.numRemaining; ++a)
+			{
+				if (pAdj[a] == bestTri)
+				{
+					std::swap(pAdj[a], pAdj[v.numRemaining - 1]);
+					break;
+				}
+			}
+			v.numRemaining--;
+		}
+
+		// LRUキャッシュを更新する
+		// 出力した三角形の頂点を先頭に置き、押し出された頂点はキャッシュ外とする
+		// 縮退した三角形の重複した頂点は1つだけ置く
+		int newCache[kCacheSize + 3];
+		int newCount = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			int vi = static_cast<int>(pTri[k]);
+			if (std::find(newCache, newCache + newCount, vi) == newCache + newCount)
+			{
+				newCache[newCount++] = vi;
+			}
+		}
+		for (int c = 0; c < cacheCount; ++c)
+		{
+			int vi = cache[c];
+			if (vi != static_cast<int>(pTri[0]) && vi != static_cast<int>(pTri[1]) && vi != static_cast<int>(pTri[2]))
+			{
+				newCache[newCount++] = vi;
+			}
+		}
+		for (int c = 0; c < newCount; ++c)
+		{
+			vertices[newCache[c]].cachePos = (c < kCacheSize) ? c : -1;
+		}
+		cacheCount = std::min(newCount, kCacheSize);
+		std::copy(newCache, newCache + newCount, cache);
+
+		// キャッシュ内 (と押し出された) 頂点のスコアを更新し、隣接三角形から次の候補を選ぶ
+		for (int c = 0; c < newCount; ++c)
+		{
+			VertexWork& v = vertices[cache[c]];
+			float newScore = CalcVertexScore(v.cachePos, v.numRemaining);
+			float diff = newScore - v.score;
+			v.score = newScore;
+			const uint32_t* pAdj = &adjacency[v.adjacencyStart];
+			for (uint32_t a = 0; a < v.numRemaining; ++a)
+			{
+				triScores[pAdj[a]] += diff;
+			}
+		}
+
+		bestScore = -1.0f;
+		for (int c = 0; c < cacheCount; ++c)
+		{
+			const VertexWork& v = vertices[cache[c]];
+			const uint32_t* pAdj = &adjacency[v.adjacencyStart];
+			for (uint32_t a = 0; a < v.numRemaining; ++a)
+			{
+				if (triScores[pAdj[a]] > bestScore)
+				{
+					bestScore = triScores[pAdj[a]];
+					bestTri = pAdj[a];
+				}
+			}
+		}
+	}
+
+	indices.swap(result);
+}
+
+//---------------------------------------
+// 頂点をインデックスの初出順に並べ替えるリマップテーブルを生成する
+//---------------------------------------
+std::vector<uint32_t> BuildVertexFetchRemap(const std::vector<const std::vector<uint32_t>*>& indexLists, uint32_t numVertices)
+{
+	static const uint32_t kInvalid = 0xffffffff;
+
+	std::vector<uint32_t> remap(numVertices, kInvalid);
+	uint32_t next = 0;
+	for (auto&& pList : indexLists)
+	{
+		for (auto index : *pList)
+		{
+			if (remap[index] == kInvalid)
+			{
+				remap[index] = next++;
+			}
+		}
+	}
+
+	// 参照されない頂点は末尾に残す
+	for (auto&& r : remap)
+	{
+		if (r == kInvalid)
+		{
+			r = next++;
+		}
+	}
+	return remap;
+}
+
+//---------------------------------------
+// FIFOキャッシュをシミュレートして統計情報を取得する
+//---------------------------------------
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize)
+{
+	VertexCacheStats ret;
+	if (numIndices < 3 || numVertices == 0)
+	{
+		return ret;
+	}
+
+	// 各頂点がキャッシュに入ったときのタイムスタンプで FIFO を表現する
+	std::vector<uint32_t> timestamps(numVertices, 0);
+	std::vector<bool> used(numVertices, false);
+	uint32_t time = cacheSize + 1;
+	uint32_t numUsed = 0;
+	for (size_t i = 0; i < numIndices; ++i)
+	{
+		uint32_t index = pIndices[i];
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			ret.numTransformed++;
+		}
+		if (!used[index])
+		{
+			used[index] = true;
+			numUsed++;
+		}
+	}
+
+	ret.acmr = static_cast<float>(ret.numTransformed) / static_cast<float>(numIndices / 3);
+	ret.atvr = static_cast<float>(ret.numTransformed) / static_cast<float>(numUsed);
+	return ret;
+}
+
+namespace
+{
+	struct Float3
+	{
+		float	x, y, z;
+
+		Float3 operator+(const Float3& v) const { return{ x + v.x, y + v.y, z + v.z }; }
+		Float3 operator-(const Float3& v) const { return{ x - v.x, y - v.y, z - v.z }; }
+		Float3 operator*(float s) const { return{ x * s, y * s, z * s }; }
+	};
+
+	float Dot(const Float3& a, const Float3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+	Float3 Cross(const Float3& a, const Float3& b)
+	{
+		return{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+	float Length(const Float3& v)
+	{
+		return sqrtf(Dot(v, v));
+	}
+
+	// メッシュレットの境界球とコーンを計算する
+	void CalcMeshletBounds(sl12::MeshMeshlet& meshlet, const MeshletBuildResult& result, const float* pPositions, size_t positionStride)
+	{
+		auto getPos = [&](uint32_t localIndex)
+		{
+			uint32_t v = result.vertexIndices[meshlet.vertexOffset + localIndex];
+			const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(pPositions) + positionStride * v);
+			return Float3{ p[0], p[1], p[2] };
+		};
+
+		// 境界球 (Ritter)
+		// 最初の頂点から最も遠い頂点、さらにそこから最も遠い頂点を直径の初期値とする
+		Float3 a = getPos(0);
+		Float3 b = a;
+		float maxDist = -1.0f;
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			Float3 p = getPos(i);
+			float d = Dot(p - a, p - a);
+			if (d > maxDist) { maxDist = d; b = p; }
+		}
+		maxDist = -1.0f;
+		Float3 c = b;
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			Float3 p = getPos(i);
+			float d = Dot(p - b, p - b);
+			if (d > maxDist) { maxDist = d; c = p; }
+		}
+		Float3 center = (b + c) * 0.5f;
+		float radius = Length(c - b) * 0.5f;
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			Float3 p = getPos(i);
+			float d = Length(p - center);
+			if (d > radius)
+			{
+				// 外側の頂点を含むように球を広げる
+				float newRadius = (radius + d) * 0.5f;
+				center = center + (p - center) * ((newRadius - radius) / d);
+				radius = newRadius;
+			}
+		}
+
+		meshlet.center[0] = center.x;
+		meshlet.center[1] = center.y;
+		meshlet.center[2] = center.z;
+		meshlet.radius = radius;
+
+		// 法線コーン
+		// 面積を無視した法線の平均を軸とし、軸と各法線の最小の内積から広がりを求める
+		std::vector<Float3> normals;
+		std::vector<Float3> points;
+		normals.reserve(meshlet.primitiveCount);
+		points.reserve(meshlet.primitiveCount);
+		Float3 axis = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t i = 0; i < meshlet.primitiveCount; ++i)
+		{
+			uint32_t prim = result.primitives[meshlet.primitiveOffset + i];
+			Float3 p0 = getPos(prim & 0xff);
+			Float3 p1 = getPos((prim >> 8) & 0xff);
+			Float3 p2 = getPos((prim >> 16) & 0xff);
+			Float3 n = Cross(p1 - p0, p2 - p0);
+			float len = Length(n);
+			if (len <= 0.0f)
+			{
+				// 縮退した三角形はコーンに含めない
+				continue;
+			}
+			n = n * (1.0f / len);
+			normals.push_back(n);
+			points.push_back(p0);
+			axis = axis + n;
+		}
+
+		meshlet.coneAxis[0] = meshlet.coneAxis[1] = meshlet.coneAxis[2] = 0.0f;
+		meshlet.coneApex[0] = center.x;
+		meshlet.coneApex[1] = center.y;
+		meshlet.coneApex[2] = center.z;
+		meshlet.coneCutoff = 1.0f;
+
+		float axisLen = Length(axis);
+		if (normals.empty() || axisLen <= 0.0f)
+		{
+			return;
+		}
+		axis = axis * (1.0f / axisLen);
+
+		float minDot = 1.0f;
+		for (auto&& n : normals)
+		{
+			minDot = std::min(minDot, Dot(axis, n));
+		}
+		if (minDot <= 0.1f)
+		{
+			// 広がりが90度に近い場合はカリングできない
+			return;
+		}
+
+		// 全ての三角形の平面より後ろに頂点を置く
+		float maxT = 0.0f;
+		for (size_t i = 0; i < normals.size(); ++i)
+		{
+			float t = Dot(center - points[i], normals[i]) / Dot(axis, normals[i]);
+			maxT = std::max(maxT, t);
+		}
+		Float3 apex = center - axis * maxT;
+
+		meshlet.coneAxis[0] = axis.x;
+		meshlet.coneAxis[1] = axis.y;
+		meshlet.coneAxis[2] = axis.z;
+		meshlet.coneApex[0] = apex.x;
+		meshlet.coneApex[1] = apex.y;
+		meshlet.coneApex[2] = apex.z;
+		meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+//---------------------------------------
+// 三角形リストからメッシュレットを生成する
+//---------------------------------------
+uint32_t BuildMeshlets(const std::vector<uint32_t>& indices, const float* pPositions, size_t positionStride, uint32_t numVertices, uint32_t maxVertices, uint32_t maxPrimitives, MeshletBuildResult& result)
+{
+	assert(maxVertices >= 3 && maxVertices <= 256);
+	assert(maxPrimitives >= 1);
+
+	static const uint32_t kInvalid = 0xffffffff;
+
+	// 頂点ごとの現在のメッシュレット内の番号
+	std::vector<uint32_t> localIndex(numVertices, kInvalid);
+	uint32_t numBuilt = 0;
+
+	sl12::MeshMeshlet current = {};
+	current.vertexOffset = (uint32_t)result.vertexIndices.size();
+	current.primitiveOffset = (uint32_t)result.primitives.size();
+
+	auto flush = [&]()
+	{
+		if (current.primitiveCount == 0)
+		{
+			return;
+		}
+		for (uint32_t i = 0; i < current.vertexCount; ++i)
+		{
+			localIndex[result.vertexIndices[current.vertexOffset + i]] = kInvalid;
+		}
+		CalcMeshletBounds(current, result, pPositions, positionStride);
+		result.meshlets.push_back(current);
+		++numBuilt;
+
+		current = {};
+		current.vertexOffset = (uint32_t)result.vertexIndices.size();
+		current.primitiveOffset = (uint32_t)result.primitives.size();
+	};
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		const uint32_t* tri = &indices[i];
+		uint32_t newVertices = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			if (localIndex[tri[k]] == kInvalid && (k == 0 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]))
+			{
+				++newVertices;
+			}
+		}
+		if (current.vertexCount + newVertices > maxVertices || current.primitiveCount + 1 > maxPrimitives)
+		{
+			flush();
+		}
+
+		uint32_t prim = 0;
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t& local = localIndex[tri[k]];
+			if (local == kInvalid)
+			{
+				local = current.vertexCount++;
+				result.vertexIndices.push_back(tri[k]);
+			}
+			prim |= local << (k * 8);
+		}
+		result.primitives.push_back(prim);
+		current.primitiveCount++;
+	}
+	flush();
+
+	return numBuilt;
+}
+
+
+// EOF
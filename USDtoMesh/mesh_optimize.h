@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../SampleLib12/include/sl12/mesh_format.h"
+
+
+/**********************************************//**
+ * @brief 頂点キャッシュの統計情報
+**************************************************/
+struct VertexCacheStats
+{
+	uint32_t	numTransformed = 0;		//!< キャッシュミスで変換された頂点数
+	float		acmr = 0.0f;			//!< Average Cache Miss Ratio (変換頂点数 / 三角形数)
+	float		atvr = 0.0f;			//!< Average Transform to Vertex Ratio (変換頂点数 / 使用頂点数)
+};	// struct VertexCacheStats
+
+/**
+ * @brief 頂点キャッシュに合わせて三角形を並べ替える
+ *
+ * Forsyth の線形時間アルゴリズムで、インデックス列の三角形の順序を入れ替える.\n
+ * 三角形内の頂点の順序 (表裏) は変更しない.
+ *
+ * @param[in,out]	indices		三角形リストのインデックス
+ * @param[in]		numVertices	頂点数
+*/
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t numVertices);
+
+/**
+ * @brief 頂点をインデックスの初出順に並べ替えるリマップテーブルを生成する
+ *
+ * 複数のインデックス列 (サブメッシュ) を順に走査し、初めて参照された順に新しい番号を振る.\n
+ * 参照されない頂点は末尾に元の順序で配置する.
+ *
+ * @param[in]	indexLists	インデックス列の配列
+ * @param[in]	numVertices	頂点数
+ * @return 元の頂点番号から新しい頂点番号へのテーブル
+*/
+std::vector<uint32_t> BuildVertexFetchRemap(const std::vector<const std::vector<uint32_t>*>& indexLists, uint32_t numVertices);
+
+/**
+ * @brief FIFOキャッシュをシミュレートして統計情報を取得する
+ *
+ * @param[in]	pIndices	三角形リストのインデックス
+ * @param[in]	numIndices	インデックス数
+ * @param[in]	numVertices	頂点数
+ * @param[in]	cacheSize	キャッシュサイズ
+*/
+VertexCacheStats AnalyzeVertexCache(const uint32_t* pIndices, size_t numIndices, uint32_t numVertices, uint32_t cacheSize = 16);
+
+
+/**********************************************//**
+ * @brief メッシュレットの生成結果
+ *
+ * 複数のサブメッシュの結果を追加していくため、各オフセットは配列全体に対するもの
+**************************************************/
+struct MeshletBuildResult
+{
+	std::vector<sl12::MeshMeshlet>	meshlets;
+	std::vector<uint32_t>			vertexIndices;		//!< シェイプの頂点番号
+	std::vector<uint32_t>			primitives;			//!< メッシュレット内の頂点番号 u8 x 3
+};	// struct MeshletBuildResult
+
+/**
+ * @brief 三角形リストからメッシュレットを生成する
+ *
+ * インデックスの順序に沿って、頂点数とプリミティブ数の上限を超えるまで三角形を詰めていく.\n
+ * 頂点キャッシュ最適化後のインデックスを渡すと局所性の高いメッシュレットになる.
+ *
+ * @param[in]		indices			三角形リストのインデックス
+ * @param[in]		pPositions		頂点座標 (float x 3) の先頭
+ * @param[in]		positionStride	頂点座標のストライド (byte)
+ * @param[in]		numVertices		頂点数
+ * @param[in]		maxVertices		メッシュレットあたりの最大頂点数 (256以下)
+ * @param[in]		maxPrimitives	メッシュレットあたりの最大プリミティブ数
+ * @param[in,out]	result			生成結果を追加する
+ * @return 生成したメッシュレット数
+*/
+uint32_t BuildMeshlets(const std::vector<uint32_t>& indices, const float* pPositions, size_t positionStride, uint32_t numVertices, uint32_t maxVertices, uint32_t maxPrimitives, MeshletBuildResult& result);
+
+
+// EOF
@@ -0,0 +1,461 @@
+﻿#include "mesh_simplify.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+
+namespace
+{
+	/**********************************************//**
+	 * @brief 対称4x4行列で表した二次誤差
+	**************************************************/
+	struct Quadric
+	{
+		double	a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+		double	a11 = 0, a12 = 0, a13 = 0;
+		double	a22 = 0, a23 = 0;
+		double	a33 = 0;
+		double	weight = 0;		//!< 重みの合計. 誤差を距離の二乗に正規化するのに使用する
+
+		// 平面 ax + by + cz + d = 0 から生成する
+		static Quadric FromPlane(double a, double b, double c, double d, double weight)
+		{
+			Quadric q;
+			q.a00 = a * a * weight; q.a01 = a * b * weight; q.a02 = a * c * weight; q.a03 = a * d * weight;
+			q.a11 = b * b * weight; q.a12 = b * c * weight; q.a13 = b * d * weight;
+			q.a22 = c * c * weight; q.a23 = c * d * weight;
+			q.a33 = d * d * weight;
+			q.weight = weight;
+			return q;
+		}
+
+		Quadric& operator+=(const Quadric& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			weight += q.weight;
+			return *this;
+		}
+
+		double Evaluate(const float* p) const
+		{
+			double x = p[0], y = p[1], z = p[2];
+			return x * x * a00 + 2.0 * x * y * a01 + 2.0 * x * z * a02 + 2.0 * x * a03
+				+ y * y * a11 + 2.0 * y * z * a12 + 2.0 * y * a13
+				+ z * z * a22 + 2.0 * z * a23
+				+ a33;
+		}
+	};	// struct Quadric
+
+	/**********************************************//**
+	 * @brief 縮約候補
+	**************************************************/
+	struct Collapse
+	{
+		double		cost;
+		double		error;			//!< 属性ペナルティを含まない二次誤差
+		uint32_t	from;
+		uint32_t	to;
+		uint32_t	fromVersion;
+		uint32_t	toVersion;
+
+		bool operator>(const Collapse& c) const
+		{
+			// 同コストの場合も順序が決まるようにして、結果を決定的にする
+			if (cost != c.cost) return cost > c.cost;
+			if (from != c.from) return from > c.from;
+			return to > c.to;
+		}
+	};	// struct Collapse
+
+	/**********************************************//**
+	 * @brief 簡略化の作業データ
+	**************************************************/
+	class Simplifier
+	{
+	public:
+		Simplifier(const std::vector<uint32_t>& indices, const SimplifyVertexInput& vertices, float attributeWeight)
+			: vertices_(vertices), attributeWeight_(attributeWeight)
+		{
+			triangles_ = indices;
+			numTriangles_ = (uint32_t)(indices.size() / 3);
+			triRemoved_.assign(numTriangles_, false);
+			liveTriangles_ = numTriangles_;
+
+			uint32_t numVertices = vertices.numVertices;
+			quadrics_.resize(numVertices);
+			adjacency_.resize(numVertices);
+			locked_.assign(numVertices, false);
+			removed_.assign(numVertices, false);
+			version_.assign(numVertices, 0);
+
+			BuildQuadrics();
+			LockBoundaries();
+			for (uint32_t t = 0; t < numTriangles_; ++t)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					adjacency_[triangles_[t * 3 + k]].push_back(t);
+				}
+			}
+			for (uint32_t t = 0; t < numTriangles_; ++t)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t a = triangles_[t * 3 + k];
+					uint32_t b = triangles_[t * 3 + (k + 1) % 3];
+					PushCollapse(a, b);
+					PushCollapse(b, a);
+				}
+			}
+		}
+
+		// 三角形数が target 以下になるまで縮約する
+		// これ以上縮約できない場合は false を返す
+		bool Run(uint32_t target)
+		{
+			while (liveTriangles_ > target)
+			{
+				if (heap_.empty())
+				{
+					return false;
+				}
+				Collapse c = heap_.top();
+				heap_.pop();
+
+				if (removed_[c.from] || removed_[c.to] || version_[c.from] != c.fromVersion || version_[c.to] != c.toVersion)
+				{
+					continue;
+				}
+				if (!CanCollapse(c.from, c.to))
+				{
+					continue;
+				}
+				DoCollapse(c.from, c.to);
+				maxError_ = std::max(maxError_, c.error);
+			}
+			return true;
+		}
+
+		// 現在の三角形リストを出力する
+		void Output(SimplifyLod& lod) const
+		{
+			lod.indices.clear();
+			lod.indices.reserve(liveTriangles_ * 3);
+			for (uint32_t t = 0; t < numTriangles_; ++t)
+			{
+				if (!triRemoved_[t])
+				{
+					lod.indices.insert(lod.indices.end(), &triangles_[t * 3], &triangles_[t * 3] + 3);
+				}
+			}
+			lod.error = (float)sqrt(std::max(maxError_, 0.0));
+		}
+
+		uint32_t GetLiveTriangleCount() const
+		{
+			return liveTriangles_;
+		}
+
+	private:
+		const float* Position(uint32_t v) const
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(vertices_.pPositions) + vertices_.stride * v);
+		}
+		const float* Normal(uint32_t v) const
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(vertices_.pNormals) + vertices_.stride * v);
+		}
+		const float* Texcoord(uint32_t v) const
+		{
+			return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(vertices_.pTexcoords) + vertices_.stride * v);
+		}
+
+		static void TriangleNormal(const float* p0, const float* p1, const float* p2, double* n)
+		{
+			double e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			n[0] = e0[1] * e1[2] - e0[2] * e1[1];
+			n[1] = e0[2] * e1[0] - e0[0] * e1[2];
+			n[2] = e0[0] * e1[1] - e0[1] * e1[0];
+		}
+
+		// 各頂点に隣接三角形の平面の二次誤差を面積で重み付けして加算する
+		void BuildQuadrics()
+		{
+			for (uint32_t t = 0; t < numTriangles_; ++t)
+			{
+				const uint32_t* tri = &triangles_[t * 3];
+				const float* p0 = Position(tri[0]);
+				double n[3];
+				TriangleNormal(p0, Position(tri[1]), Position(tri[2]), n);
+				double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (len <= 0.0)
+				{
+					continue;
+				}
+				n[0] /= len; n[1] /= len; n[2] /= len;
+				double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+				Quadric q = Quadric::FromPlane(n[0], n[1], n[2], d, len * 0.5);
+				for (int k = 0; k < 3; ++k)
+				{
+					quadrics_[tri[k]] += q;
+				}
+			}
+		}
+
+		// 境界エッジと属性の継ぎ目の頂点を固定する
+		void LockBoundaries()
+		{
+			std::unordered_map<uint64_t, uint32_t> edgeCount;
+			edgeCount.reserve(triangles_.size());
+			for (uint32_t t = 0; t < numTriangles_; ++t)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t a = triangles_[t * 3 + k];
+					uint32_t b = triangles_[t * 3 + (k + 1) % 3];
+					uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+					edgeCount[key]++;
+				}
+			}
+			for (auto&& e : edgeCount)
+			{
+				if (e.second != 2)
+				{
+					locked_[(uint32_t)(e.first >> 32)] = true;
+					locked_[(uint32_t)(e.first & 0xffffffff)] = true;
+				}
+			}
+
+			// 同じ座標を持つ別の頂点が使われている場合は継ぎ目とみなす
+			std::unordered_map<uint64_t, uint32_t> positionOwner;
+			for (auto index : triangles_)
+			{
+				const float* p = Position(index);
+				uint32_t bits[3];
+				memcpy(bits, p, sizeof(bits));
+				uint64_t key = (uint64_t)bits[0] * 0x9e3779b97f4a7c15ull ^ (uint64_t)bits[1] * 0xc2b2ae3d27d4eb4full ^ (uint64_t)bits[2] * 0x165667b19e3779f9ull;
+				auto it = positionOwner.find(key);
+				if (it == positionOwner.end())
+				{
+					positionOwner[key] = index;
+				}
+				else if (it->second != index && memcmp(Position(it->second), p, sizeof(float) * 3) == 0)
+				{
+					locked_[it->second] = true;
+					locked_[index] = true;
+				}
+			}
+		}
+
+		double CalcCost(uint32_t from, uint32_t to, double* pError) const
+		{
+			Quadric q = quadrics_[from];
+			q += quadrics_[to];
+			const float* pt = Position(to);
+			double cost = std::max(q.Evaluate(pt), 0.0);
+			*pError = (q.weight > 0.0) ? cost / q.weight : 0.0;
+
+			if (attributeWeight_ > 0.0f)
+			{
+				const float* pf = Position(from);
+				double edge2 = 0.0, attr2 = 0.0;
+				for (int i = 0; i < 3; ++i)
+				{
+					edge2 += (double)(pt[i] - pf[i]) * (pt[i] - pf[i]);
+				}
+				if (vertices_.pNormals)
+				{
+					const float* nf = Normal(from);
+					const float* nt = Normal(to);
+					for (int i = 0; i < 3; ++i)
+					{
+						attr2 += (double)(nt[i] - nf[i]) * (nt[i] - nf[i]);
+					}
+				}
+				if (vertices_.pTexcoords)
+				{
+					const float* tf = Texcoord(from);
+					const float* tt = Texcoord(to);
+					for (int i = 0; i < 2; ++i)
+					{
+						attr2 += (double)(tt[i] - tf[i]) * (tt[i] - tf[i]);
+					}
+				}
+				cost += attributeWeight_ * attr2 * edge2;
+			}
+			return cost;
+		}
+
+		void PushCollapse(uint32_t from, uint32_t to)
+		{
+			if (from == to || locked_[from])
+			{
+				return;
+			}
+			Collapse c;
+			c.cost = CalcCost(from, to, &c.error);
+			c.from = from;
+			c.to = to;
+			c.fromVersion = version_[from];
+			c.toVersion = version_[to];
+			heap_.push(c);
+		}
+
+		// 縮約によって三角形が裏返らないかを調べる
+		bool CanCollapse(uint32_t from, uint32_t to) const
+		{
+			for (auto t : adjacency_[from])
+			{
+				if (triRemoved_[t])
+				{
+					continue;
+				}
+				const uint32_t* tri = &triangles_[t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					// 縮約で消える三角形
+					continue;
+				}
+
+				const float* p[3];
+				const float* q[3];
+				for (int k = 0; k < 3; ++k)
+				{
+					p[k] = Position(tri[k]);
+					q[k] = (tri[k] == from) ? Position(to) : p[k];
+				}
+				double n0[3], n1[3];
+				TriangleNormal(p[0], p[1], p[2], n0);
+				TriangleNormal(q[0], q[1], q[2], n1);
+				double dot = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+				double len0 = n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2];
+				double len1 = n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2];
+				if (len1 <= 0.0 || dot <= 0.0 || dot * dot < 0.25 * len0 * len1)
+				{
+					// 裏返る、縮退する、または60度以上回転する
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void DoCollapse(uint32_t from, uint32_t to)
+		{
+			for (auto t : adjacency_[from])
+			{
+				if (triRemoved_[t])
+				{
+					continue;
+				}
+				uint32_t* tri = &triangles_[t * 3];
+				if (tri[0] == to || tri[1] == to || tri[2] == to)
+				{
+					triRemoved_[t] = true;
+					--liveTriangles_;
+					continue;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					if (tri[k] == from)
+					{
+						tri[k] = to;
+					}
+				}
+				adjacency_[to].push_back(t);
+			}
+			adjacency_[from].clear();
+			removed_[from] = true;
+			quadrics_[to] += quadrics_[from];
+			version_[to]++;
+
+			// to 周辺の縮約候補を更新する
+			std::vector<uint32_t> neighbors;
+			for (auto t : adjacency_[to])
+			{
+				if (triRemoved_[t])
+				{
+					continue;
+				}
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v = triangles_[t * 3 + k];
+					if (v != to)
+					{
+						neighbors.push_back(v);
+					}
+				}
+			}
+			// to のバージョンが上がったので、to を含む古い候補は全て無効になる
+			std::sort(neighbors.begin(), neighbors.end());
+			neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+			for (auto v : neighbors)
+			{
+				PushCollapse(to, v);
+				PushCollapse(v, to);
+			}
+		}
+
+	private:
+		const SimplifyVertexInput&	vertices_;
+		float						attributeWeight_;
+
+		std::vector<uint32_t>		triangles_;
+		std::vector<bool>			triRemoved_;
+		uint32_t					numTriangles_ = 0;
+		uint32_t					liveTriangles_ = 0;
+
+		std::vector<Quadric>				quadrics_;
+		std::vector<std::vector<uint32_t>>	adjacency_;
+		std::vector<bool>					locked_;
+		std::vector<bool>					removed_;
+		std::vector<uint32_t>				version_;
+
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>>	heap_;
+		double						maxError_ = 0.0;
+	};	// class Simplifier
+}
+
+//---------------------------------------
+// 二次誤差計量によるエッジ縮約でLODチェーンを生成する
+//---------------------------------------
+void SimplifyLodChain(const std::vector<uint32_t>& indices, const SimplifyVertexInput& vertices, uint32_t numLods, float reduction, float attributeWeight, std::vector<SimplifyLod>& outLods)
+{
+	outLods.clear();
+	if (indices.size() < 3 || numLods == 0)
+	{
+		return;
+	}
+	assert(reduction > 0.0f && reduction < 1.0f);
+
+	// 前のLODから続けて縮約するので、誤差は単調に増加する
+	Simplifier simplifier(indices, vertices, attributeWeight);
+	uint32_t prevCount = simplifier.GetLiveTriangleCount();
+	for (uint32_t lod = 0; lod < numLods; ++lod)
+	{
+		uint32_t target = (uint32_t)(prevCount * reduction);
+		simplifier.Run(target);
+
+		uint32_t count = simplifier.GetLiveTriangleCount();
+		if (count == 0 || (float)count > (float)prevCount * 0.9f)
+		{
+			// ほとんど削減できない場合は打ち切る
+			break;
+		}
+
+		SimplifyLod result;
+		simplifier.Output(result);
+		outLods.push_back(std::move(result));
+		prevCount = count;
+	}
+}
+
+
+// EOF
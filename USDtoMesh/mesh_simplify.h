@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/**********************************************//**
+ * @brief 簡略化の入力頂点
+ *
+ * 各ポインタは stride バイト間隔で numVertices 個並んでいること
+**************************************************/
+struct SimplifyVertexInput
+{
+	const float*	pPositions = nullptr;	//!< float x 3
+	const float*	pNormals = nullptr;		//!< float x 3
+	const float*	pTexcoords = nullptr;	//!< float x 2
+	size_t			stride = 0;
+	uint32_t		numVertices = 0;
+};	// struct SimplifyVertexInput
+
+/**********************************************//**
+ * @brief 簡略化したLOD
+**************************************************/
+struct SimplifyLod
+{
+	std::vector<uint32_t>	indices;
+	float					error = 0.0f;		//!< オブジェクト空間での幾何誤差の上限の目安
+};	// struct SimplifyLod
+
+/**
+ * @brief 二次誤差計量によるエッジ縮約でLODチェーンを生成する
+ *
+ * 頂点を既存の頂点に縮約する (half-edge collapse) ので、全LODが元の頂点バッファを共有できる.\n
+ * 境界エッジ (サブメッシュ内で1つの三角形にのみ属するエッジ) と
+ * 同一座標に複数の頂点が存在する属性の継ぎ目の頂点は固定し、マテリアル境界と継ぎ目を保持する.\n
+ * 法線とUVの差はエッジ長に比例したペナルティとしてコストに加える.
+ *
+ * @param[in]	indices			三角形リストのインデックス
+ * @param[in]	vertices		頂点
+ * @param[in]	numLods			生成するLOD数 (LOD0は含まない)
+ * @param[in]	reduction		LODごとの三角形数の比率
+ * @param[in]	attributeWeight	属性ペナルティの重み
+ * @param[out]	outLods			生成したLOD. 十分に削減できない場合は numLods より少なくなる
+*/
+void SimplifyLodChain(const std::vector<uint32_t>& indices, const SimplifyVertexInput& vertices, uint32_t numLods, float reduction, float attributeWeight, std::vector<SimplifyLod>& outLods);
+
+
+// EOF